@@ -0,0 +1,347 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Sweeps the all-reduce strategies over message sizes and writes the calibration table that the AllReduce plugin
+// reads from TRTLLM_ALLREDUCE_STRATEGY_TABLE. Run it with one MPI rank per GPU of the tensor parallel group to measure
+// the system, or with --simulate to write a table from a latency-bandwidth model.
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/customAllReduceUtils.h"
+#include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+#include "tensorrt_llm/kernels/customAllReduceStrategyTable.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/ipcUtils.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <cxxopts.hpp>
+#include <nccl.h>
+
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+using tensorrt_llm::kernels::AllReduceStrategyTable;
+using tensorrt_llm::kernels::AllReduceStrategyType;
+
+namespace tc = tensorrt_llm::common;
+namespace tk = tensorrt_llm::kernels;
+namespace tmpi = tensorrt_llm::mpi;
+
+namespace
+{
+
+constexpr float kUnsupported = std::numeric_limits<float>::infinity();
+
+std::vector<std::string> splitArg(std::string const& arg)
+{
+    std::istringstream stream{arg};
+    std::vector<std::string> tokens;
+    for (std::string token; std::getline(stream, token, ';');)
+    {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+nvinfer1::DataType parseDataType(std::string const& name)
+{
+    if (name == "float32")
+    {
+        return nvinfer1::DataType::kFLOAT;
+    }
+    if (name == "float16")
+    {
+        return nvinfer1::DataType::kHALF;
+    }
+    if (name == "bfloat16")
+    {
+        return nvinfer1::DataType::kBF16;
+    }
+    TLLM_THROW("Unsupported data type %s", name.c_str());
+}
+
+std::vector<std::size_t> messageSizes(std::size_t minBytes, std::size_t maxBytes)
+{
+    // Powers of two are aligned for every strategy and world size of the custom kernels.
+    std::vector<std::size_t> sizes;
+    for (std::size_t bytes = minBytes; bytes <= maxBytes; bytes *= 2)
+    {
+        sizes.push_back(bytes);
+    }
+    return sizes;
+}
+
+bool isCustomSupported(AllReduceStrategyType strategy, std::size_t bytes, int worldSize, nvinfer1::DataType type)
+{
+    auto const elements = bytes / tc::getDTypeSize(type);
+    return bytes <= tensorrt_llm::utils::customAllReduceUtils::getMaxRequiredWorkspaceSize(worldSize)
+        && tk::configurationSupported(strategy, elements, worldSize, type);
+}
+
+// Latency-bandwidth model of the strategies on a switched topology. NCCL runs a ring with 2 (n - 1) steps,
+// the one-shot kernel has every rank read the whole message of each peer, and the two-shot kernel reduces a scatter
+// then gathers it.
+struct SimulatedSystem
+{
+    float ncclLatencyUs;
+    float ncclStepUs;
+    float oneShotLatencyUs;
+    float twoShotLatencyUs;
+    float bandwidthGBps;
+
+    [[nodiscard]] AllReduceStrategyTable::Latencies latencies(
+        std::size_t bytes, int worldSize, nvinfer1::DataType type) const
+    {
+        auto const n = static_cast<float>(worldSize);
+        auto const transferUs = static_cast<float>(bytes) / (bandwidthGBps * 1e3f);
+        AllReduceStrategyTable::Latencies result;
+        result[0] = ncclLatencyUs + 2 * (n - 1) * ncclStepUs + 2 * (n - 1) / n * transferUs;
+        result[1] = isCustomSupported(AllReduceStrategyType::ONESHOT, bytes, worldSize, type)
+            ? oneShotLatencyUs + (n - 1) * transferUs
+            : kUnsupported;
+        result[2] = isCustomSupported(AllReduceStrategyType::TWOSHOT, bytes, worldSize, type)
+            ? twoShotLatencyUs + 2 * (n - 1) / n * transferUs
+            : kUnsupported;
+        return result;
+    }
+};
+
+WorldConfig mpiWorldOnDevice()
+{
+    auto worldConfig = WorldConfig::mpi();
+    TLLM_CUDA_CHECK(cudaSetDevice(worldConfig.getDevice()));
+    return worldConfig;
+}
+
+// The hidden size of a single token whose buffers hold the largest message of the custom kernels.
+SizeType32 workspaceElements(int worldSize)
+{
+    auto const workspaceSize = tensorrt_llm::utils::customAllReduceUtils::getMaxRequiredWorkspaceSize(worldSize);
+    return static_cast<SizeType32>(workspaceSize / sizeof(float));
+}
+
+// Measures the strategies on the ranks of the MPI session, one GPU each. All ranks take part, rank 0 collects
+// the slowest rank's time of each run.
+class MeasuredSystem
+{
+public:
+    MeasuredSystem(int warmUp, int numRuns)
+        : mWorldConfig{mpiWorldOnDevice()}
+        , mManager{std::make_shared<CudaStream>()}
+        , mBuffers{1, 1, 1, workspaceElements(mWorldConfig.getSize()), mManager, mWorldConfig}
+        , mWarmUp{warmUp}
+        , mNumRuns{numRuns}
+    {
+        std::set<int> group;
+        for (int rank = 0; rank < mWorldConfig.getSize(); ++rank)
+        {
+            group.insert(rank);
+        }
+        mNcclComm = tensorrt_llm::plugins::getComm(group);
+        TLLM_CUDA_CHECK(cudaEventCreate(&mStart));
+        TLLM_CUDA_CHECK(cudaEventCreate(&mStop));
+    }
+
+    ~MeasuredSystem()
+    {
+        cudaEventDestroy(mStart);
+        cudaEventDestroy(mStop);
+    }
+
+    [[nodiscard]] int getWorldSize() const
+    {
+        return mWorldConfig.getSize();
+    }
+
+    [[nodiscard]] AllReduceStrategyTable::Latencies latencies(std::size_t bytes, nvinfer1::DataType type)
+    {
+        auto const worldSize = getWorldSize();
+        auto const elements = bytes / tc::getDTypeSize(type);
+        auto input = mManager.gpu(ITensor::makeShape({static_cast<SizeType32>(elements)}), type);
+        auto output = mManager.gpu(ITensor::makeShape({static_cast<SizeType32>(elements)}), type);
+        mManager.setZero(*input);
+
+        AllReduceStrategyTable::Latencies result;
+        for (std::size_t i = 0; i < AllReduceStrategyTable::kStrategies.size(); ++i)
+        {
+            auto const strategy = AllReduceStrategyTable::kStrategies[i];
+            if (strategy != AllReduceStrategyType::NCCL && !isCustomSupported(strategy, bytes, worldSize, type))
+            {
+                result[i] = kUnsupported;
+                continue;
+            }
+            auto const run = [&]() { allReduce(strategy, input->data(), output->data(), elements, type); };
+            result[i] = time(run);
+        }
+        return result;
+    }
+
+private:
+    void allReduce(AllReduceStrategyType strategy, void const* input, void* output, std::size_t elements,
+        nvinfer1::DataType type)
+    {
+        auto const stream = mManager.getStream().get();
+        if (strategy == AllReduceStrategyType::NCCL)
+        {
+            NCCLCHECK(ncclAllReduce(
+                input, output, elements, (*tensorrt_llm::plugins::getDtypeMap())[type], ncclSum, *mNcclComm, stream));
+            return;
+        }
+        auto params = tk::AllReduceParams::deserialize(bufferCast<int64_t>(*mBuffers.mAllReduceCommPtrs),
+            mWorldConfig.getSize(), mWorldConfig.getRank());
+        params.local_input_buffer_ptr = input;
+        params.local_output_buffer_ptr = output;
+        params.elts_total = elements;
+        tk::customAllReduce(params, type, strategy, tk::AllReduceStrategyConfig(0), tk::AllReduceFusionOp::NONE,
+            stream);
+    }
+
+    template <typename Run>
+    float time(Run const& run)
+    {
+        auto const stream = mManager.getStream().get();
+        auto const& comm = COMM_SESSION;
+        for (int i = 0; i < mWarmUp; ++i)
+        {
+            run();
+        }
+        TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+        comm.barrier();
+
+        TLLM_CUDA_CHECK(cudaEventRecord(mStart, stream));
+        for (int i = 0; i < mNumRuns; ++i)
+        {
+            run();
+        }
+        TLLM_CUDA_CHECK(cudaEventRecord(mStop, stream));
+        TLLM_CUDA_CHECK(cudaEventSynchronize(mStop));
+        float elapsedMs = 0.f;
+        TLLM_CUDA_CHECK(cudaEventElapsedTime(&elapsedMs, mStart, mStop));
+        auto const latencyUs = elapsedMs * 1e3f / static_cast<float>(mNumRuns);
+        float slowestUs = 0.f;
+        comm.allreduce(&latencyUs, &slowestUs, 1, tmpi::MpiType::kFLOAT, tmpi::MpiOp::MAX);
+        return slowestUs;
+    }
+
+    WorldConfig mWorldConfig;
+    BufferManager mManager;
+    AllReduceBuffers mBuffers;
+    std::shared_ptr<ncclComm_t> mNcclComm;
+    cudaEvent_t mStart;
+    cudaEvent_t mStop;
+    int mWarmUp;
+    int mNumRuns;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options(
+        "TensorRT-LLM all-reduce strategy sweep", "Writes the all-reduce strategy table of a system.");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()("output", "Path of the table to write.", cxxopts::value<std::string>());
+    options.add_options()("dtype",
+        "Data types to sweep, separated by \";\", example: \"float16;bfloat16\".",
+        cxxopts::value<std::string>()->default_value("float16;bfloat16"));
+    options.add_options()(
+        "min_bytes", "Smallest message size in bytes.", cxxopts::value<std::size_t>()->default_value("1024"));
+    options.add_options()("max_bytes", "Largest message size in bytes, sizes double from the smallest.",
+        cxxopts::value<std::size_t>()->default_value("67108864"));
+    options.add_options()(
+        "warm_up", "Warm up iterations of each measurement.", cxxopts::value<int>()->default_value("10"));
+    options.add_options()(
+        "num_runs", "Timed iterations of each measurement.", cxxopts::value<int>()->default_value("50"));
+    options.add_options()("simulate", "Write the table of a latency-bandwidth model instead of measuring.",
+        cxxopts::value<bool>()->default_value("false"));
+    options.add_options()("world_size", "World sizes to simulate, separated by \";\".",
+        cxxopts::value<std::string>()->default_value("2;4;8"));
+    options.add_options()("bandwidth", "Simulated per-GPU bandwidth in GB/s.",
+        cxxopts::value<float>()->default_value("150"));
+    options.add_options()("latency_us",
+        "Simulated fixed latencies of the NCCL launch, a NCCL ring step, the one-shot and the two-shot kernels in "
+        "microseconds, separated by \";\".",
+        cxxopts::value<std::string>()->default_value("8;1;4;8"));
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("output"))
+    {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    std::vector<nvinfer1::DataType> dataTypes;
+    for (auto const& name : splitArg(result["dtype"].as<std::string>()))
+    {
+        dataTypes.push_back(parseDataType(name));
+    }
+    auto const sizes = messageSizes(result["min_bytes"].as<std::size_t>(), result["max_bytes"].as<std::size_t>());
+    TLLM_CHECK_WITH_INFO(!sizes.empty(), "No message sizes between --min_bytes and --max_bytes");
+
+    AllReduceStrategyTable table;
+    if (result["simulate"].as<bool>())
+    {
+        auto const latencies = splitArg(result["latency_us"].as<std::string>());
+        TLLM_CHECK_WITH_INFO(latencies.size() == 4, "--latency_us takes four latencies");
+        SimulatedSystem const system{std::stof(latencies[0]), std::stof(latencies[1]), std::stof(latencies[2]),
+            std::stof(latencies[3]), result["bandwidth"].as<float>()};
+        for (auto const& worldSize : splitArg(result["world_size"].as<std::string>()))
+        {
+            for (auto const type : dataTypes)
+            {
+                for (auto const bytes : sizes)
+                {
+                    table.addSample(std::stoi(worldSize), type, bytes,
+                        system.latencies(bytes, std::stoi(worldSize), type));
+                }
+            }
+        }
+    }
+    else
+    {
+        MeasuredSystem system{result["warm_up"].as<int>(), result["num_runs"].as<int>()};
+        for (auto const type : dataTypes)
+        {
+            for (auto const bytes : sizes)
+            {
+                auto const latencies = system.latencies(bytes, type);
+                table.addSample(system.getWorldSize(), type, bytes, latencies);
+                TLLM_LOG_DEBUG("%zu bytes: NCCL %.1f us, ONESHOT %.1f us, TWOSHOT %.1f us", bytes, latencies[0],
+                    latencies[1], latencies[2]);
+            }
+        }
+        if (COMM_SESSION.getRank() != 0)
+        {
+            return 0;
+        }
+    }
+
+    table.save(result["output"].as<std::string>());
+    std::cout << "Wrote " << result["output"].as<std::string>() << std::endl;
+    return 0;
+}
@@ -18,6 +18,7 @@
 
 #include "tensorrt_llm/batch_manager/kvCacheConfig.h"
 #include "tensorrt_llm/batch_manager/llmRequest.h" // TODO forward declare
+#include "tensorrt_llm/common/hashUtils.h"
 #include "tensorrt_llm/kernels/kvCacheIndex.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/common.h"
@@ -65,7 +66,6 @@ struct BlockKey
 
 // Implement hash functor for BlockKey.
 // This allows us to use unordered_map with BlockKey as key.
-// Based on https://stackoverflow.com/questions/20511347/a-good-hash-function-for-a-vector/72073933#72073933
 struct BlockKeyHasher
 {
     std::size_t operator()(BlockKey const& blockKey) const noexcept
@@ -73,26 +73,10 @@ struct BlockKeyHasher
         size_t seed = blockKey.uniqueTokens.size();
         for (auto const& uniqueToken : blockKey.uniqueTokens)
         {
-            uint32_t a = static_cast<uint32_t>(uniqueToken.tokenId);
-            a = ((a >> 16) ^ a) * 0x45d9f3b;
-            a = ((a >> 16) ^ a) * 0x45d9f3b;
-            a = (a >> 16) ^ a;
-
-            uint64_t b = uniqueToken.tokenExtraId;
-            b = (b ^ (b >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
-            b = (b ^ (b >> 27)) * UINT64_C(0x94d049bb133111eb);
-            b = b ^ (b >> 31);
-
-            seed ^= a + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            seed ^= b + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            common::hashCombine(seed, common::hashMix32(static_cast<uint32_t>(uniqueToken.tokenId)));
+            common::hashCombine(seed, common::hashMix64(uniqueToken.tokenExtraId));
         }
-
-        uint64_t c = blockKey.loraTaskId;
-        c = (c ^ (c >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
-        c = (c ^ (c >> 27)) * UINT64_C(0x94d049bb133111eb);
-        c = c ^ (c >> 31);
-
-        seed ^= c + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        common::hashCombine(seed, common::hashMix64(blockKey.loraTaskId));
         return seed;
     }
 };
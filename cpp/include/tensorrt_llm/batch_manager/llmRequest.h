@@ -165,9 +165,18 @@ public:
         initialize(*inputTokens, returnLogProbs);
     }
 
+    // The prebuilt batch manager inlines its own copy of this constructor, which the linker may keep instead of this
+    // one. Both must leave the request in the same state, so only change how it is built, not what it holds.
     GenericLlmRequest(RequestIdType requestId, executor::Request const& req)
+        : GenericLlmRequest(requestId, req, req.getInputTokenIds())
+    {
+    }
+
+    /// @brief Constructs from a request whose prompt has already been fetched. The prompt is moved into the beams,
+    /// so that building a request costs a single copy of it on top of the beam width.
+    GenericLlmRequest(RequestIdType requestId, executor::Request const& req, VecTokens inputTokens)
         : mRequestId(requestId)
-        , mPromptLen(req.getInputTokenIds().size())
+        , mPromptLen(inputTokens.size())
         , mMaxNewTokens(req.getMaxTokens())
         , mSamplingConfig(req.getSamplingConfig(), req.getExternalDraftTokensConfig())
         , mState(REQUEST_STATE_CONTEXT_INIT)
@@ -234,12 +243,13 @@ public:
             mReturnGenerationLogits = false;
         }
 
-        if (req.getEncoderInputTokenIds().has_value() || req.getEncoderInputFeatures().has_value())
+        auto encoderInputTokens = req.getEncoderInputTokenIds();
+        if (encoderInputTokens.has_value() || req.getEncoderInputFeatures().has_value())
         {
             mState = REQUEST_STATE_ENCODER_INIT;
-            if (req.getEncoderInputTokenIds().has_value())
+            if (encoderInputTokens.has_value())
             {
-                mEncoderTokens = std::make_shared<VecTokens>(req.getEncoderInputTokenIds().value());
+                mEncoderTokens = std::make_shared<VecTokens>(std::move(encoderInputTokens.value()));
             }
         }
 
@@ -249,18 +259,18 @@ public:
             // Add leading 1 dimension since that's what IFB code expects
             mEmbeddingBias.value()->unsqueeze(0);
         }
-        if (req.getBadWords())
+        if (auto const badWords = req.getBadWords())
         {
-            mBadWordsList = createListTensor(req.getBadWords().value());
+            mBadWordsList = createListTensor(badWords.value());
         }
-        if (req.getStopWords())
+        if (auto const stopWords = req.getStopWords())
         {
-            mStopWordsList = createListTensor(req.getStopWords().value());
+            mStopWordsList = createListTensor(stopWords.value());
         }
 
-        if (req.getPositionIds())
+        if (auto positionIds = req.getPositionIds())
         {
-            mPositionIds = std::make_shared<std::vector<SizeType32>>(req.getPositionIds().value());
+            mPositionIds = std::make_shared<std::vector<SizeType32>>(std::move(positionIds.value()));
         }
 
         auto pTuningConfig = req.getPromptTuningConfig();
@@ -339,7 +349,7 @@ public:
         default: throw std::runtime_error("Unsupported request type found.");
         }
 
-        initialize(req.getInputTokenIds(), req.getOutputConfig().returnLogProbs);
+        initialize(std::move(inputTokens), req.getOutputConfig().returnLogProbs);
     }
 
     void validate(SizeType32 maxInputLen, SizeType32 maxSequenceLen, SizeType32 maxDraftLen,
@@ -1477,10 +1487,8 @@ protected:
     std::shared_ptr<std::vector<bool>> mSequenceFinalVec; // Indicators whether each sibling completes generation.
 
 private:
-    void initialize(VecTokens const& inputTokens, bool outputLogProbs)
+    void initialize(VecTokens inputTokens, bool outputLogProbs)
     {
-        // Scatter the input tokens to other beam
-        mTokens = BeamTokens(mSamplingConfig.beamWidth, inputTokens);
         mLastTokens = VecTokens(mSamplingConfig.beamWidth);
 
         // Init mUniqueTokens
@@ -1493,7 +1501,7 @@ private:
                 std::string errStr = "inputTokenExtraIds vector size must be the same as input token vector size.";
                 TLLM_THROW(errStr);
             }
-            VecTokenExtraIds tokenExtraIds = *mInputTokenExtraIds.value();
+            auto const& tokenExtraIds = *mInputTokenExtraIds.value();
             for (std::size_t i = 0; i < inputTokens.size(); ++i)
             {
                 uniqueTokens.push_back({inputTokens[i], tokenExtraIds[i]});
@@ -1507,7 +1515,14 @@ private:
                 uniqueTokens.push_back({inputTokens[i], 0});
             }
         }
-        mUniqueTokens = BeamUniqueTokens(mSamplingConfig.beamWidth, uniqueTokens);
+
+        // Scatter the input tokens to other beams. The last beam takes ownership, sparing a copy of the prompt.
+        auto const beamWidth = static_cast<std::size_t>(mSamplingConfig.beamWidth);
+        TLLM_CHECK(beamWidth > 0);
+        mTokens = BeamTokens(beamWidth - 1, inputTokens);
+        mTokens.push_back(std::move(inputTokens));
+        mUniqueTokens = BeamUniqueTokens(beamWidth - 1, uniqueTokens);
+        mUniqueTokens.push_back(std::move(uniqueTokens));
 
         // Init mEncoderUniqueTokens
         // TODO: use real extra id instead of default zero value
@@ -234,6 +234,16 @@ template <typename T_OUT, typename T_S, typename T_IN>
 void invokeComputeScalesAndQuantizeMatrix(T_OUT* output, T_S* quant_ptr, const T_IN* weights, const int64_t numel,
     const int64_t lda, QuantizeMode quantize_mode, cudaStream_t stream);
 
+// Host versions of invokeComputeScalesAndQuantizeMatrix and invokeDequantizeMatrix, for buffers in host memory. They
+// run on up to num_threads threads (0 for all hardware threads) and produce the same scales and values as the kernels.
+template <typename T_OUT, typename T_S, typename T_IN>
+void computeScalesAndQuantizeMatrixHost(T_OUT* output, T_S* quant_ptr, const T_IN* weights, const int64_t numel,
+    const int64_t lda, QuantizeMode quantize_mode, int num_threads = 0);
+
+template <typename T_OUT, typename T_S, typename T_IN>
+void dequantizeMatrixHost(T_OUT* output, T_S const* input_qua_amax_ptr, T_IN const* input, int64_t numel, int64_t lda,
+    QuantizeMode quantize_mode, int num_threads = 0);
+
 } // namespace common
 } // namespace tensorrt_llm
 #endif // ENABLE_FP8
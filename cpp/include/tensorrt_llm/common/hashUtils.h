@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tensorrt_llm::common
+{
+
+// Hashing of token blocks and other keys of hash maps, shared by the block manager and the runtime caches.
+// Based on https://stackoverflow.com/questions/20511347/a-good-hash-function-for-a-vector/72073933#72073933
+
+//! \brief Scrambles the bits of a 32-bit value, e.g. a token id, before it is combined.
+inline std::uint32_t hashMix32(std::uint32_t a) noexcept
+{
+    a = ((a >> 16) ^ a) * 0x45d9f3b;
+    a = ((a >> 16) ^ a) * 0x45d9f3b;
+    return (a >> 16) ^ a;
+}
+
+//! \brief Scrambles the bits of a 64-bit value, e.g. a token extra id or a LoRA task id, before it is combined.
+inline std::uint64_t hashMix64(std::uint64_t b) noexcept
+{
+    b = (b ^ (b >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    b = (b ^ (b >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return b ^ (b >> 31);
+}
+
+//! \brief Combines value into seed, order dependent. The constant is added to value in its own type, so that 32-bit
+//! values hash as they always did in BlockKeyHasher.
+template <typename T>
+void hashCombine(std::size_t& seed, T value) noexcept
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+} // namespace tensorrt_llm::common
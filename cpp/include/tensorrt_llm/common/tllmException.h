@@ -18,29 +18,70 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 
 #define NEW_TLLM_EXCEPTION(...)                                                                                        \
     tensorrt_llm::common::TllmException(__FILE__, __LINE__, tensorrt_llm::common::fmtstr(__VA_ARGS__))
 
+// Exception for an expected error, e.g. an invalid request, which does not capture a stack trace.
+#define NEW_TLLM_EXPECTED_EXCEPTION(errorCode, ...)                                                                    \
+    tensorrt_llm::common::TllmException(                                                                               \
+        __FILE__, __LINE__, tensorrt_llm::common::fmtstr(__VA_ARGS__), errorCode, /*captureTrace*/ false)
+
 namespace tensorrt_llm::common
 {
 
+//! \brief Category of a TllmException, so that handlers can react to expected errors without parsing the message.
+enum class TllmErrorCode : std::int32_t
+{
+    kUNKNOWN = 0,
+    kINVALID_ARGUMENT = 1,
+    kCAPACITY_EXCEEDED = 2,
+    kCANCELLED = 3,
+};
+
 class TllmException : public std::runtime_error
 {
 public:
     static auto constexpr MAX_FRAMES = 128;
 
+    //! \brief Captures the frame addresses of the stack. They are only symbolized on the first call to what() or
+    //! getTrace(), which is the expensive part.
     explicit TllmException(char const* file, std::size_t line, std::string const& msg);
 
+    //! \brief Same as above with an error code, capturing the stack only if captureTrace is true.
+    TllmException(char const* file, std::size_t line, std::string const& msg, TllmErrorCode errorCode,
+        bool captureTrace = true);
+
+    //! \brief Copies carry the error code, which is kept outside the exception.
+    TllmException(TllmException const& other);
+
+    TllmException& operator=(TllmException const& other);
+
     ~TllmException() noexcept override;
 
+    //! \returns the message with its location, followed by the stack trace if captured.
+    [[nodiscard]] char const* what() const noexcept override;
+
+    //! \returns the message with its location, without the stack trace.
+    [[nodiscard]] char const* getMessage() const noexcept
+    {
+        return std::runtime_error::what();
+    }
+
+    [[nodiscard]] TllmErrorCode getErrorCode() const noexcept;
+
     [[nodiscard]] std::string getTrace() const;
 
     static std::string demangle(char const* name);
 
 private:
+    [[nodiscard]] std::string symbolize() const;
+
+    // Prebuilt libraries construct and copy this class, so its members must not change. The error code and the
+    // symbolized trace are kept outside, keyed by exception.
     std::array<void*, MAX_FRAMES> mCallstack{};
     int mNbFrames;
 };
@@ -18,6 +18,7 @@
 
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/hugePages.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include <NvInferRuntime.h>
@@ -87,6 +88,14 @@ public:
     //! \brief Allocates a pinned `ITensor` of the given dimensions on the CPU.
     [[nodiscard]] static ITensorPtr pinned(nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE);
 
+    //! \brief Allocates an `ITensor` of the given dimensions on the CPU, backed by huge pages if available.
+    [[nodiscard]] static ITensorPtr cpuHugePages(
+        nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE, HugePageSize pageSize = HugePageSize::k2MB);
+
+    //! \brief Allocates a pinned `ITensor` of the given dimensions on the CPU, backed by huge pages if available.
+    [[nodiscard]] static ITensorPtr pinnedHugePages(
+        nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE, HugePageSize pageSize = HugePageSize::k2MB);
+
     //! \brief Allocates a pinned `IBuffer` of the given size on the CPU in the default memory pool.
     [[nodiscard]] static IBufferPtr pinnedPool(std::size_t size, nvinfer1::DataType type = kBYTE_TYPE);
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Chunk lengths of the context requests of an iteration, sized to a token budget and a target step time.
+///
+/// A step mixing generation and context requests takes longer with each prefill token, so filling the whole token
+/// budget with prefill delays the next token of every generation request. While generation requests are in flight, the
+/// planner limits the tokens of the step to the ones the step time model predicts to fit in the target iteration time.
+/// Without generation requests, or without a target, the whole budget goes to prefill. The prefill tokens are given to
+/// the context requests in order, in multiples of the chunk unit size except for the last chunk of a context. A
+/// request whose remaining context fits in the tokens left over gets them even if an earlier one could not, so that
+/// the budget is filled. At least one chunk unit is prefilled per step, so contexts make progress when the target
+/// cannot be met.
+class ChunkedPrefillPlanner
+{
+public:
+    /// @brief Affine model of the duration of a step vs. the number of tokens it processes.
+    struct StepTimeModel
+    {
+        double fixedMs{0.};
+        double perTokenMs{0.};
+
+        [[nodiscard]] double estimateMs(SizeType32 numTokens) const
+        {
+            return fixedMs + perTokenMs * numTokens;
+        }
+
+        /// @brief Largest number of tokens whose estimated step time is at most targetMs, 0 if none.
+        [[nodiscard]] SizeType32 maxTokens(double targetMs) const;
+
+        /// @brief Least squares fit to measured (number of tokens, step time in ms) samples, with both coefficients
+        /// constrained to be non-negative so that the model is accepted by setStepTimeModel.
+        [[nodiscard]] static StepTimeModel fit(std::vector<std::pair<SizeType32, double>> const& samples);
+    };
+
+    struct Plan
+    {
+        //! Number of tokens to prefill for each context request, 0 if it is not scheduled in this step.
+        std::vector<SizeType32> chunkSizes;
+        //! Tokens of the step, generation and prefill.
+        SizeType32 numTokens{0};
+        double estimatedMs{0.};
+    };
+
+    /// @param maxNumTokens Token budget of a step, as the max number of tokens of the engine.
+    /// @param chunkUnitSize Granularity of the chunks, usually the KV cache block size.
+    /// @param targetIterationMs Target step time while generation requests are in flight, no target if empty.
+    ChunkedPrefillPlanner(SizeType32 maxNumTokens, SizeType32 chunkUnitSize, StepTimeModel const& stepTimeModel,
+        std::optional<double> targetIterationMs = std::nullopt);
+
+    /// @brief Number of prefill tokens of a step with numGenTokens generation tokens.
+    [[nodiscard]] SizeType32 getPrefillBudget(SizeType32 numGenTokens) const;
+
+    /// @brief Plan a step.
+    /// @param numRemainingContextTokens Context tokens not computed yet for each context request, in priority order.
+    /// @param numGenTokens Tokens of the generation requests of the step, including beams and draft tokens.
+    [[nodiscard]] Plan plan(std::vector<SizeType32> const& numRemainingContextTokens, SizeType32 numGenTokens) const;
+
+    [[nodiscard]] StepTimeModel const& getStepTimeModel() const noexcept
+    {
+        return mStepTimeModel;
+    }
+
+    /// @brief Replace the model, e.g. with one fitted to the measured iteration latencies.
+    void setStepTimeModel(StepTimeModel const& stepTimeModel);
+
+private:
+    SizeType32 const mMaxNumTokens;
+    SizeType32 const mChunkUnitSize;
+    StepTimeModel mStepTimeModel;
+    std::optional<double> const mTargetIterationMs;
+};
+
+} // namespace tensorrt_llm::runtime
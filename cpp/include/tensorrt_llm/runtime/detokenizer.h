@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Maps token ids back to text. Loaded from a HuggingFace `tokenizer.json`.
+///
+/// Supports the byte-level BPE family (GPT-2, Llama-3, Qwen, ...) and the SentencePiece family exported as BPE or
+/// Unigram with metaspace replacement and byte fallback (Llama-2, Mistral, ...). The byte representation of every
+/// token is resolved once at load time, so decoding is a table lookup followed by UTF-8 validation.
+///
+/// The object is immutable after construction and can be shared between threads and streams.
+class Detokenizer
+{
+public:
+    using SharedConstPtr = std::shared_ptr<Detokenizer const>;
+
+    /// @brief Load the tokenizer from a `tokenizer.json` file.
+    static SharedConstPtr fromFile(std::filesystem::path const& tokenizerJsonPath);
+
+    /// @brief Load the tokenizer from the content of a `tokenizer.json` file.
+    static SharedConstPtr fromJsonString(std::string const& tokenizerJson);
+
+    [[nodiscard]] SizeType32 getVocabSize() const noexcept
+    {
+        return static_cast<SizeType32>(mOffsets.size()) - 1;
+    }
+
+    /// @brief The raw bytes of a token. They are not necessarily valid UTF-8 on their own (byte fallback and
+    /// byte-level tokens can split a code point).
+    [[nodiscard]] std::string_view getTokenBytes(TokenIdType tokenId) const;
+
+    [[nodiscard]] bool isSpecial(TokenIdType tokenId) const;
+
+    /// @brief Number of leading spaces dropped from the first decoded token of a sequence (SentencePiece models).
+    [[nodiscard]] SizeType32 getNumLeadingSpacesToStrip() const noexcept
+    {
+        return mNumLeadingSpacesToStrip;
+    }
+
+    /// @brief Decode a complete sequence. Invalid UTF-8 is replaced by U+FFFD.
+    [[nodiscard]] std::string decode(executor::VecTokens const& tokenIds, bool skipSpecialTokens = true) const;
+
+private:
+    Detokenizer() = default;
+
+    void addToken(TokenIdType tokenId, std::string_view bytes, bool isSpecial);
+
+    // Bytes of token i are mData[mOffsets[i], mOffsets[i + 1]).
+    std::string mData;
+    std::vector<std::size_t> mOffsets;
+    std::vector<bool> mSpecial;
+    SizeType32 mNumLeadingSpacesToStrip{0};
+};
+
+/// @brief Text produced by one step of a DetokenizerStream
+struct TextDelta
+{
+    /// @brief Newly decoded text. Always valid UTF-8.
+    std::string text;
+    /// @brief If true, `text` replaces everything emitted so far instead of being appended to it.
+    bool isReset{false};
+    /// @brief True once a stop string has been matched. No more text will be produced by the stream.
+    bool isStopped{false};
+    /// @brief Index of the matched stop string when isStopped is true.
+    std::optional<SizeType32> stopStringIdx;
+};
+
+/// @brief Incremental decoding state of one sequence (one beam of one request).
+///
+/// Bytes of a code point split across tokens are held back until the code point is complete, so every emitted delta
+/// is valid UTF-8. When stop strings are set, up to `maxStopStringLength - 1` bytes are additionally held back so
+/// that a stop string spanning several tokens is never partially emitted.
+///
+/// Note that this class is not thread safe.
+class DetokenizerStream
+{
+public:
+    /// @param detokenizer The tokenizer vocabulary
+    /// @param stopStrings Generation stops at the first occurrence of any of these strings in the decoded text
+    /// @param skipSpecialTokens Whether special tokens (BOS, EOS, ...) produce text
+    /// @param includeStopString Whether the matched stop string is part of the output
+    explicit DetokenizerStream(Detokenizer::SharedConstPtr detokenizer, std::vector<std::string> stopStrings = {},
+        bool skipSpecialTokens = true, bool includeStopString = false);
+
+    /// @brief Feed tokens preceding the generated ones (e.g. the tail of the prompt). They produce no text, but
+    /// disable leading-space stripping and complete code points started by the prompt. The primed state survives
+    /// reset().
+    void prime(executor::VecTokens const& contextTokenIds);
+
+    /// @brief Decode newly generated tokens.
+    TextDelta step(TokenIdType const* tokenIds, std::size_t numTokens);
+
+    TextDelta step(executor::VecTokens const& tokenIds)
+    {
+        return step(tokenIds.data(), tokenIds.size());
+    }
+
+    /// @brief Decode the complete sequence generated so far, as delivered with `returnAllGeneratedTokens`. Only the
+    /// suffix not seen before is decoded. If earlier tokens changed (beam reordering), the stream restarts and the
+    /// returned delta has isReset set.
+    TextDelta stepAll(executor::VecTokens const& allTokenIds);
+
+    /// @brief Flush the text held back, replacing a trailing incomplete code point by U+FFFD.
+    TextDelta finish();
+
+    [[nodiscard]] bool isStopped() const noexcept
+    {
+        return mStopped;
+    }
+
+    [[nodiscard]] SizeType32 getNumTokens() const noexcept
+    {
+        return static_cast<SizeType32>(mTokenIds.size());
+    }
+
+    void reset();
+
+private:
+    void appendBytes(TokenIdType const* tokenIds, std::size_t numTokens);
+    void emit(TextDelta& delta, bool flush);
+
+    Detokenizer::SharedConstPtr mDetokenizer;
+    std::vector<std::string> mStopStrings;
+    std::size_t mMaxStopStringLength{0};
+    bool mSkipSpecialTokens;
+    bool mIncludeStopString;
+
+    executor::VecTokens mTokenIds;
+    // Bytes not yet forming a complete code point.
+    std::string mPendingBytes;
+    // Valid UTF-8 held back for stop string matching.
+    std::string mHeldText;
+    SizeType32 mSpacesToStrip{0};
+    bool mStopped{false};
+
+    // State restored by reset(), set by prime().
+    std::string mPrimedBytes;
+    SizeType32 mPrimedSpacesToStrip{0};
+};
+
+} // namespace tensorrt_llm::runtime
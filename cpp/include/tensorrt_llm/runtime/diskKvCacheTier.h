@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Persistent tier of reusable KV cache blocks on local disk, below the primary and secondary pools.
+///
+/// Blocks are identified by a hash chain: the hash of a block covers its tokens, its LoRA task and the hash of the
+/// previous block, so that a block only matches when the whole prefix up to it matches. The hash is stable across
+/// processes, so blocks written by one server are found by the next one.
+///
+/// The tier is one preallocated file holding a header, an index with one record per slot, and the block slots. An I/O
+/// thread writes queued blocks in batches and serves prefetches, which take priority over writes. Blocks that are
+/// queued but not yet written are served from memory. When all slots are used, the least recently used block is
+/// overwritten. The index is reloaded when the file is reopened; flush makes the blocks written so far durable.
+class DiskKvCacheTier
+{
+public:
+    using BlockHash = std::uint64_t;
+
+    struct Stats
+    {
+        std::size_t numWrites{0};
+        //! Blocks not stored because the write queue was full.
+        std::size_t numDroppedWrites{0};
+        std::size_t numEvictions{0};
+        std::size_t numReads{0};
+        //! Prefetched blocks served from the write queue.
+        std::size_t numPendingHits{0};
+    };
+
+    /// @brief Hash of one block given the hash of the previous block, 0 for the first block.
+    [[nodiscard]] static BlockHash hashBlock(BlockHash parentHash, VecUniqueTokens::const_iterator begin,
+        VecUniqueTokens::const_iterator end, LoraTaskIdType loraTaskId) noexcept;
+
+    /// @brief Hash chain of the full blocks of a sequence.
+    [[nodiscard]] static std::vector<BlockHash> hashBlocks(
+        VecUniqueTokens const& tokens, SizeType32 tokensPerBlock, LoraTaskIdType loraTaskId = 0);
+
+    /// @brief Open the tier stored at path, creating it if it does not exist or was created with another geometry.
+    /// @param blockSize Size in bytes of one block.
+    /// @param numBlocks Number of block slots of the file.
+    /// @param maxPendingWrites Blocks that can be queued before store drops them.
+    DiskKvCacheTier(std::filesystem::path path, std::size_t blockSize, SizeType32 numBlocks,
+        SizeType32 maxPendingWrites = 256);
+
+    /// @brief Writes the queued blocks and syncs the file.
+    ~DiskKvCacheTier();
+
+    DiskKvCacheTier(DiskKvCacheTier const&) = delete;
+    DiskKvCacheTier& operator=(DiskKvCacheTier const&) = delete;
+
+    /// @brief Queue a block for writing, copying it.
+    /// @return false if the block is already stored or queued, or the queue is full.
+    bool store(BlockHash hash, void const* block);
+
+    /// @brief Number of leading blocks of a hash chain that are stored or queued.
+    [[nodiscard]] SizeType32 matchPrefix(std::vector<BlockHash> const& hashes) const;
+
+    /// @brief Read the leading blocks of a hash chain into host buffers, e.g. secondary pool blocks.
+    /// @param blocks One buffer of blockSize bytes per hash.
+    /// @return The number of leading blocks read, the other buffers are untouched.
+    [[nodiscard]] std::future<SizeType32> prefetch(std::vector<BlockHash> hashes, std::vector<void*> blocks);
+
+    /// @brief Wait for the queued blocks to be written and sync them to disk.
+    void flush();
+
+    [[nodiscard]] SizeType32 getNumStoredBlocks() const;
+
+    [[nodiscard]] Stats getStats() const;
+
+    [[nodiscard]] std::size_t getBlockSize() const noexcept
+    {
+        return mBlockSize;
+    }
+
+private:
+    struct ReadJob
+    {
+        std::vector<BlockHash> hashes;
+        std::vector<void*> blocks;
+        std::promise<SizeType32> promise;
+    };
+
+    struct Slot
+    {
+        BlockHash hash{0};
+        bool used{false};
+        std::list<SizeType32>::iterator lruIt;
+    };
+
+    void load();
+    void run();
+    void read(ReadJob& job);
+    void writeBatch(std::unique_lock<std::mutex>& lock);
+    bool writeRecord(SizeType32 slot, BlockHash hash, std::uint64_t sequence) const;
+    [[nodiscard]] std::uint64_t getSlotOffset(SizeType32 slot) const noexcept;
+    void touch(SizeType32 slot);
+
+    std::filesystem::path mPath;
+    std::size_t mBlockSize;
+    std::size_t mSlotSize;
+    SizeType32 mNumBlocks;
+    std::size_t mMaxPendingWrites;
+    std::uint64_t mDataOffset;
+    int mFd;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCv;
+    std::condition_variable mIdleCv;
+    std::unordered_map<BlockHash, SizeType32> mIndex;
+    std::vector<Slot> mSlots;
+    //! Used slots, most recently used first.
+    std::list<SizeType32> mLru;
+    std::vector<SizeType32> mFreeSlots;
+    std::uint64_t mSequence{1};
+    std::unordered_map<BlockHash, std::vector<std::uint8_t>> mPending;
+    std::deque<BlockHash> mWriteQueue;
+    std::deque<ReadJob> mReadQueue;
+    bool mBusy{false};
+    bool mShutdown{false};
+    Stats mStats;
+    std::thread mThread;
+};
+
+} // namespace tensorrt_llm::runtime
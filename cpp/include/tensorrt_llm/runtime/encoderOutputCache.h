@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Content-addressed cache of the encoder outputs of encoder-decoder requests.
+///
+/// Requests that send the same encoder input again, e.g. retries or n-best queries of the same source segment or audio
+/// clip, get the encoder output of the first one and skip their encoder phase. Entries are keyed by a 128-bit digest
+/// of the model, the encoder input tokens or features and the LoRA task, and hold a host copy of the output. Entries
+/// are evicted in LRU order to respect the memory bound. Thread-safe.
+class EncoderOutputCache
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    struct Key
+    {
+        std::uint64_t lo;
+        std::uint64_t hi;
+
+        bool operator==(Key const& other) const noexcept
+        {
+            return lo == other.lo && hi == other.hi;
+        }
+    };
+
+    struct KeyHasher
+    {
+        std::size_t operator()(Key const& key) const noexcept
+        {
+            return static_cast<std::size_t>(key.lo);
+        }
+    };
+
+    struct Stats
+    {
+        std::uint64_t numHits{0};
+        std::uint64_t numMisses{0};
+        std::uint64_t numInsertions{0};
+        std::uint64_t numEvictions{0};
+        std::size_t numEntries{0};
+        std::size_t usedBytes{0};
+    };
+
+    /// @param modelId Identifies the encoder, e.g. a hash of its engine, so that caches of different models never mix.
+    /// @param maxBytes Bound on the memory held by the encoder outputs. Larger outputs are not cached.
+    /// @param memoryType Where to keep the outputs, kPINNED to copy them to the device asynchronously.
+    EncoderOutputCache(std::string modelId, std::size_t maxBytes, MemoryType memoryType = MemoryType::kPINNED);
+
+    [[nodiscard]] Key makeKey(
+        std::vector<TokenIdType> const& encoderTokens, std::optional<LoraTaskIdType> loraTaskId = std::nullopt) const;
+
+    /// @param encoderInputFeatures Features in host memory, e.g. mel spectrograms.
+    [[nodiscard]] Key makeKey(
+        ITensor const& encoderInputFeatures, std::optional<LoraTaskIdType> loraTaskId = std::nullopt) const;
+
+    /// @brief Key of the encoder input of a request, or std::nullopt if it has none.
+    [[nodiscard]] std::optional<Key> makeKey(batch_manager::LlmRequest const& request) const;
+
+    /// @brief The cached encoder output, or nullptr on a miss. The output must not be modified.
+    [[nodiscard]] TensorPtr lookup(Key const& key);
+
+    /// @brief Store a copy of an encoder output. Replaces an existing entry with the same key.
+    void insert(Key const& key, ITensor const& encoderOutput, BufferManager const& manager);
+
+    /// @brief Serve a request in its encoder phase from the cache. On a hit, the encoder output is copied to the device
+    /// and the request moves to the context phase, so that the scheduler does not run the encoder for it.
+    /// @return Whether the encoder phase of the request was skipped.
+    bool loadEncoderOutput(batch_manager::LlmRequest& request, BufferManager const& manager);
+
+    /// @brief Store the encoder output of a request once its encoder phase has run.
+    void storeEncoderOutput(batch_manager::LlmRequest const& request, BufferManager const& manager);
+
+    void clear();
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        TensorPtr output;
+        std::list<Key>::iterator lruIt;
+    };
+
+    void eraseLocked(std::unordered_map<Key, Entry, KeyHasher>::iterator it);
+
+    std::string const mModelId;
+    std::size_t const mMaxBytes;
+    MemoryType const mMemoryType;
+
+    mutable std::mutex mMutex;
+    //! Keys in LRU order, most recent first.
+    std::list<Key> mLru;
+    std::unordered_map<Key, Entry, KeyHasher> mEntries;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Picks the instance that serves a request among replicas of the same engine.
+///
+/// The load of an instance is the number of requests routed to it that did not finish yet, or the number of active
+/// and queued requests last reported by its iteration stats if that is higher. Ties are broken by the number of free
+/// KV cache blocks last reported, then in round robin order. With prefix affinity, the router remembers which instance
+/// it sent each prompt block to, keyed by the hash of the block and all blocks before it, and sends a request to the
+/// instance that got its longest known prefix, since that instance is the most likely to have it in its KV cache. The
+/// affinity is ignored when that instance is loaded more than maxImbalance requests above the least loaded one.
+/// Thread-safe.
+class ExecutorRouter
+{
+public:
+    enum class Policy
+    {
+        kROUND_ROBIN,
+        kLEAST_LOADED,
+        kPREFIX_AFFINITY,
+    };
+
+    struct Stats
+    {
+        std::uint64_t numRouted{0};
+        //! Requests sent to the instance that got a prefix of them before.
+        std::uint64_t numPrefixHits{0};
+        //! Requests with a known prefix sent elsewhere because its instance was too loaded.
+        std::uint64_t numRebalanced{0};
+    };
+
+    /// @param tokensPerBlock Granularity of the prefixes, should match the KV cache block size of the instances.
+    /// @param maxNumPrefixBlocks Number of prefix blocks remembered, the least recently routed are forgotten first.
+    /// @param maxImbalance Load above the least loaded instance up to which prefix affinity is kept.
+    ExecutorRouter(SizeType32 numInstances, Policy policy, SizeType32 tokensPerBlock = 64,
+        SizeType32 maxNumPrefixBlocks = 1 << 16, SizeType32 maxImbalance = 4);
+
+    /// @brief Pick the instance for a request and count it as outstanding there until onFinished is called.
+    [[nodiscard]] SizeType32 route(executor::VecTokens const& inputTokens);
+
+    /// @brief A request routed to instance finished, failed or was cancelled.
+    void onFinished(SizeType32 instance);
+
+    /// @brief Update the load reported by the latest iteration stats of instance.
+    void updateLoad(SizeType32 instance, executor::IterationStats const& stats);
+
+    [[nodiscard]] SizeType32 getLoad(SizeType32 instance) const;
+
+    [[nodiscard]] SizeType32 getNumInstances() const noexcept
+    {
+        return static_cast<SizeType32>(mInstances.size());
+    }
+
+    [[nodiscard]] Policy getPolicy() const noexcept
+    {
+        return mPolicy;
+    }
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Instance
+    {
+        SizeType32 numOutstanding{0};
+        SizeType32 numReported{0};
+        std::optional<SizeType32> freeKvBlocks;
+    };
+
+    struct PrefixEntry
+    {
+        SizeType32 instance;
+        std::list<std::uint64_t>::iterator lruIt;
+    };
+
+    [[nodiscard]] SizeType32 loadLocked(SizeType32 instance) const;
+    [[nodiscard]] SizeType32 leastLoadedLocked() const;
+    [[nodiscard]] std::vector<std::uint64_t> hashPrefixBlocks(executor::VecTokens const& inputTokens) const;
+    void rememberLocked(std::vector<std::uint64_t> const& blockHashes, SizeType32 instance);
+
+    Policy const mPolicy;
+    SizeType32 const mTokensPerBlock;
+    SizeType32 const mMaxNumPrefixBlocks;
+    SizeType32 const mMaxImbalance;
+
+    mutable std::mutex mMutex;
+    std::vector<Instance> mInstances;
+    SizeType32 mNextInstance{0};
+    //! Prefix block hashes in LRU order, most recent first.
+    std::list<std::uint64_t> mLru;
+    std::unordered_map<std::uint64_t, PrefixEntry> mPrefixes;
+    Stats mStats;
+};
+
+/// @brief Front door of executors serving replicas of the same engine, that routes requests with an ExecutorRouter.
+///
+/// Requests get ids that are unique across instances, and their responses are returned under these ids. The load of
+/// the instances is updated from their iteration stats on every awaitResponses call, so iteration stats must be
+/// enabled in their executor config for the router to see the KV cache usage. The stats drained from the executors are
+/// kept for getLatestIterationStats. Do not enqueue on the executors directly.
+class RoutingExecutor
+{
+public:
+    RoutingExecutor(std::vector<std::shared_ptr<executor::Executor>> executors, std::shared_ptr<ExecutorRouter> router);
+
+    [[nodiscard]] executor::IdType enqueueRequest(executor::Request const& request);
+
+    [[nodiscard]] std::vector<executor::IdType> enqueueRequests(std::vector<executor::Request> const& requests);
+
+    /// @brief Await ready responses of all instances.
+    [[nodiscard]] std::vector<executor::Response> awaitResponses(
+        std::optional<std::chrono::milliseconds> const& timeout = std::nullopt);
+
+    void cancelRequest(executor::IdType requestId);
+
+    /// @brief The iteration stats of instance since the last call, in place of Executor::getLatestIterationStats.
+    /// At most kDefaultIterStatsMaxIterations are kept, the oldest are dropped first.
+    [[nodiscard]] std::deque<executor::IterationStats> getLatestIterationStats(SizeType32 instance);
+
+    [[nodiscard]] ExecutorRouter const& getRouter() const noexcept
+    {
+        return *mRouter;
+    }
+
+private:
+    struct Route
+    {
+        SizeType32 instance;
+        executor::IdType instanceRequestId;
+    };
+
+    //! Update the load of instance and append its responses ready within timeout, under the ids handed out for them.
+    void collectResponses(
+        SizeType32 instance, std::chrono::milliseconds timeout, std::vector<executor::Response>& responses);
+
+    std::vector<std::shared_ptr<executor::Executor>> mExecutors;
+    std::shared_ptr<ExecutorRouter> mRouter;
+
+    std::mutex mMutex;
+    executor::IdType mNextRequestId{1};
+    std::unordered_map<executor::IdType, Route> mRoutes;
+    //! Per instance, the ids handed out for the ids of the instance.
+    std::vector<std::unordered_map<executor::IdType, executor::IdType>> mRequestIds;
+
+    std::mutex mIterationStatsMutex;
+    //! Per instance, the iteration stats drained from its executor and not yet returned.
+    std::vector<std::deque<executor::IterationStats>> mIterationStats;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! @brief Fuses the sampling configs of single requests into the config of a batch.
+//!
+//! Most requests share their sampling settings, so the configs are interned: every slot refers to an entry of a table
+//! of unique configs, which is updated as requests are assigned to and removed from slots. Fusing only materializes a
+//! value per request for the fields that differ between the requests of the batch. Fields with a single value are
+//! fused into a vector of size 1, which the decoding layers apply to all requests.
+//!
+//! The builder is owned by the code that assigns requests to batch slots, and lives as long as the slots do.
+class FusedSamplingConfigBuilder
+{
+public:
+    using ConfigId = SizeType32;
+
+    static ConfigId constexpr kNoConfig = -1;
+
+    explicit FusedSamplingConfigBuilder(SizeType32 maxNumSlots);
+
+    //! @brief Assigns the config of a single request to a slot, releasing the config the slot referred to before.
+    void setSlot(SizeType32 slot, SamplingConfig const& config);
+
+    //! @brief Releases the config of a slot.
+    void clearSlot(SizeType32 slot);
+
+    //! @returns The id of the config of a slot, or kNoConfig if the slot is empty.
+    [[nodiscard]] ConfigId getConfigId(SizeType32 slot) const;
+
+    [[nodiscard]] SamplingConfig const& getConfig(ConfigId id) const;
+
+    //! @returns The number of distinct configs referred to by the slots.
+    [[nodiscard]] SizeType32 getNumUniqueConfigs() const noexcept
+    {
+        return static_cast<SizeType32>(mConfigs.size() - mFreeIds.size());
+    }
+
+    [[nodiscard]] SizeType32 getMaxNumSlots() const noexcept
+    {
+        return static_cast<SizeType32>(mSlotConfigIds.size());
+    }
+
+    //! @brief Fuses the configs of slots into the config of a batch of slots.size() requests, in the order of slots.
+    //! The result is equal to SamplingConfig(configs) up to the fields that are fused to a single value.
+    [[nodiscard]] SamplingConfig fuse(std::vector<SizeType32> const& slots) const;
+
+private:
+    struct Entry
+    {
+        SamplingConfig config;
+        std::size_t hash;
+        SizeType32 numSlots;
+    };
+
+    void checkSlot(SizeType32 slot) const;
+
+    // Indexed by config id, entries without slots are free.
+    std::vector<Entry> mConfigs;
+    std::vector<ConfigId> mFreeIds;
+    std::unordered_multimap<std::size_t, ConfigId> mIdsByHash;
+    std::vector<ConfigId> mSlotConfigIds;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -47,6 +47,8 @@ public:
 
     static GptJsonConfig parse(std::istream& json);
 
+    //! \brief Parses the config file at path. The json is cached per file and reused until the file is modified, each
+    //! call builds a new config from it.
     static GptJsonConfig parse(std::filesystem::path const& path);
 
     [[nodiscard]] ModelConfig const& getModelConfig() const
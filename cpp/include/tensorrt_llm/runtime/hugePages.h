@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tensorrt_llm::runtime
+{
+
+enum class HugePageSize : std::int32_t
+{
+    k2MB = 21,
+    k1GB = 30
+};
+
+//! \brief What a huge page mapping is backed by.
+enum class HugePageBacking : std::int32_t
+{
+    //! Pages reserved in the hugetlb pool, e.g. through /proc/sys/vm/nr_hugepages.
+    kHUGETLB = 0,
+    //! Transparent huge pages of 2 MB, when the hugetlb pool has no pages left.
+    kTRANSPARENT = 1,
+    //! Regular pages, when transparent huge pages are disabled.
+    kREGULAR = 2
+};
+
+struct HugePageMapping
+{
+    void* data;
+    //! The mapped size, a multiple of the page size.
+    std::size_t size;
+    HugePageBacking backing;
+};
+
+[[nodiscard]] constexpr std::size_t getHugePageBytes(HugePageSize pageSize) noexcept
+{
+    return std::size_t{1} << static_cast<std::int32_t>(pageSize);
+}
+
+/// @brief Map anonymous host memory backed by huge pages, falling back to transparent huge pages, then to regular
+/// pages. The pages are allocated when first touched, or when the mapping is registered with CUDA.
+/// @throws std::bad_alloc if no memory could be mapped.
+[[nodiscard]] HugePageMapping mapHugePages(std::size_t size, HugePageSize pageSize = HugePageSize::k2MB);
+
+/// @brief Unmap memory of mapHugePages, given the requested size.
+void unmapHugePages(void* data, std::size_t size, HugePageSize pageSize = HugePageSize::k2MB) noexcept;
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Format of the KV cache blocks held by a compressed host tier.
+enum class KvBlockQuantization : std::uint8_t
+{
+    //! Symmetric int8, one scale per head.
+    kINT8 = 0,
+    //! FP8 E4M3, one scale per head.
+    kFP8 = 1,
+};
+
+/// @brief Quantizes KV cache blocks on the host, e.g. when they are offloaded from the primary to the secondary pool,
+/// and restores them when they are onboarded.
+///
+/// A block is [numLayers][2][numKvHeads][tokensPerBlock][sizePerHead] elements of type dtype, the layout of a block
+/// in the KV cache pools. Each head of each layer, K and V separately, is quantized with its own scale. The encoded
+/// block holds the float scales followed by one byte per element. A head that is all zeros, e.g. the unused tokens of
+/// a partially filled block, only stores a zero scale and is not read back when decoding.
+///
+/// Uses AVX2 and F16C when the CPU supports them.
+class KvBlockCodec
+{
+public:
+    /// @param dtype Type of the KV cache, kHALF, kBF16 or kFLOAT.
+    KvBlockCodec(nvinfer1::DataType dtype, SizeType32 numLayers, SizeType32 numKvHeads, SizeType32 tokensPerBlock,
+        SizeType32 sizePerHead, KvBlockQuantization quantization, bool useSimd = true);
+
+    /// @brief Size in bytes of an uncompressed block.
+    [[nodiscard]] std::size_t getBlockSize() const noexcept
+    {
+        return mNumSlabs * mSlabSize * mElementSize;
+    }
+
+    /// @brief Size in bytes of an encoded block.
+    [[nodiscard]] std::size_t getEncodedSize() const noexcept
+    {
+        return mNumSlabs * (sizeof(float) + mSlabSize);
+    }
+
+    [[nodiscard]] double getCompressionRatio() const noexcept
+    {
+        return static_cast<double>(getBlockSize()) / static_cast<double>(getEncodedSize());
+    }
+
+    [[nodiscard]] KvBlockQuantization getQuantization() const noexcept
+    {
+        return mQuantization;
+    }
+
+    //! Whether the SIMD kernels are used.
+    [[nodiscard]] bool isSimd() const noexcept
+    {
+        return mUseSimd;
+    }
+
+    /// @brief Encode a block of getBlockSize() bytes into dst of getEncodedSize() bytes.
+    void encode(void const* block, std::uint8_t* dst) const;
+
+    /// @brief Decode getEncodedSize() bytes from src into a block of getBlockSize() bytes.
+    void decode(std::uint8_t const* src, void* block) const;
+
+private:
+    nvinfer1::DataType mDataType;
+    std::size_t mElementSize;
+    //! One slab is one head of one layer, K or V.
+    std::size_t mNumSlabs;
+    std::size_t mSlabSize;
+    KvBlockQuantization mQuantization;
+    bool mUseSimd;
+};
+
+/// @brief Host tier holding offloaded KV cache blocks in a compressed format.
+///
+/// The pool has as many slots as encoded blocks fit in its capacity, i.e. getCompressionRatio() times more than
+/// uncompressed blocks would. The caller maps blocks to slots the way the block manager maps blocks to the secondary
+/// pool, offloads a block by copying it to a host staging buffer and calling offload, and onboards it by calling
+/// onboard then copying the staging buffer to the primary pool.
+///
+/// Slots can be accessed concurrently as long as each slot is used by one thread at a time.
+class QuantizedHostBlockPool
+{
+public:
+    QuantizedHostBlockPool(KvBlockCodec codec, std::size_t capacity);
+
+    [[nodiscard]] SizeType32 getNumBlocks() const noexcept
+    {
+        return mNumBlocks;
+    }
+
+    [[nodiscard]] KvBlockCodec const& getCodec() const noexcept
+    {
+        return mCodec;
+    }
+
+    /// @brief Store an uncompressed block in slot.
+    void offload(SizeType32 slot, void const* block);
+
+    /// @brief Restore the block stored in slot.
+    void onboard(SizeType32 slot, void* block) const;
+
+private:
+    [[nodiscard]] std::uint8_t* getSlot(SizeType32 slot) const;
+
+    KvBlockCodec mCodec;
+    SizeType32 mNumBlocks;
+    std::unique_ptr<std::uint8_t[]> mStorage;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <NvInferRuntime.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief What a KV cache snapshot was taken from. A snapshot is only loaded by an identical configuration.
+struct KvCacheSnapshotInfo
+{
+    //! Identifies the engine, e.g. a hash of its config and weights.
+    std::string modelId;
+    nvinfer1::DataType dataType{nvinfer1::DataType::kHALF};
+    SizeType32 numLayers{0};
+    SizeType32 numKvHeads{0};
+    SizeType32 sizePerHead{0};
+    SizeType32 tokensPerBlock{0};
+
+    //! Bytes of one block: [numLayers][2][numKvHeads][tokensPerBlock][sizePerHead].
+    [[nodiscard]] std::size_t getBlockSize() const;
+
+    bool operator==(KvCacheSnapshotInfo const& other) const noexcept
+    {
+        return modelId == other.modelId && dataType == other.dataType && numLayers == other.numLayers
+            && numKvHeads == other.numKvHeads && sizePerHead == other.sizePerHead
+            && tokensPerBlock == other.tokensPerBlock;
+    }
+};
+
+/// @brief Tree of reusable KV cache blocks, mirroring the reuse tree of the block manager: a block is a child of the
+/// block holding the previous tokens of the sequence, and is identified by its tokens and LoRA task.
+class KvCachePrefixTree
+{
+public:
+    static SizeType32 constexpr kRoot = -1;
+
+    struct Node
+    {
+        SizeType32 parent;
+        LoraTaskIdType loraTaskId;
+        VecUniqueTokens tokens;
+        //! Where the contents of the block are, e.g. a host pool index.
+        SizeType32 blockId;
+    };
+
+    /// @brief Add a block, or return the existing child of parent with the same key.
+    /// @return The node of the block. Nodes are numbered in insertion order, so parents come before their children.
+    SizeType32 addBlock(SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens tokens, SizeType32 blockId);
+
+    /// @brief The node of the child of parent with the given key, if any.
+    [[nodiscard]] std::optional<SizeType32> findChild(
+        SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens const& tokens) const;
+
+    /// @brief Nodes of the longest chain of full blocks matching the beginning of tokens.
+    [[nodiscard]] std::vector<SizeType32> findMatchingBlocks(
+        VecUniqueTokens const& tokens, SizeType32 tokensPerBlock, LoraTaskIdType loraTaskId = 0) const;
+
+    [[nodiscard]] Node const& getNode(SizeType32 node) const
+    {
+        return mNodes.at(node);
+    }
+
+    [[nodiscard]] SizeType32 getNumBlocks() const noexcept
+    {
+        return static_cast<SizeType32>(mNodes.size());
+    }
+
+private:
+    struct ChildKey
+    {
+        SizeType32 parent;
+        LoraTaskIdType loraTaskId;
+        VecUniqueTokens tokens;
+
+        bool operator==(ChildKey const& other) const noexcept
+        {
+            return parent == other.parent && loraTaskId == other.loraTaskId && tokens == other.tokens;
+        }
+    };
+
+    struct ChildKeyHasher
+    {
+        std::size_t operator()(ChildKey const& key) const noexcept;
+    };
+
+    std::vector<Node> mNodes;
+    std::unordered_map<ChildKey, SizeType32, ChildKeyHasher> mChildren;
+};
+
+/// @brief Writes a snapshot of reusable KV cache blocks, e.g. on shutdown.
+///
+/// The file holds a header describing the configuration, then one record per block with its parent, LoRA task,
+/// tokens and contents, parents first, then a footer with the number of blocks that marks the snapshot as complete.
+class KvCacheSnapshotWriter
+{
+public:
+    KvCacheSnapshotWriter(std::filesystem::path path, KvCacheSnapshotInfo const& info);
+
+    /// @brief Append a block.
+    /// @param parent The index of the parent block in this snapshot, i.e. the number of blocks added before it, or
+    /// KvCachePrefixTree::kRoot.
+    /// @return The index of the block.
+    SizeType32 addBlock(
+        SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens const& tokens, void const* contents);
+
+    /// @brief Write the footer, sync the snapshot and move it to its path. Until then, it is written to a temporary
+    /// file, so that an interrupted snapshot does not replace the previous one.
+    void close();
+
+    /// @brief Discards the snapshot if close was not called.
+    ~KvCacheSnapshotWriter();
+
+private:
+    std::filesystem::path mPath;
+    std::filesystem::path mTmpPath;
+    std::size_t mBlockSize;
+    std::ofstream mStream;
+    SizeType32 mNumBlocks{0};
+};
+
+/// @brief Reads a snapshot written by KvCacheSnapshotWriter, block by block.
+class KvCacheSnapshotReader
+{
+public:
+    struct Block
+    {
+        SizeType32 parent;
+        LoraTaskIdType loraTaskId;
+        VecUniqueTokens tokens;
+    };
+
+    /// @brief Open a snapshot, throws if it was taken from another configuration than expected.
+    KvCacheSnapshotReader(std::filesystem::path path, KvCacheSnapshotInfo const& expected);
+
+    /// @brief Read the next block, without its contents.
+    /// @return The block, or nothing after the last one.
+    [[nodiscard]] std::optional<Block> readBlock();
+
+    /// @brief Read the contents of the block returned by the last readBlock. They are skipped if this is not called.
+    void readContents(void* contents);
+
+    [[nodiscard]] SizeType32 getNumBlocksRead() const noexcept
+    {
+        return mNumBlocks;
+    }
+
+private:
+    void skipContents();
+
+    std::filesystem::path mPath;
+    std::size_t mBlockSize;
+    std::ifstream mStream;
+    SizeType32 mNumBlocks{0};
+    bool mContentsPending{false};
+};
+
+/// @brief Snapshot the blocks of a prefix tree.
+/// @param getContents Returns the contents of a block given its blockId.
+void saveKvCacheSnapshot(std::filesystem::path const& path, KvCacheSnapshotInfo const& info,
+    KvCachePrefixTree const& tree, std::function<void const*(SizeType32 blockId)> const& getContents);
+
+/// @brief Load a snapshot into free blocks, e.g. of the host pool, and rebuild its prefix tree.
+/// @param allocateBlock Returns the blockId of a free block, or nothing when there is none left, at which point
+/// loading stops. Blocks are loaded parents first, so the tree only holds complete prefixes.
+/// @param getBuffer Returns where to write the contents of a block given its blockId.
+[[nodiscard]] KvCachePrefixTree loadKvCacheSnapshot(std::filesystem::path const& path,
+    KvCacheSnapshotInfo const& info, std::function<std::optional<SizeType32>()> const& allocateBlock,
+    std::function<void*(SizeType32 blockId)> const& getBuffer);
+
+} // namespace tensorrt_llm::runtime
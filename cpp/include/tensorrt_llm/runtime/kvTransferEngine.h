@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/kvTransferTransport.h"
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Geometry of the KV cache blocks of one tensor parallel rank.
+///
+/// A block holds, for each layer, the K then the V values of the local heads, each head being tokensPerBlock vectors of
+/// sizePerHead elements: [numLayers][2][numLocalHeads][tokensPerBlock][sizePerHead]. The KV heads are split evenly and
+/// contiguously across the tpSize ranks.
+struct KvCacheLayout
+{
+    SizeType32 numLayers{0};
+    SizeType32 numKvHeads{0};
+    SizeType32 sizePerHead{0};
+    SizeType32 tokensPerBlock{0};
+    SizeType32 elementSize{0};
+    SizeType32 tpSize{1};
+    SizeType32 tpRank{0};
+
+    [[nodiscard]] SizeType32 getNumLocalHeads() const noexcept
+    {
+        return numKvHeads / tpSize;
+    }
+
+    [[nodiscard]] SizeType32 getFirstHead() const noexcept
+    {
+        return tpRank * getNumLocalHeads();
+    }
+
+    //! Bytes of one head of one layer, K or V, in a block.
+    [[nodiscard]] std::size_t getHeadBytes() const noexcept
+    {
+        return static_cast<std::size_t>(tokensPerBlock) * sizePerHead * elementSize;
+    }
+
+    [[nodiscard]] std::size_t getBlockBytes() const noexcept
+    {
+        return static_cast<std::size_t>(numLayers) * 2 * getNumLocalHeads() * getHeadBytes();
+    }
+
+    //! Same model and block geometry, possibly split across a different number of ranks.
+    [[nodiscard]] bool isCompatible(KvCacheLayout const& other) const noexcept
+    {
+        return numLayers == other.numLayers && numKvHeads == other.numKvHeads && sizePerHead == other.sizePerHead
+            && tokensPerBlock == other.tokensPerBlock && elementSize == other.elementSize;
+    }
+
+    void validate() const;
+};
+
+/// @brief Ranks of a peer instance split tpSize ways whose heads overlap the heads of this rank, i.e. the ranks this
+/// rank exchanges blocks with.
+[[nodiscard]] std::vector<SizeType32> getOverlappingRanks(KvCacheLayout const& layout, SizeType32 peerTpSize);
+
+struct KvTransferStats
+{
+    std::size_t numBytes{0};
+    std::chrono::nanoseconds duration{0};
+
+    [[nodiscard]] double getGBps() const noexcept
+    {
+        return duration.count() > 0 ? static_cast<double>(numBytes) / static_cast<double>(duration.count()) : 0.;
+    }
+};
+
+struct KvTransferResult
+{
+    SizeType32 numTokens{0};
+    //! Forwarded from the context phase, holds the first generated tokens.
+    std::optional<executor::ContextPhaseParams> contextPhaseParams;
+    KvTransferStats stats;
+};
+
+/// @brief Moves the KV cache blocks of a request from a context-phase rank to a generation-phase rank.
+///
+/// The generation rank pulls: it sends its layout and block count, the context rank streams the requested heads of
+/// every block one block at a time, so that the receiver scatters a block while the next one is in flight, then sends
+/// the ContextPhaseParams of the request. The context rank returns once the receiver acknowledged, after which the
+/// blocks can be freed. When the TP splits differ, only the overlapping heads are sent and they are placed at the
+/// receiver's head offset. Blocks that need no conversion are sent and received in place.
+///
+/// Blocks are host memory, e.g. a host block pool or pinned buffers. Both peers must have the same endianness.
+class KvTransferEngine
+{
+public:
+    explicit KvTransferEngine(KvCacheLayout layout);
+
+    /// @brief Context side: serve the transfer of one request to the generation rank at the other end of transport.
+    /// @param blocks The blocks of the request, in sequence order.
+    KvTransferStats sendBlocks(KvTransport& transport, executor::IdType requestId,
+        std::vector<void const*> const& blocks, SizeType32 numTokens,
+        std::optional<executor::ContextPhaseParams> const& contextPhaseParams = std::nullopt) const;
+
+    /// @brief Generation side: receive the blocks of one request from the context rank at the other end of transport.
+    /// @param blocks The allocated blocks of the request, in sequence order.
+    KvTransferResult receiveBlocks(
+        KvTransport& transport, executor::IdType requestId, std::vector<void*> const& blocks) const;
+
+    [[nodiscard]] KvCacheLayout const& getLayout() const noexcept
+    {
+        return mLayout;
+    }
+
+private:
+    KvCacheLayout mLayout;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Reliable, ordered, bidirectional byte stream between two peers, used to move KV cache blocks.
+///
+/// A transport connects exactly one sender and one receiver and is not thread-safe: each direction must be used by one
+/// thread at a time.
+class KvTransport
+{
+public:
+    using UniquePtr = std::unique_ptr<KvTransport>;
+
+    virtual ~KvTransport() = default;
+
+    /// @brief Send size bytes, blocks until they are handed over to the transport.
+    virtual void send(void const* data, std::size_t size) = 0;
+
+    /// @brief Receive exactly size bytes, blocks until they arrived.
+    virtual void recv(void* data, std::size_t size) = 0;
+};
+
+/// @brief Transport over a POSIX shared memory segment, between processes or threads of one node.
+///
+/// The segment holds one single-producer single-consumer ring per direction. The creator owns the segment and unlinks
+/// it on destruction, the peer opens it by name.
+class SharedMemoryTransport : public KvTransport
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @param name Name of the segment, see shm_open.
+    /// @param capacity Size in bytes of the ring of each direction.
+    /// @param timeout How long send and recv wait for the peer before throwing.
+    [[nodiscard]] static std::unique_ptr<SharedMemoryTransport> create(std::string const& name,
+        std::size_t capacity = std::size_t{64} << 20, std::chrono::milliseconds timeout = std::chrono::seconds{60});
+
+    /// @brief Open a segment created by the peer, waiting up to timeout for it to exist.
+    [[nodiscard]] static std::unique_ptr<SharedMemoryTransport> open(
+        std::string const& name, std::chrono::milliseconds timeout = std::chrono::seconds{60});
+
+    ~SharedMemoryTransport() override;
+
+    SharedMemoryTransport(SharedMemoryTransport const&) = delete;
+    SharedMemoryTransport& operator=(SharedMemoryTransport const&) = delete;
+
+    void send(void const* data, std::size_t size) override;
+    void recv(void* data, std::size_t size) override;
+
+private:
+    struct Ring;
+
+    SharedMemoryTransport(std::string name, bool isOwner, void* segment, std::size_t segmentSize,
+        std::chrono::milliseconds timeout);
+
+    std::string mName;
+    bool mIsOwner;
+    void* mSegment;
+    std::size_t mSegmentSize;
+    std::chrono::milliseconds mTimeout;
+    Ring* mSendRing;
+    Ring* mRecvRing;
+};
+
+/// @brief Transport over a TCP connection, with Nagle's algorithm disabled.
+class TcpTransport : public KvTransport
+{
+public:
+    /// @brief Connect to a listening peer, retrying until timeout since it may not be listening yet.
+    [[nodiscard]] static std::unique_ptr<TcpTransport> connect(std::string const& host, std::uint16_t port,
+        std::chrono::milliseconds timeout = std::chrono::seconds{60});
+
+    /// @brief Takes ownership of a connected socket.
+    explicit TcpTransport(int fd);
+
+    ~TcpTransport() override;
+
+    TcpTransport(TcpTransport const&) = delete;
+    TcpTransport& operator=(TcpTransport const&) = delete;
+
+    void send(void const* data, std::size_t size) override;
+    void recv(void* data, std::size_t size) override;
+
+private:
+    int mFd;
+};
+
+/// @brief Listening socket accepting TcpTransport connections.
+class TcpListener
+{
+public:
+    /// @param port Port to listen on, 0 picks a free one, see getPort.
+    explicit TcpListener(std::uint16_t port = 0, std::string const& host = "0.0.0.0");
+
+    ~TcpListener();
+
+    TcpListener(TcpListener const&) = delete;
+    TcpListener& operator=(TcpListener const&) = delete;
+
+    [[nodiscard]] std::uint16_t getPort() const noexcept
+    {
+        return mPort;
+    }
+
+    /// @brief Block until a peer connects.
+    [[nodiscard]] std::unique_ptr<TcpTransport> accept();
+
+private:
+    int mFd;
+    std::uint16_t mPort;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief CPUs and memory node close to a device.
+struct DeviceAffinity
+{
+    SizeType32 numaNode;
+    std::vector<SizeType32> cpus;
+};
+
+/// @brief NUMA nodes of the host and the placement of PCI devices, read from sysfs.
+class NumaTopology
+{
+public:
+    /// @brief Read the topology of the host from a sysfs tree, /sys normally.
+    /// A host without NUMA support is one node holding all online CPUs.
+    explicit NumaTopology(std::filesystem::path sysfsRoot = "/sys");
+
+    /// @brief The topology of this host, read once.
+    [[nodiscard]] static NumaTopology const& getInstance();
+
+    /// @brief Parse a sysfs CPU or node list, e.g. "0-3,8,10-11".
+    [[nodiscard]] static std::vector<SizeType32> parseCpuList(std::string const& list);
+
+    [[nodiscard]] SizeType32 getNumNodes() const noexcept
+    {
+        return static_cast<SizeType32>(mNodeCpus.size());
+    }
+
+    /// @brief CPUs of a node, empty for memory-only nodes.
+    [[nodiscard]] std::vector<SizeType32> const& getNodeCpus(SizeType32 node) const;
+
+    /// @brief Node and local CPUs of a PCI device.
+    /// @param busId The PCI bus id of the device, e.g. "0000:3b:00.0".
+    /// @return Nothing if the device is not found or the firmware does not report its node.
+    [[nodiscard]] std::optional<DeviceAffinity> getPciDeviceAffinity(std::string const& busId) const;
+
+    /// @brief Affinity of a CUDA device, cached. Nothing if it is unknown, the host has a single node, or
+    /// TRTLLM_DISABLE_NUMA_AFFINITY=1.
+    [[nodiscard]] static std::optional<DeviceAffinity> const& getDeviceAffinity(SizeType32 device);
+
+    /// @brief Node of the current CUDA device, to be resolved once by the owners of pinned memory, e.g. pools.
+    [[nodiscard]] static std::optional<SizeType32> getCurrentDeviceNumaNode();
+
+private:
+    std::filesystem::path mSysfsRoot;
+    std::vector<std::vector<SizeType32>> mNodeCpus;
+};
+
+/// @brief Restrict the calling thread to cpus.
+/// @return false if the affinity could not be set, e.g. the CPUs are outside of the cgroup of the process.
+bool bindCurrentThreadToCpus(std::vector<SizeType32> const& cpus);
+
+/// @brief Prefer a node for the pages of a range of memory that are not allocated yet, i.e. not touched.
+/// @return false if the policy could not be set, e.g. the kernel has no NUMA support.
+bool bindMemoryToNumaNode(void* ptr, std::size_t size, SizeType32 node);
+
+/// @brief Prefer a node for the memory allocated by the calling thread in the scope, e.g. pinned memory whose pages are
+/// allocated by cudaHostAlloc. Does nothing without a node or if the thread already has a memory policy.
+class ScopedNumaMemoryPolicy
+{
+public:
+    explicit ScopedNumaMemoryPolicy(std::optional<SizeType32> node);
+
+    ~ScopedNumaMemoryPolicy();
+
+    ScopedNumaMemoryPolicy(ScopedNumaMemoryPolicy const&) = delete;
+    ScopedNumaMemoryPolicy& operator=(ScopedNumaMemoryPolicy const&) = delete;
+
+private:
+    bool mActive{false};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Where the time of a request went, from its arrival to its last token.
+///
+/// The time points are monotonic, on the clock of the process which recorded them. Durations are relative to the
+/// arrival of the request.
+struct RequestLatencyBreakdown
+{
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::nanoseconds;
+
+    Clock::time_point arrival;
+    /// @brief Time the request was first scheduled, i.e. the time it waited in the queue.
+    std::optional<Duration> firstScheduled;
+    std::optional<Duration> firstToken;
+    std::optional<Duration> lastToken;
+    /// @brief Total time the request was paused for lack of resources, including the ongoing pause.
+    Duration pausedTime{0};
+    /// @brief Number of times the request was paused after being scheduled.
+    SizeType32 numPreemptions{0};
+    /// @brief Number of iterations which processed a chunk of the context of the request.
+    SizeType32 numPrefillChunks{0};
+
+    /// @returns the time between the first and the last token.
+    [[nodiscard]] std::optional<Duration> getDecodeTime() const;
+
+    bool operator==(RequestLatencyBreakdown const& other) const;
+
+    void serialize(std::ostream& os) const;
+    [[nodiscard]] std::size_t serializedSize() const;
+    [[nodiscard]] static RequestLatencyBreakdown deserialize(std::istream& is);
+};
+
+/// @brief Records the latency events of the requests in flight, without locks.
+///
+/// Each request registered with start() owns a slot of a fixed-size table keyed by request id until finish(). The
+/// fields of the slots are atomics, so the events of any requests can be recorded concurrently from several threads.
+/// start() must be called once per request, before its other events. The events of requests which could not be
+/// registered are ignored, and so are the events racing with the finish() of their request.
+///
+/// A thread recording an event pins the slot of the request. finish() retires the slot, which is only freed for
+/// another request once the last thread using it unpins it, so that a late event never lands in the next request.
+class RequestLatencyRecorder
+{
+public:
+    using Clock = RequestLatencyBreakdown::Clock;
+    using IdType = executor::IdType;
+
+    /// @param maxNumRequests Number of requests in flight the table is sized for.
+    explicit RequestLatencyRecorder(SizeType32 maxNumRequests);
+
+    /// @brief Registers a request which arrived at arrival.
+    /// @returns false if no slot is free for the request.
+    bool start(IdType requestId, Clock::time_point arrival = Clock::now());
+
+    void onScheduled(IdType requestId, Clock::time_point now = Clock::now());
+
+    void onPrefillChunk(IdType requestId);
+
+    /// @brief Marks the request as paused for lack of resources. A pause after being scheduled is a preemption.
+    void onPaused(IdType requestId, Clock::time_point now = Clock::now());
+
+    void onResumed(IdType requestId, Clock::time_point now = Clock::now());
+
+    /// @brief Records the delivery of tokens of the request.
+    /// @returns false if the request is not registered.
+    bool onToken(IdType requestId, Clock::time_point now = Clock::now());
+
+    /// @brief Records the events observed in the stats of an iteration: scheduling, pauses and context chunks.
+    void onRequestStats(executor::RequestStats const& stats, Clock::time_point now = Clock::now());
+
+    /// @returns the breakdown of a request in flight so far.
+    [[nodiscard]] std::optional<RequestLatencyBreakdown> getBreakdown(
+        IdType requestId, Clock::time_point now = Clock::now()) const;
+
+    /// @brief Releases the slot of the request.
+    /// @returns its breakdown, std::nullopt if it was not registered.
+    std::optional<RequestLatencyBreakdown> finish(IdType requestId, Clock::time_point now = Clock::now());
+
+    /// @returns the number of requests registered and not finished.
+    [[nodiscard]] SizeType32 getNumRequests() const noexcept
+    {
+        return mNumRequests.load(std::memory_order_relaxed);
+    }
+
+private:
+    //! Time points in nanoseconds since the epoch of the clock, 0 if not set.
+    struct alignas(64) Slot
+    {
+        std::atomic<IdType> requestId{kFreeSlot};
+        std::atomic<std::int64_t> arrival{0};
+        std::atomic<std::int64_t> firstScheduled{0};
+        std::atomic<std::int64_t> firstToken{0};
+        std::atomic<std::int64_t> lastToken{0};
+        std::atomic<std::int64_t> pausedSince{0};
+        std::atomic<std::int64_t> pausedTime{0};
+        std::atomic<SizeType32> numPreemptions{0};
+        std::atomic<SizeType32> numPrefillChunks{0};
+        std::atomic<SizeType32> contextPrefillPosition{-1};
+        //! Threads using the slot, which keep it from being freed.
+        std::atomic<std::uint32_t> numPins{0};
+    };
+
+    struct Unpin
+    {
+        void operator()(Slot* slot) const noexcept;
+    };
+
+    using PinnedSlot = std::unique_ptr<Slot, Unpin>;
+
+    static IdType constexpr kFreeSlot = ~IdType{0};
+    //! Slots probed for a request from its home slot.
+    static std::size_t constexpr kMaxProbes = 16;
+
+    [[nodiscard]] std::size_t getHomeSlot(IdType requestId) const noexcept;
+
+    //! Pins the slot of a registered request.
+    [[nodiscard]] PinnedSlot pin(IdType requestId) const noexcept;
+
+    static void pause(Slot& slot, Clock::time_point now);
+
+    static void resume(Slot& slot, Clock::time_point now);
+
+    [[nodiscard]] static RequestLatencyBreakdown makeBreakdown(Slot const& slot, Clock::time_point now);
+
+    std::unique_ptr<Slot[]> mSlots;
+    std::size_t mNumSlots;
+    int mHashShift;
+    std::atomic<SizeType32> mNumRequests{0};
+};
+
+/// @brief Response with the latency breakdown of its request, set for the final response.
+struct TimedResponse
+{
+    executor::Response response;
+    std::optional<RequestLatencyBreakdown> latency;
+};
+
+/// @brief Stats of a request in an iteration with its latency breakdown so far.
+struct TimedRequestStats
+{
+    executor::RequestStats stats;
+    std::optional<RequestLatencyBreakdown> latency;
+};
+
+struct TimedRequestStatsPerIteration
+{
+    executor::IterationType iter;
+    std::vector<TimedRequestStats> requestStats;
+};
+
+/// @brief Executor front door which records the latency breakdown of each request.
+///
+/// The arrival is taken when the request is enqueued, tokens when responses are awaited, and scheduling, pauses and
+/// context chunks when the request stats of the iterations are read, so the latter need the request stats to be polled
+/// regularly. Without streaming, the first and last tokens are both taken with the final response.
+///
+/// The requests are registered after the executor returns their ids, so their first responses can be awaited before.
+/// Such responses are held aside while requests are being enqueued, and recorded once their request is registered. A
+/// final response held aside carries no breakdown. All requests of the executor must be enqueued through this class.
+class LatencyTrackingExecutor
+{
+public:
+    LatencyTrackingExecutor(std::shared_ptr<executor::Executor> executor, SizeType32 maxNumRequests);
+
+    [[nodiscard]] executor::IdType enqueueRequest(executor::Request const& request);
+
+    [[nodiscard]] std::vector<executor::IdType> enqueueRequests(std::vector<executor::Request> const& requests);
+
+    /// @brief Await ready responses. Final responses carry the latency breakdown of their request.
+    [[nodiscard]] std::vector<TimedResponse> awaitResponses(
+        std::optional<std::chrono::milliseconds> const& timeout = std::nullopt);
+
+    void cancelRequest(executor::IdType requestId);
+
+    /// @brief Returns the request stats of the iterations since the last call, with the breakdown of each request.
+    [[nodiscard]] std::deque<TimedRequestStatsPerIteration> getLatestRequestStats();
+
+    [[nodiscard]] RequestLatencyRecorder const& getRecorder() const noexcept
+    {
+        return mRecorder;
+    }
+
+private:
+    using Clock = RequestLatencyRecorder::Clock;
+
+    //! Responses of a request awaited before it was registered.
+    struct EarlyResponses
+    {
+        executor::IdType requestId;
+        std::optional<Clock::time_point> firstToken;
+        Clock::time_point lastToken;
+        bool isFinal;
+    };
+
+    //! Holds a response of a request which is not registered, unless its request was registered meanwhile.
+    //! @returns the breakdown of the request if the response is final and was recorded.
+    std::optional<RequestLatencyBreakdown> holdEarlyResponse(
+        executor::IdType requestId, bool hasToken, bool isFinal, Clock::time_point now);
+
+    //! Records the held responses of the registered requests, and drops the others if no request is being enqueued.
+    void recordEarlyResponses();
+
+    //! Records held responses of a registered request.
+    //! @returns the breakdown of the request if the responses were final.
+    std::optional<RequestLatencyBreakdown> record(EarlyResponses const& responses);
+
+    std::shared_ptr<executor::Executor> mExecutor;
+    RequestLatencyRecorder mRecorder;
+    //! Number of calls of enqueueRequests in progress. Responses of unregistered requests are only held meanwhile.
+    std::atomic<SizeType32> mNumEnqueuing{0};
+    //! Responses held aside, rare enough to be guarded by a mutex. Their number is read without it.
+    std::mutex mEarlyResponsesMutex;
+    std::vector<EarlyResponses> mEarlyResponses;
+    std::atomic<std::size_t> mNumEarlyResponses{0};
+};
+
+} // namespace tensorrt_llm::runtime
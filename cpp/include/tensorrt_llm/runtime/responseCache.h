@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/executor.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Exact-match cache of the responses of deterministic requests.
+///
+/// Only greedy requests (beam width 1, top-k 1 or no sampling, a single return sequence) without tensors attached to
+/// them are cached. The key holds everything that can change their output: input tokens, sampling and output configs,
+/// max tokens, end and pad ids, bad and stop words, LoRA task id, streaming mode and encoder input. The full results
+/// streamed for a request are recorded and replayed verbatim for later identical requests. Entries are evicted in LRU
+/// order to respect the memory bound, and expire after the optional time to live. Thread-safe.
+class ResponseCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        std::uint64_t numHits{0};
+        std::uint64_t numMisses{0};
+        std::uint64_t numInsertions{0};
+        std::uint64_t numEvictions{0};
+        std::uint64_t numExpirations{0};
+        std::size_t numEntries{0};
+        std::size_t usedBytes{0};
+    };
+
+    /// @param maxBytes Bound on the memory held by keys and results. Entries larger than that are not cached.
+    /// @param timeToLive Entries older than that are dropped on lookup.
+    explicit ResponseCache(std::size_t maxBytes, std::optional<Clock::duration> timeToLive = std::nullopt);
+
+    /// @brief Key of a request, or std::nullopt if its output is not deterministic or depends on tensors.
+    [[nodiscard]] static std::optional<std::string> makeKey(executor::Request const& request);
+
+    /// @brief Responses recorded for the key, re-addressed to requestId, or std::nullopt on a miss.
+    [[nodiscard]] std::optional<std::vector<executor::Response>> lookup(
+        std::string const& key, executor::IdType requestId);
+
+    /// @brief Store the results of a finished request. Replaces an existing entry with the same key.
+    void insert(std::string key, std::vector<executor::Result> results);
+
+    /// @brief Record the responses of an enqueued request, they are inserted once its final response is seen.
+    void startRecording(executor::IdType requestId, std::string key);
+
+    /// @brief Feed a response returned by the executor. Errors and cancellations drop the recording.
+    void recordResponse(executor::Response const& response);
+
+    /// @brief Forget the recording of a request, e.g. when it is cancelled.
+    void stopRecording(executor::IdType requestId);
+
+    void clear();
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        std::vector<executor::Result> results;
+        Clock::time_point insertionTime;
+        std::size_t numBytes;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    void insertLocked(std::string key, std::vector<executor::Result> results);
+    void eraseLocked(std::unordered_map<std::string_view, Entry>::iterator it);
+
+    std::size_t const mMaxBytes;
+    std::optional<Clock::duration> const mTimeToLive;
+
+    mutable std::mutex mMutex;
+    //! Keys in LRU order, most recent first. The map keys are views of these strings.
+    std::list<std::string> mLru;
+    std::unordered_map<std::string_view, Entry> mEntries;
+    std::unordered_map<executor::IdType, std::pair<std::string, std::vector<executor::Result>>> mRecordings;
+    Stats mStats;
+};
+
+/// @brief Front door of an executor that serves repeated deterministic requests from a ResponseCache.
+///
+/// Cache hits get request ids from a separate range and their responses are returned by the next awaitResponses call,
+/// without scheduling any work on the executor. Misses are enqueued and their responses are recorded. A hit enqueued
+/// while another thread blocks in awaitResponses is only returned by the next call, so use a timeout in that case.
+class CachingExecutor
+{
+public:
+    CachingExecutor(std::shared_ptr<executor::Executor> executor, std::shared_ptr<ResponseCache> cache);
+
+    [[nodiscard]] executor::IdType enqueueRequest(executor::Request const& request);
+
+    [[nodiscard]] std::vector<executor::IdType> enqueueRequests(std::vector<executor::Request> const& requests);
+
+    /// @brief Await ready responses. Replayed responses are returned without waiting on the executor.
+    [[nodiscard]] std::vector<executor::Response> awaitResponses(
+        std::optional<std::chrono::milliseconds> const& timeout = std::nullopt);
+
+    void cancelRequest(executor::IdType requestId);
+
+    //! First id given to cache hits, far above the ids handed out by the executor.
+    static executor::IdType constexpr kFirstReplayId = executor::IdType{1} << 62;
+
+private:
+    std::shared_ptr<executor::Executor> mExecutor;
+    std::shared_ptr<ResponseCache> mCache;
+
+    std::mutex mMutex;
+    std::deque<executor::Response> mReplayed;
+    executor::IdType mNextReplayId{kFirstReplayId};
+};
+
+} // namespace tensorrt_llm::runtime
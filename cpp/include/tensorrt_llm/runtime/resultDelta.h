@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <istream>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Update of one beam relative to the previous streamed result of the same sequence.
+///
+/// The new beam is the first `tokenPrefixLength` tokens of beam `sourceBeam` of the previous result followed by
+/// `tokens`. Beam search may reorder beams between steps, hence the explicit source beam. Log probabilities are
+/// encoded the same way, relative to the same source beam.
+struct BeamDelta
+{
+    SizeType32 sourceBeam{0};
+    SizeType32 tokenPrefixLength{0};
+    executor::VecTokens tokens;
+    SizeType32 logProbPrefixLength{0};
+    executor::VecLogProbs logProbs;
+
+    bool operator==(BeamDelta const& other) const;
+};
+
+/// @brief Delta-encoded executor::Result. Fields that are not per-token are carried as is.
+struct ResultDelta
+{
+    bool isFinal{false};
+    bool isSequenceFinal{false};
+    SizeType32 sequenceIndex{0};
+    SizeType32 decodingIter{0};
+    std::vector<BeamDelta> beams;
+    bool hasLogProbs{false};
+    std::optional<executor::VecLogProbs> cumLogProbs;
+    std::vector<executor::FinishReason> finishReasons;
+    std::optional<executor::Tensor> contextLogits;
+    std::optional<executor::Tensor> generationLogits;
+    std::optional<executor::Tensor> encoderOutput;
+    std::optional<executor::ContextPhaseParams> contextPhaseParams;
+
+    void serialize(std::ostream& os) const;
+    [[nodiscard]] std::size_t serializedSize() const;
+    [[nodiscard]] static ResultDelta deserialize(std::istream& is);
+};
+
+/// @brief Produces the deltas of the successive results streamed for one sequence of one request.
+///
+/// With `returnAllGeneratedTokens`, every streamed Result repeats the full beams. The encoder keeps the previous
+/// beams and only emits what changed, so the volume sent per step no longer grows with the output length.
+class ResultDeltaEncoder
+{
+public:
+    /// @param enableDelta If false, every delta carries the full beams. Useful as a reference and for clients that
+    /// do not keep state.
+    explicit ResultDeltaEncoder(bool enableDelta = true)
+        : mEnableDelta{enableDelta}
+    {
+    }
+
+    [[nodiscard]] ResultDelta encode(executor::Result const& result);
+
+private:
+    bool mEnableDelta;
+    executor::BeamTokens mTokens;
+    std::vector<executor::VecLogProbs> mLogProbs;
+};
+
+/// @brief Client-side reassembly of the results of one sequence from their deltas.
+class ResultDeltaDecoder
+{
+public:
+    /// @brief Apply a delta. The returned result holds the full beams and stays valid until the next call.
+    executor::Result const& decode(ResultDelta delta);
+
+private:
+    executor::Result mResult;
+};
+
+/// @brief Delta encoding of the responses of many requests into a single buffer, as sent by the response thread.
+///
+/// The per-sequence state is keyed by request id and sequence index, and released with the last result of the
+/// sequence. Error responses are forwarded and release the state of the request.
+class ResponseDeltaEncoder
+{
+public:
+    explicit ResponseDeltaEncoder(bool enableDelta = true)
+        : mEnableDelta{enableDelta}
+    {
+    }
+
+    [[nodiscard]] std::vector<char> encode(std::vector<executor::Response> const& responses);
+
+    [[nodiscard]] std::size_t getNumActiveSequences() const noexcept
+    {
+        return mEncoders.size();
+    }
+
+private:
+    using Key = std::pair<executor::IdType, SizeType32>;
+
+    bool mEnableDelta;
+    std::map<Key, ResultDeltaEncoder> mEncoders;
+};
+
+/// @brief Counterpart of ResponseDeltaEncoder. Returns responses with full beams.
+class ResponseDeltaDecoder
+{
+public:
+    [[nodiscard]] std::vector<executor::Response> decode(std::vector<char> const& buffer);
+
+    [[nodiscard]] std::size_t getNumActiveSequences() const noexcept
+    {
+        return mDecoders.size();
+    }
+
+private:
+    using Key = std::pair<executor::IdType, SizeType32>;
+
+    std::map<Key, ResultDeltaDecoder> mDecoders;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/diskKvCacheTier.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class RnnStateBuffers;
+
+/// @brief Cache of recurrent states of prompt prefixes, the counterpart of KV cache reuse for Mamba and
+/// RecurrentGemma models.
+///
+/// The rnn and conv states of a sequence are checkpointed after every checkpointInterval prompt tokens into a bounded
+/// pool, keyed by the hash chain of the prefix they were computed from. Entries keep their prefix, which is compared on
+/// lookup, so that a hash collision never restores the state of another prompt. A new request whose prompt starts
+/// with a cached prefix restores the state of the longest one into its state slot and only prefills the remaining
+/// tokens.
+/// When the pool is full, the least recently used state is replaced.
+///
+/// Requires paged state: states are copied from and to the slot slotMappingHost assigns to a batch index.
+class RnnStateCache
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using StateHash = DiskKvCacheTier::BlockHash;
+
+    struct Match
+    {
+        SizeType32 entry;
+        //! The number of prompt tokens the state was computed from, i.e. the prefill tokens saved.
+        SizeType32 numTokens;
+    };
+
+    struct Stats
+    {
+        std::size_t numHits{0};
+        std::size_t numMisses{0};
+        std::size_t numStores{0};
+        std::size_t numEvictions{0};
+        std::size_t numTokensSaved{0};
+    };
+
+    /// @brief Allocate a pool of maxNumEntries states shaped like one slot of buffers.
+    /// @param memoryType Where to keep the pool, kGPU to restore without crossing PCIe.
+    RnnStateCache(SizeType32 maxNumEntries, SizeType32 checkpointInterval, RnnStateBuffers const& buffers,
+        BufferManager const& manager, MemoryType memoryType = MemoryType::kGPU);
+
+    /// @brief The number of prompt tokens after which the state of a sequence can be stored. Prefill chunks should
+    /// end at multiples of this.
+    [[nodiscard]] SizeType32 getCheckpointInterval() const noexcept
+    {
+        return mCheckpointInterval;
+    }
+
+    /// @brief Find the longest cached prefix of a prompt. The last prompt token is never covered, since its logits are
+    /// needed for the first generated token.
+    [[nodiscard]] std::optional<Match> find(VecUniqueTokens const& tokens, LoraTaskIdType loraTaskId = 0);
+
+    /// @brief Copy the state of a match into the slot of batchIdx. Must come after the context step has reset the
+    /// states, and the prefill then starts at match.numTokens.
+    void restore(Match const& match, RnnStateBuffers const& buffers, SizeType32 batchIdx);
+
+    /// @brief Store the state of the slot of batchIdx after prefilling the first numTokens tokens.
+    /// @param numTokens A multiple of the checkpoint interval.
+    /// @return The entry holding the state, which is not copied again if it is already cached.
+    SizeType32 store(VecUniqueTokens const& tokens, SizeType32 numTokens, RnnStateBuffers const& buffers,
+        SizeType32 batchIdx, LoraTaskIdType loraTaskId = 0);
+
+    [[nodiscard]] bool contains(
+        VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId = 0) const;
+
+    [[nodiscard]] SizeType32 getNumEntries() const noexcept
+    {
+        return static_cast<SizeType32>(mEntries.size() - mFreeEntries.size());
+    }
+
+    [[nodiscard]] SizeType32 getMaxNumEntries() const noexcept
+    {
+        return static_cast<SizeType32>(mEntries.size());
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+    /// @brief The state slot of a batch index, given by slotMappingHost.
+    [[nodiscard]] static SizeType32 getStateSlot(RnnStateBuffers const& buffers, SizeType32 batchIdx);
+
+private:
+    struct Entry
+    {
+        StateHash hash;
+        SizeType32 numTokens;
+        LoraTaskIdType loraTaskId;
+        //! The numTokens tokens the state was computed from.
+        VecUniqueTokens prefix;
+        std::list<SizeType32>::iterator lruIt;
+    };
+
+    [[nodiscard]] StateHash hashPrefix(
+        VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId) const;
+
+    //! \brief Whether the entry mapped to the hash of a prefix holds that prefix.
+    [[nodiscard]] bool holdsPrefix(
+        SizeType32 entry, VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId) const;
+
+    SizeType32 acquireEntry(
+        StateHash hash, VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId);
+
+    void touch(SizeType32 entry);
+
+    BufferManager const& mManager;
+    SizeType32 mCheckpointInterval;
+    SizeType32 mNumLayers;
+    TensorPtr mRnnStatePool;  // [maxNumEntries * numLayers, ...]
+    TensorPtr mConvStatePool; // [maxNumEntries * numLayers, ...]
+
+    std::vector<Entry> mEntries;
+    std::vector<SizeType32> mFreeEntries;
+    //! Most recently used first.
+    std::list<SizeType32> mLruList;
+    std::unordered_map<StateHash, SizeType32> mLookup;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
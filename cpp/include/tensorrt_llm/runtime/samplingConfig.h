@@ -21,6 +21,7 @@
 #include "tensorrt_llm/layers/defaultDecodingParams.h"
 #include "tensorrt_llm/runtime/common.h"
 
+#include <algorithm>
 #include <functional>
 #include <optional>
 #include <vector>
@@ -105,6 +106,16 @@ private:
         return valid;
     }
 
+    template <typename T>
+    static void expandVec(OptVec<T>& vec, size_t size)
+    {
+        if (vec && vec->size() == 1 && size > 1)
+        {
+            auto const value = vec->front();
+            vec->assign(size, value);
+        }
+    }
+
 public:
     explicit SamplingConfig(SizeType32 beamWidth = 1)
         : beamWidth{beamWidth}
@@ -236,6 +247,17 @@ public:
         // Detect greedy sampling and overwrite params.
         if (temperature)
         {
+            // Fused configs hold a single value for fields shared by the batch, expand them so that the params of the
+            // greedy requests can be overwritten individually.
+            if (std::find(temperature->begin(), temperature->end(), 0.f) != temperature->end())
+            {
+                auto const batchSize
+                    = std::max({temperature->size(), topK ? topK->size() : 1, topP ? topP->size() : 1});
+                expandVec(temperature, batchSize);
+                expandVec(topK, batchSize);
+                expandVec(topP, batchSize);
+            }
+
             for (size_t ti = 0; ti < temperature->size(); ++ti)
             {
                 if (temperature->at(ti) == 0.f)
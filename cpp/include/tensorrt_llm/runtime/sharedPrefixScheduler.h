@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Admission of pending requests that computes the prefill of a prompt prefix shared by several of them once.
+///
+/// The block manager can only reuse the blocks of a prefix once a request has prefilled and stored them, so requests
+/// arriving together with the same long system prompt would all prefill it. The scheduler groups the pending requests
+/// by the full prompt blocks they share, beyond the blocks already reusable, with a trie of blocks keyed by their
+/// tokens, their parent block and the LoRA task. The first request of a group that shares at least minSharedBlocks
+/// blocks becomes the leader of the prefix and is admitted. The other requests of the group follow it: they are
+/// deferred while the leader is in flight, and are admitted once it is released, when its blocks can be reused. As in
+/// the block manager, the block holding the last prompt token is never shared.
+class SharedPrefixScheduler
+{
+public:
+    using LlmRequestPtr = std::shared_ptr<batch_manager::LlmRequest>;
+    using RequestVector = std::vector<LlmRequestPtr>;
+    using RequestIdType = batch_manager::LlmRequest::RequestIdType;
+    using VecTokens = batch_manager::LlmRequest::VecTokens;
+    //! Number of leading prompt blocks of a request that the KV cache can reuse.
+    using ReusableBlocksFunc = std::function<SizeType32(batch_manager::LlmRequest const&)>;
+
+    struct Plan
+    {
+        //! Leaders and requests without a shared prefix, in pending order.
+        RequestVector admitted;
+        //! Followers of a leader in flight, to schedule again once it is released.
+        RequestVector deferred;
+    };
+
+    struct Stats
+    {
+        std::uint64_t numLeaders{0};
+        std::uint64_t numDeferrals{0};
+        //! Prompt blocks the deferred requests did not prefill in the round they were deferred.
+        std::uint64_t numDeferredBlocks{0};
+    };
+
+    /// @param minSharedBlocks Least number of shared blocks, beyond the reusable ones, for which a request is deferred.
+    explicit SharedPrefixScheduler(SizeType32 tokensPerBlock, SizeType32 minSharedBlocks = 1);
+
+    /// @brief Split the pending requests into the ones to admit and the followers of a leader in flight.
+    [[nodiscard]] Plan schedule(RequestVector const& pending, ReusableBlocksFunc const& numReusableBlocks);
+
+    /// @brief The leader stored its context blocks for reuse, finished or was cancelled. Its followers are admitted by
+    /// the next schedule, or one of them becomes the leader if the blocks are not reusable.
+    void releaseLeader(RequestIdType requestId);
+
+    [[nodiscard]] bool isLeader(RequestIdType requestId) const
+    {
+        return mLeaders.count(requestId) > 0;
+    }
+
+    [[nodiscard]] SizeType32 getNumLeaders() const noexcept
+    {
+        return static_cast<SizeType32>(mLeaders.size());
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    using NodeIdType = std::int64_t;
+
+    struct BlockKey
+    {
+        NodeIdType parent;
+        LoraTaskIdType loraTaskId;
+        VecTokens tokens;
+
+        bool operator==(BlockKey const& other) const noexcept
+        {
+            return parent == other.parent && loraTaskId == other.loraTaskId && tokens == other.tokens;
+        }
+    };
+
+    struct BlockKeyHasher
+    {
+        std::size_t operator()(BlockKey const& key) const noexcept;
+    };
+
+    //! Trie of prompt blocks, counting the prompts going through each block.
+    class PrefixTrie
+    {
+    public:
+        //! Number of leading blocks of the prompt in the trie that are held by at least minCount prompts.
+        [[nodiscard]] SizeType32 match(VecTokens const& tokens, LoraTaskIdType loraTaskId, SizeType32 numBlocks,
+            SizeType32 tokensPerBlock, SizeType32 minCount = 1) const;
+
+        //! Add the leading numBlocks blocks of the prompt, returns the keys of the path to release them.
+        std::vector<BlockKey> insert(
+            VecTokens const& tokens, LoraTaskIdType loraTaskId, SizeType32 numBlocks, SizeType32 tokensPerBlock);
+
+        void release(std::vector<BlockKey> const& path);
+
+    private:
+        struct Node
+        {
+            NodeIdType id;
+            SizeType32 count;
+        };
+
+        std::unordered_map<BlockKey, Node, BlockKeyHasher> mNodes;
+        NodeIdType mNextId{0};
+    };
+
+    //! Number of prompt blocks of the request that can be shared with other requests.
+    [[nodiscard]] SizeType32 getNumShareableBlocks(batch_manager::LlmRequest const& request) const;
+
+    SizeType32 const mTokensPerBlock;
+    SizeType32 const mMinSharedBlocks;
+
+    //! Prefixes of the leaders in flight.
+    PrefixTrie mInFlight;
+    std::unordered_map<RequestIdType, std::vector<BlockKey>> mLeaders;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
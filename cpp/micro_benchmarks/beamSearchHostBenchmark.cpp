@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/beamSearchHost.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::kernels;
+using tensorrt_llm::runtime::SizeType32;
+using tensorrt_llm::runtime::TokenIdType;
+
+namespace
+{
+
+auto constexpr kBatchSize = 64;
+auto constexpr kInputLength = 128;
+auto constexpr kEndId = 2;
+
+//! \brief The work tree of a batch of beam searches that ran for the full sequence length.
+struct WorkTree
+{
+    WorkTree(SizeType32 beamWidth, SizeType32 maxSeqLen)
+        : numBeams{kBatchSize * beamWidth}
+        , stepIds(numBeams * maxSeqLen)
+        , parentIds(numBeams * maxSeqLen)
+        , sequenceLengths(numBeams, maxSeqLen)
+        , inputLengths(numBeams, kInputLength)
+        , cumLogProbs(numBeams)
+        , endIds(numBeams, kEndId)
+    {
+        std::mt19937 generator{42};
+        std::uniform_int_distribution<TokenIdType> tokens{kEndId + 1, 32000};
+        std::uniform_int_distribution<TokenIdType> parents{0, beamWidth - 1};
+        std::uniform_real_distribution<float> logProbs{-50.f, -1.f};
+        for (std::size_t i = 0; i < stepIds.size(); ++i)
+        {
+            stepIds[i] = tokens(generator);
+            parentIds[i] = parents(generator);
+        }
+        for (auto& cumLogProb : cumLogProbs)
+        {
+            cumLogProb = logProbs(generator);
+        }
+    }
+
+    SizeType32 numBeams;
+    std::vector<TokenIdType> stepIds;
+    std::vector<TokenIdType> parentIds;
+    std::vector<SizeType32> sequenceLengths;
+    std::vector<SizeType32> inputLengths;
+    std::vector<float> cumLogProbs;
+    std::vector<TokenIdType> endIds;
+};
+
+//! \brief Backtracking and sorting of kBatchSize sampled requests of range(0) beams and range(1) tokens, as
+//! gatherTreeHost does for outputs copied back to the host. Reports the throughput in tokens.
+void BM_GatherTree(benchmark::State& state)
+{
+    auto const beamWidth = static_cast<SizeType32>(state.range(0));
+    auto const maxSeqLen = static_cast<SizeType32>(state.range(1));
+    WorkTree tree{beamWidth, maxSeqLen};
+    std::vector<TokenIdType> outputIds(tree.stepIds.size());
+
+    gatherTreeParam param;
+    param.sequenceLengths = tree.sequenceLengths.data();
+    param.maxSequenceLengthFinalStep = 1;
+    param.inputLengths = tree.inputLengths.data();
+    param.maxSeqLen = maxSeqLen;
+    param.batchSize = kBatchSize;
+    param.beamWidth = beamWidth;
+    param.stepIds = tree.stepIds.data();
+    param.parentIds = tree.parentIds.data();
+    param.endTokens = tree.endIds.data();
+    param.outputIds = outputIds.data();
+    param.cumLogProbs = tree.cumLogProbs.data();
+    for (auto _ : state)
+    {
+        gatherTreeHost(param);
+        benchmark::DoNotOptimize(outputIds.data());
+    }
+    state.SetItemsProcessed(state.iterations() * tree.stepIds.size());
+}
+
+//! \brief Insertion of the unfinished beams into the candidate beam arrays and selection of the best beams, as the
+//! gather_tree op does with beam hypotheses on the host. Reports the throughput in tokens.
+void BM_InsertUnfinishedAndFinalize(benchmark::State& state)
+{
+    auto const beamWidth = static_cast<SizeType32>(state.range(0));
+    auto const maxSeqLen = static_cast<SizeType32>(state.range(1));
+    WorkTree tree{beamWidth, maxSeqLen};
+    auto const numCandidates = tree.numBeams * 2;
+    std::vector<TokenIdType> outputIds(tree.stepIds.size());
+    std::vector<TokenIdType> outputIdsCBA(numCandidates * maxSeqLen);
+    std::vector<SizeType32> sequenceLengthsCBA(numCandidates);
+    std::vector<float> cumLogProbsCBA(numCandidates);
+    std::vector<float> normedScoresCBA(numCandidates);
+    std::vector<SizeType32> numBeamsCBA(kBatchSize);
+    std::vector<float> lengthPenalties(kBatchSize, 1.f);
+    std::vector<char> batchDones(kBatchSize, false);
+
+    BeamHypotheses bh;
+    bh.nMaxBatchSize = kBatchSize;
+    bh.nBatchSize = kBatchSize;
+    bh.nBeamWidth = beamWidth;
+    bh.nMaxSeqLen = maxSeqLen;
+    bh.lengthPenalties = lengthPenalties.data();
+    bh.inputLengths = tree.inputLengths.data();
+    bh.outputIds = outputIds.data();
+    bh.sequenceLengths = tree.sequenceLengths.data();
+    bh.cumLogProbs = tree.cumLogProbs.data();
+    bh.outputIdsCBA = outputIdsCBA.data();
+    bh.sequenceLengthsCBA = sequenceLengthsCBA.data();
+    bh.cumLogProbsCBA = cumLogProbsCBA.data();
+    bh.normedScoresCBA = normedScoresCBA.data();
+    bh.numBeamsCBA = numBeamsCBA.data();
+    bh.batchDones = reinterpret_cast<bool*>(batchDones.data());
+    bh.outputIdsUnfinish = tree.stepIds.data();
+    bh.parentIdsUnfinish = tree.parentIds.data();
+    for (auto _ : state)
+    {
+        std::fill(numBeamsCBA.begin(), numBeamsCBA.end(), 0);
+        insertUnfinishedPathHost(bh);
+        finalizeHost(bh);
+        benchmark::DoNotOptimize(outputIds.data());
+    }
+    state.SetItemsProcessed(state.iterations() * tree.stepIds.size());
+}
+
+void beamArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"beams", "seqLen"});
+    for (auto const beamWidth : {2, 4, 8, 16})
+    {
+        for (auto const maxSeqLen : {256, 1024, 4096})
+        {
+            benchmark->Args({beamWidth, maxSeqLen});
+        }
+    }
+    benchmark->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+} // namespace
+
+BENCHMARK(BM_GatherTree)->Apply(beamArgs);
+BENCHMARK(BM_InsertUnfinishedAndFinalize)->Apply(beamArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/chunkedPrefillPlanner.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kMaxNumTokens = 8192;
+auto constexpr kChunkUnitSize = 64;
+auto constexpr kMaxBatchSize = 64;
+auto constexpr kNumRequests = 2000;
+auto constexpr kNumOutputTokens = 128;
+// Step time of the simulated engine.
+auto const kStepTimeModel = ChunkedPrefillPlanner::StepTimeModel{8., 0.004};
+
+struct SimulationResult
+{
+    double meanTtftMs;
+    double meanItlMs;
+    double p99ItlMs;
+    double prefillTokensPerSecond;
+};
+
+//! \brief Serve a Poisson stream of requests with prompts of 1k to 4k tokens, planning the chunks of each step with a
+//! ChunkedPrefillPlanner, without target if targetMs is empty. A step takes the time predicted by kStepTimeModel.
+SimulationResult simulate(std::optional<double> targetMs, double requestsPerSecond)
+{
+    std::mt19937 generator{1234};
+    std::exponential_distribution<double> interArrivalMs{requestsPerSecond / 1000.};
+    std::uniform_int_distribution<SizeType32> promptLengths{1024, 4096};
+    ChunkedPrefillPlanner const planner{kMaxNumTokens, kChunkUnitSize, kStepTimeModel, targetMs};
+
+    struct Context
+    {
+        double arrivalMs;
+        SizeType32 numRemaining;
+    };
+
+    std::deque<Context> contexts;
+    std::vector<SizeType32> generations;
+    std::vector<double> ttfts;
+    std::vector<double> itls;
+    ttfts.reserve(kNumRequests);
+    std::int64_t numPrefillTokens = 0;
+    std::vector<SizeType32> numRemaining;
+
+    double nowMs = 0.;
+    double nextArrivalMs = interArrivalMs(generator);
+    int numArrived = 0;
+    while (numArrived < kNumRequests || !contexts.empty() || !generations.empty())
+    {
+        while (numArrived < kNumRequests && nextArrivalMs <= nowMs)
+        {
+            contexts.push_back(Context{nextArrivalMs, promptLengths(generator)});
+            nextArrivalMs += interArrivalMs(generator);
+            ++numArrived;
+        }
+        if (contexts.empty() && generations.empty())
+        {
+            nowMs = nextArrivalMs;
+            continue;
+        }
+
+        // Contexts in flight count against the batch size.
+        auto const numContexts = std::min(contexts.size(), kMaxBatchSize - generations.size());
+        numRemaining.resize(numContexts);
+        std::transform(contexts.begin(), contexts.begin() + numContexts, numRemaining.begin(),
+            [](Context const& context) { return context.numRemaining; });
+        auto const numGenTokens = static_cast<SizeType32>(generations.size());
+        auto const plan = planner.plan(numRemaining, numGenTokens);
+        nowMs += kStepTimeModel.estimateMs(plan.numTokens);
+
+        for (auto& numOutputTokens : generations)
+        {
+            itls.push_back(kStepTimeModel.estimateMs(plan.numTokens));
+            --numOutputTokens;
+        }
+        generations.erase(std::remove(generations.begin(), generations.end(), 0), generations.end());
+
+        for (std::size_t i = 0; i < numContexts; ++i)
+        {
+            contexts[i].numRemaining -= plan.chunkSizes[i];
+            numPrefillTokens += plan.chunkSizes[i];
+        }
+        // Contexts after an unfinished one can complete when they fill the budget.
+        for (auto it = contexts.begin(); it != contexts.end();)
+        {
+            if (it->numRemaining == 0)
+            {
+                ttfts.push_back(nowMs - it->arrivalMs);
+                generations.push_back(kNumOutputTokens - 1);
+                it = contexts.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    std::sort(itls.begin(), itls.end());
+    SimulationResult result;
+    result.meanTtftMs = std::accumulate(ttfts.begin(), ttfts.end(), 0.) / ttfts.size();
+    result.meanItlMs = std::accumulate(itls.begin(), itls.end(), 0.) / itls.size();
+    result.p99ItlMs = itls[itls.size() * 99 / 100];
+    result.prefillTokensPerSecond = numPrefillTokens / nowMs * 1000.;
+    return result;
+}
+
+//! \brief Simulate kNumRequests requests at range(1) requests per second with a target iteration time of range(0) ms,
+//! or without target if range(0) is 0. Reports the mean time to first token, the mean and p99 inter-token latency and
+//! the prefill throughput.
+void BM_ChunkedPrefillSimulation(benchmark::State& state)
+{
+    auto const targetMs = state.range(0) > 0 ? std::optional<double>(state.range(0)) : std::nullopt;
+    auto const requestsPerSecond = static_cast<double>(state.range(1));
+    SimulationResult result{};
+    for (auto _ : state)
+    {
+        result = simulate(targetMs, requestsPerSecond);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["meanTtftMs"] = result.meanTtftMs;
+    state.counters["meanItlMs"] = result.meanItlMs;
+    state.counters["p99ItlMs"] = result.p99ItlMs;
+    state.counters["prefillTokensPerSecond"] = result.prefillTokensPerSecond;
+    state.SetItemsProcessed(state.iterations() * kNumRequests);
+}
+
+} // namespace
+
+BENCHMARK(BM_ChunkedPrefillSimulation)
+    ->ArgNames({"targetMs", "rps"})
+    ->ArgsProduct({{0, 12, 16, 24}, {5, 10, 15}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/detokenizer.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kVocabSize = 32000;
+auto constexpr kTokensPerStream = 512;
+
+std::string encodeUtf8(std::uint32_t codePoint)
+{
+    std::string result;
+    if (codePoint < 0x80)
+    {
+        result.push_back(static_cast<char>(codePoint));
+    }
+    else if (codePoint < 0x800)
+    {
+        result.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+        result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    else
+    {
+        result.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+        result.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    return result;
+}
+
+//! \brief Byte-level spelling of a byte string, as stored in a GPT-2 style tokenizer.json.
+std::string toByteLevel(std::string const& bytes)
+{
+    static auto const table = []()
+    {
+        std::vector<std::uint32_t> result(256);
+        std::uint32_t next = 256;
+        for (std::uint32_t b = 0; b < 256; ++b)
+        {
+            bool const printable = (b >= '!' && b <= '~') || (b >= 0xA1 && b <= 0xAC) || (b >= 0xAE && b <= 0xFF);
+            result[b] = printable ? b : next++;
+        }
+        return result;
+    }();
+    std::string result;
+    for (auto const c : bytes)
+    {
+        result += encodeUtf8(table[static_cast<unsigned char>(c)]);
+    }
+    return result;
+}
+
+//! \brief A byte-level BPE vocabulary of mixed ASCII and multi-byte pieces, with single byte tokens so that code
+//! points are regularly split across tokens.
+Detokenizer::SharedConstPtr const& syntheticDetokenizer()
+{
+    static auto const detokenizer = []()
+    {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> length(1, 8);
+        std::uniform_int_distribution<int> ascii('a', 'z');
+        std::uniform_int_distribution<std::uint32_t> cjk(0x4E00, 0x9FFF);
+        std::bernoulli_distribution multiByte(0.2);
+
+        nlohmann::json vocab = nlohmann::json::object();
+        for (int b = 0; b < 256; ++b)
+        {
+            vocab[toByteLevel(std::string(1, static_cast<char>(b)))] = b;
+        }
+        int tokenId = 256;
+        while (tokenId < kVocabSize)
+        {
+            std::string piece = " ";
+            for (int i = 0, n = length(gen); i < n; ++i)
+            {
+                piece += multiByte(gen) ? encodeUtf8(cjk(gen)) : std::string(1, static_cast<char>(ascii(gen)));
+            }
+            auto const [it, inserted] = vocab.emplace(toByteLevel(piece), tokenId);
+            tokenId += inserted ? 1 : 0;
+        }
+        nlohmann::json tokenizer;
+        tokenizer["model"] = {{"type", "BPE"}, {"vocab", vocab}};
+        tokenizer["decoder"] = {{"type", "ByteLevel"}};
+        tokenizer["added_tokens"] = nlohmann::json::array();
+        return Detokenizer::fromJsonString(tokenizer.dump());
+    }();
+    return detokenizer;
+}
+
+std::vector<std::vector<TokenIdType>> randomSequences(int numStreams)
+{
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<TokenIdType> token(0, kVocabSize - 1);
+    std::vector<std::vector<TokenIdType>> sequences(numStreams, std::vector<TokenIdType>(kTokensPerStream));
+    for (auto& sequence : sequences)
+    {
+        for (auto& t : sequence)
+        {
+            t = token(gen);
+        }
+    }
+    return sequences;
+}
+
+//! \brief Incremental detokenization of numStreams concurrent streams, one token per stream per step, as done by a
+//! response thread serving streaming requests.
+void BM_DetokenizerStream(benchmark::State& state)
+{
+    auto const numStreams = static_cast<int>(state.range(0));
+    auto const numStopStrings = static_cast<int>(state.range(1));
+    auto const& detokenizer = syntheticDetokenizer();
+    auto const sequences = randomSequences(numStreams);
+    std::vector<std::string> stopStrings;
+    for (int i = 0; i < numStopStrings; ++i)
+    {
+        stopStrings.push_back("<stop" + std::to_string(i) + ">");
+    }
+
+    std::size_t numBytes = 0;
+    for (auto _ : state)
+    {
+        std::vector<DetokenizerStream> streams;
+        streams.reserve(numStreams);
+        for (int s = 0; s < numStreams; ++s)
+        {
+            streams.emplace_back(detokenizer, stopStrings);
+        }
+        for (int t = 0; t < kTokensPerStream; ++t)
+        {
+            for (int s = 0; s < numStreams; ++s)
+            {
+                auto const delta = streams[s].step(&sequences[s][t], 1);
+                numBytes += delta.text.size();
+            }
+        }
+        benchmark::DoNotOptimize(numBytes);
+    }
+    state.SetItemsProcessed(state.iterations() * numStreams * kTokensPerStream);
+    state.counters["numStreams"] = numStreams;
+    state.counters["numStopStrings"] = numStopStrings;
+}
+
+//! \brief Reference: decode the full sequence after every token and diff against the previous text, which is what a
+//! front-end without incremental state has to do.
+void BM_DetokenizerFullRedecode(benchmark::State& state)
+{
+    auto const numStreams = static_cast<int>(state.range(0));
+    auto const& detokenizer = syntheticDetokenizer();
+    auto const sequences = randomSequences(numStreams);
+
+    std::size_t numBytes = 0;
+    for (auto _ : state)
+    {
+        std::vector<std::vector<TokenIdType>> prefixes(numStreams);
+        std::vector<std::size_t> emitted(numStreams, 0);
+        for (int t = 0; t < kTokensPerStream; ++t)
+        {
+            for (int s = 0; s < numStreams; ++s)
+            {
+                prefixes[s].push_back(sequences[s][t]);
+                auto const text = detokenizer->decode(prefixes[s]);
+                numBytes += text.size() - std::min(text.size(), emitted[s]);
+                emitted[s] = text.size();
+            }
+        }
+        benchmark::DoNotOptimize(numBytes);
+    }
+    state.SetItemsProcessed(state.iterations() * numStreams * kTokensPerStream);
+    state.counters["numStreams"] = numStreams;
+}
+
+} // namespace
+
+BENCHMARK(BM_DetokenizerStream)
+    ->ArgNames({"streams", "stopStrings"})
+    ->ArgsProduct({{1, 64, 1024}, {0, 4}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_DetokenizerFullRedecode)->ArgNames({"streams"})->Arg(1)->Arg(64)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/diskKvCacheTier.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kNumBlocks = 128;
+auto constexpr kTokensPerBlock = 64;
+
+//! \brief The tier file is created in TMPDIR, point it to the NVMe drive to measure.
+std::filesystem::path getPath()
+{
+    return std::filesystem::temp_directory_path() / ("diskKvCacheTierBenchmark." + std::to_string(::getpid()));
+}
+
+//! \brief Write batches of 32 evicted blocks and sync them.
+void BM_DiskTierWrite(benchmark::State& state)
+{
+    auto const blockSize = static_cast<std::size_t>(state.range(0)) << 10;
+    auto const path = getPath();
+    std::vector<std::uint8_t> block(blockSize, 1);
+    DiskKvCacheTier::BlockHash hash = 0;
+    {
+        DiskKvCacheTier tier(path, blockSize, kNumBlocks);
+        for (auto _ : state)
+        {
+            for (int i = 0; i < 32; ++i)
+            {
+                block[0] = static_cast<std::uint8_t>(hash);
+                tier.store(++hash, block.data());
+            }
+            tier.flush();
+        }
+        state.counters["evictions"] = static_cast<double>(tier.getStats().numEvictions);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * 32);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * 32 * blockSize));
+}
+
+//! \brief A request whose prompt matches a stored prefix: hash the prompt, match and read the blocks into host
+//! buffers.
+void BM_DiskTierPrefixHit(benchmark::State& state)
+{
+    auto const blockSize = static_cast<std::size_t>(state.range(0)) << 10;
+    auto const numPrefixBlocks = static_cast<SizeType32>(state.range(1));
+    auto const path = getPath();
+
+    VecUniqueTokens prompt;
+    for (SizeType32 i = 0; i < numPrefixBlocks * kTokensPerBlock + kTokensPerBlock / 2; ++i)
+    {
+        prompt.push_back({i * 7 % 32000, 0});
+    }
+    std::vector<std::vector<std::uint8_t>> blocks(numPrefixBlocks, std::vector<std::uint8_t>(blockSize, 1));
+    std::vector<void*> pointers;
+    for (auto& block : blocks)
+    {
+        pointers.push_back(block.data());
+    }
+    {
+        DiskKvCacheTier tier(path, blockSize, kNumBlocks);
+        for (auto const hash : DiskKvCacheTier::hashBlocks(prompt, kTokensPerBlock))
+        {
+            tier.store(hash, blocks.front().data());
+        }
+        tier.flush();
+
+        for (auto _ : state)
+        {
+            auto hashes = DiskKvCacheTier::hashBlocks(prompt, kTokensPerBlock);
+            hashes.resize(tier.matchPrefix(hashes));
+            auto const numRead = tier.prefetch(std::move(hashes), pointers).get();
+            benchmark::DoNotOptimize(numRead);
+        }
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * numPrefixBlocks);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * numPrefixBlocks * blockSize));
+}
+
+} // namespace
+
+BENCHMARK(BM_DiskTierWrite)->ArgName("blockKiB")->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_DiskTierPrefixHit)
+    ->ArgNames({"blockKiB", "blocks"})
+    ->ArgsProduct({{256, 2048}, {4, 32}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
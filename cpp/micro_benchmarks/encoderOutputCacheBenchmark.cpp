@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/encoderOutputCache.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kHiddenSize = 1024;
+auto constexpr kSegmentLength = 128;
+// 80 mel bins of a 30 s clip, as Whisper takes them.
+auto constexpr kMelBins = 80;
+auto constexpr kMelFrames = 3000;
+auto constexpr kCacheBytes = std::size_t{256} << 20;
+
+//! \brief Serve requests for range(0) distinct source segments, picked with a Zipf-like skew, as retries and n-best
+//! queries of popular segments do. A miss stores the encoder output of the segment. Reports the hit rate.
+void BM_TranslationSegments(benchmark::State& state)
+{
+    auto const numSegments = static_cast<SizeType32>(state.range(0));
+    BufferManager manager{std::make_shared<CudaStream>()};
+    EncoderOutputCache cache{"encoder", kCacheBytes, MemoryType::kCPU};
+    auto const output
+        = BufferManager::cpu(ITensor::makeShape({kSegmentLength, kHiddenSize}), nvinfer1::DataType::kHALF);
+
+    std::vector<double> weights(numSegments);
+    for (SizeType32 i = 0; i < numSegments; ++i)
+    {
+        weights[i] = 1.0 / (i + 1);
+    }
+    std::mt19937 generator{42};
+    std::discrete_distribution<SizeType32> segmentDistribution{weights.begin(), weights.end()};
+    std::vector<TokenIdType> segment(kSegmentLength);
+
+    for (auto _ : state)
+    {
+        auto const id = segmentDistribution(generator);
+        for (SizeType32 i = 0; i < kSegmentLength; ++i)
+        {
+            segment[i] = id * kSegmentLength + i;
+        }
+        auto const key = cache.makeKey(segment);
+        if (auto cached = cache.lookup(key))
+        {
+            benchmark::DoNotOptimize(cached);
+        }
+        else
+        {
+            cache.insert(key, *output, manager);
+        }
+    }
+
+    auto const stats = cache.getStats();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hitRate"]
+        = static_cast<double>(stats.numHits) / static_cast<double>(stats.numHits + stats.numMisses);
+    state.counters["entries"] = static_cast<double>(stats.numEntries);
+}
+
+//! \brief Key derivation cost for the features of a 30 s audio clip, paid by every speech request.
+void BM_AudioFeatureKey(benchmark::State& state)
+{
+    EncoderOutputCache cache{"encoder", kCacheBytes, MemoryType::kCPU};
+    auto const features = BufferManager::cpu(ITensor::makeShape({kMelFrames, kMelBins}), nvinfer1::DataType::kFLOAT);
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<float> distribution{-1.F, 1.F};
+    auto* data = bufferCast<float>(*features);
+    for (std::size_t i = 0; i < features->getSize(); ++i)
+    {
+        data[i] = distribution(generator);
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cache.makeKey(*features));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * features->getSizeInBytes()));
+}
+
+} // namespace
+
+BENCHMARK(BM_TranslationSegments)->ArgName("segments")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AudioFeatureKey)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,197 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/executorRouter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+auto constexpr kNumInstances = 4;
+auto constexpr kNumSlots = 16;
+auto constexpr kTokensPerBlock = 64;
+auto constexpr kNumPrefixes = 64;
+auto constexpr kNumPrefixBlocks = 16;
+auto constexpr kNumUniqueBlocks = 2;
+auto constexpr kCacheBlocks = 384;
+auto constexpr kNumRequests = 4000;
+// Prefill cost of a token that is not in the KV cache, and time a request holds its slot after its first token.
+auto constexpr kPrefillMsPerToken = 0.02;
+auto constexpr kDecodeMs = 400.0;
+
+//! \brief The KV cache of an instance, as an LRU set of blocks.
+class BlockCache
+{
+public:
+    //! \brief Number of leading blocks of the prompt in the cache. All blocks of the prompt are cached afterwards.
+    int lookupAndInsert(std::vector<std::uint64_t> const& blocks)
+    {
+        int numCached = 0;
+        while (numCached < static_cast<int>(blocks.size()) && mBlocks.count(blocks[numCached]))
+        {
+            ++numCached;
+        }
+        for (auto const block : blocks)
+        {
+            if (auto const it = mBlocks.find(block); it != mBlocks.end())
+            {
+                mLru.splice(mLru.begin(), mLru, it->second);
+                continue;
+            }
+            if (mBlocks.size() == kCacheBlocks)
+            {
+                mBlocks.erase(mLru.back());
+                mLru.pop_back();
+            }
+            mLru.push_front(block);
+            mBlocks.emplace(block, mLru.begin());
+        }
+        return numCached;
+    }
+
+private:
+    std::list<std::uint64_t> mLru;
+    std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator> mBlocks;
+};
+
+struct SimulationResult
+{
+    double meanTtftMs;
+    double p99TtftMs;
+    double cacheHitRate;
+};
+
+//! \brief Serve a Poisson stream of requests that share one of kNumPrefixes system prompts with kNumInstances
+//! instances of kNumSlots slots each. A request starts when a slot of its instance is free, and gets its first token
+//! after the prefill of the blocks that are not in the KV cache of the instance.
+SimulationResult simulate(ExecutorRouter::Policy policy, double requestsPerSecond)
+{
+    std::mt19937 generator{1234};
+    std::exponential_distribution<double> interArrivalMs{requestsPerSecond / 1000.};
+    // A few system prompts are much more popular than the others.
+    std::vector<double> weights(kNumPrefixes);
+    for (int i = 0; i < kNumPrefixes; ++i)
+    {
+        weights[i] = 1. / (i + 1);
+    }
+    std::discrete_distribution<int> prefixes{weights.begin(), weights.end()};
+
+    ExecutorRouter router{kNumInstances, policy, kTokensPerBlock, 1 << 16, kNumSlots / 4};
+    std::vector<BlockCache> caches(kNumInstances);
+    std::vector<std::vector<double>> slotFreeMs(kNumInstances, std::vector<double>(kNumSlots, 0.));
+    using Completion = std::pair<double, SizeType32>;
+    std::priority_queue<Completion, std::vector<Completion>, std::greater<>> completions;
+
+    std::vector<double> ttfts;
+    ttfts.reserve(kNumRequests);
+    std::int64_t numCachedTokens = 0;
+    std::int64_t numTokens = 0;
+    double nowMs = 0.;
+    auto const numBlocks = kNumPrefixBlocks + kNumUniqueBlocks;
+    texec::VecTokens tokens(numBlocks * kTokensPerBlock);
+    std::vector<std::uint64_t> blocks(numBlocks);
+    for (int request = 0; request < kNumRequests; ++request)
+    {
+        nowMs += interArrivalMs(generator);
+        while (!completions.empty() && completions.top().first <= nowMs)
+        {
+            router.onFinished(completions.top().second);
+            completions.pop();
+        }
+
+        auto const prefix = prefixes(generator);
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // The unique blocks of the requests are numbered after the blocks of the system prompts.
+            auto const owner = block < kNumPrefixBlocks ? prefix : kNumPrefixes + request;
+            blocks[block] = static_cast<std::uint64_t>(owner) * numBlocks + block;
+            std::fill_n(tokens.begin() + block * kTokensPerBlock, kTokensPerBlock,
+                static_cast<texec::TokenIdType>(blocks[block] % (1 << 30)));
+        }
+
+        auto const instance = router.route(tokens);
+        auto const numCachedBlocks = caches[instance].lookupAndInsert(blocks);
+        auto& slots = slotFreeMs[instance];
+        auto const slot = std::min_element(slots.begin(), slots.end());
+        auto const startMs = std::max(nowMs, *slot);
+        auto const firstTokenMs = startMs + (numBlocks - numCachedBlocks) * kTokensPerBlock * kPrefillMsPerToken;
+        *slot = firstTokenMs + kDecodeMs;
+        completions.emplace(*slot, instance);
+
+        ttfts.push_back(firstTokenMs - nowMs);
+        numCachedTokens += numCachedBlocks * kTokensPerBlock;
+        numTokens += numBlocks * kTokensPerBlock;
+    }
+
+    std::sort(ttfts.begin(), ttfts.end());
+    SimulationResult result;
+    result.meanTtftMs = std::accumulate(ttfts.begin(), ttfts.end(), 0.) / ttfts.size();
+    result.p99TtftMs = ttfts[ttfts.size() * 99 / 100];
+    result.cacheHitRate = static_cast<double>(numCachedTokens) / numTokens;
+    return result;
+}
+
+//! \brief Simulate the routing of kNumRequests requests with policy range(0) at range(1) requests per second. Reports
+//! the mean and p99 time to first token and the fraction of prompt tokens found in the KV cache.
+void BM_RouterSimulation(benchmark::State& state)
+{
+    auto const policy = static_cast<ExecutorRouter::Policy>(state.range(0));
+    auto const requestsPerSecond = static_cast<double>(state.range(1));
+    SimulationResult result{};
+    for (auto _ : state)
+    {
+        result = simulate(policy, requestsPerSecond);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["meanTtftMs"] = result.meanTtftMs;
+    state.counters["p99TtftMs"] = result.p99TtftMs;
+    state.counters["cacheHitRate"] = result.cacheHitRate;
+    state.SetItemsProcessed(state.iterations() * kNumRequests);
+}
+
+void simulationArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"policy", "rps"});
+    for (auto const policy : {ExecutorRouter::Policy::kROUND_ROBIN, ExecutorRouter::Policy::kLEAST_LOADED,
+             ExecutorRouter::Policy::kPREFIX_AFFINITY})
+    {
+        for (auto const requestsPerSecond : {50, 100, 150})
+        {
+            benchmark->Args({static_cast<std::int64_t>(policy), requestsPerSecond});
+        }
+    }
+    benchmark->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_RouterSimulation)->Apply(simulationArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/gptJsonConfig.h"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+//! \brief A llama engine built with the current builder, with most optional fields left out.
+auto constexpr kLlamaConfig = R"({
+    "version": "0.12.0",
+    "pretrained_config": {
+        "architecture": "LlamaForCausalLM", "dtype": "float16", "num_hidden_layers": 80, "num_attention_heads": 64,
+        "num_key_value_heads": 8, "hidden_size": 8192, "vocab_size": 128256, "intermediate_size": 28672,
+        "mapping": {"tp_size": 8, "pp_size": 1}, "quantization": {"quant_algo": "FP8", "kv_cache_quant_algo": "FP8"}
+    },
+    "build_config": {
+        "max_batch_size": 256, "max_input_len": 4096, "max_seq_len": 8192, "max_num_tokens": 8192,
+        "kv_cache_type": "paged", "lora_config": {},
+        "plugin_config": {
+            "gpt_attention_plugin": "auto", "lora_plugin": null, "remove_input_padding": true, "paged_kv_cache": true,
+            "tokens_per_block": 64, "context_fmha": true, "use_paged_context_fmha": true
+        }
+    }
+})";
+
+//! \brief A llama engine with LoRA and Medusa heads, with all optional fields set.
+auto constexpr kMedusaLoraConfig = R"({
+    "version": "0.12.0",
+    "pretrained_config": {
+        "architecture": "MedusaForCausalLm", "dtype": "float16", "num_hidden_layers": 32, "num_attention_heads": 32,
+        "num_key_value_heads": 32, "hidden_size": 4096, "vocab_size": 32000, "intermediate_size": 11008,
+        "head_size": 128, "logits_dtype": "float32", "has_position_embedding": false,
+        "has_token_type_embedding": false, "num_medusa_heads": 4, "max_draft_len": 63,
+        "mapping": {"tp_size": 1, "pp_size": 1, "gpus_per_node": 8},
+        "quantization": {"quant_algo": null, "kv_cache_quant_algo": null}
+    },
+    "build_config": {
+        "max_batch_size": 8, "max_beam_width": 1, "max_input_len": 1024, "max_seq_len": 2048, "max_num_tokens": 8192,
+        "max_prompt_embedding_table_size": 0, "gather_context_logits": false, "gather_generation_logits": false,
+        "speculative_decoding_mode": 4, "kv_cache_type": "paged",
+        "lora_config": {"max_lora_rank": 64, "lora_target_modules": ["attn_qkv", "attn_dense", "mlp_h_to_4h",
+            "mlp_4h_to_h", "mlp_gate"]},
+        "plugin_config": {
+            "gpt_attention_plugin": "float16", "lora_plugin": "float16", "remove_input_padding": true,
+            "paged_kv_cache": true, "tokens_per_block": 64, "context_fmha": true, "use_paged_context_fmha": false,
+            "paged_state": false, "enable_xqa": true, "manage_weights": false
+        }
+    }
+})";
+
+//! \brief A GPT engine built with the legacy builder.
+auto constexpr kLegacyConfig = R"({
+    "builder_config": {
+        "name": "gpt", "precision": "float16", "tensor_parallel": 2, "pipeline_parallel": 1, "num_layers": 24,
+        "num_heads": 16, "hidden_size": 1024, "vocab_size": 50257, "max_batch_size": 64, "max_beam_width": 4,
+        "max_input_len": 512, "max_seq_len": 1024, "max_num_tokens": 4096, "kv_cache_type": "paged", "quant_mode": 0
+    },
+    "plugin_config": {
+        "gpt_attention_plugin": "float16", "lora_plugin": null, "remove_input_padding": true, "paged_kv_cache": true,
+        "tokens_per_block": 64, "context_fmha": true, "use_paged_context_fmha": false
+    }
+})";
+
+std::array<char const*, 3> constexpr kConfigs{kLlamaConfig, kMedusaLoraConfig, kLegacyConfig};
+
+//! \brief Parse config range(0) from a string, as a process does on its first construction of an executor.
+void BM_Parse(benchmark::State& state)
+{
+    std::string const json = kConfigs.at(state.range(0));
+    for (auto _ : state)
+    {
+        auto const config = GptJsonConfig::parse(json);
+        benchmark::DoNotOptimize(config);
+    }
+}
+
+//! \brief Parse config range(0) from an unchanged file, as later constructions of executors and sessions do.
+void BM_ParseCachedFile(benchmark::State& state)
+{
+    auto const path = std::filesystem::temp_directory_path()
+        / ("gptJsonConfigBenchmark." + std::to_string(::getpid()) + "." + std::to_string(state.range(0)));
+    {
+        std::ofstream file(path);
+        file << kConfigs.at(state.range(0));
+    }
+    for (auto _ : state)
+    {
+        auto const config = GptJsonConfig::parse(path);
+        benchmark::DoNotOptimize(config);
+    }
+    std::filesystem::remove(path);
+}
+
+void configArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgName("config")->DenseRange(0, kConfigs.size() - 1)->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Parse)->Apply(configArgs);
+BENCHMARK(BM_ParseCachedFile)->Apply(configArgs);
+
+BENCHMARK_MAIN();
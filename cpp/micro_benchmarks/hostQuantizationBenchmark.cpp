@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaFp8Utils.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::kernels::cutlass_kernels;
+
+namespace
+{
+
+// The MLP up projection of a 7B model.
+auto constexpr kNumRows = 4096;
+auto constexpr kNumCols = 11008;
+
+std::vector<half> makeWeight(std::size_t numel)
+{
+    std::mt19937 generator{42};
+    std::normal_distribution<float> distribution{0.F, 0.02F};
+    std::vector<half> weight(numel);
+    for (auto& value : weight)
+    {
+        value = half(distribution(generator));
+    }
+    return weight;
+}
+
+//! \brief E4M3 quantization of an FP16 weight in host memory, with the mode range(0) on range(1) threads, as
+//! quantize_e4m3_* does for CPU tensors. Reports the bandwidth over the FP16 input.
+void BM_E4m3Quantize(benchmark::State& state)
+{
+    auto const mode = static_cast<QuantizeMode>(state.range(0));
+    auto const numThreads = static_cast<int>(state.range(1));
+    std::size_t const numel = std::size_t{kNumRows} * kNumCols;
+    auto const weight = makeWeight(numel);
+    std::vector<__nv_fp8_e4m3> quantized(numel);
+    std::vector<half> scales(mode == QuantizeMode::PER_TOKEN ? kNumRows : kNumCols);
+
+    for (auto _ : state)
+    {
+        computeScalesAndQuantizeMatrixHost(
+            quantized.data(), scales.data(), weight.data(), numel, kNumCols, mode, numThreads);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * numel * sizeof(half)));
+}
+
+//! \brief Weight-only quantization and preprocessing of an FP16 weight for the mixed-type GEMM, as
+//! symmetric_quantize_last_axis_of_batched_matrix does, for int8 and int4 (range(0) bits). Runs on all host threads.
+void BM_WeightOnlyQuantize(benchmark::State& state)
+{
+    auto const quantType = state.range(0) == 8 ? QuantType::W8_A16 : QuantType::W4_A16;
+    std::size_t const numel = std::size_t{kNumRows} * kNumCols;
+    auto const weight = makeWeight(numel);
+    std::vector<int8_t> processed(numel * get_weight_quant_bits(quantType) / 8);
+    std::vector<half> scales(kNumCols);
+    std::vector<std::size_t> const shape{kNumRows, kNumCols};
+
+    for (auto _ : state)
+    {
+        symmetric_quantize<half, half>(processed.data(), scales.data(), weight.data(), shape, quantType, false);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * numel * sizeof(half)));
+}
+
+} // namespace
+
+BENCHMARK(BM_E4m3Quantize)
+    ->ArgNames({"mode", "threads"})
+    ->ArgsProduct({{QuantizeMode::PER_TENSOR, QuantizeMode::PER_TOKEN, QuantizeMode::PER_CHANNEL}, {1, 4, 16}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_WeightOnlyQuantize)->ArgName("bits")->Arg(8)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/tllmBuffers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kPoolMiB = 2048;
+
+//! \brief Allocate and pin a pool chunk, as the pinned pool and the LoRA host cache do at startup.
+template <typename TAllocator>
+void allocatePinned(benchmark::State& state, TAllocator allocator)
+{
+    auto const size = static_cast<std::size_t>(state.range(0)) << 20;
+    for (auto _ : state)
+    {
+        auto* const ptr = allocator.allocate(size);
+        benchmark::DoNotOptimize(ptr);
+        allocator.deallocate(ptr, size);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+}
+
+void BM_PinnedAllocate(benchmark::State& state)
+{
+    allocatePinned(state, PinnedAllocator{});
+}
+
+void BM_HugePagePinnedAllocate(benchmark::State& state)
+{
+    allocatePinned(state, HugePagePinnedAllocator{});
+}
+
+//! \brief Copy blocks at random offsets of a host pool into a staging buffer, as offloading and onboarding KV cache
+//! blocks does. Every block touches new pages, so that small blocks are bound by TLB misses with 4 KB pages.
+template <typename TAllocator>
+void copyBlocks(benchmark::State& state, TAllocator allocator)
+{
+    auto const blockSize = static_cast<std::size_t>(state.range(0)) << 10;
+    auto constexpr poolSize = static_cast<std::size_t>(kPoolMiB) << 20;
+    auto const numBlocks = poolSize / blockSize;
+    auto* const pool = static_cast<std::uint8_t*>(allocator.allocate(poolSize));
+    std::memset(pool, 1, poolSize);
+    std::vector<std::uint8_t> staging(blockSize);
+
+    std::mt19937_64 generator{42};
+    std::uniform_int_distribution<std::size_t> distribution{0, numBlocks - 1};
+    for (auto _ : state)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            std::memcpy(staging.data(), pool + distribution(generator) * blockSize, blockSize);
+        }
+        benchmark::ClobberMemory();
+    }
+    allocator.deallocate(pool, poolSize);
+    state.SetItemsProcessed(state.iterations() * 64);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * 64 * blockSize));
+}
+
+void BM_HostBlockCopy(benchmark::State& state)
+{
+    copyBlocks(state, HostAllocator{});
+}
+
+void BM_HugePageHostBlockCopy(benchmark::State& state)
+{
+    copyBlocks(state, HugePageHostAllocator{});
+}
+
+} // namespace
+
+BENCHMARK(BM_PinnedAllocate)->ArgName("MiB")->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_HugePagePinnedAllocate)->ArgName("MiB")->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_HostBlockCopy)->ArgName("blockKiB")->Arg(4)->Arg(64)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_HugePageHostBlockCopy)->ArgName("blockKiB")->Arg(4)->Arg(64)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
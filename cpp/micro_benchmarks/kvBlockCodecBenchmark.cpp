@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvBlockCodec.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cuda_fp16.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+// 32 layers, 8 KV heads of 128 fp16 values, 64 tokens per block: 8 MiB per block.
+auto constexpr kNumLayers = 32;
+auto constexpr kNumKvHeads = 8;
+auto constexpr kTokensPerBlock = 64;
+auto constexpr kSizePerHead = 128;
+auto constexpr kSlabSize = kTokensPerBlock * kSizePerHead;
+
+KvBlockCodec makeCodec(benchmark::State const& state)
+{
+    return KvBlockCodec(nvinfer1::DataType::kHALF, kNumLayers, kNumKvHeads, kTokensPerBlock, kSizePerHead,
+        static_cast<KvBlockQuantization>(state.range(0)), state.range(1) != 0);
+}
+
+//! \brief Normal values with a few outliers, like K and V activations.
+std::vector<half> makeBlock(KvBlockCodec const& codec)
+{
+    std::vector<half> block(codec.getBlockSize() / sizeof(half));
+    std::mt19937 gen(42);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    for (std::size_t i = 0; i < block.size(); ++i)
+    {
+        block[i] = __float2half(dist(gen) * (i % 211 == 0 ? 6.f : 1.f));
+    }
+    return block;
+}
+
+//! \brief Relative L2 error of softmax(q K^T / sqrt(d)) V over the first head of every layer.
+double getAttentionError(std::vector<half> const& block, std::vector<half> const& decoded)
+{
+    std::mt19937 gen(7);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    std::vector<float> q(kSizePerHead);
+    double error = 0.;
+    double norm = 0.;
+    for (int layer = 0; layer < kNumLayers; ++layer)
+    {
+        std::generate(q.begin(), q.end(), [&]() { return dist(gen); });
+        auto const kOffset = static_cast<std::size_t>(layer) * 2 * kNumKvHeads * kSlabSize;
+        auto const vOffset = kOffset + static_cast<std::size_t>(kNumKvHeads) * kSlabSize;
+        auto attention = [&](std::vector<half> const& kv)
+        {
+            std::vector<float> weights(kTokensPerBlock);
+            for (int t = 0; t < kTokensPerBlock; ++t)
+            {
+                float dot = 0.f;
+                for (int d = 0; d < kSizePerHead; ++d)
+                {
+                    dot += q[d] * __half2float(kv[kOffset + t * kSizePerHead + d]);
+                }
+                weights[t] = dot / std::sqrt(static_cast<float>(kSizePerHead));
+            }
+            auto const maxWeight = *std::max_element(weights.begin(), weights.end());
+            float sum = 0.f;
+            for (auto& w : weights)
+            {
+                w = std::exp(w - maxWeight);
+                sum += w;
+            }
+            std::vector<float> out(kSizePerHead);
+            for (int t = 0; t < kTokensPerBlock; ++t)
+            {
+                for (int d = 0; d < kSizePerHead; ++d)
+                {
+                    out[d] += weights[t] / sum * __half2float(kv[vOffset + t * kSizePerHead + d]);
+                }
+            }
+            return out;
+        };
+        auto const expected = attention(block);
+        auto const actual = attention(decoded);
+        for (int d = 0; d < kSizePerHead; ++d)
+        {
+            error += (actual[d] - expected[d]) * (actual[d] - expected[d]);
+            norm += expected[d] * expected[d];
+        }
+    }
+    return std::sqrt(error / norm);
+}
+
+void BM_KvBlockEncode(benchmark::State& state)
+{
+    auto const codec = makeCodec(state);
+    auto const block = makeBlock(codec);
+    std::vector<std::uint8_t> encoded(codec.getEncodedSize());
+    for (auto _ : state)
+    {
+        codec.encode(block.data(), encoded.data());
+        benchmark::DoNotOptimize(encoded.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * codec.getBlockSize()));
+    state.counters["ratio"] = codec.getCompressionRatio();
+    state.counters["simd"] = codec.isSimd();
+}
+
+void BM_KvBlockDecode(benchmark::State& state)
+{
+    auto const codec = makeCodec(state);
+    auto const block = makeBlock(codec);
+    std::vector<std::uint8_t> encoded(codec.getEncodedSize());
+    codec.encode(block.data(), encoded.data());
+    std::vector<half> decoded(block.size());
+    for (auto _ : state)
+    {
+        codec.decode(encoded.data(), decoded.data());
+        benchmark::DoNotOptimize(decoded.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * codec.getBlockSize()));
+    state.counters["attnError"] = getAttentionError(block, decoded);
+    state.counters["simd"] = codec.isSimd();
+}
+
+} // namespace
+
+BENCHMARK(BM_KvBlockEncode)
+    ->ArgNames({"fp8", "simd"})
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_KvBlockDecode)
+    ->ArgNames({"fp8", "simd"})
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvCacheSnapshot.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+auto constexpr kNumBlocks = 64;
+auto constexpr kBlocksPerSequence = 8;
+
+//! \brief 32 layers of 8 KV heads of size 128 in half precision, 128 KiB per token.
+KvCacheSnapshotInfo makeInfo(SizeType32 tokensPerBlock)
+{
+    return KvCacheSnapshotInfo{"benchmark", nvinfer1::DataType::kHALF, 32, 8, 128, tokensPerBlock};
+}
+
+//! \brief The snapshot is created in TMPDIR, point it to the drive to measure.
+std::filesystem::path getPath()
+{
+    return std::filesystem::temp_directory_path() / ("kvCacheSnapshotBenchmark." + std::to_string(::getpid()));
+}
+
+//! \brief Sequences of kBlocksPerSequence blocks sharing their first block, one host buffer per block.
+KvCachePrefixTree makeTree(SizeType32 tokensPerBlock)
+{
+    KvCachePrefixTree tree;
+    auto parent = KvCachePrefixTree::kRoot;
+    for (SizeType32 block = 0; block < kNumBlocks; ++block)
+    {
+        if (block % kBlocksPerSequence == 0)
+        {
+            parent = block == 0 ? KvCachePrefixTree::kRoot : 0;
+        }
+        VecUniqueTokens tokens;
+        for (SizeType32 i = 0; i < tokensPerBlock; ++i)
+        {
+            tokens.push_back({(block * tokensPerBlock + i) % 32000, 0});
+        }
+        parent = tree.addBlock(parent, 0, std::move(tokens), block);
+    }
+    return tree;
+}
+
+void BM_SnapshotSave(benchmark::State& state)
+{
+    auto const info = makeInfo(static_cast<SizeType32>(state.range(0)));
+    auto const path = getPath();
+    auto const tree = makeTree(info.tokensPerBlock);
+    std::vector<std::vector<std::uint8_t>> pool(kNumBlocks, std::vector<std::uint8_t>(info.getBlockSize(), 1));
+
+    for (auto _ : state)
+    {
+        saveKvCacheSnapshot(path, info, tree, [&pool](SizeType32 blockId) { return pool[blockId].data(); });
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * kNumBlocks);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kNumBlocks * info.getBlockSize()));
+}
+
+void BM_SnapshotLoad(benchmark::State& state)
+{
+    auto const info = makeInfo(static_cast<SizeType32>(state.range(0)));
+    auto const path = getPath();
+    std::vector<std::vector<std::uint8_t>> pool(kNumBlocks, std::vector<std::uint8_t>(info.getBlockSize(), 1));
+    saveKvCacheSnapshot(
+        path, info, makeTree(info.tokensPerBlock), [&pool](SizeType32 blockId) { return pool[blockId].data(); });
+
+    for (auto _ : state)
+    {
+        SizeType32 numAllocated = 0;
+        auto const tree = loadKvCacheSnapshot(
+            path, info, [&numAllocated]() { return std::optional<SizeType32>{numAllocated++}; },
+            [&pool](SizeType32 blockId) { return pool[blockId].data(); });
+        benchmark::DoNotOptimize(tree.getNumBlocks());
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * kNumBlocks);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kNumBlocks * info.getBlockSize()));
+}
+
+} // namespace
+
+BENCHMARK(BM_SnapshotSave)->ArgName("tokensPerBlock")->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SnapshotLoad)->ArgName("tokensPerBlock")->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
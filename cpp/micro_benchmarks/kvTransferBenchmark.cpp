@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvTransferEngine.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+//! \brief 32 layers, 8 KV heads of 128 fp16 values, 64 tokens per block: 8 MiB per block.
+KvCacheLayout makeLayout(SizeType32 tpSize, SizeType32 tpRank)
+{
+    KvCacheLayout layout;
+    layout.numLayers = 32;
+    layout.numKvHeads = 8;
+    layout.sizePerHead = 128;
+    layout.tokensPerBlock = 64;
+    layout.elementSize = 2;
+    layout.tpSize = tpSize;
+    layout.tpRank = tpRank;
+    return layout;
+}
+
+enum class TransportType
+{
+    kSharedMemory = 0,
+    kTcp = 1,
+};
+
+std::pair<KvTransport::UniquePtr, KvTransport::UniquePtr> connect(TransportType type)
+{
+    if (type == TransportType::kSharedMemory)
+    {
+        auto const name = "/kvTransferBenchmark." + std::to_string(::getpid());
+        KvTransport::UniquePtr sender = SharedMemoryTransport::create(name);
+        return {std::move(sender), SharedMemoryTransport::open(name)};
+    }
+    TcpListener listener(0, "127.0.0.1");
+    KvTransport::UniquePtr receiver;
+    std::thread connector([&]() { receiver = TcpTransport::connect("127.0.0.1", listener.getPort()); });
+    KvTransport::UniquePtr sender = listener.accept();
+    connector.join();
+    return {std::move(sender), std::move(receiver)};
+}
+
+//! \brief Transfer the blocks of one request per iteration from a context rank to a generation rank with TP1. With
+//! context TP2 the generation rank receives half of its heads from the benchmarked context rank.
+void BM_KvTransfer(benchmark::State& state)
+{
+    auto const transportType = static_cast<TransportType>(state.range(0));
+    auto const contextTpSize = static_cast<SizeType32>(state.range(1));
+    auto const numBlocks = static_cast<std::size_t>(state.range(2));
+
+    auto const contextLayout = makeLayout(contextTpSize, 0);
+    auto const generationLayout = makeLayout(1, 0);
+    std::vector<std::vector<char>> contextBlocks(numBlocks, std::vector<char>(contextLayout.getBlockBytes(), 1));
+    std::vector<std::vector<char>> generationBlocks(numBlocks, std::vector<char>(generationLayout.getBlockBytes()));
+    std::vector<void const*> sendPointers;
+    std::vector<void*> recvPointers;
+    for (std::size_t i = 0; i < numBlocks; ++i)
+    {
+        sendPointers.push_back(contextBlocks[i].data());
+        recvPointers.push_back(generationBlocks[i].data());
+    }
+
+    auto const transports = connect(transportType);
+    // The benchmark loop runs exactly max_iterations times, serve as many requests.
+    std::thread sender(
+        [&]()
+        {
+            KvTransferEngine const engine(contextLayout);
+            for (benchmark::IterationCount i = 0; i < state.max_iterations; ++i)
+            {
+                engine.sendBlocks(*transports.first, i, sendPointers, 64 * numBlocks);
+            }
+        });
+
+    KvTransferEngine const engine(generationLayout);
+    benchmark::IterationCount requestId = 0;
+    std::size_t numBytes = 0;
+    for (auto _ : state)
+    {
+        auto const result = engine.receiveBlocks(*transports.second, requestId++, recvPointers);
+        numBytes += result.stats.numBytes;
+        benchmark::DoNotOptimize(generationBlocks.back().data());
+    }
+    sender.join();
+
+    state.SetBytesProcessed(static_cast<int64_t>(numBytes));
+    state.counters["MiBPerRequest"]
+        = static_cast<double>(numBytes) / static_cast<double>(std::max<benchmark::IterationCount>(requestId, 1) << 20);
+}
+
+} // namespace
+
+BENCHMARK(BM_KvTransfer)
+    ->ArgNames({"tcp", "ctxTp", "blocks"})
+    ->ArgsProduct({{0, 1}, {1, 2}, {1, 8}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/lora/loraSegments.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+auto constexpr kNumModules = 3;
+auto constexpr kNumAdapters = 4;
+auto constexpr kNumContextReqs = 8;
+auto constexpr kNumGenerationReqs = 64;
+
+//! \brief Per-request LoRA inputs of a step with kNumContextReqs context requests of range(1) tokens followed by
+//! kNumGenerationReqs generation requests, using kNumAdapters adapters round robin.
+struct LoraStep
+{
+    explicit LoraStep(int64_t contextLen)
+    {
+        auto const numReqs = kNumContextReqs + kNumGenerationReqs;
+        for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+        {
+            reqNumTokens.push_back(reqId < kNumContextReqs ? contextLen : 1);
+        }
+        for (int32_t moduleIdx = 0; moduleIdx < kNumModules; ++moduleIdx)
+        {
+            for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+            {
+                auto const adapter = reqId % kNumAdapters;
+                ranks[moduleIdx].push_back(8);
+                weightsPtrs[moduleIdx].push_back(0x10000 * (adapter * kNumModules + moduleIdx));
+                weightsPtrs[moduleIdx].push_back(0x10000 * (adapter * kNumModules + moduleIdx) + 0x8000);
+            }
+            ranksPtrs[moduleIdx] = ranks[moduleIdx].data();
+            moduleWeightsPtrs[moduleIdx] = weightsPtrs[moduleIdx].data();
+        }
+    }
+
+    std::vector<int64_t> reqNumTokens;
+    std::vector<int32_t> ranks[kNumModules];
+    std::vector<int64_t> weightsPtrs[kNumModules];
+    int32_t const* ranksPtrs[kNumModules];
+    int64_t const* moduleWeightsPtrs[kNumModules];
+};
+
+//! \brief Host work of the LoRA plugin for a step: range(0) = 0 expands the ranks and weights per token and merges
+//! contiguous tokens, as the plugin did before segments; 1 builds the segments per request; 2 also groups the tokens by
+//! adapter. Reports the number of GEMM problems of the step.
+void BM_LoraSegments(benchmark::State& state)
+{
+    auto const mode = state.range(0);
+    LoraStep const step{state.range(1)};
+    auto const numReqs = static_cast<int64_t>(step.reqNumTokens.size());
+    std::vector<int32_t> expandedRanks;
+    std::vector<void const*> expandedWeightsPtrs;
+    tk::LoraSegmentTable table;
+
+    for (auto _ : state)
+    {
+        if (mode == 0)
+        {
+            expandedRanks.clear();
+            expandedWeightsPtrs.clear();
+            for (int32_t moduleIdx = 0; moduleIdx < kNumModules; ++moduleIdx)
+            {
+                for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+                {
+                    for (int64_t tokenIdx = 0; tokenIdx < step.reqNumTokens[reqId]; ++tokenIdx)
+                    {
+                        expandedWeightsPtrs.push_back(
+                            reinterpret_cast<void const*>(step.weightsPtrs[moduleIdx][reqId * 2]));
+                        expandedWeightsPtrs.push_back(
+                            reinterpret_cast<void const*>(step.weightsPtrs[moduleIdx][reqId * 2 + 1]));
+                        expandedRanks.push_back(step.ranks[moduleIdx][reqId]);
+                    }
+                }
+            }
+            auto const numTokens = static_cast<int64_t>(expandedRanks.size()) / kNumModules;
+            table.buildFromTokens(kNumModules, numTokens, expandedRanks.data(), expandedWeightsPtrs.data());
+        }
+        else
+        {
+            table.build(kNumModules, numReqs, step.reqNumTokens.data(), step.ranksPtrs, step.moduleWeightsPtrs,
+                mode == 2);
+        }
+        benchmark::DoNotOptimize(table.getSegments(0).data());
+    }
+
+    int64_t numProblems = 0;
+    for (int32_t moduleIdx = 0; moduleIdx < kNumModules; ++moduleIdx)
+    {
+        numProblems += table.getNumProblems(moduleIdx);
+    }
+    state.counters["problems"] = numProblems;
+    state.counters["permutedTokens"] = table.getTokenPermutation().size();
+    state.SetItemsProcessed(state.iterations() * table.getNumTokens());
+}
+
+} // namespace
+
+BENCHMARK(BM_LoraSegments)
+    ->ArgNames({"mode", "contextLen"})
+    ->ArgsProduct({{0, 1, 2}, {128, 2048}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
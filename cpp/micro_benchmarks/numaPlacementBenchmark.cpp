@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/numaTopology.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+//! \brief Anonymous mapping whose pages are placed on a node when first touched.
+class NodeBuffer
+{
+public:
+    NodeBuffer(std::size_t size, SizeType32 node)
+        : mSize{size}
+        , mData{::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)}
+    {
+        if (mData == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        bindMemoryToNumaNode(mData, mSize, node);
+        std::memset(mData, 1, mSize);
+    }
+
+    ~NodeBuffer()
+    {
+        ::munmap(mData, mSize);
+    }
+
+    NodeBuffer(NodeBuffer const&) = delete;
+    NodeBuffer& operator=(NodeBuffer const&) = delete;
+
+    [[nodiscard]] void* data() const noexcept
+    {
+        return mData;
+    }
+
+private:
+    std::size_t mSize;
+    void* mData;
+};
+
+//! \brief Copy between buffers on memNode from a thread on the CPUs of cpuNode, as a host thread staging a copy to a
+//! device on memNode does.
+void BM_HostMemcpy(benchmark::State& state)
+{
+    auto const cpuNode = static_cast<SizeType32>(state.range(0));
+    auto const memNode = static_cast<SizeType32>(state.range(1));
+    auto const size = static_cast<std::size_t>(state.range(2)) << 20;
+    auto const& topology = NumaTopology::getInstance();
+
+    cpu_set_t previous;
+    ::sched_getaffinity(0, sizeof(previous), &previous);
+    if (!bindCurrentThreadToCpus(topology.getNodeCpus(cpuNode)))
+    {
+        state.SkipWithError("The CPUs of the node are not available");
+        return;
+    }
+    {
+        NodeBuffer const src(size, memNode);
+        NodeBuffer const dst(size, memNode);
+        for (auto _ : state)
+        {
+            std::memcpy(dst.data(), src.data(), size);
+            benchmark::ClobberMemory();
+        }
+    }
+    ::sched_setaffinity(0, sizeof(previous), &previous);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+}
+
+//! \brief Every pair of nodes with CPUs.
+void nodePairs(benchmark::internal::Benchmark* benchmark)
+{
+    auto const& topology = NumaTopology::getInstance();
+    for (SizeType32 cpuNode = 0; cpuNode < topology.getNumNodes(); ++cpuNode)
+    {
+        if (topology.getNodeCpus(cpuNode).empty())
+        {
+            continue;
+        }
+        for (SizeType32 memNode = 0; memNode < topology.getNumNodes(); ++memNode)
+        {
+            benchmark->Args({cpuNode, memNode, 256});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_HostMemcpy)
+    ->ArgNames({"cpuNode", "memNode", "MiB"})
+    ->Apply(nodePairs)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
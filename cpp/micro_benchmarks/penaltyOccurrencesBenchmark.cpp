@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/penaltyHost.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+auto constexpr kBatchSize = 8;
+auto constexpr kBeamWidth = 2;
+// Batch size of the reported workspace memory.
+auto constexpr kServingBatchSize = 256;
+
+//! \brief Apply the penalties of a beam search generation step to kBatchSize requests of range(2) tokens over a
+//! vocabulary of range(1) tokens, with dense occurrence counts (range(0) = 0) or sparse occurrence tables. Reports the
+//! occurrence workspace memory of kServingBatchSize requests, which is the same for both if the dense counts are
+//! smaller.
+void BM_PenaltyGenerationStep(benchmark::State& state)
+{
+    auto const sparse = state.range(0) != 0;
+    auto const vocabSize = static_cast<SizeType32>(state.range(1));
+    auto const maxSeqLen = static_cast<SizeType32>(state.range(2));
+    auto const inputLen = maxSeqLen - 1;
+    auto const capacity = sparse ? tk::getOccurrenceCapacity(maxSeqLen, vocabSize) : 0;
+    auto const workspaceSize = tk::getOccurrenceWorkspaceSize(capacity, vocabSize);
+
+    std::mt19937 generator{1234};
+    std::uniform_int_distribution<TokenIdType> tokens{0, vocabSize - 1};
+    std::vector<std::vector<TokenIdType>> outputIds(kBatchSize, std::vector<TokenIdType>(kBeamWidth * maxSeqLen));
+    std::vector<std::vector<SizeType32>> parentIds(kBatchSize, std::vector<SizeType32>(kBeamWidth * maxSeqLen, 0));
+    std::vector<TokenIdType const*> outputIdsPtr;
+    std::vector<SizeType32 const*> parentIdsPtr;
+    for (SizeType32 slot = 0; slot < kBatchSize; ++slot)
+    {
+        for (auto& token : outputIds[slot])
+        {
+            token = tokens(generator);
+        }
+        outputIdsPtr.push_back(outputIds[slot].data());
+        parentIdsPtr.push_back(parentIds[slot].data());
+    }
+    std::vector<float> logits(kBatchSize * kBeamWidth * vocabSize);
+    std::normal_distribution<float> logitValues{0.f, 3.f};
+    for (auto& logit : logits)
+    {
+        logit = logitValues(generator);
+    }
+    std::vector<float const*> logitsPtrs;
+    for (SizeType32 batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+    {
+        logitsPtrs.push_back(logits.data() + batchIdx * kBeamWidth * vocabSize);
+    }
+
+    std::vector<float> outputLogits(logits.size());
+    std::vector<TokenIdType> workspace(kBatchSize * kBeamWidth * workspaceSize);
+    std::vector<TokenIdType> workspacePrev(workspace.size());
+    std::vector<SizeType32> batchSlots(kBatchSize);
+    std::iota(batchSlots.begin(), batchSlots.end(), 0);
+    std::vector<float> const repetitionPenalties(kBatchSize, 1.2f);
+    std::vector<SizeType32> const inputLengths(kBatchSize * kBeamWidth, inputLen);
+    std::vector<SizeType32> sequenceLengths(kBatchSize * kBeamWidth, inputLen);
+
+    tk::InvokeBatchApplyPenaltyParams<float> params{};
+    params.inputLogits = logitsPtrs.data();
+    params.outputLogits = outputLogits.data();
+    params.repetitionPenalties = repetitionPenalties.data();
+    params.batchSize = kBatchSize;
+    params.beamWidth = kBeamWidth;
+    params.maxSeqLen = maxSeqLen;
+    params.vocabSize = vocabSize;
+    params.vocabSizePadded = vocabSize;
+    params.outputIdsPtr = outputIdsPtr.data();
+    params.parentIdsPtr = parentIdsPtr.data();
+    params.inputLengths = inputLengths.data();
+    params.sequenceLengths = sequenceLengths.data();
+    params.batchSlots = batchSlots.data();
+    params.maxTokensPerStep = 1;
+    params.occurrenceCapacity = capacity;
+
+    // Count the context, then apply the penalties of the first generated token, which copies the counts of the parent.
+    params.penaltyWorkspace = workspacePrev.data();
+    tk::invokeBatchApplyPenaltyHost(params);
+    std::fill(sequenceLengths.begin(), sequenceLengths.end(), inputLen + 1);
+    params.penaltyWorkspace = workspace.data();
+    params.penaltyWorkspacePrev = workspacePrev.data();
+    for (auto _ : state)
+    {
+        tk::invokeBatchApplyPenaltyHost(params);
+        benchmark::DoNotOptimize(outputLogits.data());
+        benchmark::ClobberMemory();
+    }
+
+    // Beam search keeps the workspace of the previous step.
+    auto const workspaceBytes = 2. * kServingBatchSize * kBeamWidth * workspaceSize * sizeof(TokenIdType);
+    state.counters["workspaceMiB"] = workspaceBytes / (1 << 20);
+    state.counters["sparse"] = capacity > 0;
+    state.SetItemsProcessed(state.iterations() * kBatchSize * kBeamWidth);
+}
+
+} // namespace
+
+BENCHMARK(BM_PenaltyGenerationStep)
+    ->ArgNames({"sparse", "vocab", "seqLen"})
+    ->ArgsProduct({{0, 1}, {32000, 128000, 256000}, {1024, 8192}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
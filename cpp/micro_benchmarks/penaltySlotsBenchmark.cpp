@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
+#include "tensorrt_llm/layers/penaltySlots.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::layers;
+using tensorrt_llm::kernels::DecodingPenaltyType;
+
+namespace
+{
+
+auto constexpr kMaxBatchSize = 256;
+auto constexpr kNumTypes = ActivePenaltySlots::kNumPenaltyTypes;
+// Probability that a request in flight finishes at a step.
+auto constexpr kFinishProbability = 0.02;
+
+//! \brief Decides which penalties each decoding step applies while requests churn through kMaxBatchSize slots, where
+//! range(1) per mille of the requests use a penalty of each type. range(0) = 0 keeps layer-lifetime flags set by the
+//! first request using a penalty and scans the values of the step, as the layer did before; range(0) = 1 keeps per-slot
+//! masks. Reports the fraction of steps which apply each penalty.
+void BM_PenaltyStep(benchmark::State& state)
+{
+    auto const perSlot = state.range(0) != 0;
+    std::bernoulli_distribution usesPenalty{state.range(1) / 1000.};
+    std::bernoulli_distribution finishes{kFinishProbability};
+    std::mt19937 generator{1234};
+
+    ActivePenaltySlots slots{kMaxBatchSize};
+    std::array<std::vector<float>, kNumTypes> values;
+    values.fill(std::vector<float>(kMaxBatchSize, DefaultDecodingParams::getRepetitionPenalty()));
+    std::array<bool, kNumTypes> stickyFlags{};
+    std::vector<bool> inFlight(kMaxBatchSize, false);
+    std::vector<SizeType32> batchSlots;
+    std::vector<SizeType32> newSlots;
+    SizeType32 numSteps = 0;
+    SizeType32 numPenaltySteps = 0;
+
+    for (auto _ : state)
+    {
+        // Add requests to the free slots and remove finished ones, then decode all requests in flight.
+        batchSlots.clear();
+        newSlots.clear();
+        for (SizeType32 slot = 0; slot < kMaxBatchSize; ++slot)
+        {
+            if (!inFlight[slot])
+            {
+                inFlight[slot] = true;
+                newSlots.push_back(slot);
+                for (auto& typeValues : values)
+                {
+                    typeValues[slot] = usesPenalty(generator) ? 1.2f : DefaultDecodingParams::getRepetitionPenalty();
+                }
+            }
+            else if (finishes(generator))
+            {
+                inFlight[slot] = false;
+                if (perSlot)
+                {
+                    slots.release(slot);
+                }
+                continue;
+            }
+            batchSlots.push_back(slot);
+        }
+
+        for (SizeType32 type = 0; type < kNumTypes; ++type)
+        {
+            auto const penaltyType = static_cast<DecodingPenaltyType>(type);
+            auto const& typeValues = values[type];
+            bool active = false;
+            if (perSlot)
+            {
+                slots.set(penaltyType, newSlots.data(), newSlots.size(), typeValues.data(),
+                    DefaultDecodingParams::getRepetitionPenalty());
+                active = slots.isActive(penaltyType, batchSlots.data(), batchSlots.size());
+            }
+            else
+            {
+                stickyFlags[type] |= std::any_of(newSlots.begin(), newSlots.end(),
+                    [&](SizeType32 slot) { return typeValues[slot] != DefaultDecodingParams::getRepetitionPenalty(); });
+                active = stickyFlags[type]
+                    && !std::all_of(batchSlots.begin(), batchSlots.end(), [&](SizeType32 slot)
+                        { return typeValues[slot] == DefaultDecodingParams::getRepetitionPenalty(); });
+            }
+            numPenaltySteps += active;
+            benchmark::DoNotOptimize(active);
+        }
+        ++numSteps;
+    }
+
+    state.counters["penaltyStepFraction"] = static_cast<double>(numPenaltySteps) / (numSteps * kNumTypes);
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_PenaltyStep)->ArgNames({"perSlot", "perMille"})->ArgsProduct({{0, 1}, {0, 1, 10, 100}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/executor/executor.h"
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <vector>
+
+namespace tb = tensorrt_llm::batch_manager;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+texec::VecTokens makePrompt(std::size_t promptLength)
+{
+    texec::VecTokens prompt(promptLength);
+    std::iota(prompt.begin(), prompt.end(), 0);
+    return prompt;
+}
+
+//! \brief Host side of enqueueing a request: building the executor::Request from a moved prompt and turning it into
+//! the LlmRequest the batch manager schedules.
+void BM_RequestIngestion(benchmark::State& state)
+{
+    auto const promptLength = static_cast<std::size_t>(state.range(0));
+    auto const beamWidth = static_cast<texec::SizeType32>(state.range(1));
+    auto const prompt = makePrompt(promptLength);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto inputTokens = prompt;
+        state.ResumeTiming();
+
+        texec::Request request(std::move(inputTokens), 128, false, texec::SamplingConfig(beamWidth));
+        tb::LlmRequest llmRequest(1, request);
+        benchmark::DoNotOptimize(llmRequest.getTokens(0).data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(promptLength));
+    state.counters["promptLength"] = static_cast<double>(promptLength);
+    state.counters["beamWidth"] = beamWidth;
+}
+
+//! \brief Reference: a single copy of the prompt, to express the ingestion cost in prompt copies.
+void BM_PromptCopy(benchmark::State& state)
+{
+    auto const promptLength = static_cast<std::size_t>(state.range(0));
+    auto const prompt = makePrompt(promptLength);
+    for (auto _ : state)
+    {
+        auto copy = prompt;
+        benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(promptLength));
+}
+
+} // namespace
+
+BENCHMARK(BM_RequestIngestion)
+    ->ArgNames({"promptLength", "beamWidth"})
+    ->ArgsProduct({{1024, 8192, 32768, 131072}, {1, 4}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_PromptCopy)
+    ->ArgNames({"promptLength"})
+    ->Arg(1024)
+    ->Arg(8192)
+    ->Arg(32768)
+    ->Arg(131072)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/requestLatency.h"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+auto constexpr kMaxNumRequests = 4096;
+//! Tokens streamed per request, each recorded as an event.
+auto constexpr kNumTokens = 64;
+//! Requests in flight that all threads record events of, above the ids of the requests of a single thread.
+auto constexpr kNumSharedRequests = 64;
+auto constexpr kSharedRequestIdBase = texec::IdType{1} << 48;
+
+using Clock = RequestLatencyBreakdown::Clock;
+
+//! \brief The straightforward alternative to the recorder: breakdowns in a map guarded by a mutex.
+class MutexRecorder
+{
+public:
+    void start(texec::IdType requestId, Clock::time_point arrival)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBreakdowns[requestId].arrival = arrival;
+    }
+
+    void onScheduled(texec::IdType requestId, Clock::time_point now)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const it = mBreakdowns.find(requestId);
+        if (it != mBreakdowns.end() && !it->second.firstScheduled)
+        {
+            it->second.firstScheduled = now - it->second.arrival;
+        }
+    }
+
+    void onToken(texec::IdType requestId, Clock::time_point now)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const it = mBreakdowns.find(requestId);
+        if (it == mBreakdowns.end())
+        {
+            return;
+        }
+        auto& breakdown = it->second;
+        if (!breakdown.firstToken)
+        {
+            breakdown.firstToken = now - breakdown.arrival;
+        }
+        breakdown.lastToken = now - breakdown.arrival;
+    }
+
+    std::optional<RequestLatencyBreakdown> finish(texec::IdType requestId, Clock::time_point)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto node = mBreakdowns.extract(requestId);
+        return node ? std::optional{node.mapped()} : std::nullopt;
+    }
+
+private:
+    std::mutex mMutex;
+    std::unordered_map<texec::IdType, RequestLatencyBreakdown> mBreakdowns;
+};
+
+RequestLatencyRecorder gRecorder{kMaxNumRequests};
+MutexRecorder gMutexRecorder;
+
+//! \brief Records the lifetime of one streaming request per iteration: arrival, scheduling, tokens and completion.
+//! The threads stand for the enqueuing, response and stats threads of several executors recording concurrently.
+void BM_RequestLatencyRecorder(benchmark::State& state)
+{
+    auto const numThreads = static_cast<texec::IdType>(state.threads());
+    auto requestId = static_cast<texec::IdType>(state.thread_index());
+    for (auto _ : state)
+    {
+        auto const now = Clock::now();
+        gRecorder.start(requestId, now);
+        gRecorder.onScheduled(requestId, now);
+        for (int i = 0; i < kNumTokens; ++i)
+        {
+            gRecorder.onToken(requestId, now + std::chrono::microseconds{i});
+        }
+        benchmark::DoNotOptimize(gRecorder.finish(requestId, now));
+        requestId += numThreads;
+    }
+    state.SetItemsProcessed(state.iterations() * (kNumTokens + 3));
+}
+
+void BM_RequestLatencyMutex(benchmark::State& state)
+{
+    auto const numThreads = static_cast<texec::IdType>(state.threads());
+    auto requestId = static_cast<texec::IdType>(state.thread_index());
+    for (auto _ : state)
+    {
+        auto const now = Clock::now();
+        gMutexRecorder.start(requestId, now);
+        gMutexRecorder.onScheduled(requestId, now);
+        for (int i = 0; i < kNumTokens; ++i)
+        {
+            gMutexRecorder.onToken(requestId, now + std::chrono::microseconds{i});
+        }
+        benchmark::DoNotOptimize(gMutexRecorder.finish(requestId, now));
+        requestId += numThreads;
+    }
+    state.SetItemsProcessed(state.iterations() * (kNumTokens + 3));
+}
+
+//! \brief Records the scheduling and tokens of a few requests in flight shared by all threads, like the response and
+//! stats threads of an executor, so that the threads contend on the same requests. Every 64 events of a request, the
+//! thread recording it replaces it with a new request and finishes it, racing with the other threads still recording
+//! events of the finished request.
+template <typename Recorder>
+void recordSharedRequests(benchmark::State& state, Recorder& recorder)
+{
+    static std::array<std::atomic<texec::IdType>, kNumSharedRequests> requestIds;
+    static std::atomic<texec::IdType> nextRequestId{kSharedRequestIdBase};
+    if (state.thread_index() == 0)
+    {
+        for (auto& requestId : requestIds)
+        {
+            requestId = nextRequestId++;
+            recorder.start(requestId, Clock::now());
+        }
+    }
+    auto const numThreads = static_cast<std::size_t>(state.threads());
+    auto index = static_cast<std::size_t>(state.thread_index());
+    for (auto _ : state)
+    {
+        auto& sharedRequestId = requestIds[index % kNumSharedRequests];
+        auto const now = Clock::now();
+        if (index / kNumSharedRequests % kNumTokens == kNumTokens - 1)
+        {
+            auto const requestId = nextRequestId++;
+            recorder.start(requestId, now);
+            benchmark::DoNotOptimize(recorder.finish(sharedRequestId.exchange(requestId), now));
+        }
+        else
+        {
+            auto const requestId = sharedRequestId.load();
+            recorder.onScheduled(requestId, now);
+            recorder.onToken(requestId, now);
+        }
+        index += numThreads;
+    }
+    if (state.thread_index() == 0)
+    {
+        for (auto const& requestId : requestIds)
+        {
+            recorder.finish(requestId, Clock::now());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_RequestLatencyRecorderShared(benchmark::State& state)
+{
+    recordSharedRequests(state, gRecorder);
+}
+
+void BM_RequestLatencyMutexShared(benchmark::State& state)
+{
+    recordSharedRequests(state, gMutexRecorder);
+}
+
+} // namespace
+
+BENCHMARK(BM_RequestLatencyRecorder)->ThreadRange(1, 16)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RequestLatencyMutex)->ThreadRange(1, 16)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RequestLatencyRecorderShared)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_RequestLatencyMutexShared)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/responseCache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+auto constexpr kNumPrompts = 1024;
+auto constexpr kOutputLength = 256;
+
+std::vector<texec::Request> makeRequests(int promptLength, bool streaming)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<texec::TokenIdType> token(0, 31999);
+    std::vector<texec::Request> requests;
+    requests.reserve(kNumPrompts);
+    for (int i = 0; i < kNumPrompts; ++i)
+    {
+        texec::VecTokens prompt(promptLength);
+        for (auto& t : prompt)
+        {
+            t = token(gen);
+        }
+        requests.emplace_back(std::move(prompt), kOutputLength, streaming);
+    }
+    return requests;
+}
+
+//! \brief The results the executor would have streamed: one token per response when streaming, else a single one.
+std::vector<texec::Result> makeResults(bool streaming)
+{
+    std::vector<texec::Result> results;
+    auto const numResults = streaming ? kOutputLength : 1;
+    for (int i = 0; i < numResults; ++i)
+    {
+        texec::Result result{};
+        result.isFinal = result.isSequenceFinal = i == numResults - 1;
+        result.outputTokenIds = {texec::VecTokens(streaming ? 1 : kOutputLength, i)};
+        result.finishReasons = {result.isFinal ? texec::FinishReason::kLENGTH : texec::FinishReason::kNOT_FINISHED};
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+//! \brief Serving repeated requests from the cache: computing the key of each request and replaying its responses.
+void BM_ResponseCacheHit(benchmark::State& state)
+{
+    auto const promptLength = static_cast<int>(state.range(0));
+    auto const streaming = state.range(1) != 0;
+    auto const requests = makeRequests(promptLength, streaming);
+    ResponseCache cache(std::size_t{4} << 30);
+    for (auto const& request : requests)
+    {
+        cache.insert(*ResponseCache::makeKey(request), makeResults(streaming));
+    }
+
+    std::size_t numResponses = 0;
+    texec::IdType requestId = 0;
+    for (auto _ : state)
+    {
+        for (auto const& request : requests)
+        {
+            auto const key = ResponseCache::makeKey(request);
+            auto const responses = cache.lookup(*key, ++requestId);
+            numResponses += responses->size();
+        }
+        benchmark::DoNotOptimize(numResponses);
+    }
+    state.SetItemsProcessed(state.iterations() * kNumPrompts);
+    state.counters["responsesPerRequest"] = static_cast<double>(numResponses) / (state.iterations() * kNumPrompts);
+}
+
+//! \brief Cost of computing the key alone, which misses also pay.
+void BM_ResponseCacheMakeKey(benchmark::State& state)
+{
+    auto const promptLength = static_cast<int>(state.range(0));
+    auto const requests = makeRequests(promptLength, false);
+    for (auto _ : state)
+    {
+        for (auto const& request : requests)
+        {
+            benchmark::DoNotOptimize(ResponseCache::makeKey(request));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumPrompts);
+}
+
+} // namespace
+
+BENCHMARK(BM_ResponseCacheHit)
+    ->ArgNames({"promptLength", "streaming"})
+    ->ArgsProduct({{128, 2048, 32768}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ResponseCacheMakeKey)
+    ->ArgNames({"promptLength"})
+    ->Arg(128)
+    ->Arg(2048)
+    ->Arg(32768)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
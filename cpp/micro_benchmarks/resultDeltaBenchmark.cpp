@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/resultDelta.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+auto constexpr kNumSteps = 4096;
+auto constexpr kReorderProbability = 0.05;
+
+//! \brief Streams a beam search of kNumSteps tokens with `returnAllGeneratedTokens`, one response per step, through
+//! the response delta encoder and decoder. Beams are occasionally replaced by a copy of a sibling, as beam search does.
+void BM_ResponseDeltaStream(benchmark::State& state)
+{
+    auto const enableDelta = state.range(0) != 0;
+    auto const beamWidth = static_cast<std::size_t>(state.range(1));
+    auto const withLogProbs = state.range(2) != 0;
+
+    std::size_t numBytes = 0;
+    std::size_t numStreamedTokens = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<texec::TokenIdType> token(0, 31999);
+        std::uniform_real_distribution<float> logProb(-10.f, 0.f);
+        std::bernoulli_distribution reorder(kReorderProbability);
+        texec::Result result{};
+        result.outputTokenIds.resize(beamWidth);
+        if (withLogProbs)
+        {
+            result.logProbs = std::vector<texec::VecLogProbs>(beamWidth);
+        }
+        ResponseDeltaEncoder encoder(enableDelta);
+        ResponseDeltaDecoder decoder;
+        state.ResumeTiming();
+
+        for (int step = 0; step < kNumSteps; ++step)
+        {
+            state.PauseTiming();
+            for (std::size_t beam = 0; beam < beamWidth; ++beam)
+            {
+                if (beamWidth > 1 && reorder(gen))
+                {
+                    auto const sibling = (beam + 1) % beamWidth;
+                    result.outputTokenIds[beam] = result.outputTokenIds[sibling];
+                    if (withLogProbs)
+                    {
+                        (*result.logProbs)[beam] = (*result.logProbs)[sibling];
+                    }
+                }
+                result.outputTokenIds[beam].push_back(token(gen));
+                if (withLogProbs)
+                {
+                    (*result.logProbs)[beam].push_back(logProb(gen));
+                }
+            }
+            result.isFinal = result.isSequenceFinal = step == kNumSteps - 1;
+            std::vector<texec::Response> responses;
+            responses.emplace_back(1, result);
+            state.ResumeTiming();
+
+            auto const buffer = encoder.encode(responses);
+            auto const decoded = decoder.decode(buffer);
+            benchmark::DoNotOptimize(decoded.data());
+            numBytes += buffer.size();
+            numStreamedTokens += beamWidth;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(numStreamedTokens));
+    state.SetBytesProcessed(static_cast<int64_t>(numBytes));
+    state.counters["bytesPerToken"] = static_cast<double>(numBytes) / static_cast<double>(numStreamedTokens);
+}
+
+} // namespace
+
+BENCHMARK(BM_ResponseDeltaStream)
+    ->ArgNames({"delta", "beamWidth", "logProbs"})
+    ->ArgsProduct({{0, 1}, {1, 4}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
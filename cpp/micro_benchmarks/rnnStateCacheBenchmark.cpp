@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/rnnStateCache.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/rnnStateBuffers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+// Roughly the states of Mamba-2.8B, of 16 of its layers.
+auto constexpr kNumLayers = 16;
+auto constexpr kNumSlots = 8;
+auto constexpr kStateSize = 16;
+auto constexpr kHiddenSize = 5120;
+auto constexpr kConvKernel = 4;
+auto constexpr kPrefixLength = 512;
+auto constexpr kSuffixLength = 64;
+auto constexpr kInterval = 128;
+auto constexpr kNumEntries = 64;
+
+//! \brief Paged state buffers on the device, as RnnStateBuffers allocates them.
+RnnStateBuffers makeBuffers(BufferManager const& manager)
+{
+    RnnStateBuffers buffers;
+    buffers.rnnStates = manager.gpu(
+        ITensor::makeShape({kNumLayers * kNumSlots, kStateSize, kHiddenSize}), nvinfer1::DataType::kFLOAT);
+    buffers.convStates = manager.gpu(
+        ITensor::makeShape({kNumLayers * kNumSlots, kConvKernel - 1, kHiddenSize}), nvinfer1::DataType::kHALF);
+    for (SizeType32 layer = 0; layer < kNumLayers; ++layer)
+    {
+        buffers.rnnState.push_back(ITensor::slice(buffers.rnnStates, layer * kNumSlots, kNumSlots));
+        buffers.convState.push_back(ITensor::slice(buffers.convStates, layer * kNumSlots, kNumSlots));
+    }
+    buffers.slotMappingHost = BufferManager::cpu(ITensor::makeShape({kNumSlots}), nvinfer1::DataType::kINT32);
+    auto* slotMapping = bufferCast<SizeType32>(*buffers.slotMappingHost);
+    for (SizeType32 b = 0; b < kNumSlots; ++b)
+    {
+        slotMapping[b] = b;
+    }
+    return buffers;
+}
+
+//! \brief Admit requests whose prompts start with one of range(0) system prompts, followed by a unique suffix. Each
+//! request restores the longest cached prefix, then stores the states at the checkpoints it prefills, as the batch
+//! manager does. Reports the fraction of prompt tokens whose prefill is skipped. range(1) is where the cache pool is.
+void BM_SharedPrefixAdmission(benchmark::State& state)
+{
+    auto const numPrefixes = static_cast<SizeType32>(state.range(0));
+    auto const memoryType = static_cast<MemoryType>(state.range(1));
+    BufferManager manager{std::make_shared<CudaStream>()};
+    auto buffers = makeBuffers(manager);
+    RnnStateCache cache{kNumEntries, kInterval, buffers, manager, memoryType};
+
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<SizeType32> prefixDistribution{0, numPrefixes - 1};
+    std::uniform_int_distribution<TokenIdType> tokenDistribution{0, 32000};
+    VecUniqueTokens prompt(kPrefixLength + kSuffixLength);
+
+    std::size_t numPromptTokens = 0;
+    SizeType32 batchIdx = 0;
+    for (auto _ : state)
+    {
+        auto const prefix = prefixDistribution(generator);
+        for (SizeType32 i = 0; i < kPrefixLength; ++i)
+        {
+            prompt[i] = UniqueToken{prefix * kPrefixLength + i, 0};
+        }
+        for (SizeType32 i = kPrefixLength; i < kPrefixLength + kSuffixLength; ++i)
+        {
+            prompt[i] = UniqueToken{tokenDistribution(generator), 0};
+        }
+
+        SizeType32 numCached = 0;
+        if (auto const match = cache.find(prompt))
+        {
+            cache.restore(*match, buffers, batchIdx);
+            numCached = match->numTokens;
+        }
+        for (auto numTokens = numCached + kInterval; numTokens <= kPrefixLength + kSuffixLength; numTokens += kInterval)
+        {
+            cache.store(prompt, numTokens, buffers, batchIdx);
+        }
+        numPromptTokens += prompt.size();
+        batchIdx = (batchIdx + 1) % kNumSlots;
+    }
+    manager.getStream().synchronize();
+
+    auto const& stats = cache.getStats();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["tokensSaved"] = static_cast<double>(stats.numTokensSaved) / static_cast<double>(numPromptTokens);
+    state.counters["hitRate"]
+        = static_cast<double>(stats.numHits) / static_cast<double>(stats.numHits + stats.numMisses);
+    state.counters["evictions"] = static_cast<double>(stats.numEvictions);
+}
+
+} // namespace
+
+BENCHMARK(BM_SharedPrefixAdmission)
+    ->ArgNames({"prefixes", "memoryType"})
+    ->ArgsProduct({{1, 8, 64}, {static_cast<int64_t>(MemoryType::kGPU), static_cast<int64_t>(MemoryType::kPINNED)}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/fusedSamplingConfigBuilder.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+//! \brief The config of request i of a batch that uses numDistinct distinct configs.
+SamplingConfig makeConfig(SizeType32 i, SizeType32 numDistinct)
+{
+    SamplingConfig config;
+    auto const variant = i % numDistinct;
+    config.temperature = std::vector<float>{0.7f};
+    config.topK = std::vector<SizeType32>{40 + variant};
+    config.topP = std::vector<float>{0.9f};
+    config.repetitionPenalty = std::vector<float>{1.1f};
+    config.randomSeed = std::vector<uint64_t>{static_cast<uint64_t>(variant)};
+    config.outputLogProbs = std::vector<bool>{false};
+    config.cumLogProbs = std::vector<bool>{false};
+    return config;
+}
+
+std::vector<SamplingConfig> makeConfigs(benchmark::State const& state)
+{
+    auto const batchSize = static_cast<SizeType32>(state.range(0));
+    auto const numDistinct = static_cast<SizeType32>(state.range(1));
+    std::vector<SamplingConfig> configs;
+    configs.reserve(batchSize);
+    for (SizeType32 i = 0; i < batchSize; ++i)
+    {
+        configs.push_back(makeConfig(i, numDistinct));
+    }
+    return configs;
+}
+
+//! \brief Fuse a batch of range(0) new requests with the constructor of SamplingConfig, as the decoder does.
+void BM_FuseValues(benchmark::State& state)
+{
+    auto const configs = makeConfigs(state);
+    for (auto _ : state)
+    {
+        auto fused = SamplingConfig(configs);
+        benchmark::DoNotOptimize(fused);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//! \brief Assign the new requests to their slots in the builder and fuse them.
+void BM_FusedSamplingConfigBuilder(benchmark::State& state)
+{
+    auto const configs = makeConfigs(state);
+    std::vector<SizeType32> slots(configs.size());
+    std::iota(slots.begin(), slots.end(), 0);
+    FusedSamplingConfigBuilder builder{static_cast<SizeType32>(configs.size())};
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < configs.size(); ++i)
+        {
+            builder.setSlot(slots[i], configs[i]);
+        }
+        auto fused = builder.fuse(slots);
+        benchmark::DoNotOptimize(fused);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["uniqueConfigs"] = builder.getNumUniqueConfigs();
+}
+
+void fusionArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"batch", "distinct"});
+    for (auto const batchSize : {8, 64, 256})
+    {
+        for (auto const numDistinct : {1, 4, batchSize})
+        {
+            benchmark->Args({batchSize, numDistinct});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_FuseValues)->Apply(fusionArgs);
+BENCHMARK(BM_FusedSamplingConfigBuilder)->Apply(fusionArgs);
+
+BENCHMARK_MAIN();
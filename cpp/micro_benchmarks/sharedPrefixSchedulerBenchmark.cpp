@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/sharedPrefixScheduler.h"
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tb = tensorrt_llm::batch_manager;
+
+namespace
+{
+
+using VecTokens = SharedPrefixScheduler::VecTokens;
+
+auto constexpr kTokensPerBlock = 64;
+auto constexpr kNumPrefixes = 8;
+auto constexpr kNumPrefixBlocks = 16;
+auto constexpr kNumUniqueTokens = 100;
+auto constexpr kNumBursts = 50;
+
+//! \brief Reuse tree of the block manager, as the set of the stored prefixes of whole blocks.
+class SimulatedBlockManager
+{
+public:
+    void storeContextBlocks(tb::LlmRequest const& request)
+    {
+        auto const& tokens = request.getTokens(0);
+        for (SizeType32 block = 1; block <= (request.mPromptLen - 1) / kTokensPerBlock; ++block)
+        {
+            mPrefixes.emplace(tokens.begin(), tokens.begin() + block * kTokensPerBlock);
+        }
+    }
+
+    SizeType32 numReusableBlocks(tb::LlmRequest const& request) const
+    {
+        auto const& tokens = request.getTokens(0);
+        SizeType32 numBlocks = 0;
+        while ((numBlocks + 1) * kTokensPerBlock < request.mPromptLen
+            && mPrefixes.count(VecTokens(tokens.begin(), tokens.begin() + (numBlocks + 1) * kTokensPerBlock)))
+        {
+            ++numBlocks;
+        }
+        return numBlocks;
+    }
+
+private:
+    std::set<VecTokens> mPrefixes;
+};
+
+struct SimulationResult
+{
+    std::int64_t numPrefillTokens{0};
+    std::int64_t numPromptTokens{0};
+    std::int64_t numDeferralRounds{0};
+    std::int64_t numRequests{0};
+};
+
+//! \brief Serve kNumBursts bursts of burstSize requests, each burst using a system prompt chosen among kNumPrefixes.
+//! Each scheduling round admits requests whose context phase completes within the round, storing their blocks for
+//! reuse. Without the scheduler every request of a burst is admitted in the round it arrives.
+SimulationResult simulate(bool dedup, int burstSize)
+{
+    std::mt19937 generator{1234};
+    std::uniform_int_distribution<int> prefixes{0, kNumPrefixes - 1};
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock};
+    auto const numReusableBlocks
+        = [&blockManager](tb::LlmRequest const& request) { return blockManager.numReusableBlocks(request); };
+
+    SimulationResult result;
+    SharedPrefixScheduler::RequestVector pending;
+    tb::LlmRequest::RequestIdType requestId = 0;
+    for (int round = 0; round < kNumBursts || !pending.empty(); ++round)
+    {
+        if (round < kNumBursts)
+        {
+            auto const prefix = prefixes(generator);
+            for (int i = 0; i < burstSize; ++i, ++requestId)
+            {
+                auto tokens = std::make_shared<VecTokens>(kNumPrefixBlocks * kTokensPerBlock + kNumUniqueTokens);
+                std::iota(tokens->begin(), tokens->begin() + kNumPrefixBlocks * kTokensPerBlock,
+                    prefix * kNumPrefixBlocks * kTokensPerBlock);
+                std::fill(tokens->begin() + kNumPrefixBlocks * kTokensPerBlock, tokens->end(),
+                    static_cast<tb::LlmRequest::TokenIdType>(1 << 20) + requestId);
+                pending.push_back(std::make_shared<tb::LlmRequest>(requestId, 8, tokens, SamplingConfig{1}, false));
+            }
+        }
+
+        SharedPrefixScheduler::RequestVector admitted;
+        if (dedup)
+        {
+            auto plan = scheduler.schedule(pending, numReusableBlocks);
+            admitted = std::move(plan.admitted);
+            result.numDeferralRounds += static_cast<std::int64_t>(plan.deferred.size());
+            pending = std::move(plan.deferred);
+        }
+        else
+        {
+            admitted = std::move(pending);
+            pending.clear();
+        }
+
+        // The admitted requests run their context phase together, so none reuses the blocks of another.
+        for (auto const& request : admitted)
+        {
+            auto const numReusable = numReusableBlocks(*request);
+            result.numPrefillTokens += request->mPromptLen - numReusable * kTokensPerBlock;
+            result.numPromptTokens += request->mPromptLen;
+            ++result.numRequests;
+        }
+        for (auto const& request : admitted)
+        {
+            blockManager.storeContextBlocks(*request);
+            scheduler.releaseLeader(request->mRequestId);
+        }
+    }
+    return result;
+}
+
+//! \brief Simulate bursts of range(1) requests sharing a system prompt, admitted all at once (range(0) = 0) or
+//! through the shared prefix scheduler (range(0) = 1). Reports the fraction of prompt tokens prefilled and the mean
+//! number of rounds a request was deferred.
+void BM_SharedPrefixSimulation(benchmark::State& state)
+{
+    auto const dedup = state.range(0) != 0;
+    auto const burstSize = static_cast<int>(state.range(1));
+    SimulationResult result{};
+    for (auto _ : state)
+    {
+        result = simulate(dedup, burstSize);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["prefillTokens"] = static_cast<double>(result.numPrefillTokens);
+    state.counters["prefillFraction"] = static_cast<double>(result.numPrefillTokens) / result.numPromptTokens;
+    state.counters["meanDeferralRounds"] = static_cast<double>(result.numDeferralRounds) / result.numRequests;
+    state.SetItemsProcessed(state.iterations() * result.numRequests);
+}
+
+} // namespace
+
+BENCHMARK(BM_SharedPrefixSimulation)
+    ->ArgNames({"dedup", "burst"})
+    ->ArgsProduct({{0, 1}, {2, 8, 32}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <benchmark/benchmark.h>
+
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+[[noreturn]] __attribute__((noinline)) void throwError(int64_t mode, int requestId)
+{
+    if (mode == 0)
+    {
+        throw NEW_TLLM_EXPECTED_EXCEPTION(tc::TllmErrorCode::kINVALID_ARGUMENT, "Invalid request %d", requestId);
+    }
+    TLLM_THROW("Invalid request %d", requestId);
+}
+
+//! \brief Throws and catches an invalid request error. range(0) = 0 throws an expected error without stack trace,
+//! 1 captures the stack trace and only reads the message, 2 also symbolizes the trace with what(), as any error did
+//! before the trace was symbolized lazily.
+void BM_ThrowCatch(benchmark::State& state)
+{
+    auto const mode = state.range(0);
+    int requestId = 0;
+    for (auto _ : state)
+    {
+        try
+        {
+            throwError(mode, requestId++);
+        }
+        catch (tc::TllmException const& e)
+        {
+            benchmark::DoNotOptimize(mode == 2 ? e.what() : e.getMessage());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_ThrowCatch)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaFp8Utils.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
+#include "tensorrt_llm/common/parallelUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tensorrt_llm
+{
+namespace common
+{
+#ifdef ENABLE_FP8
+
+namespace
+{
+
+// Elements per task of the element-wise loops, large enough to amortize the thread start.
+constexpr int64_t kGrainSize = 1 << 16;
+
+constexpr float kMinScalingFactor = 1.0f / (FP8_E4M3_MAX * 512.f);
+
+size_t resolveNumThreads(int num_threads)
+{
+    return num_threads > 0 ? static_cast<size_t>(num_threads) : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsToFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Round to nearest even with saturation to +-448, as cvt.rn.satfinite.e4m3x2.f32 and the __nv_fp8_e4m3 constructor.
+// The cases are selected with masks rather than branches, so that the quantization loops vectorize.
+inline uint8_t floatToE4m3(float value)
+{
+    constexpr uint32_t kMaxBits = 0x43E00000; // 448, every larger value saturates to it.
+    constexpr uint32_t kMinNormalBits = 121u << 23;
+    // Adding 2^14 to a value below the smallest normal rounds it to a multiple of the smallest subnormal, 2^-9.
+    constexpr uint32_t kDenormMagicBits = 141u << 23;
+
+    auto const bits = floatBits(value);
+    auto const sign = (bits >> 24) & 0x80;
+    auto const abs_bits = bits & 0x7FFFFFFF;
+    auto const clamped_bits = std::min(abs_bits, kMaxBits);
+
+    auto const denorm = floatBits(bitsToFloat(clamped_bits) + bitsToFloat(kDenormMagicBits)) - kDenormMagicBits;
+    auto const mantissa_odd = (clamped_bits >> 20) & 1;
+    auto const normal = (clamped_bits + (static_cast<uint32_t>(7 - 127) << 23) + 0x7FFFF + mantissa_odd) >> 20;
+
+    auto const denorm_mask = 0u - static_cast<uint32_t>(clamped_bits < kMinNormalBits);
+    auto const nan_mask = 0u - static_cast<uint32_t>(abs_bits > 0x7F800000);
+    auto const magnitude = (denorm & denorm_mask) | (normal & ~denorm_mask);
+    return static_cast<uint8_t>((magnitude & ~nan_mask) | (0x7F & nan_mask) | sign);
+}
+
+std::array<float, 256> makeE4m3Table()
+{
+    std::array<float, 256> table{};
+    for (int code = 0; code < 256; ++code)
+    {
+        int const exponent = (code >> 3) & 0xF;
+        int const mantissa = code & 0x7;
+        float value;
+        if (exponent == 0xF && mantissa == 0x7)
+        {
+            value = std::numeric_limits<float>::quiet_NaN();
+        }
+        else if (exponent == 0)
+        {
+            value = std::ldexp(static_cast<float>(mantissa), -9);
+        }
+        else
+        {
+            value = std::ldexp(static_cast<float>(8 + mantissa), exponent - 10);
+        }
+        table[code] = (code & 0x80) ? -value : value;
+    }
+    return table;
+}
+
+template <typename T_S>
+T_S computeScale(float amax)
+{
+    return static_cast<T_S>(std::max(amax / FP8_E4M3_MAX, kMinScalingFactor));
+}
+
+// The magnitudes of non-negative floats order like their bits, and integer maxima vectorize.
+template <typename T_IN>
+float absMax(T_IN const* input, int64_t size)
+{
+    uint32_t amax_bits = 0;
+    for (int64_t i = 0; i < size; ++i)
+    {
+        amax_bits = std::max(amax_bits, floatBits(static_cast<float>(input[i])) & 0x7FFFFFFF);
+    }
+    return bitsToFloat(amax_bits);
+}
+
+template <typename T_IN>
+void quantizeWithScale(uint8_t* output, T_IN const* input, int64_t size, float scale)
+{
+    for (int64_t i = 0; i < size; ++i)
+    {
+        output[i] = floatToE4m3(static_cast<float>(input[i]) / scale);
+    }
+}
+
+template <typename T_IN>
+void quantizeWithColumnScales(uint8_t* output, T_IN const* input, float const* scales, int64_t lda)
+{
+    for (int64_t i = 0; i < lda; ++i)
+    {
+        output[i] = floatToE4m3(static_cast<float>(input[i]) / scales[i]);
+    }
+}
+
+} // namespace
+
+template <typename T_OUT, typename T_S, typename T_IN>
+void computeScalesAndQuantizeMatrixHost(T_OUT* output, T_S* quant_ptr, const T_IN* input, const int64_t numel,
+    const int64_t lda, QuantizeMode quantize_mode, int num_threads)
+{
+    static_assert(std::is_same_v<T_OUT, __nv_fp8_e4m3>, "Only E4M3 quantization is supported");
+    TLLM_CHECK_WITH_INFO(lda > 0 && numel % lda == 0, "numel must be a multiple of lda");
+    auto* out = reinterpret_cast<uint8_t*>(output);
+    auto const threads = resolveNumThreads(num_threads);
+    auto const nrows = numel / lda;
+
+    if (quantize_mode == QuantizeMode::PER_TOKEN)
+    {
+        auto const rows_per_task = static_cast<size_t>(std::max<int64_t>(kGrainSize / lda, 1));
+        parallelFor(
+            nrows, rows_per_task,
+            [&](size_t begin, size_t end)
+            {
+                for (auto row = static_cast<int64_t>(begin); row < static_cast<int64_t>(end); ++row)
+                {
+                    auto const s = computeScale<T_S>(absMax(input + row * lda, lda));
+                    quant_ptr[row] = s;
+                    quantizeWithScale(out + row * lda, input + row * lda, lda, static_cast<float>(s));
+                }
+            },
+            threads);
+    }
+    else if (quantize_mode == QuantizeMode::PER_CHANNEL)
+    {
+        // Each task reduces a block of rows into its own column maxima, which are then merged.
+        auto const num_blocks = static_cast<size_t>(std::min<int64_t>(nrows, threads));
+        auto const rows_per_block = (nrows + num_blocks - 1) / num_blocks;
+        std::vector<float> block_max(num_blocks * lda, 0.f);
+        parallelFor(
+            num_blocks, 1,
+            [&](size_t begin, size_t end)
+            {
+                for (auto block = begin; block < end; ++block)
+                {
+                    float* col_max = block_max.data() + block * lda;
+                    auto const row_end = std::min<int64_t>((block + 1) * rows_per_block, nrows);
+                    for (int64_t row = block * rows_per_block; row < row_end; ++row)
+                    {
+                        T_IN const* in = input + row * lda;
+                        for (int64_t col = 0; col < lda; ++col)
+                        {
+                            col_max[col] = std::max(col_max[col], std::fabs(static_cast<float>(in[col])));
+                        }
+                    }
+                }
+            },
+            threads);
+
+        std::vector<float> scales(lda);
+        for (int64_t col = 0; col < lda; ++col)
+        {
+            float amax = 0.f;
+            for (size_t block = 0; block < num_blocks; ++block)
+            {
+                amax = std::max(amax, block_max[block * lda + col]);
+            }
+            auto const s = computeScale<T_S>(amax);
+            quant_ptr[col] = s;
+            scales[col] = static_cast<float>(s);
+        }
+
+        auto const rows_per_task = static_cast<size_t>(std::max<int64_t>(kGrainSize / lda, 1));
+        parallelFor(
+            nrows, rows_per_task,
+            [&](size_t begin, size_t end)
+            {
+                for (auto row = static_cast<int64_t>(begin); row < static_cast<int64_t>(end); ++row)
+                {
+                    quantizeWithColumnScales(out + row * lda, input + row * lda, scales.data(), lda);
+                }
+            },
+            threads);
+    }
+    else if (quantize_mode == QuantizeMode::PER_TENSOR)
+    {
+        auto const num_chunks = static_cast<size_t>((numel + kGrainSize - 1) / kGrainSize);
+        std::vector<float> chunk_max(num_chunks);
+        parallelFor(
+            num_chunks, 1,
+            [&](size_t begin, size_t end)
+            {
+                for (auto chunk = begin; chunk < end; ++chunk)
+                {
+                    auto const offset = static_cast<int64_t>(chunk) * kGrainSize;
+                    chunk_max[chunk] = absMax(input + offset, std::min(kGrainSize, numel - offset));
+                }
+            },
+            threads);
+
+        auto const s = computeScale<T_S>(*std::max_element(chunk_max.begin(), chunk_max.end()));
+        quant_ptr[0] = s;
+        parallelFor(
+            num_chunks, 1,
+            [&](size_t begin, size_t end)
+            {
+                auto const offset = static_cast<int64_t>(begin) * kGrainSize;
+                auto const size = std::min(static_cast<int64_t>(end) * kGrainSize, numel) - offset;
+                quantizeWithScale(out + offset, input + offset, size, static_cast<float>(s));
+            },
+            threads);
+    }
+    else
+    {
+        TLLM_THROW("Unsupported quantize mode");
+    }
+}
+
+template <typename T_OUT, typename T_S, typename T_IN>
+void dequantizeMatrixHost(T_OUT* output, T_S const* input_scale, T_IN const* input, int64_t numel, int64_t lda,
+    QuantizeMode quantize_mode, int num_threads)
+{
+    static_assert(std::is_same_v<T_IN, __nv_fp8_e4m3>, "Only E4M3 dequantization is supported");
+    TLLM_CHECK_WITH_INFO(lda > 0 && numel % lda == 0, "numel must be a multiple of lda");
+    static std::array<float, 256> const e4m3_table = makeE4m3Table();
+    auto const* in = reinterpret_cast<uint8_t const*>(input);
+
+    parallelFor(
+        static_cast<size_t>(numel), kGrainSize,
+        [&](size_t begin, size_t end)
+        {
+            for (auto i = static_cast<int64_t>(begin); i < static_cast<int64_t>(end); ++i)
+            {
+                auto const scale_idx = quantize_mode == QuantizeMode::PER_CHANNEL ? i % lda
+                    : quantize_mode == QuantizeMode::PER_TOKEN                    ? i / lda
+                                                                                  : 0;
+                output[i] = static_cast<T_OUT>(e4m3_table[in[i]] * static_cast<float>(input_scale[scale_idx]));
+            }
+        },
+        resolveNumThreads(num_threads));
+}
+
+#define DEFINE_QUANTIZE_MATRIX_HOST(type_scale, type_in)                                                              \
+    template void computeScalesAndQuantizeMatrixHost<__nv_fp8_e4m3, type_scale, type_in>(__nv_fp8_e4m3 * output,      \
+        type_scale * quant_ptr, type_in const* input, int64_t numel, int64_t lda, QuantizeMode quantize_mode,          \
+        int num_threads);                                                                                              \
+    template void dequantizeMatrixHost<type_in, type_scale, __nv_fp8_e4m3>(type_in * output,                           \
+        type_scale const* input_scale, __nv_fp8_e4m3 const* input, int64_t numel, int64_t lda,                         \
+        QuantizeMode quantize_mode, int num_threads);
+
+DEFINE_QUANTIZE_MATRIX_HOST(float, float);
+DEFINE_QUANTIZE_MATRIX_HOST(half, half);
+#ifdef ENABLE_BF16
+DEFINE_QUANTIZE_MATRIX_HOST(__nv_bfloat16, __nv_bfloat16);
+#endif
+
+#endif // ENABLE_FP8
+} // namespace common
+} // namespace tensorrt_llm
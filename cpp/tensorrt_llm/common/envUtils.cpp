@@ -157,4 +157,30 @@ bool getEnvEnablePDL()
     return enablePDL;
 }
 
+std::optional<std::string> getEnvAllReduceStrategyTable()
+{
+    char const* const path = std::getenv("TRTLLM_ALLREDUCE_STRATEGY_TABLE");
+    if (path == nullptr || path[0] == '\0')
+    {
+        return std::nullopt;
+    }
+    return std::string{path};
+}
+
+bool getEnvLoraHostCacheHugePages()
+{
+    // Not cached, a cache reads it once when it is initialized.
+    return getIntEnv("TRTLLM_LORA_HOST_CACHE_HUGE_PAGES").value_or(0) != 0;
+}
+
+bool getEnvDisableNumaAffinity()
+{
+    static bool const disableNumaAffinity = []()
+    {
+        char const* const env = std::getenv("TRTLLM_DISABLE_NUMA_AFFINITY");
+        return env != nullptr && env[0] == '1' && env[1] == '\0';
+    }();
+    return disableNumaAffinity;
+}
+
 } // namespace tensorrt_llm::common
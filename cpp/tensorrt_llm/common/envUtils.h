@@ -18,6 +18,7 @@
 #pragma once
 #include <cstdint>
 #include <optional>
+#include <string>
 
 namespace tensorrt_llm::common
 {
@@ -40,4 +41,13 @@ int getEnvMmhaKernelBlockSize();
 // Whether PDL is enabled.
 bool getEnvEnablePDL();
 
+// Path of the calibrated all-reduce strategy table, from the TRTLLM_ALLREDUCE_STRATEGY_TABLE env var.
+std::optional<std::string> getEnvAllReduceStrategyTable();
+
+// Whether the LoRA host cache backs its page blocks with huge pages, from TRTLLM_LORA_HOST_CACHE_HUGE_PAGES.
+bool getEnvLoraHostCacheHugePages();
+
+// Whether threads are left unpinned from the NUMA node of their GPU, from the TRTLLM_DISABLE_NUMA_AFFINITY env var.
+bool getEnvDisableNumaAffinity();
+
 } // namespace tensorrt_llm::common
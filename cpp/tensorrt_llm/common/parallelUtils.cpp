@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/parallelUtils.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+
+// The tasks of one runOnHostThreads call. The calling thread and the workers helping it claim tasks by index.
+struct TaskGroup
+{
+    TaskGroup(std::size_t numTasks, std::function<void(std::size_t)> const& task)
+        : numTasks{numTasks}
+        , task{task}
+    {
+    }
+
+    // Runs claimed tasks until none is left. A worker that claims nothing never touches task, which may be gone by
+    // then, since the caller returns as soon as all tasks are done.
+    void runClaimed()
+    {
+        for (auto index = nextTask.fetch_add(1); index < numTasks; index = nextTask.fetch_add(1))
+        {
+            task(index);
+            if (numDone.fetch_add(1) + 1 == numTasks)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                allDone.notify_all();
+            }
+        }
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return numDone.load() == numTasks; });
+    }
+
+    std::size_t const numTasks;
+    std::function<void(std::size_t)> const& task;
+    std::atomic<std::size_t> nextTask{0};
+    std::atomic<std::size_t> numDone{0};
+    std::mutex mutex;
+    std::condition_variable allDone;
+};
+
+// One worker per hardware thread besides the calling one, started on first use and kept for the process lifetime.
+class HostWorkerPool
+{
+public:
+    static HostWorkerPool& getInstance()
+    {
+        static HostWorkerPool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+        return pool;
+    }
+
+    explicit HostWorkerPool(std::size_t numWorkers)
+    {
+        mWorkers.reserve(numWorkers);
+        for (std::size_t i = 0; i < numWorkers; ++i)
+        {
+            mWorkers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~HostWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWorkAvailable.notify_all();
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+    }
+
+    [[nodiscard]] std::size_t getNumWorkers() const
+    {
+        return mWorkers.size();
+    }
+
+    // Asks numHelpers workers to help with the group.
+    void submit(std::shared_ptr<TaskGroup> const& group, std::size_t numHelpers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mGroups.insert(mGroups.end(), numHelpers, group);
+        }
+        for (std::size_t i = 0; i < numHelpers; ++i)
+        {
+            mWorkAvailable.notify_one();
+        }
+    }
+
+private:
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::shared_ptr<TaskGroup> group;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkAvailable.wait(lock, [this] { return mStop || !mGroups.empty(); });
+                if (mGroups.empty())
+                {
+                    return;
+                }
+                group = std::move(mGroups.front());
+                mGroups.pop_front();
+            }
+            group->runClaimed();
+        }
+    }
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::deque<std::shared_ptr<TaskGroup>> mGroups;
+    bool mStop{false};
+};
+
+} // namespace
+
+void runOnHostThreads(std::size_t numTasks, std::function<void(std::size_t)> const& task)
+{
+    if (numTasks == 0)
+    {
+        return;
+    }
+    auto& pool = HostWorkerPool::getInstance();
+    auto const group = std::make_shared<TaskGroup>(numTasks, task);
+    auto const numHelpers = std::min(numTasks - 1, pool.getNumWorkers());
+    if (numHelpers > 0)
+    {
+        pool.submit(group, numHelpers);
+    }
+    group->runClaimed();
+    group->wait();
+}
+
+} // namespace tensorrt_llm::common
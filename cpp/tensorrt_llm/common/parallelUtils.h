@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+// Calls task(0), ..., task(numTasks - 1) on the calling thread and on the host worker threads shared by the process,
+// and returns once all tasks are done. The workers are started on first use and only help, so the calling thread runs
+// every task no worker picks up, and calls from within a task cannot deadlock. task must not throw.
+void runOnHostThreads(std::size_t numTasks, std::function<void(std::size_t)> const& task);
+
+// Splits [0, numItems) into contiguous ranges of at least grainSize items and calls func(begin, end) for each range,
+// using up to numThreads threads including the calling one. numThreads = 0 uses all hardware threads. The ranges are
+// processed concurrently on the shared host worker threads, so func must only write to the items of its range. The
+// first exception thrown by func is rethrown once all ranges are done.
+template <typename Func>
+void parallelFor(std::size_t numItems, std::size_t grainSize, Func const& func, std::size_t numThreads = 0)
+{
+    if (numItems == 0)
+    {
+        return;
+    }
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    grainSize = std::max(grainSize, std::size_t{1});
+    auto const numRanges = std::min(numThreads, (numItems + grainSize - 1) / grainSize);
+    if (numRanges <= 1)
+    {
+        func(std::size_t{0}, numItems);
+        return;
+    }
+
+    auto const itemsPerRange = (numItems + numRanges - 1) / numRanges;
+    std::vector<std::exception_ptr> errors(numRanges);
+    runOnHostThreads(numRanges,
+        [&](std::size_t range)
+        {
+            auto const begin = range * itemsPerRange;
+            auto const end = std::min(begin + itemsPerRange, numItems);
+            try
+            {
+                if (begin < end)
+                {
+                    func(begin, end);
+                }
+            }
+            catch (...)
+            {
+                errors[range] = std::current_exception();
+            }
+        });
+    for (auto const& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace tensorrt_llm::common
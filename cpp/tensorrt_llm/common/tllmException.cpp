@@ -17,13 +17,16 @@
 #include "tensorrt_llm/common/tllmException.h"
 #include "tensorrt_llm/common/stringUtils.h"
 
+#include <atomic>
 #include <cstdlib>
 #if !defined(_MSC_VER)
 #include <cxxabi.h>
 #include <dlfcn.h>
 #include <execinfo.h>
 #endif
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 namespace tensorrt_llm::common
 {
@@ -31,29 +34,215 @@ namespace tensorrt_llm::common
 namespace
 {
 int constexpr VOID_PTR_SZ = 2 + sizeof(void*) * 2;
-}
+
+struct SymbolizedTrace
+{
+    //! Message of the exception when it was symbolized, which changes if another exception is assigned to it.
+    char const* message{nullptr};
+    std::string trace;
+    std::string what;
+};
+
+//! \brief Symbolized traces of the live exceptions, keyed by exception. Each exception drops its entry when destroyed,
+//! and copies symbolize their own trace, so what() stays valid for the lifetime of the exception.
+class SymbolizedTraces
+{
+public:
+    static SymbolizedTraces& getInstance()
+    {
+        // Never destroyed, since exceptions may outlive static destruction.
+        static auto* instance = new SymbolizedTraces;
+        return *instance;
+    }
+
+    template <typename Symbolize>
+    SymbolizedTrace const& get(TllmException const* exception, Symbolize const& symbolize)
+    {
+        auto const* message = exception->getMessage();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto const it = mTraces.find(exception);
+            if (it != mTraces.end() && it->second.message == message)
+            {
+                return it->second;
+            }
+        }
+        // Symbolize without the lock, other exceptions do not wait for it.
+        auto trace = symbolize();
+        auto what = fmtstr("%s\n%s", message, trace.c_str());
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& entry = mTraces[exception];
+        if (entry.message != message)
+        {
+            entry = SymbolizedTrace{message, std::move(trace), std::move(what)};
+        }
+        mNumTraces.store(mTraces.size(), std::memory_order_relaxed);
+        return entry;
+    }
+
+    void erase(TllmException const* exception) noexcept
+    {
+        // Most exceptions are never symbolized, they do not take the lock.
+        if (mNumTraces.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTraces.erase(exception);
+        mNumTraces.store(mTraces.size(), std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex mMutex;
+    // Entries are nodes, so references to them stay valid as others are added.
+    std::unordered_map<TllmException const*, SymbolizedTrace> mTraces;
+    std::atomic<std::size_t> mNumTraces{0};
+};
+
+//! \brief Error codes of the live exceptions, keyed by exception. Only codes other than kUNKNOWN are stored, and each
+//! exception drops its entry when destroyed.
+class ErrorCodes
+{
+public:
+    static ErrorCodes& getInstance()
+    {
+        // Never destroyed, since exceptions may outlive static destruction.
+        static auto* instance = new ErrorCodes;
+        return *instance;
+    }
+
+    void set(TllmException const* exception, TllmErrorCode errorCode)
+    {
+        if (errorCode == TllmErrorCode::kUNKNOWN)
+        {
+            erase(exception);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCodes[exception] = errorCode;
+        mNumCodes.store(mCodes.size(), std::memory_order_relaxed);
+    }
+
+    TllmErrorCode get(TllmException const* exception) noexcept
+    {
+        if (mNumCodes.load(std::memory_order_relaxed) == 0)
+        {
+            return TllmErrorCode::kUNKNOWN;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const it = mCodes.find(exception);
+        return it != mCodes.end() ? it->second : TllmErrorCode::kUNKNOWN;
+    }
+
+    void erase(TllmException const* exception) noexcept
+    {
+        // Most exceptions have no error code, they do not take the lock.
+        if (mNumCodes.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCodes.erase(exception);
+        mNumCodes.store(mCodes.size(), std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex mMutex;
+    std::unordered_map<TllmException const*, TllmErrorCode> mCodes;
+    std::atomic<std::size_t> mNumCodes{0};
+};
+
+} // namespace
 
 #if !defined(_MSC_VER)
 
+// Only the frame addresses are captured here, symbolization is deferred to what() or getTrace().
 TllmException::TllmException(char const* file, std::size_t line, std::string const& msg)
-    : std::runtime_error{""}
+    : std::runtime_error{fmtstr("%s (%s:%zu)", msg.c_str(), file, line)}
 {
     mNbFrames = backtrace(mCallstack.data(), MAX_FRAMES);
-    auto const trace = getTrace();
-    std::runtime_error::operator=(
-        std::runtime_error{fmtstr("%s (%s:%zu)\n%s", msg.c_str(), file, line, trace.c_str())});
+}
+
+TllmException::TllmException(
+    char const* file, std::size_t line, std::string const& msg, TllmErrorCode errorCode, bool captureTrace)
+    : std::runtime_error{fmtstr("%s (%s:%zu)", msg.c_str(), file, line)}
+    , mNbFrames{}
+{
+    if (captureTrace)
+    {
+        mNbFrames = backtrace(mCallstack.data(), MAX_FRAMES);
+    }
+    ErrorCodes::getInstance().set(this, errorCode);
 }
 #else
 TllmException::TllmException(char const* file, std::size_t line, std::string const& msg)
-    : mNbFrames{}
-    , std::runtime_error{fmtstr("%s (%s:%zu)", msg.c_str(), file, line)}
+    : TllmException{file, line, msg, TllmErrorCode::kUNKNOWN}
 {
 }
+
+TllmException::TllmException(
+    char const* file, std::size_t line, std::string const& msg, TllmErrorCode errorCode, bool /*captureTrace*/)
+    : std::runtime_error{fmtstr("%s (%s:%zu)", msg.c_str(), file, line)}
+    , mNbFrames{}
+{
+    ErrorCodes::getInstance().set(this, errorCode);
+}
 #endif
 
-TllmException::~TllmException() noexcept = default;
+TllmException::TllmException(TllmException const& other)
+    : std::runtime_error{other}
+    , mCallstack{other.mCallstack}
+    , mNbFrames{other.mNbFrames}
+{
+    ErrorCodes::getInstance().set(this, other.getErrorCode());
+}
+
+TllmException& TllmException::operator=(TllmException const& other)
+{
+    std::runtime_error::operator=(other);
+    mCallstack = other.mCallstack;
+    mNbFrames = other.mNbFrames;
+    ErrorCodes::getInstance().set(this, other.getErrorCode());
+    return *this;
+}
+
+TllmException::~TllmException() noexcept
+{
+    ErrorCodes::getInstance().erase(this);
+    SymbolizedTraces::getInstance().erase(this);
+}
+
+char const* TllmException::what() const noexcept
+{
+    if (mNbFrames <= 1)
+    {
+        return getMessage();
+    }
+    try
+    {
+        return SymbolizedTraces::getInstance().get(this, [this] { return symbolize(); }).what.c_str();
+    }
+    catch (...)
+    {
+        return getMessage();
+    }
+}
+
+TllmErrorCode TllmException::getErrorCode() const noexcept
+{
+    return ErrorCodes::getInstance().get(this);
+}
 
 std::string TllmException::getTrace() const
+{
+    if (mNbFrames <= 1)
+    {
+        return {};
+    }
+    return SymbolizedTraces::getInstance().get(this, [this] { return symbolize(); }).trace;
+}
+
+std::string TllmException::symbolize() const
 {
 #if defined(_MSC_VER)
     return "";
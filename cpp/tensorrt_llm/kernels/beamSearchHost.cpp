@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/beamSearchHost.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/parallelUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+// Number of token positions a task should cover to be worth a thread.
+constexpr std::size_t kGrainSize = 1 << 16;
+
+constexpr float kMaxFloat = std::numeric_limits<float>::max();
+
+// Calls func(request) for the numRequests requests, each touching about workPerRequest token positions.
+template <typename Func>
+void forEachRequest(SizeType32 numRequests, std::size_t workPerRequest, SizeType32 numThreads, Func const& func)
+{
+    TLLM_CHECK_WITH_INFO(numThreads >= 0, "Number of threads must not be negative");
+    common::parallelFor(
+        numRequests, kGrainSize / std::max(workPerRequest, std::size_t{1}),
+        [&func](std::size_t begin, std::size_t end)
+        {
+            for (auto request = begin; request < end; ++request)
+            {
+                func(static_cast<SizeType32>(request));
+            }
+        },
+        numThreads);
+}
+
+// The indices of the beams in the order of decreasing scores, the lower index first among equal scores.
+std::vector<SizeType32> rankByScore(float const* scores, SizeType32 numBeams, SizeType32 numRanked)
+{
+    std::vector<SizeType32> ranks(numBeams);
+    std::iota(ranks.begin(), ranks.end(), 0);
+    std::partial_sort(ranks.begin(), ranks.begin() + numRanked, ranks.end(),
+        [scores](SizeType32 a, SizeType32 b) { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); });
+    ranks.resize(numRanked);
+    return ranks;
+}
+
+void selectBeams(TokenIdType const* candidateIds, float const* candidateLogProbs, BeamHypotheses& bh, SizeType32 bid)
+{
+    auto const slot = bh.batchSlots != nullptr ? bh.batchSlots[bid] : bid;
+    SizeType32 const nMBS{bh.nMaxBatchSize}; // Only for bh.logProbsTiled
+    SizeType32 const nBM{bh.nBeamWidth};
+    SizeType32 const nMSL{bh.nMaxSeqLen};
+    SizeType32 const nCandidate{nBM * nBM * 2};
+    SizeType32 const nV{bh.nVocabSize};
+    float const diversityRate{bh.diversityRates[slot]};
+    float const lengthPenalty{bh.lengthPenalties[slot]};
+    SizeType32 const earlyStopping{bh.earlyStoppings[slot]};
+    bool const useCBA{bh.numBeamsCBA != nullptr};
+
+    if (useCBA)
+    {
+        if (bh.numBeamsCBA[slot] == 0)
+        {
+            bh.minNormedScoresCBA[slot] = kMaxFloat;
+        }
+        else if ((earlyStopping == 1 && bh.numBeamsCBA[slot] == nBM)
+            || (earlyStopping != 1 && bh.finished[slot * nBM].isFinished()))
+        {
+            return;
+        }
+    }
+
+    auto const* ids = candidateIds + bid * nCandidate;
+    auto const* logProbs = candidateLogProbs + bid * nCandidate;
+    std::vector<float> const cumLogProbs(bh.cumLogProbs + slot * nBM, bh.cumLogProbs + (slot + 1) * nBM);
+    std::vector<float> values(nCandidate);
+    for (SizeType32 i = 0; i < nCandidate; ++i)
+    {
+        auto const index = useCBA ? i / 2 / nBM : i % nBM;
+        values[i] = logProbs[i] + diversityRate * static_cast<float>(index);
+    }
+    auto const top = rankByScore(values.data(), nCandidate, 2 * nBM);
+
+    // Select finished beams into the CBA or tokens for the next step, like the kernel does with one thread.
+    SizeType32 nBeamForNextStep{0};
+    for (SizeType32 i = 0; i < 2 * nBM; ++i)
+    {
+        auto const topKey = top[i];
+        auto const topValue = values[topKey];
+        bool const isEndToken = ids[topKey] % nV == bh.endIds[slot];
+        if (i < nBM && useCBA && isEndToken)
+        {
+            SizeType32 const nSeqLen = bh.sequenceLengths[slot * nBM + i] + 1 - bh.inputLengths[slot * nBM + i];
+            float const score = applyLengthPenalty(topValue, nSeqLen, lengthPenalty);
+            auto nCBA = bh.numBeamsCBA[slot];
+            if (nCBA == nBM)
+            {
+                if (score < bh.minNormedScoresCBA[slot])
+                {
+                    if (earlyStopping)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                // Replace the candidate beam with the worst score.
+                auto* normedScores = bh.normedScoresCBA + slot * (nBM * 2);
+                for (SizeType32 j = 0; j < nBM; ++j)
+                {
+                    if (normedScores[j] == bh.minNormedScoresCBA[slot])
+                    {
+                        nCBA = j;
+                        bh.numBeamsCBA[slot]--;
+                        normedScores[j] = score;
+                        bh.minNormedScoresCBA[slot] = *std::min_element(normedScores, normedScores + nBM);
+                        break;
+                    }
+                }
+            }
+            // Copy the finished beam from the work tree to the CBA.
+            auto indexPrev = (ids[topKey] / nV) % nBM;
+            auto const step = bh.sequenceLengths[slot * nBM + indexPrev];
+            auto const offsetCBA = (slot * nBM * 2 + nCBA) * nMSL;
+            bh.outputIdsCBA[offsetCBA + step] = bh.endIds[slot];
+            if (bh.logProbsCBA != nullptr)
+            {
+                bh.logProbsCBA[offsetCBA + step] = logProbs[topKey] - cumLogProbs[(ids[topKey] / nV) % nBM];
+            }
+            for (auto j = step - 1; j >= 0; --j)
+            {
+                bh.outputIdsCBA[offsetCBA + j] = bh.outputIdsPtr[slot][indexPrev * nMSL + j];
+                indexPrev = bh.parentIdsPtr[slot][indexPrev * nMSL + j];
+            }
+            if (bh.logProbsCBA != nullptr && bh.logProbsTiled != nullptr)
+            {
+                indexPrev = (ids[topKey] / nV) % nBM;
+                for (auto j = step - 1; j >= 0; --j)
+                {
+                    bh.logProbsCBA[offsetCBA + j] = bh.logProbsTiled[(j * nMBS + slot) * nBM + indexPrev];
+                    indexPrev = bh.parentIdsPtr[slot][indexPrev * nMSL + j];
+                }
+            }
+            auto const index = slot * (nBM * 2) + nCBA;
+            bh.sequenceLengthsCBA[index] = step;
+            bh.normedScoresCBA[index] = score;
+            bh.minNormedScoresCBA[slot] = std::min(bh.minNormedScoresCBA[slot], score);
+            bh.numBeamsCBA[slot]++;
+            bh.cumLogProbsCBA[index] = logProbs[topKey];
+        }
+        else if (i < nBM || (useCBA && !isEndToken))
+        {
+            // Add the token to the end of the next beam.
+            auto const step = bh.sequenceLengths[slot * nBM + nBeamForNextStep];
+            bh.outputIdsPtr[slot][nBeamForNextStep * nMSL + step] = ids[topKey];
+            if (bh.logProbsTiled != nullptr)
+            {
+                bh.logProbsTiled[step * nMBS * nBM + slot * nBM + nBeamForNextStep]
+                    = logProbs[topKey] - cumLogProbs[ids[topKey] / nV % nBM];
+            }
+            bh.cumLogProbs[slot * nBM + nBeamForNextStep] = logProbs[topKey];
+            nBeamForNextStep++;
+        }
+        if (nBeamForNextStep >= nBM)
+        {
+            break;
+        }
+    }
+
+    if (useCBA)
+    {
+        if (bh.numBeamsCBA[slot] < nBM)
+        {
+            bh.batchDones[slot] = false;
+        }
+        else if (earlyStopping == 1)
+        {
+            bh.batchDones[slot] = true;
+        }
+        else
+        {
+            // The best cumulative log probability of the step bounds the score a longer beam can reach.
+            auto nSeqLen = bh.sequenceLengths[slot * nBM] + 1 - bh.inputLengths[slot * nBM];
+            if (earlyStopping != 0 && lengthPenalty > 0.0f)
+            {
+                nSeqLen = nMSL - bh.inputLengths[slot * nBM];
+            }
+            float const bestAttainableScore = applyLengthPenalty(values[top[0]], nSeqLen, lengthPenalty);
+            bh.batchDones[slot] = bh.minNormedScoresCBA[slot] >= bestAttainableScore;
+        }
+    }
+
+    // Update sequenceLengths, parentIdsPtr, outputIdsPtr and finished.
+    std::vector<SizeType32> const steps(bh.sequenceLengths + slot * nBM, bh.sequenceLengths + (slot + 1) * nBM);
+    std::vector<SizeType32> nextLengths(steps);
+    for (SizeType32 beam = 0; beam < nBM; ++beam)
+    {
+        if (!bh.finished[slot * nBM + beam].isFinished())
+        {
+            nextLengths[beam]++;
+        }
+    }
+    bool const isDone = (earlyStopping == 1 && useCBA && bh.numBeamsCBA[slot] == nBM)
+        || (earlyStopping != 1 && bh.batchDones != nullptr && bh.batchDones[slot]);
+    for (SizeType32 beam = 0; beam < nBM; ++beam)
+    {
+        auto const indexBatchBeam = slot * nBM + beam;
+        auto const offset = beam * nMSL + steps[beam];
+        auto const newId = bh.outputIdsPtr[slot][offset];
+        auto const newBeamId = (newId / nV) % nBM;
+        auto const newTokenId = newId % nV;
+        bh.sequenceLengths[indexBatchBeam] = nextLengths[newBeamId];
+        if (newTokenId == bh.endIds[slot])
+        {
+            bh.finished[indexBatchBeam].setFinishedEOS();
+        }
+        bh.parentIdsPtr[slot][offset] = newBeamId;
+        bh.outputIdsPtr[slot][offset] = newTokenId;
+        if (isDone)
+        {
+            bh.batchDones[slot] = true;
+            bh.finished[indexBatchBeam].setFinished();
+        }
+    }
+}
+
+void insertUnfinishedPath(BeamHypotheses& bh, SizeType32 bid)
+{
+    SizeType32 const nBM{bh.nBeamWidth};
+    SizeType32 const nMBS{bh.nMaxBatchSize}; // Only for bh.logProbsTiled
+    SizeType32 const nMSL{bh.nMaxSeqLen};
+    bool const outputLogProbs{bh.logProbsCBA != nullptr && bh.logProbsTiled != nullptr};
+    auto const indexDstStart = bh.numBeamsCBA[bid];
+
+    if (bh.batchDones[bid])
+    {
+        return;
+    }
+
+    for (SizeType32 i = 0; i < nBM; ++i)
+    {
+        auto const srcBeam = bid * nBM + i;
+        auto const dstBeam = bid * nBM * 2 + i + indexDstStart;
+        auto const step = bh.sequenceLengths[srcBeam] - 1;
+        auto* dstIds = bh.outputIdsCBA + dstBeam * nMSL;
+        auto* dstLogProbs = outputLogProbs ? bh.logProbsCBA + dstBeam * nMSL : nullptr;
+
+        // Backtrack the ids and log probs together, the kernel walks the parents once for each.
+        dstIds[step] = bh.outputIdsUnfinish[srcBeam * nMSL + step];
+        if (outputLogProbs)
+        {
+            dstLogProbs[step] = bh.logProbsTiled[step * nMBS * nBM + srcBeam];
+        }
+        auto prevId = bh.parentIdsUnfinish[srcBeam * nMSL + step];
+        for (auto j = step - 1; j >= 0; --j)
+        {
+            auto const index = bid * nBM * nMSL + prevId * nMSL + j;
+            dstIds[j] = bh.outputIdsUnfinish[index];
+            if (outputLogProbs)
+            {
+                dstLogProbs[j] = bh.logProbsTiled[j * nMBS * nBM + bid * nBM + prevId];
+            }
+            prevId = bh.parentIdsUnfinish[index];
+        }
+        bh.sequenceLengthsCBA[dstBeam] = bh.sequenceLengths[srcBeam];
+        bh.normedScoresCBA[dstBeam]
+            = applyLengthPenalty(bh.cumLogProbs[srcBeam], step - bh.inputLengths[srcBeam] + 1, bh.lengthPenalties[bid]);
+        bh.cumLogProbsCBA[dstBeam] = bh.cumLogProbs[srcBeam];
+        bh.numBeamsCBA[bid]++;
+    }
+}
+
+void finalize(BeamHypotheses& bh, SizeType32 bid)
+{
+    SizeType32 const nBM{bh.nBeamWidth};
+    SizeType32 const nCBA{bh.numBeamsCBA[bid]};
+    SizeType32 const nMSL{bh.nMaxSeqLen};
+    TLLM_CHECK_WITH_INFO(nBM <= nCBA && nCBA <= nBM * 2,
+        "Request %d has %d candidate beams, expected between %d and %d", bid, nCBA, nBM, nBM * 2);
+
+    auto const ranks = rankByScore(bh.normedScoresCBA + bid * nBM * 2, nCBA, nBM);
+    for (SizeType32 beam = 0; beam < nBM; ++beam)
+    {
+        auto const src = bid * nBM * 2 + ranks[beam];
+        auto const dst = bid * nBM + beam;
+        auto const length = bh.sequenceLengthsCBA[src];
+        bh.sequenceLengths[dst] = length;
+        if (bh.cumLogProbs != nullptr)
+        {
+            bh.cumLogProbs[dst] = bh.cumLogProbsCBA[src];
+        }
+        std::memcpy(bh.outputIds + dst * nMSL, bh.outputIdsCBA + src * nMSL, length * sizeof(TokenIdType));
+        if (bh.logProbs != nullptr)
+        {
+            // The log probs of the output exclude the input.
+            auto const inputLength = bh.inputLengths[dst];
+            if (length > inputLength)
+            {
+                std::memcpy(bh.logProbs + dst * nMSL, bh.logProbsCBA + src * nMSL + inputLength,
+                    (length - inputLength) * sizeof(float));
+            }
+        }
+    }
+}
+
+void gatherTree(gatherTreeParam const& param, SizeType32 batch)
+{
+    SizeType32 const beamWidth{param.beamWidth};
+    SizeType32 const maxSeqLen{param.maxSeqLen};
+    auto const endToken = param.endTokens[batch];
+    auto const batchOffset = batch * beamWidth;
+
+    SizeType32 maxLen{-1};
+    for (SizeType32 beam = 0; beam < beamWidth; ++beam)
+    {
+        auto& length = param.sequenceLengths[batchOffset + beam];
+        length += param.maxSequenceLengthFinalStep - 1;
+        if (param.responseInputLengths != nullptr)
+        {
+            param.responseInputLengths[batchOffset + beam]
+                = param.inputLengths == nullptr ? 0 : param.inputLengths[batchOffset + beam];
+        }
+        maxLen = std::max(maxLen, length);
+    }
+    auto const maxSeqLenB = std::min(maxSeqLen, maxLen);
+    if (maxSeqLenB <= 0)
+    {
+        return;
+    }
+
+    for (SizeType32 beam = 0; beam < beamWidth; ++beam)
+    {
+        auto* outputIds = param.outputIds + (batchOffset + beam) * maxSeqLen;
+        auto const* stepIds = param.stepIds + batchOffset * maxSeqLen;
+        auto const* parentIds = param.parentIds == nullptr ? nullptr : param.parentIds + batchOffset * maxSeqLen;
+
+        outputIds[maxSeqLenB - 1] = stepIds[beam * maxSeqLen + maxSeqLenB - 1];
+        auto parent = parentIds == nullptr ? 0 : parentIds[beam * maxSeqLen + maxSeqLenB - 1] % beamWidth;
+        bool foundBad{false};
+        for (auto level = maxSeqLenB - 2; level >= 0; --level)
+        {
+            if (parent < 0 || parent >= beamWidth)
+            {
+                outputIds[level] = endToken;
+                parent = -1;
+                foundBad = true;
+            }
+            else
+            {
+                outputIds[level] = stepIds[parent * maxSeqLen + level];
+                parent = parentIds == nullptr ? 0 : parentIds[parent * maxSeqLen + level] % beamWidth;
+            }
+        }
+        std::fill(outputIds + maxSeqLenB, outputIds + maxSeqLen, endToken);
+
+        // Tokens after the first end token of a valid path are end tokens as well. Step 0 is often the start token.
+        if (!foundBad)
+        {
+            auto const firstEnd = std::find(outputIds + 1, outputIds + maxSeqLenB, endToken);
+            if (firstEnd != outputIds + maxSeqLenB)
+            {
+                std::fill(firstEnd + 1, outputIds + maxSeqLenB, endToken);
+            }
+        }
+    }
+
+    if (beamWidth == 1)
+    {
+        return;
+    }
+    // Sort the beams by their length penalized scores.
+    TLLM_CHECK_WITH_INFO(param.cumLogProbs != nullptr && param.inputLengths != nullptr,
+        "Sorting the beams requires the cumulative log probs and the input lengths");
+    std::vector<float> normedScores(beamWidth);
+    for (SizeType32 beam = 0; beam < beamWidth; ++beam)
+    {
+        auto const idx = batchOffset + beam;
+        normedScores[beam] = applyLengthPenalty(
+            param.cumLogProbs[idx], param.sequenceLengths[idx] - param.inputLengths[idx], param.lengthPenalty);
+    }
+    auto const ranks = rankByScore(normedScores.data(), beamWidth, beamWidth);
+    std::vector<TokenIdType> const ids(
+        param.outputIds + batchOffset * maxSeqLen, param.outputIds + (batchOffset + beamWidth) * maxSeqLen);
+    std::vector<SizeType32> const lengths(
+        param.sequenceLengths + batchOffset, param.sequenceLengths + batchOffset + beamWidth);
+    std::vector<float> const scores(param.cumLogProbs + batchOffset, param.cumLogProbs + batchOffset + beamWidth);
+    for (SizeType32 beam = 0; beam < beamWidth; ++beam)
+    {
+        auto const src = ranks[beam];
+        param.sequenceLengths[batchOffset + beam] = lengths[src];
+        param.cumLogProbs[batchOffset + beam] = scores[src];
+        // Like the kernel, only the tokens up to the length of the beam are moved.
+        std::copy_n(ids.begin() + src * maxSeqLen, std::clamp(lengths[src], 0, maxSeqLen),
+            param.outputIds + (batchOffset + beam) * maxSeqLen);
+    }
+}
+
+} // namespace
+
+void selectBeamsHost(
+    TokenIdType const* candidateIds, float const* candidateLogProbs, BeamHypotheses& bh, SizeType32 numThreads)
+{
+    forEachRequest(bh.nBatchSize, static_cast<std::size_t>(bh.nBeamWidth) * bh.nMaxSeqLen, numThreads,
+        [&](SizeType32 bid) { selectBeams(candidateIds, candidateLogProbs, bh, bid); });
+}
+
+void initializeOutputHost(
+    TokenIdType* finalOutputIds, TokenIdType const* endIds, SizeType32 batchBeam, SizeType32 maxSeqLen)
+{
+    for (SizeType32 i = 0; i < batchBeam; ++i)
+    {
+        std::fill_n(finalOutputIds + i * maxSeqLen, maxSeqLen, endIds[i]);
+    }
+}
+
+void insertUnfinishedPathHost(BeamHypotheses& bh, SizeType32 numThreads)
+{
+    forEachRequest(bh.nBatchSize, static_cast<std::size_t>(bh.nBeamWidth) * bh.nMaxSeqLen, numThreads,
+        [&bh](SizeType32 bid) { insertUnfinishedPath(bh, bid); });
+}
+
+void finalizeHost(BeamHypotheses& bh, SizeType32 numThreads)
+{
+    forEachRequest(bh.nBatchSize, static_cast<std::size_t>(bh.nBeamWidth) * bh.nMaxSeqLen, numThreads,
+        [&bh](SizeType32 bid) { finalize(bh, bid); });
+}
+
+void gatherTreeHost(gatherTreeParam const& param, SizeType32 numThreads)
+{
+    forEachRequest(param.batchSize, static_cast<std::size_t>(param.beamWidth) * param.maxSeqLen, numThreads,
+        [&param](SizeType32 batch) { gatherTree(param, batch); });
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/beamSearchKernels.h"
+#include "tensorrt_llm/kernels/decodingKernels.h"
+#include "tensorrt_llm/runtime/common.h"
+
+namespace tensorrt_llm::kernels
+{
+
+// Host implementations of the beam search bookkeeping kernels. They take the same BeamHypotheses and gatherTreeParam
+// as the kernels, with all pointers in host memory, and produce the same outputs. They finalize beams whose buffers are
+// already copied back to the host, and check the kernels without a GPU. The requests of a batch are independent and
+// are processed by up to numThreads threads, 0 uses all hardware threads.
+
+// Selects the beams of the next step from the nBM * nBM * 2 candidates of each request, as the third stage of
+// invokeTopkSoftMax does: finished candidates among the best nBM enter the candidate beam array (CBA) with their length
+// penalized score, the others extend the beams. candidateIds hold vocabSize * beam + token, candidateLogProbs
+// the cumulative log probabilities, both [BS, nBM * nBM * 2].
+void selectBeamsHost(runtime::TokenIdType const* candidateIds, float const* candidateLogProbs, BeamHypotheses& bh,
+    runtime::SizeType32 numThreads = 0);
+
+// Prefills [batchBeam, maxSeqLen] output ids with the end id of each beam, as invokeInitializeOutput does.
+void initializeOutputHost(runtime::TokenIdType* finalOutputIds, runtime::TokenIdType const* endIds,
+    runtime::SizeType32 batchBeam, runtime::SizeType32 maxSeqLen);
+
+// Moves the unfinished beams of the requests that are not done into the CBA, as invokeInsertUnfinishedPath does.
+void insertUnfinishedPathHost(BeamHypotheses& bh, runtime::SizeType32 numThreads = 0);
+
+// Writes the best nBM beams of the CBA of each request to the outputs, as invokeFinalize does.
+void finalizeHost(BeamHypotheses& bh, runtime::SizeType32 numThreads = 0);
+
+// Backtracks the beams through their parents and sorts them by length penalized score, as invokeGatherTree does.
+// Unlike the kernel, any beam width is supported.
+void gatherTreeHost(gatherTreeParam const& param, runtime::SizeType32 numThreads = 0);
+
+} // namespace tensorrt_llm::kernels
@@ -97,7 +97,7 @@ __inline__ int padToNextPowerOfTwo(int const n)
 }
 
 template <typename T>
-__device__ __forceinline__ T applyLengthPenalty(T const log_prob, int const length, float const length_penalty)
+__host__ __device__ __forceinline__ T applyLengthPenalty(T const log_prob, int const length, float const length_penalty)
 {
     // score = log(prob) / (length ^ length_penalty)
     if (length_penalty == 0.0f || length == 1)
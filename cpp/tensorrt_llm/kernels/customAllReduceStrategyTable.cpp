@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/customAllReduceStrategyTable.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr float kUnsupported = std::numeric_limits<float>::infinity();
+
+char const* dataTypeName(nvinfer1::DataType type)
+{
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: return "float32";
+    case nvinfer1::DataType::kHALF: return "float16";
+    case nvinfer1::DataType::kBF16: return "bfloat16";
+    default: return nullptr;
+    }
+}
+
+std::optional<nvinfer1::DataType> dataTypeFromName(std::string const& name)
+{
+    for (auto const type : {nvinfer1::DataType::kFLOAT, nvinfer1::DataType::kHALF, nvinfer1::DataType::kBF16})
+    {
+        if (name == dataTypeName(type))
+        {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<float> parseLatency(std::string const& token)
+{
+    if (token == "-")
+    {
+        return kUnsupported;
+    }
+    std::istringstream stream{token};
+    float latency;
+    if (!(stream >> latency) || !stream.eof() || !std::isfinite(latency) || latency < 0.f)
+    {
+        return std::nullopt;
+    }
+    return latency;
+}
+
+} // namespace
+
+void AllReduceStrategyTable::addSample(
+    int worldSize, nvinfer1::DataType type, std::size_t messageBytes, Latencies const& latencies)
+{
+    TLLM_CHECK_WITH_INFO(worldSize > 0, "World size must be positive");
+    TLLM_CHECK_WITH_INFO(messageBytes > 0, "Message size must be positive");
+    TLLM_CHECK_WITH_INFO(std::all_of(latencies.begin(), latencies.end(), [](float l) { return l >= 0.f; }),
+        "Latencies must be non-negative");
+    TLLM_CHECK_WITH_INFO(
+        dataTypeName(type) != nullptr, "Unsupported all-reduce data type %d", static_cast<int>(type));
+
+    auto& samples = mCurves[{worldSize, type}];
+    auto it = std::lower_bound(samples.begin(), samples.end(), messageBytes,
+        [](Sample const& sample, std::size_t bytes) { return sample.messageBytes < bytes; });
+    if (it != samples.end() && it->messageBytes == messageBytes)
+    {
+        it->latencies = latencies;
+    }
+    else
+    {
+        samples.insert(it, Sample{messageBytes, latencies});
+    }
+}
+
+std::optional<AllReduceStrategyTable::Latencies> AllReduceStrategyTable::estimateLatencies(
+    int worldSize, nvinfer1::DataType type, std::size_t messageBytes) const
+{
+    auto const curve = mCurves.find({worldSize, type});
+    if (curve == mCurves.end())
+    {
+        return std::nullopt;
+    }
+    auto const& samples = curve->second;
+    auto const upper = std::lower_bound(samples.begin(), samples.end(), messageBytes,
+        [](Sample const& sample, std::size_t bytes) { return sample.messageBytes < bytes; });
+    if (upper == samples.end())
+    {
+        return std::nullopt;
+    }
+    if (upper == samples.begin() || upper->messageBytes == messageBytes)
+    {
+        return upper->latencies;
+    }
+
+    // Latencies grow with the message size from a constant launch and synchronization cost, so they are interpolated
+    // on a log scale of the size, which is also how the sweeps space their samples.
+    auto const& lower = *std::prev(upper);
+    auto const logLower = std::log2(static_cast<double>(lower.messageBytes));
+    auto const weight = static_cast<float>((std::log2(static_cast<double>(messageBytes)) - logLower)
+        / (std::log2(static_cast<double>(upper->messageBytes)) - logLower));
+    Latencies latencies;
+    for (std::size_t i = 0; i < latencies.size(); ++i)
+    {
+        auto const a = lower.latencies[i];
+        auto const b = upper->latencies[i];
+        // A strategy missing on either side of the interval is not known to support the sizes in between.
+        latencies[i] = (std::isinf(a) || std::isinf(b)) ? kUnsupported : a + weight * (b - a);
+    }
+    return latencies;
+}
+
+std::optional<AllReduceStrategyType> AllReduceStrategyTable::select(
+    int worldSize, nvinfer1::DataType type, std::size_t messageBytes, IsSupported const& isSupported) const
+{
+    auto const latencies = estimateLatencies(worldSize, type, messageBytes);
+    if (!latencies)
+    {
+        return std::nullopt;
+    }
+    std::optional<AllReduceStrategyType> best;
+    auto bestLatency = kUnsupported;
+    for (std::size_t i = 0; i < kStrategies.size(); ++i)
+    {
+        auto const latency = (*latencies)[i];
+        if (latency < bestLatency && (!isSupported || isSupported(kStrategies[i])))
+        {
+            best = kStrategies[i];
+            bestLatency = latency;
+        }
+    }
+    return best;
+}
+
+AllReduceStrategyTable AllReduceStrategyTable::parse(std::istream& input)
+{
+    AllReduceStrategyTable table;
+    std::string line;
+    for (int lineNumber = 1; std::getline(input, line); ++lineNumber)
+    {
+        std::istringstream fields{line.substr(0, line.find('#'))};
+        std::vector<std::string> tokens;
+        for (std::string token; fields >> token;)
+        {
+            tokens.push_back(token);
+        }
+        if (tokens.empty())
+        {
+            continue;
+        }
+        TLLM_CHECK_WITH_INFO(tokens.size() == 3 + kStrategies.size(),
+            "All-reduce strategy table line %d has %zu fields, expected %zu", lineNumber, tokens.size(),
+            3 + kStrategies.size());
+
+        std::istringstream worldSizeField{tokens[0]};
+        std::istringstream bytesField{tokens[2]};
+        int worldSize;
+        std::size_t messageBytes;
+        auto const type = dataTypeFromName(tokens[1]);
+        TLLM_CHECK_WITH_INFO(worldSizeField >> worldSize && worldSizeField.eof() && worldSize > 0,
+            "Invalid world size '%s' on all-reduce strategy table line %d", tokens[0].c_str(), lineNumber);
+        TLLM_CHECK_WITH_INFO(type.has_value(), "Invalid data type '%s' on all-reduce strategy table line %d",
+            tokens[1].c_str(), lineNumber);
+        TLLM_CHECK_WITH_INFO(tokens[2][0] != '-' && bytesField >> messageBytes && bytesField.eof() && messageBytes > 0,
+            "Invalid message size '%s' on all-reduce strategy table line %d", tokens[2].c_str(), lineNumber);
+
+        Latencies latencies;
+        for (std::size_t i = 0; i < kStrategies.size(); ++i)
+        {
+            auto const latency = parseLatency(tokens[3 + i]);
+            TLLM_CHECK_WITH_INFO(latency.has_value(), "Invalid latency '%s' on all-reduce strategy table line %d",
+                tokens[3 + i].c_str(), lineNumber);
+            latencies[i] = *latency;
+        }
+        table.addSample(worldSize, *type, messageBytes, latencies);
+    }
+    return table;
+}
+
+AllReduceStrategyTable AllReduceStrategyTable::load(std::filesystem::path const& path)
+{
+    std::ifstream file{path};
+    TLLM_CHECK_WITH_INFO(file.is_open(), "Cannot open all-reduce strategy table %s", path.string().c_str());
+    return parse(file);
+}
+
+void AllReduceStrategyTable::write(std::ostream& output) const
+{
+    output << "# world_size dtype message_bytes nccl_us oneshot_us twoshot_us\n";
+    for (auto const& [key, samples] : mCurves)
+    {
+        auto const& [worldSize, type] = key;
+        for (auto const& sample : samples)
+        {
+            output << worldSize << ' ' << dataTypeName(type) << ' ' << sample.messageBytes;
+            for (auto const latency : sample.latencies)
+            {
+                output << ' ';
+                if (std::isinf(latency))
+                {
+                    output << '-';
+                }
+                else
+                {
+                    output << latency;
+                }
+            }
+            output << '\n';
+        }
+    }
+}
+
+void AllReduceStrategyTable::save(std::filesystem::path const& path) const
+{
+    std::ofstream file{path};
+    TLLM_CHECK_WITH_INFO(file.is_open(), "Cannot write all-reduce strategy table %s", path.string().c_str());
+    write(file);
+    TLLM_CHECK_WITH_INFO(file.good(), "Failed to write all-reduce strategy table %s", path.string().c_str());
+}
+
+AllReduceStrategyTable const& AllReduceStrategyTable::getDefault()
+{
+    static AllReduceStrategyTable const table = []()
+    {
+        auto const path = common::getEnvAllReduceStrategyTable();
+        if (!path)
+        {
+            return AllReduceStrategyTable{};
+        }
+        try
+        {
+            auto loaded = load(*path);
+            TLLM_LOG_INFO("Using the all-reduce strategy table %s", path->c_str());
+            return loaded;
+        }
+        catch (std::exception const& e)
+        {
+            TLLM_LOG_WARNING("Ignoring the all-reduce strategy table %s: %s", path->c_str(), e.what());
+            return AllReduceStrategyTable{};
+        }
+    }();
+    return table;
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+
+#include <NvInferRuntime.h>
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::kernels
+{
+
+// Measured all-reduce latencies of one system, used to choose the strategy of a message instead of the fixed size
+// thresholds. The samples of a (world size, data type) pair form one latency curve per strategy, which is
+// interpolated linearly in log2 of the message size between samples.
+//
+// The text format has one sample per line, "#" starts a comment:
+//   <world size> <float32|float16|bfloat16> <message bytes> <nccl us> <oneshot us> <twoshot us>
+// A latency of "-" marks a strategy that was not measured, or does not support the message.
+class AllReduceStrategyTable
+{
+public:
+    // The strategies of a sample, in the order of its latencies.
+    static constexpr std::array<AllReduceStrategyType, 3> kStrategies{
+        AllReduceStrategyType::NCCL, AllReduceStrategyType::ONESHOT, AllReduceStrategyType::TWOSHOT};
+
+    // Latencies in microseconds, infinite for strategies that cannot run the message.
+    using Latencies = std::array<float, kStrategies.size()>;
+
+    using IsSupported = std::function<bool(AllReduceStrategyType)>;
+
+    // Adds a sample, replacing the sample of the same world size, data type and message size.
+    void addSample(int worldSize, nvinfer1::DataType type, std::size_t messageBytes, Latencies const& latencies);
+
+    // The latencies at messageBytes, or nullopt if the table has no curve for worldSize and type, or messageBytes is
+    // beyond its largest sample. Messages below the smallest sample take its latencies.
+    [[nodiscard]] std::optional<Latencies> estimateLatencies(
+        int worldSize, nvinfer1::DataType type, std::size_t messageBytes) const;
+
+    // The fastest strategy for the message among those accepted by isSupported, or nullopt if the table does not
+    // cover the message and the caller should fall back to its heuristic.
+    [[nodiscard]] std::optional<AllReduceStrategyType> select(int worldSize, nvinfer1::DataType type,
+        std::size_t messageBytes, IsSupported const& isSupported = nullptr) const;
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return mCurves.empty();
+    }
+
+    static AllReduceStrategyTable parse(std::istream& input);
+
+    static AllReduceStrategyTable load(std::filesystem::path const& path);
+
+    void write(std::ostream& output) const;
+
+    void save(std::filesystem::path const& path) const;
+
+    // The table of the file named by TRTLLM_ALLREDUCE_STRATEGY_TABLE, loaded on first use. It is empty if the
+    // variable is not set or the file cannot be read.
+    static AllReduceStrategyTable const& getDefault();
+
+private:
+    struct Sample
+    {
+        std::size_t messageBytes;
+        Latencies latencies;
+    };
+
+    // The samples of each curve, sorted by message size.
+    std::map<std::pair<int, nvinfer1::DataType>, std::vector<Sample>> mCurves;
+};
+
+} // namespace tensorrt_llm::kernels
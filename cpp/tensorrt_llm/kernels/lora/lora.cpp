@@ -21,6 +21,7 @@
 #include "tensorrt_llm/common/cublasMMWrapper.h"
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/kernels/groupGemm.h"
+#include "tensorrt_llm/kernels/lora/loraPermuteKernels.h"
 #include "tensorrt_llm/kernels/splitkGroupGemm.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 
@@ -78,6 +79,8 @@ LoraImpl::LoraImpl(int in_hidden_size, std::vector<int> out_hidden_sizes, int tr
 {
     mOutHiddenSizes.resize(mNumLoraModules);
     mOutHiddenSizes.assign(out_hidden_sizes.begin(), out_hidden_sizes.end());
+    char* groupByAdapterChar = std::getenv("LORA_GROUP_TOKENS_BY_ADAPTER");
+    mGroupByAdapter = groupByAdapterChar != nullptr && std::string(groupByAdapterChar) == "ON";
     TLLM_LOG_DEBUG("%s", __PRETTY_FUNCTION__);
 }
 
@@ -130,9 +133,24 @@ size_t LoraImpl::getWorkspaceSize(
     TLLM_CHECK_WITH_INFO(
         numTokens >= numReqs, fmtstr("num tokens %ld should be greater than num reqs %ld", numTokens, numReqs));
 
-    return (size_t) getGemmWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, mSplitKSlices)
+    auto workspaceSize = (size_t) getGemmWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, mSplitKSlices)
         + getLowRankWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, typeSize)
         + getGemmParamsWorkSpaceSize(numReqs * mNumLoraModules);
+    if (mGroupByAdapter)
+    {
+        workspaceSize += getPermutedWorkSpaceSize(numTokens, typeSize);
+    }
+    return workspaceSize;
+}
+
+size_t LoraImpl::getPermutedWorkSpaceSize(int64_t numTokens, int64_t typeSize) const
+{
+    auto size = divUp(numTokens * sizeof(int32_t), 16) * 16 + divUp(numTokens * mInHiddenSize * typeSize, 16) * 16;
+    for (auto const outHiddenSize : mOutHiddenSizes)
+    {
+        size += divUp(numTokens * outHiddenSize * typeSize, 16) * 16;
+    }
+    return size;
 }
 
 void LoraImpl::setBestTactic(std::optional<Config> config)
@@ -142,55 +160,83 @@ void LoraImpl::setBestTactic(std::optional<Config> config)
 
 int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
     void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    // inputs
+    //     loraRanks [mNumLoraModules, numTokens] on cpu
+    //     loraWeightsPtr [mNumLoraModules, numTokens, 2] on cpu
+    mSegments.buildFromTokens(mNumLoraModules, numTokens, loraRanks, loraWeightsPtr);
+    return run(mSegments, numReqs, input, weightIndex, outputs, workspace, stream);
+}
+
+int LoraImpl::run(LoraSegmentTable const& segments, int64_t numReqs, void const* input, int weightIndex,
+    void* const* outputs, void* workspace, cudaStream_t stream)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
     // inputs
-    //     numTokens
+    //     segments of the mNumLoraModules modules over numTokens tokens
     //     numReqs
     //     input [numTokens, K] (view as 2D)
-    //     loraRanks [mNumLoraModules, numTokens] on cpu
-    //     loraWeightsPtr [mNumLoraModules, numTokens, 2] on cpu
     // outputs
     //     output [-1, N] (view as 2D)
     //     ... (there are mNumLoraModules outputs)
 
+    auto const numTokens = segments.getNumTokens();
     if (numTokens == 0)
     {
         return 0;
     }
+    TLLM_CHECK_WITH_INFO(segments.getNumModules() == mNumLoraModules,
+        fmtstr("LoRA segments of %d modules, expected %d", segments.getNumModules(), mNumLoraModules));
 
     auto const typeSize = tensorrt_llm::runtime::BufferDataType(mType).getSize();
     setGemmConfig();
 
     int64_t GemmWorkSpaceSize = getGemmWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, mSplitKSlices);
     int64_t groupGemmParamsWorkSpaceSize = getGemmParamsWorkSpaceSize(numReqs * mNumLoraModules);
-    void* gemmWorkSpace = workspace; // [gemmWorkSpace, lowrankWorkSpace, groupGemmParamsWorkSpace]
+    void* gemmWorkSpace = workspace; // [gemmWorkSpace, lowrankWorkSpace, groupGemmParamsWorkSpace, permutedWorkSpace]
     void* lowRankWorkSpace = static_cast<char*>(gemmWorkSpace) + GemmWorkSpaceSize;
     void* groupGemmParamsWorkSpace = static_cast<char*>(lowRankWorkSpace)
         + getLowRankWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, typeSize);
 
+    // The GEMMs of permuted tokens read the input and write the outputs in the grouped order, in the permuted
+    // workspace: [token permutation, input, output of each module].
+    auto const permuted = segments.isPermuted();
+    TLLM_CHECK_WITH_INFO(!permuted || mGroupByAdapter, "LoRA tokens are permuted but the workspace is not reserved");
+    void const* gemmInput = input;
+    std::vector<void*> gemmOutputs(outputs, outputs + mNumLoraModules);
+    int32_t const* tokenPermutation = nullptr;
+    if (permuted)
+    {
+        auto* permutedWorkSpace = static_cast<char*>(groupGemmParamsWorkSpace) + groupGemmParamsWorkSpaceSize;
+        // The copy from pageable memory returns once the host buffer is staged, so the table can be rebuilt.
+        auto const& hostPermutation = segments.getTokenPermutation();
+        TLLM_CUDA_CHECK(cudaMemcpyAsync(permutedWorkSpace, hostPermutation.data(),
+            hostPermutation.size() * sizeof(int32_t), cudaMemcpyHostToDevice, stream));
+        tokenPermutation = reinterpret_cast<int32_t const*>(permutedWorkSpace);
+        permutedWorkSpace += divUp(numTokens * sizeof(int32_t), 16) * 16;
+
+        auto const inputRowSize = mInHiddenSize * typeSize;
+        invokeLoraGatherTokens(permutedWorkSpace, input, inputRowSize, tokenPermutation, numTokens, stream);
+        gemmInput = permutedWorkSpace;
+        permutedWorkSpace += divUp(numTokens * inputRowSize, 16) * 16;
+        for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+        {
+            gemmOutputs[loraModuleIdx] = permutedWorkSpace;
+            permutedWorkSpace += divUp(numTokens * mOutHiddenSizes[loraModuleIdx] * typeSize, 16) * 16;
+        }
+    }
+
     for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
     {
         size_t size = numTokens * mOutHiddenSizes[loraModuleIdx];
-        cudaMemsetAsync(outputs[loraModuleIdx], 0, size * typeSize, stream);
+        cudaMemsetAsync(gemmOutputs[loraModuleIdx], 0, size * typeSize, stream);
     }
 
     char* useUnifiedGemmChar = std::getenv("LORA_USE_UNIFIED_GEMM");
     bool useUnifiedGemm = (useUnifiedGemmChar == nullptr || std::string(useUnifiedGemmChar) != "OFF");
-
     for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
     {
-        auto const loraRankModule = loraRanks[loraModuleIdx * numTokens];
-        void const* const* loraWeightsPtrModule = &loraWeightsPtr[loraModuleIdx * numTokens * 2];
-        for (int rowId = 0; rowId < numTokens; rowId++)
-        {
-            if (loraWeightsPtrModule[rowId * 2] != loraWeightsPtrModule[0]
-                || loraWeightsPtrModule[rowId * 2 + 1] != loraWeightsPtrModule[1]
-                || loraRanks[loraModuleIdx * numTokens + rowId] != loraRankModule)
-            {
-                useUnifiedGemm = false;
-            }
-        }
+        useUnifiedGemm &= segments.getSegments(loraModuleIdx).size() == 1;
     }
 
     // TODO can add batch_size == 1 case
@@ -198,14 +244,11 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
     {
         for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
         {
-            int64_t const* loraWeightsPtrModule
-                = reinterpret_cast<int64_t const*>(&loraWeightsPtr[loraModuleIdx * numTokens * 2]);
+            auto const& segment = segments.getSegments(loraModuleIdx).front();
 
             int M = numTokens;
 
-            auto const lora_rank = loraRanks[loraModuleIdx * numTokens];
-
-            auto const N = lora_rank;
+            auto const N = segment.rank;
 
             if (N > 0)
             {
@@ -217,14 +260,13 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
                 // [M, K] * [K, N] -> [M, N]
                 // [M, N] * [N, N2] -> [M, N2]
 
-                void* lora_in_weight
-                    = reinterpret_cast<void*>(loraWeightsPtrModule[0] + K * N * typeSize * weightIndex);
+                void* lora_in_weight = reinterpret_cast<void*>(segment.inWeightsPtr + K * N * typeSize * weightIndex);
                 void* lora_out_weight
-                    = reinterpret_cast<void*>(loraWeightsPtrModule[1] + N2 * N * typeSize * weightIndex);
-                void* output = outputs[loraModuleIdx];
+                    = reinterpret_cast<void*>(segment.outWeightsPtr + N2 * N * typeSize * weightIndex);
+                void* output = gemmOutputs[loraModuleIdx];
 
-                _runGemm(M, N, K, mTransA, mTransB, mType, mCublasWrapper, input, lora_in_weight, lowRankWorkSpace,
-                    mBestConfig, gemmWorkSpace, stream);
+                _runGemm(M, N, K, mTransA, mTransB, mType, mCublasWrapper, gemmInput, lora_in_weight,
+                    lowRankWorkSpace, mBestConfig, gemmWorkSpace, stream);
 
                 _runGemm(M, N2, N, false, mTransB, mType, mCublasWrapper, lowRankWorkSpace, lora_out_weight, output,
                     mBestConfig, gemmWorkSpace, stream);
@@ -233,91 +275,79 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
     }
     else
     {
+        int64_t numProblems = 0;
+        for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+        {
+            numProblems += segments.getNumProblems(loraModuleIdx);
+        }
+
         std::vector<cutlass::gemm::GemmCoord> problem_sizes;
-        problem_sizes.reserve(numTokens * mNumLoraModules);
+        problem_sizes.reserve(numProblems);
         std::vector<void*> ptrA;
-        ptrA.reserve(numTokens * mNumLoraModules);
+        ptrA.reserve(numProblems);
         std::vector<void*> ptrB;
-        ptrB.reserve(numTokens * mNumLoraModules);
+        ptrB.reserve(numProblems);
         std::vector<void*> ptrC;
-        ptrC.reserve(numTokens * mNumLoraModules);
+        ptrC.reserve(numProblems);
         std::vector<void*> ptrD;
-        ptrD.reserve(numTokens * mNumLoraModules);
+        ptrD.reserve(numProblems);
 
         std::vector<cutlass::gemm::GemmCoord> problem_sizes_2;
-        problem_sizes_2.reserve(numTokens * mNumLoraModules);
+        problem_sizes_2.reserve(numProblems);
         std::vector<void*> ptrA_2;
-        ptrA_2.reserve(numTokens * mNumLoraModules);
+        ptrA_2.reserve(numProblems);
         std::vector<void*> ptrB_2;
-        ptrB_2.reserve(numTokens * mNumLoraModules);
+        ptrB_2.reserve(numProblems);
         std::vector<void*> ptrC_2;
-        ptrC_2.reserve(numTokens * mNumLoraModules);
+        ptrC_2.reserve(numProblems);
         std::vector<void*> ptrD_2;
-        ptrD_2.reserve(numTokens * mNumLoraModules);
+        ptrD_2.reserve(numProblems);
 
         std::vector<int64_t> splitkBufferOffsets;
+        splitkBufferOffsets.reserve(numProblems + 1);
         splitkBufferOffsets.push_back(0);
         for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
         {
-            int64_t const* loraWeightsPtrModule
-                = reinterpret_cast<int64_t const*>(&loraWeightsPtr[loraModuleIdx * numTokens * 2]);
-            int32_t const* loraRanksModule = &loraRanks[loraModuleIdx * numTokens];
-
-            // The following loop aggregates the contiguous requests that use the same LoRA weights to reduce
-            // the problem_size of grouped GEMMs and increase the M dimension of those GEMMs.
-            int rowId = 0;
-            int handled_token_num = 0;
-            while (rowId < numTokens)
+            // Each segment holds the contiguous tokens that use the same LoRA weights, which reduces the
+            // problem_size of grouped GEMMs and increases the M dimension of those GEMMs.
+            for (auto const& segment : segments.getSegments(loraModuleIdx))
             {
-                auto const lora_rank = loraRanksModule[rowId];
-                auto const N = lora_rank;
-                int count = 0;
-                size_t M = 0;
-                while (rowId + count < numTokens && lora_rank == loraRanksModule[rowId + count]
-                    && loraWeightsPtrModule[rowId * 2] == loraWeightsPtrModule[(rowId + count) * 2]
-                    && loraWeightsPtrModule[rowId * 2 + 1] == loraWeightsPtrModule[(rowId + count) * 2 + 1])
+                auto const N = segment.rank;
+                if (N == 0)
                 {
-                    M += 1;
-                    count++;
+                    continue;
                 }
+                TLLM_CHECK_WITH_INFO(N <= mMaxLowRank,
+                    fmtstr("Invalid low_rank (%d). low_rank must be smaller than mMaxLowRank (%d)", N, mMaxLowRank));
 
-                if (N > 0)
-                {
-                    TLLM_CHECK_WITH_INFO(N <= mMaxLowRank,
-                        fmtstr(
-                            "Invalid low_rank (%d). low_rank must be smaller than mMaxLowRank (%d)", N, mMaxLowRank));
-
-                    auto const K = mInHiddenSize;
-
-                    cutlass::gemm::GemmCoord problem(M, N, K);
-                    problem_sizes.push_back(problem);
-
-                    ptrA.push_back(static_cast<void*>(
-                        static_cast<char*>(const_cast<void*>(input)) + handled_token_num * K * typeSize));
-                    ptrB.push_back(
-                        reinterpret_cast<void*>(loraWeightsPtrModule[rowId * 2] + K * N * typeSize * weightIndex));
-                    ptrC.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
-                        + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
-                    ptrD.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
-                        + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
-
-                    auto const N2 = mOutHiddenSizes[loraModuleIdx];
-                    cutlass::gemm::GemmCoord problem_2(M, N2, N);
-                    problem_sizes_2.push_back(problem_2);
-                    ptrA_2.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
-                        + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
-                    ptrB_2.push_back(
-                        reinterpret_cast<void*>(loraWeightsPtrModule[rowId * 2 + 1] + N2 * N * typeSize * weightIndex));
-                    ptrC_2.push_back(static_cast<void*>(
-                        static_cast<char*>(outputs[loraModuleIdx]) + handled_token_num * N2 * typeSize));
-                    ptrD_2.push_back(static_cast<void*>(
-                        static_cast<char*>(outputs[loraModuleIdx]) + handled_token_num * N2 * typeSize));
-                }
-                handled_token_num += M;
-                rowId += count;
-                splitkBufferOffsets.push_back(splitkBufferOffsets.at(splitkBufferOffsets.size() - 1) + M * N);
+                auto const M = segment.numTokens;
+                auto const handled_token_num = segment.tokenBegin;
+                auto const K = mInHiddenSize;
+
+                cutlass::gemm::GemmCoord problem(M, N, K);
+                problem_sizes.push_back(problem);
+
+                ptrA.push_back(static_cast<void*>(
+                    static_cast<char*>(const_cast<void*>(gemmInput)) + handled_token_num * K * typeSize));
+                ptrB.push_back(reinterpret_cast<void*>(segment.inWeightsPtr + K * N * typeSize * weightIndex));
+                ptrC.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
+                    + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
+                ptrD.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
+                    + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
+
+                auto const N2 = mOutHiddenSizes[loraModuleIdx];
+                cutlass::gemm::GemmCoord problem_2(M, N2, N);
+                problem_sizes_2.push_back(problem_2);
+                ptrA_2.push_back(static_cast<void*>(static_cast<char*>(lowRankWorkSpace)
+                    + (loraModuleIdx * numTokens * mMaxLowRank + handled_token_num * mMaxLowRank) * typeSize));
+                ptrB_2.push_back(reinterpret_cast<void*>(segment.outWeightsPtr + N2 * N * typeSize * weightIndex));
+                ptrC_2.push_back(static_cast<void*>(
+                    static_cast<char*>(gemmOutputs[loraModuleIdx]) + handled_token_num * N2 * typeSize));
+                ptrD_2.push_back(static_cast<void*>(
+                    static_cast<char*>(gemmOutputs[loraModuleIdx]) + handled_token_num * N2 * typeSize));
+
+                splitkBufferOffsets.push_back(splitkBufferOffsets.back() + M * N);
             }
-            TLLM_CHECK(handled_token_num == numTokens);
         }
         if (problem_sizes.size() > 0)
         {
@@ -334,6 +364,20 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
         }
     }
 
+    if (permuted)
+    {
+        // Scatter the outputs of all modules back to the input order of the tokens.
+        std::vector<int64_t> outputRowSizes(mNumLoraModules);
+        for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+        {
+            outputRowSizes[loraModuleIdx] = mOutHiddenSizes[loraModuleIdx] * typeSize;
+        }
+        std::vector<void const*> const permutedOutputs(gemmOutputs.begin(), gemmOutputs.end());
+        invokeLoraScatterTokens(outputs, permutedOutputs.data(), outputRowSizes.data(), mNumLoraModules,
+            tokenPermutation, numTokens, stream);
+    }
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
     return 0;
 }
 
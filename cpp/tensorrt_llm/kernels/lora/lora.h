@@ -17,6 +17,7 @@
 #pragma once
 #include "tensorrt_llm/common/cublasMMWrapper.h"
 #include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/kernels/lora/loraSegments.h"
 #include <cassert>
 #include <string>
 #include <vector>
@@ -43,6 +44,17 @@ public:
     void setBestTactic(std::optional<Config> config);
     int run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
         void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream);
+    //! Runs one GEMM problem per segment of each module. If the segments are permuted, the tokens are gathered in the
+    //! grouped order in the workspace and the outputs scattered back.
+    int run(LoraSegmentTable const& segments, int64_t numReqs, void const* input, int weightIndex,
+        void* const* outputs, void* workspace, cudaStream_t stream);
+
+    //! Whether the tokens of the requests using the same adapter are grouped, set by LORA_GROUP_TOKENS_BY_ADAPTER=ON.
+    //! The workspace then holds the token permutation and the permuted input and outputs.
+    [[nodiscard]] bool isGroupByAdapter() const
+    {
+        return mGroupByAdapter;
+    }
 
     void setGemmConfig();
 
@@ -57,12 +69,18 @@ public:
     CublasGemmWrapperPtr mCublasWrapper;
 
 private:
+    size_t getPermutedWorkSpaceSize(int64_t numTokens, int64_t typeSize) const;
+
     int mInHiddenSize;
     std::vector<int> mOutHiddenSizes;
     int mMaxLowRank;
     int const mSplitKSlices = 16;
 
     std::optional<Config> mBestConfig;
+
+    bool mGroupByAdapter{false};
+    // Segments of the per-token run.
+    LoraSegmentTable mSegments;
 };
 
 } // namespace tensorrt_llm::kernels
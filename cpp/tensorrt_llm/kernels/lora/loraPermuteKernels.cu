@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION &
+ * AFFILIATES. All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/lora/loraPermuteKernels.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+// Matrices permuted by one launch, passed by value. LoRA layers have few modules, so more are split over launches.
+struct LoraPermuteParams
+{
+    static constexpr int32_t kMaxMatrices = 8;
+
+    void* dst[kMaxMatrices];
+    void const* src[kMaxMatrices];
+    int64_t rowBytes[kMaxMatrices];
+    int32_t numMatrices;
+};
+
+// One block copies a row of the matrix blockIdx.y at a time, each thread a vector of VecT.
+template <typename VecT, bool kGather>
+__global__ void loraPermuteTokensKernel(LoraPermuteParams params, int32_t const* permutation, int64_t numTokens)
+{
+    auto const matrixIdx = blockIdx.y;
+    auto const rowVecs = params.rowBytes[matrixIdx] / static_cast<int64_t>(sizeof(VecT));
+    auto* dst = static_cast<VecT*>(params.dst[matrixIdx]);
+    auto const* src = static_cast<VecT const*>(params.src[matrixIdx]);
+    for (int64_t token = blockIdx.x; token < numTokens; token += gridDim.x)
+    {
+        int64_t const permutedToken = permutation[token];
+        auto const dstRow = kGather ? token : permutedToken;
+        auto const srcRow = kGather ? permutedToken : token;
+        for (int64_t vecIdx = threadIdx.x; vecIdx < rowVecs; vecIdx += blockDim.x)
+        {
+            dst[dstRow * rowVecs + vecIdx] = src[srcRow * rowVecs + vecIdx];
+        }
+    }
+}
+
+template <typename VecT, bool kGather>
+void launchLoraPermuteTokens(
+    LoraPermuteParams const& params, int32_t const* permutation, int64_t numTokens, cudaStream_t stream)
+{
+    int64_t constexpr maxBlocks = 65535;
+    int64_t constexpr maxBlockSize = 512;
+    auto const maxRowBytes = *std::max_element(params.rowBytes, params.rowBytes + params.numMatrices);
+    auto const rowVecs = maxRowBytes / static_cast<int64_t>(sizeof(VecT));
+    dim3 const grid(std::min(numTokens, maxBlocks), params.numMatrices);
+    auto const numWarps = std::max(static_cast<int64_t>(divUp(rowVecs, 32)), int64_t{1});
+    dim3 const block(std::min(numWarps * 32, maxBlockSize));
+    loraPermuteTokensKernel<VecT, kGather><<<grid, block, 0, stream>>>(params, permutation, numTokens);
+}
+
+// Copies with the widest vectors that all rows and pointers are aligned to.
+template <bool kGather>
+void invokeLoraPermuteTokens(
+    LoraPermuteParams const& params, int32_t const* permutation, int64_t numTokens, cudaStream_t stream)
+{
+    uint64_t alignment = 16;
+    for (int32_t matrixIdx = 0; matrixIdx < params.numMatrices; ++matrixIdx)
+    {
+        alignment |= static_cast<uint64_t>(params.rowBytes[matrixIdx])
+            | reinterpret_cast<uint64_t>(params.dst[matrixIdx]) | reinterpret_cast<uint64_t>(params.src[matrixIdx]);
+    }
+    // Lowest set bit, at most 16.
+    switch (alignment & (~alignment + 1))
+    {
+    case 16: launchLoraPermuteTokens<uint4, kGather>(params, permutation, numTokens, stream); break;
+    case 8: launchLoraPermuteTokens<uint2, kGather>(params, permutation, numTokens, stream); break;
+    case 4: launchLoraPermuteTokens<uint32_t, kGather>(params, permutation, numTokens, stream); break;
+    case 2: launchLoraPermuteTokens<uint16_t, kGather>(params, permutation, numTokens, stream); break;
+    default: launchLoraPermuteTokens<uint8_t, kGather>(params, permutation, numTokens, stream); break;
+    }
+    sync_check_cuda_error();
+}
+
+} // namespace
+
+void invokeLoraGatherTokens(void* dst, void const* src, int64_t rowBytes, int32_t const* permutation,
+    int64_t numTokens, cudaStream_t stream)
+{
+    if (numTokens == 0 || rowBytes == 0)
+    {
+        return;
+    }
+    LoraPermuteParams params{};
+    params.dst[0] = dst;
+    params.src[0] = src;
+    params.rowBytes[0] = rowBytes;
+    params.numMatrices = 1;
+    invokeLoraPermuteTokens<true>(params, permutation, numTokens, stream);
+}
+
+void invokeLoraScatterTokens(void* const* outputs, void const* const* permutedOutputs, int64_t const* rowBytes,
+    int32_t numModules, int32_t const* permutation, int64_t numTokens, cudaStream_t stream)
+{
+    if (numTokens == 0)
+    {
+        return;
+    }
+    for (int32_t moduleBegin = 0; moduleBegin < numModules; moduleBegin += LoraPermuteParams::kMaxMatrices)
+    {
+        LoraPermuteParams params{};
+        params.numMatrices = std::min(numModules - moduleBegin, LoraPermuteParams::kMaxMatrices);
+        for (int32_t matrixIdx = 0; matrixIdx < params.numMatrices; ++matrixIdx)
+        {
+            params.dst[matrixIdx] = outputs[moduleBegin + matrixIdx];
+            params.src[matrixIdx] = permutedOutputs[moduleBegin + matrixIdx];
+            params.rowBytes[matrixIdx] = rowBytes[moduleBegin + matrixIdx];
+        }
+        invokeLoraPermuteTokens<false>(params, permutation, numTokens, stream);
+    }
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION &
+ * AFFILIATES. All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Gathers the rows of a [numTokens, rowBytes] matrix in the grouped order of the LoRA tokens, in one launch:
+//! row i of dst is row permutation[i] of src.
+//! \param permutation input token at each position of the grouped order, on device [numTokens]
+void invokeLoraGatherTokens(void* dst, void const* src, int64_t rowBytes, int32_t const* permutation,
+    int64_t numTokens, cudaStream_t stream);
+
+//! \brief Scatters the rows of the outputs of all LoRA modules back to the input order of the tokens, in one launch:
+//! row permutation[i] of outputs[m] is row i of permutedOutputs[m].
+//! \param rowBytes size of a row of each output [numModules]
+//! \param permutation input token at each position of the grouped order, on device [numTokens]
+void invokeLoraScatterTokens(void* const* outputs, void const* const* permutedOutputs, int64_t const* rowBytes,
+    int32_t numModules, int32_t const* permutation, int64_t numTokens, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
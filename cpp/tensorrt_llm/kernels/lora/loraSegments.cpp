@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/lora/loraSegments.h"
+
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+//! Weights of a rank 0 module are not used, so its pointers do not need to match.
+bool sameWeights(int32_t rank, int64_t inWeightsPtr, int64_t outWeightsPtr, int32_t otherRank,
+    int64_t otherInWeightsPtr, int64_t otherOutWeightsPtr)
+{
+    return rank == otherRank
+        && (rank == 0 || (inWeightsPtr == otherInWeightsPtr && outWeightsPtr == otherOutWeightsPtr));
+}
+
+} // namespace
+
+void LoraSegmentTable::clear(int32_t numModules)
+{
+    mSegments.resize(numModules);
+    for (auto& segments : mSegments)
+    {
+        segments.clear();
+    }
+    mTokenPermutation.clear();
+    mNumTokens = 0;
+    mPermuted = false;
+}
+
+void LoraSegmentTable::append(
+    int32_t moduleIdx, int64_t inWeightsPtr, int64_t outWeightsPtr, int32_t rank, int64_t numTokens)
+{
+    if (numTokens == 0)
+    {
+        return;
+    }
+    auto& segments = mSegments[moduleIdx];
+    if (!segments.empty())
+    {
+        auto& last = segments.back();
+        if (sameWeights(rank, inWeightsPtr, outWeightsPtr, last.rank, last.inWeightsPtr, last.outWeightsPtr))
+        {
+            last.numTokens += numTokens;
+            return;
+        }
+    }
+    auto const tokenBegin = segments.empty() ? 0 : segments.back().tokenBegin + segments.back().numTokens;
+    segments.push_back(LoraSegment{inWeightsPtr, outWeightsPtr, rank, tokenBegin, numTokens});
+}
+
+void LoraSegmentTable::build(int32_t numModules, int64_t numReqs, int64_t const* reqNumTokens,
+    int32_t const* const* ranks, int64_t const* const* weightsPtrs, bool groupByAdapter)
+{
+    clear(numModules);
+
+    mReqTokenBegin.resize(numReqs);
+    for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+    {
+        mReqTokenBegin[reqId] = mNumTokens;
+        mNumTokens += reqNumTokens[reqId];
+    }
+
+    mReqOrder.resize(numReqs);
+    if (groupByAdapter)
+    {
+        auto const sameAdapter = [&](int64_t reqId, int64_t otherReqId)
+        {
+            for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+            {
+                auto const* ptrs = weightsPtrs[moduleIdx];
+                if (!sameWeights(ranks[moduleIdx][reqId], ptrs[reqId * 2], ptrs[reqId * 2 + 1],
+                        ranks[moduleIdx][otherReqId], ptrs[otherReqId * 2], ptrs[otherReqId * 2 + 1]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // A step has few distinct adapters, so find the group of each request by comparing it to the first request
+        // of each group.
+        mGroupLeaders.clear();
+        mReqGroups.resize(numReqs);
+        for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+        {
+            auto const group = std::find_if(mGroupLeaders.begin(), mGroupLeaders.end(),
+                [&](int64_t leader) { return sameAdapter(reqId, leader); });
+            mReqGroups[reqId] = group - mGroupLeaders.begin();
+            if (group == mGroupLeaders.end())
+            {
+                mGroupLeaders.push_back(reqId);
+            }
+        }
+        std::iota(mReqOrder.begin(), mReqOrder.end(), 0);
+        std::stable_sort(mReqOrder.begin(), mReqOrder.end(),
+            [this](int64_t lhs, int64_t rhs) { return mReqGroups[lhs] < mReqGroups[rhs]; });
+
+        TLLM_CHECK_WITH_INFO(mNumTokens <= std::numeric_limits<int32_t>::max(),
+            "Too many LoRA tokens to permute: %ld", mNumTokens);
+        mTokenPermutation.resize(mNumTokens);
+        int64_t dstToken = 0;
+        for (auto const reqId : mReqOrder)
+        {
+            auto const srcToken = mReqTokenBegin[reqId];
+            auto const numTokens = reqNumTokens[reqId];
+            mPermuted |= srcToken != dstToken && numTokens > 0;
+            std::iota(mTokenPermutation.begin() + dstToken, mTokenPermutation.begin() + dstToken + numTokens,
+                static_cast<int32_t>(srcToken));
+            dstToken += numTokens;
+        }
+        if (!mPermuted)
+        {
+            mTokenPermutation.clear();
+        }
+    }
+    else
+    {
+        std::iota(mReqOrder.begin(), mReqOrder.end(), 0);
+    }
+
+    for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+    {
+        auto const* moduleRanks = ranks[moduleIdx];
+        auto const* ptrs = weightsPtrs[moduleIdx];
+        for (auto const reqId : mReqOrder)
+        {
+            append(moduleIdx, ptrs[reqId * 2], ptrs[reqId * 2 + 1], moduleRanks[reqId], reqNumTokens[reqId]);
+        }
+    }
+}
+
+void LoraSegmentTable::buildFromTokens(
+    int32_t numModules, int64_t numTokens, int32_t const* ranks, void const* const* weightsPtrs)
+{
+    clear(numModules);
+    mNumTokens = numTokens;
+    for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+    {
+        auto const* moduleRanks = ranks + moduleIdx * numTokens;
+        auto const* ptrs = reinterpret_cast<int64_t const*>(weightsPtrs + moduleIdx * numTokens * 2);
+        for (int64_t tokenIdx = 0; tokenIdx < numTokens; ++tokenIdx)
+        {
+            append(moduleIdx, ptrs[tokenIdx * 2], ptrs[tokenIdx * 2 + 1], moduleRanks[tokenIdx], 1);
+        }
+    }
+}
+
+int64_t LoraSegmentTable::getNumProblems(int32_t moduleIdx) const
+{
+    auto const& segments = mSegments[moduleIdx];
+    return std::count_if(segments.begin(), segments.end(), [](LoraSegment const& segment) { return segment.rank > 0; });
+}
+
+} // namespace tensorrt_llm::kernels
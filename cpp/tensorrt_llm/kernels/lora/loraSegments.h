@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Contiguous tokens of a step that use the same LoRA weights of a module, i.e. one grouped GEMM problem.
+struct LoraSegment
+{
+    //! Pointers to the in and out weights of the adapter, as passed to the plugin.
+    int64_t inWeightsPtr;
+    int64_t outWeightsPtr;
+    int32_t rank;
+    //! First token of the segment, in the grouped order of the tokens if they are permuted.
+    int64_t tokenBegin;
+    int64_t numTokens;
+};
+
+//! \brief Table of the LoRA segments of each module for a step, built once from the per-request ranks and weight
+//! pointers instead of expanding them per token.
+//!
+//! Optionally, the requests are grouped by adapter: the requests with the same ranks and weights in all modules are
+//! moved next to the first of them, so that interleaved requests of an adapter make a single GEMM problem. The token
+//! permutation then gives the input token at each position of the grouped order.
+class LoraSegmentTable
+{
+public:
+    //! \brief Builds the segments of numModules modules for numReqs requests.
+    //! \param reqNumTokens number of tokens of each request [numReqs]
+    //! \param ranks ranks of each module for each request [numModules][numReqs]
+    //! \param weightsPtrs in and out weight pointers of each module for each request [numModules][numReqs, 2]
+    //! \param groupByAdapter whether to group the tokens of the requests using the same adapter
+    void build(int32_t numModules, int64_t numReqs, int64_t const* reqNumTokens, int32_t const* const* ranks,
+        int64_t const* const* weightsPtrs, bool groupByAdapter);
+
+    //! \brief Builds the segments from the per-token ranks and weight pointers of all modules, as taken by
+    //! LoraImpl::run, merging contiguous tokens that use the same weights.
+    //! \param ranks [numModules, numTokens]
+    //! \param weightsPtrs [numModules, numTokens, 2]
+    void buildFromTokens(int32_t numModules, int64_t numTokens, int32_t const* ranks, void const* const* weightsPtrs);
+
+    [[nodiscard]] std::vector<LoraSegment> const& getSegments(int32_t moduleIdx) const
+    {
+        return mSegments[moduleIdx];
+    }
+
+    [[nodiscard]] int32_t getNumModules() const
+    {
+        return static_cast<int32_t>(mSegments.size());
+    }
+
+    [[nodiscard]] int64_t getNumTokens() const
+    {
+        return mNumTokens;
+    }
+
+    //! \returns the number of GEMM problems of a module, i.e. its segments with a non-zero rank.
+    [[nodiscard]] int64_t getNumProblems(int32_t moduleIdx) const;
+
+    //! \returns whether the grouped order of the tokens differs from the input order.
+    [[nodiscard]] bool isPermuted() const
+    {
+        return mPermuted;
+    }
+
+    //! \returns the input token at each position of the grouped order [numTokens], only if the tokens are permuted.
+    [[nodiscard]] std::vector<int32_t> const& getTokenPermutation() const
+    {
+        return mTokenPermutation;
+    }
+
+private:
+    void clear(int32_t numModules);
+
+    //! Appends numTokens tokens to the segments of the module, merged with the last one if it uses the same weights.
+    void append(int32_t moduleIdx, int64_t inWeightsPtr, int64_t outWeightsPtr, int32_t rank, int64_t numTokens);
+
+    std::vector<std::vector<LoraSegment>> mSegments;
+    std::vector<int32_t> mTokenPermutation;
+    int64_t mNumTokens{0};
+    bool mPermuted{false};
+
+    // Scratch buffers reused across steps.
+    std::vector<int64_t> mReqOrder;
+    std::vector<int64_t> mReqTokenBegin;
+    std::vector<int64_t> mReqGroups;
+    std::vector<int64_t> mGroupLeaders;
+};
+
+} // namespace tensorrt_llm::kernels
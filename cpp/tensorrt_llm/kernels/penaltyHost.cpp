@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/penaltyHost.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <type_traits>
+
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+// Largest finite half, as in reduceKernelUtils.cuh.
+constexpr float kHalfFltMax = 65504.F;
+
+float toFloat(float value)
+{
+    return value;
+}
+
+float toFloat(half value)
+{
+    return __half2float(value);
+}
+
+template <typename T>
+T fromFloat(float value)
+{
+    if constexpr (std::is_same_v<T, half>)
+    {
+        return __float2half(value);
+    }
+    else
+    {
+        return value;
+    }
+}
+
+bool almostEqual(float a, float b, float epsilon)
+{
+    return std::fabs(a - b) < epsilon;
+}
+
+// Penalties of a request, as read by the kernel. Occurrences are counted only if a penalty uses them.
+struct SlotPenalties
+{
+    float invTemperature{layers::DefaultDecodingParams::getTemperature()};
+    float repetitionPenalty{layers::DefaultDecodingParams::getRepetitionPenalty()};
+    float presencePenalty{layers::DefaultDecodingParams::getPresencePenalty()};
+    float frequencyPenalty{layers::DefaultDecodingParams::getFrequencyPenalty()};
+    SizeType32 minLength{layers::DefaultDecodingParams::getMinLength()};
+    bool accumulateVocab{false};
+    bool hasTemperature{false};
+    bool hasMinLength{false};
+};
+
+template <typename T>
+SlotPenalties getSlotPenalties(InvokeBatchApplyPenaltyParams<T> const& params, SizeType32 batchSlot)
+{
+    using layers::DefaultDecodingParams;
+    SlotPenalties penalties;
+    if (params.temperatures != nullptr)
+    {
+        auto const temperature = params.temperatures[batchSlot];
+        penalties.invTemperature = 1.0f / (temperature + 1e-6f);
+        penalties.hasTemperature = !almostEqual(temperature, DefaultDecodingParams::getTemperature(), 1e-9);
+    }
+    if (params.repetitionPenalties != nullptr)
+    {
+        penalties.repetitionPenalty = params.repetitionPenalties[batchSlot];
+        penalties.accumulateVocab
+            |= !almostEqual(penalties.repetitionPenalty, DefaultDecodingParams::getRepetitionPenalty(), 1e-9);
+    }
+    if (params.presencePenalties != nullptr)
+    {
+        penalties.presencePenalty = params.presencePenalties[batchSlot];
+        penalties.accumulateVocab
+            |= !almostEqual(penalties.presencePenalty, DefaultDecodingParams::getPresencePenalty(), 1e-9);
+    }
+    if (params.frequencyPenalties != nullptr)
+    {
+        penalties.frequencyPenalty = params.frequencyPenalties[batchSlot];
+        penalties.accumulateVocab
+            |= !almostEqual(penalties.frequencyPenalty, DefaultDecodingParams::getFrequencyPenalty(), 1e-9);
+    }
+    if (params.minLengths != nullptr)
+    {
+        penalties.minLength = params.minLengths[batchSlot];
+        penalties.hasMinLength = penalties.minLength > 0;
+    }
+    return penalties;
+}
+
+// Counts the tokens of the context in the context phase, or adds the last token to the counts of the parent beam.
+template <typename T>
+void updateOccurrences(InvokeBatchApplyPenaltyParams<T> const& params, TokenIdType* workspace, SizeType32 batchIdx,
+    SizeType32 beamIdx, SizeType32 stepIdx)
+{
+    auto const capacity = params.occurrenceCapacity;
+    auto const workspaceSize = getOccurrenceWorkspaceSize(capacity, params.vocabSize);
+    auto const batchSlot = params.batchSlots[batchIdx];
+    auto const batchSlotBeamIdx = batchSlot * params.beamWidth + beamIdx;
+    auto const inputLen = params.inputLengths == nullptr ? SizeType32{0} : params.inputLengths[batchSlotBeamIdx];
+    auto const currentStep
+        = params.sequenceLengths == nullptr ? SizeType32{0} : params.sequenceLengths[batchSlotBeamIdx];
+    auto const* outputIds = params.outputIdsPtr[batchSlot] + beamIdx * params.maxSeqLen;
+
+    auto const addToken = [&](TokenIdType token)
+    {
+        if (token >= params.vocabSize)
+        {
+            return;
+        }
+        if (capacity > 0)
+        {
+            addOccurrence(workspace, capacity, token);
+        }
+        else
+        {
+            ++workspace[token];
+        }
+    };
+
+    if (currentStep <= inputLen)
+    {
+        if (capacity > 0)
+        {
+            for (SizeType32 index = 0; index < capacity; ++index)
+            {
+                clearOccurrences(workspace, capacity, index);
+            }
+        }
+        else
+        {
+            std::fill_n(workspace, params.vocabSize, 0);
+        }
+        std::for_each(outputIds, outputIds + inputLen, addToken);
+        return;
+    }
+    if (params.beamWidth > 1)
+    {
+        auto const parentBeam = params.parentIdsPtr[batchSlot][beamIdx * params.maxSeqLen + currentStep - 1];
+        auto const parentIdx = (batchIdx * params.beamWidth + parentBeam) * params.maxTokensPerStep + stepIdx;
+        std::copy_n(params.penaltyWorkspacePrev + parentIdx * workspaceSize, workspaceSize, workspace);
+    }
+    addToken(outputIds[currentStep - 1]);
+}
+
+} // namespace
+
+template <typename T>
+void invokeBatchApplyPenaltyHost(InvokeBatchApplyPenaltyParams<T> const& params)
+{
+    auto const capacity = params.occurrenceCapacity;
+    TLLM_CHECK_WITH_INFO(
+        (capacity & (capacity - 1)) == 0, "Occurrence capacity must be 0 or a power of 2, got %d", capacity);
+    auto const workspaceSize = getOccurrenceWorkspaceSize(capacity, params.vocabSize);
+    float const maskVal = std::is_same_v<T, half> ? -kHalfFltMax : -FLT_MAX;
+
+    for (SizeType32 batchIdx = 0; batchIdx < params.batchSize; ++batchIdx)
+    {
+        auto const batchSlot = params.batchSlots[batchIdx];
+        auto const penalties = getSlotPenalties(params, batchSlot);
+        auto const numSteps
+            = params.tokensPerStep == nullptr ? params.maxTokensPerStep : params.tokensPerStep[batchSlot];
+        auto const* bias = params.biases == nullptr ? nullptr : params.biases + batchSlot * params.vocabSizePadded;
+        for (SizeType32 beamIdx = 0; beamIdx < params.beamWidth; ++beamIdx)
+        {
+            for (SizeType32 stepIdx = 0; stepIdx < numSteps; ++stepIdx)
+            {
+                auto const batchBeamStepIdx
+                    = (batchIdx * params.beamWidth + beamIdx) * params.maxTokensPerStep + stepIdx;
+                auto* workspace = params.penaltyWorkspace + batchBeamStepIdx * workspaceSize;
+                if (penalties.accumulateVocab)
+                {
+                    updateOccurrences(params, workspace, batchIdx, beamIdx, stepIdx);
+                }
+
+                auto const* inLogits = params.inputLogits[batchIdx]
+                    + (beamIdx * params.maxTokensPerStep + stepIdx) * params.vocabSizePadded;
+                auto* outLogits = params.outputLogits + batchBeamStepIdx * params.vocabSizePadded;
+                auto const computeLogit = [&](SizeType32 index, SizeType32 numOccurrences)
+                {
+                    auto logit = toFloat(inLogits[index]);
+                    if (bias != nullptr)
+                    {
+                        logit += toFloat(bias[index]);
+                    }
+                    if (penalties.hasTemperature)
+                    {
+                        logit *= penalties.invTemperature;
+                    }
+                    if (numOccurrences > 0)
+                    {
+                        logit = applyOccurrencePenalties(logit, numOccurrences, penalties.repetitionPenalty,
+                            penalties.presencePenalty, penalties.frequencyPenalty);
+                    }
+                    // do clamp to prevent overflow
+                    return fromFloat<T>(std::min(std::max(logit, maskVal), -maskVal));
+                };
+                auto const denseOccurrences = penalties.accumulateVocab && capacity == 0;
+                for (SizeType32 index = 0; index < params.vocabSize; ++index)
+                {
+                    outLogits[index] = computeLogit(index, denseOccurrences ? workspace[index] : 0);
+                }
+                if (penalties.accumulateVocab && capacity > 0)
+                {
+                    // Recompute the logits of the tokens that occurred, from the entries of the sparse table.
+                    for (SizeType32 slot = 0; slot < capacity; ++slot)
+                    {
+                        if (auto const key = workspace[slot]; key > 0)
+                        {
+                            outLogits[key - 1] = computeLogit(key - 1, workspace[capacity + slot]);
+                        }
+                    }
+                }
+                std::fill(outLogits + params.vocabSize, outLogits + params.vocabSizePadded, fromFloat<T>(maskVal));
+
+                auto const batchSlotBeamIdx = batchSlot * params.beamWidth + beamIdx;
+                auto const inputLen
+                    = params.inputLengths == nullptr ? SizeType32{0} : params.inputLengths[batchSlotBeamIdx];
+                auto const currentStep
+                    = params.sequenceLengths == nullptr ? SizeType32{0} : params.sequenceLengths[batchSlotBeamIdx];
+                if (penalties.hasMinLength && currentStep - inputLen < penalties.minLength)
+                {
+                    outLogits[params.endIds[batchSlot]] = fromFloat<T>(maskVal);
+                }
+            }
+        }
+    }
+}
+
+template void invokeBatchApplyPenaltyHost(InvokeBatchApplyPenaltyParams<float> const& params);
+template void invokeBatchApplyPenaltyHost(InvokeBatchApplyPenaltyParams<half> const& params);
+
+} // namespace tensorrt_llm::kernels
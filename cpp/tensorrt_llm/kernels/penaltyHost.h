@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/penaltyKernels.h"
+
+namespace tensorrt_llm::kernels
+{
+
+// Host implementation of invokeBatchApplyPenalty. It takes the same params, with all pointers in host memory, and
+// produces the same output logits and occurrence workspace, dense or sparse. It is the reference of the kernel and of
+// the sparse occurrence tables, which must give the same logits as the dense counts.
+template <typename T>
+void invokeBatchApplyPenaltyHost(InvokeBatchApplyPenaltyParams<T> const& params);
+
+} // namespace tensorrt_llm::kernels
@@ -43,7 +43,7 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     SizeType32 maxSeqLen, SizeType32 vocabSize, SizeType32 vocabSizePadded, TokenIdType const** outputIdsPtr,
     SizeType32 const** parentIdsPtr, SizeType32 const* inputLengths, SizeType32 const* sequenceLengths,
     SizeType32 const* minLengths, TokenIdType const* endIds, SizeType32 const* batchSlots,
-    SizeType32 const* tokensPerStep)
+    SizeType32 const* tokensPerStep, SizeType32 occurrenceCapacity)
 {
     auto const beamWidth = static_cast<SizeType32>(gridDim.y);
     auto const maxTokensPerStep = static_cast<SizeType32>(gridDim.z);
@@ -56,6 +56,7 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     auto const inputLen = inputLengths == nullptr ? SizeType32{0} : inputLengths[batchSlotBeamIdx];
     auto const currentStep = sequenceLengths == nullptr ? SizeType32{0} : sequenceLengths[batchSlotBeamIdx];
     T const* biasBase = biases + batchSlot * vocabSizePadded;
+    auto const occurrenceWorkspaceSize = getOccurrenceWorkspaceSize(occurrenceCapacity, vocabSize);
 
     if (tokensPerStep != nullptr && stepIdx >= tokensPerStep[batchSlot])
     {
@@ -101,13 +102,24 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     // Initialize or update the number of occurrences of tokens
     if (accumulateVocab)
     {
-        penaltyWorkspace += batchBeamStepIdx * vocabSize;
+        penaltyWorkspace += batchBeamStepIdx * occurrenceWorkspaceSize;
         if (currentStep <= inputLen)
         { // Context phase
-            for (auto index = static_cast<SizeType32>(threadIdx.x); index < vocabSize;
-                 index += static_cast<SizeType32>(blockDim.x))
+            if (occurrenceCapacity > 0)
             {
-                penaltyWorkspace[index] = 0;
+                for (auto index = static_cast<SizeType32>(threadIdx.x); index < occurrenceCapacity;
+                     index += static_cast<SizeType32>(blockDim.x))
+                {
+                    clearOccurrences(penaltyWorkspace, occurrenceCapacity, index);
+                }
+            }
+            else
+            {
+                for (auto index = static_cast<SizeType32>(threadIdx.x); index < vocabSize;
+                     index += static_cast<SizeType32>(blockDim.x))
+                {
+                    penaltyWorkspace[index] = 0;
+                }
             }
             __syncthreads();
             for (auto step = static_cast<SizeType32>(threadIdx.x); step < inputLen;
@@ -117,7 +129,14 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
                 auto penaltyIndex = outputIdsPtr[batchSlot][beamIdx * maxSeqLen + step];
                 if (penaltyIndex < vocabSize)
                 {
-                    atomicAdd(&penaltyWorkspace[penaltyIndex], 1);
+                    if (occurrenceCapacity > 0)
+                    {
+                        addOccurrence(penaltyWorkspace, occurrenceCapacity, penaltyIndex);
+                    }
+                    else
+                    {
+                        atomicAdd(&penaltyWorkspace[penaltyIndex], 1);
+                    }
                 }
             }
         }
@@ -126,8 +145,9 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
             if (beamWidth > 1)
             {
                 auto parentBeam = parentIdsPtr[batchSlot][beamIdx * maxSeqLen + currentStep - 1];
-                penaltyWorkspacePrev += ((batchIdx * beamWidth + parentBeam) * maxTokensPerStep + stepIdx) * vocabSize;
-                for (auto index = static_cast<SizeType32>(threadIdx.x); index < vocabSize;
+                penaltyWorkspacePrev += ((batchIdx * beamWidth + parentBeam) * maxTokensPerStep + stepIdx)
+                    * occurrenceWorkspaceSize;
+                for (auto index = static_cast<SizeType32>(threadIdx.x); index < occurrenceWorkspaceSize;
                      index += static_cast<SizeType32>(blockDim.x))
                 {
                     penaltyWorkspace[index] = penaltyWorkspacePrev[index];
@@ -139,7 +159,14 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
                 auto penaltyIndex = outputIdsPtr[batchSlot][beamIdx * maxSeqLen + currentStep - 1];
                 if (penaltyIndex < vocabSize)
                 {
-                    penaltyWorkspace[penaltyIndex] += 1;
+                    if (occurrenceCapacity > 0)
+                    {
+                        addOccurrence(penaltyWorkspace, occurrenceCapacity, penaltyIndex);
+                    }
+                    else
+                    {
+                        penaltyWorkspace[penaltyIndex] += 1;
+                    }
                 }
             }
         }
@@ -150,60 +177,62 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     auto const inLogitsPtr = inputLogits[batchIdx] + (beamIdx * maxTokensPerStep + stepIdx) * vocabSizePadded;
     auto outLogitsPtr = outputLogits + batchBeamStepIdx * vocabSizePadded;
     T const MASK_VAL = (std::is_same<T, half>::value) ? -HALF_FLT_MAX : -FLT_MAX;
+    auto const computeLogit = [&](SizeType32 index, SizeType32 numOccurences)
+    {
+        auto logit = static_cast<float>(inLogitsPtr[index]);
+        // Bias
+        if (biases != nullptr)
+        {
+            logit += static_cast<float>(biasBase[index]);
+        }
+        // Temperature
+        if (hasTemperature)
+        {
+            logit *= invTemperature;
+        }
+        if (numOccurences > 0)
+        {
+            logit = applyOccurrencePenalties(
+                logit, numOccurences, repetitionPenalty, presencePenalty, frequencyPenalty);
+        }
+        // do clamp to prevent overflow
+        if (logit > static_cast<float>(-MASK_VAL))
+        {
+            logit = static_cast<float>(-MASK_VAL);
+        }
+        else if (logit < static_cast<float>(MASK_VAL))
+        {
+            logit = static_cast<float>(MASK_VAL);
+        }
+        return logit;
+    };
+    auto const denseOccurrences = accumulateVocab && occurrenceCapacity == 0;
     for (auto index = static_cast<SizeType32>(threadIdx.x); index < vocabSizePadded;
          index += static_cast<SizeType32>(blockDim.x))
     {
         if (index < vocabSize)
         {
-            auto logit = static_cast<float>(inLogitsPtr[index]);
-            // Bias
-            if (biases != nullptr)
-            {
-                logit += static_cast<float>(biasBase[index]);
-            }
-            // Temperature
-            if (hasTemperature)
-            {
-                logit *= invTemperature;
-            }
-            if (accumulateVocab)
-            {
-                SizeType32 numOccurences = penaltyWorkspace[index];
-                if (numOccurences > 0)
-                {
-                    // Repetition
-                    if (repetitionPenalties != nullptr)
-                    {
-                        logit = logit < 0.0f ? logit * repetitionPenalty : logit / repetitionPenalty;
-                    }
-                    // Presence
-                    if (presencePenalties != nullptr)
-                    {
-                        logit -= presencePenalty;
-                    }
-                    // Frequency
-                    if (frequencyPenalties != nullptr)
-                    {
-                        logit -= frequencyPenalty * numOccurences;
-                    }
-                }
-            }
-            // do clamp to prevent overflow
-            if (logit > static_cast<float>(-MASK_VAL))
-            {
-                logit = static_cast<float>(-MASK_VAL);
-            }
-            else if (logit < static_cast<float>(MASK_VAL))
-            {
-                logit = static_cast<float>(MASK_VAL);
-            }
-            outLogitsPtr[index] = logit;
+            outLogitsPtr[index] = computeLogit(index, denseOccurrences ? penaltyWorkspace[index] : 0);
         }
         else
         {
             outLogitsPtr[index] = MASK_VAL;
         }
     }
+    if (accumulateVocab && occurrenceCapacity > 0)
+    {
+        // Recompute the logits of the tokens that occurred, from the entries of the sparse table.
+        __syncthreads();
+        for (auto slot = static_cast<SizeType32>(threadIdx.x); slot < occurrenceCapacity;
+             slot += static_cast<SizeType32>(blockDim.x))
+        {
+            auto const key = penaltyWorkspace[slot];
+            if (key > 0)
+            {
+                outLogitsPtr[key - 1] = computeLogit(key - 1, penaltyWorkspace[occurrenceCapacity + slot]);
+            }
+        }
+    }
     if (hasMinLength)
     {
         __syncthreads();
@@ -225,7 +254,7 @@ void invokeBatchApplyPenalty(InvokeBatchApplyPenaltyParams<T> const& params)
         params.penaltyWorkspace, params.penaltyWorkspacePrev, params.temperatures, params.repetitionPenalties,
         params.presencePenalties, params.frequencyPenalties, params.maxSeqLen, params.vocabSize, params.vocabSizePadded,
         params.outputIdsPtr, params.parentIdsPtr, params.inputLengths, params.sequenceLengths, params.minLengths,
-        params.endIds, params.batchSlots, params.tokensPerStep);
+        params.endIds, params.batchSlots, params.tokensPerStep, params.occurrenceCapacity);
 }
 
 template void invokeBatchApplyPenalty(InvokeBatchApplyPenaltyParams<float> const& params);
@@ -21,6 +21,9 @@
 #include "tensorrt_llm/kernels/penaltyTypes.h"
 #include "tensorrt_llm/runtime/common.h"
 
+#include <algorithm>
+#include <cstdint>
+
 namespace tensorrt_llm
 {
 namespace kernels
@@ -53,8 +56,104 @@ struct InvokeBatchApplyPenaltyParams
     runtime::SizeType32 maxTokensPerStep;
     runtime::SizeType32 const* tokensPerStep;
     cudaStream_t stream;
+    //! Capacity of the sparse occurrence table of each sequence, 0 for dense counts over the vocabulary.
+    runtime::SizeType32 occurrenceCapacity{0};
 };
 
+//! \brief Capacity of the sparse occurrence table of a sequence of up to maxSeqLen tokens, 0 if the dense counts over
+//! the vocabulary take less memory. The table holds at most half as many distinct tokens as its capacity.
+inline runtime::SizeType32 getOccurrenceCapacity(runtime::SizeType32 maxSeqLen, runtime::SizeType32 vocabSize)
+{
+    runtime::SizeType32 capacity = 1;
+    while (capacity < 2 * std::min(maxSeqLen, vocabSize))
+    {
+        capacity *= 2;
+    }
+    // The table holds a key and a count per entry.
+    return 2 * capacity < vocabSize ? capacity : 0;
+}
+
+//! \brief Number of TokenIdType of the occurrence workspace of a sequence.
+__host__ __device__ inline runtime::SizeType32 getOccurrenceWorkspaceSize(
+    runtime::SizeType32 occurrenceCapacity, runtime::SizeType32 vocabSize)
+{
+    return occurrenceCapacity > 0 ? 2 * occurrenceCapacity : vocabSize;
+}
+
+//! The sparse occurrence table of a sequence is an open addressing hash table with linear probing, made of
+//! occurrenceCapacity keys followed by their counts. The key of a token is token + 1, so that a zeroed table is empty.
+//! Tokens are never removed.
+__host__ __device__ inline runtime::SizeType32 getOccurrenceSlot(
+    runtime::TokenIdType token, runtime::SizeType32 occurrenceCapacity)
+{
+    return static_cast<runtime::SizeType32>(static_cast<uint32_t>(token) * 2654435761u) & (occurrenceCapacity - 1);
+}
+
+__host__ __device__ inline void clearOccurrences(
+    runtime::TokenIdType* table, runtime::SizeType32 occurrenceCapacity, runtime::SizeType32 index)
+{
+    table[index] = 0;
+    table[occurrenceCapacity + index] = 0;
+}
+
+//! \brief Count one more occurrence of token, atomically on the device. Dropped if the table is full.
+__host__ __device__ inline void addOccurrence(
+    runtime::TokenIdType* table, runtime::SizeType32 occurrenceCapacity, runtime::TokenIdType token)
+{
+    auto slot = getOccurrenceSlot(token, occurrenceCapacity);
+    for (runtime::SizeType32 probe = 0; probe < occurrenceCapacity; ++probe)
+    {
+#ifdef __CUDA_ARCH__
+        auto const key = atomicCAS(&table[slot], 0, token + 1);
+#else
+        auto const key = table[slot];
+        if (key == 0)
+        {
+            table[slot] = token + 1;
+        }
+#endif
+        if (key == 0 || key == token + 1)
+        {
+#ifdef __CUDA_ARCH__
+            atomicAdd(&table[occurrenceCapacity + slot], 1);
+#else
+            ++table[occurrenceCapacity + slot];
+#endif
+            return;
+        }
+        slot = (slot + 1) & (occurrenceCapacity - 1);
+    }
+}
+
+__host__ __device__ inline runtime::SizeType32 findOccurrences(
+    runtime::TokenIdType const* table, runtime::SizeType32 occurrenceCapacity, runtime::TokenIdType token)
+{
+    auto slot = getOccurrenceSlot(token, occurrenceCapacity);
+    for (runtime::SizeType32 probe = 0; probe < occurrenceCapacity; ++probe)
+    {
+        auto const key = table[slot];
+        if (key == token + 1)
+        {
+            return table[occurrenceCapacity + slot];
+        }
+        if (key == 0)
+        {
+            break;
+        }
+        slot = (slot + 1) & (occurrenceCapacity - 1);
+    }
+    return 0;
+}
+
+//! \brief Repetition, presence and frequency penalties of the logit of a token that occurred numOccurrences > 0 times.
+//! The default penalties leave the logit unchanged.
+__host__ __device__ inline float applyOccurrencePenalties(float logit, runtime::SizeType32 numOccurrences,
+    float repetitionPenalty, float presencePenalty, float frequencyPenalty)
+{
+    logit = logit < 0.0f ? logit * repetitionPenalty : logit / repetitionPenalty;
+    return logit - presencePenalty - frequencyPenalty * numOccurrences;
+}
+
 template <typename T>
 void invokeBatchApplyPenalty(InvokeBatchApplyPenaltyParams<T> const& params);
 
@@ -58,12 +58,14 @@ class DecoderDomain
 public:
     DecoderDomain(runtime::SizeType32 batchSize, runtime::SizeType32 beamWidth, runtime::SizeType32 vocabSize,
         std::optional<runtime::SizeType32> vocabSizePadded = std::nullopt,
-        std::shared_ptr<runtime::SpeculativeDecodingModule const> speculativeDecodingModule = nullptr)
+        std::shared_ptr<runtime::SpeculativeDecodingModule const> speculativeDecodingModule = nullptr,
+        std::optional<runtime::SizeType32> maxSequenceLength = std::nullopt)
         : mBatchSize(batchSize)
         , mBeamWidth(beamWidth)
         , mVocabSize(vocabSize)
         , mVocabSizePadded(vocabSizePadded.value_or(vocabSize))
         , mSpeculativeDecodingModule(std::move(speculativeDecodingModule))
+        , mMaxSequenceLength(maxSequenceLength)
     {
     }
 
@@ -103,12 +105,19 @@ public:
         return mSpeculativeDecodingModule;
     }
 
+    //! @returns the max sequence length of the output ids, if known when the layers are constructed
+    [[nodiscard]] std::optional<runtime::SizeType32> getMaxSequenceLength() const
+    {
+        return mMaxSequenceLength;
+    }
+
 private:
     runtime::SizeType32 mBatchSize;
     runtime::SizeType32 mBeamWidth;
     runtime::SizeType32 mVocabSize;
     runtime::SizeType32 mVocabSizePadded;
     std::shared_ptr<runtime::SpeculativeDecodingModule const> mSpeculativeDecodingModule;
+    std::optional<runtime::SizeType32> mMaxSequenceLength;
 };
 
 class BaseSetupParams
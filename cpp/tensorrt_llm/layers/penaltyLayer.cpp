@@ -23,6 +23,8 @@
 #include "tensorrt_llm/runtime/bufferManager.h"
 
 #include <algorithm>
+#include <array>
+#include <type_traits>
 
 using namespace tensorrt_llm::common;
 using namespace tensorrt_llm::kernels;
@@ -42,6 +44,7 @@ PenaltyLayer<T>::PenaltyLayer(executor::DecodingMode const& mode, DecoderDomain
     std::shared_ptr<BufferManager> bufferManager)
     : BaseLayer(decoderDomain, bufferManager)
     , mDecodingMode(mode)
+    , mActivePenaltySlots(decoderDomain.getBatchSize())
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
 
@@ -78,14 +81,21 @@ void PenaltyLayer<T>::allocateWorkspace()
 
     if (mDecodingMode.isUseOccurrencePenalty())
     {
-
+        // Sequences touch few distinct tokens of large vocabularies, count them in sparse tables if that is smaller.
+        // Without a known max sequence length, the counts are dense.
+        auto const maxSequenceLength = mDecoderDomain.getMaxSequenceLength();
+        mOccurrenceCapacity
+            = maxSequenceLength ? getOccurrenceCapacity(*maxSequenceLength, mDecoderDomain.getVocabSize()) : 0;
         auto const workspaceSize = mDecoderDomain.getBatchSize() * mDecoderDomain.getMaxDecodingTokens()
-            * mConfiguredBeamWidth * mDecoderDomain.getVocabSize();
+            * mConfiguredBeamWidth * getOccurrenceWorkspaceSize(mOccurrenceCapacity, mDecoderDomain.getVocabSize());
         mPenaltyWorkspaceDevice = mBufferManager->gpu(workspaceSize, nvinfer1::DataType::kINT32);
+        // Zeroed sparse tables are empty.
+        mBufferManager->setZero(*mPenaltyWorkspaceDevice);
 
         if (mDecodingMode.isBeamSearch())
         {
             mPenaltyWorkspacePrevDevice = mBufferManager->gpu(workspaceSize, nvinfer1::DataType::kINT32);
+            mBufferManager->setZero(*mPenaltyWorkspacePrevDevice);
         }
     }
 
@@ -126,6 +136,22 @@ void PenaltyLayer<T>::allocateBuffer()
         mMinLengthDevice = mBufferManager->gpu(batchSizeShape, nvinfer1::DataType::kINT32);
     }
 
+    // Every slot starts without active penalties, so holds the default values.
+    auto const fillDefault = [this](auto const defaultValue, TensorPtr const& hostBuffer, TensorPtr const& deviceBuffer)
+    {
+        auto hostRange = BufferRange<std::remove_const_t<decltype(defaultValue)>>(*hostBuffer);
+        std::fill(hostRange.begin(), hostRange.end(), defaultValue);
+        if (deviceBuffer)
+        {
+            mBufferManager->copy(*hostBuffer, *deviceBuffer);
+        }
+    };
+    fillDefault(DefaultDecodingParams::getTemperature(), mTemperature, mTemperatureDevice);
+    fillDefault(DefaultDecodingParams::getRepetitionPenalty(), mRepetitionPenalty, mRepetitionPenaltyDevice);
+    fillDefault(DefaultDecodingParams::getPresencePenalty(), mPresencePenalty, mPresencePenaltyDevice);
+    fillDefault(DefaultDecodingParams::getFrequencyPenalty(), mFrequencyPenalty, mFrequencyPenaltyDevice);
+    fillDefault(DefaultDecodingParams::getMinLength(), mMinLength, mMinLengthDevice);
+
     auto const logitsPtrDeviceDesc = std::make_pair(batchSizeShape, TRTDataType<T*>::value);
     mWorkspaceSize = DecodingLayerWorkspace::calculateRequiredWorkspaceSize(logitsPtrDeviceDesc);
 
@@ -158,46 +184,60 @@ void PenaltyLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorCo
     auto const& penaltyParams = setupParams->penaltyParams;
     TLLM_CHECK_WITH_INFO(penaltyParams, "penaltyParams for setup is not set");
 
-    bool const useTemperature = mDecodingMode.isUseTemperature() && penaltyParams->temperature.has_value();
-    bool const useRepetitionPenalty
-        = mDecodingMode.isUseRepetitionPenalty() && penaltyParams->repetitionPenalty.has_value();
-    bool const usePresencePenalty = mDecodingMode.isUsePresencePenalty() && penaltyParams->presencePenalty.has_value();
-    bool const useFrequencyPenalty
-        = mDecodingMode.isUseFrequencyPenalty() && penaltyParams->frequencyPenalty.has_value();
-    bool const useMinLength = mDecodingMode.isUseMinLength() && penaltyParams->minLength.has_value();
-    // FIXME(nkorobov): once one of the requests has some penalty, we will always have to compute it.
-    // To avoid that we need to scan through all active requests at each iteration.
-    mUseTemperature |= useTemperature;
-    mUseRepetitionPenalty |= useRepetitionPenalty;
-    mUsePresencePenalty |= usePresencePenalty;
-    mUseFrequencyPenalty |= useFrequencyPenalty;
-    mUseMinLength |= useMinLength;
-
-    if (mUseTemperature)
+    // The new requests replace the ones in their slots, whose penalties no longer apply.
+    auto const* batchSlotsHost = bufferCast<SizeType32>(*batchSlots);
+    std::array<bool, ActivePenaltySlots::kNumPenaltyTypes> wasActive{};
+    for (SizeType32 type = 0; type < ActivePenaltySlots::kNumPenaltyTypes; ++type)
     {
-        fillBuffers(penaltyParams->temperature, DefaultDecodingParams::getTemperature(), mTemperature,
-            mTemperatureDevice, batchSlots, getLimitsPenalty(DecodingPenaltyType::Temperature), "temperature penalty");
+        wasActive[type]
+            = mActivePenaltySlots.isActive(static_cast<DecodingPenaltyType>(type), batchSlotsHost, batchSize);
     }
-    if (mUseRepetitionPenalty)
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
     {
-        fillBuffers(penaltyParams->repetitionPenalty, DefaultDecodingParams::getRepetitionPenalty(), mRepetitionPenalty,
-            mRepetitionPenaltyDevice, batchSlots, getLimitsPenalty(DecodingPenaltyType::Repetition),
+        mActivePenaltySlots.release(batchSlotsHost[bi]);
+    }
+
+    // Slots without an active penalty hold its default value, since the kernel reads the values of all requests of a
+    // step with an active penalty. The values are filled only if a new request sets the penalty, or if a slot has to
+    // be reset to the default.
+    auto const setupPenalty = [&](DecodingPenaltyType type, auto const& optParam, auto const defaultValue,
+                                  TensorPtr const& hostBuffer, TensorPtr const& deviceBuffer, char const* name)
+    {
+        if (!optParam && !wasActive[static_cast<SizeType32>(type)])
+        {
+            return;
+        }
+        fillBuffers(optParam, defaultValue, hostBuffer, deviceBuffer, batchSlots, getLimitsPenalty(type), name);
+        mActivePenaltySlots.set(type, batchSlotsHost, batchSize,
+            bufferCast<std::remove_const_t<decltype(defaultValue)>>(*hostBuffer), defaultValue);
+    };
+
+    if (mDecodingMode.isUseTemperature())
+    {
+        setupPenalty(DecodingPenaltyType::Temperature, penaltyParams->temperature,
+            DefaultDecodingParams::getTemperature(), mTemperature, mTemperatureDevice, "temperature penalty");
+    }
+    if (mDecodingMode.isUseRepetitionPenalty())
+    {
+        setupPenalty(DecodingPenaltyType::Repetition, penaltyParams->repetitionPenalty,
+            DefaultDecodingParams::getRepetitionPenalty(), mRepetitionPenalty, mRepetitionPenaltyDevice,
             "repetition penalty");
     }
-    if (mUsePresencePenalty)
+    if (mDecodingMode.isUsePresencePenalty())
     {
-        fillBuffers(penaltyParams->presencePenalty, DefaultDecodingParams::getPresencePenalty(), mPresencePenalty,
-            mPresencePenaltyDevice, batchSlots, getLimitsPenalty(DecodingPenaltyType::Presence), "presence penalty");
+        setupPenalty(DecodingPenaltyType::Presence, penaltyParams->presencePenalty,
+            DefaultDecodingParams::getPresencePenalty(), mPresencePenalty, mPresencePenaltyDevice, "presence penalty");
     }
-    if (mUseFrequencyPenalty)
+    if (mDecodingMode.isUseFrequencyPenalty())
     {
-        fillBuffers(penaltyParams->frequencyPenalty, DefaultDecodingParams::getFrequencyPenalty(), mFrequencyPenalty,
-            mFrequencyPenaltyDevice, batchSlots, getLimitsPenalty(DecodingPenaltyType::Frequency), "frequency penalty");
+        setupPenalty(DecodingPenaltyType::Frequency, penaltyParams->frequencyPenalty,
+            DefaultDecodingParams::getFrequencyPenalty(), mFrequencyPenalty, mFrequencyPenaltyDevice,
+            "frequency penalty");
     }
-    if (mUseMinLength)
+    if (mDecodingMode.isUseMinLength())
     {
-        fillBuffers(penaltyParams->minLength, DefaultDecodingParams::getMinLength(), mMinLength, mMinLengthDevice,
-            batchSlots, getLimitsPenalty(DecodingPenaltyType::MinLength), "min length");
+        setupPenalty(DecodingPenaltyType::MinLength, penaltyParams->minLength, DefaultDecodingParams::getMinLength(),
+            mMinLength, mMinLengthDevice, "min length");
     }
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
@@ -222,6 +262,9 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
             ITensor::makeShape({static_cast<int32_t>(maxSeqLen), static_cast<int32_t>(mDecoderDomain.getBatchSize())}));
         mRuntimeMaxSeqLen = maxSeqLen;
     }
+    TLLM_CHECK_WITH_INFO(mOccurrenceCapacity == 0 || maxSeqLen <= mDecoderDomain.getMaxSequenceLength().value(),
+        "Max sequence length of the output ids (%d) exceeds the one the occurrence tables are sized for (%d)",
+        static_cast<SizeType32>(maxSeqLen), mDecoderDomain.getMaxSequenceLength().value());
 
     mCyclicStep = mCyclicStep % mRuntimeMaxSeqLen;
 
@@ -248,20 +291,18 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
     auto const* inputLengths = bufferCastOrNull<SizeType32>(params->inputLengths);
     auto embeddingBias = bufferCastOrNull<T>(params->embeddingBias);
     auto const* batchSlotsHostPtr = bufferCast<SizeType32>(*params->batchSlots);
-#define GET_PENALTIES(capital_name, type)                                                                              \
-    (mUse##capital_name                                                                                                \
-        && !allOfBatchSlots(batchSlotsHostPtr, bufferCast<type>(*m##capital_name), localDecoderDomain.getBatchSize(),  \
-            DefaultDecodingParams::get##capital_name()))                                                               \
-        ? m##capital_name##Device                                                                                      \
-        : nullptr;
-
-    auto temperatures = GET_PENALTIES(Temperature, float);
-    auto repetitionPenalties = GET_PENALTIES(RepetitionPenalty, float);
-    auto presencePenalties = GET_PENALTIES(PresencePenalty, float);
-    auto frequencyPenalties = GET_PENALTIES(FrequencyPenalty, float);
-    auto minLengths = GET_PENALTIES(MinLength, SizeType32);
+    auto const getPenalties = [&](DecodingPenaltyType type, TensorPtr const& penaltiesDevice)
+    {
+        return mActivePenaltySlots.isActive(type, batchSlotsHostPtr, localDecoderDomain.getBatchSize())
+            ? penaltiesDevice
+            : nullptr;
+    };
 
-#undef GET_PENALTIES
+    auto temperatures = getPenalties(DecodingPenaltyType::Temperature, mTemperatureDevice);
+    auto repetitionPenalties = getPenalties(DecodingPenaltyType::Repetition, mRepetitionPenaltyDevice);
+    auto presencePenalties = getPenalties(DecodingPenaltyType::Presence, mPresencePenaltyDevice);
+    auto frequencyPenalties = getPenalties(DecodingPenaltyType::Frequency, mFrequencyPenaltyDevice);
+    auto minLengths = getPenalties(DecodingPenaltyType::MinLength, mMinLengthDevice);
 
     auto* const tokensPerStep = bufferCastOrNull<SizeType32>(params->curTokensPerStep);
 
@@ -294,6 +335,7 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
     penaltyParams.maxTokensPerStep = mDecoderDomain.getMaxDecodingTokens();
     penaltyParams.tokensPerStep = tokensPerStep;
     penaltyParams.stream = getStream();
+    penaltyParams.occurrenceCapacity = mOccurrenceCapacity;
 
     if (penaltyParams.beamWidth > 1)
     {
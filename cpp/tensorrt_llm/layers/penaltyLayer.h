@@ -22,6 +22,7 @@
 #include "tensorrt_llm/executor/types.h"
 #include "tensorrt_llm/layers/baseLayer.h"
 #include "tensorrt_llm/layers/decodingParams.h"
+#include "tensorrt_llm/layers/penaltySlots.h"
 
 namespace tensorrt_llm::layers
 {
@@ -74,15 +75,14 @@ private:
     TensorPtr mFrequencyPenalty;
     TensorPtr mMinLength;
 
-    bool mUseTemperature{false};
-    bool mUseRepetitionPenalty{false};
-    bool mUsePresencePenalty{false};
-    bool mUseFrequencyPenalty{false};
-    bool mUseMinLength{false};
+    //! Penalties set by the request of each slot, to skip the penalties that no request of a step uses.
+    ActivePenaltySlots mActivePenaltySlots;
 
     runtime::SizeType32 mCyclicStep{0};
     runtime::SizeType32 mRuntimeMaxSeqLen{0};
     runtime::SizeType32 mConfiguredBeamWidth{-1};
+    //! Capacity of the sparse occurrence tables, 0 for dense occurrence counts.
+    runtime::SizeType32 mOccurrenceCapacity{0};
 
     BufferPtr mPenaltyWorkspaceDevice;
     BufferPtr mPenaltyWorkspacePrevDevice;
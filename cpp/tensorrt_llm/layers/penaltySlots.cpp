@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/layers/penaltySlots.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::layers
+{
+
+ActivePenaltySlots::ActivePenaltySlots(SizeType32 maxBatchSize)
+    : mMasks(maxBatchSize, 0)
+{
+    TLLM_CHECK_WITH_INFO(maxBatchSize > 0, "maxBatchSize must be positive, got %d", maxBatchSize);
+}
+
+void ActivePenaltySlots::set(SizeType32 slot, DecodingPenaltyType type, bool active)
+{
+    TLLM_CHECK_WITH_INFO(0 <= slot && slot < static_cast<SizeType32>(mMasks.size()),
+        "Slot %d is out of range [0, %zu)", slot, mMasks.size());
+    auto const bit = getBit(type);
+    auto& mask = mMasks[slot];
+    auto const wasActive = (mask & bit) != 0;
+    if (active == wasActive)
+    {
+        return;
+    }
+    mask ^= bit;
+    mNumActive[static_cast<SizeType32>(type)] += active ? 1 : -1;
+}
+
+void ActivePenaltySlots::release(SizeType32 slot)
+{
+    for (SizeType32 type = 0; type < kNumPenaltyTypes; ++type)
+    {
+        set(slot, static_cast<DecodingPenaltyType>(type), false);
+    }
+}
+
+bool ActivePenaltySlots::isActive(SizeType32 slot, DecodingPenaltyType type) const
+{
+    return (mMasks[slot] & getBit(type)) != 0;
+}
+
+SizeType32 ActivePenaltySlots::getNumActive(DecodingPenaltyType type) const
+{
+    return mNumActive[static_cast<SizeType32>(type)];
+}
+
+bool ActivePenaltySlots::isActive(DecodingPenaltyType type, SizeType32 const* batchSlots, SizeType32 batchSize) const
+{
+    if (getNumActive(type) == 0)
+    {
+        return false;
+    }
+    auto const bit = getBit(type);
+    return std::any_of(
+        batchSlots, batchSlots + batchSize, [this, bit](SizeType32 slot) { return (mMasks[slot] & bit) != 0; });
+}
+
+} // namespace tensorrt_llm::layers
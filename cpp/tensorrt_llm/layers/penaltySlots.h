@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/penaltyTypes.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace tensorrt_llm::layers
+{
+
+//! @brief Tracks which penalties are active for the request in each batch slot, i.e. set to a non-default value.
+//! The masks are updated when requests are added to or removed from slots, and keep the number of active slots of each
+//! penalty type, so that a decoding step whose requests use no penalty of a type skips it without reading any values.
+class ActivePenaltySlots
+{
+public:
+    using SizeType32 = runtime::SizeType32;
+    using DecodingPenaltyType = kernels::DecodingPenaltyType;
+
+    static auto constexpr kNumPenaltyTypes = static_cast<SizeType32>(DecodingPenaltyType::MinLength) + 1;
+
+    explicit ActivePenaltySlots(SizeType32 maxBatchSize);
+
+    //! @brief Sets whether the penalty type is active for the request in slot.
+    void set(SizeType32 slot, DecodingPenaltyType type, bool active);
+
+    //! @brief Sets the penalty type of the requests added to batchSlots, active where values differ from defaultValue.
+    //! values are indexed by slot, as the host penalty buffers of the layer.
+    template <typename T>
+    void set(DecodingPenaltyType type, SizeType32 const* batchSlots, SizeType32 batchSize, T const* values,
+        T defaultValue)
+    {
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            auto const slot = batchSlots[bi];
+            set(slot, type, values[slot] != defaultValue);
+        }
+    }
+
+    //! @brief Deactivates all penalties of slot, whose request finished or is replaced by a new one.
+    void release(SizeType32 slot);
+
+    [[nodiscard]] bool isActive(SizeType32 slot, DecodingPenaltyType type) const;
+
+    //! @returns the number of slots for which the penalty type is active.
+    [[nodiscard]] SizeType32 getNumActive(DecodingPenaltyType type) const;
+
+    //! @returns whether the penalty type is active for any of the batchSize slots of batchSlots.
+    [[nodiscard]] bool isActive(DecodingPenaltyType type, SizeType32 const* batchSlots, SizeType32 batchSize) const;
+
+private:
+    static std::uint8_t getBit(DecodingPenaltyType type)
+    {
+        return static_cast<std::uint8_t>(1U << static_cast<std::uint32_t>(type));
+    }
+
+    //! Bit t of mMasks[slot] is set if penalty type t is active for slot.
+    std::vector<std::uint8_t> mMasks;
+    std::array<SizeType32, kNumPenaltyTypes> mNumActive{};
+};
+
+} // namespace tensorrt_llm::layers
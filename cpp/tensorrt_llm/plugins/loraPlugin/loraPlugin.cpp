@@ -246,49 +246,24 @@ int LoraPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::P
         = mRemoveInputPadding ? static_cast<int32_t const*>(inputs[getHostContextLengthsIdx()]) : nullptr;
 
     int numTokens = getNumTokens(inputDesc);
-    mExpandLoraWeightPtrs.clear();
-    mExpandLoraRanks.clear();
-    mExpandLoraWeightPtrs.reserve(mNumLoraModules * numTokens * 2);
-    mExpandLoraRanks.reserve(mNumLoraModules * numTokens);
-
-    for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+    mReqNumTokens.resize(numReqs);
+    for (int reqId = 0; reqId < numReqs; reqId++)
     {
-        auto const loraWeightModulePtrs = static_cast<int64_t const*>(loraWeightPtrs[loraModuleIdx]);
-        auto const loraRankModule = static_cast<int32_t const*>(loraRanks[loraModuleIdx]);
-
-        int idx = 0;
-        for (int reqId = 0; reqId < numReqs; reqId++)
-        {
-            const RequestType reqType = static_cast<RequestType const>(reqTypes[reqId]);
-            if (reqType == RequestType::kGENERATION)
-            {
-                mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 2]));
-                mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 2 + 1]));
-                mExpandLoraRanks.push_back(loraRankModule[reqId]);
-                idx += 1;
-            }
-            else
-            {
-                int contextLen = (mRemoveInputPadding ? hostContextLengths[reqId] : seqLen);
-
-                for (int contextId = 0; contextId < contextLen; contextId++)
-                {
-                    mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 2]));
-                    mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 2 + 1]));
-                    mExpandLoraRanks.push_back(loraRankModule[reqId]);
-                    idx += 1;
-                }
-            }
-        }
-        TLLM_CHECK_WITH_INFO(idx == numTokens,
-            fmtstr("LoraParams and input dims don't match, lora tokens %d input tokens %d", idx, numTokens));
+        const RequestType reqType = static_cast<RequestType const>(reqTypes[reqId]);
+        mReqNumTokens[reqId]
+            = reqType == RequestType::kGENERATION ? 1 : (mRemoveInputPadding ? hostContextLengths[reqId] : seqLen);
     }
+    mLoraSegments.build(mNumLoraModules, numReqs, mReqNumTokens.data(),
+        reinterpret_cast<int32_t const* const*>(loraRanks), reinterpret_cast<int64_t const* const*>(loraWeightPtrs),
+        mLoraImpl->isGroupByAdapter());
+    TLLM_CHECK_WITH_INFO(mLoraSegments.getNumTokens() == numTokens,
+        fmtstr("LoraParams and input dims don't match, lora tokens %ld input tokens %d", mLoraSegments.getNumTokens(),
+            numTokens));
 
     // only used for unifed gemm
     auto bestTactic = mPluginProfiler->getBestConfig(numTokens, mGemmId);
     mLoraImpl->setBestTactic(bestTactic);
-    mLoraImpl->run(numTokens, numReqs, input, mExpandLoraRanks.data(), mExpandLoraWeightPtrs.data(), mWeightIndex,
-        outputs, workspace, stream);
+    mLoraImpl->run(mLoraSegments, numReqs, input, mWeightIndex, outputs, workspace, stream);
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
     return 0;
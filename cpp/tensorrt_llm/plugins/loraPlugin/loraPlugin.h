@@ -122,8 +122,8 @@ private:
     int mMaxLowRank;
     int mWeightIndex;
 
-    std::vector<void const*> mExpandLoraWeightPtrs{};
-    std::vector<int32_t> mExpandLoraRanks{};
+    std::vector<int64_t> mReqNumTokens{};
+    kernels::LoraSegmentTable mLoraSegments{};
 
     GemmDims mDims{};
     GemmIdCublas mGemmId{};
@@ -20,6 +20,7 @@
 #include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/kernels/customAllReduceKernels.h"
+#include "tensorrt_llm/kernels/customAllReduceStrategyTable.h"
 #include <nccl.h>
 #include <unordered_set>
 
@@ -160,13 +161,25 @@ AllReduceStrategyType AllreducePlugin::selectImplementation(
 
     if (messageSizeBytes <= maxWorkspaceSize)
     {
-        // In some instances, the two-shot strategy has exhibited significant performance issues.
-        // As a temporary measure, we have disabled the two-shot strategy.
-        // TODO: remove this WAR after https://nvbugspro.nvidia.com/bug/4718747 is fixed.
+        auto const isSupported = [&](AllReduceStrategyType candidate)
+        {
+            return candidate == AllReduceStrategyType::NCCL
+                || kernels::configurationSupported(candidate, messageSize, worldSize, type);
+        };
+
         if (!isAuto)
         {
             strat = mStrategy;
         }
+        else if (auto const calibrated = kernels::AllReduceStrategyTable::getDefault().select(
+                     worldSize, type, messageSizeBytes, isSupported))
+        {
+            strat = *calibrated;
+        }
+        // In some instances, the two-shot strategy has exhibited significant performance issues.
+        // As a temporary measure, the heuristic below never picks the two-shot strategy. A calibrated table re-enables
+        // it where it was measured to be faster on this system.
+        // TODO: remove this WAR after https://nvbugspro.nvidia.com/bug/4718747 is fixed.
         else if (worldSize <= 2)
         {
             strat = AllReduceStrategyType::ONESHOT;
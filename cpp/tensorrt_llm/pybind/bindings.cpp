@@ -36,8 +36,10 @@
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/common/quantization.h"
 #include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/detokenizer.h"
 #include "tensorrt_llm/runtime/gptJsonConfig.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
+#include "tensorrt_llm/runtime/resultDelta.h"
 #include "tensorrt_llm/runtime/samplingConfig.h"
 
 namespace py = pybind11;
@@ -415,6 +417,66 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_property_readonly("pinned", &tr::MemoryCounters::getPinned)
         .def_property_readonly("uvm", &tr::MemoryCounters::getUVM);
 
+    py::class_<tr::Detokenizer, std::shared_ptr<tr::Detokenizer>>(m, "Detokenizer")
+        .def_static(
+            "from_file",
+            [](std::filesystem::path const& path)
+            { return std::const_pointer_cast<tr::Detokenizer>(tr::Detokenizer::fromFile(path)); },
+            py::arg("path"))
+        .def_static(
+            "from_json",
+            [](std::string const& json)
+            { return std::const_pointer_cast<tr::Detokenizer>(tr::Detokenizer::fromJsonString(json)); },
+            py::arg("json"))
+        .def_property_readonly("vocab_size", &tr::Detokenizer::getVocabSize)
+        .def(
+            "token_bytes", [](tr::Detokenizer const& self, TokenIdType tokenId)
+            { return py::bytes(std::string{self.getTokenBytes(tokenId)}); },
+            py::arg("token_id"))
+        .def("is_special", &tr::Detokenizer::isSpecial, py::arg("token_id"))
+        .def("decode", &tr::Detokenizer::decode, py::arg("token_ids"), py::arg("skip_special_tokens") = true);
+
+    py::class_<tr::TextDelta>(m, "TextDelta")
+        .def_readonly("text", &tr::TextDelta::text)
+        .def_readonly("is_reset", &tr::TextDelta::isReset)
+        .def_readonly("is_stopped", &tr::TextDelta::isStopped)
+        .def_readonly("stop_string_idx", &tr::TextDelta::stopStringIdx);
+
+    py::class_<tr::DetokenizerStream>(m, "DetokenizerStream")
+        .def(py::init<std::shared_ptr<tr::Detokenizer>, std::vector<std::string>, bool, bool>(),
+            py::arg("detokenizer"), py::arg("stop_strings") = std::vector<std::string>{},
+            py::arg("skip_special_tokens") = true, py::arg("include_stop_string") = false)
+        .def("prime", &tr::DetokenizerStream::prime, py::arg("context_token_ids"))
+        .def("step", py::overload_cast<std::vector<TokenIdType> const&>(&tr::DetokenizerStream::step),
+            py::arg("token_ids"))
+        .def("step_all", &tr::DetokenizerStream::stepAll, py::arg("all_token_ids"))
+        .def("finish", &tr::DetokenizerStream::finish)
+        .def("reset", &tr::DetokenizerStream::reset)
+        .def_property_readonly("is_stopped", &tr::DetokenizerStream::isStopped)
+        .def_property_readonly("num_tokens", &tr::DetokenizerStream::getNumTokens);
+
+    py::class_<tr::ResponseDeltaEncoder>(m, "ResponseDeltaEncoder")
+        .def(py::init<bool>(), py::arg("enable_delta") = true)
+        .def(
+            "encode", [](tr::ResponseDeltaEncoder& self, std::vector<tensorrt_llm::executor::Response> const& responses)
+            {
+                auto const buffer = self.encode(responses);
+                return py::bytes(buffer.data(), buffer.size());
+            },
+            py::arg("responses"))
+        .def_property_readonly("num_active_sequences", &tr::ResponseDeltaEncoder::getNumActiveSequences);
+
+    py::class_<tr::ResponseDeltaDecoder>(m, "ResponseDeltaDecoder")
+        .def(py::init<>())
+        .def(
+            "decode", [](tr::ResponseDeltaDecoder& self, py::bytes const& data)
+            {
+                auto const str = static_cast<std::string>(data);
+                return self.decode(std::vector<char>(str.begin(), str.end()));
+            },
+            py::arg("data"))
+        .def_property_readonly("num_active_sequences", &tr::ResponseDeltaDecoder::getNumActiveSequences);
+
     py::class_<tensorrt_llm::mpi::MpiComm>(m, "MpiComm")
         .def_static("rank",
             []()
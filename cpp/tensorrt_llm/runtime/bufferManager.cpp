@@ -86,6 +86,19 @@ BufferManager::ITensorPtr BufferManager::pinned(nvinfer1::Dims dims, nvinfer1::D
     return std::make_unique<PinnedTensor>(dims, type);
 }
 
+BufferManager::ITensorPtr BufferManager::cpuHugePages(
+    nvinfer1::Dims dims, nvinfer1::DataType type, HugePageSize pageSize)
+{
+    return std::make_unique<HugePageHostTensor>(dims, type, HugePageHostAllocator{pageSize});
+}
+
+BufferManager::ITensorPtr BufferManager::pinnedHugePages(
+    nvinfer1::Dims dims, nvinfer1::DataType type, HugePageSize pageSize)
+{
+    return std::make_unique<HugePagePinnedTensor>(
+        dims, type, HugePagePinnedAllocator{pageSize, NumaTopology::getCurrentDeviceNumaNode()});
+}
+
 BufferManager::IBufferPtr BufferManager::pinnedPool(std::size_t size, nvinfer1::DataType type)
 {
     return std::make_unique<PinnedPoolBuffer>(size, type);
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/chunkedPrefillPlanner.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace tensorrt_llm::runtime;
+
+SizeType32 ChunkedPrefillPlanner::StepTimeModel::maxTokens(double targetMs) const
+{
+    if (targetMs < fixedMs)
+    {
+        return 0;
+    }
+    auto constexpr kMaxTokens = std::numeric_limits<SizeType32>::max();
+    if (perTokenMs <= 0.)
+    {
+        return kMaxTokens;
+    }
+    auto const numTokens = std::floor((targetMs - fixedMs) / perTokenMs);
+    return numTokens >= kMaxTokens ? kMaxTokens : static_cast<SizeType32>(numTokens);
+}
+
+ChunkedPrefillPlanner::StepTimeModel ChunkedPrefillPlanner::StepTimeModel::fit(
+    std::vector<std::pair<SizeType32, double>> const& samples)
+{
+    TLLM_CHECK_WITH_INFO(samples.size() >= 2, "Fitting the step time model requires at least 2 samples, got %zu",
+        samples.size());
+    double meanTokens = 0.;
+    double meanMs = 0.;
+    for (auto const& [numTokens, ms] : samples)
+    {
+        meanTokens += numTokens;
+        meanMs += ms;
+    }
+    meanTokens /= samples.size();
+    meanMs /= samples.size();
+
+    double covariance = 0.;
+    double variance = 0.;
+    for (auto const& [numTokens, ms] : samples)
+    {
+        covariance += (numTokens - meanTokens) * (ms - meanMs);
+        variance += (numTokens - meanTokens) * (numTokens - meanTokens);
+    }
+    TLLM_CHECK_WITH_INFO(
+        variance > 0., "Fitting the step time model requires samples with different numbers of tokens");
+
+    StepTimeModel model;
+    model.perTokenMs = covariance / variance;
+    model.fixedMs = meanMs - model.perTokenMs * meanTokens;
+    if (model.fixedMs >= 0. && model.perTokenMs >= 0.)
+    {
+        return model;
+    }
+
+    // With a negative coefficient in the unconstrained fit, the best non-negative fit has one coefficient at 0. It is
+    // either a line through the origin or a constant, whichever has the smaller squared error.
+    double sumTokensMs = 0.;
+    double sumTokensSquared = 0.;
+    for (auto const& [numTokens, ms] : samples)
+    {
+        sumTokensMs += numTokens * ms;
+        sumTokensSquared += static_cast<double>(numTokens) * numTokens;
+    }
+    StepTimeModel const proportional{0., std::max(sumTokensMs / sumTokensSquared, 0.)};
+    StepTimeModel const constant{std::max(meanMs, 0.), 0.};
+    auto const squaredError = [&samples](StepTimeModel const& candidate)
+    {
+        double error = 0.;
+        for (auto const& [numTokens, ms] : samples)
+        {
+            auto const residual = candidate.estimateMs(numTokens) - ms;
+            error += residual * residual;
+        }
+        return error;
+    };
+    return squaredError(proportional) <= squaredError(constant) ? proportional : constant;
+}
+
+ChunkedPrefillPlanner::ChunkedPrefillPlanner(SizeType32 maxNumTokens, SizeType32 chunkUnitSize,
+    StepTimeModel const& stepTimeModel, std::optional<double> targetIterationMs)
+    : mMaxNumTokens{maxNumTokens}
+    , mChunkUnitSize{chunkUnitSize}
+    , mTargetIterationMs{targetIterationMs}
+{
+    TLLM_CHECK_WITH_INFO(chunkUnitSize > 0, "Chunk unit size must be positive, got %d", chunkUnitSize);
+    TLLM_CHECK_WITH_INFO(maxNumTokens >= chunkUnitSize,
+        "Max number of tokens (%d) must be at least the chunk unit size (%d)", maxNumTokens, chunkUnitSize);
+    TLLM_CHECK_WITH_INFO(!targetIterationMs || *targetIterationMs > 0.,
+        "Target iteration time must be positive, got %f", targetIterationMs.value_or(0.));
+    setStepTimeModel(stepTimeModel);
+}
+
+void ChunkedPrefillPlanner::setStepTimeModel(StepTimeModel const& stepTimeModel)
+{
+    TLLM_CHECK_WITH_INFO(stepTimeModel.fixedMs >= 0. && stepTimeModel.perTokenMs >= 0.,
+        "Step time model must not be negative, got %f ms + %f ms per token", stepTimeModel.fixedMs,
+        stepTimeModel.perTokenMs);
+    mStepTimeModel = stepTimeModel;
+}
+
+SizeType32 ChunkedPrefillPlanner::getPrefillBudget(SizeType32 numGenTokens) const
+{
+    auto const available = std::max(mMaxNumTokens - numGenTokens, 0);
+    if (numGenTokens == 0 || !mTargetIterationMs)
+    {
+        return available;
+    }
+    auto const onTarget = std::max(mStepTimeModel.maxTokens(*mTargetIterationMs) - numGenTokens, 0);
+    return std::min(std::max(onTarget, mChunkUnitSize), available);
+}
+
+ChunkedPrefillPlanner::Plan ChunkedPrefillPlanner::plan(
+    std::vector<SizeType32> const& numRemainingContextTokens, SizeType32 numGenTokens) const
+{
+    Plan plan;
+    plan.chunkSizes.reserve(numRemainingContextTokens.size());
+    auto budget = getPrefillBudget(numGenTokens);
+    plan.numTokens = numGenTokens;
+    for (auto const numRemaining : numRemainingContextTokens)
+    {
+        // The last chunk of a context can have any length, the others must be whole chunk units.
+        auto const chunkSize = numRemaining <= budget ? numRemaining : budget / mChunkUnitSize * mChunkUnitSize;
+        plan.chunkSizes.push_back(chunkSize);
+        budget -= chunkSize;
+        plan.numTokens += chunkSize;
+    }
+    plan.estimatedMs = mStepTimeModel.estimateMs(plan.numTokens);
+    return plan;
+}
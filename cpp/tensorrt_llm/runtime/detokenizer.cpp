@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/detokenizer.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <unordered_map>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+using Json = typename nlohmann::json::basic_json;
+
+auto constexpr kReplacementChar = "\xEF\xBF\xBD";
+auto constexpr kMetaspace = "\xE2\x96\x81";
+
+bool isContinuationByte(unsigned char c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+//! \brief Append the longest decodable prefix of `bytes` to `out`, replacing invalid sequences with U+FFFD.
+//! \returns The number of bytes consumed. A trailing incomplete sequence is left unconsumed unless `flush` is set.
+std::size_t appendValidUtf8(std::string_view bytes, std::string& out, bool flush)
+{
+    std::size_t pos = 0;
+    while (pos < bytes.size())
+    {
+        auto const lead = static_cast<unsigned char>(bytes[pos]);
+        if (lead < 0x80)
+        {
+            // Fast path for ASCII runs.
+            auto end = pos + 1;
+            while (end < bytes.size() && static_cast<unsigned char>(bytes[end]) < 0x80)
+            {
+                ++end;
+            }
+            out.append(bytes.data() + pos, end - pos);
+            pos = end;
+            continue;
+        }
+
+        std::size_t length = 0;
+        unsigned char lower = 0x80;
+        unsigned char upper = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            lower = lead == 0xE0 ? 0xA0 : 0x80;
+            upper = lead == 0xED ? 0x9F : 0xBF;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            lower = lead == 0xF0 ? 0x90 : 0x80;
+            upper = lead == 0xF4 ? 0x8F : 0xBF;
+        }
+        else
+        {
+            out.append(kReplacementChar);
+            ++pos;
+            continue;
+        }
+
+        // Length of the valid prefix of the sequence, following the "maximal subpart" replacement practice.
+        std::size_t valid = 1;
+        while (valid < length && pos + valid < bytes.size())
+        {
+            auto const c = static_cast<unsigned char>(bytes[pos + valid]);
+            auto const lo = valid == 1 ? lower : static_cast<unsigned char>(0x80);
+            auto const hi = valid == 1 ? upper : static_cast<unsigned char>(0xBF);
+            if (c < lo || c > hi)
+            {
+                break;
+            }
+            ++valid;
+        }
+
+        if (valid == length)
+        {
+            out.append(bytes.data() + pos, length);
+            pos += length;
+        }
+        else if (pos + valid == bytes.size() && !flush)
+        {
+            // Incomplete but still valid so far, wait for more bytes.
+            break;
+        }
+        else
+        {
+            out.append(kReplacementChar);
+            pos += valid;
+        }
+    }
+    return pos;
+}
+
+//! \brief Inverse of the GPT-2 `bytes_to_unicode` table used by byte-level BPE.
+std::unordered_map<std::uint32_t, char> const& byteLevelDecoder()
+{
+    static auto const table = []()
+    {
+        std::unordered_map<std::uint32_t, char> result;
+        std::uint32_t next = 256;
+        for (std::uint32_t b = 0; b < 256; ++b)
+        {
+            bool const printable = (b >= '!' && b <= '~') || (b >= 0xA1 && b <= 0xAC) || (b >= 0xAE && b <= 0xFF);
+            result.emplace(printable ? b : next++, static_cast<char>(b));
+        }
+        return result;
+    }();
+    return table;
+}
+
+//! \brief Decode one code point from a valid UTF-8 string. Advances `pos`.
+std::uint32_t nextCodePoint(std::string_view str, std::size_t& pos)
+{
+    auto const lead = static_cast<unsigned char>(str[pos]);
+    std::size_t const length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    std::uint32_t codePoint = length == 1 ? lead : lead & (0xFF >> (length + 1));
+    for (std::size_t i = 1; i < length && pos + i < str.size(); ++i)
+    {
+        codePoint = (codePoint << 6) | (static_cast<unsigned char>(str[pos + i]) & 0x3F);
+    }
+    pos += length;
+    return codePoint;
+}
+
+std::string decodeByteLevel(std::string_view piece)
+{
+    auto const& table = byteLevelDecoder();
+    std::string result;
+    result.reserve(piece.size());
+    std::size_t pos = 0;
+    while (pos < piece.size())
+    {
+        auto const begin = pos;
+        auto const it = table.find(nextCodePoint(piece, pos));
+        if (it != table.end())
+        {
+            result.push_back(it->second);
+        }
+        else
+        {
+            result.append(piece.substr(begin, pos - begin));
+        }
+    }
+    return result;
+}
+
+//! \brief Parse a SentencePiece byte fallback token of the form `<0xHH>`.
+std::optional<char> parseByteFallback(std::string_view piece)
+{
+    if (piece.size() != 6 || piece.substr(0, 3) != "<0x" || piece.back() != '>')
+    {
+        return std::nullopt;
+    }
+    auto const hexValue = [](char c) -> int
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        return -1;
+    };
+    auto const hi = hexValue(piece[3]);
+    auto const lo = hexValue(piece[4]);
+    if (hi < 0 || lo < 0)
+    {
+        return std::nullopt;
+    }
+    return static_cast<char>((hi << 4) | lo);
+}
+
+void replaceAll(std::string& str, std::string const& pattern, std::string const& content)
+{
+    if (pattern.empty())
+    {
+        return;
+    }
+    for (auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + content.size()))
+    {
+        str.replace(pos, pattern.size(), content);
+    }
+}
+
+//! \brief Decoder pipeline of a tokenizer.json, reduced to the steps that matter for detokenization.
+struct DecoderSpec
+{
+    bool byteLevel{false};
+    bool byteFallback{false};
+    std::vector<std::pair<std::string, std::string>> replacements;
+    SizeType32 numLeadingSpacesToStrip{0};
+};
+
+void parseDecoder(Json const& decoder, DecoderSpec& spec)
+{
+    if (decoder.is_null())
+    {
+        return;
+    }
+    auto const type = decoder.at("type").get<std::string>();
+    if (type == "Sequence")
+    {
+        for (auto const& child : decoder.at("decoders"))
+        {
+            parseDecoder(child, spec);
+        }
+    }
+    else if (type == "ByteLevel")
+    {
+        spec.byteLevel = true;
+    }
+    else if (type == "ByteFallback")
+    {
+        spec.byteFallback = true;
+    }
+    else if (type == "Replace")
+    {
+        auto const& pattern = decoder.at("pattern");
+        TLLM_CHECK_WITH_INFO(pattern.contains("String"), "Only string patterns are supported by the Replace decoder");
+        spec.replacements.emplace_back(
+            pattern.at("String").get<std::string>(), decoder.at("content").get<std::string>());
+    }
+    else if (type == "Strip")
+    {
+        if (decoder.value("content", std::string{" "}) == " ")
+        {
+            spec.numLeadingSpacesToStrip = decoder.value("start", 0);
+        }
+    }
+    else if (type == "Metaspace")
+    {
+        spec.replacements.emplace_back(decoder.value("replacement", std::string{kMetaspace}), " ");
+        auto const prependScheme = decoder.value("prepend_scheme", std::string{});
+        bool const addPrefixSpace = prependScheme.empty() ? decoder.value("add_prefix_space", true)
+                                                          : prependScheme != "never";
+        spec.numLeadingSpacesToStrip = addPrefixSpace ? 1 : 0;
+    }
+    else if (type == "Fuse")
+    {
+        // Joining tokens is implicit in streaming decoding.
+    }
+    else
+    {
+        TLLM_THROW("Unsupported tokenizer decoder type: %s", type.c_str());
+    }
+}
+
+} // namespace
+
+Detokenizer::SharedConstPtr Detokenizer::fromFile(std::filesystem::path const& tokenizerJsonPath)
+{
+    std::ifstream file(tokenizerJsonPath);
+    TLLM_CHECK_WITH_INFO(file.good(), "Cannot open tokenizer file %s", tokenizerJsonPath.string().c_str());
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return fromJsonString(buffer.str());
+}
+
+Detokenizer::SharedConstPtr Detokenizer::fromJsonString(std::string const& tokenizerJson)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    auto const json = Json::parse(tokenizerJson);
+    auto const& model = json.at("model");
+    auto const modelType = model.value("type", std::string{"BPE"});
+
+    DecoderSpec spec;
+    spec.byteFallback = model.value("byte_fallback", false);
+    parseDecoder(json.value("decoder", Json{}), spec);
+
+    // Collect the pieces of the model vocabulary.
+    std::vector<std::pair<TokenIdType, std::string>> pieces;
+    auto const& vocab = model.at("vocab");
+    if (modelType == "BPE" || modelType == "WordLevel")
+    {
+        pieces.reserve(vocab.size());
+        for (auto const& [piece, tokenId] : vocab.items())
+        {
+            pieces.emplace_back(tokenId.get<TokenIdType>(), piece);
+        }
+    }
+    else if (modelType == "Unigram")
+    {
+        pieces.reserve(vocab.size());
+        for (std::size_t i = 0; i < vocab.size(); ++i)
+        {
+            pieces.emplace_back(static_cast<TokenIdType>(i), vocab[i].at(0).get<std::string>());
+        }
+    }
+    else
+    {
+        TLLM_THROW("Unsupported tokenizer model type: %s", modelType.c_str());
+    }
+
+    // Added tokens are decoded verbatim and take precedence over the model vocabulary.
+    std::unordered_map<TokenIdType, std::pair<std::string, bool>> addedTokens;
+    for (auto const& token : json.value("added_tokens", Json::array()))
+    {
+        addedTokens[token.at("id").get<TokenIdType>()]
+            = {token.at("content").get<std::string>(), token.value("special", false)};
+    }
+
+    TokenIdType maxTokenId = -1;
+    for (auto const& piece : pieces)
+    {
+        maxTokenId = std::max(maxTokenId, piece.first);
+    }
+    for (auto const& [tokenId, token] : addedTokens)
+    {
+        maxTokenId = std::max(maxTokenId, tokenId);
+    }
+    TLLM_CHECK_WITH_INFO(maxTokenId >= 0, "Tokenizer vocabulary is empty");
+
+    std::vector<std::string> tokenBytes(maxTokenId + 1);
+    for (auto& [tokenId, piece] : pieces)
+    {
+        TLLM_CHECK_WITH_INFO(tokenId >= 0, "Invalid token id %d", tokenId);
+        std::optional<char> byte = spec.byteFallback ? parseByteFallback(piece) : std::nullopt;
+        if (byte)
+        {
+            tokenBytes[tokenId] = std::string(1, *byte);
+        }
+        else if (spec.byteLevel)
+        {
+            tokenBytes[tokenId] = decodeByteLevel(piece);
+        }
+        else
+        {
+            for (auto const& [pattern, content] : spec.replacements)
+            {
+                replaceAll(piece, pattern, content);
+            }
+            tokenBytes[tokenId] = std::move(piece);
+        }
+    }
+
+    std::shared_ptr<Detokenizer> detokenizer{new Detokenizer()};
+    detokenizer->mNumLeadingSpacesToStrip = spec.numLeadingSpacesToStrip;
+    detokenizer->mOffsets.reserve(tokenBytes.size() + 1);
+    detokenizer->mOffsets.push_back(0);
+    detokenizer->mSpecial.resize(tokenBytes.size(), false);
+    for (std::size_t tokenId = 0; tokenId < tokenBytes.size(); ++tokenId)
+    {
+        auto const it = addedTokens.find(static_cast<TokenIdType>(tokenId));
+        if (it != addedTokens.end())
+        {
+            detokenizer->addToken(static_cast<TokenIdType>(tokenId), it->second.first, it->second.second);
+        }
+        else
+        {
+            detokenizer->addToken(static_cast<TokenIdType>(tokenId), tokenBytes[tokenId], false);
+        }
+    }
+    TLLM_LOG_DEBUG("Loaded %s tokenizer with %d tokens", modelType.c_str(), detokenizer->getVocabSize());
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+    return detokenizer;
+}
+
+void Detokenizer::addToken(TokenIdType tokenId, std::string_view bytes, bool isSpecial)
+{
+    mData.append(bytes);
+    mOffsets.push_back(mData.size());
+    mSpecial[tokenId] = isSpecial;
+}
+
+std::string_view Detokenizer::getTokenBytes(TokenIdType tokenId) const
+{
+    TLLM_CHECK_WITH_INFO(tokenId >= 0 && tokenId < getVocabSize(), "Token id %d out of range [0, %d)", tokenId,
+        getVocabSize());
+    auto const begin = mOffsets[tokenId];
+    return std::string_view{mData}.substr(begin, mOffsets[tokenId + 1] - begin);
+}
+
+bool Detokenizer::isSpecial(TokenIdType tokenId) const
+{
+    TLLM_CHECK_WITH_INFO(tokenId >= 0 && tokenId < getVocabSize(), "Token id %d out of range [0, %d)", tokenId,
+        getVocabSize());
+    return mSpecial[tokenId];
+}
+
+std::string Detokenizer::decode(executor::VecTokens const& tokenIds, bool skipSpecialTokens) const
+{
+    std::string bytes;
+    for (auto const tokenId : tokenIds)
+    {
+        if (!(skipSpecialTokens && isSpecial(tokenId)))
+        {
+            bytes.append(getTokenBytes(tokenId));
+        }
+    }
+    std::size_t start = 0;
+    while (start < bytes.size() && start < static_cast<std::size_t>(mNumLeadingSpacesToStrip) && bytes[start] == ' ')
+    {
+        ++start;
+    }
+    std::string text;
+    text.reserve(bytes.size() - start);
+    appendValidUtf8(std::string_view{bytes}.substr(start), text, true);
+    return text;
+}
+
+DetokenizerStream::DetokenizerStream(Detokenizer::SharedConstPtr detokenizer, std::vector<std::string> stopStrings,
+    bool skipSpecialTokens, bool includeStopString)
+    : mDetokenizer{std::move(detokenizer)}
+    , mStopStrings{std::move(stopStrings)}
+    , mSkipSpecialTokens{skipSpecialTokens}
+    , mIncludeStopString{includeStopString}
+{
+    TLLM_CHECK(mDetokenizer);
+    for (auto const& stopString : mStopStrings)
+    {
+        TLLM_CHECK_WITH_INFO(!stopString.empty(), "Stop strings must not be empty");
+        mMaxStopStringLength = std::max(mMaxStopStringLength, stopString.size());
+    }
+    mPrimedSpacesToStrip = mDetokenizer->getNumLeadingSpacesToStrip();
+    reset();
+}
+
+void DetokenizerStream::reset()
+{
+    mTokenIds.clear();
+    mPendingBytes = mPrimedBytes;
+    mHeldText.clear();
+    mSpacesToStrip = mPrimedSpacesToStrip;
+    mStopped = false;
+}
+
+void DetokenizerStream::prime(executor::VecTokens const& contextTokenIds)
+{
+    TLLM_CHECK_WITH_INFO(mTokenIds.empty(), "A stream must be primed before decoding generated tokens");
+    std::string bytes;
+    for (auto const tokenId : contextTokenIds)
+    {
+        if (!(mSkipSpecialTokens && mDetokenizer->isSpecial(tokenId)))
+        {
+            bytes.append(mDetokenizer->getTokenBytes(tokenId));
+        }
+    }
+    if (!bytes.empty())
+    {
+        mPrimedSpacesToStrip = 0;
+    }
+    // Keep only a trailing incomplete code point, it will be completed by the first generated tokens.
+    std::string discarded;
+    auto const consumed = appendValidUtf8(bytes, discarded, false);
+    mPrimedBytes = bytes.substr(consumed);
+    reset();
+}
+
+void DetokenizerStream::appendBytes(TokenIdType const* tokenIds, std::size_t numTokens)
+{
+    for (std::size_t i = 0; i < numTokens; ++i)
+    {
+        auto const tokenId = tokenIds[i];
+        mTokenIds.push_back(tokenId);
+        if (mSkipSpecialTokens && mDetokenizer->isSpecial(tokenId))
+        {
+            continue;
+        }
+        auto bytes = mDetokenizer->getTokenBytes(tokenId);
+        while (mSpacesToStrip > 0 && !bytes.empty())
+        {
+            if (bytes.front() == ' ')
+            {
+                bytes.remove_prefix(1);
+                --mSpacesToStrip;
+            }
+            else
+            {
+                mSpacesToStrip = 0;
+            }
+        }
+        mPendingBytes.append(bytes);
+    }
+}
+
+void DetokenizerStream::emit(TextDelta& delta, bool flush)
+{
+    auto const consumed = appendValidUtf8(mPendingBytes, mHeldText, flush);
+    mPendingBytes.erase(0, consumed);
+
+    if (mStopStrings.empty())
+    {
+        delta.text.append(mHeldText);
+        mHeldText.clear();
+        return;
+    }
+
+    // Earliest match, ties resolved in favor of the first stop string in the list.
+    auto matchPos = std::string::npos;
+    for (std::size_t i = 0; i < mStopStrings.size(); ++i)
+    {
+        auto const pos = mHeldText.find(mStopStrings[i]);
+        if (pos < matchPos)
+        {
+            matchPos = pos;
+            delta.stopStringIdx = static_cast<SizeType32>(i);
+        }
+    }
+    if (matchPos != std::string::npos)
+    {
+        auto const end = mIncludeStopString ? matchPos + mStopStrings[*delta.stopStringIdx].size() : matchPos;
+        delta.text.append(mHeldText, 0, end);
+        delta.isStopped = true;
+        mStopped = true;
+        mHeldText.clear();
+        mPendingBytes.clear();
+        return;
+    }
+
+    // Hold back the tail that could still be the beginning of a stop string.
+    auto const holdBack = flush ? 0 : std::min(mHeldText.size(), mMaxStopStringLength - 1);
+    auto cut = mHeldText.size() - holdBack;
+    while (cut > 0 && cut < mHeldText.size() && isContinuationByte(static_cast<unsigned char>(mHeldText[cut])))
+    {
+        --cut;
+    }
+    delta.text.append(mHeldText, 0, cut);
+    mHeldText.erase(0, cut);
+}
+
+TextDelta DetokenizerStream::step(TokenIdType const* tokenIds, std::size_t numTokens)
+{
+    TextDelta delta;
+    if (mStopped)
+    {
+        delta.isStopped = true;
+        return delta;
+    }
+    appendBytes(tokenIds, numTokens);
+    emit(delta, false);
+    return delta;
+}
+
+TextDelta DetokenizerStream::stepAll(executor::VecTokens const& allTokenIds)
+{
+    auto const numSeen = mTokenIds.size();
+    if (allTokenIds.size() >= numSeen && std::equal(mTokenIds.begin(), mTokenIds.end(), allTokenIds.begin()))
+    {
+        return step(allTokenIds.data() + numSeen, allTokenIds.size() - numSeen);
+    }
+
+    // Previously decoded tokens changed, start over.
+    reset();
+    auto delta = step(allTokenIds);
+    delta.isReset = true;
+    return delta;
+}
+
+TextDelta DetokenizerStream::finish()
+{
+    TextDelta delta;
+    if (mStopped)
+    {
+        delta.isStopped = true;
+        return delta;
+    }
+    emit(delta, true);
+    return delta;
+}
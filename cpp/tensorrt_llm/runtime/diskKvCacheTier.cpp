@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/diskKvCacheTier.h"
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/hashUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::uint64_t constexpr kMagic = 0x314b564b53494454; // "TDISKVK1"
+std::uint32_t constexpr kVersion = 2;
+std::size_t constexpr kPageSize = 4096;
+std::size_t constexpr kMaxWriteBatch = 32;
+
+struct FileHeader
+{
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t blockSize;
+    std::uint64_t numBlocks;
+};
+
+//! A slot is empty when its sequence is 0. Higher sequences were written later.
+struct SlotRecord
+{
+    std::uint64_t hash;
+    std::uint64_t sequence;
+};
+
+std::size_t roundUp(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+bool writeFully(int fd, void const* data, std::size_t size, std::uint64_t offset)
+{
+    auto const* src = static_cast<char const*>(data);
+    while (size > 0)
+    {
+        auto const written = ::pwrite(fd, src, size, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        src += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+bool readFully(int fd, void* data, std::size_t size, std::uint64_t offset)
+{
+    auto* dst = static_cast<char*>(data);
+    while (size > 0)
+    {
+        auto const count = ::pread(fd, dst, size, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        dst += count;
+        size -= static_cast<std::size_t>(count);
+        offset += static_cast<std::uint64_t>(count);
+    }
+    return true;
+}
+
+} // namespace
+
+DiskKvCacheTier::BlockHash DiskKvCacheTier::hashBlock(BlockHash parentHash, VecUniqueTokens::const_iterator begin,
+    VecUniqueTokens::const_iterator end, LoraTaskIdType loraTaskId) noexcept
+{
+    namespace kvcm = tensorrt_llm::batch_manager::kv_cache_manager;
+    kvcm::BlockKey const key{loraTaskId, VecUniqueTokens(begin, end)};
+    auto seed = kvcm::BlockKeyHasher{}(key);
+    common::hashCombine(seed, parentHash);
+    return seed;
+}
+
+std::vector<DiskKvCacheTier::BlockHash> DiskKvCacheTier::hashBlocks(
+    VecUniqueTokens const& tokens, SizeType32 tokensPerBlock, LoraTaskIdType loraTaskId)
+{
+    TLLM_CHECK(tokensPerBlock > 0);
+    std::vector<BlockHash> hashes;
+    hashes.reserve(tokens.size() / tokensPerBlock);
+    BlockHash parent = 0;
+    for (std::size_t begin = 0; begin + tokensPerBlock <= tokens.size(); begin += tokensPerBlock)
+    {
+        parent = hashBlock(parent, tokens.begin() + begin, tokens.begin() + begin + tokensPerBlock, loraTaskId);
+        hashes.push_back(parent);
+    }
+    return hashes;
+}
+
+DiskKvCacheTier::DiskKvCacheTier(
+    std::filesystem::path path, std::size_t blockSize, SizeType32 numBlocks, SizeType32 maxPendingWrites)
+    : mPath{std::move(path)}
+    , mBlockSize{blockSize}
+    , mSlotSize{roundUp(blockSize, kPageSize)}
+    , mNumBlocks{numBlocks}
+    , mMaxPendingWrites{static_cast<std::size_t>(std::max(maxPendingWrites, 1))}
+    , mDataOffset{kPageSize + roundUp(static_cast<std::size_t>(numBlocks) * sizeof(SlotRecord), kPageSize)}
+    , mSlots(numBlocks)
+{
+    TLLM_CHECK_WITH_INFO(blockSize > 0 && numBlocks > 0, "Disk KV cache tier needs a positive block size and count");
+    mFd = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    TLLM_CHECK_WITH_INFO(mFd >= 0, "Cannot open %s: %s", mPath.c_str(), std::strerror(errno));
+
+    FileHeader header{};
+    auto const fileSize = mDataOffset + static_cast<std::uint64_t>(numBlocks) * mSlotSize;
+    if (readFully(mFd, &header, sizeof(header), 0) && header.magic == kMagic && header.version == kVersion
+        && header.blockSize == blockSize && header.numBlocks == static_cast<std::uint64_t>(numBlocks))
+    {
+        try
+        {
+            load();
+        }
+        catch (...)
+        {
+            ::close(mFd);
+            throw;
+        }
+    }
+    else
+    {
+        TLLM_LOG_INFO("Creating disk KV cache tier %s of %d blocks", mPath.c_str(), numBlocks);
+        header = FileHeader{kMagic, kVersion, 0, blockSize, static_cast<std::uint64_t>(numBlocks)};
+        // Truncating first clears a stale index.
+        auto error = ::ftruncate(mFd, 0) == 0 && ::ftruncate(mFd, static_cast<off_t>(fileSize)) == 0 ? 0 : errno;
+        if (error == 0)
+        {
+            // Reserve the blocks up front so that writes do not fail or fragment later, when supported.
+            auto const fallocateError = ::posix_fallocate(mFd, 0, static_cast<off_t>(fileSize));
+            error = fallocateError == ENOSPC ? ENOSPC : 0;
+        }
+        if (error == 0 && !writeFully(mFd, &header, sizeof(header), 0))
+        {
+            error = errno;
+        }
+        if (error != 0)
+        {
+            ::close(mFd);
+            TLLM_THROW("Cannot allocate disk KV cache tier %s: %s", mPath.c_str(), std::strerror(error));
+        }
+        for (SizeType32 slot = numBlocks - 1; slot >= 0; --slot)
+        {
+            mFreeSlots.push_back(slot);
+        }
+    }
+    mThread = std::thread(&DiskKvCacheTier::run, this);
+}
+
+DiskKvCacheTier::~DiskKvCacheTier()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCv.notify_all();
+    mThread.join();
+    ::fdatasync(mFd);
+    ::close(mFd);
+}
+
+void DiskKvCacheTier::load()
+{
+    std::vector<SlotRecord> records(mNumBlocks);
+    TLLM_CHECK_WITH_INFO(readFully(mFd, records.data(), records.size() * sizeof(SlotRecord), kPageSize),
+        "Cannot read the index of %s", mPath.c_str());
+
+    std::vector<SizeType32> order(mNumBlocks);
+    for (SizeType32 slot = 0; slot < mNumBlocks; ++slot)
+    {
+        order[slot] = slot;
+    }
+    // Most recently written first.
+    std::sort(order.begin(), order.end(),
+        [&records](SizeType32 a, SizeType32 b) { return records[a].sequence > records[b].sequence; });
+    for (auto const slot : order)
+    {
+        auto const& record = records[slot];
+        if (record.sequence == 0 || !mIndex.emplace(record.hash, slot).second)
+        {
+            mFreeSlots.push_back(slot);
+            continue;
+        }
+        mSequence = std::max(mSequence, record.sequence + 1);
+        mSlots[slot].hash = record.hash;
+        mSlots[slot].used = true;
+        mSlots[slot].lruIt = mLru.insert(mLru.end(), slot);
+    }
+    TLLM_LOG_INFO("Loaded %zu blocks from disk KV cache tier %s", mIndex.size(), mPath.c_str());
+}
+
+bool DiskKvCacheTier::store(BlockHash hash, void const* block)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mIndex.count(hash) > 0 || mPending.count(hash) > 0)
+        {
+            return false;
+        }
+        if (mPending.size() >= mMaxPendingWrites)
+        {
+            ++mStats.numDroppedWrites;
+            return false;
+        }
+    }
+    // Copy without holding the lock.
+    auto const* src = static_cast<std::uint8_t const*>(block);
+    std::vector<std::uint8_t> data(src, src + mBlockSize);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mIndex.count(hash) > 0 || !mPending.emplace(hash, std::move(data)).second)
+        {
+            return false;
+        }
+        mWriteQueue.push_back(hash);
+    }
+    mCv.notify_one();
+    return true;
+}
+
+SizeType32 DiskKvCacheTier::matchPrefix(std::vector<BlockHash> const& hashes) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    SizeType32 numMatched = 0;
+    for (auto const hash : hashes)
+    {
+        if (mIndex.count(hash) == 0 && mPending.count(hash) == 0)
+        {
+            break;
+        }
+        ++numMatched;
+    }
+    return numMatched;
+}
+
+std::future<SizeType32> DiskKvCacheTier::prefetch(std::vector<BlockHash> hashes, std::vector<void*> blocks)
+{
+    TLLM_CHECK_WITH_INFO(hashes.size() == blocks.size(), "Prefetch needs one buffer per block");
+    ReadJob job{std::move(hashes), std::move(blocks), {}};
+    auto future = job.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReadQueue.push_back(std::move(job));
+    }
+    mCv.notify_one();
+    return future;
+}
+
+void DiskKvCacheTier::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdleCv.wait(lock, [this]() { return mWriteQueue.empty() && !mBusy; });
+    }
+    TLLM_CHECK_WITH_INFO(::fdatasync(mFd) == 0, "Cannot sync %s: %s", mPath.c_str(), std::strerror(errno));
+}
+
+SizeType32 DiskKvCacheTier::getNumStoredBlocks() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return static_cast<SizeType32>(mIndex.size());
+}
+
+DiskKvCacheTier::Stats DiskKvCacheTier::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void DiskKvCacheTier::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCv.wait(lock, [this]() { return mShutdown || !mReadQueue.empty() || !mWriteQueue.empty(); });
+        mBusy = true;
+        if (!mReadQueue.empty())
+        {
+            auto job = std::move(mReadQueue.front());
+            mReadQueue.pop_front();
+            lock.unlock();
+            try
+            {
+                read(job);
+            }
+            catch (...)
+            {
+                job.promise.set_exception(std::current_exception());
+            }
+            lock.lock();
+        }
+        else if (!mWriteQueue.empty())
+        {
+            writeBatch(lock);
+        }
+        mBusy = false;
+        if (mWriteQueue.empty())
+        {
+            mIdleCv.notify_all();
+            if (mShutdown && mReadQueue.empty())
+            {
+                break;
+            }
+        }
+    }
+}
+
+void DiskKvCacheTier::read(ReadJob& job)
+{
+    // Only this thread writes slots, so the resolved slots stay valid until they are read.
+    std::vector<std::pair<SizeType32, void*>> reads;
+    SizeType32 numMatched = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (; numMatched < static_cast<SizeType32>(job.hashes.size()); ++numMatched)
+        {
+            auto const hash = job.hashes[numMatched];
+            if (auto const pending = mPending.find(hash); pending != mPending.end())
+            {
+                std::memcpy(job.blocks[numMatched], pending->second.data(), mBlockSize);
+                ++mStats.numPendingHits;
+                continue;
+            }
+            auto const it = mIndex.find(hash);
+            if (it == mIndex.end())
+            {
+                break;
+            }
+            touch(it->second);
+            reads.emplace_back(it->second, job.blocks[numMatched]);
+        }
+        mStats.numReads += reads.size();
+    }
+    for (auto const& [slot, block] : reads)
+    {
+        TLLM_CHECK_WITH_INFO(readFully(mFd, block, mBlockSize, getSlotOffset(slot)), "Cannot read block from %s: %s",
+            mPath.c_str(), std::strerror(errno));
+    }
+    job.promise.set_value(numMatched);
+}
+
+void DiskKvCacheTier::writeBatch(std::unique_lock<std::mutex>& lock)
+{
+    struct Write
+    {
+        BlockHash hash;
+        SizeType32 slot;
+        std::uint8_t const* data;
+        bool evicted;
+        std::uint64_t sequence;
+    };
+
+    std::vector<Write> batch;
+    // Stop when all slots are in flight, the remaining blocks go in the next batch.
+    while (batch.size() < kMaxWriteBatch && !mWriteQueue.empty() && (!mFreeSlots.empty() || !mLru.empty()))
+    {
+        auto const hash = mWriteQueue.front();
+        mWriteQueue.pop_front();
+        SizeType32 slot;
+        bool evicted = false;
+        if (!mFreeSlots.empty())
+        {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else
+        {
+            slot = mLru.back();
+            mLru.pop_back();
+            mIndex.erase(mSlots[slot].hash);
+            mSlots[slot].used = false;
+            evicted = true;
+            ++mStats.numEvictions;
+        }
+        // The pending buffers are only erased by this thread.
+        batch.push_back({hash, slot, mPending.at(hash).data(), evicted, mSequence++});
+    }
+    lock.unlock();
+
+    // The index records, the blocks and the new records may reach the disk in any order, so sync after invalidating
+    // the overwritten blocks and again after writing the blocks, so that a record never points at a torn block.
+    auto const sync = [this]()
+    {
+        if (::fdatasync(mFd) == 0)
+        {
+            return true;
+        }
+        TLLM_LOG_ERROR("Cannot sync %s: %s", mPath.c_str(), std::strerror(errno));
+        return false;
+    };
+    bool invalidated = true;
+    if (std::any_of(batch.begin(), batch.end(), [](Write const& write) { return write.evicted; }))
+    {
+        for (auto const& write : batch)
+        {
+            if (write.evicted)
+            {
+                invalidated = writeRecord(write.slot, 0, 0) && invalidated;
+            }
+        }
+        invalidated = invalidated && sync();
+    }
+    std::vector<bool> written(batch.size(), false);
+    for (std::size_t i = 0; invalidated && i < batch.size(); ++i)
+    {
+        written[i] = writeFully(mFd, batch[i].data, mBlockSize, getSlotOffset(batch[i].slot));
+        if (!written[i])
+        {
+            TLLM_LOG_ERROR("Cannot write block to %s: %s", mPath.c_str(), std::strerror(errno));
+        }
+    }
+    if (std::find(written.begin(), written.end(), true) != written.end() && !sync())
+    {
+        written.assign(batch.size(), false);
+    }
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        if (written[i])
+        {
+            written[i] = writeRecord(batch[i].slot, batch[i].hash, batch[i].sequence);
+        }
+    }
+
+    lock.lock();
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        auto const& write = batch[i];
+        mPending.erase(write.hash);
+        if (!written[i])
+        {
+            mFreeSlots.push_back(write.slot);
+            continue;
+        }
+        auto& slot = mSlots[write.slot];
+        slot.hash = write.hash;
+        slot.used = true;
+        slot.lruIt = mLru.insert(mLru.begin(), write.slot);
+        mIndex[write.hash] = write.slot;
+        ++mStats.numWrites;
+    }
+}
+
+bool DiskKvCacheTier::writeRecord(SizeType32 slot, BlockHash hash, std::uint64_t sequence) const
+{
+    SlotRecord const record{hash, sequence};
+    if (!writeFully(mFd, &record, sizeof(record), kPageSize + static_cast<std::uint64_t>(slot) * sizeof(record)))
+    {
+        TLLM_LOG_ERROR("Cannot write the index of %s: %s", mPath.c_str(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t DiskKvCacheTier::getSlotOffset(SizeType32 slot) const noexcept
+{
+    return mDataOffset + static_cast<std::uint64_t>(slot) * mSlotSize;
+}
+
+void DiskKvCacheTier::touch(SizeType32 slot)
+{
+    mLru.splice(mLru.begin(), mLru, mSlots[slot].lruIt);
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/encoderOutputCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <cstring>
+
+using namespace tensorrt_llm::runtime;
+namespace tb = tensorrt_llm::batch_manager;
+
+namespace
+{
+
+//! Distinguishes token and feature inputs, bump when the digest changes.
+std::uint64_t constexpr kTokensTag = 0x746f6b656e730001;
+std::uint64_t constexpr kFeaturesTag = 0x6665617475720001;
+
+std::uint64_t mix64(std::uint64_t x) noexcept
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+std::uint64_t rotl(std::uint64_t x, int r) noexcept
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+//! \brief Two independently seeded 64-bit lanes, so that two inputs only collide if both lanes do.
+class Digest
+{
+public:
+    explicit Digest(std::uint64_t tag)
+        : mLo{mix64(tag)}
+        , mHi{mix64(tag ^ 0x9e3779b97f4a7c15ULL)}
+    {
+    }
+
+    void add(std::uint64_t word) noexcept
+    {
+        mLo = rotl(mLo ^ mix64(word), 27) * 0x9e3779b97f4a7c15ULL + 0x52dce729;
+        mHi = rotl(mHi ^ mix64(word ^ 0xc2b2ae3d27d4eb4fULL), 31) * 0x165667b19e3779f9ULL + 0x38495ab5;
+    }
+
+    void add(std::string const& value) noexcept
+    {
+        addBytes(value.data(), value.size());
+    }
+
+    void addBytes(void const* data, std::size_t size) noexcept
+    {
+        auto const* bytes = static_cast<std::uint8_t const*>(data);
+        std::size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            add(word);
+        }
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, bytes + i, size - i);
+        add(tail);
+        add(static_cast<std::uint64_t>(size));
+    }
+
+    [[nodiscard]] EncoderOutputCache::Key finish(std::optional<LoraTaskIdType> loraTaskId) noexcept
+    {
+        add(loraTaskId.has_value());
+        add(loraTaskId.value_or(0));
+        return EncoderOutputCache::Key{mix64(mLo), mix64(mHi)};
+    }
+
+private:
+    std::uint64_t mLo;
+    std::uint64_t mHi;
+};
+
+} // namespace
+
+EncoderOutputCache::EncoderOutputCache(std::string modelId, std::size_t maxBytes, MemoryType memoryType)
+    : mModelId{std::move(modelId)}
+    , mMaxBytes{maxBytes}
+    , mMemoryType{memoryType}
+{
+    TLLM_CHECK_WITH_INFO(memoryType != MemoryType::kGPU, "The encoder output cache is a host tier.");
+}
+
+EncoderOutputCache::Key EncoderOutputCache::makeKey(
+    std::vector<TokenIdType> const& encoderTokens, std::optional<LoraTaskIdType> loraTaskId) const
+{
+    Digest digest{kTokensTag};
+    digest.add(mModelId);
+    digest.addBytes(encoderTokens.data(), encoderTokens.size() * sizeof(TokenIdType));
+    return digest.finish(loraTaskId);
+}
+
+EncoderOutputCache::Key EncoderOutputCache::makeKey(
+    ITensor const& encoderInputFeatures, std::optional<LoraTaskIdType> loraTaskId) const
+{
+    TLLM_CHECK_WITH_INFO(encoderInputFeatures.getMemoryType() != MemoryType::kGPU,
+        "Encoder input features must be in host memory to be hashed.");
+    Digest digest{kFeaturesTag};
+    digest.add(mModelId);
+    digest.add(static_cast<std::uint64_t>(encoderInputFeatures.getDataType()));
+    auto const& shape = encoderInputFeatures.getShape();
+    for (SizeType32 i = 0; i < shape.nbDims; ++i)
+    {
+        digest.add(static_cast<std::uint64_t>(shape.d[i]));
+    }
+    digest.addBytes(encoderInputFeatures.data(), encoderInputFeatures.getSizeInBytes());
+    return digest.finish(loraTaskId);
+}
+
+std::optional<EncoderOutputCache::Key> EncoderOutputCache::makeKey(tb::LlmRequest const& request) const
+{
+    if (auto const features = request.getEncoderInputFeatures())
+    {
+        return makeKey(*features, request.getLoraTaskId());
+    }
+    if (auto const& tokens = request.getEncoderTokens())
+    {
+        return makeKey(*tokens.value(), request.getLoraTaskId());
+    }
+    return std::nullopt;
+}
+
+EncoderOutputCache::TensorPtr EncoderOutputCache::lookup(Key const& key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mEntries.find(key);
+    if (it == mEntries.end())
+    {
+        ++mStats.numMisses;
+        return nullptr;
+    }
+    mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+    ++mStats.numHits;
+    return it->second.output;
+}
+
+void EncoderOutputCache::insert(Key const& key, ITensor const& encoderOutput, BufferManager const& manager)
+{
+    auto const numBytes = encoderOutput.getSizeInBytes();
+    if (numBytes > mMaxBytes)
+    {
+        TLLM_LOG_DEBUG("Encoder output of %zu B exceeds the cache size, not cached", numBytes);
+        return;
+    }
+    // Copy outside of the lock, the output may be on the device.
+    TensorPtr output = manager.copyFrom(encoderOutput, mMemoryType);
+    if (encoderOutput.getMemoryType() == MemoryType::kGPU)
+    {
+        // Other streams may read the entry as soon as it is inserted.
+        manager.getStream().synchronize();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (auto const it = mEntries.find(key); it != mEntries.end())
+    {
+        eraseLocked(it);
+    }
+    while (mStats.usedBytes + numBytes > mMaxBytes)
+    {
+        eraseLocked(mEntries.find(mLru.back()));
+        ++mStats.numEvictions;
+    }
+    mLru.push_front(key);
+    mEntries.emplace(key, Entry{std::move(output), mLru.begin()});
+    mStats.usedBytes += numBytes;
+    mStats.numEntries = mEntries.size();
+    ++mStats.numInsertions;
+}
+
+bool EncoderOutputCache::loadEncoderOutput(tb::LlmRequest& request, BufferManager const& manager)
+{
+    if (!request.isEncoderInitState())
+    {
+        return false;
+    }
+    auto const key = makeKey(request);
+    if (!key)
+    {
+        return false;
+    }
+    auto output = lookup(*key);
+    if (!output)
+    {
+        return false;
+    }
+    TLLM_CHECK_WITH_INFO(output->getShape().d[0] == request.getEncoderOutputLen(),
+        "Cached encoder output of length %ld does not match the request %lu (%d)", output->getShape().d[0],
+        request.mRequestId, request.getEncoderOutputLen());
+    request.setEncoderOutput(manager.copyFrom(*output, MemoryType::kGPU));
+    if (request.getReturnEncoderOutput())
+    {
+        // The host output can reach the user in the response, so it must not alias the cached entry.
+        request.setEncoderOutputHost(manager.copyFrom(*output, MemoryType::kCPU));
+    }
+    request.mState = tb::REQUEST_STATE_CONTEXT_INIT;
+    return true;
+}
+
+void EncoderOutputCache::storeEncoderOutput(tb::LlmRequest const& request, BufferManager const& manager)
+{
+    auto const& output = request.getEncoderOutput();
+    TLLM_CHECK_WITH_INFO(output != nullptr, "Request %lu has no encoder output", request.mRequestId);
+    if (auto const key = makeKey(request))
+    {
+        insert(*key, *output, manager);
+    }
+}
+
+void EncoderOutputCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mLru.clear();
+    mStats.usedBytes = 0;
+    mStats.numEntries = 0;
+}
+
+EncoderOutputCache::Stats EncoderOutputCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void EncoderOutputCache::eraseLocked(std::unordered_map<Key, Entry, KeyHasher>::iterator it)
+{
+    mStats.usedBytes -= it->second.output->getSizeInBytes();
+    mLru.erase(it->second.lruIt);
+    mEntries.erase(it);
+    mStats.numEntries = mEntries.size();
+}
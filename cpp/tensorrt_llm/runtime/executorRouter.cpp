@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/executorRouter.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/hashUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+// Longest time awaitResponses blocks on one instance while responses of the others may be ready.
+auto constexpr kPollInterval = std::chrono::milliseconds{1};
+
+} // namespace
+
+ExecutorRouter::ExecutorRouter(SizeType32 numInstances, Policy policy, SizeType32 tokensPerBlock,
+    SizeType32 maxNumPrefixBlocks, SizeType32 maxImbalance)
+    : mPolicy{policy}
+    , mTokensPerBlock{tokensPerBlock}
+    , mMaxNumPrefixBlocks{maxNumPrefixBlocks}
+    , mMaxImbalance{maxImbalance}
+    , mInstances(numInstances)
+{
+    TLLM_CHECK_WITH_INFO(numInstances > 0, "The router needs at least one instance");
+    TLLM_CHECK(tokensPerBlock > 0);
+    TLLM_CHECK(maxNumPrefixBlocks > 0);
+    TLLM_CHECK(maxImbalance >= 0);
+}
+
+SizeType32 ExecutorRouter::route(texec::VecTokens const& inputTokens)
+{
+    auto const blockHashes
+        = mPolicy == Policy::kPREFIX_AFFINITY ? hashPrefixBlocks(inputTokens) : std::vector<std::uint64_t>{};
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    SizeType32 instance = 0;
+    if (mPolicy == Policy::kROUND_ROBIN)
+    {
+        instance = mNextInstance;
+        mNextInstance = (mNextInstance + 1) % getNumInstances();
+    }
+    else
+    {
+        instance = leastLoadedLocked();
+        // The deepest remembered block gives the instance most likely to hold the longest prefix of the prompt.
+        std::optional<SizeType32> affineInstance;
+        for (auto const hash : blockHashes)
+        {
+            auto const it = mPrefixes.find(hash);
+            if (it == mPrefixes.end())
+            {
+                break;
+            }
+            affineInstance = it->second.instance;
+        }
+        if (affineInstance)
+        {
+            if (loadLocked(*affineInstance) <= loadLocked(instance) + mMaxImbalance)
+            {
+                instance = *affineInstance;
+                ++mStats.numPrefixHits;
+            }
+            else
+            {
+                ++mStats.numRebalanced;
+            }
+        }
+        rememberLocked(blockHashes, instance);
+        mNextInstance = (instance + 1) % getNumInstances();
+    }
+    ++mInstances[instance].numOutstanding;
+    ++mStats.numRouted;
+    return instance;
+}
+
+void ExecutorRouter::onFinished(SizeType32 instance)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& numOutstanding = mInstances.at(instance).numOutstanding;
+    TLLM_CHECK_WITH_INFO(numOutstanding > 0, "Instance %d has no outstanding request", instance);
+    --numOutstanding;
+}
+
+void ExecutorRouter::updateLoad(SizeType32 instance, texec::IterationStats const& stats)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& state = mInstances.at(instance);
+    state.numReported = stats.numActiveRequests + stats.numQueuedRequests;
+    if (stats.kvCacheStats)
+    {
+        state.freeKvBlocks = stats.kvCacheStats->freeNumBlocks;
+    }
+}
+
+SizeType32 ExecutorRouter::getLoad(SizeType32 instance) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    TLLM_CHECK(instance >= 0 && instance < getNumInstances());
+    return loadLocked(instance);
+}
+
+ExecutorRouter::Stats ExecutorRouter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+SizeType32 ExecutorRouter::loadLocked(SizeType32 instance) const
+{
+    auto const& state = mInstances[instance];
+    return std::max(state.numOutstanding, state.numReported);
+}
+
+SizeType32 ExecutorRouter::leastLoadedLocked() const
+{
+    auto constexpr kUnknownFreeBlocks = std::numeric_limits<SizeType32>::max();
+    auto const numInstances = getNumInstances();
+    // Start the scan after the instance picked last, so that ties rotate over the instances.
+    auto best = mNextInstance;
+    for (SizeType32 i = 1; i < numInstances; ++i)
+    {
+        auto const candidate = (mNextInstance + i) % numInstances;
+        auto const candidateLoad = loadLocked(candidate);
+        auto const bestLoad = loadLocked(best);
+        if (candidateLoad < bestLoad
+            || (candidateLoad == bestLoad
+                && mInstances[candidate].freeKvBlocks.value_or(kUnknownFreeBlocks)
+                    > mInstances[best].freeKvBlocks.value_or(kUnknownFreeBlocks)))
+        {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+std::vector<std::uint64_t> ExecutorRouter::hashPrefixBlocks(texec::VecTokens const& inputTokens) const
+{
+    auto const numBlocks = static_cast<SizeType32>(inputTokens.size()) / mTokensPerBlock;
+    std::vector<std::uint64_t> blockHashes;
+    blockHashes.reserve(numBlocks);
+    std::size_t hash = 0;
+    for (SizeType32 block = 0; block < numBlocks; ++block)
+    {
+        auto const* tokens = inputTokens.data() + block * mTokensPerBlock;
+        for (SizeType32 i = 0; i < mTokensPerBlock; ++i)
+        {
+            common::hashCombine(hash, static_cast<std::uint32_t>(tokens[i]));
+        }
+        hash = common::hashMix64(hash);
+        blockHashes.push_back(hash);
+    }
+    return blockHashes;
+}
+
+void ExecutorRouter::rememberLocked(std::vector<std::uint64_t> const& blockHashes, SizeType32 instance)
+{
+    // Deepest block first, so that the leading blocks shared by many prompts are the last to be forgotten.
+    for (auto blockIt = blockHashes.rbegin(); blockIt != blockHashes.rend(); ++blockIt)
+    {
+        auto const hash = *blockIt;
+        if (auto const it = mPrefixes.find(hash); it != mPrefixes.end())
+        {
+            it->second.instance = instance;
+            mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+            continue;
+        }
+        if (static_cast<SizeType32>(mPrefixes.size()) == mMaxNumPrefixBlocks)
+        {
+            mPrefixes.erase(mLru.back());
+            mLru.pop_back();
+        }
+        mLru.push_front(hash);
+        mPrefixes.emplace(hash, PrefixEntry{instance, mLru.begin()});
+    }
+}
+
+RoutingExecutor::RoutingExecutor(
+    std::vector<std::shared_ptr<texec::Executor>> executors, std::shared_ptr<ExecutorRouter> router)
+    : mExecutors{std::move(executors)}
+    , mRouter{std::move(router)}
+    , mRequestIds(mExecutors.size())
+    , mIterationStats(mExecutors.size())
+{
+    TLLM_CHECK(mRouter);
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(mExecutors.size()) == mRouter->getNumInstances(),
+        "The router has %d instances but %lu executors are given", mRouter->getNumInstances(), mExecutors.size());
+    for (auto const& executor : mExecutors)
+    {
+        TLLM_CHECK(executor);
+    }
+}
+
+texec::IdType RoutingExecutor::enqueueRequest(texec::Request const& request)
+{
+    return enqueueRequests({request}).front();
+}
+
+std::vector<texec::IdType> RoutingExecutor::enqueueRequests(std::vector<texec::Request> const& requests)
+{
+    std::vector<texec::IdType> requestIds;
+    requestIds.reserve(requests.size());
+
+    // Hold the lock until the routes are recorded, so that their first responses cannot be consumed before.
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto const& request : requests)
+    {
+        auto const instance = mRouter->route(request.getInputTokenIds());
+        texec::IdType instanceRequestId{};
+        try
+        {
+            instanceRequestId = mExecutors[instance]->enqueueRequest(request);
+        }
+        catch (...)
+        {
+            mRouter->onFinished(instance);
+            throw;
+        }
+        auto const requestId = mNextRequestId++;
+        mRoutes.emplace(requestId, Route{instance, instanceRequestId});
+        mRequestIds[instance].emplace(instanceRequestId, requestId);
+        requestIds.push_back(requestId);
+    }
+    return requestIds;
+}
+
+std::vector<texec::Response> RoutingExecutor::awaitResponses(std::optional<std::chrono::milliseconds> const& timeout)
+{
+    auto const numInstances = static_cast<SizeType32>(mExecutors.size());
+    std::vector<texec::Response> responses;
+    for (SizeType32 instance = 0; instance < numInstances; ++instance)
+    {
+        collectResponses(instance, std::chrono::milliseconds{0}, responses);
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    SizeType32 instance = 0;
+    while (responses.empty())
+    {
+        auto slice = kPollInterval;
+        if (timeout)
+        {
+            auto const elapsed
+                = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            if (elapsed >= *timeout)
+            {
+                break;
+            }
+            slice = std::min(slice, *timeout - elapsed);
+        }
+        collectResponses(instance, slice, responses);
+        instance = (instance + 1) % numInstances;
+    }
+    return responses;
+}
+
+void RoutingExecutor::cancelRequest(texec::IdType requestId)
+{
+    std::optional<Route> route;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto const it = mRoutes.find(requestId); it != mRoutes.end())
+        {
+            route = it->second;
+        }
+    }
+    if (!route)
+    {
+        TLLM_LOG_WARNING("Cannot cancel request %lu, it is unknown or already finished", requestId);
+        return;
+    }
+    // The final response of the cancelled request releases its route.
+    mExecutors[route->instance]->cancelRequest(route->instanceRequestId);
+}
+
+std::deque<texec::IterationStats> RoutingExecutor::getLatestIterationStats(SizeType32 instance)
+{
+    TLLM_CHECK(instance >= 0 && instance < static_cast<SizeType32>(mExecutors.size()));
+    std::lock_guard<std::mutex> lock(mIterationStatsMutex);
+    return std::exchange(mIterationStats[instance], {});
+}
+
+void RoutingExecutor::collectResponses(
+    SizeType32 instance, std::chrono::milliseconds timeout, std::vector<texec::Response>& responses)
+{
+    auto& executor = *mExecutors[instance];
+    if (auto stats = executor.getLatestIterationStats(); !stats.empty())
+    {
+        mRouter->updateLoad(instance, stats.back());
+        std::lock_guard<std::mutex> lock(mIterationStatsMutex);
+        auto& kept = mIterationStats[instance];
+        std::move(stats.begin(), stats.end(), std::back_inserter(kept));
+        while (kept.size() > static_cast<std::size_t>(texec::kDefaultIterStatsMaxIterations))
+        {
+            kept.pop_front();
+        }
+    }
+    auto ready = executor.awaitResponses(timeout);
+    if (ready.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& requestIds = mRequestIds[instance];
+    for (auto const& response : ready)
+    {
+        auto const it = requestIds.find(response.getRequestId());
+        if (it == requestIds.end())
+        {
+            TLLM_LOG_WARNING("Dropping a response of instance %d for unknown request %lu", instance,
+                response.getRequestId());
+            continue;
+        }
+        auto const requestId = it->second;
+        auto const isFinal = response.hasError() || response.getResult().isFinal;
+        if (response.hasError())
+        {
+            responses.emplace_back(requestId, response.getErrorMsg());
+        }
+        else
+        {
+            responses.emplace_back(requestId, response.getResult());
+        }
+        if (isFinal)
+        {
+            requestIds.erase(it);
+            mRoutes.erase(requestId);
+            mRouter->onFinished(instance);
+        }
+    }
+}
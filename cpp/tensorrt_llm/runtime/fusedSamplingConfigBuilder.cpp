@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/fusedSamplingConfigBuilder.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/hashUtils.h"
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+using layers::DefaultDecodingParams;
+
+//! Calls func(member, defaultValue, broadcastable) for every per-request field of SamplingConfig. A field is
+//! broadcastable if the decoding layers accept a single value for the whole batch.
+template <typename Func>
+void forEachField(Func&& func)
+{
+    func(&SamplingConfig::temperature, DefaultDecodingParams::getTemperature(), true);
+    func(&SamplingConfig::minLength, DefaultDecodingParams::getMinLength(), true);
+    func(&SamplingConfig::repetitionPenalty, DefaultDecodingParams::getRepetitionPenalty(), true);
+    func(&SamplingConfig::presencePenalty, DefaultDecodingParams::getPresencePenalty(), true);
+    func(&SamplingConfig::frequencyPenalty, DefaultDecodingParams::getFrequencyPenalty(), true);
+    func(&SamplingConfig::noRepeatNgramSize, DefaultDecodingParams::getNoRepeatNgramSize(), true);
+    func(&SamplingConfig::topK, DefaultDecodingParams::getTopK(), true);
+    func(&SamplingConfig::topP, DefaultDecodingParams::getTopP(), true);
+    func(&SamplingConfig::randomSeed, DefaultDecodingParams::getSeed(), true);
+    // The top-p decay parameters are copied to the batch slots without broadcasting.
+    func(&SamplingConfig::topPDecay, DefaultDecodingParams::getTopPDecay(), false);
+    func(&SamplingConfig::topPMin, DefaultDecodingParams::getTopPMin(), false);
+    func(&SamplingConfig::topPResetIds, DefaultDecodingParams::getTopPResetId(), false);
+    func(&SamplingConfig::beamSearchDiversityRate, DefaultDecodingParams::getBeamSearchDiversity(), true);
+    func(&SamplingConfig::lengthPenalty, DefaultDecodingParams::getLengthPenalty(), true);
+    func(&SamplingConfig::earlyStopping, DefaultDecodingParams::getEarlyStopping(), true);
+    func(&SamplingConfig::topKMedusaHeads, DefaultDecodingParams::getTopKMedusaHeads(), false);
+    func(&SamplingConfig::outputLogProbs, false, true);
+    func(&SamplingConfig::cumLogProbs, false, true);
+    func(&SamplingConfig::draftAcceptanceThreshold, 0.f, true);
+}
+
+using common::hashCombine;
+
+template <typename T>
+std::size_t hashValue(T const& value)
+{
+    return std::hash<T>{}(value);
+}
+
+std::size_t hashValue(std::vector<SizeType32> const& values)
+{
+    std::size_t seed = values.size();
+    for (auto const value : values)
+    {
+        hashCombine(seed, std::hash<SizeType32>{}(value));
+    }
+    return seed;
+}
+
+std::size_t hashConfig(SamplingConfig const& config)
+{
+    std::size_t seed = std::hash<SizeType32>{}(config.beamWidth);
+    hashCombine(seed, std::size_t{config.normalizeLogProbs ? 1u + *config.normalizeLogProbs : 0u});
+    forEachField(
+        [&config, &seed](auto field, auto const& defaultValue, bool /* broadcastable */)
+        {
+            using T = std::decay_t<decltype(defaultValue)>;
+            auto const& value = config.*field;
+            hashCombine(seed, value ? hashValue(static_cast<T>(value->front())) : std::size_t{0});
+        });
+    return seed;
+}
+
+} // namespace
+
+FusedSamplingConfigBuilder::FusedSamplingConfigBuilder(SizeType32 maxNumSlots)
+    : mSlotConfigIds(maxNumSlots, kNoConfig)
+{
+    TLLM_CHECK(maxNumSlots > 0);
+    mConfigs.reserve(maxNumSlots);
+}
+
+void FusedSamplingConfigBuilder::checkSlot(SizeType32 slot) const
+{
+    TLLM_CHECK_WITH_INFO(0 <= slot && slot < getMaxNumSlots(), "Slot %d is out of range [0, %d)", slot,
+        getMaxNumSlots());
+}
+
+void FusedSamplingConfigBuilder::setSlot(SizeType32 slot, SamplingConfig const& config)
+{
+    checkSlot(slot);
+    forEachField(
+        [&config, slot](auto field, auto const& /* defaultValue */, bool /* broadcastable */)
+        {
+            auto const& value = config.*field;
+            TLLM_CHECK_WITH_INFO(
+                !value || value->size() == 1, "The sampling config of slot %d must hold a single request", slot);
+        });
+
+    auto const hash = hashConfig(config);
+    auto id = kNoConfig;
+    auto const [first, last] = mIdsByHash.equal_range(hash);
+    for (auto it = first; it != last; ++it)
+    {
+        if (mConfigs[it->second].config == config)
+        {
+            id = it->second;
+            break;
+        }
+    }
+    if (id == kNoConfig)
+    {
+        if (mFreeIds.empty())
+        {
+            id = static_cast<ConfigId>(mConfigs.size());
+            mConfigs.push_back(Entry{config, hash, 0});
+        }
+        else
+        {
+            id = mFreeIds.back();
+            mFreeIds.pop_back();
+            mConfigs[id] = Entry{config, hash, 0};
+        }
+        mIdsByHash.emplace(hash, id);
+    }
+    // Take the reference before releasing the previous config of the slot, so that an unchanged slot keeps its id.
+    ++mConfigs[id].numSlots;
+    clearSlot(slot);
+    mSlotConfigIds[slot] = id;
+}
+
+void FusedSamplingConfigBuilder::clearSlot(SizeType32 slot)
+{
+    checkSlot(slot);
+    auto const id = mSlotConfigIds[slot];
+    if (id == kNoConfig)
+    {
+        return;
+    }
+    mSlotConfigIds[slot] = kNoConfig;
+    auto& entry = mConfigs[id];
+    if (--entry.numSlots > 0)
+    {
+        return;
+    }
+    auto const [first, last] = mIdsByHash.equal_range(entry.hash);
+    mIdsByHash.erase(std::find_if(first, last, [id](auto const& item) { return item.second == id; }));
+    mFreeIds.push_back(id);
+}
+
+FusedSamplingConfigBuilder::ConfigId FusedSamplingConfigBuilder::getConfigId(SizeType32 slot) const
+{
+    checkSlot(slot);
+    return mSlotConfigIds[slot];
+}
+
+SamplingConfig const& FusedSamplingConfigBuilder::getConfig(ConfigId id) const
+{
+    TLLM_CHECK_WITH_INFO(0 <= id && id < static_cast<ConfigId>(mConfigs.size()) && mConfigs[id].numSlots > 0,
+        "Sampling config %d is not in use", id);
+    return mConfigs[id].config;
+}
+
+SamplingConfig FusedSamplingConfigBuilder::fuse(std::vector<SizeType32> const& slots) const
+{
+    TLLM_CHECK(!slots.empty());
+    std::vector<ConfigId> ids;
+    ids.reserve(slots.size());
+    std::vector<ConfigId> uniqueIds;
+    std::vector<bool> isSeen(mConfigs.size());
+    for (auto const slot : slots)
+    {
+        auto const id = getConfigId(slot);
+        TLLM_CHECK_WITH_INFO(id != kNoConfig, "Slot %d has no sampling config", slot);
+        ids.push_back(id);
+        if (!isSeen[id])
+        {
+            isSeen[id] = true;
+            uniqueIds.push_back(id);
+        }
+    }
+
+    auto const& front = mConfigs[ids.front()].config;
+    SamplingConfig fused{front.beamWidth};
+    fused.normalizeLogProbs = front.normalizeLogProbs;
+    forEachField(
+        [this, &ids, &uniqueIds, &fused](auto field, auto const& defaultValue, bool broadcastable)
+        {
+            using T = std::decay_t<decltype(defaultValue)>;
+            auto const valueOf = [this, field, &defaultValue](ConfigId id) -> T
+            {
+                auto const& value = mConfigs[id].config.*field;
+                return value ? value->front() : defaultValue;
+            };
+
+            bool hasValue{false};
+            bool uniform{true};
+            for (auto const id : uniqueIds)
+            {
+                hasValue |= (mConfigs[id].config.*field).has_value();
+                uniform &= valueOf(id) == valueOf(uniqueIds.front());
+            }
+            if (!hasValue)
+            {
+                return;
+            }
+            if (uniform && broadcastable)
+            {
+                fused.*field = std::vector<T>{valueOf(uniqueIds.front())};
+                return;
+            }
+            std::vector<T> values;
+            values.reserve(ids.size());
+            for (auto const id : ids)
+            {
+                values.push_back(valueOf(id));
+            }
+            fused.*field = std::move(values);
+        });
+    return fused;
+}
+
+} // namespace tensorrt_llm::runtime
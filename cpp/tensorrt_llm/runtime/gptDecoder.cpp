@@ -46,8 +46,8 @@ GptDecoder<T>::GptDecoder(executor::DecodingMode const& mode, size_t maxBatchSiz
     , mDecodingMode{mode}
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
-    auto const decodingDomain = tensorrt_llm::layers::DecoderDomain(
-        maxBatchSize, maxBeamWidth, vocabSize, vocabSizePadded, speculativeDecodingModule);
+    auto const decodingDomain = tensorrt_llm::layers::DecoderDomain(maxBatchSize, maxBeamWidth, vocabSize,
+        vocabSizePadded, speculativeDecodingModule, static_cast<SizeType32>(maxSequenceLength));
     mDynamicDecodeLayer = std::make_shared<tensorrt_llm::layers::DynamicDecodeLayer<T>>(mode, decodingDomain, mManager);
     auto constexpr nvFloatType = TRTDataType<float>::value;
     mLogProbsTiled = mManager->gpu(ITensor::makeShape({static_cast<SizeType32>(maxSequenceLength),
@@ -26,8 +26,11 @@
 #include "tensorrt_llm/runtime/modelConfig.h"
 
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 
 using namespace tensorrt_llm::runtime;
@@ -40,38 +43,171 @@ using Json = typename nlohmann::json::basic_json;
 template <typename FieldType>
 FieldType parseJsonFieldOr(Json const& json, std::string_view name, FieldType defaultValue)
 {
-    auto value = defaultValue;
-    try
-    {
-        value = json.at(name).template get<FieldType>();
-    }
-    catch (nlohmann::json::out_of_range& e)
+    auto const it = json.find(name);
+    if (it == json.end() || it->is_null())
     {
-        TLLM_LOG_DEBUG("Parameter %s cannot be read from json:", std::string(name).c_str());
-        TLLM_LOG_DEBUG(e.what());
+        TLLM_LOG_DEBUG("Parameter %s cannot be read from json, using the default value.", std::string(name).c_str());
+        return defaultValue;
     }
-    return value;
+    return it->template get<FieldType>();
 }
 
 template <typename FieldType>
 std::optional<FieldType> parseJsonFieldOptional(Json const& json, std::string_view name)
 {
-    std::optional<FieldType> value = std::nullopt;
-    try
+    auto const it = json.find(name);
+    if (it == json.end() || it->is_null())
     {
-        value = json.at(name).template get<FieldType>();
+        TLLM_LOG_DEBUG("Optional value for parameter %s will not be set.", std::string(name).c_str());
+        return std::nullopt;
     }
-    catch (nlohmann::json::out_of_range const& e)
+    try
     {
-        TLLM_LOG_DEBUG(e.what());
-        TLLM_LOG_DEBUG("Optional value for parameter %s will not be set.", std::string(name).c_str());
+        return it->template get<FieldType>();
     }
     catch (nlohmann::json::type_error const& e)
     {
         TLLM_LOG_DEBUG(e.what());
         TLLM_LOG_DEBUG("Optional value for parameter %s will not be set.", std::string(name).c_str());
     }
-    return value;
+    return std::nullopt;
+}
+
+enum class FieldKind
+{
+    kAny,
+    kObject,
+    kString,
+    kInteger,
+    kBoolean,
+    kArray
+};
+
+struct FieldSchema
+{
+    char const* path;
+    FieldKind kind;
+    bool required;
+};
+
+// Fields read by the parser, as json pointers into the config. Required fields must be present, all listed fields
+// must have the listed kind when present, optional fields may also be null, which is read as missing. Fields that are
+// only read for some architectures are checked when read.
+std::vector<FieldSchema> const kLegacyConfigSchema{
+    {"/builder_config", FieldKind::kObject, true},
+    {"/builder_config/name", FieldKind::kString, true},
+    {"/builder_config/precision", FieldKind::kString, true},
+    {"/builder_config/tensor_parallel", FieldKind::kInteger, true},
+    {"/builder_config/pipeline_parallel", FieldKind::kInteger, false},
+    {"/builder_config/num_layers", FieldKind::kInteger, true},
+    {"/builder_config/num_heads", FieldKind::kInteger, true},
+    {"/builder_config/num_kv_heads", FieldKind::kInteger, false},
+    {"/builder_config/hidden_size", FieldKind::kInteger, true},
+    {"/builder_config/vocab_size", FieldKind::kInteger, true},
+    {"/builder_config/head_size", FieldKind::kInteger, false},
+    {"/builder_config/max_batch_size", FieldKind::kInteger, false},
+    {"/builder_config/max_beam_width", FieldKind::kInteger, false},
+    {"/builder_config/max_input_len", FieldKind::kInteger, false},
+    {"/builder_config/max_seq_len", FieldKind::kInteger, false},
+    {"/builder_config/max_lora_rank", FieldKind::kInteger, false},
+    {"/builder_config/lora_target_modules", FieldKind::kArray, false},
+    {"/builder_config/quant_mode", FieldKind::kInteger, false},
+    {"/plugin_config", FieldKind::kObject, true},
+    {"/plugin_config/gpt_attention_plugin", FieldKind::kAny, true},
+    {"/plugin_config/lora_plugin", FieldKind::kAny, true},
+    {"/plugin_config/remove_input_padding", FieldKind::kBoolean, true},
+    {"/plugin_config/paged_kv_cache", FieldKind::kAny, true},
+    {"/plugin_config/tokens_per_block", FieldKind::kInteger, true},
+    {"/plugin_config/context_fmha", FieldKind::kBoolean, true},
+    {"/plugin_config/use_paged_context_fmha", FieldKind::kBoolean, true},
+};
+
+std::vector<FieldSchema> const kConfigSchema{
+    {"/pretrained_config", FieldKind::kObject, true},
+    {"/pretrained_config/architecture", FieldKind::kString, true},
+    {"/pretrained_config/dtype", FieldKind::kString, true},
+    {"/pretrained_config/mapping", FieldKind::kObject, true},
+    {"/pretrained_config/mapping/tp_size", FieldKind::kInteger, true},
+    {"/pretrained_config/mapping/pp_size", FieldKind::kInteger, false},
+    {"/pretrained_config/mapping/gpus_per_node", FieldKind::kInteger, false},
+    {"/pretrained_config/num_hidden_layers", FieldKind::kInteger, true},
+    {"/pretrained_config/num_attention_heads", FieldKind::kInteger, true},
+    {"/pretrained_config/num_key_value_heads", FieldKind::kInteger, false},
+    {"/pretrained_config/hidden_size", FieldKind::kInteger, true},
+    {"/pretrained_config/vocab_size", FieldKind::kInteger, true},
+    {"/pretrained_config/head_size", FieldKind::kInteger, false},
+    {"/pretrained_config/layer_types", FieldKind::kArray, false},
+    {"/pretrained_config/quantization", FieldKind::kObject, true},
+    {"/build_config", FieldKind::kObject, true},
+    {"/build_config/max_batch_size", FieldKind::kInteger, false},
+    {"/build_config/max_beam_width", FieldKind::kInteger, false},
+    {"/build_config/max_input_len", FieldKind::kInteger, false},
+    {"/build_config/max_seq_len", FieldKind::kInteger, false},
+    {"/build_config/max_draft_len", FieldKind::kInteger, false},
+    {"/build_config/lora_config", FieldKind::kObject, true},
+    {"/build_config/lora_config/max_lora_rank", FieldKind::kInteger, false},
+    {"/build_config/lora_config/lora_target_modules", FieldKind::kArray, false},
+    {"/build_config/plugin_config", FieldKind::kObject, true},
+    {"/build_config/plugin_config/gpt_attention_plugin", FieldKind::kAny, true},
+    {"/build_config/plugin_config/lora_plugin", FieldKind::kAny, true},
+    {"/build_config/plugin_config/remove_input_padding", FieldKind::kBoolean, true},
+    {"/build_config/plugin_config/paged_kv_cache", FieldKind::kAny, true},
+    {"/build_config/plugin_config/tokens_per_block", FieldKind::kInteger, true},
+    {"/build_config/plugin_config/context_fmha", FieldKind::kBoolean, true},
+    {"/build_config/plugin_config/use_paged_context_fmha", FieldKind::kBoolean, true},
+};
+
+bool hasKind(Json const& value, FieldKind kind)
+{
+    switch (kind)
+    {
+    case FieldKind::kAny: return true;
+    case FieldKind::kObject: return value.is_object();
+    case FieldKind::kString: return value.is_string();
+    case FieldKind::kInteger: return value.is_number_integer();
+    case FieldKind::kBoolean: return value.is_boolean();
+    case FieldKind::kArray: return value.is_array();
+    }
+    return false;
+}
+
+char const* kindName(FieldKind kind)
+{
+    switch (kind)
+    {
+    case FieldKind::kAny: return "any";
+    case FieldKind::kObject: return "object";
+    case FieldKind::kString: return "string";
+    case FieldKind::kInteger: return "integer";
+    case FieldKind::kBoolean: return "boolean";
+    case FieldKind::kArray: return "array";
+    }
+    return "unknown";
+}
+
+// Checks the config against the schema and throws one error that lists all missing and invalid fields, so that a
+// broken config is fixed in one go instead of one field per attempt.
+void validateJson(Json const& json, std::vector<FieldSchema> const& schema)
+{
+    std::string errors;
+    for (auto const& field : schema)
+    {
+        Json::json_pointer const pointer{field.path};
+        if (!json.contains(pointer))
+        {
+            if (field.required)
+            {
+                errors += std::string("\n  missing field ") + field.path;
+            }
+        }
+        else if (auto const& value = json.at(pointer);
+                 !hasKind(value, field.kind) && (field.required || !value.is_null()))
+        {
+            errors += std::string("\n  field ") + field.path + " must be of type " + kindName(field.kind) + ", got "
+                + value.type_name();
+        }
+    }
+    TLLM_CHECK_WITH_INFO(errors.empty(), "Invalid engine config:%s", errors.c_str());
 }
 
 std::vector<ModelConfig::LayerType> buildLayerTypes(
@@ -294,12 +430,15 @@ void parseLora(ModelConfig& modelConfig, Json const& json, Json const& pluginCon
 }
 
 template <typename InputType>
-GptJsonConfig parseJson(InputType&& input)
+Json readJson(InputType&& input)
 {
     auto constexpr allowExceptions = true;
     auto constexpr ignoreComments = true;
-    auto const json = nlohmann::json::parse(std::forward<InputType>(input), nullptr, allowExceptions, ignoreComments);
+    return nlohmann::json::parse(std::forward<InputType>(input), nullptr, allowExceptions, ignoreComments);
+}
 
+GptJsonConfig parseJson(Json const& json)
+{
     auto const engineVersion = parseJsonFieldOr(json, "version", std::string("none"));
 
     auto const engineVersionNone = engineVersion == std::string("none");
@@ -312,6 +451,7 @@ GptJsonConfig parseJson(InputType&& input)
         TLLM_LOG_INFO("Engine version %s found in the config file, assuming engine(s) built by new builder API.",
             engineVersion.c_str());
     }
+    validateJson(json, engineVersionNone ? kLegacyConfigSchema : kConfigSchema);
 
     auto const& builderConfig = engineVersionNone ? json.at("builder_config") : json.at("build_config");
 
@@ -535,17 +675,54 @@ std::string GptJsonConfig::engineFilename(WorldConfig const& worldConfig, std::s
 
 GptJsonConfig GptJsonConfig::parse(std::string const& json)
 {
-    return parseJson(json);
+    return parseJson(readJson(json));
 }
 
 GptJsonConfig GptJsonConfig::parse(std::istream& json)
 {
-    return parseJson(json);
+    return parseJson(readJson(json));
 }
 
 GptJsonConfig GptJsonConfig::parse(std::filesystem::path const& path)
 {
     TLLM_CHECK_WITH_INFO(std::filesystem::exists(path), std::string("File does not exist: ") + path.string());
-    std::ifstream json(path);
-    return parse(json);
+
+    // Executors, sessions and their workers parse the config of the same engine over and over. The json documents are
+    // kept per file and reused as long as the file is unchanged. The config is still built for every call, so that each
+    // caller gets its own speculative decoding module, which executors configure.
+    struct CachedJson
+    {
+        std::filesystem::file_time_type lastWriteTime;
+        std::uintmax_t fileSize;
+        std::shared_ptr<Json const> json;
+    };
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, CachedJson> cache;
+
+    auto const key = std::filesystem::canonical(path).string();
+    auto const lastWriteTime = std::filesystem::last_write_time(path);
+    auto const fileSize = std::filesystem::file_size(path);
+    std::shared_ptr<Json const> json;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto const it = cache.find(key);
+        if (it != cache.end() && it->second.lastWriteTime == lastWriteTime && it->second.fileSize == fileSize)
+        {
+            TLLM_LOG_DEBUG("Reusing the parsed config of %s", key.c_str());
+            json = it->second.json;
+        }
+    }
+    if (json)
+    {
+        return parseJson(*json);
+    }
+
+    std::ifstream file(path);
+    json = std::make_shared<Json const>(readJson(file));
+    auto config = parseJson(*json);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.insert_or_assign(key, CachedJson{lastWriteTime, fileSize, std::move(json)});
+    return config;
 }
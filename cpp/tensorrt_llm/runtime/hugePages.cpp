@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/hugePages.h"
+
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+std::size_t constexpr kTransparentPageBytes = getHugePageBytes(HugePageSize::k2MB);
+
+std::size_t roundUp(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+void* mapAnonymous(std::size_t size, int flags)
+{
+    auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+//! \brief Map size bytes aligned to a transparent huge page, trimming the over-allocation.
+void* mapAligned(std::size_t size)
+{
+    auto const mappedSize = size + kTransparentPageBytes;
+    auto* const mapped = static_cast<std::uint8_t*>(mapAnonymous(mappedSize, 0));
+    if (mapped == nullptr)
+    {
+        return nullptr;
+    }
+    auto* const aligned = reinterpret_cast<std::uint8_t*>(
+        roundUp(reinterpret_cast<std::uintptr_t>(mapped), kTransparentPageBytes));
+    if (aligned != mapped)
+    {
+        ::munmap(mapped, static_cast<std::size_t>(aligned - mapped));
+    }
+    auto const tail = static_cast<std::size_t>(mapped + mappedSize - (aligned + size));
+    if (tail > 0)
+    {
+        ::munmap(aligned + size, tail);
+    }
+    return aligned;
+}
+
+} // namespace
+
+namespace tensorrt_llm::runtime
+{
+
+HugePageMapping mapHugePages(std::size_t size, HugePageSize pageSize)
+{
+    auto const mappedSize = roundUp(std::max(size, std::size_t{1}), getHugePageBytes(pageSize));
+
+    auto const hugeFlags = MAP_HUGETLB | (static_cast<int>(pageSize) << MAP_HUGE_SHIFT);
+    if (auto* data = mapAnonymous(mappedSize, hugeFlags))
+    {
+        return HugePageMapping{data, mappedSize, HugePageBacking::kHUGETLB};
+    }
+
+    auto* data = mapAligned(mappedSize);
+    if (data == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    if (::madvise(data, mappedSize, MADV_HUGEPAGE) == 0)
+    {
+        TLLM_LOG_DEBUG("No hugetlb pages left for %zu B, using transparent huge pages", mappedSize);
+        return HugePageMapping{data, mappedSize, HugePageBacking::kTRANSPARENT};
+    }
+    TLLM_LOG_WARNING("Huge pages are not available, %zu B are backed by regular pages", mappedSize);
+    return HugePageMapping{data, mappedSize, HugePageBacking::kREGULAR};
+}
+
+void unmapHugePages(void* data, std::size_t size, HugePageSize pageSize) noexcept
+{
+    if (data != nullptr)
+    {
+        ::munmap(data, roundUp(std::max(size, std::size_t{1}), getHugePageBytes(pageSize)));
+    }
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvBlockCodec.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TLLM_KV_BLOCK_CODEC_AVX2 1
+#endif
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+float constexpr kInt8Max = 127.f;
+float constexpr kFp8Max = 448.f;
+//! Smallest normal FP8 E4M3 value, 2^-6.
+float constexpr kFp8MinNormal = 0.015625f;
+
+std::uint32_t toBits(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float fromBits(std::uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+float halfToFloat(std::uint16_t h)
+{
+    auto const sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+    auto const exponent = (h >> 10) & 0x1fu;
+    auto const mantissa = h & 0x3ffu;
+    if (exponent == 0)
+    {
+        // Zero or subnormal.
+        auto const magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+        return fromBits(sign | toBits(magnitude));
+    }
+    if (exponent == 0x1f)
+    {
+        return fromBits(sign | 0x7f800000u | (mantissa << 13));
+    }
+    return fromBits(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+//! \brief Round to nearest even, like F16C.
+std::uint16_t floatToHalf(float value)
+{
+    auto const bits = toBits(value);
+    auto const sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+    auto const magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u)
+    {
+        return sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u);
+    }
+    if (magnitude >= 0x477ff000u)
+    {
+        // Rounds to above the largest half.
+        return sign | 0x7c00u;
+    }
+    if (magnitude < 0x38800000u)
+    {
+        // Subnormal half: the magic addition rounds to nearest even in units of 2^-24.
+        auto const rounded = toBits(fromBits(magnitude) + 0.5f) - toBits(0.5f);
+        return sign | static_cast<std::uint16_t>(rounded);
+    }
+    auto const rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u) - (112u << 23);
+    return sign | static_cast<std::uint16_t>(rounded >> 13);
+}
+
+float bf16ToFloat(std::uint16_t b)
+{
+    return fromBits(static_cast<std::uint32_t>(b) << 16);
+}
+
+std::uint16_t floatToBf16(float value)
+{
+    auto const bits = toBits(value);
+    return static_cast<std::uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+//! \brief Convert a float within [-448, 448] to FP8 E4M3, rounding to nearest even.
+std::uint8_t floatToFp8(float value)
+{
+    auto const sign = static_cast<std::uint8_t>((toBits(value) >> 24) & 0x80u);
+    auto const magnitude = std::min(std::fabs(value), kFp8Max);
+    if (magnitude < kFp8MinNormal)
+    {
+        // Subnormals are multiples of 2^-9, rounding up to 2^-6 yields its encoding 0x08.
+        return sign | static_cast<std::uint8_t>(std::nearbyint(magnitude * 512.f));
+    }
+    auto bits = toBits(magnitude);
+    bits += 0x7ffffu + ((bits >> 20) & 1u);
+    return sign | static_cast<std::uint8_t>((((bits >> 23) - 120u) << 3) | ((bits >> 20) & 7u));
+}
+
+std::array<float, 256> makeFp8Table()
+{
+    std::array<float, 256> table{};
+    for (int q = 0; q < 256; ++q)
+    {
+        auto const exponent = (q >> 3) & 0xf;
+        auto const mantissa = q & 0x7;
+        auto const magnitude = exponent == 0 ? std::ldexp(static_cast<float>(mantissa), -9)
+                                             : std::ldexp(1.f + static_cast<float>(mantissa) / 8.f, exponent - 7);
+        table[q] = (exponent == 0xf && mantissa == 0x7) ? std::numeric_limits<float>::quiet_NaN()
+                                                         : ((q & 0x80) ? -magnitude : magnitude);
+    }
+    return table;
+}
+
+std::array<float, 256> const kFp8ToFloat = makeFp8Table();
+
+template <nvinfer1::DataType kType>
+struct Element;
+
+template <>
+struct Element<nvinfer1::DataType::kHALF>
+{
+    using StorageType = std::uint16_t;
+
+    static float load(StorageType value)
+    {
+        return halfToFloat(value);
+    }
+
+    static StorageType store(float value)
+    {
+        return floatToHalf(value);
+    }
+};
+
+template <>
+struct Element<nvinfer1::DataType::kBF16>
+{
+    using StorageType = std::uint16_t;
+
+    static float load(StorageType value)
+    {
+        return bf16ToFloat(value);
+    }
+
+    static StorageType store(float value)
+    {
+        return floatToBf16(value);
+    }
+};
+
+template <>
+struct Element<nvinfer1::DataType::kFLOAT>
+{
+    using StorageType = float;
+
+    static float load(StorageType value)
+    {
+        return value;
+    }
+
+    static StorageType store(float value)
+    {
+        return value;
+    }
+};
+
+//! \brief Scalar kernels, also used for the tail of a slab by the SIMD kernels.
+template <nvinfer1::DataType kType>
+struct ScalarKernels
+{
+    using E = Element<kType>;
+    using T = typename E::StorageType;
+
+    static float amax(T const* src, std::size_t begin, std::size_t end, float value = 0.f)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            value = std::max(value, std::fabs(E::load(src[i])));
+        }
+        return value;
+    }
+
+    static void quantizeInt8(T const* src, std::uint8_t* dst, float invScale, std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const q = std::clamp(std::nearbyint(E::load(src[i]) * invScale), -kInt8Max, kInt8Max);
+            dst[i] = static_cast<std::uint8_t>(static_cast<std::int8_t>(q));
+        }
+    }
+
+    static void quantizeFp8(T const* src, std::uint8_t* dst, float invScale, std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            dst[i] = floatToFp8(E::load(src[i]) * invScale);
+        }
+    }
+
+    static void dequantizeInt8(std::uint8_t const* src, T* dst, float scale, std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            dst[i] = E::store(static_cast<float>(static_cast<std::int8_t>(src[i])) * scale);
+        }
+    }
+
+    static void dequantizeFp8(std::uint8_t const* src, T* dst, float scale, std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            dst[i] = E::store(kFp8ToFloat[src[i]] * scale);
+        }
+    }
+};
+
+#ifdef TLLM_KV_BLOCK_CODEC_AVX2
+
+#define TLLM_AVX2 __attribute__((target("avx2,f16c")))
+
+bool cpuSupportsAvx2()
+{
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+}
+
+template <nvinfer1::DataType kType>
+struct Avx2Element;
+
+template <>
+struct Avx2Element<nvinfer1::DataType::kHALF>
+{
+    TLLM_AVX2 static __m256 load(std::uint16_t const* src)
+    {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(src)));
+    }
+
+    TLLM_AVX2 static void store(std::uint16_t* dst, __m256 value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+template <>
+struct Avx2Element<nvinfer1::DataType::kBF16>
+{
+    TLLM_AVX2 static __m256 load(std::uint16_t const* src)
+    {
+        auto const wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(src)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+    }
+
+    TLLM_AVX2 static void store(std::uint16_t* dst, __m256 value)
+    {
+        auto bits = _mm256_castps_si256(value);
+        auto const lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+        bits = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7fff), lsb)), 16);
+        // Pack to 16 bits within each lane, then gather the low halves of both lanes.
+        auto const packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(bits, bits), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+    }
+};
+
+template <>
+struct Avx2Element<nvinfer1::DataType::kFLOAT>
+{
+    TLLM_AVX2 static __m256 load(float const* src)
+    {
+        return _mm256_loadu_ps(src);
+    }
+
+    TLLM_AVX2 static void store(float* dst, __m256 value)
+    {
+        _mm256_storeu_ps(dst, value);
+    }
+};
+
+//! \brief Store the low byte of each of the 8 32-bit values.
+TLLM_AVX2 void storeBytes(std::uint8_t* dst, __m256i values)
+{
+    auto const words = _mm256_packus_epi32(values, values);
+    auto const bytes = _mm256_packus_epi16(words, words);
+    auto const merged = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), merged);
+}
+
+template <nvinfer1::DataType kType>
+struct Avx2Kernels
+{
+    using Scalar = ScalarKernels<kType>;
+    using T = typename Scalar::T;
+    using V = Avx2Element<kType>;
+
+    static std::size_t getVectorEnd(std::size_t size)
+    {
+        return size / 8 * 8;
+    }
+
+    TLLM_AVX2 static float amax(T const* src, std::size_t size)
+    {
+        auto const absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        auto acc = _mm256_setzero_ps();
+        auto const end = getVectorEnd(size);
+        for (std::size_t i = 0; i < end; i += 8)
+        {
+            acc = _mm256_max_ps(acc, _mm256_and_ps(V::load(src + i), absMask));
+        }
+        auto m = _mm_max_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+        return Scalar::amax(src, end, size, _mm_cvtss_f32(m));
+    }
+
+    TLLM_AVX2 static void quantizeInt8(T const* src, std::uint8_t* dst, float invScale, std::size_t size)
+    {
+        auto const inv = _mm256_set1_ps(invScale);
+        auto const hi = _mm256_set1_epi32(127);
+        auto const lo = _mm256_set1_epi32(-127);
+        auto const end = getVectorEnd(size);
+        for (std::size_t i = 0; i < end; i += 8)
+        {
+            auto q = _mm256_cvtps_epi32(_mm256_mul_ps(V::load(src + i), inv));
+            q = _mm256_max_epi32(_mm256_min_epi32(q, hi), lo);
+            storeBytes(dst + i, _mm256_and_si256(q, _mm256_set1_epi32(0xff)));
+        }
+        Scalar::quantizeInt8(src, dst, invScale, end, size);
+    }
+
+    TLLM_AVX2 static void quantizeFp8(T const* src, std::uint8_t* dst, float invScale, std::size_t size)
+    {
+        auto const inv = _mm256_set1_ps(invScale);
+        auto const absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        auto const end = getVectorEnd(size);
+        for (std::size_t i = 0; i < end; i += 8)
+        {
+            auto const value = _mm256_mul_ps(V::load(src + i), inv);
+            auto const sign = _mm256_srli_epi32(
+                _mm256_andnot_si256(_mm256_castps_si256(absMask), _mm256_castps_si256(value)), 24);
+            auto const magnitude = _mm256_min_ps(_mm256_and_ps(value, absMask), _mm256_set1_ps(kFp8Max));
+            auto const subnormal = _mm256_cvtps_epi32(_mm256_mul_ps(magnitude, _mm256_set1_ps(512.f)));
+            auto bits = _mm256_castps_si256(magnitude);
+            auto const lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 20), _mm256_set1_epi32(1));
+            bits = _mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7ffff), lsb));
+            auto const exponent
+                = _mm256_slli_epi32(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(120)), 3);
+            auto const mantissa = _mm256_and_si256(_mm256_srli_epi32(bits, 20), _mm256_set1_epi32(7));
+            auto const normal = _mm256_or_si256(exponent, mantissa);
+            auto const isSubnormal
+                = _mm256_castps_si256(_mm256_cmp_ps(magnitude, _mm256_set1_ps(kFp8MinNormal), _CMP_LT_OQ));
+            auto const q = _mm256_or_si256(_mm256_blendv_epi8(normal, subnormal, isSubnormal), sign);
+            storeBytes(dst + i, _mm256_and_si256(q, _mm256_set1_epi32(0xff)));
+        }
+        Scalar::quantizeFp8(src, dst, invScale, end, size);
+    }
+
+    TLLM_AVX2 static void dequantizeInt8(std::uint8_t const* src, T* dst, float scale, std::size_t size)
+    {
+        auto const s = _mm256_set1_ps(scale);
+        auto const end = getVectorEnd(size);
+        for (std::size_t i = 0; i < end; i += 8)
+        {
+            auto const q = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + i)));
+            V::store(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(q), s));
+        }
+        Scalar::dequantizeInt8(src, dst, scale, end, size);
+    }
+
+    TLLM_AVX2 static void dequantizeFp8(std::uint8_t const* src, T* dst, float scale, std::size_t size)
+    {
+        auto const s = _mm256_set1_ps(scale);
+        // Moving the exponent and mantissa to the top of a float exponent and mantissa yields the value times
+        // 2^-120, subnormals included.
+        auto const rebias = _mm256_set1_ps(0x1p120f);
+        auto const end = getVectorEnd(size);
+        for (std::size_t i = 0; i < end; i += 8)
+        {
+            auto const q = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + i)));
+            auto const sign = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(0x80)), 24);
+            auto const magnitude = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(0x7f)), 20);
+            auto const value = _mm256_mul_ps(_mm256_castsi256_ps(_mm256_or_si256(sign, magnitude)), rebias);
+            V::store(dst + i, _mm256_mul_ps(value, s));
+        }
+        Scalar::dequantizeFp8(src, dst, scale, end, size);
+    }
+};
+
+#else
+
+bool cpuSupportsAvx2()
+{
+    return false;
+}
+
+#endif // TLLM_KV_BLOCK_CODEC_AVX2
+
+template <nvinfer1::DataType kType>
+void encodeBlock(void const* block, std::uint8_t* dst, std::size_t numSlabs, std::size_t slabSize,
+    KvBlockQuantization quantization, bool useSimd)
+{
+    using Scalar = ScalarKernels<kType>;
+    using T = typename Scalar::T;
+    auto const* src = static_cast<T const*>(block);
+    auto* scales = reinterpret_cast<float*>(dst);
+    auto* payload = dst + numSlabs * sizeof(float);
+    auto const maxValue = quantization == KvBlockQuantization::kINT8 ? kInt8Max : kFp8Max;
+
+    for (std::size_t slab = 0; slab < numSlabs; ++slab)
+    {
+        auto const* slabSrc = src + slab * slabSize;
+        auto* slabDst = payload + slab * slabSize;
+        float amax;
+#ifdef TLLM_KV_BLOCK_CODEC_AVX2
+        if (useSimd)
+        {
+            amax = Avx2Kernels<kType>::amax(slabSrc, slabSize);
+        }
+        else
+#endif
+        {
+            amax = Scalar::amax(slabSrc, 0, slabSize);
+        }
+        auto const scale = amax / maxValue;
+        std::memcpy(scales + slab, &scale, sizeof(scale));
+        if (amax == 0.f)
+        {
+            continue;
+        }
+        auto const invScale = maxValue / amax;
+#ifdef TLLM_KV_BLOCK_CODEC_AVX2
+        if (useSimd)
+        {
+            quantization == KvBlockQuantization::kINT8
+                ? Avx2Kernels<kType>::quantizeInt8(slabSrc, slabDst, invScale, slabSize)
+                : Avx2Kernels<kType>::quantizeFp8(slabSrc, slabDst, invScale, slabSize);
+            continue;
+        }
+#endif
+        quantization == KvBlockQuantization::kINT8 ? Scalar::quantizeInt8(slabSrc, slabDst, invScale, 0, slabSize)
+                                                   : Scalar::quantizeFp8(slabSrc, slabDst, invScale, 0, slabSize);
+    }
+}
+
+template <nvinfer1::DataType kType>
+void decodeBlock(std::uint8_t const* src, void* block, std::size_t numSlabs, std::size_t slabSize,
+    KvBlockQuantization quantization, bool useSimd)
+{
+    using Scalar = ScalarKernels<kType>;
+    using T = typename Scalar::T;
+    auto* dst = static_cast<T*>(block);
+    auto const* payload = src + numSlabs * sizeof(float);
+
+    for (std::size_t slab = 0; slab < numSlabs; ++slab)
+    {
+        auto const* slabSrc = payload + slab * slabSize;
+        auto* slabDst = dst + slab * slabSize;
+        float scale;
+        std::memcpy(&scale, src + slab * sizeof(float), sizeof(scale));
+        if (scale == 0.f)
+        {
+            std::memset(slabDst, 0, slabSize * sizeof(T));
+            continue;
+        }
+#ifdef TLLM_KV_BLOCK_CODEC_AVX2
+        if (useSimd)
+        {
+            quantization == KvBlockQuantization::kINT8
+                ? Avx2Kernels<kType>::dequantizeInt8(slabSrc, slabDst, scale, slabSize)
+                : Avx2Kernels<kType>::dequantizeFp8(slabSrc, slabDst, scale, slabSize);
+            continue;
+        }
+#endif
+        quantization == KvBlockQuantization::kINT8 ? Scalar::dequantizeInt8(slabSrc, slabDst, scale, 0, slabSize)
+                                                   : Scalar::dequantizeFp8(slabSrc, slabDst, scale, 0, slabSize);
+    }
+}
+
+} // namespace
+
+KvBlockCodec::KvBlockCodec(nvinfer1::DataType dtype, SizeType32 numLayers, SizeType32 numKvHeads,
+    SizeType32 tokensPerBlock, SizeType32 sizePerHead, KvBlockQuantization quantization, bool useSimd)
+    : mDataType{dtype}
+    , mNumSlabs{static_cast<std::size_t>(numLayers) * 2 * numKvHeads}
+    , mSlabSize{static_cast<std::size_t>(tokensPerBlock) * sizePerHead}
+    , mQuantization{quantization}
+    , mUseSimd{useSimd && cpuSupportsAvx2()}
+{
+    TLLM_CHECK_WITH_INFO(numLayers > 0 && numKvHeads > 0 && tokensPerBlock > 0 && sizePerHead > 0,
+        "KV cache block dimensions must be positive");
+    switch (dtype)
+    {
+    case nvinfer1::DataType::kHALF:
+    case nvinfer1::DataType::kBF16: mElementSize = 2; break;
+    case nvinfer1::DataType::kFLOAT: mElementSize = 4; break;
+    default: TLLM_THROW("Unsupported KV cache data type %d for block compression", static_cast<int>(dtype));
+    }
+}
+
+void KvBlockCodec::encode(void const* block, std::uint8_t* dst) const
+{
+    switch (mDataType)
+    {
+    case nvinfer1::DataType::kHALF:
+        encodeBlock<nvinfer1::DataType::kHALF>(block, dst, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+        break;
+    case nvinfer1::DataType::kBF16:
+        encodeBlock<nvinfer1::DataType::kBF16>(block, dst, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+        break;
+    default: encodeBlock<nvinfer1::DataType::kFLOAT>(block, dst, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+    }
+}
+
+void KvBlockCodec::decode(std::uint8_t const* src, void* block) const
+{
+    switch (mDataType)
+    {
+    case nvinfer1::DataType::kHALF:
+        decodeBlock<nvinfer1::DataType::kHALF>(src, block, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+        break;
+    case nvinfer1::DataType::kBF16:
+        decodeBlock<nvinfer1::DataType::kBF16>(src, block, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+        break;
+    default: decodeBlock<nvinfer1::DataType::kFLOAT>(src, block, mNumSlabs, mSlabSize, mQuantization, mUseSimd);
+    }
+}
+
+QuantizedHostBlockPool::QuantizedHostBlockPool(KvBlockCodec codec, std::size_t capacity)
+    : mCodec{codec}
+    , mNumBlocks{static_cast<SizeType32>(capacity / codec.getEncodedSize())}
+    , mStorage{std::make_unique<std::uint8_t[]>(mNumBlocks * codec.getEncodedSize())}
+{
+    TLLM_LOG_DEBUG("Compressed host KV cache holds %d blocks, %.1fx the uncompressed capacity", mNumBlocks,
+        codec.getCompressionRatio());
+}
+
+std::uint8_t* QuantizedHostBlockPool::getSlot(SizeType32 slot) const
+{
+    TLLM_CHECK_WITH_INFO(0 <= slot && slot < mNumBlocks, "Slot %d out of range [0, %d)", slot, mNumBlocks);
+    return mStorage.get() + static_cast<std::size_t>(slot) * mCodec.getEncodedSize();
+}
+
+void QuantizedHostBlockPool::offload(SizeType32 slot, void const* block)
+{
+    mCodec.encode(block, getSlot(slot));
+}
+
+void QuantizedHostBlockPool::onboard(SizeType32 slot, void* block) const
+{
+    mCodec.decode(getSlot(slot), block);
+}
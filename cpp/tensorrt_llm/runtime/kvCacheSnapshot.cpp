@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvCacheSnapshot.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/diskKvCacheTier.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::uint64_t constexpr kMagic = 0x31504e534b564c54; // "TLVKSNP1"
+std::uint32_t constexpr kVersion = 1;
+std::uint32_t constexpr kBlockTag = 0x4b434f4c; // "LOCK"
+std::uint32_t constexpr kEndTag = 0x21444e45;   // "END!"
+
+struct FileHeader
+{
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::int32_t dataType;
+    std::int32_t numLayers;
+    std::int32_t numKvHeads;
+    std::int32_t sizePerHead;
+    std::int32_t tokensPerBlock;
+    std::uint64_t blockSize;
+    std::uint32_t modelIdLength;
+    std::uint32_t reserved;
+};
+
+//! Followed by the token ids, the token extra ids and the contents of the block.
+struct BlockRecord
+{
+    std::uint32_t tag;
+    std::int32_t parent;
+    std::uint64_t loraTaskId;
+    std::uint32_t numTokens;
+    std::uint32_t reserved;
+};
+
+struct Footer
+{
+    std::uint32_t tag;
+    std::uint32_t reserved;
+    std::uint64_t numBlocks;
+};
+
+template <typename T>
+void writeValue(std::ofstream& stream, T const& value)
+{
+    stream.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+void readValue(std::ifstream& stream, T& value)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void syncPath(std::filesystem::path const& path)
+{
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    TLLM_CHECK_WITH_INFO(fd >= 0, "Cannot open %s: %s", path.c_str(), std::strerror(errno));
+    auto const error = ::fsync(fd) == 0 ? 0 : errno;
+    ::close(fd);
+    TLLM_CHECK_WITH_INFO(error == 0, "Cannot sync %s: %s", path.c_str(), std::strerror(error));
+}
+
+} // namespace
+
+std::size_t KvCacheSnapshotInfo::getBlockSize() const
+{
+    return static_cast<std::size_t>(numLayers) * 2 * numKvHeads * tokensPerBlock * sizePerHead
+        * tensorrt_llm::common::getDTypeSize(dataType);
+}
+
+std::size_t KvCachePrefixTree::ChildKeyHasher::operator()(ChildKey const& key) const noexcept
+{
+    return DiskKvCacheTier::hashBlock(
+        static_cast<std::uint64_t>(key.parent), key.tokens.begin(), key.tokens.end(), key.loraTaskId);
+}
+
+SizeType32 KvCachePrefixTree::addBlock(
+    SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens tokens, SizeType32 blockId)
+{
+    TLLM_CHECK_WITH_INFO(parent >= kRoot && parent < getNumBlocks(), "Invalid parent block %d", parent);
+    auto const node = getNumBlocks();
+    auto const [it, inserted] = mChildren.try_emplace(ChildKey{parent, loraTaskId, tokens}, node);
+    if (!inserted)
+    {
+        return it->second;
+    }
+    mNodes.push_back(Node{parent, loraTaskId, std::move(tokens), blockId});
+    return node;
+}
+
+std::optional<SizeType32> KvCachePrefixTree::findChild(
+    SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens const& tokens) const
+{
+    auto const it = mChildren.find(ChildKey{parent, loraTaskId, tokens});
+    return it == mChildren.end() ? std::nullopt : std::optional{it->second};
+}
+
+std::vector<SizeType32> KvCachePrefixTree::findMatchingBlocks(
+    VecUniqueTokens const& tokens, SizeType32 tokensPerBlock, LoraTaskIdType loraTaskId) const
+{
+    std::vector<SizeType32> nodes;
+    ChildKey key{kRoot, loraTaskId, {}};
+    for (std::size_t begin = 0; begin + tokensPerBlock <= tokens.size(); begin += tokensPerBlock)
+    {
+        key.tokens.assign(tokens.begin() + begin, tokens.begin() + begin + tokensPerBlock);
+        auto const it = mChildren.find(key);
+        if (it == mChildren.end())
+        {
+            break;
+        }
+        nodes.push_back(it->second);
+        key.parent = it->second;
+    }
+    return nodes;
+}
+
+KvCacheSnapshotWriter::KvCacheSnapshotWriter(std::filesystem::path path, KvCacheSnapshotInfo const& info)
+    : mPath{std::move(path)}
+    , mTmpPath{mPath.string() + ".tmp"}
+    , mBlockSize{info.getBlockSize()}
+{
+    TLLM_CHECK_WITH_INFO(mBlockSize > 0, "KV cache snapshot of empty blocks");
+    mStream.open(mTmpPath, std::ios::binary | std::ios::trunc);
+    TLLM_CHECK_WITH_INFO(mStream.is_open(), "Failed to create KV cache snapshot %s", mTmpPath.c_str());
+
+    FileHeader header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.dataType = static_cast<std::int32_t>(info.dataType);
+    header.numLayers = info.numLayers;
+    header.numKvHeads = info.numKvHeads;
+    header.sizePerHead = info.sizePerHead;
+    header.tokensPerBlock = info.tokensPerBlock;
+    header.blockSize = mBlockSize;
+    header.modelIdLength = static_cast<std::uint32_t>(info.modelId.size());
+    writeValue(mStream, header);
+    mStream.write(info.modelId.data(), static_cast<std::streamsize>(info.modelId.size()));
+}
+
+SizeType32 KvCacheSnapshotWriter::addBlock(
+    SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens const& tokens, void const* contents)
+{
+    TLLM_CHECK_WITH_INFO(mStream.is_open(), "KV cache snapshot is closed");
+    TLLM_CHECK_WITH_INFO(parent >= KvCachePrefixTree::kRoot && parent < mNumBlocks,
+        "Parent %d of a snapshot block must be added before it", parent);
+
+    BlockRecord record{};
+    record.tag = kBlockTag;
+    record.parent = parent;
+    record.loraTaskId = loraTaskId;
+    record.numTokens = static_cast<std::uint32_t>(tokens.size());
+    writeValue(mStream, record);
+    for (auto const& token : tokens)
+    {
+        writeValue(mStream, token.tokenId);
+    }
+    for (auto const& token : tokens)
+    {
+        writeValue(mStream, token.tokenExtraId);
+    }
+    mStream.write(static_cast<char const*>(contents), static_cast<std::streamsize>(mBlockSize));
+    TLLM_CHECK_WITH_INFO(mStream.good(), "Failed to write KV cache snapshot %s", mTmpPath.c_str());
+    return mNumBlocks++;
+}
+
+void KvCacheSnapshotWriter::close()
+{
+    TLLM_CHECK_WITH_INFO(mStream.is_open(), "KV cache snapshot is closed");
+    writeValue(mStream, Footer{kEndTag, 0, static_cast<std::uint64_t>(mNumBlocks)});
+    mStream.close();
+    TLLM_CHECK_WITH_INFO(!mStream.fail(), "Failed to write KV cache snapshot %s", mTmpPath.c_str());
+    // Sync before the rename, so that a crash cannot leave a partial snapshot in place of the previous one.
+    syncPath(mTmpPath);
+    std::filesystem::rename(mTmpPath, mPath);
+    auto const directory = mPath.parent_path();
+    syncPath(directory.empty() ? std::filesystem::path{"."} : directory);
+    TLLM_LOG_INFO("Saved %d KV cache blocks to %s", mNumBlocks, mPath.c_str());
+}
+
+KvCacheSnapshotWriter::~KvCacheSnapshotWriter()
+{
+    if (mStream.is_open())
+    {
+        mStream.close();
+        std::error_code ec;
+        std::filesystem::remove(mTmpPath, ec);
+    }
+}
+
+KvCacheSnapshotReader::KvCacheSnapshotReader(std::filesystem::path path, KvCacheSnapshotInfo const& expected)
+    : mPath{std::move(path)}
+    , mBlockSize{expected.getBlockSize()}
+    , mStream{mPath, std::ios::binary}
+{
+    TLLM_CHECK_WITH_INFO(mStream.is_open(), "Failed to open KV cache snapshot %s", mPath.c_str());
+
+    FileHeader header{};
+    readValue(mStream, header);
+    TLLM_CHECK_WITH_INFO(mStream.good() && header.magic == kMagic && header.version == kVersion,
+        "%s is not a KV cache snapshot of version %u", mPath.c_str(), kVersion);
+    std::string modelId(header.modelIdLength, '\0');
+    mStream.read(modelId.data(), static_cast<std::streamsize>(modelId.size()));
+    TLLM_CHECK_WITH_INFO(mStream.good(), "KV cache snapshot %s is truncated", mPath.c_str());
+
+    TLLM_CHECK_WITH_INFO(modelId == expected.modelId, "KV cache snapshot %s was taken from model '%s', not '%s'",
+        mPath.c_str(), modelId.c_str(), expected.modelId.c_str());
+    TLLM_CHECK_WITH_INFO(header.dataType == static_cast<std::int32_t>(expected.dataType)
+            && header.numLayers == expected.numLayers && header.numKvHeads == expected.numKvHeads
+            && header.sizePerHead == expected.sizePerHead && header.tokensPerBlock == expected.tokensPerBlock
+            && header.blockSize == mBlockSize,
+        "KV cache snapshot %s has another layout: data type %d, %d layers, %d KV heads, head size %d, "
+        "%d tokens per block instead of data type %d, %d layers, %d KV heads, head size %d, %d tokens per block",
+        mPath.c_str(), header.dataType, header.numLayers, header.numKvHeads, header.sizePerHead,
+        header.tokensPerBlock, static_cast<std::int32_t>(expected.dataType), expected.numLayers,
+        expected.numKvHeads, expected.sizePerHead, expected.tokensPerBlock);
+}
+
+std::optional<KvCacheSnapshotReader::Block> KvCacheSnapshotReader::readBlock()
+{
+    if (mContentsPending)
+    {
+        skipContents();
+    }
+
+    std::uint32_t tag{0};
+    readValue(mStream, tag);
+    TLLM_CHECK_WITH_INFO(mStream.good(), "KV cache snapshot %s is truncated", mPath.c_str());
+    if (tag == kEndTag)
+    {
+        Footer footer{};
+        mStream.read(reinterpret_cast<char*>(&footer) + sizeof(tag), sizeof(footer) - sizeof(tag));
+        TLLM_CHECK_WITH_INFO(mStream.good() && footer.numBlocks == static_cast<std::uint64_t>(mNumBlocks),
+            "KV cache snapshot %s is corrupted", mPath.c_str());
+        return std::nullopt;
+    }
+    TLLM_CHECK_WITH_INFO(tag == kBlockTag, "KV cache snapshot %s is corrupted", mPath.c_str());
+
+    BlockRecord record{};
+    mStream.read(reinterpret_cast<char*>(&record) + sizeof(tag), sizeof(record) - sizeof(tag));
+    TLLM_CHECK_WITH_INFO(mStream.good() && record.parent >= KvCachePrefixTree::kRoot && record.parent < mNumBlocks,
+        "KV cache snapshot %s is corrupted", mPath.c_str());
+
+    Block block{record.parent, record.loraTaskId, VecUniqueTokens(record.numTokens)};
+    for (auto& token : block.tokens)
+    {
+        readValue(mStream, token.tokenId);
+    }
+    for (auto& token : block.tokens)
+    {
+        readValue(mStream, token.tokenExtraId);
+    }
+    TLLM_CHECK_WITH_INFO(mStream.good(), "KV cache snapshot %s is truncated", mPath.c_str());
+    ++mNumBlocks;
+    mContentsPending = true;
+    return block;
+}
+
+void KvCacheSnapshotReader::readContents(void* contents)
+{
+    TLLM_CHECK_WITH_INFO(mContentsPending, "No block to read the contents of");
+    mStream.read(static_cast<char*>(contents), static_cast<std::streamsize>(mBlockSize));
+    TLLM_CHECK_WITH_INFO(mStream.good(), "KV cache snapshot %s is truncated", mPath.c_str());
+    mContentsPending = false;
+}
+
+void KvCacheSnapshotReader::skipContents()
+{
+    mStream.seekg(static_cast<std::streamoff>(mBlockSize), std::ios::cur);
+    TLLM_CHECK_WITH_INFO(mStream.good(), "KV cache snapshot %s is truncated", mPath.c_str());
+    mContentsPending = false;
+}
+
+namespace tensorrt_llm::runtime
+{
+
+void saveKvCacheSnapshot(std::filesystem::path const& path, KvCacheSnapshotInfo const& info,
+    KvCachePrefixTree const& tree, std::function<void const*(SizeType32 blockId)> const& getContents)
+{
+    KvCacheSnapshotWriter writer(path, info);
+    // Nodes are numbered parents first, so they are their own index in the snapshot.
+    for (SizeType32 node = 0; node < tree.getNumBlocks(); ++node)
+    {
+        auto const& block = tree.getNode(node);
+        writer.addBlock(block.parent, block.loraTaskId, block.tokens, getContents(block.blockId));
+    }
+    writer.close();
+}
+
+KvCachePrefixTree loadKvCacheSnapshot(std::filesystem::path const& path, KvCacheSnapshotInfo const& info,
+    std::function<std::optional<SizeType32>()> const& allocateBlock,
+    std::function<void*(SizeType32 blockId)> const& getBuffer)
+{
+    KvCacheSnapshotReader reader(path, info);
+    KvCachePrefixTree tree;
+    // Node of each snapshot block in the tree.
+    std::vector<SizeType32> nodes;
+    while (auto block = reader.readBlock())
+    {
+        auto const parent = block->parent == KvCachePrefixTree::kRoot ? KvCachePrefixTree::kRoot : nodes[block->parent];
+        // A duplicate block keeps the contents of the first one, the next readBlock skips its contents.
+        if (auto const node = tree.findChild(parent, block->loraTaskId, block->tokens))
+        {
+            nodes.push_back(*node);
+            continue;
+        }
+        auto const blockId = allocateBlock();
+        if (!blockId)
+        {
+            TLLM_LOG_WARNING("No free block left, loaded %d of the KV cache blocks of %s", tree.getNumBlocks(),
+                path.c_str());
+            break;
+        }
+        reader.readContents(getBuffer(*blockId));
+        nodes.push_back(tree.addBlock(parent, block->loraTaskId, std::move(block->tokens), *blockId));
+    }
+    TLLM_LOG_INFO("Loaded %d KV cache blocks from %s", tree.getNumBlocks(), path.c_str());
+    return tree;
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvTransferEngine.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/serialization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+std::uint32_t constexpr kProtocolMagic = 0x4B565431; // "KVT1"
+
+enum class MessageType : std::uint32_t
+{
+    kRequest = 1,
+    kAccept = 2,
+    kBlock = 3,
+    kDone = 4,
+    kAck = 5,
+    kError = 6,
+};
+
+struct MessageHeader
+{
+    MessageType type;
+    //! Block index for kBlock messages.
+    std::uint32_t index;
+    texec::IdType requestId;
+    std::uint64_t payloadSize;
+};
+
+//! Sent by the receiver in kRequest and answered by the sender with its own layout in kAccept.
+struct RequestPayload
+{
+    std::uint32_t magic;
+    std::uint32_t numBlocks;
+    KvCacheLayout layout;
+};
+
+static_assert(std::is_trivially_copyable_v<MessageHeader>);
+static_assert(std::is_trivially_copyable_v<RequestPayload>);
+
+struct HeadRange
+{
+    SizeType32 begin;
+    SizeType32 end;
+
+    [[nodiscard]] SizeType32 size() const
+    {
+        return end - begin;
+    }
+};
+
+HeadRange getHeadRange(KvCacheLayout const& layout)
+{
+    return {layout.getFirstHead(), layout.getFirstHead() + layout.getNumLocalHeads()};
+}
+
+HeadRange getOverlap(KvCacheLayout const& a, KvCacheLayout const& b)
+{
+    auto const rangeA = getHeadRange(a);
+    auto const rangeB = getHeadRange(b);
+    auto const begin = std::max(rangeA.begin, rangeB.begin);
+    return {begin, std::max(begin, std::min(rangeA.end, rangeB.end))};
+}
+
+//! \brief Offset in a block of `layout` of the first head of `heads`, for one layer and K or V.
+std::size_t getSlabOffset(KvCacheLayout const& layout, SizeType32 layer, SizeType32 kv, HeadRange const& heads)
+{
+    auto const slab = static_cast<std::size_t>(layer) * 2 + kv;
+    return (slab * layout.getNumLocalHeads() + (heads.begin - layout.getFirstHead())) * layout.getHeadBytes();
+}
+
+void sendMessage(KvTransport& transport, MessageType type, texec::IdType requestId, std::uint64_t payloadSize,
+    std::uint32_t index = 0)
+{
+    MessageHeader const header{type, index, requestId, payloadSize};
+    transport.send(&header, sizeof(header));
+}
+
+void sendError(KvTransport& transport, texec::IdType requestId, std::string const& message)
+{
+    sendMessage(transport, MessageType::kError, requestId, message.size());
+    transport.send(message.data(), message.size());
+}
+
+MessageHeader recvMessage(KvTransport& transport, texec::IdType requestId)
+{
+    MessageHeader header{};
+    transport.recv(&header, sizeof(header));
+    if (header.type == MessageType::kError)
+    {
+        std::string message(header.payloadSize, '\0');
+        transport.recv(message.data(), message.size());
+        TLLM_THROW("KV transfer of request %lu failed on the peer: %s", requestId, message.c_str());
+    }
+    TLLM_CHECK_WITH_INFO(header.requestId == requestId, "KV transfer expected request %lu, got a message for %lu",
+        requestId, header.requestId);
+    return header;
+}
+
+void expectType(MessageHeader const& header, MessageType type)
+{
+    TLLM_CHECK_WITH_INFO(header.type == type, "KV transfer protocol error: expected message %u, got %u",
+        static_cast<unsigned>(type), static_cast<unsigned>(header.type));
+}
+
+} // namespace
+
+void KvCacheLayout::validate() const
+{
+    TLLM_CHECK_WITH_INFO(numLayers > 0 && numKvHeads > 0 && sizePerHead > 0 && tokensPerBlock > 0 && elementSize > 0,
+        "KV cache layout dimensions must be positive");
+    TLLM_CHECK_WITH_INFO(tpSize > 0 && tpRank >= 0 && tpRank < tpSize, "Invalid TP rank %d of %d", tpRank, tpSize);
+    TLLM_CHECK_WITH_INFO(numKvHeads % tpSize == 0, "%d KV heads cannot be split across %d ranks", numKvHeads, tpSize);
+}
+
+std::vector<SizeType32> tensorrt_llm::runtime::getOverlappingRanks(KvCacheLayout const& layout, SizeType32 peerTpSize)
+{
+    TLLM_CHECK_WITH_INFO(peerTpSize > 0 && layout.numKvHeads % peerTpSize == 0,
+        "%d KV heads cannot be split across %d ranks", layout.numKvHeads, peerTpSize);
+    std::vector<SizeType32> ranks;
+    auto peer = layout;
+    peer.tpSize = peerTpSize;
+    for (peer.tpRank = 0; peer.tpRank < peerTpSize; ++peer.tpRank)
+    {
+        if (getOverlap(layout, peer).size() > 0)
+        {
+            ranks.push_back(peer.tpRank);
+        }
+    }
+    return ranks;
+}
+
+KvTransferEngine::KvTransferEngine(KvCacheLayout layout)
+    : mLayout{layout}
+{
+    mLayout.validate();
+}
+
+KvTransferStats KvTransferEngine::sendBlocks(KvTransport& transport, texec::IdType requestId,
+    std::vector<void const*> const& blocks, SizeType32 numTokens,
+    std::optional<texec::ContextPhaseParams> const& contextPhaseParams) const
+{
+    auto const header = recvMessage(transport, requestId);
+    expectType(header, MessageType::kRequest);
+    TLLM_CHECK_WITH_INFO(header.payloadSize == sizeof(RequestPayload), "KV transfer protocol error: bad request size");
+    RequestPayload request{};
+    transport.recv(&request, sizeof(request));
+    auto const start = std::chrono::steady_clock::now();
+
+    auto const& remote = request.layout;
+    std::string error;
+    if (request.magic != kProtocolMagic)
+    {
+        error = "unknown protocol";
+    }
+    else if (!mLayout.isCompatible(remote))
+    {
+        error = "incompatible KV cache layouts";
+    }
+    else if (request.numBlocks != blocks.size())
+    {
+        error = "receiver expects " + std::to_string(request.numBlocks) + " blocks, sender has "
+            + std::to_string(blocks.size());
+    }
+    else if (getOverlap(mLayout, remote).size() == 0)
+    {
+        error = "ranks hold disjoint heads";
+    }
+    if (!error.empty())
+    {
+        sendError(transport, requestId, error);
+        TLLM_THROW("KV transfer of request %lu failed: %s", requestId, error.c_str());
+    }
+
+    RequestPayload const accept{kProtocolMagic, static_cast<std::uint32_t>(blocks.size()), mLayout};
+    sendMessage(transport, MessageType::kAccept, requestId, sizeof(accept));
+    transport.send(&accept, sizeof(accept));
+
+    auto const heads = getOverlap(mLayout, remote);
+    auto const slabBytes = static_cast<std::size_t>(heads.size()) * mLayout.getHeadBytes();
+    auto const payloadBytes = slabBytes * mLayout.numLayers * 2;
+    // All local heads are requested, the block is sent as is.
+    auto const inPlace = heads.size() == mLayout.getNumLocalHeads();
+    std::vector<char> staging(inPlace ? 0 : payloadBytes);
+
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        auto const* block = static_cast<char const*>(blocks[i]);
+        sendMessage(transport, MessageType::kBlock, requestId, payloadBytes, static_cast<std::uint32_t>(i));
+        if (inPlace)
+        {
+            transport.send(block, payloadBytes);
+            continue;
+        }
+        for (SizeType32 layer = 0; layer < mLayout.numLayers; ++layer)
+        {
+            for (SizeType32 kv = 0; kv < 2; ++kv)
+            {
+                std::memcpy(staging.data() + (static_cast<std::size_t>(layer) * 2 + kv) * slabBytes,
+                    block + getSlabOffset(mLayout, layer, kv, heads), slabBytes);
+            }
+        }
+        transport.send(staging.data(), payloadBytes);
+    }
+
+    std::ostringstream done;
+    done.write(reinterpret_cast<char const*>(&numTokens), sizeof(numTokens));
+    bool const hasContextPhaseParams = contextPhaseParams.has_value();
+    done.write(reinterpret_cast<char const*>(&hasContextPhaseParams), sizeof(hasContextPhaseParams));
+    if (hasContextPhaseParams)
+    {
+        texec::Serialization::serialize(*contextPhaseParams, done);
+    }
+    auto const donePayload = std::move(done).str();
+    sendMessage(transport, MessageType::kDone, requestId, donePayload.size());
+    transport.send(donePayload.data(), donePayload.size());
+
+    expectType(recvMessage(transport, requestId), MessageType::kAck);
+    KvTransferStats stats;
+    stats.numBytes = payloadBytes * blocks.size();
+    stats.duration = std::chrono::steady_clock::now() - start;
+    TLLM_LOG_DEBUG("Sent %zu KV cache bytes of request %lu at %.2f GB/s", stats.numBytes, requestId, stats.getGBps());
+    return stats;
+}
+
+KvTransferResult KvTransferEngine::receiveBlocks(
+    KvTransport& transport, texec::IdType requestId, std::vector<void*> const& blocks) const
+{
+    auto const start = std::chrono::steady_clock::now();
+    RequestPayload const request{kProtocolMagic, static_cast<std::uint32_t>(blocks.size()), mLayout};
+    sendMessage(transport, MessageType::kRequest, requestId, sizeof(request));
+    transport.send(&request, sizeof(request));
+
+    auto const acceptHeader = recvMessage(transport, requestId);
+    expectType(acceptHeader, MessageType::kAccept);
+    TLLM_CHECK_WITH_INFO(
+        acceptHeader.payloadSize == sizeof(RequestPayload), "KV transfer protocol error: bad accept size");
+    RequestPayload accept{};
+    transport.recv(&accept, sizeof(accept));
+    auto const& remote = accept.layout;
+    TLLM_CHECK_WITH_INFO(accept.magic == kProtocolMagic && mLayout.isCompatible(remote),
+        "KV transfer protocol error: peer accepted an incompatible layout");
+
+    auto const heads = getOverlap(mLayout, remote);
+    auto const slabBytes = static_cast<std::size_t>(heads.size()) * mLayout.getHeadBytes();
+    auto const payloadBytes = slabBytes * mLayout.numLayers * 2;
+    // The sender provides all local heads, the block is received in place.
+    auto const inPlace = heads.size() == mLayout.getNumLocalHeads();
+    std::vector<char> staging(inPlace ? 0 : payloadBytes);
+
+    KvTransferResult result;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        auto const header = recvMessage(transport, requestId);
+        expectType(header, MessageType::kBlock);
+        TLLM_CHECK_WITH_INFO(header.index == i && header.payloadSize == payloadBytes,
+            "KV transfer protocol error: unexpected block %u of %lu bytes", header.index, header.payloadSize);
+        auto* block = static_cast<char*>(blocks[i]);
+        if (inPlace)
+        {
+            transport.recv(block, payloadBytes);
+            continue;
+        }
+        transport.recv(staging.data(), payloadBytes);
+        for (SizeType32 layer = 0; layer < mLayout.numLayers; ++layer)
+        {
+            for (SizeType32 kv = 0; kv < 2; ++kv)
+            {
+                std::memcpy(block + getSlabOffset(mLayout, layer, kv, heads),
+                    staging.data() + (static_cast<std::size_t>(layer) * 2 + kv) * slabBytes, slabBytes);
+            }
+        }
+    }
+
+    auto const doneHeader = recvMessage(transport, requestId);
+    expectType(doneHeader, MessageType::kDone);
+    std::string payload(doneHeader.payloadSize, '\0');
+    transport.recv(payload.data(), payload.size());
+    std::istringstream is(std::move(payload));
+    bool hasContextPhaseParams = false;
+    is.read(reinterpret_cast<char*>(&result.numTokens), sizeof(result.numTokens));
+    is.read(reinterpret_cast<char*>(&hasContextPhaseParams), sizeof(hasContextPhaseParams));
+    TLLM_CHECK_WITH_INFO(is.good(), "KV transfer protocol error: truncated completion message");
+    if (hasContextPhaseParams)
+    {
+        result.contextPhaseParams = texec::Serialization::deserializeContextPhaseParams(is);
+    }
+    sendMessage(transport, MessageType::kAck, requestId, 0);
+
+    result.stats.numBytes = payloadBytes * blocks.size();
+    result.stats.duration = std::chrono::steady_clock::now() - start;
+    TLLM_LOG_DEBUG("Received %zu KV cache bytes of request %lu at %.2f GB/s", result.stats.numBytes, requestId,
+        result.stats.getGBps());
+    return result;
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvTransferTransport.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::size_t constexpr kCacheLineSize = 64;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory rings need lock-free atomics");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Shared memory rings need lock-free atomics");
+
+struct alignas(kCacheLineSize) SegmentHeader
+{
+    std::atomic<std::uint32_t> ready;
+    std::uint64_t capacity;
+};
+
+std::size_t roundUp(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+//! \brief Spin, then yield, then sleep until ready() holds. Throws if it did not within timeout.
+template <typename Predicate>
+void waitUntil(Predicate&& ready, std::chrono::milliseconds timeout, char const* what)
+{
+    if (ready())
+    {
+        return;
+    }
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    for (std::uint32_t iter = 1;; ++iter)
+    {
+        if (ready())
+        {
+            return;
+        }
+        if (iter < 64)
+        {
+            continue;
+        }
+        if (iter < 1024)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        if (iter % 256 == 0 && std::chrono::steady_clock::now() > deadline)
+        {
+            TLLM_THROW("Timed out after %ld ms waiting for %s", static_cast<long>(timeout.count()), what);
+        }
+    }
+}
+
+std::string errnoString()
+{
+    return std::strerror(errno);
+}
+
+} // namespace
+
+struct SharedMemoryTransport::Ring
+{
+    //! Bytes written so far, only advanced by the producer.
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> head;
+    //! Bytes read so far, only advanced by the consumer.
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> tail;
+    alignas(kCacheLineSize) std::uint64_t capacity;
+
+    char* data()
+    {
+        return reinterpret_cast<char*>(this + 1);
+    }
+
+    static std::size_t getSize(std::size_t capacity)
+    {
+        return sizeof(Ring) + capacity;
+    }
+};
+
+std::unique_ptr<SharedMemoryTransport> SharedMemoryTransport::create(
+    std::string const& name, std::size_t capacity, std::chrono::milliseconds timeout)
+{
+    TLLM_CHECK_WITH_INFO(capacity > 0, "Shared memory ring capacity must be positive");
+    capacity = roundUp(capacity, kCacheLineSize);
+    auto const segmentSize = sizeof(SegmentHeader) + 2 * Ring::getSize(capacity);
+
+    auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        // Left over by a process that did not clean up.
+        TLLM_LOG_WARNING("Replacing stale shared memory segment %s", name.c_str());
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    TLLM_CHECK_WITH_INFO(fd >= 0, "shm_open(%s) failed: %s", name.c_str(), errnoString().c_str());
+    if (ftruncate(fd, static_cast<off_t>(segmentSize)) != 0)
+    {
+        auto const error = errnoString();
+        close(fd);
+        shm_unlink(name.c_str());
+        TLLM_THROW("ftruncate of shared memory segment %s failed: %s", name.c_str(), error.c_str());
+    }
+    auto* segment = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        TLLM_THROW("mmap of shared memory segment %s failed: %s", name.c_str(), errnoString().c_str());
+    }
+
+    auto* header = new (segment) SegmentHeader{};
+    header->capacity = capacity;
+    auto* rings = static_cast<char*>(segment) + sizeof(SegmentHeader);
+    for (int i = 0; i < 2; ++i)
+    {
+        auto* ring = new (rings + i * Ring::getSize(capacity)) Ring{};
+        ring->capacity = capacity;
+    }
+    header->ready.store(1, std::memory_order_release);
+
+    return std::unique_ptr<SharedMemoryTransport>(
+        new SharedMemoryTransport(name, true, segment, segmentSize, timeout));
+}
+
+std::unique_ptr<SharedMemoryTransport> SharedMemoryTransport::open(
+    std::string const& name, std::chrono::milliseconds timeout)
+{
+    int fd = -1;
+    struct stat st
+    {
+    };
+
+    // The creator may not have created or sized the segment yet.
+    try
+    {
+        waitUntil(
+            [&]()
+            {
+                if (fd < 0)
+                {
+                    fd = shm_open(name.c_str(), O_RDWR, 0600);
+                }
+                return fd >= 0 && fstat(fd, &st) == 0
+                    && static_cast<std::size_t>(st.st_size) > sizeof(SegmentHeader);
+            },
+            timeout, "the shared memory segment to be created");
+    }
+    catch (...)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw;
+    }
+
+    auto const segmentSize = static_cast<std::size_t>(st.st_size);
+    auto* segment = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    TLLM_CHECK_WITH_INFO(
+        segment != MAP_FAILED, "mmap of shared memory segment %s failed: %s", name.c_str(), errnoString().c_str());
+
+    auto* header = static_cast<SegmentHeader*>(segment);
+    waitUntil([header]() { return header->ready.load(std::memory_order_acquire) == 1; }, timeout,
+        "the shared memory segment to be initialized");
+    return std::unique_ptr<SharedMemoryTransport>(
+        new SharedMemoryTransport(name, false, segment, segmentSize, timeout));
+}
+
+SharedMemoryTransport::SharedMemoryTransport(
+    std::string name, bool isOwner, void* segment, std::size_t segmentSize, std::chrono::milliseconds timeout)
+    : mName{std::move(name)}
+    , mIsOwner{isOwner}
+    , mSegment{segment}
+    , mSegmentSize{segmentSize}
+    , mTimeout{timeout}
+{
+    auto const capacity = static_cast<SegmentHeader*>(segment)->capacity;
+    TLLM_CHECK_WITH_INFO(sizeof(SegmentHeader) + 2 * Ring::getSize(capacity) <= segmentSize,
+        "Shared memory segment %s is smaller than its rings", mName.c_str());
+    auto* rings = static_cast<char*>(segment) + sizeof(SegmentHeader);
+    auto* first = reinterpret_cast<Ring*>(rings);
+    auto* second = reinterpret_cast<Ring*>(rings + Ring::getSize(capacity));
+    mSendRing = isOwner ? first : second;
+    mRecvRing = isOwner ? second : first;
+}
+
+SharedMemoryTransport::~SharedMemoryTransport()
+{
+    munmap(mSegment, mSegmentSize);
+    if (mIsOwner)
+    {
+        shm_unlink(mName.c_str());
+    }
+}
+
+void SharedMemoryTransport::send(void const* data, std::size_t size)
+{
+    auto& ring = *mSendRing;
+    auto const capacity = ring.capacity;
+    auto const* src = static_cast<char const*>(data);
+    while (size > 0)
+    {
+        auto const head = ring.head.load(std::memory_order_relaxed);
+        std::uint64_t tail = 0;
+        waitUntil(
+            [&]()
+            {
+                tail = ring.tail.load(std::memory_order_acquire);
+                return head - tail < capacity;
+            },
+            mTimeout, "the peer to read from the shared memory ring");
+        auto const offset = head % capacity;
+        auto const count = std::min<std::uint64_t>({size, capacity - (head - tail), capacity - offset});
+        std::memcpy(ring.data() + offset, src, count);
+        ring.head.store(head + count, std::memory_order_release);
+        src += count;
+        size -= count;
+    }
+}
+
+void SharedMemoryTransport::recv(void* data, std::size_t size)
+{
+    auto& ring = *mRecvRing;
+    auto const capacity = ring.capacity;
+    auto* dst = static_cast<char*>(data);
+    while (size > 0)
+    {
+        auto const tail = ring.tail.load(std::memory_order_relaxed);
+        std::uint64_t head = 0;
+        waitUntil(
+            [&]()
+            {
+                head = ring.head.load(std::memory_order_acquire);
+                return head != tail;
+            },
+            mTimeout, "the peer to write to the shared memory ring");
+        auto const offset = tail % capacity;
+        auto const count = std::min<std::uint64_t>({size, head - tail, capacity - offset});
+        std::memcpy(dst, ring.data() + offset, count);
+        ring.tail.store(tail + count, std::memory_order_release);
+        dst += count;
+        size -= count;
+    }
+}
+
+std::unique_ptr<TcpTransport> TcpTransport::connect(
+    std::string const& host, std::uint16_t port, std::chrono::milliseconds timeout)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    auto const service = std::to_string(port);
+    auto const status = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+    TLLM_CHECK_WITH_INFO(status == 0, "Cannot resolve %s: %s", host.c_str(), gai_strerror(status));
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressesGuard(addresses, &freeaddrinfo);
+
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    while (true)
+    {
+        for (auto* address = addresses; address != nullptr; address = address->ai_next)
+        {
+            auto const fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0)
+            {
+                continue;
+            }
+            if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+            {
+                return std::make_unique<TcpTransport>(fd);
+            }
+            close(fd);
+        }
+        TLLM_CHECK_WITH_INFO(std::chrono::steady_clock::now() < deadline, "Cannot connect to %s:%u: %s", host.c_str(),
+            static_cast<unsigned>(port), errnoString().c_str());
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+TcpTransport::TcpTransport(int fd)
+    : mFd{fd}
+{
+    int const enable = 1;
+    setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+TcpTransport::~TcpTransport()
+{
+    close(mFd);
+}
+
+void TcpTransport::send(void const* data, std::size_t size)
+{
+    auto const* src = static_cast<char const*>(data);
+    while (size > 0)
+    {
+        auto const count = ::send(mFd, src, size, MSG_NOSIGNAL);
+        if (count < 0)
+        {
+            TLLM_CHECK_WITH_INFO(errno == EINTR, "TCP send failed: %s", errnoString().c_str());
+            continue;
+        }
+        src += count;
+        size -= static_cast<std::size_t>(count);
+    }
+}
+
+void TcpTransport::recv(void* data, std::size_t size)
+{
+    auto* dst = static_cast<char*>(data);
+    while (size > 0)
+    {
+        auto const count = ::recv(mFd, dst, size, 0);
+        if (count < 0)
+        {
+            TLLM_CHECK_WITH_INFO(errno == EINTR, "TCP recv failed: %s", errnoString().c_str());
+            continue;
+        }
+        TLLM_CHECK_WITH_INFO(count > 0, "TCP connection closed by peer with %zu bytes pending", size);
+        dst += count;
+        size -= static_cast<std::size_t>(count);
+    }
+}
+
+TcpListener::TcpListener(std::uint16_t port, std::string const& host)
+{
+    mFd = socket(AF_INET, SOCK_STREAM, 0);
+    TLLM_CHECK_WITH_INFO(mFd >= 0, "Cannot create socket: %s", errnoString().c_str());
+    int const enable = 1;
+    setsockopt(mFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1
+        || bind(mFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(mFd, SOMAXCONN) != 0)
+    {
+        auto const error = errnoString();
+        close(mFd);
+        TLLM_THROW("Cannot listen on %s:%u: %s", host.c_str(), static_cast<unsigned>(port), error.c_str());
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(mFd, reinterpret_cast<sockaddr*>(&address), &length);
+    mPort = ntohs(address.sin_port);
+}
+
+TcpListener::~TcpListener()
+{
+    close(mFd);
+}
+
+std::unique_ptr<TcpTransport> TcpListener::accept()
+{
+    while (true)
+    {
+        auto const fd = ::accept(mFd, nullptr, nullptr);
+        if (fd >= 0)
+        {
+            return std::make_unique<TcpTransport>(fd);
+        }
+        TLLM_CHECK_WITH_INFO(errno == EINTR, "accept failed: %s", errnoString().c_str());
+    }
+}
@@ -21,6 +21,7 @@
 #include "iBuffer.h"
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/runtime/loraUtils.h"
@@ -61,13 +62,28 @@ void LoraCachePageManager::initialize(BufferManager const& bufferManager)
 
     TLLM_LOG_DEBUG("pageConfig: " + to_string(mConfig));
 
+    // Host page blocks can be backed by huge pages, to pin them faster and copy them with fewer TLB misses.
+    auto const useHugePages = common::getEnvLoraHostCacheHugePages();
     std::size_t pageIdx = 0;
     while (pageIdx < static_cast<size_t>(mConfig.getTotalNumPages()))
     {
         auto const numLocalPages = std::min<SizeType32>(
             mConfig.getTotalNumPages() - static_cast<SizeType32>(pageIdx), mConfig.getMaxPagesPerBlock());
         auto const blockShape = ITensor::makeShape({numLocalPages, mConfig.getSlotsPerPage(), mConfig.getPageWidth()});
-        TensorPtr block = bufferManager.allocate(mConfig.getMemoryType(), blockShape, mConfig.getDataType());
+        auto const memoryType = mConfig.getMemoryType();
+        TensorPtr block;
+        if (useHugePages && memoryType == MemoryType::kCPU)
+        {
+            block = BufferManager::cpuHugePages(blockShape, mConfig.getDataType());
+        }
+        else if (useHugePages && memoryType == MemoryType::kPINNED)
+        {
+            block = BufferManager::pinnedHugePages(blockShape, mConfig.getDataType());
+        }
+        else
+        {
+            block = bufferManager.allocate(memoryType, blockShape, mConfig.getDataType());
+        }
         bufferManager.setZero(*block);
         mPageBlocks.push_back(block);
         for (SizeType32 i = 0; i < numLocalPages; ++i)
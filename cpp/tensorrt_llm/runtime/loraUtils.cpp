@@ -18,13 +18,24 @@
 #include "tensorrt_llm/runtime/worldConfig.h"
 #include <string>
 
+// Requests failing validation are expected under load, so they are thrown without a stack trace.
+#define TLLM_CHECK_LORA_REQUEST(val, info)                                                                             \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (TLLM_UNLIKELY(!static_cast<bool>(val)))                                                                    \
+        {                                                                                                              \
+            throw NEW_TLLM_EXPECTED_EXCEPTION(tensorrt_llm::common::TllmErrorCode::kINVALID_ARGUMENT,                  \
+                "Invalid LoRA request: %s", std::string{info}.c_str());                                                \
+        }                                                                                                              \
+    } while (0)
+
 namespace tensorrt_llm::runtime::lora
 {
 
 void loraValidateRequestTensorDims(std::optional<ITensor::SharedPtr> const& optReqLoraWeights,
     std::optional<ITensor::SharedPtr> const& optReqLoraConfig)
 {
-    TLLM_CHECK_WITH_INFO(optReqLoraWeights.has_value() && optReqLoraConfig.has_value(),
+    TLLM_CHECK_LORA_REQUEST(optReqLoraWeights.has_value() && optReqLoraConfig.has_value(),
         "Request for LoRA inference must have both lora_weights and lora_keys");
 
     SizeType32 constexpr expectedBatchSize = 1;
@@ -33,20 +44,20 @@ void loraValidateRequestTensorDims(std::optional<ITensor::SharedPtr> const& optR
 
     auto weights = optReqLoraWeights.value();
     auto keys = optReqLoraConfig.value();
-    TLLM_CHECK_WITH_INFO(weights->getShape().nbDims == expectedWeightsDims, "Invalid shape for lora_weights tensor");
-    TLLM_CHECK_WITH_INFO(keys->getShape().nbDims == expectedKeysDims, "Invalid shape for lora_keys tensor");
-    TLLM_CHECK_WITH_INFO(
+    TLLM_CHECK_LORA_REQUEST(weights->getShape().nbDims == expectedWeightsDims, "Invalid shape for lora_weights tensor");
+    TLLM_CHECK_LORA_REQUEST(keys->getShape().nbDims == expectedKeysDims, "Invalid shape for lora_keys tensor");
+    TLLM_CHECK_LORA_REQUEST(
         weights->getShape().d[0] == expectedBatchSize, "Expected batch dimension to be 1 for each lora request");
-    TLLM_CHECK_WITH_INFO(
+    TLLM_CHECK_LORA_REQUEST(
         keys->getShape().d[0] == expectedBatchSize, "Expected batch dimension to be 1 for each lora request");
-    TLLM_CHECK_WITH_INFO(weights->getMemoryType() != MemoryType::kGPU, "Expected lora weights to be in CPU memory");
-    TLLM_CHECK_WITH_INFO(keys->getMemoryType() != MemoryType::kGPU, "Expected lora weights to be in CPU memory");
-    TLLM_CHECK_WITH_INFO(keys->getDataType() == nvinfer1::DataType::kINT32,
+    TLLM_CHECK_LORA_REQUEST(weights->getMemoryType() != MemoryType::kGPU, "Expected lora weights to be in CPU memory");
+    TLLM_CHECK_LORA_REQUEST(keys->getMemoryType() != MemoryType::kGPU, "Expected lora weights to be in CPU memory");
+    TLLM_CHECK_LORA_REQUEST(keys->getDataType() == nvinfer1::DataType::kINT32,
         "Expected  lora keys to have TYPE_INT32 but was " + std::string(keys->getDataTypeName()));
 
-    TLLM_CHECK_WITH_INFO(keys->getShape().d[1] == weights->getShape().d[1],
+    TLLM_CHECK_LORA_REQUEST(keys->getShape().d[1] == weights->getShape().d[1],
         "Expected dim1 lora_weights and lora_keys to have the same size");
-    TLLM_CHECK_WITH_INFO(keys->getShape().d[2] == kLORA_CONFIG_ROW_SIZE,
+    TLLM_CHECK_LORA_REQUEST(keys->getShape().d[2] == kLORA_CONFIG_ROW_SIZE,
         "Expected dim2 of lora_keys to have a size of " + std::to_string(kLORA_CONFIG_ROW_SIZE));
 }
 
@@ -55,7 +66,7 @@ void loraValidateRequestTensors(std::optional<std::uint64_t> const& optTaskId,
     std::optional<ITensor::SharedPtr> const& optReqLoraConfig, runtime::ModelConfig const& modelConfig,
     runtime::WorldConfig const& worldConfig)
 {
-    TLLM_CHECK_WITH_INFO(optTaskId.has_value(), "lora_task_id must be set for LoRA inference");
+    TLLM_CHECK_LORA_REQUEST(optTaskId.has_value(), "lora_task_id must be set for LoRA inference");
     if (optReqLoraWeights.has_value() || optReqLoraConfig.has_value())
     {
         loraValidateRequestTensorDims(optReqLoraWeights, optReqLoraConfig);
@@ -63,7 +74,7 @@ void loraValidateRequestTensors(std::optional<std::uint64_t> const& optTaskId,
         auto weights = optReqLoraWeights.value();
         auto config = optReqLoraConfig.value();
         SizeType32 nbModelLayers = modelConfig.getNbAttentionLayers();
-        TLLM_CHECK_WITH_INFO(weights->getDataType() == modelConfig.getDataType(),
+        TLLM_CHECK_LORA_REQUEST(weights->getDataType() == modelConfig.getDataType(),
             "Expected lora weights to be the same data type as base model");
 
         auto loraModules = modelConfig.getLoraModules();
@@ -74,14 +85,15 @@ void loraValidateRequestTensors(std::optional<std::uint64_t> const& optTaskId,
             auto layerId = configPtr[row * kLORA_CONFIG_ROW_SIZE + kLORA_CONFIG_LAYER_OFF];
             auto adapterSize = configPtr[row * kLORA_CONFIG_ROW_SIZE + kLORA_CONFIG_ADAPTER_SIZE_OFF];
 
-            TLLM_CHECK_WITH_INFO(
+            TLLM_CHECK_LORA_REQUEST(
                 layerId >= 0 && layerId < nbModelLayers, "Expected layerId to be in the range [0, numModelLayers)");
-            TLLM_CHECK_WITH_INFO(adapterSize > 0, "Expected adapterSize to be > 0");
+            TLLM_CHECK_LORA_REQUEST(adapterSize > 0, "Expected adapterSize to be > 0");
             auto it = std::find_if(
                 loraModules.begin(), loraModules.end(), [modId](LoraModule const& m) { return m.value() == modId; });
             std::string moduleName(LoraModule::toModuleName(modId));
-            TLLM_CHECK_WITH_INFO(it != loraModules.end(), "lora module " + moduleName + " not enabled for this model");
-            TLLM_CHECK_WITH_INFO(it->flattenedInOutSize(adapterSize) <= weights->getShape().d[2],
+            TLLM_CHECK_LORA_REQUEST(
+                it != loraModules.end(), "lora module " + moduleName + " not enabled for this model");
+            TLLM_CHECK_LORA_REQUEST(it->flattenedInOutSize(adapterSize) <= weights->getShape().d[2],
                 "lora_weights has to few values for " + moduleName);
         }
     }
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/numaTopology.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+// From linux/mempolicy.h, which is not installed everywhere.
+int constexpr kMpolDefault = 0;
+int constexpr kMpolPreferred = 1;
+std::size_t constexpr kMaxNodes = 1024;
+auto constexpr kBitsPerMask = 8 * sizeof(unsigned long);
+
+using NodeMask = std::array<unsigned long, kMaxNodes / kBitsPerMask>;
+
+std::optional<std::string> readLine(std::filesystem::path const& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line))
+    {
+        return std::nullopt;
+    }
+    return line;
+}
+
+NodeMask makeNodeMask(SizeType32 node)
+{
+    NodeMask mask{};
+    mask[node / kBitsPerMask] |= 1UL << (node % kBitsPerMask);
+    return mask;
+}
+
+} // namespace
+
+NumaTopology::NumaTopology(std::filesystem::path sysfsRoot)
+    : mSysfsRoot{std::move(sysfsRoot)}
+{
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator(mSysfsRoot / "devices/system/node", ec))
+    {
+        auto const name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0
+            || !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); }))
+        {
+            continue;
+        }
+        auto const node = static_cast<std::size_t>(std::stoi(name.substr(4)));
+        if (node >= kMaxNodes)
+        {
+            continue;
+        }
+        if (node >= mNodeCpus.size())
+        {
+            mNodeCpus.resize(node + 1);
+        }
+        mNodeCpus[node] = parseCpuList(readLine(entry.path() / "cpulist").value_or(""));
+    }
+
+    if (mNodeCpus.empty())
+    {
+        auto cpus = parseCpuList(readLine(mSysfsRoot / "devices/system/cpu/online").value_or(""));
+        if (cpus.empty())
+        {
+            cpus.resize(std::max(std::thread::hardware_concurrency(), 1U));
+            std::iota(cpus.begin(), cpus.end(), 0);
+        }
+        mNodeCpus.push_back(std::move(cpus));
+    }
+}
+
+NumaTopology const& NumaTopology::getInstance()
+{
+    static NumaTopology const instance;
+    return instance;
+}
+
+std::vector<SizeType32> NumaTopology::parseCpuList(std::string const& list)
+{
+    std::vector<SizeType32> cpus;
+    std::size_t begin = 0;
+    while (begin < list.size())
+    {
+        auto end = list.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        auto const range = list.substr(begin, end - begin);
+        begin = end + 1;
+        if (range.find_first_not_of(" \t\n") == std::string::npos)
+        {
+            continue;
+        }
+        auto const dash = range.find('-');
+        auto const first = std::stoi(range.substr(0, dash));
+        auto const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        TLLM_CHECK_WITH_INFO(0 <= first && first <= last, "Invalid CPU list '%s'", list.c_str());
+        for (auto cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<SizeType32> const& NumaTopology::getNodeCpus(SizeType32 node) const
+{
+    TLLM_CHECK_WITH_INFO(0 <= node && node < getNumNodes(), "Invalid NUMA node %d", node);
+    return mNodeCpus[node];
+}
+
+std::optional<DeviceAffinity> NumaTopology::getPciDeviceAffinity(std::string const& busId) const
+{
+    auto id = busId;
+    std::transform(id.begin(), id.end(), id.begin(), [](unsigned char c) { return std::tolower(c); });
+    auto const device = mSysfsRoot / "bus/pci/devices" / id;
+
+    auto const nodeLine = readLine(device / "numa_node");
+    if (!nodeLine)
+    {
+        return std::nullopt;
+    }
+    auto const node = std::stoi(*nodeLine);
+    // -1 when the firmware does not describe the topology.
+    if (node < 0 || node >= getNumNodes())
+    {
+        return std::nullopt;
+    }
+
+    auto cpus = parseCpuList(readLine(device / "local_cpulist").value_or(""));
+    if (cpus.empty())
+    {
+        cpus = mNodeCpus[node];
+    }
+    return DeviceAffinity{node, std::move(cpus)};
+}
+
+std::optional<DeviceAffinity> const& NumaTopology::getDeviceAffinity(SizeType32 device)
+{
+    static std::mutex mutex;
+    static std::map<SizeType32, std::optional<DeviceAffinity>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto const it = cache.find(device);
+    if (it != cache.end())
+    {
+        return it->second;
+    }
+
+    std::optional<DeviceAffinity> affinity;
+    auto const& topology = getInstance();
+    if (!common::getEnvDisableNumaAffinity() && topology.getNumNodes() > 1)
+    {
+        std::array<char, 32> busId{};
+        TLLM_CUDA_CHECK(::cudaDeviceGetPCIBusId(busId.data(), static_cast<int>(busId.size()), device));
+        affinity = topology.getPciDeviceAffinity(busId.data());
+        if (affinity)
+        {
+            TLLM_LOG_INFO("Device %d (%s) is on NUMA node %d with %zu local CPUs", device, busId.data(),
+                affinity->numaNode, affinity->cpus.size());
+        }
+        else
+        {
+            TLLM_LOG_WARNING("NUMA node of device %d (%s) is unknown", device, busId.data());
+        }
+    }
+    return cache.emplace(device, std::move(affinity)).first->second;
+}
+
+std::optional<SizeType32> NumaTopology::getCurrentDeviceNumaNode()
+{
+    int device{0};
+    TLLM_CUDA_CHECK(::cudaGetDevice(&device));
+    auto const& affinity = getDeviceAffinity(device);
+    return affinity ? std::optional<SizeType32>{affinity->numaNode} : std::nullopt;
+}
+
+bool bindCurrentThreadToCpus(std::vector<SizeType32> const& cpus)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto const cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    if (CPU_COUNT(&cpuSet) == 0)
+    {
+        return false;
+    }
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+}
+
+bool bindMemoryToNumaNode(void* ptr, std::size_t size, SizeType32 node)
+{
+    if (node < 0 || static_cast<std::size_t>(node) >= kMaxNodes || size == 0)
+    {
+        return false;
+    }
+    auto const pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto const begin = reinterpret_cast<std::uintptr_t>(ptr) / pageSize * pageSize;
+    auto const end = reinterpret_cast<std::uintptr_t>(ptr) + size;
+    auto const mask = makeNodeMask(node);
+    return ::syscall(SYS_mbind, begin, end - begin, kMpolPreferred, mask.data(), kMaxNodes, 0) == 0;
+}
+
+ScopedNumaMemoryPolicy::ScopedNumaMemoryPolicy(std::optional<SizeType32> node)
+{
+    if (!node || *node < 0 || static_cast<std::size_t>(*node) >= kMaxNodes)
+    {
+        return;
+    }
+    // Keep the policy the process was started with, e.g. by numactl.
+    int mode{-1};
+    NodeMask currentMask{};
+    if (::syscall(SYS_get_mempolicy, &mode, currentMask.data(), kMaxNodes, nullptr, 0) != 0 || mode != kMpolDefault)
+    {
+        return;
+    }
+    auto const mask = makeNodeMask(*node);
+    mActive = ::syscall(SYS_set_mempolicy, kMpolPreferred, mask.data(), kMaxNodes) == 0;
+}
+
+ScopedNumaMemoryPolicy::~ScopedNumaMemoryPolicy()
+{
+    if (mActive)
+    {
+        ::syscall(SYS_set_mempolicy, kMpolDefault, nullptr, 0);
+    }
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/requestLatency.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+using Clock = RequestLatencyBreakdown::Clock;
+using Duration = RequestLatencyBreakdown::Duration;
+
+//! Marks a slot taken by a request whose fields are not initialized yet.
+auto constexpr kReservedSlot = ~texec::IdType{0} - 1;
+//! Marks the slot of a finished request which is still pinned.
+auto constexpr kRetiredSlot = ~texec::IdType{0} - 2;
+
+std::int64_t toNanoseconds(Clock::time_point timePoint)
+{
+    return std::chrono::duration_cast<Duration>(timePoint.time_since_epoch()).count();
+}
+
+std::optional<Duration> sinceArrival(std::int64_t timePoint, std::int64_t arrival)
+{
+    return timePoint == 0 ? std::nullopt : std::optional<Duration>{Duration{timePoint - arrival}};
+}
+
+//! Sets value to desired unless it is already set.
+template <typename T>
+void setOnce(std::atomic<T>& value, T desired)
+{
+    T expected{0};
+    value.compare_exchange_strong(expected, desired, std::memory_order_relaxed);
+}
+
+template <typename T>
+void write(std::ostream& os, T const& value)
+{
+    os.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(std::istream& is)
+{
+    T value;
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    TLLM_CHECK_WITH_INFO(is.good(), "Truncated request latency buffer");
+    return value;
+}
+
+void writeOptionalDuration(std::ostream& os, std::optional<Duration> const& duration)
+{
+    write(os, duration.has_value());
+    if (duration)
+    {
+        write(os, static_cast<std::int64_t>(duration->count()));
+    }
+}
+
+std::optional<Duration> readOptionalDuration(std::istream& is)
+{
+    if (read<bool>(is))
+    {
+        return Duration{read<std::int64_t>(is)};
+    }
+    return std::nullopt;
+}
+
+std::size_t optionalDurationSize(std::optional<Duration> const& duration)
+{
+    return sizeof(bool) + (duration ? sizeof(std::int64_t) : 0);
+}
+
+} // namespace
+
+std::optional<Duration> RequestLatencyBreakdown::getDecodeTime() const
+{
+    if (!firstToken || !lastToken)
+    {
+        return std::nullopt;
+    }
+    return *lastToken - *firstToken;
+}
+
+bool RequestLatencyBreakdown::operator==(RequestLatencyBreakdown const& other) const
+{
+    return arrival == other.arrival && firstScheduled == other.firstScheduled && firstToken == other.firstToken
+        && lastToken == other.lastToken && pausedTime == other.pausedTime && numPreemptions == other.numPreemptions
+        && numPrefillChunks == other.numPrefillChunks;
+}
+
+void RequestLatencyBreakdown::serialize(std::ostream& os) const
+{
+    write(os, toNanoseconds(arrival));
+    writeOptionalDuration(os, firstScheduled);
+    writeOptionalDuration(os, firstToken);
+    writeOptionalDuration(os, lastToken);
+    write(os, static_cast<std::int64_t>(pausedTime.count()));
+    write(os, numPreemptions);
+    write(os, numPrefillChunks);
+}
+
+std::size_t RequestLatencyBreakdown::serializedSize() const
+{
+    return sizeof(std::int64_t) + optionalDurationSize(firstScheduled) + optionalDurationSize(firstToken)
+        + optionalDurationSize(lastToken) + sizeof(std::int64_t) + sizeof(numPreemptions) + sizeof(numPrefillChunks);
+}
+
+RequestLatencyBreakdown RequestLatencyBreakdown::deserialize(std::istream& is)
+{
+    RequestLatencyBreakdown breakdown;
+    breakdown.arrival = Clock::time_point{Duration{read<std::int64_t>(is)}};
+    breakdown.firstScheduled = readOptionalDuration(is);
+    breakdown.firstToken = readOptionalDuration(is);
+    breakdown.lastToken = readOptionalDuration(is);
+    breakdown.pausedTime = Duration{read<std::int64_t>(is)};
+    breakdown.numPreemptions = read<SizeType32>(is);
+    breakdown.numPrefillChunks = read<SizeType32>(is);
+    return breakdown;
+}
+
+RequestLatencyRecorder::RequestLatencyRecorder(SizeType32 maxNumRequests)
+{
+    TLLM_CHECK_WITH_INFO(maxNumRequests > 0, "maxNumRequests must be positive, got %d", maxNumRequests);
+    // Keep the table at most half full, so that the probes of a request rarely all hit other requests.
+    mNumSlots = kMaxProbes;
+    mHashShift = 64 - 4;
+    while (mNumSlots < 2 * static_cast<std::size_t>(maxNumRequests))
+    {
+        mNumSlots *= 2;
+        --mHashShift;
+    }
+    mSlots = std::make_unique<Slot[]>(mNumSlots);
+}
+
+std::size_t RequestLatencyRecorder::getHomeSlot(IdType requestId) const noexcept
+{
+    // Fibonacci hashing spreads both consecutive and strided ids.
+    return static_cast<std::size_t>((static_cast<std::uint64_t>(requestId) * 0x9E3779B97F4A7C15ULL) >> mHashShift);
+}
+
+void RequestLatencyRecorder::Unpin::operator()(Slot* slot) const noexcept
+{
+    if (slot->numPins.fetch_sub(1, std::memory_order_seq_cst) == 1)
+    {
+        // The last thread using a retired slot frees it, after all the writes to it.
+        auto retired = kRetiredSlot;
+        slot->requestId.compare_exchange_strong(retired, kFreeSlot, std::memory_order_release);
+    }
+}
+
+RequestLatencyRecorder::PinnedSlot RequestLatencyRecorder::pin(IdType requestId) const noexcept
+{
+    auto const home = getHomeSlot(requestId);
+    // Finished requests free their slot, so the probes cannot stop at the first free slot.
+    for (std::size_t probe = 0; probe < kMaxProbes; ++probe)
+    {
+        auto& slot = mSlots[(home + probe) & (mNumSlots - 1)];
+        if (slot.requestId.load(std::memory_order_acquire) != requestId)
+        {
+            continue;
+        }
+        slot.numPins.fetch_add(1, std::memory_order_seq_cst);
+        PinnedSlot pinned{&slot};
+        // Once pinned, check the id again: a slot retired before the pin may be freed and reused at any time.
+        if (slot.requestId.load(std::memory_order_seq_cst) == requestId)
+        {
+            return pinned;
+        }
+    }
+    return nullptr;
+}
+
+bool RequestLatencyRecorder::start(IdType requestId, Clock::time_point arrival)
+{
+    TLLM_CHECK_WITH_INFO(
+        requestId != kFreeSlot && requestId != kReservedSlot && requestId != kRetiredSlot, "Request id %lu is reserved",
+        requestId);
+    auto const home = getHomeSlot(requestId);
+    for (std::size_t probe = 0; probe < kMaxProbes; ++probe)
+    {
+        auto& slot = mSlots[(home + probe) & (mNumSlots - 1)];
+        auto expected = kFreeSlot;
+        if (slot.requestId.load(std::memory_order_relaxed) != kFreeSlot
+            || !slot.requestId.compare_exchange_strong(expected, kReservedSlot, std::memory_order_acquire))
+        {
+            continue;
+        }
+        slot.arrival.store(toNanoseconds(arrival), std::memory_order_relaxed);
+        slot.firstScheduled.store(0, std::memory_order_relaxed);
+        slot.firstToken.store(0, std::memory_order_relaxed);
+        slot.lastToken.store(0, std::memory_order_relaxed);
+        slot.pausedSince.store(0, std::memory_order_relaxed);
+        slot.pausedTime.store(0, std::memory_order_relaxed);
+        slot.numPreemptions.store(0, std::memory_order_relaxed);
+        slot.numPrefillChunks.store(0, std::memory_order_relaxed);
+        slot.contextPrefillPosition.store(-1, std::memory_order_relaxed);
+        // Publish the initialized fields with the id.
+        slot.requestId.store(requestId, std::memory_order_release);
+        mNumRequests.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void RequestLatencyRecorder::onScheduled(IdType requestId, Clock::time_point now)
+{
+    if (auto const slot = pin(requestId))
+    {
+        setOnce(slot->firstScheduled, toNanoseconds(now));
+    }
+}
+
+void RequestLatencyRecorder::onPrefillChunk(IdType requestId)
+{
+    if (auto const slot = pin(requestId))
+    {
+        slot->numPrefillChunks.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RequestLatencyRecorder::pause(Slot& slot, Clock::time_point now)
+{
+    std::int64_t notPaused{0};
+    if (slot.pausedSince.compare_exchange_strong(notPaused, toNanoseconds(now), std::memory_order_relaxed)
+        && slot.firstScheduled.load(std::memory_order_relaxed) != 0)
+    {
+        slot.numPreemptions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RequestLatencyRecorder::resume(Slot& slot, Clock::time_point now)
+{
+    if (auto const pausedSince = slot.pausedSince.exchange(0, std::memory_order_relaxed); pausedSince != 0)
+    {
+        slot.pausedTime.fetch_add(toNanoseconds(now) - pausedSince, std::memory_order_relaxed);
+    }
+}
+
+void RequestLatencyRecorder::onPaused(IdType requestId, Clock::time_point now)
+{
+    if (auto const slot = pin(requestId))
+    {
+        pause(*slot, now);
+    }
+}
+
+void RequestLatencyRecorder::onResumed(IdType requestId, Clock::time_point now)
+{
+    if (auto const slot = pin(requestId))
+    {
+        resume(*slot, now);
+    }
+}
+
+bool RequestLatencyRecorder::onToken(IdType requestId, Clock::time_point now)
+{
+    auto const slot = pin(requestId);
+    if (!slot)
+    {
+        return false;
+    }
+    auto const timePoint = toNanoseconds(now);
+    setOnce(slot->firstToken, timePoint);
+    slot->lastToken.store(timePoint, std::memory_order_relaxed);
+    return true;
+}
+
+void RequestLatencyRecorder::onRequestStats(texec::RequestStats const& stats, Clock::time_point now)
+{
+    auto const slot = pin(stats.id);
+    if (!slot)
+    {
+        return;
+    }
+    if (stats.paused)
+    {
+        pause(*slot, now);
+    }
+    else
+    {
+        resume(*slot, now);
+    }
+    if (stats.scheduled)
+    {
+        setOnce(slot->firstScheduled, toNanoseconds(now));
+        // The prefill position moves once per chunk, which also ignores the stats of an iteration read twice.
+        if (stats.stage == texec::RequestStage::kCONTEXT_IN_PROGRESS
+            && slot->contextPrefillPosition.exchange(stats.contextPrefillPosition, std::memory_order_relaxed)
+                != stats.contextPrefillPosition)
+        {
+            slot->numPrefillChunks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+RequestLatencyBreakdown RequestLatencyRecorder::makeBreakdown(Slot const& slot, Clock::time_point now)
+{
+    auto const arrival = slot.arrival.load(std::memory_order_relaxed);
+    RequestLatencyBreakdown breakdown;
+    breakdown.arrival = Clock::time_point{Duration{arrival}};
+    breakdown.firstScheduled = sinceArrival(slot.firstScheduled.load(std::memory_order_relaxed), arrival);
+    breakdown.firstToken = sinceArrival(slot.firstToken.load(std::memory_order_relaxed), arrival);
+    breakdown.lastToken = sinceArrival(slot.lastToken.load(std::memory_order_relaxed), arrival);
+    breakdown.pausedTime = Duration{slot.pausedTime.load(std::memory_order_relaxed)};
+    if (auto const pausedSince = slot.pausedSince.load(std::memory_order_relaxed); pausedSince != 0)
+    {
+        breakdown.pausedTime += Duration{toNanoseconds(now) - pausedSince};
+    }
+    breakdown.numPreemptions = slot.numPreemptions.load(std::memory_order_relaxed);
+    breakdown.numPrefillChunks = slot.numPrefillChunks.load(std::memory_order_relaxed);
+    return breakdown;
+}
+
+std::optional<RequestLatencyBreakdown> RequestLatencyRecorder::getBreakdown(
+    IdType requestId, Clock::time_point now) const
+{
+    auto const slot = pin(requestId);
+    return slot ? std::optional{makeBreakdown(*slot, now)} : std::nullopt;
+}
+
+std::optional<RequestLatencyBreakdown> RequestLatencyRecorder::finish(IdType requestId, Clock::time_point now)
+{
+    auto const slot = pin(requestId);
+    if (!slot)
+    {
+        return std::nullopt;
+    }
+    auto breakdown = makeBreakdown(*slot, now);
+    // Retire the slot, which the last unpin frees. Only one of concurrent finishes of a request succeeds.
+    auto expected = requestId;
+    if (!slot->requestId.compare_exchange_strong(expected, kRetiredSlot, std::memory_order_seq_cst))
+    {
+        return std::nullopt;
+    }
+    mNumRequests.fetch_sub(1, std::memory_order_relaxed);
+    return breakdown;
+}
+
+LatencyTrackingExecutor::LatencyTrackingExecutor(std::shared_ptr<texec::Executor> executor, SizeType32 maxNumRequests)
+    : mExecutor{std::move(executor)}
+    , mRecorder{maxNumRequests}
+{
+    TLLM_CHECK(mExecutor);
+}
+
+texec::IdType LatencyTrackingExecutor::enqueueRequest(texec::Request const& request)
+{
+    return enqueueRequests({request}).front();
+}
+
+std::vector<texec::IdType> LatencyTrackingExecutor::enqueueRequests(std::vector<texec::Request> const& requests)
+{
+    auto const arrival = Clock::now();
+    mNumEnqueuing.fetch_add(1, std::memory_order_seq_cst);
+    std::vector<texec::IdType> requestIds;
+    try
+    {
+        requestIds = mExecutor->enqueueRequests(requests);
+    }
+    catch (...)
+    {
+        mNumEnqueuing.fetch_sub(1, std::memory_order_seq_cst);
+        throw;
+    }
+    for (auto const requestId : requestIds)
+    {
+        if (!mRecorder.start(requestId, arrival))
+        {
+            TLLM_LOG_WARNING("No latency slot for request %lu, its latency is not recorded", requestId);
+        }
+    }
+    mNumEnqueuing.fetch_sub(1, std::memory_order_seq_cst);
+    // Either this thread sees the responses held before the requests were registered, or the thread holding them sees
+    // the requests registered.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumEarlyResponses.load(std::memory_order_relaxed) > 0)
+    {
+        recordEarlyResponses();
+    }
+    return requestIds;
+}
+
+std::vector<TimedResponse> LatencyTrackingExecutor::awaitResponses(
+    std::optional<std::chrono::milliseconds> const& timeout)
+{
+    auto responses = mExecutor->awaitResponses(timeout);
+    // Read before looking the requests up: once no request is being enqueued, the requests of the responses are
+    // registered, unless they are finished.
+    auto const numEnqueuing = mNumEnqueuing.load(std::memory_order_seq_cst);
+    if (mNumEarlyResponses.load(std::memory_order_relaxed) > 0)
+    {
+        recordEarlyResponses();
+    }
+    auto const now = Clock::now();
+    std::vector<TimedResponse> timedResponses;
+    timedResponses.reserve(responses.size());
+    for (auto& response : responses)
+    {
+        auto const requestId = response.getRequestId();
+        auto const hasToken = !response.hasError();
+        auto const isFinal = !hasToken || response.getResult().isFinal;
+        auto registered = !hasToken || mRecorder.onToken(requestId, now);
+        std::optional<RequestLatencyBreakdown> latency;
+        if (registered && isFinal)
+        {
+            latency = mRecorder.finish(requestId, now);
+            registered = latency.has_value();
+        }
+        if (!registered && numEnqueuing > 0)
+        {
+            latency = holdEarlyResponse(requestId, hasToken, isFinal, now);
+        }
+        timedResponses.push_back(TimedResponse{std::move(response), std::move(latency)});
+    }
+    return timedResponses;
+}
+
+std::optional<RequestLatencyBreakdown> LatencyTrackingExecutor::holdEarlyResponse(
+    texec::IdType requestId, bool hasToken, bool isFinal, Clock::time_point now)
+{
+    auto const sameRequest = [requestId](EarlyResponses const& held) { return held.requestId == requestId; };
+    {
+        std::lock_guard<std::mutex> lock(mEarlyResponsesMutex);
+        auto it = std::find_if(mEarlyResponses.begin(), mEarlyResponses.end(), sameRequest);
+        if (it == mEarlyResponses.end())
+        {
+            it = mEarlyResponses.insert(mEarlyResponses.end(), EarlyResponses{requestId, std::nullopt, now, false});
+        }
+        if (hasToken)
+        {
+            it->firstToken = it->firstToken.value_or(now);
+            it->lastToken = now;
+        }
+        it->isFinal |= isFinal;
+        mNumEarlyResponses.store(mEarlyResponses.size(), std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mRecorder.getBreakdown(requestId, now))
+    {
+        // Recorded by the enqueuing thread once registered.
+        return std::nullopt;
+    }
+    // Registered meanwhile, record the responses unless another thread did.
+    std::optional<EarlyResponses> held;
+    {
+        std::lock_guard<std::mutex> lock(mEarlyResponsesMutex);
+        auto const it = std::find_if(mEarlyResponses.begin(), mEarlyResponses.end(), sameRequest);
+        if (it != mEarlyResponses.end())
+        {
+            held = *it;
+            mEarlyResponses.erase(it);
+            mNumEarlyResponses.store(mEarlyResponses.size(), std::memory_order_relaxed);
+        }
+    }
+    return held ? record(*held) : std::nullopt;
+}
+
+void LatencyTrackingExecutor::recordEarlyResponses()
+{
+    std::lock_guard<std::mutex> lock(mEarlyResponsesMutex);
+    // Requests still unregistered when none is being enqueued were not enqueued here, or are finished.
+    auto const dropUnregistered = mNumEnqueuing.load(std::memory_order_seq_cst) == 0;
+    auto const now = Clock::now();
+    auto const end = std::remove_if(mEarlyResponses.begin(), mEarlyResponses.end(),
+        [&](EarlyResponses const& held)
+        {
+            if (!mRecorder.getBreakdown(held.requestId, now))
+            {
+                return dropUnregistered;
+            }
+            record(held);
+            return true;
+        });
+    mEarlyResponses.erase(end, mEarlyResponses.end());
+    mNumEarlyResponses.store(mEarlyResponses.size(), std::memory_order_relaxed);
+}
+
+std::optional<RequestLatencyBreakdown> LatencyTrackingExecutor::record(EarlyResponses const& responses)
+{
+    if (responses.firstToken)
+    {
+        mRecorder.onToken(responses.requestId, *responses.firstToken);
+        mRecorder.onToken(responses.requestId, responses.lastToken);
+    }
+    return responses.isFinal ? mRecorder.finish(responses.requestId, responses.lastToken) : std::nullopt;
+}
+
+void LatencyTrackingExecutor::cancelRequest(texec::IdType requestId)
+{
+    // The request is finished by its last response.
+    mExecutor->cancelRequest(requestId);
+}
+
+std::deque<TimedRequestStatsPerIteration> LatencyTrackingExecutor::getLatestRequestStats()
+{
+    auto const now = Clock::now();
+    std::deque<TimedRequestStatsPerIteration> timedStats;
+    for (auto& iterationStats : mExecutor->getLatestRequestStats())
+    {
+        auto& timedIteration = timedStats.emplace_back();
+        timedIteration.iter = iterationStats.iter;
+        timedIteration.requestStats.reserve(iterationStats.requestStats.size());
+        for (auto const& stats : iterationStats.requestStats)
+        {
+            mRecorder.onRequestStats(stats, now);
+            timedIteration.requestStats.push_back(TimedRequestStats{stats, mRecorder.getBreakdown(stats.id, now)});
+        }
+    }
+    return timedStats;
+}
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/responseCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/serialization.h"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+//! Bump when the key layout changes.
+std::uint8_t constexpr kKeyVersion = 1;
+//! Rough bookkeeping cost of an entry: list node, map node and Entry.
+std::size_t constexpr kEntryOverhead = 128;
+
+template <typename T>
+void write(std::ostream& os, T const& value)
+{
+    os.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeVector(std::ostream& os, std::vector<T> const& values)
+{
+    write(os, static_cast<std::uint64_t>(values.size()));
+    os.write(reinterpret_cast<char const*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+void writeOptional(std::ostream& os, std::optional<T> const& value)
+{
+    write(os, value.has_value());
+    if (value)
+    {
+        write(os, *value);
+    }
+}
+
+void writeWords(std::ostream& os, std::optional<std::list<texec::VecTokens>> const& words)
+{
+    write(os, words.has_value());
+    if (words)
+    {
+        write(os, static_cast<std::uint64_t>(words->size()));
+        for (auto const& word : *words)
+        {
+            writeVector(os, word);
+        }
+    }
+}
+
+bool isGreedy(texec::SamplingConfig const& config)
+{
+    auto const topK = config.getTopK().value_or(0);
+    auto const topP = config.getTopP().value_or(0.f);
+    return config.getBeamWidth() == 1 && (topK == 1 || (topK == 0 && topP == 0.f));
+}
+
+std::size_t resultBytes(texec::Result const& result)
+{
+    std::size_t numBytes = sizeof(texec::Result);
+    for (auto const& beam : result.outputTokenIds)
+    {
+        numBytes += beam.size() * sizeof(texec::TokenIdType);
+    }
+    if (result.logProbs)
+    {
+        for (auto const& beam : *result.logProbs)
+        {
+            numBytes += beam.size() * sizeof(texec::FloatType);
+        }
+    }
+    if (result.cumLogProbs)
+    {
+        numBytes += result.cumLogProbs->size() * sizeof(texec::FloatType);
+    }
+    numBytes += result.finishReasons.size() * sizeof(texec::FinishReason);
+    return numBytes;
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(std::size_t maxBytes, std::optional<Clock::duration> timeToLive)
+    : mMaxBytes{maxBytes}
+    , mTimeToLive{timeToLive}
+{
+}
+
+std::optional<std::string> ResponseCache::makeKey(texec::Request const& request)
+{
+    auto const samplingConfig = request.getSamplingConfig();
+    auto const outputConfig = request.getOutputConfig();
+    if (!isGreedy(samplingConfig) || request.getNumReturnSequences() != 1
+        || request.getRequestType() != texec::RequestType::REQUEST_TYPE_CONTEXT_AND_GENERATION
+        || request.getContextPhaseParams() || request.getEmbeddingBias() || request.getExternalDraftTokensConfig()
+        || request.getPromptTuningConfig() || request.getLookaheadConfig() || request.getLogitsPostProcessorName()
+        || request.getEncoderInputFeatures() || outputConfig.returnContextLogits || outputConfig.returnGenerationLogits
+        || outputConfig.returnEncoderOutput)
+    {
+        return std::nullopt;
+    }
+
+    std::ostringstream os;
+    write(os, kKeyVersion);
+    writeVector(os, request.getInputTokenIds());
+    write(os, request.getMaxTokens());
+    write(os, request.getStreaming());
+    write(os, request.getReturnAllGeneratedTokens());
+    texec::Serialization::serialize(samplingConfig, os);
+    texec::Serialization::serialize(outputConfig, os);
+    writeOptional(os, request.getEndId());
+    writeOptional(os, request.getPadId());
+    auto const positionIds = request.getPositionIds();
+    write(os, positionIds.has_value());
+    if (positionIds)
+    {
+        writeVector(os, *positionIds);
+    }
+    writeWords(os, request.getBadWords());
+    writeWords(os, request.getStopWords());
+    auto const loraConfig = request.getLoraConfig();
+    writeOptional(os, loraConfig ? std::optional<texec::IdType>{loraConfig->getTaskId()} : std::nullopt);
+    auto const encoderInputTokenIds = request.getEncoderInputTokenIds();
+    write(os, encoderInputTokenIds.has_value());
+    if (encoderInputTokenIds)
+    {
+        writeVector(os, *encoderInputTokenIds);
+    }
+    writeOptional(os, request.getEncoderOutputLength());
+    return std::move(os).str();
+}
+
+std::optional<std::vector<texec::Response>> ResponseCache::lookup(std::string const& key, texec::IdType requestId)
+{
+    std::vector<texec::Result> results;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            ++mStats.numMisses;
+            return std::nullopt;
+        }
+        if (mTimeToLive && Clock::now() - it->second.insertionTime > *mTimeToLive)
+        {
+            eraseLocked(it);
+            ++mStats.numExpirations;
+            ++mStats.numMisses;
+            return std::nullopt;
+        }
+        mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+        ++mStats.numHits;
+        results = it->second.results;
+    }
+
+    std::vector<texec::Response> responses;
+    responses.reserve(results.size());
+    for (auto& result : results)
+    {
+        responses.emplace_back(requestId, std::move(result));
+    }
+    return responses;
+}
+
+void ResponseCache::insert(std::string key, std::vector<texec::Result> results)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    insertLocked(std::move(key), std::move(results));
+}
+
+void ResponseCache::insertLocked(std::string key, std::vector<texec::Result> results)
+{
+    auto numBytes = kEntryOverhead + key.size();
+    for (auto const& result : results)
+    {
+        numBytes += resultBytes(result);
+    }
+    if (auto it = mEntries.find(key); it != mEntries.end())
+    {
+        eraseLocked(it);
+    }
+    if (numBytes > mMaxBytes)
+    {
+        TLLM_LOG_DEBUG("Not caching a response of %zu bytes, the cache holds at most %zu", numBytes, mMaxBytes);
+        return;
+    }
+    while (mStats.usedBytes + numBytes > mMaxBytes)
+    {
+        eraseLocked(mEntries.find(mLru.back()));
+        ++mStats.numEvictions;
+    }
+
+    mLru.push_front(std::move(key));
+    mEntries.emplace(mLru.front(), Entry{std::move(results), Clock::now(), numBytes, mLru.begin()});
+    mStats.usedBytes += numBytes;
+    mStats.numEntries = mEntries.size();
+    ++mStats.numInsertions;
+}
+
+void ResponseCache::eraseLocked(std::unordered_map<std::string_view, Entry>::iterator it)
+{
+    TLLM_CHECK(it != mEntries.end());
+    auto const lruIt = it->second.lruIt;
+    mStats.usedBytes -= it->second.numBytes;
+    // Erase the map node first, its key is a view of the list node.
+    mEntries.erase(it);
+    mLru.erase(lruIt);
+    mStats.numEntries = mEntries.size();
+}
+
+void ResponseCache::startRecording(texec::IdType requestId, std::string key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecordings.insert_or_assign(requestId, std::make_pair(std::move(key), std::vector<texec::Result>{}));
+}
+
+void ResponseCache::recordResponse(texec::Response const& response)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mRecordings.find(response.getRequestId());
+    if (it == mRecordings.end())
+    {
+        return;
+    }
+    if (response.hasError())
+    {
+        mRecordings.erase(it);
+        return;
+    }
+    auto const& result = response.getResult();
+    auto& [key, results] = it->second;
+    results.push_back(result);
+    if (result.isFinal)
+    {
+        // Cancelled requests finish early without a finish reason.
+        auto const cancelled = std::any_of(result.finishReasons.begin(), result.finishReasons.end(),
+            [](auto const reason) { return reason == texec::FinishReason::kNOT_FINISHED; });
+        if (!cancelled)
+        {
+            insertLocked(std::move(key), std::move(results));
+        }
+        mRecordings.erase(it);
+    }
+}
+
+void ResponseCache::stopRecording(texec::IdType requestId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecordings.erase(requestId);
+}
+
+void ResponseCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mLru.clear();
+    mRecordings.clear();
+    mStats.usedBytes = 0;
+    mStats.numEntries = 0;
+}
+
+ResponseCache::Stats ResponseCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+CachingExecutor::CachingExecutor(std::shared_ptr<texec::Executor> executor, std::shared_ptr<ResponseCache> cache)
+    : mExecutor{std::move(executor)}
+    , mCache{std::move(cache)}
+{
+    TLLM_CHECK(mExecutor);
+    TLLM_CHECK(mCache);
+}
+
+texec::IdType CachingExecutor::enqueueRequest(texec::Request const& request)
+{
+    return enqueueRequests({request}).front();
+}
+
+std::vector<texec::IdType> CachingExecutor::enqueueRequests(std::vector<texec::Request> const& requests)
+{
+    std::vector<texec::IdType> requestIds(requests.size());
+    std::vector<std::optional<std::string>> keys(requests.size());
+    std::vector<std::size_t> missIndices;
+    std::vector<texec::Request> misses;
+
+    // Hold the lock until the misses are recorded, so that their first responses cannot be consumed before.
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        keys[i] = ResponseCache::makeKey(requests[i]);
+        if (keys[i])
+        {
+            auto const replayId = mNextReplayId;
+            if (auto responses = mCache->lookup(*keys[i], replayId))
+            {
+                ++mNextReplayId;
+                requestIds[i] = replayId;
+                std::move(responses->begin(), responses->end(), std::back_inserter(mReplayed));
+                continue;
+            }
+        }
+        missIndices.push_back(i);
+        misses.push_back(requests[i]);
+    }
+    if (misses.empty())
+    {
+        return requestIds;
+    }
+
+    auto const missIds = mExecutor->enqueueRequests(misses);
+    for (std::size_t j = 0; j < missIndices.size(); ++j)
+    {
+        auto const i = missIndices[j];
+        requestIds[i] = missIds[j];
+        if (keys[i])
+        {
+            mCache->startRecording(missIds[j], std::move(*keys[i]));
+        }
+    }
+    return requestIds;
+}
+
+std::vector<texec::Response> CachingExecutor::awaitResponses(std::optional<std::chrono::milliseconds> const& timeout)
+{
+    std::vector<texec::Response> replayed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::move(mReplayed.begin(), mReplayed.end(), std::back_inserter(replayed));
+        mReplayed.clear();
+    }
+
+    // Do not block on the executor when replayed responses are ready to be returned.
+    auto responses = mExecutor->awaitResponses(replayed.empty() ? timeout : std::chrono::milliseconds{0});
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto const& response : responses)
+        {
+            mCache->recordResponse(response);
+        }
+    }
+    std::move(replayed.begin(), replayed.end(), std::back_inserter(responses));
+    return responses;
+}
+
+void CachingExecutor::cancelRequest(texec::IdType requestId)
+{
+    if (requestId >= kFirstReplayId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReplayed.erase(std::remove_if(mReplayed.begin(), mReplayed.end(),
+                            [requestId](auto const& response) { return response.getRequestId() == requestId; }),
+            mReplayed.end());
+        return;
+    }
+    mExecutor->cancelRequest(requestId);
+    mCache->stopRecording(requestId);
+}
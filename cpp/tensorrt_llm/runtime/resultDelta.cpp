@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/resultDelta.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/serialization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <streambuf>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+//! \brief Stream buffer over preallocated memory, avoids the copies of string streams.
+class VectorWrapBuf : public std::streambuf
+{
+public:
+    explicit VectorWrapBuf(std::vector<char>& buffer)
+    {
+        setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+};
+
+template <typename T>
+void write(std::ostream& os, T const& value)
+{
+    os.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(std::istream& is)
+{
+    T value;
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    TLLM_CHECK_WITH_INFO(is.good(), "Truncated result delta buffer");
+    return value;
+}
+
+template <typename T>
+void writeVector(std::ostream& os, std::vector<T> const& values)
+{
+    write(os, static_cast<std::uint64_t>(values.size()));
+    os.write(reinterpret_cast<char const*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+std::vector<T> readVector(std::istream& is)
+{
+    auto const size = read<std::uint64_t>(is);
+    std::vector<T> values(size);
+    is.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size * sizeof(T)));
+    TLLM_CHECK_WITH_INFO(is.good() || size == 0, "Truncated result delta buffer");
+    return values;
+}
+
+template <typename T>
+std::size_t vectorSize(std::vector<T> const& values)
+{
+    return sizeof(std::uint64_t) + values.size() * sizeof(T);
+}
+
+void writeOptionalTensor(std::ostream& os, std::optional<texec::Tensor> const& tensor)
+{
+    write(os, tensor.has_value());
+    if (tensor)
+    {
+        texec::Serialization::serialize(*tensor, os);
+    }
+}
+
+std::optional<texec::Tensor> readOptionalTensor(std::istream& is)
+{
+    if (read<bool>(is))
+    {
+        return texec::Serialization::deserializeTensor(is);
+    }
+    return std::nullopt;
+}
+
+std::size_t optionalTensorSize(std::optional<texec::Tensor> const& tensor)
+{
+    return sizeof(bool) + (tensor ? texec::Serialization::serializedSize(*tensor) : 0);
+}
+
+//! \brief Length of the common prefix, comparing elements bitwise so that log probs round-trip exactly.
+template <typename T>
+std::size_t commonPrefixLength(std::vector<T> const& a, std::vector<T> const& b)
+{
+    auto const size = std::min(a.size(), b.size());
+    if (size == 0)
+    {
+        return 0;
+    }
+    // Fast path: a beam that was only extended matches entirely.
+    if (std::memcmp(a.data(), b.data(), size * sizeof(T)) == 0)
+    {
+        return size;
+    }
+    auto const [itA, itB] = std::mismatch(a.begin(), a.begin() + size, b.begin(),
+        [](T const& x, T const& y) { return std::memcmp(&x, &y, sizeof(T)) == 0; });
+    return static_cast<std::size_t>(itA - a.begin());
+}
+
+} // namespace
+
+bool BeamDelta::operator==(BeamDelta const& other) const
+{
+    return sourceBeam == other.sourceBeam && tokenPrefixLength == other.tokenPrefixLength && tokens == other.tokens
+        && logProbPrefixLength == other.logProbPrefixLength && logProbs == other.logProbs;
+}
+
+void ResultDelta::serialize(std::ostream& os) const
+{
+    write(os, isFinal);
+    write(os, isSequenceFinal);
+    write(os, sequenceIndex);
+    write(os, decodingIter);
+    write(os, hasLogProbs);
+    write(os, static_cast<std::uint64_t>(beams.size()));
+    for (auto const& beam : beams)
+    {
+        write(os, beam.sourceBeam);
+        write(os, beam.tokenPrefixLength);
+        writeVector(os, beam.tokens);
+        if (hasLogProbs)
+        {
+            write(os, beam.logProbPrefixLength);
+            writeVector(os, beam.logProbs);
+        }
+    }
+    write(os, cumLogProbs.has_value());
+    if (cumLogProbs)
+    {
+        writeVector(os, *cumLogProbs);
+    }
+    writeVector(os, finishReasons);
+    writeOptionalTensor(os, contextLogits);
+    writeOptionalTensor(os, generationLogits);
+    writeOptionalTensor(os, encoderOutput);
+    write(os, contextPhaseParams.has_value());
+    if (contextPhaseParams)
+    {
+        texec::Serialization::serialize(*contextPhaseParams, os);
+    }
+}
+
+std::size_t ResultDelta::serializedSize() const
+{
+    std::size_t size = 3 * sizeof(bool) + 2 * sizeof(SizeType32) + sizeof(std::uint64_t);
+    for (auto const& beam : beams)
+    {
+        size += 2 * sizeof(SizeType32) + vectorSize(beam.tokens);
+        if (hasLogProbs)
+        {
+            size += sizeof(SizeType32) + vectorSize(beam.logProbs);
+        }
+    }
+    size += sizeof(bool) + (cumLogProbs ? vectorSize(*cumLogProbs) : 0);
+    size += vectorSize(finishReasons);
+    size += optionalTensorSize(contextLogits) + optionalTensorSize(generationLogits)
+        + optionalTensorSize(encoderOutput);
+    size += sizeof(bool) + (contextPhaseParams ? texec::Serialization::serializedSize(*contextPhaseParams) : 0);
+    return size;
+}
+
+ResultDelta ResultDelta::deserialize(std::istream& is)
+{
+    ResultDelta delta;
+    delta.isFinal = read<bool>(is);
+    delta.isSequenceFinal = read<bool>(is);
+    delta.sequenceIndex = read<SizeType32>(is);
+    delta.decodingIter = read<SizeType32>(is);
+    delta.hasLogProbs = read<bool>(is);
+    delta.beams.resize(read<std::uint64_t>(is));
+    for (auto& beam : delta.beams)
+    {
+        beam.sourceBeam = read<SizeType32>(is);
+        beam.tokenPrefixLength = read<SizeType32>(is);
+        beam.tokens = readVector<texec::TokenIdType>(is);
+        if (delta.hasLogProbs)
+        {
+            beam.logProbPrefixLength = read<SizeType32>(is);
+            beam.logProbs = readVector<texec::FloatType>(is);
+        }
+    }
+    if (read<bool>(is))
+    {
+        delta.cumLogProbs = readVector<texec::FloatType>(is);
+    }
+    delta.finishReasons = readVector<texec::FinishReason>(is);
+    delta.contextLogits = readOptionalTensor(is);
+    delta.generationLogits = readOptionalTensor(is);
+    delta.encoderOutput = readOptionalTensor(is);
+    if (read<bool>(is))
+    {
+        delta.contextPhaseParams = texec::Serialization::deserializeContextPhaseParams(is);
+    }
+    return delta;
+}
+
+ResultDelta ResultDeltaEncoder::encode(texec::Result const& result)
+{
+    ResultDelta delta;
+    delta.isFinal = result.isFinal;
+    delta.isSequenceFinal = result.isSequenceFinal;
+    delta.sequenceIndex = result.sequenceIndex;
+    delta.decodingIter = result.decodingIter;
+    delta.hasLogProbs = result.logProbs.has_value();
+    delta.cumLogProbs = result.cumLogProbs;
+    delta.finishReasons = result.finishReasons;
+    delta.contextLogits = result.contextLogits;
+    delta.generationLogits = result.generationLogits;
+    delta.encoderOutput = result.encoderOutput;
+    delta.contextPhaseParams = result.contextPhaseParams;
+
+    auto const numBeams = result.outputTokenIds.size();
+    TLLM_CHECK_WITH_INFO(!delta.hasLogProbs || result.logProbs->size() == numBeams,
+        "Expected log probs for %zu beams, got %zu", numBeams, result.logProbs->size());
+    auto const numPrevBeams = mTokens.size();
+    static texec::VecLogProbs const kEmptyLogProbs;
+
+    delta.beams.resize(numBeams);
+    for (std::size_t beamIdx = 0; beamIdx < numBeams; ++beamIdx)
+    {
+        auto const& tokens = result.outputTokenIds[beamIdx];
+        auto& beam = delta.beams[beamIdx];
+        std::size_t sourceBeam = beamIdx;
+        std::size_t prefixLength = 0;
+        if (mEnableDelta && numPrevBeams > 0)
+        {
+            // Most steps extend every beam in place, try the same beam first.
+            sourceBeam = std::min(beamIdx, numPrevBeams - 1);
+            prefixLength = commonPrefixLength(mTokens[sourceBeam], tokens);
+            if (prefixLength < mTokens[sourceBeam].size())
+            {
+                for (std::size_t candidate = 0; candidate < numPrevBeams; ++candidate)
+                {
+                    auto const candidateLength = commonPrefixLength(mTokens[candidate], tokens);
+                    if (candidateLength > prefixLength)
+                    {
+                        sourceBeam = candidate;
+                        prefixLength = candidateLength;
+                    }
+                }
+            }
+        }
+        beam.sourceBeam = static_cast<SizeType32>(sourceBeam);
+        beam.tokenPrefixLength = static_cast<SizeType32>(prefixLength);
+        beam.tokens.assign(tokens.begin() + static_cast<std::ptrdiff_t>(prefixLength), tokens.end());
+
+        if (delta.hasLogProbs)
+        {
+            auto const& logProbs = (*result.logProbs)[beamIdx];
+            auto const& prevLogProbs = sourceBeam < mLogProbs.size() ? mLogProbs[sourceBeam] : kEmptyLogProbs;
+            auto const logProbPrefixLength = mEnableDelta ? commonPrefixLength(prevLogProbs, logProbs) : 0;
+            beam.logProbPrefixLength = static_cast<SizeType32>(logProbPrefixLength);
+            beam.logProbs.assign(logProbs.begin() + static_cast<std::ptrdiff_t>(logProbPrefixLength), logProbs.end());
+        }
+    }
+
+    if (mEnableDelta)
+    {
+        mTokens = result.outputTokenIds;
+        if (delta.hasLogProbs)
+        {
+            mLogProbs = *result.logProbs;
+        }
+        else
+        {
+            mLogProbs.clear();
+        }
+    }
+    return delta;
+}
+
+texec::Result const& ResultDeltaDecoder::decode(ResultDelta delta)
+{
+    auto const numBeams = delta.beams.size();
+    auto& prevTokens = mResult.outputTokenIds;
+    std::vector<texec::VecLogProbs> noLogProbs;
+    auto& prevLogProbs = mResult.logProbs ? *mResult.logProbs : noLogProbs;
+
+    auto const checkSource = [](BeamDelta const& beam, auto const& prevBeams, std::size_t prefixLength)
+    {
+        auto const numPrevBeams = prevBeams.size();
+        TLLM_CHECK_WITH_INFO(static_cast<std::size_t>(beam.sourceBeam) < numPrevBeams,
+            "Result delta refers to beam %d, only %zu beams are known", beam.sourceBeam, numPrevBeams);
+        auto const sourceLength = prevBeams[beam.sourceBeam].size();
+        TLLM_CHECK_WITH_INFO(prefixLength <= sourceLength,
+            "Result delta keeps %zu elements of a beam holding %zu", prefixLength, sourceLength);
+    };
+
+    bool inPlace = numBeams == prevTokens.size() && (!delta.hasLogProbs || prevLogProbs.size() == numBeams);
+    for (std::size_t beamIdx = 0; inPlace && beamIdx < numBeams; ++beamIdx)
+    {
+        inPlace = static_cast<std::size_t>(delta.beams[beamIdx].sourceBeam) == beamIdx;
+    }
+
+    if (inPlace)
+    {
+        // Common case: every beam extends itself, append without copying the prefixes.
+        for (std::size_t beamIdx = 0; beamIdx < numBeams; ++beamIdx)
+        {
+            auto const& beam = delta.beams[beamIdx];
+            auto const tokenPrefixLength = static_cast<std::size_t>(beam.tokenPrefixLength);
+            checkSource(beam, prevTokens, tokenPrefixLength);
+            prevTokens[beamIdx].resize(tokenPrefixLength);
+            prevTokens[beamIdx].insert(prevTokens[beamIdx].end(), beam.tokens.begin(), beam.tokens.end());
+            if (delta.hasLogProbs)
+            {
+                auto const logProbPrefixLength = static_cast<std::size_t>(beam.logProbPrefixLength);
+                checkSource(beam, prevLogProbs, logProbPrefixLength);
+                prevLogProbs[beamIdx].resize(logProbPrefixLength);
+                prevLogProbs[beamIdx].insert(prevLogProbs[beamIdx].end(), beam.logProbs.begin(), beam.logProbs.end());
+            }
+        }
+        if (delta.hasLogProbs && !mResult.logProbs)
+        {
+            mResult.logProbs = std::move(prevLogProbs);
+        }
+    }
+    else
+    {
+        texec::BeamTokens tokens(numBeams);
+        std::vector<texec::VecLogProbs> logProbs(delta.hasLogProbs ? numBeams : 0);
+        for (std::size_t beamIdx = 0; beamIdx < numBeams; ++beamIdx)
+        {
+            auto& beam = delta.beams[beamIdx];
+            auto const source = static_cast<std::size_t>(beam.sourceBeam);
+            auto const tokenPrefixLength = static_cast<std::size_t>(beam.tokenPrefixLength);
+            if (tokenPrefixLength > 0)
+            {
+                checkSource(beam, prevTokens, tokenPrefixLength);
+                tokens[beamIdx].reserve(tokenPrefixLength + beam.tokens.size());
+                tokens[beamIdx].assign(prevTokens[source].begin(),
+                    prevTokens[source].begin() + static_cast<std::ptrdiff_t>(tokenPrefixLength));
+                tokens[beamIdx].insert(tokens[beamIdx].end(), beam.tokens.begin(), beam.tokens.end());
+            }
+            else
+            {
+                tokens[beamIdx] = std::move(beam.tokens);
+            }
+            if (delta.hasLogProbs)
+            {
+                auto const logProbPrefixLength = static_cast<std::size_t>(beam.logProbPrefixLength);
+                if (logProbPrefixLength > 0)
+                {
+                    checkSource(beam, prevLogProbs, logProbPrefixLength);
+                    logProbs[beamIdx].assign(prevLogProbs[source].begin(),
+                        prevLogProbs[source].begin() + static_cast<std::ptrdiff_t>(logProbPrefixLength));
+                }
+                logProbs[beamIdx].insert(logProbs[beamIdx].end(), beam.logProbs.begin(), beam.logProbs.end());
+            }
+        }
+        mResult.outputTokenIds = std::move(tokens);
+        if (delta.hasLogProbs)
+        {
+            mResult.logProbs = std::move(logProbs);
+        }
+    }
+    if (!delta.hasLogProbs)
+    {
+        mResult.logProbs = std::nullopt;
+    }
+
+    mResult.isFinal = delta.isFinal;
+    mResult.isSequenceFinal = delta.isSequenceFinal;
+    mResult.sequenceIndex = delta.sequenceIndex;
+    mResult.decodingIter = delta.decodingIter;
+    mResult.cumLogProbs = std::move(delta.cumLogProbs);
+    mResult.finishReasons = std::move(delta.finishReasons);
+    mResult.contextLogits = std::move(delta.contextLogits);
+    mResult.generationLogits = std::move(delta.generationLogits);
+    mResult.encoderOutput = std::move(delta.encoderOutput);
+    mResult.contextPhaseParams = std::move(delta.contextPhaseParams);
+    return mResult;
+}
+
+std::vector<char> ResponseDeltaEncoder::encode(std::vector<texec::Response> const& responses)
+{
+    std::vector<ResultDelta> deltas;
+    deltas.reserve(responses.size());
+    std::size_t totalSize = sizeof(std::uint64_t);
+    for (auto const& response : responses)
+    {
+        auto const requestId = response.getRequestId();
+        totalSize += sizeof(texec::IdType) + sizeof(bool);
+        if (response.hasError())
+        {
+            totalSize += sizeof(std::uint64_t) + response.getErrorMsg().size();
+            mEncoders.erase(mEncoders.lower_bound({requestId, std::numeric_limits<SizeType32>::min()}),
+                mEncoders.upper_bound({requestId, std::numeric_limits<SizeType32>::max()}));
+            continue;
+        }
+        auto const& result = response.getResult();
+        Key const key{requestId, result.sequenceIndex};
+        auto it = mEncoders.try_emplace(key, mEnableDelta).first;
+        deltas.push_back(it->second.encode(result));
+        totalSize += deltas.back().serializedSize();
+        if (result.isSequenceFinal || result.isFinal)
+        {
+            mEncoders.erase(it);
+        }
+    }
+
+    std::vector<char> buffer(totalSize);
+    VectorWrapBuf streamBuf(buffer);
+    std::ostream os(&streamBuf);
+    write(os, static_cast<std::uint64_t>(responses.size()));
+    auto delta = deltas.begin();
+    for (auto const& response : responses)
+    {
+        write(os, response.getRequestId());
+        write(os, response.hasError());
+        if (response.hasError())
+        {
+            auto const& errorMsg = response.getErrorMsg();
+            writeVector(os, std::vector<char>(errorMsg.begin(), errorMsg.end()));
+        }
+        else
+        {
+            (delta++)->serialize(os);
+        }
+    }
+    TLLM_CHECK_WITH_INFO(os.good(), "Failed to serialize result deltas");
+    return buffer;
+}
+
+std::vector<texec::Response> ResponseDeltaDecoder::decode(std::vector<char> const& buffer)
+{
+    // The stream buffer only reads from the vector.
+    VectorWrapBuf streamBuf(const_cast<std::vector<char>&>(buffer));
+    std::istream is(&streamBuf);
+
+    auto const numResponses = read<std::uint64_t>(is);
+    std::vector<texec::Response> responses;
+    responses.reserve(numResponses);
+    for (std::uint64_t i = 0; i < numResponses; ++i)
+    {
+        auto const requestId = read<texec::IdType>(is);
+        if (read<bool>(is))
+        {
+            auto const errorMsg = readVector<char>(is);
+            responses.emplace_back(requestId, std::string(errorMsg.begin(), errorMsg.end()));
+            mDecoders.erase(mDecoders.lower_bound({requestId, std::numeric_limits<SizeType32>::min()}),
+                mDecoders.upper_bound({requestId, std::numeric_limits<SizeType32>::max()}));
+            continue;
+        }
+        auto delta = ResultDelta::deserialize(is);
+        Key const key{requestId, delta.sequenceIndex};
+        auto it = mDecoders.try_emplace(key).first;
+        auto const release = delta.isSequenceFinal || delta.isFinal;
+        responses.emplace_back(requestId, it->second.decode(std::move(delta)));
+        if (release)
+        {
+            mDecoders.erase(it);
+        }
+    }
+    return responses;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/rnnStateCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/rnnStateBuffers.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+//! \brief A pool of numEntries states, each holding one slot of every layer of states.
+ITensor::SharedPtr allocatePool(std::vector<ITensor::SharedPtr> const& states, SizeType32 numEntries,
+    BufferManager const& manager, MemoryType memoryType)
+{
+    auto shape = states.front()->getShape();
+    shape.d[0] = static_cast<ITensor::DimType64>(numEntries) * static_cast<ITensor::DimType64>(states.size());
+    return manager.allocate(memoryType, shape, states.front()->getDataType());
+}
+
+} // namespace
+
+RnnStateCache::RnnStateCache(SizeType32 maxNumEntries, SizeType32 checkpointInterval, RnnStateBuffers const& buffers,
+    BufferManager const& manager, MemoryType memoryType)
+    : mManager{manager}
+    , mCheckpointInterval{checkpointInterval}
+    , mNumLayers{static_cast<SizeType32>(buffers.rnnState.size())}
+{
+    TLLM_CHECK_WITH_INFO(maxNumEntries > 0, "The RNN state cache needs at least one entry.");
+    TLLM_CHECK_WITH_INFO(checkpointInterval > 0, "The checkpoint interval must be positive.");
+    TLLM_CHECK_WITH_INFO(buffers.slotMappingHost != nullptr, "The RNN state cache requires paged state.");
+    TLLM_CHECK(mNumLayers > 0 && buffers.convState.size() == buffers.rnnState.size());
+
+    mRnnStatePool = allocatePool(buffers.rnnState, maxNumEntries, manager, memoryType);
+    mConvStatePool = allocatePool(buffers.convState, maxNumEntries, manager, memoryType);
+
+    mEntries.resize(maxNumEntries);
+    mFreeEntries.reserve(maxNumEntries);
+    for (SizeType32 entry = maxNumEntries - 1; entry >= 0; --entry)
+    {
+        mFreeEntries.push_back(entry);
+    }
+    mLookup.reserve(maxNumEntries);
+    TLLM_LOG_INFO("Allocated RNN state cache of %d entries (%zu B), checkpoint every %d tokens", maxNumEntries,
+        mRnnStatePool->getSizeInBytes() + mConvStatePool->getSizeInBytes(), checkpointInterval);
+}
+
+RnnStateCache::StateHash RnnStateCache::hashPrefix(
+    VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId) const
+{
+    StateHash hash = 0;
+    for (SizeType32 begin = 0; begin < numTokens; begin += mCheckpointInterval)
+    {
+        hash = DiskKvCacheTier::hashBlock(
+            hash, tokens.begin() + begin, tokens.begin() + begin + mCheckpointInterval, loraTaskId);
+    }
+    return hash;
+}
+
+std::optional<RnnStateCache::Match> RnnStateCache::find(VecUniqueTokens const& tokens, LoraTaskIdType loraTaskId)
+{
+    auto const hashes = DiskKvCacheTier::hashBlocks(tokens, mCheckpointInterval, loraTaskId);
+    for (auto i = static_cast<SizeType32>(hashes.size()) - 1; i >= 0; --i)
+    {
+        auto const numTokens = (i + 1) * mCheckpointInterval;
+        if (static_cast<std::size_t>(numTokens) >= tokens.size())
+        {
+            continue;
+        }
+        auto const it = mLookup.find(hashes[i]);
+        if (it != mLookup.end() && holdsPrefix(it->second, tokens, numTokens, loraTaskId))
+        {
+            touch(it->second);
+            ++mStats.numHits;
+            return Match{it->second, numTokens};
+        }
+    }
+    ++mStats.numMisses;
+    return std::nullopt;
+}
+
+SizeType32 RnnStateCache::getStateSlot(RnnStateBuffers const& buffers, SizeType32 batchIdx)
+{
+    TLLM_CHECK(buffers.slotMappingHost != nullptr);
+    TLLM_CHECK_WITH_INFO(batchIdx >= 0 && static_cast<std::size_t>(batchIdx) < buffers.slotMappingHost->getSize(),
+        "Batch index %d out of range", batchIdx);
+    auto const slot = bufferCast<SizeType32>(*buffers.slotMappingHost)[batchIdx];
+    TLLM_CHECK_WITH_INFO(slot >= 0 && slot < buffers.rnnState.front()->getShape().d[0],
+        "State slot %d of batch index %d out of range", slot, batchIdx);
+    return slot;
+}
+
+void RnnStateCache::restore(Match const& match, RnnStateBuffers const& buffers, SizeType32 batchIdx)
+{
+    TLLM_CHECK(match.entry >= 0 && match.entry < getMaxNumEntries());
+    TLLM_CHECK_WITH_INFO(mEntries[match.entry].numTokens == match.numTokens, "The state of the match was replaced.");
+    auto const slot = getStateSlot(buffers, batchIdx);
+    for (SizeType32 layer = 0; layer < mNumLayers; ++layer)
+    {
+        auto const poolIdx = match.entry * mNumLayers + layer;
+        mManager.copy(*ITensor::slice(mRnnStatePool, poolIdx, 1), *ITensor::slice(buffers.rnnState[layer], slot, 1));
+        mManager.copy(
+            *ITensor::slice(mConvStatePool, poolIdx, 1), *ITensor::slice(buffers.convState[layer], slot, 1));
+    }
+    mStats.numTokensSaved += match.numTokens;
+}
+
+SizeType32 RnnStateCache::store(VecUniqueTokens const& tokens, SizeType32 numTokens, RnnStateBuffers const& buffers,
+    SizeType32 batchIdx, LoraTaskIdType loraTaskId)
+{
+    TLLM_CHECK_WITH_INFO(numTokens > 0 && numTokens % mCheckpointInterval == 0,
+        "States are stored at multiples of %d tokens, not after %d", mCheckpointInterval, numTokens);
+    TLLM_CHECK(static_cast<std::size_t>(numTokens) <= tokens.size());
+
+    auto const hash = hashPrefix(tokens, numTokens, loraTaskId);
+    if (auto const it = mLookup.find(hash);
+        it != mLookup.end() && holdsPrefix(it->second, tokens, numTokens, loraTaskId))
+    {
+        touch(it->second);
+        return it->second;
+    }
+
+    auto const slot = getStateSlot(buffers, batchIdx);
+    auto const entry = acquireEntry(hash, tokens, numTokens, loraTaskId);
+    for (SizeType32 layer = 0; layer < mNumLayers; ++layer)
+    {
+        auto const poolIdx = entry * mNumLayers + layer;
+        mManager.copy(*ITensor::slice(buffers.rnnState[layer], slot, 1), *ITensor::slice(mRnnStatePool, poolIdx, 1));
+        mManager.copy(
+            *ITensor::slice(buffers.convState[layer], slot, 1), *ITensor::slice(mConvStatePool, poolIdx, 1));
+    }
+    ++mStats.numStores;
+    return entry;
+}
+
+bool RnnStateCache::contains(VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId) const
+{
+    if (numTokens <= 0 || numTokens % mCheckpointInterval != 0 || static_cast<std::size_t>(numTokens) > tokens.size())
+    {
+        return false;
+    }
+    auto const it = mLookup.find(hashPrefix(tokens, numTokens, loraTaskId));
+    return it != mLookup.end() && holdsPrefix(it->second, tokens, numTokens, loraTaskId);
+}
+
+bool RnnStateCache::holdsPrefix(
+    SizeType32 entry, VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId) const
+{
+    auto const& candidate = mEntries[entry];
+    return candidate.numTokens == numTokens && candidate.loraTaskId == loraTaskId
+        && std::equal(candidate.prefix.begin(), candidate.prefix.end(), tokens.begin());
+}
+
+SizeType32 RnnStateCache::acquireEntry(
+    StateHash hash, VecUniqueTokens const& tokens, SizeType32 numTokens, LoraTaskIdType loraTaskId)
+{
+    SizeType32 entry;
+    if (!mFreeEntries.empty())
+    {
+        entry = mFreeEntries.back();
+        mFreeEntries.pop_back();
+    }
+    else
+    {
+        entry = mLruList.back();
+        mLruList.pop_back();
+        if (auto const it = mLookup.find(mEntries[entry].hash); it != mLookup.end() && it->second == entry)
+        {
+            mLookup.erase(it);
+        }
+        ++mStats.numEvictions;
+    }
+    mLruList.push_front(entry);
+    auto& acquired = mEntries[entry];
+    acquired.hash = hash;
+    acquired.numTokens = numTokens;
+    acquired.loraTaskId = loraTaskId;
+    acquired.prefix.assign(tokens.begin(), tokens.begin() + numTokens);
+    acquired.lruIt = mLruList.begin();
+    mLookup.insert_or_assign(hash, entry);
+    return entry;
+}
+
+void RnnStateCache::touch(SizeType32 entry)
+{
+    mLruList.splice(mLruList.begin(), mLruList, mEntries[entry].lruIt);
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/sharedPrefixScheduler.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/hashUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+namespace tb = tensorrt_llm::batch_manager;
+
+namespace
+{
+
+auto constexpr kRoot = std::int64_t{-1};
+
+} // namespace
+
+std::size_t SharedPrefixScheduler::BlockKeyHasher::operator()(BlockKey const& key) const noexcept
+{
+    auto seed = static_cast<std::size_t>(key.parent);
+    common::hashCombine(seed, static_cast<std::size_t>(key.loraTaskId));
+    for (auto const token : key.tokens)
+    {
+        common::hashCombine(seed, static_cast<std::size_t>(token));
+    }
+    return seed;
+}
+
+SizeType32 SharedPrefixScheduler::PrefixTrie::match(VecTokens const& tokens, LoraTaskIdType loraTaskId,
+    SizeType32 numBlocks, SizeType32 tokensPerBlock, SizeType32 minCount) const
+{
+    BlockKey key{kRoot, loraTaskId, {}};
+    for (SizeType32 block = 0; block < numBlocks; ++block)
+    {
+        auto const begin = tokens.begin() + block * tokensPerBlock;
+        key.tokens.assign(begin, begin + tokensPerBlock);
+        auto const it = mNodes.find(key);
+        if (it == mNodes.end() || it->second.count < minCount)
+        {
+            return block;
+        }
+        key.parent = it->second.id;
+    }
+    return numBlocks;
+}
+
+std::vector<SharedPrefixScheduler::BlockKey> SharedPrefixScheduler::PrefixTrie::insert(
+    VecTokens const& tokens, LoraTaskIdType loraTaskId, SizeType32 numBlocks, SizeType32 tokensPerBlock)
+{
+    std::vector<BlockKey> path;
+    path.reserve(numBlocks);
+    auto parent = kRoot;
+    for (SizeType32 block = 0; block < numBlocks; ++block)
+    {
+        auto const begin = tokens.begin() + block * tokensPerBlock;
+        BlockKey key{parent, loraTaskId, VecTokens(begin, begin + tokensPerBlock)};
+        auto [it, inserted] = mNodes.try_emplace(key, Node{mNextId, 0});
+        if (inserted)
+        {
+            ++mNextId;
+        }
+        ++it->second.count;
+        parent = it->second.id;
+        path.push_back(std::move(key));
+    }
+    return path;
+}
+
+void SharedPrefixScheduler::PrefixTrie::release(std::vector<BlockKey> const& path)
+{
+    for (auto const& key : path)
+    {
+        auto const it = mNodes.find(key);
+        TLLM_CHECK(it != mNodes.end() && it->second.count > 0);
+        if (--it->second.count == 0)
+        {
+            mNodes.erase(it);
+        }
+    }
+}
+
+SharedPrefixScheduler::SharedPrefixScheduler(SizeType32 tokensPerBlock, SizeType32 minSharedBlocks)
+    : mTokensPerBlock{tokensPerBlock}
+    , mMinSharedBlocks{minSharedBlocks}
+{
+    TLLM_CHECK(tokensPerBlock > 0);
+    TLLM_CHECK(minSharedBlocks > 0);
+}
+
+SizeType32 SharedPrefixScheduler::getNumShareableBlocks(tb::LlmRequest const& request) const
+{
+    // The block holding the last prompt token is computed by every request, to produce its first token.
+    return std::max(request.mPromptLen - 1, 0) / mTokensPerBlock;
+}
+
+SharedPrefixScheduler::Plan SharedPrefixScheduler::schedule(
+    RequestVector const& pending, ReusableBlocksFunc const& numReusableBlocks)
+{
+    struct Candidate
+    {
+        SizeType32 numBlocks;
+        SizeType32 numReusable;
+        LoraTaskIdType loraTaskId;
+    };
+
+    // Count the pending requests going through each block, to find the prefixes shared in this round.
+    PrefixTrie round;
+    std::vector<Candidate> candidates;
+    candidates.reserve(pending.size());
+    for (auto const& request : pending)
+    {
+        auto const numBlocks = getNumShareableBlocks(*request);
+        auto const numReusable = std::min(numReusableBlocks(*request), numBlocks);
+        auto const loraTaskId = request->getLoraTaskId().value_or(0);
+        candidates.push_back(Candidate{numBlocks, numReusable, loraTaskId});
+        if (numBlocks - numReusable >= mMinSharedBlocks)
+        {
+            round.insert(request->getTokens(0), loraTaskId, numBlocks, mTokensPerBlock);
+        }
+    }
+
+    Plan plan;
+    for (std::size_t i = 0; i < pending.size(); ++i)
+    {
+        auto const& request = pending[i];
+        auto const& candidate = candidates[i];
+        if (candidate.numBlocks - candidate.numReusable < mMinSharedBlocks || isLeader(request->mRequestId))
+        {
+            plan.admitted.push_back(request);
+            continue;
+        }
+
+        auto const& tokens = request->getTokens(0);
+        auto const numInFlight = mInFlight.match(tokens, candidate.loraTaskId, candidate.numBlocks, mTokensPerBlock);
+        if (numInFlight - candidate.numReusable >= mMinSharedBlocks)
+        {
+            ++mStats.numDeferrals;
+            mStats.numDeferredBlocks += numInFlight - candidate.numReusable;
+            plan.deferred.push_back(request);
+            continue;
+        }
+
+        auto const numShared = round.match(tokens, candidate.loraTaskId, candidate.numBlocks, mTokensPerBlock, 2);
+        if (numShared - candidate.numReusable >= mMinSharedBlocks)
+        {
+            TLLM_LOG_DEBUG("Request %lu leads the prefill of %d shared prompt blocks", request->mRequestId,
+                numShared - candidate.numReusable);
+            mLeaders.emplace(request->mRequestId,
+                mInFlight.insert(tokens, candidate.loraTaskId, candidate.numBlocks, mTokensPerBlock));
+            ++mStats.numLeaders;
+        }
+        plan.admitted.push_back(request);
+    }
+    return plan;
+}
+
+void SharedPrefixScheduler::releaseLeader(RequestIdType requestId)
+{
+    auto const it = mLeaders.find(requestId);
+    if (it == mLeaders.end())
+    {
+        return;
+    }
+    mInFlight.release(it->second);
+    mLeaders.erase(it);
+}
@@ -22,7 +22,8 @@ namespace tensorrt_llm::runtime
 template <typename TAllocator>
 typename PoolAllocator<TAllocator>::PoolType& PoolAllocator<TAllocator>::getPool()
 {
-    static PoolType pool;
+    // The node is resolved once, for the device that is current at the first allocation.
+    static PoolType pool{PoolType::kInitialChunkSize, TAllocator{}, NumaTopology::getCurrentDeviceNumaNode()};
     return pool;
 }
 
@@ -21,9 +21,11 @@
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/runtime/cudaMemPool.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/hugePages.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
+#include "tensorrt_llm/runtime/numaTopology.h"
 
 #include <NvInferRuntime.h>
 #include <cuda_runtime_api.h>
@@ -202,6 +204,77 @@ protected:
     }
 };
 
+//! \brief Host memory backed by huge pages, for large pools whose block copies would otherwise miss the TLB.
+class HugePageHostAllocator : public BaseAllocator<HugePageHostAllocator, MemoryType::kCPU>
+{
+    friend class BaseAllocator<HugePageHostAllocator, MemoryType::kCPU>;
+
+public:
+    explicit HugePageHostAllocator(HugePageSize pageSize = HugePageSize::k2MB) noexcept
+        : mPageSize{pageSize}
+    {
+    }
+
+protected:
+    void allocateImpl(PointerType* ptr, std::size_t n)
+    {
+        *ptr = mapHugePages(n, mPageSize).data;
+    }
+
+    void deallocateImpl(PointerType ptr, std::size_t n)
+    {
+        unmapHugePages(ptr, n, mPageSize);
+    }
+
+private:
+    HugePageSize mPageSize;
+};
+
+//! \brief Pinned memory backed by huge pages. Pinning pins one huge page at a time instead of 4 KB pages.
+class HugePagePinnedAllocator : public BaseAllocator<HugePagePinnedAllocator, MemoryType::kPINNED>
+{
+    friend class BaseAllocator<HugePagePinnedAllocator, MemoryType::kPINNED>;
+
+public:
+    using Base = BaseAllocator<HugePagePinnedAllocator, MemoryType::kPINNED>;
+
+    //! \param numaNode Node to place the pages on, e.g. the node of the device they are copied to.
+    explicit HugePagePinnedAllocator(
+        HugePageSize pageSize = HugePageSize::k2MB, std::optional<SizeType32> numaNode = std::nullopt) noexcept
+        : mPageSize{pageSize}
+        , mNumaNode{numaNode}
+    {
+    }
+
+protected:
+    void allocateImpl(PointerType* ptr, std::size_t n)
+    {
+        auto const mapping = mapHugePages(n, mPageSize);
+        // The pages are allocated when they are pinned, so the node must be set before.
+        if (mNumaNode)
+        {
+            bindMemoryToNumaNode(mapping.data, mapping.size, *mNumaNode);
+        }
+        auto const status = ::cudaHostRegister(mapping.data, mapping.size, cudaHostRegisterDefault);
+        if (status != cudaSuccess)
+        {
+            unmapHugePages(mapping.data, n, mPageSize);
+            TLLM_CUDA_CHECK(status);
+        }
+        *ptr = mapping.data;
+    }
+
+    void deallocateImpl(PointerType ptr, std::size_t n)
+    {
+        TLLM_CUDA_CHECK_FREE_RESOURCE(::cudaHostUnregister(ptr));
+        unmapHugePages(ptr, n, mPageSize);
+    }
+
+private:
+    HugePageSize mPageSize;
+    std::optional<SizeType32> mNumaNode;
+};
+
 template <MemoryType memoryType>
 class BorrowingAllocator : public BaseAllocator<BorrowingAllocator<memoryType>, memoryType, false>
 {
@@ -269,9 +342,12 @@ public:
     static std::size_t constexpr kInitialChunkSize{std::size_t{1} << 29}; // 512 MB
     static std::size_t constexpr kAlignment{256};
 
-    explicit MemoryPool(std::size_t chunkSize = kInitialChunkSize, Allocator allocator = Allocator{})
+    //! \param numaNode Node to place the chunks on. Pinned chunks are allocated under the memory policy of this node.
+    explicit MemoryPool(std::size_t chunkSize = kInitialChunkSize, Allocator allocator = Allocator{},
+        std::optional<SizeType32> numaNode = std::nullopt)
         : mChunkSize(chunkSize)
         , mAllocator{allocator}
+        , mNumaNode{numaNode}
     {
     }
 
@@ -359,10 +435,14 @@ private:
 
     std::list<MemorySegment> mMemorySegments = {};
     std::vector<std::tuple<PointerType, std::size_t>> mAllocatedChunks = {};
+    // Last, so that the members above keep their offsets.
+    std::optional<SizeType32> mNumaNode;
 
     void allocateChunk()
     {
         TLLM_LOG_DEBUG("MemoryPool: Allocating %zu B", mChunkSize);
+        // The pages of pinned chunks are allocated by the allocator, under the policy of the calling thread.
+        ScopedNumaMemoryPolicy const memoryPolicy{mNumaNode};
         auto basePointer = mAllocator.allocate(mChunkSize);
         mAllocatedChunks.emplace_back(basePointer, mChunkSize);
         mMemorySegments.push_back(MemorySegment{basePointer, mChunkSize});
@@ -674,6 +754,8 @@ using DeviceBuffer = GenericBuffer<CudaAllocatorAsync>;
 using StaticDeviceBuffer = GenericBuffer<CudaAllocator>;
 using HostBuffer = GenericBuffer<HostAllocator>;
 using PinnedBuffer = GenericBuffer<PinnedAllocator>;
+using HugePageHostBuffer = GenericBuffer<HugePageHostAllocator>;
+using HugePagePinnedBuffer = GenericBuffer<HugePagePinnedAllocator>;
 using PinnedPoolBuffer = GenericBuffer<PinnedPoolAllocator>;
 using UVMBuffer = GenericBuffer<UVMAllocator>;
 
@@ -764,6 +846,8 @@ using DeviceTensor = GenericTensor<CudaAllocatorAsync>;
 using StaticDeviceTensor = GenericTensor<CudaAllocator>;
 using HostTensor = GenericTensor<HostAllocator>;
 using PinnedTensor = GenericTensor<PinnedAllocator>;
+using HugePageHostTensor = GenericTensor<HugePageHostAllocator>;
+using HugePagePinnedTensor = GenericTensor<HugePagePinnedAllocator>;
 using PinnedPoolTensor = GenericTensor<PinnedPoolAllocator>;
 using UVMTensor = GenericTensor<UVMAllocator>;
 
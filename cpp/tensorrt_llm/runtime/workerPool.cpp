@@ -16,6 +16,7 @@
 
 #include "workerPool.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/numaTopology.h"
 
 namespace tensorrt_llm::runtime
 {
@@ -29,6 +30,11 @@ WorkerPool::WorkerPool(std::size_t numWorkers, std::int32_t deviceId)
                 if (deviceId >= 0)
                 {
                     TLLM_CUDA_CHECK(cudaSetDevice(deviceId));
+                    // Run next to the device, so that copies from and to it stay on its socket.
+                    if (auto const& affinity = NumaTopology::getDeviceAffinity(deviceId))
+                    {
+                        bindCurrentThreadToCpus(affinity->cpus);
+                    }
                 }
                 else
                 {
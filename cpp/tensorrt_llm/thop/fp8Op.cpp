@@ -61,8 +61,39 @@ std::vector<Tensor> e4m3_quantize_helper(Tensor input, QuantizeMode quantize_mod
         scale_shape.assign(input.dim(), 1);
     }
 
-    auto const is_cuda = input.is_cuda();
-    input = input.cuda();
+    if (!input.is_cuda())
+    {
+        // Quantize on the host, on torch's intra-op threads, instead of taking the tensor through the device.
+        Tensor quantized_input
+            = torch::empty(quantized_input_shape, torch::dtype(torch::kInt8).device(torch::kCPU).requires_grad(false));
+        Tensor scales = torch::empty(scale_shape, torch::dtype(input.dtype()).device(torch::kCPU).requires_grad(false));
+        auto quantized_input_ptr = reinterpret_cast<__nv_fp8_e4m3*>(get_ptr<int8_t>(quantized_input));
+        auto const num_threads = at::get_num_threads();
+
+        if (input.scalar_type() == at::ScalarType::Float)
+        {
+            computeScalesAndQuantizeMatrixHost(quantized_input_ptr, get_ptr<float>(scales),
+                get_ptr<float const>(input), input.numel(), input.size(-1), quantize_mode, num_threads);
+        }
+        else if (input.scalar_type() == at::ScalarType::Half)
+        {
+            computeScalesAndQuantizeMatrixHost(quantized_input_ptr, get_ptr<half>(scales), get_ptr<half const>(input),
+                input.numel(), input.size(-1), quantize_mode, num_threads);
+        }
+#ifdef ENABLE_BF16
+        else if (input.scalar_type() == at::ScalarType::BFloat16)
+        {
+            computeScalesAndQuantizeMatrixHost(quantized_input_ptr, get_ptr<__nv_bfloat16>(scales),
+                get_ptr<__nv_bfloat16 const>(input), input.numel(), input.size(-1), quantize_mode, num_threads);
+        }
+#endif
+        else
+        {
+            TORCH_CHECK(false, "Invalid datatype. input must be BF16/FP16/FP32");
+        }
+
+        return std::vector<Tensor>{quantized_input, scales};
+    }
 
     Tensor quantized_input
         = torch::empty(quantized_input_shape, torch::dtype(torch::kInt8).device(torch::kCUDA).requires_grad(false));
@@ -95,12 +126,6 @@ std::vector<Tensor> e4m3_quantize_helper(Tensor input, QuantizeMode quantize_mod
         TORCH_CHECK(false, "Invalid datatype. input must be BF16/FP16/FP32");
     }
 
-    if (!is_cuda)
-    {
-        quantized_input = quantized_input.cpu();
-        scales = scales.cpu();
-    }
-
     return std::vector<Tensor>{quantized_input, scales};
 }
 
@@ -136,8 +161,39 @@ Tensor e4m3_dequantize_helper(Tensor input, Tensor scales, QuantizeMode quantize
             TORCH_CHECK(scales.size(i) == 1);
     }
 
-    auto const w_is_cuda = input.is_cuda();
-    input = input.cuda();
+    if (!input.is_cuda())
+    {
+        scales = scales.cpu();
+        Tensor dequantized_input = torch::empty(
+            dequantized_input_shape, torch::dtype(scales.dtype()).device(torch::kCPU).requires_grad(false));
+        auto input_ptr = reinterpret_cast<__nv_fp8_e4m3*>(get_ptr<int8_t>(input));
+        auto const num_threads = at::get_num_threads();
+
+        if (scales.scalar_type() == at::ScalarType::Float)
+        {
+            dequantizeMatrixHost(get_ptr<float>(dequantized_input), get_ptr<float>(scales), input_ptr, input.numel(),
+                input.size(-1), quantize_mode, num_threads);
+        }
+        else if (scales.scalar_type() == at::ScalarType::Half)
+        {
+            dequantizeMatrixHost(get_ptr<half>(dequantized_input), get_ptr<half>(scales), input_ptr, input.numel(),
+                input.size(-1), quantize_mode, num_threads);
+        }
+#ifdef ENABLE_BF16
+        else if (scales.scalar_type() == at::ScalarType::BFloat16)
+        {
+            dequantizeMatrixHost(get_ptr<__nv_bfloat16>(dequantized_input), get_ptr<__nv_bfloat16>(scales),
+                input_ptr, input.numel(), input.size(-1), quantize_mode, num_threads);
+        }
+#endif
+        else
+        {
+            TORCH_CHECK(false, "Invalid datatype. input must be BF16/FP16/FP32");
+        }
+
+        return dequantized_input;
+    }
+
     scales = scales.cuda();
 
     Tensor dequantized_input
@@ -169,9 +225,6 @@ Tensor e4m3_dequantize_helper(Tensor input, Tensor scales, QuantizeMode quantize
         TORCH_CHECK(false, "Invalid datatype. input must be BF16/FP16/FP32");
     }
 
-    if (!w_is_cuda)
-        dequantized_input = dequantized_input.cpu();
-
     return dequantized_input;
 }
 
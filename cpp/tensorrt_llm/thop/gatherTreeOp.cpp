@@ -15,6 +15,7 @@
  */
 
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/beamSearchHost.h"
 #include "tensorrt_llm/kernels/beamSearchKernels.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
@@ -53,14 +54,47 @@ th::Tensor gatherTree(                                    // BS: batch_size, BM:
     bool const use_beam_hyps                              //
 )
 {
-    auto stream = at::cuda::getCurrentCUDAStream().stream();
-    th::Tensor final_output_ids = torch::zeros(
-        {batch_size, beam_width, max_seq_len}, torch::dtype(torch::kInt32).device(torch::kCUDA).requires_grad(false));
+    // Outputs already copied back to the host are finalized on the host, which reads every other tensor there too.
+    bool const on_host = !output_ids.is_cuda();
+    auto const device = output_ids.device();
+    auto const check_device = [&device](th::optional<th::Tensor> const& tensor, char const* name)
+    {
+        TORCH_CHECK(!tensor.has_value() || tensor->device() == device, name, " is on ", tensor->device(),
+            " but output_ids is on ", device);
+    };
+    check_device(sequence_lengths, "sequence_lengths");
+    check_device(parent_ids, "parent_ids");
+    check_device(end_ids, "end_ids");
+    check_device(tiled_input_lengths, "tiled_input_lengths");
+    check_device(cum_log_probs_opt, "cum_log_probs");
+    check_device(log_probs_opt, "log_probs");
+    check_device(log_probs_tiled_opt, "log_probs_tiled");
+    check_device(beam_hyps_output_ids_cba, "beam_hyps_output_ids_cba");
+    check_device(beam_hyps_seq_len_cba, "beam_hyps_seq_len_cba");
+    check_device(beam_hyps_cum_log_probs_cba, "beam_hyps_cum_log_probs_cba");
+    check_device(beam_hyps_normed_scores_cba, "beam_hyps_normed_scores_cba");
+    check_device(beam_hyps_log_probs_cba, "beam_hyps_log_probs_cba");
+    check_device(beam_hyps_min_normed_scores, "beam_hyps_min_normed_scores");
+    check_device(beam_hyps_num_beams, "beam_hyps_num_beams");
+    check_device(beam_hyps_is_done, "beam_hyps_is_done");
+    check_device(finished, "finished");
+    check_device(length_penalty, "length_penalty");
+    cudaStream_t stream = on_host ? nullptr : at::cuda::getCurrentCUDAStream().stream();
+    th::Tensor final_output_ids = torch::zeros({batch_size, beam_width, max_seq_len},
+        torch::dtype(torch::kInt32).device(device).requires_grad(false));
     if (use_beam_hyps && beam_width > 1)
     {
         int32_t* final_output_ids_ptr = get_ptr<int32_t>(final_output_ids);
-        tk::invokeInitializeOutput(
-            final_output_ids_ptr, get_ptr<int32_t>(end_ids), batch_size * beam_width, max_seq_len, stream);
+        if (on_host)
+        {
+            tk::initializeOutputHost(
+                final_output_ids_ptr, get_ptr<int32_t>(end_ids), batch_size * beam_width, max_seq_len);
+        }
+        else
+        {
+            tk::invokeInitializeOutput(
+                final_output_ids_ptr, get_ptr<int32_t>(end_ids), batch_size * beam_width, max_seq_len, stream);
+        }
 
         tk::BeamHypotheses bh;
         bh.nBatchSize = batch_size;
@@ -86,20 +120,31 @@ th::Tensor gatherTree(                                    // BS: batch_size, BM:
         bh.outputIdsUnfinish = get_ptr<int32_t>(output_ids);
         bh.parentIdsUnfinish = get_ptr<int32_t>(parent_ids);
 
-        tk::invokeInsertUnfinishedPath(bh, stream);
-        sync_check_cuda_error();
+        if (on_host)
+        {
+            tk::insertUnfinishedPathHost(bh);
+            tk::finalizeHost(bh);
+        }
+        else
+        {
+            tk::invokeInsertUnfinishedPath(bh, stream);
+            sync_check_cuda_error();
 
-        tk::invokeFinalize(bh, stream);
-        sync_check_cuda_error();
+            tk::invokeFinalize(bh, stream);
+            sync_check_cuda_error();
+        }
     }
     else if (!use_beam_hyps && beam_width > 1)
     {
-        th::Tensor workspace = torch::zeros(batch_size * beam_width * max_seq_len * sizeof(int32_t),
-            torch::dtype(torch::kInt8).device(torch::kCUDA).requires_grad(false));
-
         // For sampling, it is equivalent to all parent ids are 0.
         tk::gatherTreeParam param;
-        param.beams = get_ptr<int32_t>(workspace);
+        th::Tensor workspace;
+        if (!on_host)
+        {
+            workspace = torch::zeros(batch_size * beam_width * max_seq_len * sizeof(int32_t),
+                torch::dtype(torch::kInt8).device(torch::kCUDA).requires_grad(false));
+            param.beams = get_ptr<int32_t>(workspace);
+        }
         // Remove prompt length if possible
         param.sequenceLengths = get_ptr<int32_t>(sequence_lengths);
         // add sequence_length 1 here because the sequence_length of time step t is t - 1
@@ -121,8 +166,19 @@ th::Tensor gatherTree(                                    // BS: batch_size, BM:
         param.lengthPenalty = get_val<float>(length_penalty, 0);
 
         // NOTE: need to remove all prompt virtual tokens
-        tk::invokeGatherTree(param);
-        sync_check_cuda_error();
+        if (on_host)
+        {
+            tk::gatherTreeHost(param);
+        }
+        else
+        {
+            tk::invokeGatherTree(param);
+            sync_check_cuda_error();
+        }
+    }
+    else if (on_host)
+    {
+        final_output_ids.copy_(output_ids);
     }
     else
     {
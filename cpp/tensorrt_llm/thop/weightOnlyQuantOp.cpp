@@ -28,6 +28,9 @@ namespace torch_ext
 using torch::Tensor;
 using namespace tensorrt_llm::kernels::cutlass_kernels;
 
+// Packed bytes per task when (un)packing int4 tensors on torch's intra-op threads.
+constexpr int64_t kPackGrainSize = 1 << 16;
+
 void check_quant_type_allowed(torch::ScalarType quant_type)
 {
 #ifdef TORCH_IS_AT_LEAST_v190
@@ -114,7 +117,8 @@ Tensor subbyte_transpose(Tensor quantized_tensor, torch::ScalarType quant_type)
     int8_t* input_byte_ptr = get_ptr<int8_t>(quantized_tensor);
     int8_t* output_byte_ptr = get_ptr<int8_t>(transposed_tensor);
 
-    subbyte_transpose(output_byte_ptr, input_byte_ptr, {num_experts, num_rows, num_cols}, ft_quant_type);
+    subbyte_transpose(
+        output_byte_ptr, input_byte_ptr, {num_experts, num_rows, num_cols}, ft_quant_type, at::get_num_threads());
     return transposed_tensor;
 }
 
@@ -144,8 +148,9 @@ Tensor preprocess_weights_for_mixed_gemm(
 
     bool force_interleave = row_major_quantized_weight.dim() == 3; // WAR for MoE 3-D tensors.
 
-    preprocess_weights_for_mixed_gemm(
-        output_byte_ptr, input_byte_ptr, {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave);
+    // The host passes run on as many threads as torch's intra-op parallelism allows.
+    preprocess_weights_for_mixed_gemm(output_byte_ptr, input_byte_ptr, {num_experts, num_rows, num_cols},
+        ft_quant_type, force_interleave, at::get_num_threads());
 
     return processed_tensor;
 }
@@ -203,25 +208,26 @@ std::vector<Tensor> symmetric_quantize_helper(
 
     // TODO(dastokes) This should be removed if Grouped GEMM is updated to not need interleaved input
     bool force_interleave = weight.dim() == 3;
+    auto const num_threads = at::get_num_threads();
 
     if (weight.scalar_type() == at::ScalarType::Float)
     {
         symmetric_quantize<float, float>(processed_quantized_weight_ptr, unprocessed_quantized_weight_ptr,
             get_ptr<float>(scales), get_ptr<float const>(weight), {num_experts, num_rows, num_cols}, ft_quant_type,
-            force_interleave);
+            force_interleave, num_threads);
     }
     else if (weight.scalar_type() == at::ScalarType::Half)
     {
         symmetric_quantize<half, half>(processed_quantized_weight_ptr, unprocessed_quantized_weight_ptr,
             get_ptr<half>(scales), get_ptr<half const>(weight), {num_experts, num_rows, num_cols}, ft_quant_type,
-            force_interleave);
+            force_interleave, num_threads);
     }
 #ifdef ENABLE_BF16
     else if (weight.scalar_type() == at::ScalarType::BFloat16)
     {
         symmetric_quantize<__nv_bfloat16, __nv_bfloat16>(processed_quantized_weight_ptr,
             unprocessed_quantized_weight_ptr, get_ptr<__nv_bfloat16>(scales), get_ptr<__nv_bfloat16 const>(weight),
-            {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave);
+            {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave, num_threads);
     }
 #endif
     else
@@ -301,16 +307,20 @@ Tensor unpack_int4_packed_tensor_to_int8(Tensor weight)
     int8_t* packed_ptr = get_ptr<int8_t>(weight);
     int8_t* unpacked_ptr = get_ptr<int8_t>(unpacked_weight);
 
-    for (size_t packed_idx = 0; packed_idx < weight.numel(); ++packed_idx)
-    {
-        int8_t packed_data = packed_ptr[packed_idx];
+    at::parallel_for(0, weight.numel(), kPackGrainSize,
+        [&](int64_t begin, int64_t end)
+        {
+            for (int64_t packed_idx = begin; packed_idx < end; ++packed_idx)
+            {
+                int8_t packed_data = packed_ptr[packed_idx];
 
-        int8_t elt_0 = (int8_t(packed_data << 4) >> 4); // The double shift here is to ensure sign extension
-        int8_t elt_1 = packed_data >> 4;
+                int8_t elt_0 = (int8_t(packed_data << 4) >> 4); // The double shift here is to ensure sign extension
+                int8_t elt_1 = packed_data >> 4;
 
-        unpacked_ptr[2 * packed_idx + 0] = elt_0;
-        unpacked_ptr[2 * packed_idx + 1] = elt_1;
-    }
+                unpacked_ptr[2 * packed_idx + 0] = elt_0;
+                unpacked_ptr[2 * packed_idx + 1] = elt_1;
+            }
+        });
 
     return unpacked_weight;
 }
@@ -335,20 +345,24 @@ Tensor pack_int8_tensor_to_packed_int4(Tensor weight)
     int8_t* unpacked_ptr = get_ptr<int8_t>(weight);
     int8_t* packed_ptr = get_ptr<int8_t>(packed_weight);
 
-    for (size_t packed_idx = 0; packed_idx < packed_weight.numel(); ++packed_idx)
-    {
-        int8_t packed_int4s = 0;
-        int8_t elt_0 = unpacked_ptr[2 * packed_idx + 0];
-        int8_t elt_1 = unpacked_ptr[2 * packed_idx + 1];
+    at::parallel_for(0, packed_weight.numel(), kPackGrainSize,
+        [&](int64_t begin, int64_t end)
+        {
+            for (int64_t packed_idx = begin; packed_idx < end; ++packed_idx)
+            {
+                int8_t packed_int4s = 0;
+                int8_t elt_0 = unpacked_ptr[2 * packed_idx + 0];
+                int8_t elt_1 = unpacked_ptr[2 * packed_idx + 1];
 
-        TORCH_CHECK(elt_0 >= -8 && elt_0 <= 7, "Value in unpacked tensor not in int4 range");
-        TORCH_CHECK(elt_1 >= -8 && elt_1 <= 7, "Value in unpacked tensor not in int4 range");
+                TORCH_CHECK(elt_0 >= -8 && elt_0 <= 7, "Value in unpacked tensor not in int4 range");
+                TORCH_CHECK(elt_1 >= -8 && elt_1 <= 7, "Value in unpacked tensor not in int4 range");
 
-        packed_int4s |= ((elt_0 & 0x0F));
-        packed_int4s |= int8_t(elt_1 << 4);
+                packed_int4s |= ((elt_0 & 0x0F));
+                packed_int4s |= int8_t(elt_1 << 4);
 
-        packed_ptr[packed_idx] = packed_int4s;
-    }
+                packed_ptr[packed_idx] = packed_int4s;
+            }
+        });
     return packed_weight;
 }
 
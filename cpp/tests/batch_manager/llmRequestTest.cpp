@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+namespace tb = tensorrt_llm::batch_manager;
+namespace texec = tensorrt_llm::executor;
+namespace tr = tensorrt_llm::runtime;
+
+namespace
+{
+
+texec::VecTokens makePrompt(std::size_t length)
+{
+    texec::VecTokens prompt(length);
+    std::iota(prompt.begin(), prompt.end(), 100);
+    return prompt;
+}
+
+texec::Request makeRequest(texec::VecTokens prompt, texec::SizeType32 beamWidth)
+{
+    return texec::Request{std::move(prompt), 8, false, texec::SamplingConfig{beamWidth}};
+}
+
+void expectPromptInEveryBeam(
+    tb::GenericLlmRequest<tr::ITensor::SharedPtr> const& llmRequest, texec::VecTokens const& prompt, int beamWidth)
+{
+    tr::VecUniqueTokens uniquePrompt;
+    for (auto const token : prompt)
+    {
+        uniquePrompt.push_back({token, 0});
+    }
+
+    EXPECT_EQ(llmRequest.mPromptLen, static_cast<texec::SizeType32>(prompt.size()));
+    ASSERT_EQ(llmRequest.getTokens().size(), static_cast<std::size_t>(beamWidth));
+    ASSERT_EQ(llmRequest.getUniqueTokens().size(), static_cast<std::size_t>(beamWidth));
+    for (int beam = 0; beam < beamWidth; ++beam)
+    {
+        EXPECT_EQ(llmRequest.getTokens(beam), prompt) << "beam " << beam;
+        EXPECT_EQ(llmRequest.getUniqueTokens(beam), uniquePrompt) << "beam " << beam;
+    }
+}
+
+class LlmRequestTest : public ::testing::TestWithParam<int>
+{
+};
+
+} // namespace
+
+TEST_P(LlmRequestTest, promptInEveryBeam)
+{
+    auto const beamWidth = GetParam();
+    auto const prompt = makePrompt(37);
+    auto const request = makeRequest(prompt, beamWidth);
+
+    tb::LlmRequest llmRequest(1, request);
+
+    expectPromptInEveryBeam(llmRequest, prompt, beamWidth);
+    EXPECT_EQ(request.getInputTokenIds(), prompt);
+}
+
+TEST_P(LlmRequestTest, movedPromptInEveryBeam)
+{
+    auto const beamWidth = GetParam();
+    auto const prompt = makePrompt(37);
+    auto const request = makeRequest(prompt, beamWidth);
+
+    auto inputTokens = request.getInputTokenIds();
+    tb::GenericLlmRequest<tr::ITensor::SharedPtr> llmRequest(1, request, std::move(inputTokens));
+
+    expectPromptInEveryBeam(llmRequest, prompt, beamWidth);
+    EXPECT_EQ(request.getInputTokenIds(), prompt);
+}
+
+INSTANTIATE_TEST_SUITE_P(BeamWidths, LlmRequestTest, ::testing::Values(1, 2, 4));
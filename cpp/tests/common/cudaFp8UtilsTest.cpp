@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cudaFp8Utils.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#ifdef ENABLE_FP8
+
+namespace tc = tensorrt_llm::common;
+namespace tr = tensorrt_llm::runtime;
+
+namespace
+{
+
+std::vector<float> makeInput(std::int64_t numRows, std::int64_t numCols)
+{
+    std::mt19937 generator{42};
+    std::normal_distribution<float> distribution{0.F, 2.F};
+    std::vector<float> input(numRows * numCols);
+    for (auto& value : input)
+    {
+        value = distribution(generator);
+    }
+    // An all-zero row and a row of subnormal E4M3 values after scaling.
+    std::fill_n(input.begin(), numCols, 0.F);
+    for (std::int64_t i = 0; i < numCols; ++i)
+    {
+        input[numCols + i] = (i % 7 == 0) ? 448.F : 1e-3F * static_cast<float>(i % 13);
+    }
+    return input;
+}
+
+std::vector<std::uint8_t> toBytes(std::vector<__nv_fp8_e4m3> const& values)
+{
+    std::vector<std::uint8_t> bytes(values.size());
+    std::memcpy(bytes.data(), values.data(), values.size());
+    return bytes;
+}
+
+} // namespace
+
+class Fp8HostQuantizationTest : public ::testing::TestWithParam<tc::QuantizeMode>
+{
+};
+
+TEST_P(Fp8HostQuantizationTest, MatchesDevice)
+{
+    if (tc::getDeviceCount() <= 0)
+    {
+        GTEST_SKIP() << "The host quantization is compared against the device kernels.";
+    }
+    auto const mode = GetParam();
+    std::int64_t constexpr numRows = 67;
+    std::int64_t constexpr numCols = 1000;
+    auto const numel = numRows * numCols;
+    auto const numScales = mode == tc::QuantizeMode::PER_TOKEN ? numRows
+        : mode == tc::QuantizeMode::PER_CHANNEL                ? numCols
+                                                               : 1;
+    auto const input = makeInput(numRows, numCols);
+
+    std::vector<__nv_fp8_e4m3> hostOutput(numel);
+    std::vector<float> hostScales(numScales);
+    tc::computeScalesAndQuantizeMatrixHost(
+        hostOutput.data(), hostScales.data(), input.data(), numel, numCols, mode, /*num_threads=*/4);
+
+    tr::BufferManager manager{std::make_shared<tr::CudaStream>()};
+    auto const deviceInput = manager.copyFrom(input, tr::ITensor::makeShape({numRows, numCols}), tr::MemoryType::kGPU);
+    auto deviceOutput = manager.gpu(tr::ITensor::makeShape({numRows, numCols}), nvinfer1::DataType::kFP8);
+    auto deviceScales = manager.gpu(tr::ITensor::makeShape({numScales}), nvinfer1::DataType::kFLOAT);
+    tc::invokeComputeScalesAndQuantizeMatrix(reinterpret_cast<__nv_fp8_e4m3*>(deviceOutput->data()),
+        tr::bufferCast<float>(*deviceScales), tr::bufferCast<float>(*deviceInput), numel, numCols, mode,
+        manager.getStream().get());
+    std::vector<__nv_fp8_e4m3> output(numel);
+    std::vector<float> scales(numScales);
+    manager.copy(*deviceOutput, output.data());
+    manager.copy(*deviceScales, scales.data());
+    manager.getStream().synchronize();
+
+    EXPECT_EQ(hostScales, scales);
+    EXPECT_EQ(toBytes(hostOutput), toBytes(output));
+
+    // Dequantization only scales, so it must match as well.
+    std::vector<float> hostDequantized(numel);
+    tc::dequantizeMatrixHost(
+        hostDequantized.data(), hostScales.data(), hostOutput.data(), numel, numCols, mode, /*num_threads=*/3);
+    auto deviceDequantized = manager.gpu(tr::ITensor::makeShape({numRows, numCols}), nvinfer1::DataType::kFLOAT);
+    tc::invokeDequantizeMatrix(tr::bufferCast<float>(*deviceDequantized), tr::bufferCast<float>(*deviceScales),
+        reinterpret_cast<__nv_fp8_e4m3 const*>(deviceOutput->data()), numel, numCols, mode,
+        manager.getStream().get());
+    std::vector<float> dequantized(numel);
+    manager.copy(*deviceDequantized, dequantized.data());
+    manager.getStream().synchronize();
+    EXPECT_EQ(hostDequantized, dequantized);
+}
+
+TEST_P(Fp8HostQuantizationTest, IndependentOfThreads)
+{
+    auto const mode = GetParam();
+    std::int64_t constexpr numRows = 300;
+    std::int64_t constexpr numCols = 512;
+    auto const numel = numRows * numCols;
+    auto const input = makeInput(numRows, numCols);
+
+    std::vector<__nv_fp8_e4m3> expected(numel);
+    std::vector<float> expectedScales(numRows * numCols);
+    tc::computeScalesAndQuantizeMatrixHost(
+        expected.data(), expectedScales.data(), input.data(), numel, numCols, mode, /*num_threads=*/1);
+    for (int numThreads : {2, 7, 64})
+    {
+        std::vector<__nv_fp8_e4m3> output(numel);
+        std::vector<float> scales(numRows * numCols);
+        tc::computeScalesAndQuantizeMatrixHost(
+            output.data(), scales.data(), input.data(), numel, numCols, mode, numThreads);
+        EXPECT_EQ(toBytes(output), toBytes(expected)) << numThreads << " threads";
+        EXPECT_EQ(scales, expectedScales) << numThreads << " threads";
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(QuantizeModes, Fp8HostQuantizationTest,
+    ::testing::Values(tc::QuantizeMode::PER_TENSOR, tc::QuantizeMode::PER_TOKEN, tc::QuantizeMode::PER_CHANNEL));
+
+#endif // ENABLE_FP8
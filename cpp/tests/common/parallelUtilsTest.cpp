@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/parallelUtils.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace tc = tensorrt_llm::common;
+
+TEST(ParallelUtilsTest, everyItemOnce)
+{
+    for (std::size_t const numItems : {0, 1, 7, 1000, 100003})
+    {
+        for (std::size_t const numThreads : {0, 1, 3, 64})
+        {
+            std::vector<int> counts(numItems, 0);
+            tc::parallelFor(
+                numItems, 16,
+                [&](std::size_t begin, std::size_t end)
+                {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        ++counts[i];
+                    }
+                },
+                numThreads);
+            EXPECT_EQ(counts, std::vector<int>(numItems, 1)) << numItems << " items, " << numThreads << " threads";
+        }
+    }
+}
+
+TEST(ParallelUtilsTest, threadLimit)
+{
+    std::mutex mutex;
+    std::set<std::thread::id> threadIds;
+    std::size_t numRanges = 0;
+    tc::parallelFor(
+        1000, 1,
+        [&](std::size_t, std::size_t)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            threadIds.insert(std::this_thread::get_id());
+            ++numRanges;
+        },
+        2);
+    EXPECT_EQ(numRanges, 2);
+    EXPECT_LE(threadIds.size(), 2);
+}
+
+TEST(ParallelUtilsTest, rethrowsFromWorkers)
+{
+    auto const numRanges = std::max(std::thread::hardware_concurrency(), 2u);
+    std::atomic<std::size_t> numCalls{0};
+    // Every range but the first throws, so the exception comes from a range the calling thread may not have run.
+    EXPECT_THROW(tc::parallelFor(
+                     numRanges, 1,
+                     [&](std::size_t begin, std::size_t)
+                     {
+                         ++numCalls;
+                         if (begin > 0)
+                         {
+                             throw std::runtime_error("range failed");
+                         }
+                     },
+                     numRanges),
+        std::runtime_error);
+    // The remaining ranges still ran, and the workers are usable afterwards.
+    EXPECT_EQ(numCalls.load(), numRanges);
+
+    std::atomic<std::size_t> numItems{0};
+    tc::parallelFor(
+        numRanges, 1, [&](std::size_t begin, std::size_t end) { numItems += end - begin; }, numRanges);
+    EXPECT_EQ(numItems.load(), numRanges);
+}
+
+TEST(ParallelUtilsTest, nested)
+{
+    std::size_t constexpr numOuter = 64;
+    std::size_t constexpr numInner = 1000;
+    std::vector<std::atomic<std::size_t>> sums(numOuter);
+    tc::parallelFor(numOuter, 1,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (auto outer = begin; outer < end; ++outer)
+            {
+                tc::parallelFor(numInner, 1,
+                    [&](std::size_t innerBegin, std::size_t innerEnd) { sums[outer] += innerEnd - innerBegin; });
+            }
+        });
+    for (auto const& sum : sums)
+    {
+        EXPECT_EQ(sum.load(), numInner);
+    }
+}
+
+TEST(ParallelUtilsTest, concurrentCallers)
+{
+    int constexpr numCallers = 4;
+    std::size_t constexpr numItems = 10000;
+    std::vector<std::size_t> sums(numCallers, 0);
+    std::vector<std::thread> callers;
+    for (int c = 0; c < numCallers; ++c)
+    {
+        callers.emplace_back(
+            [&, c]
+            {
+                for (int repeat = 0; repeat < 100; ++repeat)
+                {
+                    std::atomic<std::size_t> sum{0};
+                    tc::parallelFor(numItems, 64, [&](std::size_t begin, std::size_t end) { sum += end - begin; });
+                    sums[c] += sum.load();
+                }
+            });
+    }
+    for (auto& caller : callers)
+    {
+        caller.join();
+    }
+    EXPECT_EQ(sums, std::vector<std::size_t>(numCallers, 100 * numItems));
+}
@@ -21,6 +21,7 @@
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/tllmException.h"
 
+#include <array>
 #include <string>
 
 using ::testing::HasSubstr;
@@ -64,3 +65,75 @@ TEST(TllmException, Logger)
 #endif
     }
 }
+
+TEST(TllmException, LazyTrace)
+{
+    auto const ex = NEW_TLLM_EXCEPTION("TestException %d", 2);
+    std::string const message{ex.getMessage()};
+    EXPECT_THAT(message, HasSubstr("TestException 2"));
+    EXPECT_THAT(message, HasSubstr(__FILE__));
+    EXPECT_EQ(ex.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kUNKNOWN);
+
+    // A copy symbolizes the same frames, and the first symbolization is kept.
+    auto const copy = ex;
+    std::string const trace = copy.getTrace();
+    std::string const what{ex.what()};
+    EXPECT_EQ(what, message + "\n" + trace);
+    EXPECT_EQ(std::string{copy.what()}, what);
+    EXPECT_EQ(ex.what(), ex.what());
+#if !defined(_MSC_VER)
+    EXPECT_THAT(trace, HasSubstr("main"));
+    EXPECT_THAT(message, ::testing::Not(HasSubstr("main")));
+#endif
+}
+
+TEST(TllmException, ExpectedError)
+{
+    try
+    {
+        throw NEW_TLLM_EXPECTED_EXCEPTION(
+            tensorrt_llm::common::TllmErrorCode::kINVALID_ARGUMENT, "Invalid request %d", 3);
+    }
+    catch (tensorrt_llm::common::TllmException const& e)
+    {
+        EXPECT_EQ(e.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kINVALID_ARGUMENT);
+        EXPECT_TRUE(e.getTrace().empty());
+        std::string const what{e.what()};
+        EXPECT_EQ(what, e.getMessage());
+        EXPECT_THAT(what, HasSubstr("Invalid request 3"));
+        EXPECT_THAT(what, HasSubstr(__FILE__));
+
+        // The error code is kept outside the exception, copies carry it.
+        auto const copy = e;
+        EXPECT_EQ(copy.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kINVALID_ARGUMENT);
+    }
+}
+
+TEST(TllmException, AssignedTrace)
+{
+    auto ex = NEW_TLLM_EXCEPTION("TestException %d", 4);
+    EXPECT_THAT(ex.what(), HasSubstr("TestException 4"));
+    ex = NEW_TLLM_EXCEPTION("TestException %d", 5);
+    std::string const what{ex.what()};
+    EXPECT_THAT(what, HasSubstr("TestException 5"));
+    EXPECT_THAT(what, ::testing::Not(HasSubstr("TestException 4")));
+    ex = NEW_TLLM_EXPECTED_EXCEPTION(tensorrt_llm::common::TllmErrorCode::kCANCELLED, "TestException %d", 6);
+    EXPECT_EQ(std::string{ex.what()}, ex.getMessage());
+    EXPECT_EQ(ex.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kCANCELLED);
+    ex = NEW_TLLM_EXCEPTION("TestException %d", 7);
+    EXPECT_EQ(ex.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kUNKNOWN);
+}
+
+TEST(TllmException, Layout)
+{
+    // Prebuilt libraries construct and copy the exception with these members.
+    struct PrebuiltLayout : std::runtime_error
+    {
+        std::array<void*, tensorrt_llm::common::TllmException::MAX_FRAMES> callstack;
+        int nbFrames;
+    };
+
+    static_assert(sizeof(tensorrt_llm::common::TllmException) == sizeof(PrebuiltLayout));
+    tensorrt_llm::common::TllmException const ex{__FILE__, __LINE__, "TestException"};
+    EXPECT_EQ(ex.getErrorCode(), tensorrt_llm::common::TllmErrorCode::kUNKNOWN);
+}
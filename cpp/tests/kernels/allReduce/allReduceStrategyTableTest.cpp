@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/kernels/customAllReduceStrategyTable.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using tensorrt_llm::kernels::AllReduceStrategyTable;
+using tensorrt_llm::kernels::AllReduceStrategyType;
+
+namespace
+{
+
+auto constexpr kUnsupported = std::numeric_limits<float>::infinity();
+auto constexpr kHalf = nvinfer1::DataType::kHALF;
+
+//! \brief Synthetic latency curves of a system whose one-shot kernel wins for small messages, the two-shot kernel for
+//! medium ones and NCCL beyond the 8 MB workspace of the custom kernels.
+AllReduceStrategyTable::Latencies syntheticLatencies(std::size_t bytes)
+{
+    auto const transferUs = static_cast<float>(bytes) / 5e3f;
+    auto const custom = bytes <= (std::size_t{8} << 20);
+    return {20.f + 1.75f * transferUs, custom ? 4.f + 3.f * transferUs : kUnsupported,
+        custom ? 10.f + 1.75f * transferUs : kUnsupported};
+}
+
+AllReduceStrategyTable makeTable(int worldSize = 4)
+{
+    AllReduceStrategyTable table;
+    for (std::size_t bytes = 1024; bytes <= (std::size_t{64} << 20); bytes *= 4)
+    {
+        table.addSample(worldSize, kHalf, bytes, syntheticLatencies(bytes));
+    }
+    return table;
+}
+
+} // namespace
+
+TEST(AllReduceStrategyTableTest, SelectsFastestStrategy)
+{
+    auto const table = makeTable();
+    EXPECT_EQ(table.select(4, kHalf, 4096), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(table.select(4, kHalf, std::size_t{4} << 20), AllReduceStrategyType::TWOSHOT);
+    EXPECT_EQ(table.select(4, kHalf, std::size_t{64} << 20), AllReduceStrategyType::NCCL);
+    // Between the 4 MB and 16 MB samples the custom kernels are not known to support the message.
+    EXPECT_EQ(table.select(4, kHalf, std::size_t{6} << 20), AllReduceStrategyType::NCCL);
+}
+
+TEST(AllReduceStrategyTableTest, InterpolatesInLogSize)
+{
+    AllReduceStrategyTable table;
+    table.addSample(2, kHalf, 1024, {10.f, 2.f, kUnsupported});
+    table.addSample(2, kHalf, 16384, {30.f, 42.f, kUnsupported});
+
+    // 4096 bytes is halfway between the samples on a log scale.
+    auto const latencies = table.estimateLatencies(2, kHalf, 4096);
+    ASSERT_TRUE(latencies.has_value());
+    EXPECT_FLOAT_EQ((*latencies)[0], 20.f);
+    EXPECT_FLOAT_EQ((*latencies)[1], 22.f);
+    EXPECT_TRUE(std::isinf((*latencies)[2]));
+    EXPECT_EQ(table.select(2, kHalf, 2048), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(table.select(2, kHalf, 8192), AllReduceStrategyType::NCCL);
+}
+
+TEST(AllReduceStrategyTableTest, FindsCrossoverBetweenSamples)
+{
+    // The one-shot and two-shot curves cross at 24 kB on a linear size scale. Interpolation on the samples at 16 kB
+    // and 64 kB must switch between them in that interval.
+    auto const table = makeTable();
+    std::size_t previous = 16384;
+    auto strategy = *table.select(4, kHalf, previous);
+    EXPECT_EQ(strategy, AllReduceStrategyType::ONESHOT);
+    for (std::size_t bytes = previous + 1024; bytes <= 65536; bytes += 1024)
+    {
+        auto const next = table.select(4, kHalf, bytes);
+        ASSERT_TRUE(next.has_value());
+        if (*next != strategy)
+        {
+            EXPECT_EQ(*next, AllReduceStrategyType::TWOSHOT);
+            EXPECT_GT(bytes, 16384u);
+            EXPECT_LT(bytes, 65536u);
+            strategy = *next;
+        }
+    }
+    EXPECT_EQ(strategy, AllReduceStrategyType::TWOSHOT);
+}
+
+TEST(AllReduceStrategyTableTest, FallsBackOutsideTable)
+{
+    auto const table = makeTable();
+    EXPECT_FALSE(table.select(8, kHalf, 4096).has_value());
+    EXPECT_FALSE(table.select(4, nvinfer1::DataType::kBF16, 4096).has_value());
+    EXPECT_FALSE(table.select(4, kHalf, std::size_t{128} << 20).has_value());
+    // Messages below the smallest sample are dominated by the fixed latencies measured for it.
+    EXPECT_EQ(table.select(4, kHalf, 64), AllReduceStrategyType::ONESHOT);
+    EXPECT_FALSE(AllReduceStrategyTable{}.select(4, kHalf, 4096).has_value());
+}
+
+TEST(AllReduceStrategyTableTest, RespectsSupportedStrategies)
+{
+    auto const table = makeTable();
+    auto const noOneShot = [](AllReduceStrategyType strategy) { return strategy != AllReduceStrategyType::ONESHOT; };
+    EXPECT_EQ(table.select(4, kHalf, 4096, noOneShot), AllReduceStrategyType::TWOSHOT);
+    auto const none = [](AllReduceStrategyType) { return false; };
+    EXPECT_FALSE(table.select(4, kHalf, 4096, none).has_value());
+}
+
+TEST(AllReduceStrategyTableTest, ReplacesSamples)
+{
+    auto table = makeTable();
+    table.addSample(4, kHalf, 4096, {1.f, 5.f, 5.f});
+    EXPECT_EQ(table.select(4, kHalf, 4096), AllReduceStrategyType::NCCL);
+    EXPECT_THROW(table.addSample(0, kHalf, 4096, {1.f, 1.f, 1.f}), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(table.addSample(4, kHalf, 4096, {-1.f, 1.f, 1.f}), tensorrt_llm::common::TllmException);
+}
+
+TEST(AllReduceStrategyTableTest, RoundTrips)
+{
+    auto table = makeTable(4);
+    for (std::size_t bytes = 1024; bytes <= (std::size_t{64} << 20); bytes *= 4)
+    {
+        table.addSample(8, nvinfer1::DataType::kBF16, bytes, syntheticLatencies(bytes / 2));
+    }
+    std::stringstream stream;
+    table.write(stream);
+    auto const parsed = AllReduceStrategyTable::parse(stream);
+
+    for (auto const [worldSize, type] : {std::pair{4, kHalf}, std::pair{8, nvinfer1::DataType::kBF16}})
+    {
+        for (std::size_t bytes = 512; bytes <= (std::size_t{64} << 20); bytes = bytes * 3 / 2)
+        {
+            auto const expected = table.estimateLatencies(worldSize, type, bytes);
+            auto const actual = parsed.estimateLatencies(worldSize, type, bytes);
+            ASSERT_TRUE(expected.has_value() && actual.has_value());
+            for (std::size_t i = 0; i < expected->size(); ++i)
+            {
+                if (std::isinf((*expected)[i]))
+                {
+                    EXPECT_TRUE(std::isinf((*actual)[i]));
+                }
+                else
+                {
+                    EXPECT_NEAR((*actual)[i], (*expected)[i], 1e-4f * (*expected)[i]);
+                }
+            }
+        }
+    }
+}
+
+TEST(AllReduceStrategyTableTest, ParsesCommentsAndRejectsInvalidLines)
+{
+    std::istringstream input{
+        "# world_size dtype message_bytes nccl_us oneshot_us twoshot_us\n"
+        "\n"
+        "2 float32 1024 12.5 3 - # one-shot only\n"};
+    auto const table = AllReduceStrategyTable::parse(input);
+    EXPECT_EQ(table.select(2, nvinfer1::DataType::kFLOAT, 1024), AllReduceStrategyType::ONESHOT);
+
+    for (auto const* line : {"2 float32 1024 12.5 3", "2 int8 1024 1 1 1", "0 float16 1024 1 1 1",
+             "2 float16 -4 1 1 1", "2 float16 1024 1 x 1", "2 float16 1024 1 -3 1"})
+    {
+        std::istringstream invalid{line};
+        EXPECT_THROW(AllReduceStrategyTable::parse(invalid), tensorrt_llm::common::TllmException) << line;
+    }
+}
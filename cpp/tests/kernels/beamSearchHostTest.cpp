@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/beamSearchHost.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace tk = tensorrt_llm::kernels;
+namespace tc = tensorrt_llm::common;
+namespace tr = tensorrt_llm::runtime;
+
+using tr::SizeType32;
+using tr::TokenIdType;
+
+namespace
+{
+
+auto constexpr kEndId = 1000;
+
+//! \brief Step ids, parent ids and lengths of beam search outputs, in the layout of gatherTreeParam.
+struct BeamTree
+{
+    SizeType32 batchSize;
+    SizeType32 beamWidth;
+    SizeType32 maxSeqLen;
+    std::vector<TokenIdType> stepIds;        // [BS, BM, MSL]
+    std::vector<TokenIdType> parentIds;      // [BS, BM, MSL]
+    std::vector<SizeType32> sequenceLengths; // [BS, BM]
+    std::vector<SizeType32> inputLengths;    // [BS, BM]
+    std::vector<float> cumLogProbs;          // [BS, BM]
+    std::vector<TokenIdType> endIds;         // [BS]
+};
+
+BeamTree makeTree(SizeType32 batchSize, SizeType32 beamWidth, SizeType32 maxSeqLen, unsigned seed)
+{
+    std::mt19937 generator{seed};
+    std::uniform_int_distribution<TokenIdType> tokens{0, kEndId - 1};
+    std::uniform_int_distribution<TokenIdType> parents{0, beamWidth - 1};
+    std::uniform_int_distribution<SizeType32> inputLengths{1, maxSeqLen / 2};
+    std::uniform_real_distribution<float> logProbs{-20.f, -0.1f};
+
+    BeamTree tree{batchSize, beamWidth, maxSeqLen};
+    auto const numTokens = batchSize * beamWidth * maxSeqLen;
+    for (SizeType32 i = 0; i < numTokens; ++i)
+    {
+        tree.stepIds.push_back(tokens(generator));
+        tree.parentIds.push_back(parents(generator));
+    }
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        auto const inputLength = inputLengths(generator);
+        std::uniform_int_distribution<SizeType32> lengths{inputLength + 1, maxSeqLen};
+        for (SizeType32 beam = 0; beam < beamWidth; ++beam)
+        {
+            tree.inputLengths.push_back(inputLength);
+            tree.sequenceLengths.push_back(lengths(generator));
+            tree.cumLogProbs.push_back(logProbs(generator));
+        }
+        tree.endIds.push_back(kEndId);
+    }
+    return tree;
+}
+
+tk::gatherTreeParam makeParam(BeamTree& tree, std::vector<TokenIdType>& outputIds)
+{
+    tk::gatherTreeParam param;
+    param.sequenceLengths = tree.sequenceLengths.data();
+    param.maxSequenceLengthFinalStep = 1;
+    param.inputLengths = tree.inputLengths.data();
+    param.maxSeqLen = tree.maxSeqLen;
+    param.batchSize = tree.batchSize;
+    param.beamWidth = tree.beamWidth;
+    param.stepIds = tree.stepIds.data();
+    param.parentIds = tree.parentIds.data();
+    param.endTokens = tree.endIds.data();
+    param.outputIds = outputIds.data();
+    param.cumLogProbs = tree.cumLogProbs.data();
+    param.lengthPenalty = 1.2f;
+    return param;
+}
+
+//! \brief The path of a beam, following its parents back from the last step of the longest beam.
+std::vector<TokenIdType> backtrack(BeamTree const& tree, SizeType32 bi, SizeType32 beam)
+{
+    auto const* lengths = tree.sequenceLengths.data() + bi * tree.beamWidth;
+    auto const length = *std::max_element(lengths, lengths + tree.beamWidth);
+    std::vector<TokenIdType> path(length);
+    for (auto step = length - 1; step >= 0; --step)
+    {
+        auto const index = (bi * tree.beamWidth + beam) * tree.maxSeqLen + step;
+        path[step] = tree.stepIds[index];
+        beam = tree.parentIds[index];
+    }
+    return path;
+}
+
+} // namespace
+
+TEST(BeamSearchHostTest, GatherTreeBacktracksAndSortsBeams)
+{
+    auto tree = makeTree(3, 4, 24, 42);
+    auto const input = tree;
+    std::vector<TokenIdType> outputIds(tree.stepIds.size());
+    tk::gatherTreeHost(makeParam(tree, outputIds));
+
+    for (SizeType32 bi = 0; bi < tree.batchSize; ++bi)
+    {
+        std::vector<float> scores;
+        for (SizeType32 beam = 0; beam < tree.beamWidth; ++beam)
+        {
+            auto const index = bi * tree.beamWidth + beam;
+            auto const numGenerated = input.sequenceLengths[index] - input.inputLengths[index];
+            scores.push_back(input.cumLogProbs[index] / std::pow(static_cast<float>(numGenerated), 1.2f));
+        }
+        std::vector<SizeType32> ranks(tree.beamWidth);
+        std::iota(ranks.begin(), ranks.end(), 0);
+        std::sort(ranks.begin(), ranks.end(), [&scores](auto a, auto b) { return scores[a] > scores[b]; });
+
+        for (SizeType32 beam = 0; beam < tree.beamWidth; ++beam)
+        {
+            auto const src = bi * tree.beamWidth + ranks[beam];
+            auto const dst = bi * tree.beamWidth + beam;
+            EXPECT_EQ(tree.sequenceLengths[dst], input.sequenceLengths[src]);
+            EXPECT_EQ(tree.cumLogProbs[dst], input.cumLogProbs[src]);
+            auto const path = backtrack(input, bi, ranks[beam]);
+            for (SizeType32 step = 0; step < tree.sequenceLengths[dst]; ++step)
+            {
+                EXPECT_EQ(outputIds[dst * tree.maxSeqLen + step], path[step])
+                    << "batch " << bi << " beam " << beam << " step " << step;
+            }
+        }
+    }
+}
+
+TEST(BeamSearchHostTest, GatherTreeEndsPathsAtEndToken)
+{
+    BeamTree tree{1, 1, 8};
+    tree.stepIds = {4, 5, kEndId, 6, 7, 8, 9, 10};
+    tree.parentIds.assign(8, 0);
+    tree.sequenceLengths = {6};
+    tree.inputLengths = {1};
+    tree.cumLogProbs = {-1.f};
+    tree.endIds = {kEndId};
+    std::vector<TokenIdType> outputIds(8, -1);
+    tk::gatherTreeHost(makeParam(tree, outputIds));
+    EXPECT_EQ(outputIds, (std::vector<TokenIdType>{4, 5, kEndId, kEndId, kEndId, kEndId, kEndId, kEndId}));
+}
+
+TEST(BeamSearchHostTest, SelectBeamsTracksFinishedBeams)
+{
+    SizeType32 constexpr nBM = 2;
+    SizeType32 constexpr nV = 4;
+    SizeType32 constexpr nMSL = 8;
+    TokenIdType constexpr endId = 3;
+
+    std::vector<TokenIdType> outputIds{0, 1, 2, 0, 0, 0, 0, 0, 0, 1, 3, 0, 0, 0, 0, 0};
+    std::vector<TokenIdType> parentIds(nBM * nMSL, 0);
+    std::vector<SizeType32> sequenceLengths{3, 3};
+    std::vector<SizeType32> inputLengths{2, 2};
+    std::vector<float> cumLogProbs{-0.2f, -0.3f};
+    std::vector<tk::FinishedState> finished(nBM, tk::FinishedState::empty());
+    TokenIdType* outputIdsPtr[] = {outputIds.data()};
+    TokenIdType* parentIdsPtr[] = {parentIds.data()};
+    float const diversityRate{0.f};
+    float const lengthPenalty{0.f};
+    SizeType32 const earlyStopping{1};
+    std::vector<TokenIdType> outputIdsCBA(nBM * 2 * nMSL, -1);
+    std::vector<SizeType32> sequenceLengthsCBA(nBM * 2);
+    std::vector<float> cumLogProbsCBA(nBM * 2);
+    std::vector<float> normedScoresCBA(nBM * 2);
+    SizeType32 numBeamsCBA{0};
+    float minNormedScoresCBA{0.f};
+    bool batchDone{false};
+
+    tk::BeamHypotheses bh;
+    bh.nMaxBatchSize = 1;
+    bh.nBatchSize = 1;
+    bh.nBeamWidth = nBM;
+    bh.nMaxSeqLen = nMSL;
+    bh.nVocabSize = nV;
+    bh.diversityRates = &diversityRate;
+    bh.lengthPenalties = &lengthPenalty;
+    bh.earlyStoppings = &earlyStopping;
+    bh.inputLengths = inputLengths.data();
+    bh.endIds = &endId;
+    bh.sequenceLengths = sequenceLengths.data();
+    bh.cumLogProbs = cumLogProbs.data();
+    bh.outputIdsCBA = outputIdsCBA.data();
+    bh.sequenceLengthsCBA = sequenceLengthsCBA.data();
+    bh.cumLogProbsCBA = cumLogProbsCBA.data();
+    bh.normedScoresCBA = normedScoresCBA.data();
+    bh.numBeamsCBA = &numBeamsCBA;
+    bh.minNormedScoresCBA = &minNormedScoresCBA;
+    bh.batchDones = &batchDone;
+    bh.finished = finished.data();
+    bh.outputIdsPtr = outputIdsPtr;
+    bh.parentIdsPtr = parentIdsPtr;
+
+    // The best candidate ends beam 0, the next two extend beam 0 and beam 1.
+    std::vector<TokenIdType> candidateIds{0 * nV + endId, 0 * nV + 1, 1 * nV + 2, 1, 2, 5, 6, 7};
+    std::vector<float> candidateLogProbs{-0.5f, -0.7f, -0.8f, -5.f, -5.f, -5.f, -5.f, -5.f};
+    tk::selectBeamsHost(candidateIds.data(), candidateLogProbs.data(), bh);
+
+    EXPECT_EQ(numBeamsCBA, 1);
+    EXPECT_FLOAT_EQ(minNormedScoresCBA, -0.5f);
+    EXPECT_FLOAT_EQ(normedScoresCBA[0], -0.5f);
+    EXPECT_FLOAT_EQ(cumLogProbsCBA[0], -0.5f);
+    EXPECT_EQ(sequenceLengthsCBA[0], 3);
+    EXPECT_EQ(std::vector<TokenIdType>(outputIdsCBA.begin(), outputIdsCBA.begin() + 4),
+        (std::vector<TokenIdType>{0, 1, 2, endId}));
+    EXPECT_FALSE(batchDone);
+
+    EXPECT_EQ(sequenceLengths, (std::vector<SizeType32>{4, 4}));
+    EXPECT_EQ(cumLogProbs, (std::vector<float>{-0.7f, -0.8f}));
+    EXPECT_EQ(outputIds[3], 1);
+    EXPECT_EQ(outputIds[nMSL + 3], 2);
+    EXPECT_EQ(parentIds[3], 0);
+    EXPECT_EQ(parentIds[nMSL + 3], 1);
+    EXPECT_FALSE(finished[0].isFinished());
+    EXPECT_FALSE(finished[1].isFinished());
+}
+
+TEST(BeamSearchHostTest, FinalizeSelectsBestCandidateBeams)
+{
+    SizeType32 constexpr nBM = 2;
+    SizeType32 constexpr nMSL = 6;
+
+    // A beam that finished with 4 tokens and two unfinished beams of 5 tokens. The second unfinished beam continues
+    // the first one.
+    std::vector<TokenIdType> outputIdsCBA(nBM * 2 * nMSL, -1);
+    std::copy_n(std::vector<TokenIdType>{5, 6, 7, kEndId}.begin(), 4, outputIdsCBA.begin());
+    std::vector<float> logProbsCBA(nBM * 2 * nMSL, 0.f);
+    std::vector<SizeType32> sequenceLengthsCBA{4, 0, 0, 0};
+    std::vector<float> cumLogProbsCBA{-2.f, 0.f, 0.f, 0.f};
+    std::vector<float> normedScoresCBA{-1.f, 0.f, 0.f, 0.f};
+    SizeType32 numBeamsCBA{1};
+    bool batchDone{false};
+
+    std::vector<TokenIdType> outputIdsUnfinish{5, 6, 10, 11, 12, 0, 5, 6, 20, 21, 22, 0};
+    std::vector<TokenIdType> parentIdsUnfinish{0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
+    std::vector<float> logProbsTiled(nMSL * nBM);
+    std::iota(logProbsTiled.begin(), logProbsTiled.end(), 0.f);
+    std::vector<SizeType32> sequenceLengths{5, 5};
+    std::vector<SizeType32> inputLengths{2, 2};
+    std::vector<float> cumLogProbs{-0.9f, -6.f};
+    float const lengthPenalty{1.f};
+    std::vector<TokenIdType> outputIds(nBM * nMSL, kEndId);
+    std::vector<float> logProbs(nBM * nMSL, 0.f);
+
+    tk::BeamHypotheses bh;
+    bh.nMaxBatchSize = 1;
+    bh.nBatchSize = 1;
+    bh.nBeamWidth = nBM;
+    bh.nMaxSeqLen = nMSL;
+    bh.lengthPenalties = &lengthPenalty;
+    bh.inputLengths = inputLengths.data();
+    bh.outputIds = outputIds.data();
+    bh.logProbs = logProbs.data();
+    bh.logProbsTiled = logProbsTiled.data();
+    bh.sequenceLengths = sequenceLengths.data();
+    bh.cumLogProbs = cumLogProbs.data();
+    bh.outputIdsCBA = outputIdsCBA.data();
+    bh.logProbsCBA = logProbsCBA.data();
+    bh.sequenceLengthsCBA = sequenceLengthsCBA.data();
+    bh.cumLogProbsCBA = cumLogProbsCBA.data();
+    bh.normedScoresCBA = normedScoresCBA.data();
+    bh.numBeamsCBA = &numBeamsCBA;
+    bh.batchDones = &batchDone;
+    bh.outputIdsUnfinish = outputIdsUnfinish.data();
+    bh.parentIdsUnfinish = parentIdsUnfinish.data();
+
+    tk::insertUnfinishedPathHost(bh);
+    EXPECT_EQ(numBeamsCBA, 3);
+    EXPECT_FLOAT_EQ(normedScoresCBA[1], -0.3f);
+    EXPECT_FLOAT_EQ(normedScoresCBA[2], -2.f);
+
+    tk::finalizeHost(bh);
+    EXPECT_EQ(sequenceLengths, (std::vector<SizeType32>{5, 4}));
+    EXPECT_EQ(cumLogProbs, (std::vector<float>{-0.9f, -2.f}));
+    EXPECT_EQ(std::vector<TokenIdType>(outputIds.begin(), outputIds.begin() + 5),
+        (std::vector<TokenIdType>{5, 6, 10, 11, 12}));
+    EXPECT_EQ(std::vector<TokenIdType>(outputIds.begin() + nMSL, outputIds.begin() + nMSL + 4),
+        (std::vector<TokenIdType>{5, 6, 7, kEndId}));
+    // The log probs of the generated tokens of beam 0, from the tiled [MSL, MBS, BM] layout.
+    EXPECT_EQ(std::vector<float>(logProbs.begin(), logProbs.begin() + 3), (std::vector<float>{4.f, 6.f, 8.f}));
+
+    // The beams of a finished request are not inserted.
+    batchDone = true;
+    tk::insertUnfinishedPathHost(bh);
+    EXPECT_EQ(numBeamsCBA, 3);
+}
+
+TEST(BeamSearchHostTest, GatherTreeIndependentOfThreads)
+{
+    auto expected = makeTree(64, 8, 256, 7);
+    std::vector<TokenIdType> expectedIds(expected.stepIds.size());
+    tk::gatherTreeHost(makeParam(expected, expectedIds), /*numThreads=*/1);
+    for (SizeType32 numThreads : {2, 5})
+    {
+        auto tree = makeTree(64, 8, 256, 7);
+        std::vector<TokenIdType> outputIds(tree.stepIds.size());
+        tk::gatherTreeHost(makeParam(tree, outputIds), numThreads);
+        EXPECT_EQ(outputIds, expectedIds) << numThreads << " threads";
+        EXPECT_EQ(tree.sequenceLengths, expected.sequenceLengths) << numThreads << " threads";
+        EXPECT_EQ(tree.cumLogProbs, expected.cumLogProbs) << numThreads << " threads";
+    }
+}
+
+TEST(BeamSearchHostTest, GatherTreeMatchesDevice)
+{
+    if (tc::getDeviceCount() <= 0)
+    {
+        GTEST_SKIP() << "The host implementation is compared against the device kernels.";
+    }
+    // The kernel sorts up to 32 beams.
+    auto tree = makeTree(16, 8, 64, 3);
+    auto const input = tree;
+    std::vector<TokenIdType> hostIds(tree.stepIds.size());
+    tk::gatherTreeHost(makeParam(tree, hostIds));
+
+    tr::BufferManager manager{std::make_shared<tr::CudaStream>()};
+    auto const shape = tr::ITensor::makeShape({tree.batchSize, tree.beamWidth, tree.maxSeqLen});
+    auto const beamShape = tr::ITensor::makeShape({tree.batchSize, tree.beamWidth});
+    auto const stepIds = manager.copyFrom(input.stepIds, shape, tr::MemoryType::kGPU);
+    auto const parentIds = manager.copyFrom(input.parentIds, shape, tr::MemoryType::kGPU);
+    auto sequenceLengths = manager.copyFrom(input.sequenceLengths, beamShape, tr::MemoryType::kGPU);
+    auto const inputLengths = manager.copyFrom(input.inputLengths, beamShape, tr::MemoryType::kGPU);
+    auto cumLogProbs = manager.copyFrom(input.cumLogProbs, beamShape, tr::MemoryType::kGPU);
+    auto const endIds
+        = manager.copyFrom(input.endIds, tr::ITensor::makeShape({tree.batchSize}), tr::MemoryType::kGPU);
+    auto outputIds = manager.gpu(shape, nvinfer1::DataType::kINT32);
+
+    tk::gatherTreeParam param;
+    param.sequenceLengths = tr::bufferCast<SizeType32>(*sequenceLengths);
+    param.maxSequenceLengthFinalStep = 1;
+    param.inputLengths = tr::bufferCast<SizeType32>(*inputLengths);
+    param.maxSeqLen = tree.maxSeqLen;
+    param.batchSize = tree.batchSize;
+    param.beamWidth = tree.beamWidth;
+    param.stepIds = tr::bufferCast<TokenIdType>(*stepIds);
+    param.parentIds = tr::bufferCast<TokenIdType>(*parentIds);
+    param.endTokens = tr::bufferCast<TokenIdType>(*endIds);
+    param.outputIds = tr::bufferCast<TokenIdType>(*outputIds);
+    param.cumLogProbs = tr::bufferCast<float>(*cumLogProbs);
+    param.lengthPenalty = 1.2f;
+    param.stream = manager.getStream().get();
+    tk::invokeGatherTree(param);
+
+    std::vector<TokenIdType> deviceIds(hostIds.size());
+    std::vector<SizeType32> deviceLengths(tree.sequenceLengths.size());
+    std::vector<float> deviceCumLogProbs(tree.cumLogProbs.size());
+    manager.copy(*outputIds, deviceIds.data());
+    manager.copy(*sequenceLengths, deviceLengths.data());
+    manager.copy(*cumLogProbs, deviceCumLogProbs.data());
+    manager.getStream().synchronize();
+
+    EXPECT_EQ(deviceLengths, tree.sequenceLengths);
+    EXPECT_EQ(deviceCumLogProbs, tree.cumLogProbs);
+    for (std::size_t beam = 0; beam < deviceLengths.size(); ++beam)
+    {
+        for (SizeType32 step = 0; step < deviceLengths[beam]; ++step)
+        {
+            auto const index = beam * tree.maxSeqLen + step;
+            EXPECT_EQ(hostIds[index], deviceIds[index]) << "beam " << beam << " step " << step;
+        }
+    }
+}
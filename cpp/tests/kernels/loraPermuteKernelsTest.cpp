@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/lora/loraPermuteKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace tk = tensorrt_llm::kernels;
+namespace tr = tensorrt_llm::runtime;
+
+namespace
+{
+
+class LoraPermuteKernelsTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (tensorrt_llm::common::getDeviceCount() == 0)
+        {
+            GTEST_SKIP() << "Skipping due to no GPU";
+        }
+        mStream = std::make_shared<tr::CudaStream>();
+        mBufferManager = std::make_shared<tr::BufferManager>(mStream);
+    }
+
+    std::vector<uint8_t> makeRows(int64_t numTokens, int64_t rowBytes)
+    {
+        std::uniform_int_distribution<int> distribution{0, 255};
+        std::vector<uint8_t> rows(numTokens * rowBytes);
+        std::generate(rows.begin(), rows.end(), [&] { return static_cast<uint8_t>(distribution(mGenerator)); });
+        return rows;
+    }
+
+    std::vector<uint8_t> toHost(tr::IBuffer const& buffer)
+    {
+        std::vector<uint8_t> host(buffer.getSizeInBytes());
+        mBufferManager->copy(buffer, host.data());
+        mStream->synchronize();
+        return host;
+    }
+
+    std::vector<int32_t> makePermutation(int64_t numTokens)
+    {
+        std::vector<int32_t> permutation(numTokens);
+        std::iota(permutation.begin(), permutation.end(), 0);
+        std::shuffle(permutation.begin(), permutation.end(), mGenerator);
+        return permutation;
+    }
+
+    std::shared_ptr<tr::CudaStream> mStream;
+    std::shared_ptr<tr::BufferManager> mBufferManager;
+    std::mt19937 mGenerator{42};
+};
+
+} // namespace
+
+TEST_F(LoraPermuteKernelsTest, gather)
+{
+    int64_t const numTokens = 37;
+    // Rows copied by vectors of 16, 2 and 1 bytes.
+    for (int64_t const rowBytes : {256, 6, 3})
+    {
+        auto const permutation = makePermutation(numTokens);
+        auto const input = makeRows(numTokens, rowBytes);
+        auto const devicePermutation = mBufferManager->copyFrom(permutation, tr::MemoryType::kGPU);
+        auto const deviceInput = mBufferManager->copyFrom(input, tr::MemoryType::kGPU);
+        auto deviceOutput = mBufferManager->gpu(numTokens * rowBytes);
+        tk::invokeLoraGatherTokens(deviceOutput->data(), deviceInput->data(), rowBytes,
+            tr::bufferCast<int32_t>(*devicePermutation), numTokens, mStream->get());
+
+        std::vector<uint8_t> expected(numTokens * rowBytes);
+        for (int64_t token = 0; token < numTokens; ++token)
+        {
+            std::copy_n(input.begin() + permutation[token] * rowBytes, rowBytes, expected.begin() + token * rowBytes);
+        }
+        EXPECT_EQ(toHost(*deviceOutput), expected) << "row bytes " << rowBytes;
+    }
+}
+
+TEST_F(LoraPermuteKernelsTest, scatterAllModules)
+{
+    int64_t const numTokens = 53;
+    // More modules than one launch takes, with different row sizes.
+    int32_t const numModules = 11;
+    auto const permutation = makePermutation(numTokens);
+    auto const devicePermutation = mBufferManager->copyFrom(permutation, tr::MemoryType::kGPU);
+
+    std::vector<int64_t> rowBytes(numModules);
+    std::vector<std::vector<uint8_t>> permutedOutputs(numModules);
+    std::vector<tr::IBufferPtr> devicePermutedOutputs(numModules);
+    std::vector<tr::IBufferPtr> deviceOutputs(numModules);
+    std::vector<void const*> permutedOutputPtrs(numModules);
+    std::vector<void*> outputPtrs(numModules);
+    for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+    {
+        rowBytes[moduleIdx] = 64 * (moduleIdx + 1);
+        permutedOutputs[moduleIdx] = makeRows(numTokens, rowBytes[moduleIdx]);
+        devicePermutedOutputs[moduleIdx] = mBufferManager->copyFrom(permutedOutputs[moduleIdx], tr::MemoryType::kGPU);
+        deviceOutputs[moduleIdx] = mBufferManager->gpu(numTokens * rowBytes[moduleIdx]);
+        permutedOutputPtrs[moduleIdx] = devicePermutedOutputs[moduleIdx]->data();
+        outputPtrs[moduleIdx] = deviceOutputs[moduleIdx]->data();
+    }
+    tk::invokeLoraScatterTokens(outputPtrs.data(), permutedOutputPtrs.data(), rowBytes.data(), numModules,
+        tr::bufferCast<int32_t>(*devicePermutation), numTokens, mStream->get());
+
+    for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+    {
+        auto const moduleRowBytes = rowBytes[moduleIdx];
+        std::vector<uint8_t> expected(numTokens * moduleRowBytes);
+        for (int64_t token = 0; token < numTokens; ++token)
+        {
+            std::copy_n(permutedOutputs[moduleIdx].begin() + token * moduleRowBytes, moduleRowBytes,
+                expected.begin() + permutation[token] * moduleRowBytes);
+        }
+        EXPECT_EQ(toHost(*deviceOutputs[moduleIdx]), expected) << "module " << moduleIdx;
+    }
+}
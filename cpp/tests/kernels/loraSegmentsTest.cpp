@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/lora/loraSegments.h"
+
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+//! \brief Per-request LoRA inputs of a step, in the layout of the LoRA plugin inputs.
+struct LoraStep
+{
+    int32_t numModules;
+    std::vector<int64_t> reqNumTokens;             // [numReqs]
+    std::vector<std::vector<int32_t>> ranks;       // [numModules][numReqs]
+    std::vector<std::vector<int64_t>> weightsPtrs; // [numModules][numReqs, 2]
+    std::vector<int32_t const*> ranksPtrs;         // [numModules]
+    std::vector<int64_t const*> moduleWeightsPtrs; // [numModules]
+};
+
+//! Requests use one of numAdapters adapters at random, with rank 0 for some modules, and adapter 0 has rank 0 for
+//! all modules.
+LoraStep makeStep(int32_t numModules, int64_t numReqs, int32_t numAdapters, unsigned seed)
+{
+    std::mt19937 generator{seed};
+    std::uniform_int_distribution<int32_t> adapters{0, numAdapters - 1};
+    std::uniform_int_distribution<int64_t> contextLengths{0, 64};
+    std::bernoulli_distribution isGeneration{0.5};
+
+    LoraStep step;
+    step.numModules = numModules;
+    step.ranks.resize(numModules);
+    step.weightsPtrs.resize(numModules);
+    for (int64_t reqId = 0; reqId < numReqs; ++reqId)
+    {
+        step.reqNumTokens.push_back(isGeneration(generator) ? 1 : contextLengths(generator));
+        auto const adapter = adapters(generator);
+        for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+        {
+            auto const rank = (adapter == 0 || (adapter + moduleIdx) % 3 == 0) ? 0 : 8 * (adapter % 2 + 1);
+            step.ranks[moduleIdx].push_back(rank);
+            // Weights of a rank 0 module may be anything.
+            auto const inPtr
+                = rank == 0 ? static_cast<int64_t>(generator()) : 0x1000 * (adapter * numModules + moduleIdx);
+            step.weightsPtrs[moduleIdx].push_back(inPtr);
+            step.weightsPtrs[moduleIdx].push_back(inPtr + 0x800);
+        }
+    }
+    for (int32_t moduleIdx = 0; moduleIdx < numModules; ++moduleIdx)
+    {
+        step.ranksPtrs.push_back(step.ranks[moduleIdx].data());
+        step.moduleWeightsPtrs.push_back(step.weightsPtrs[moduleIdx].data());
+    }
+    return step;
+}
+
+//! \brief Expands the per-request ranks and weights into per-token ones, as the LoRA plugin did before segments.
+void expandPerToken(LoraStep const& step, std::vector<int32_t>& ranks, std::vector<void const*>& weightsPtrs)
+{
+    for (int32_t moduleIdx = 0; moduleIdx < step.numModules; ++moduleIdx)
+    {
+        for (size_t reqId = 0; reqId < step.reqNumTokens.size(); ++reqId)
+        {
+            for (int64_t tokenIdx = 0; tokenIdx < step.reqNumTokens[reqId]; ++tokenIdx)
+            {
+                weightsPtrs.push_back(reinterpret_cast<void const*>(step.weightsPtrs[moduleIdx][reqId * 2]));
+                weightsPtrs.push_back(reinterpret_cast<void const*>(step.weightsPtrs[moduleIdx][reqId * 2 + 1]));
+                ranks.push_back(step.ranks[moduleIdx][reqId]);
+            }
+        }
+    }
+}
+
+//! \brief Checks that the segments of each module cover all tokens in order, that contiguous segments use different
+//! weights, and that the token of the input order at each position uses the weights of its segment.
+void checkSegments(tk::LoraSegmentTable const& table, LoraStep const& step)
+{
+    std::vector<int32_t> ranks;
+    std::vector<void const*> weightsPtrs;
+    expandPerToken(step, ranks, weightsPtrs);
+    auto const numTokens = table.getNumTokens();
+    ASSERT_EQ(static_cast<int64_t>(ranks.size()), numTokens * step.numModules);
+
+    // Input token at each position of the grouped order.
+    std::vector<int64_t> srcTokens(numTokens);
+    std::iota(srcTokens.begin(), srcTokens.end(), 0);
+    if (table.isPermuted())
+    {
+        auto const& permutation = table.getTokenPermutation();
+        ASSERT_EQ(static_cast<int64_t>(permutation.size()), numTokens);
+        std::vector<bool> covered(numTokens, false);
+        for (int64_t dstToken = 0; dstToken < numTokens; ++dstToken)
+        {
+            auto const srcToken = permutation[dstToken];
+            ASSERT_GE(srcToken, 0);
+            ASSERT_LT(srcToken, numTokens);
+            ASSERT_FALSE(covered[srcToken]);
+            covered[srcToken] = true;
+            srcTokens[dstToken] = srcToken;
+        }
+    }
+    else
+    {
+        EXPECT_TRUE(table.getTokenPermutation().empty());
+    }
+
+    for (int32_t moduleIdx = 0; moduleIdx < step.numModules; ++moduleIdx)
+    {
+        int64_t tokenBegin = 0;
+        tk::LoraSegment const* previous = nullptr;
+        for (auto const& segment : table.getSegments(moduleIdx))
+        {
+            ASSERT_EQ(segment.tokenBegin, tokenBegin);
+            ASSERT_GT(segment.numTokens, 0);
+            if (previous != nullptr)
+            {
+                EXPECT_TRUE(previous->rank != segment.rank
+                    || (segment.rank > 0
+                        && (previous->inWeightsPtr != segment.inWeightsPtr
+                            || previous->outWeightsPtr != segment.outWeightsPtr)));
+            }
+            for (int64_t tokenIdx = segment.tokenBegin; tokenIdx < segment.tokenBegin + segment.numTokens; ++tokenIdx)
+            {
+                auto const expandedIdx = moduleIdx * numTokens + srcTokens[tokenIdx];
+                ASSERT_EQ(segment.rank, ranks[expandedIdx]) << "module " << moduleIdx << " token " << tokenIdx;
+                if (segment.rank > 0)
+                {
+                    ASSERT_EQ(segment.inWeightsPtr, reinterpret_cast<int64_t>(weightsPtrs[expandedIdx * 2]));
+                    ASSERT_EQ(segment.outWeightsPtr, reinterpret_cast<int64_t>(weightsPtrs[expandedIdx * 2 + 1]));
+                }
+            }
+            tokenBegin += segment.numTokens;
+            previous = &segment;
+        }
+        ASSERT_EQ(tokenBegin, numTokens);
+    }
+}
+
+} // namespace
+
+TEST(LoraSegmentsTest, matchesPerTokenExpansion)
+{
+    for (unsigned seed = 0; seed < 20; ++seed)
+    {
+        auto const step = makeStep(3, 32, 4, seed);
+        tk::LoraSegmentTable table;
+        table.build(step.numModules, step.reqNumTokens.size(), step.reqNumTokens.data(), step.ranksPtrs.data(),
+            step.moduleWeightsPtrs.data(), false);
+        EXPECT_FALSE(table.isPermuted());
+        ASSERT_NO_FATAL_FAILURE(checkSegments(table, step)) << "seed " << seed;
+
+        // The per-token run of LoraImpl merges the same segments.
+        std::vector<int32_t> ranks;
+        std::vector<void const*> weightsPtrs;
+        expandPerToken(step, ranks, weightsPtrs);
+        tk::LoraSegmentTable tokenTable;
+        tokenTable.buildFromTokens(step.numModules, table.getNumTokens(), ranks.data(), weightsPtrs.data());
+        for (int32_t moduleIdx = 0; moduleIdx < step.numModules; ++moduleIdx)
+        {
+            EXPECT_EQ(tokenTable.getSegments(moduleIdx).size(), table.getSegments(moduleIdx).size());
+        }
+        ASSERT_NO_FATAL_FAILURE(checkSegments(tokenTable, step)) << "seed " << seed;
+    }
+}
+
+TEST(LoraSegmentsTest, groupByAdapter)
+{
+    for (unsigned seed = 0; seed < 20; ++seed)
+    {
+        auto const numAdapters = 4;
+        auto const step = makeStep(3, 32, numAdapters, seed);
+        tk::LoraSegmentTable table;
+        table.build(step.numModules, step.reqNumTokens.size(), step.reqNumTokens.data(), step.ranksPtrs.data(),
+            step.moduleWeightsPtrs.data(), true);
+        ASSERT_NO_FATAL_FAILURE(checkSegments(table, step)) << "seed " << seed;
+        // All tokens of an adapter make a single problem.
+        for (int32_t moduleIdx = 0; moduleIdx < step.numModules; ++moduleIdx)
+        {
+            EXPECT_LE(table.getNumProblems(moduleIdx), numAdapters - 1);
+        }
+    }
+}
+
+TEST(LoraSegmentsTest, interleavedAdapters)
+{
+    // Generation requests alternating between two adapters, with a context request of the first one in between.
+    int64_t const numReqs = 5;
+    std::vector<int64_t> const reqNumTokens{1, 1, 10, 1, 1};
+    std::vector<int32_t> const ranks{8, 16, 8, 16, 8};
+    std::vector<int64_t> const weightsPtrs{0x100, 0x200, 0x300, 0x400, 0x100, 0x200, 0x300, 0x400, 0x100, 0x200};
+    std::vector<int32_t const*> const ranksPtrs{ranks.data()};
+    std::vector<int64_t const*> const moduleWeightsPtrs{weightsPtrs.data()};
+
+    tk::LoraSegmentTable table;
+    table.build(1, numReqs, reqNumTokens.data(), ranksPtrs.data(), moduleWeightsPtrs.data(), false);
+    EXPECT_EQ(table.getNumTokens(), 14);
+    EXPECT_EQ(table.getNumProblems(0), 5);
+
+    table.build(1, numReqs, reqNumTokens.data(), ranksPtrs.data(), moduleWeightsPtrs.data(), true);
+    EXPECT_EQ(table.getNumTokens(), 14);
+    ASSERT_EQ(table.getNumProblems(0), 2);
+    auto const& segments = table.getSegments(0);
+    EXPECT_EQ(segments[0].rank, 8);
+    EXPECT_EQ(segments[0].tokenBegin, 0);
+    EXPECT_EQ(segments[0].numTokens, 12);
+    EXPECT_EQ(segments[1].rank, 16);
+    EXPECT_EQ(segments[1].tokenBegin, 12);
+    EXPECT_EQ(segments[1].numTokens, 2);
+
+    ASSERT_TRUE(table.isPermuted());
+    // The requests of the first adapter, then those of the second, each keeping the order of its tokens.
+    EXPECT_EQ(table.getTokenPermutation(), (std::vector<int32_t>{0, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 1, 12}));
+}
+
+TEST(LoraSegmentsTest, singleAdapterIsNotPermuted)
+{
+    std::vector<int64_t> const reqNumTokens{1, 7, 1};
+    std::vector<int32_t> const ranks{8, 8, 8};
+    std::vector<int64_t> const weightsPtrs{0x100, 0x200, 0x100, 0x200, 0x100, 0x200};
+    std::vector<int32_t const*> const ranksPtrs{ranks.data()};
+    std::vector<int64_t const*> const moduleWeightsPtrs{weightsPtrs.data()};
+
+    tk::LoraSegmentTable table;
+    table.build(1, 3, reqNumTokens.data(), ranksPtrs.data(), moduleWeightsPtrs.data(), true);
+    EXPECT_FALSE(table.isPermuted());
+    EXPECT_TRUE(table.getTokenPermutation().empty());
+    ASSERT_EQ(table.getSegments(0).size(), 1);
+    EXPECT_EQ(table.getSegments(0).front().numTokens, 9);
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/penaltyHost.h"
+
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+auto constexpr kBatchSize = 3;
+auto constexpr kBeamWidth = 2;
+auto constexpr kVocabSize = 1000;
+auto constexpr kVocabSizePadded = 1024;
+auto constexpr kMaxSeqLen = 64;
+auto constexpr kInputLen = 20;
+// Slot of each batch entry, the slots are not in batch order.
+std::vector<SizeType32> const kBatchSlots{2, 0, 1};
+
+//! \brief Penalty inputs of a batch decoded with beam search, with a dense or a sparse occurrence workspace.
+class PenaltyRun
+{
+public:
+    explicit PenaltyRun(SizeType32 occurrenceCapacity)
+        : mOccurrenceCapacity{occurrenceCapacity}
+    {
+        auto const workspaceSize
+            = kBatchSize * kBeamWidth * tk::getOccurrenceWorkspaceSize(occurrenceCapacity, kVocabSize);
+        mWorkspace.resize(workspaceSize);
+        mWorkspacePrev.resize(workspaceSize);
+        mOutputLogits.resize(kBatchSize * kBeamWidth * kVocabSizePadded);
+    }
+
+    //! \brief Apply the penalties to logits for sequences at the given lengths, then swap the workspaces as the penalty
+    //! layer does for beam search.
+    std::vector<float> const& step(std::vector<float const*> const& logits, std::vector<TokenIdType const*>& outputIds,
+        std::vector<SizeType32 const*>& parentIds, std::vector<SizeType32> const& sequenceLengths)
+    {
+        std::vector<float> const temperatures{0.7f, 1.f, 1.3f};
+        std::vector<float> const repetitionPenalties{1.3f, 1.f, 0.8f};
+        std::vector<float> const presencePenalties{0.5f, 0.f, -0.2f};
+        std::vector<float> const frequencyPenalties{0.2f, 0.f, 0.1f};
+        std::vector<SizeType32> const minLengths{5, 0, 1};
+        std::vector<SizeType32> const inputLengths(kBatchSize * kBeamWidth, kInputLen);
+        std::vector<TokenIdType> const endIds{7, 8, 9};
+
+        tk::InvokeBatchApplyPenaltyParams<float> params{};
+        params.inputLogits = logits.data();
+        params.outputLogits = mOutputLogits.data();
+        params.penaltyWorkspace = mWorkspace.data();
+        params.penaltyWorkspacePrev = mWorkspacePrev.data();
+        params.temperatures = temperatures.data();
+        params.repetitionPenalties = repetitionPenalties.data();
+        params.presencePenalties = presencePenalties.data();
+        params.frequencyPenalties = frequencyPenalties.data();
+        params.batchSize = kBatchSize;
+        params.beamWidth = kBeamWidth;
+        params.maxSeqLen = kMaxSeqLen;
+        params.vocabSize = kVocabSize;
+        params.vocabSizePadded = kVocabSizePadded;
+        params.outputIdsPtr = outputIds.data();
+        params.parentIdsPtr = parentIds.data();
+        params.inputLengths = inputLengths.data();
+        params.sequenceLengths = sequenceLengths.data();
+        params.minLengths = minLengths.data();
+        params.endIds = endIds.data();
+        params.batchSlots = kBatchSlots.data();
+        params.maxTokensPerStep = 1;
+        params.occurrenceCapacity = mOccurrenceCapacity;
+        tk::invokeBatchApplyPenaltyHost(params);
+        std::swap(mWorkspace, mWorkspacePrev);
+        return mOutputLogits;
+    }
+
+    //! \brief Occurrences of token in the sequence of a batch entry and beam, as of the last step.
+    [[nodiscard]] SizeType32 getOccurrences(SizeType32 batchIdx, SizeType32 beamIdx, TokenIdType token) const
+    {
+        auto const* table = mWorkspacePrev.data()
+            + (batchIdx * kBeamWidth + beamIdx) * tk::getOccurrenceWorkspaceSize(mOccurrenceCapacity, kVocabSize);
+        return mOccurrenceCapacity > 0 ? tk::findOccurrences(table, mOccurrenceCapacity, token) : table[token];
+    }
+
+private:
+    SizeType32 mOccurrenceCapacity;
+    std::vector<TokenIdType> mWorkspace;
+    std::vector<TokenIdType> mWorkspacePrev;
+    std::vector<float> mOutputLogits;
+};
+
+} // namespace
+
+TEST(PenaltyHostTest, occurrenceCapacity)
+{
+    EXPECT_EQ(tk::getOccurrenceCapacity(4096, 128000), 8192);
+    EXPECT_EQ(tk::getOccurrenceCapacity(3000, 128000), 8192);
+    EXPECT_EQ(tk::getOccurrenceCapacity(4096, 32000), 8192);
+    // The dense counts are smaller for long sequences over small vocabularies.
+    EXPECT_EQ(tk::getOccurrenceCapacity(16384, 32000), 0);
+}
+
+TEST(PenaltyHostTest, sparseOccurrencesMatchDense)
+{
+    std::mt19937 generator{42};
+    // Few distinct tokens so that they repeat, and some out of the vocabulary.
+    std::uniform_int_distribution<TokenIdType> tokens{0, 40};
+    std::uniform_int_distribution<SizeType32> beams{0, kBeamWidth - 1};
+    std::normal_distribution<float> logitValues{0.f, 3.f};
+
+    // [slot][beam * maxSeqLen + step], the beams of a slot share the context.
+    std::vector<std::vector<TokenIdType>> outputIds(kBatchSize, std::vector<TokenIdType>(kBeamWidth * kMaxSeqLen));
+    std::vector<std::vector<SizeType32>> parentIds(kBatchSize, std::vector<SizeType32>(kBeamWidth * kMaxSeqLen));
+    for (auto& ids : outputIds)
+    {
+        for (SizeType32 step = 0; step < kInputLen; ++step)
+        {
+            auto const token = step % 7 == 0 ? kVocabSize + step : tokens(generator);
+            for (SizeType32 beam = 0; beam < kBeamWidth; ++beam)
+            {
+                ids[beam * kMaxSeqLen + step] = token;
+            }
+        }
+    }
+    std::vector<TokenIdType const*> outputIdsPtr;
+    std::vector<SizeType32 const*> parentIdsPtr;
+    for (SizeType32 slot = 0; slot < kBatchSize; ++slot)
+    {
+        outputIdsPtr.push_back(outputIds[slot].data());
+        parentIdsPtr.push_back(parentIds[slot].data());
+    }
+
+    auto const capacity = tk::getOccurrenceCapacity(kMaxSeqLen, kVocabSize);
+    ASSERT_GT(capacity, 0);
+    PenaltyRun dense{0};
+    PenaltyRun sparse{capacity};
+    std::vector<float> logits(kBatchSize * kBeamWidth * kVocabSizePadded);
+    std::vector<float const*> logitsPtrs;
+    for (SizeType32 batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+    {
+        logitsPtrs.push_back(logits.data() + batchIdx * kBeamWidth * kVocabSizePadded);
+    }
+
+    for (SizeType32 length = kInputLen; length < kInputLen + 12; ++length)
+    {
+        if (length > kInputLen)
+        {
+            // Append a token to each beam, from a random parent.
+            for (SizeType32 slot = 0; slot < kBatchSize; ++slot)
+            {
+                for (SizeType32 beam = 0; beam < kBeamWidth; ++beam)
+                {
+                    outputIds[slot][beam * kMaxSeqLen + length - 1] = tokens(generator);
+                    parentIds[slot][beam * kMaxSeqLen + length - 1] = beams(generator);
+                }
+            }
+        }
+        for (auto& logit : logits)
+        {
+            logit = logitValues(generator);
+        }
+        std::vector<SizeType32> const sequenceLengths(kBatchSize * kBeamWidth, length);
+
+        auto const& denseLogits = dense.step(logitsPtrs, outputIdsPtr, parentIdsPtr, sequenceLengths);
+        auto const& sparseLogits = sparse.step(logitsPtrs, outputIdsPtr, parentIdsPtr, sequenceLengths);
+        ASSERT_EQ(denseLogits, sparseLogits) << "at length " << length;
+        for (SizeType32 batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+        {
+            for (SizeType32 beam = 0; beam < kBeamWidth; ++beam)
+            {
+                for (TokenIdType token = 0; token < kVocabSize; ++token)
+                {
+                    ASSERT_EQ(
+                        dense.getOccurrences(batchIdx, beam, token), sparse.getOccurrences(batchIdx, beam, token));
+                }
+            }
+        }
+    }
+}
+
+TEST(PenaltyHostTest, penalties)
+{
+    // One sequence whose context has token 3 twice and token 5 once.
+    std::vector<TokenIdType> const ids{3, 5, 3};
+    std::vector<TokenIdType const*> outputIdsPtr{ids.data()};
+    std::vector<float> const logits{1.f, 1.f, 1.f, 2.f, 1.f, -2.f, 1.f, 1.f};
+    std::vector<float const*> logitsPtrs{logits.data()};
+    std::vector<float> outputLogits(logits.size());
+    std::vector<TokenIdType> workspace(2 * 4);
+    float const repetitionPenalty{2.f};
+    float const presencePenalty{0.5f};
+    float const frequencyPenalty{0.25f};
+    SizeType32 const inputLength{3};
+    SizeType32 const batchSlot{0};
+
+    tk::InvokeBatchApplyPenaltyParams<float> params{};
+    params.inputLogits = logitsPtrs.data();
+    params.outputLogits = outputLogits.data();
+    params.penaltyWorkspace = workspace.data();
+    params.repetitionPenalties = &repetitionPenalty;
+    params.presencePenalties = &presencePenalty;
+    params.frequencyPenalties = &frequencyPenalty;
+    params.batchSize = 1;
+    params.beamWidth = 1;
+    params.maxSeqLen = 3;
+    params.vocabSize = 7;
+    params.vocabSizePadded = 8;
+    params.outputIdsPtr = outputIdsPtr.data();
+    params.inputLengths = &inputLength;
+    params.sequenceLengths = &inputLength;
+    params.batchSlots = &batchSlot;
+    params.maxTokensPerStep = 1;
+    params.occurrenceCapacity = 4;
+    tk::invokeBatchApplyPenaltyHost(params);
+
+    EXPECT_FLOAT_EQ(outputLogits[0], 1.f);
+    EXPECT_FLOAT_EQ(outputLogits[3], 2.f / 2.f - 0.5f - 2 * 0.25f);
+    EXPECT_FLOAT_EQ(outputLogits[5], -2.f * 2.f - 0.5f - 0.25f);
+    EXPECT_EQ(outputLogits[7], -FLT_MAX);
+}
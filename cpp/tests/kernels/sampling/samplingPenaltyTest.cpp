@@ -386,6 +386,7 @@ struct RepetitionPenaltyTestCase
     int32_t presencePenaltiesSize;
     int32_t frequencyPenaltiesSize;
     int32_t maxTokensPerStep{1};
+    int32_t occurrenceCapacity{0};
 
     RepetitionPenaltyTestCase& setBatchSize(int32_t bs)
     {
@@ -447,12 +448,18 @@ struct RepetitionPenaltyTestCase
         return *this;
     }
 
+    RepetitionPenaltyTestCase& setOccurrenceCapacity(int32_t oc)
+    {
+        occurrenceCapacity = oc;
+        return *this;
+    }
+
     std::string toString() const
     {
         return tc::fmtstr(
-            "RepetitionPenaltyTestCase[batch=%d, vocab=%d, maxInputLength=%d, "
+            "RepetitionPenaltyTestCase[batch=%d, vocab=%d, maxInputLength=%d, occurrenceCapacity=%d, "
             "repetitionPenalties=%s, presencePenalties=%s, frequencyPenalties=%s]",
-            batchSize, vocabSize, maxInputLength,
+            batchSize, vocabSize, maxInputLength, occurrenceCapacity,
             tc::arr2str(bufferCast<float>(*repetitionPenalties), repetitionPenaltiesSize).c_str(),
             tc::arr2str(bufferCast<float>(*presencePenalties), presencePenaltiesSize).c_str(),
             tc::arr2str(bufferCast<float>(*frequencyPenalties), frequencyPenaltiesSize).c_str());
@@ -680,6 +687,30 @@ public:
         bool passed = checkResult(param.toString(), bufferCast<T>(*logitsOutHost), bufferCast<T>(*mLogitsRefHost),
             mBatchSize * mMaxTokensPerStep * mVocabSizePadded);
         EXPECT_TRUE(passed);
+
+        if (param.occurrenceCapacity > 0)
+        {
+            // Counting the occurrences in sparse tables must give the logits of the dense counts.
+            auto const sequenceWorkspaceSize = getOccurrenceWorkspaceSize(param.occurrenceCapacity, mVocabSize);
+            auto sparseWorkspaceDevice = mBufferManager->gpu(
+                ITensor::makeShape({mBatchSize, mMaxTokensPerStep, sequenceWorkspaceSize}), nvinfer1::DataType::kINT32);
+            mBufferManager->setZero(*sparseWorkspaceDevice);
+            auto sparseOutLogitsDevice = mBufferManager->gpu(mOutLogitsDevice->getShape(), TRTDataType<T>::value);
+            trk::invokeFill(*sparseOutLogitsDevice, T{0.0f}, *mStream);
+
+            auto sparsePenaltyParams = penaltyParams;
+            sparsePenaltyParams.outputLogits = bufferCast<T>(*sparseOutLogitsDevice);
+            sparsePenaltyParams.penaltyWorkspace = bufferCast<int32_t>(*sparseWorkspaceDevice);
+            sparsePenaltyParams.occurrenceCapacity = param.occurrenceCapacity;
+            tk::invokeBatchApplyPenalty(sparsePenaltyParams);
+
+            auto sparseLogitsOutHost = mBufferManager->copyFrom(*sparseOutLogitsDevice, MemoryType::kCPU);
+            mStream->synchronize();
+
+            bool sparsePassed = checkResult(param.toString(), bufferCast<T>(*sparseLogitsOutHost),
+                bufferCast<T>(*logitsOutHost), mBatchSize * mMaxTokensPerStep * mVocabSizePadded);
+            EXPECT_TRUE(sparsePassed);
+        }
     }
 };
 
@@ -1050,6 +1081,74 @@ TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFullTokensPerStep)
                       .setMaxTokensPerStep(4));
 }
 
+TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFullSparseOccurrences)
+{
+    int32_t batchSize = 6;
+    int32_t maxBatchSize = 2 * batchSize;
+    int32_t vocabSize = 1000;
+    int32_t maxInputLength = 40;
+    TensorPtr repetitionPenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr presencePenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr frequencyPenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    for (int32_t i = 0; i < maxBatchSize; ++i)
+    {
+        bufferCast<float>(*repetitionPenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*presencePenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*frequencyPenaltyHost)[i] = 0.53 + i * 0.2f;
+    }
+    // Sequences hold up to 2 * maxInputLength tokens.
+    auto const occurrenceCapacity = getOccurrenceCapacity(2 * maxInputLength, vocabSize);
+    ASSERT_GT(occurrenceCapacity, 0);
+    this->runTest(RepetitionPenaltyTestCase()
+                      .setBatchSize(batchSize)
+                      .setVocabSize(vocabSize)
+                      .setMaxInputLength(maxInputLength)
+                      .setRepetitionPenalties(repetitionPenaltyHost)
+                      .setPresencePenalties(presencePenaltyHost)
+                      .setFrequencyPenalties(frequencyPenaltyHost)
+                      .setRepetitionPenaltiesSize(maxBatchSize)
+                      .setPresencePenaltiesSize(maxBatchSize)
+                      .setFrequencyPenaltiesSize(maxBatchSize)
+                      .setOccurrenceCapacity(occurrenceCapacity));
+}
+
+TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFullSparseOccurrencesTokensPerStep)
+{
+    int32_t batchSize = 6;
+    int32_t maxBatchSize = 2 * batchSize;
+    int32_t vocabSize = 1000;
+    int32_t maxInputLength = 40;
+    TensorPtr repetitionPenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr presencePenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr frequencyPenaltyHost
+        = BufferManager::pinned(ITensor::makeShape({maxBatchSize}), nvinfer1::DataType::kFLOAT);
+    for (int32_t i = 0; i < maxBatchSize; ++i)
+    {
+        bufferCast<float>(*repetitionPenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*presencePenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*frequencyPenaltyHost)[i] = 0.53 + i * 0.2f;
+    }
+    auto const occurrenceCapacity = getOccurrenceCapacity(2 * maxInputLength, vocabSize);
+    ASSERT_GT(occurrenceCapacity, 0);
+    this->runTest(RepetitionPenaltyTestCase()
+                      .setBatchSize(batchSize)
+                      .setVocabSize(vocabSize)
+                      .setMaxInputLength(maxInputLength)
+                      .setRepetitionPenalties(repetitionPenaltyHost)
+                      .setPresencePenalties(presencePenaltyHost)
+                      .setFrequencyPenalties(frequencyPenaltyHost)
+                      .setRepetitionPenaltiesSize(maxBatchSize)
+                      .setPresencePenaltiesSize(maxBatchSize)
+                      .setFrequencyPenaltiesSize(maxBatchSize)
+                      .setMaxTokensPerStep(4)
+                      .setOccurrenceCapacity(occurrenceCapacity));
+}
+
 struct MinLengthPenaltyTestParams
 {
     int32_t batchSize;
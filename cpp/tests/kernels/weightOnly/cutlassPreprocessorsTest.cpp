@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace tc = tensorrt_llm::common;
+using namespace tensorrt_llm::kernels::cutlass_kernels;
+
+namespace
+{
+
+std::vector<int8_t> makeRandomBytes(std::size_t numBytes)
+{
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> distribution{-128, 127};
+    std::vector<int8_t> bytes(numBytes);
+    for (auto& byte : bytes)
+    {
+        byte = static_cast<int8_t>(distribution(generator));
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> toUnsigned(std::vector<int8_t> const& bytes)
+{
+    return {bytes.begin(), bytes.end()};
+}
+
+} // namespace
+
+TEST(CutlassPreprocessorsTest, interleaveInt4s)
+{
+    // Elements 0 to 7 of one register, two per byte with the lower element in the lower bits.
+    std::vector<int8_t> tensor{0x10, 0x32, 0x54, 0x76};
+    add_bias_and_interleave_quantized_tensor_inplace(tensor.data(), 8, QuantType::W4_A16);
+    // Each element biased by 8, the even elements in the lower half of the register and the odd ones in the upper.
+    EXPECT_EQ(toUnsigned(tensor), (std::vector<uint8_t>{0xA8, 0xEC, 0xB9, 0xFD}));
+}
+
+TEST(CutlassPreprocessorsTest, interleaveInt8s)
+{
+    std::vector<int8_t> tensor{0, 1, 2, 3};
+    add_bias_and_interleave_quantized_tensor_inplace(tensor.data(), 4, QuantType::W8_A16);
+    EXPECT_EQ(toUnsigned(tensor), (std::vector<uint8_t>{128, 130, 129, 131}));
+}
+
+TEST(CutlassPreprocessorsTest, illegalSizeThrows)
+{
+    // The relayout works on whole 32-bit registers: 8 int4s or 4 int8s.
+    auto tensor = makeRandomBytes(16);
+    auto const original = tensor;
+    EXPECT_THROW(add_bias_and_interleave_quantized_tensor_inplace(tensor.data(), 12, QuantType::W4_A16),
+        tc::TllmException);
+    EXPECT_THROW(add_bias_and_interleave_quantized_tensor_inplace(tensor.data(), 6, QuantType::W8_A16),
+        tc::TllmException);
+    EXPECT_EQ(tensor, original);
+}
+
+TEST(CutlassPreprocessorsTest, threadCountDoesNotChangeResult)
+{
+    // Large enough to be split over several host threads.
+    std::size_t constexpr numBytes = std::size_t{1} << 22;
+    auto const input = makeRandomBytes(numBytes);
+    for (auto const quantType : {QuantType::W8_A16, QuantType::W4_A16})
+    {
+        auto const numElts = numBytes * 8 / get_weight_quant_bits(quantType);
+        auto expected = input;
+        add_bias_and_interleave_quantized_tensor_inplace(expected.data(), numElts, quantType, 1);
+        for (int const numThreads : {0, 2, 7})
+        {
+            auto actual = input;
+            add_bias_and_interleave_quantized_tensor_inplace(actual.data(), numElts, quantType, numThreads);
+            EXPECT_EQ(actual, expected) << "bits " << get_weight_quant_bits(quantType) << ", threads " << numThreads;
+        }
+
+        std::vector<size_t> const shape{4, 512, numElts / (4 * 512)};
+        std::vector<int8_t> expectedTransposed(numBytes);
+        subbyte_transpose(expectedTransposed.data(), input.data(), shape, quantType, 1);
+        std::vector<int8_t> actualTransposed(numBytes);
+        subbyte_transpose(actualTransposed.data(), input.data(), shape, quantType);
+        EXPECT_EQ(actualTransposed, expectedTransposed) << "bits " << get_weight_quant_bits(quantType);
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/layers/penaltySlots.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace tensorrt_llm::tests::layers
+{
+
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::layers;
+using tensorrt_llm::kernels::DecodingPenaltyType;
+
+TEST(ActivePenaltySlotsTest, setAndRelease)
+{
+    ActivePenaltySlots slots{4};
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::Repetition), 0);
+
+    slots.set(1, DecodingPenaltyType::Repetition, true);
+    slots.set(1, DecodingPenaltyType::Repetition, true);
+    slots.set(2, DecodingPenaltyType::Repetition, true);
+    slots.set(2, DecodingPenaltyType::MinLength, true);
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::Repetition), 2);
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::MinLength), 1);
+    EXPECT_TRUE(slots.isActive(2, DecodingPenaltyType::MinLength));
+    EXPECT_FALSE(slots.isActive(1, DecodingPenaltyType::MinLength));
+
+    std::vector<SizeType32> const batchSlots{3, 1};
+    EXPECT_TRUE(slots.isActive(DecodingPenaltyType::Repetition, batchSlots.data(), 2));
+    EXPECT_FALSE(slots.isActive(DecodingPenaltyType::MinLength, batchSlots.data(), 2));
+    EXPECT_FALSE(slots.isActive(DecodingPenaltyType::Temperature, batchSlots.data(), 2));
+
+    slots.release(1);
+    EXPECT_FALSE(slots.isActive(DecodingPenaltyType::Repetition, batchSlots.data(), 2));
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::Repetition), 1);
+
+    slots.set(2, DecodingPenaltyType::MinLength, false);
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::MinLength), 0);
+}
+
+TEST(ActivePenaltySlotsTest, setFromValues)
+{
+    ActivePenaltySlots slots{4};
+    auto const defaultPenalty = 1.f;
+    std::vector<float> const values{1.2f, defaultPenalty, 0.9f, 1.5f};
+    // Only the slots of the setup are updated.
+    std::vector<SizeType32> const batchSlots{2, 1, 0};
+    slots.set(DecodingPenaltyType::Repetition, batchSlots.data(), 2, values.data(), defaultPenalty);
+    EXPECT_TRUE(slots.isActive(2, DecodingPenaltyType::Repetition));
+    EXPECT_FALSE(slots.isActive(1, DecodingPenaltyType::Repetition));
+    EXPECT_FALSE(slots.isActive(0, DecodingPenaltyType::Repetition));
+    EXPECT_EQ(slots.getNumActive(DecodingPenaltyType::Repetition), 1);
+}
+
+//! \brief Adds and removes requests with random penalties from random slots, as the batch manager does, and checks
+//! the masks against the penalties of the requests in flight after each change and decoding step.
+TEST(ActivePenaltySlotsTest, churn)
+{
+    auto constexpr maxBatchSize = 64;
+    auto constexpr numTypes = ActivePenaltySlots::kNumPenaltyTypes;
+    auto constexpr numSteps = 5000;
+    std::mt19937 generator{42};
+    std::bernoulli_distribution usesPenalty{0.1};
+    std::bernoulli_distribution finishes{0.05};
+
+    ActivePenaltySlots slots{maxBatchSize};
+    // Penalties of the request in each slot, empty if the slot is free.
+    std::vector<std::vector<bool>> requests(maxBatchSize);
+    std::vector<SizeType32> batchSlots;
+
+    auto const checkMasks = [&]()
+    {
+        for (SizeType32 type = 0; type < numTypes; ++type)
+        {
+            auto const penaltyType = static_cast<DecodingPenaltyType>(type);
+            SizeType32 numActive = 0;
+            for (SizeType32 slot = 0; slot < maxBatchSize; ++slot)
+            {
+                auto const active = !requests[slot].empty() && requests[slot][type];
+                ASSERT_EQ(slots.isActive(slot, penaltyType), active) << "slot " << slot << " type " << type;
+                numActive += active;
+            }
+            ASSERT_EQ(slots.getNumActive(penaltyType), numActive);
+            auto const anyInBatch = std::any_of(batchSlots.begin(), batchSlots.end(),
+                [&](SizeType32 slot) { return requests[slot][type]; });
+            ASSERT_EQ(slots.isActive(penaltyType, batchSlots.data(), batchSlots.size()), anyInBatch);
+        }
+    };
+
+    SizeType32 numActiveSteps = 0;
+    for (SizeType32 step = 0; step < numSteps; ++step)
+    {
+        for (SizeType32 slot = 0; slot < maxBatchSize; ++slot)
+        {
+            if (requests[slot].empty())
+            {
+                std::vector<bool> penalties(numTypes);
+                std::generate(penalties.begin(), penalties.end(), [&]() { return usesPenalty(generator); });
+                for (SizeType32 type = 0; type < numTypes; ++type)
+                {
+                    slots.set(slot, static_cast<DecodingPenaltyType>(type), penalties[type]);
+                }
+                requests[slot] = penalties;
+            }
+            else if (finishes(generator))
+            {
+                slots.release(slot);
+                requests[slot].clear();
+            }
+        }
+
+        // A step decodes a random subset of the requests in flight.
+        batchSlots.clear();
+        for (SizeType32 slot = 0; slot < maxBatchSize; ++slot)
+        {
+            if (!requests[slot].empty() && generator() % 4 == 0)
+            {
+                batchSlots.push_back(slot);
+            }
+        }
+        ASSERT_NO_FATAL_FAILURE(checkMasks()) << "at step " << step;
+        numActiveSteps += slots.isActive(DecodingPenaltyType::Repetition, batchSlots.data(), batchSlots.size());
+    }
+    // Some steps apply the penalty and some skip it.
+    EXPECT_GT(numActiveSteps, 0);
+    EXPECT_LT(numActiveSteps, numSteps);
+}
+
+} // namespace tensorrt_llm::tests::layers
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/chunkedPrefillPlanner.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+using Chunks = std::vector<SizeType32>;
+
+// 5 ms per step plus 10 us per token, 500 tokens fit in 10 ms.
+auto const kModel = ChunkedPrefillPlanner::StepTimeModel{5., 0.01};
+auto constexpr kTargetMs = 10.;
+
+} // namespace
+
+TEST(ChunkedPrefillPlannerTest, noTargetFillsBudget)
+{
+    ChunkedPrefillPlanner const planner{256, 16, kModel};
+    auto const plan = planner.plan({100, 300, 20}, 10);
+    EXPECT_EQ(plan.chunkSizes, (Chunks{100, 144, 0}));
+    EXPECT_EQ(plan.numTokens, 254);
+    EXPECT_DOUBLE_EQ(plan.estimatedMs, kModel.estimateMs(254));
+}
+
+TEST(ChunkedPrefillPlannerTest, targetLimitsPrefillWithGeneration)
+{
+    ChunkedPrefillPlanner const planner{8192, 64, kModel, kTargetMs};
+    auto plan = planner.plan({1000, 30}, 100);
+    EXPECT_EQ(plan.chunkSizes, (Chunks{384, 0}));
+    EXPECT_EQ(plan.numTokens, 484);
+    EXPECT_LE(plan.estimatedMs, kTargetMs);
+
+    // Without generation requests there is no token latency to protect.
+    plan = planner.plan({1000, 30}, 0);
+    EXPECT_EQ(plan.chunkSizes, (Chunks{1000, 30}));
+}
+
+TEST(ChunkedPrefillPlannerTest, shortContextFillsLeftover)
+{
+    ChunkedPrefillPlanner const planner{8192, 64, kModel, kTargetMs};
+    auto const plan = planner.plan({1000, 10}, 100);
+    EXPECT_EQ(plan.chunkSizes, (Chunks{384, 10}));
+}
+
+TEST(ChunkedPrefillPlannerTest, progressWhenTargetUnreachable)
+{
+    ChunkedPrefillPlanner const planner{8192, 64, kModel, kTargetMs};
+    EXPECT_EQ(planner.getPrefillBudget(600), 64);
+    EXPECT_EQ(planner.plan({1000}, 600).chunkSizes, (Chunks{64}));
+    // But never over the token budget.
+    EXPECT_EQ(planner.getPrefillBudget(8192), 0);
+}
+
+TEST(ChunkedPrefillPlannerTest, stepTimeModel)
+{
+    EXPECT_EQ(kModel.maxTokens(kTargetMs), 500);
+    EXPECT_EQ(kModel.maxTokens(4.), 0);
+
+    auto const fitted = ChunkedPrefillPlanner::StepTimeModel::fit({{100, 6.}, {300, 8.}, {500, 10.}});
+    EXPECT_NEAR(fitted.fixedMs, 5., 1e-9);
+    EXPECT_NEAR(fitted.perTokenMs, 0.01, 1e-12);
+
+    // Noisy samples whose unconstrained fit has a negative intercept or slope get the best non-negative fit.
+    auto const throughOrigin = ChunkedPrefillPlanner::StepTimeModel::fit({{100, 1.}, {200, 3.}, {300, 5.}});
+    EXPECT_EQ(throughOrigin.fixedMs, 0.);
+    EXPECT_NEAR(throughOrigin.perTokenMs, 2200. / 140000., 1e-12);
+    auto const constant = ChunkedPrefillPlanner::StepTimeModel::fit({{100, 5.}, {300, 4.}, {500, 3.}});
+    EXPECT_NEAR(constant.fixedMs, 4., 1e-12);
+    EXPECT_EQ(constant.perTokenMs, 0.);
+    ChunkedPrefillPlanner planner{8192, 64, kModel, kTargetMs};
+    EXPECT_NO_THROW(planner.setStepTimeModel(throughOrigin));
+    EXPECT_NO_THROW(planner.setStepTimeModel(constant));
+
+    EXPECT_THROW(static_cast<void>(ChunkedPrefillPlanner::StepTimeModel::fit({{100, 6.}})),
+        tensorrt_llm::common::TllmException);
+    EXPECT_THROW(static_cast<void>(ChunkedPrefillPlanner::StepTimeModel::fit({{100, 6.}, {100, 7.}})),
+        tensorrt_llm::common::TllmException);
+}
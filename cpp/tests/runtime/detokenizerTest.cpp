@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/detokenizer.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+// Byte-level BPE in the GPT-2 style. "ðŁĺĢ" is the byte-level spelling of U+1F600 (F0 9F 98 80), split in two tokens.
+auto constexpr kByteLevelTokenizer = R"({
+    "added_tokens": [{"id": 7, "content": "<|endoftext|>", "special": true}],
+    "decoder": {"type": "ByteLevel", "add_prefix_space": false, "trim_offsets": true, "use_regex": true},
+    "model": {"type": "BPE", "vocab": {
+        "Hello": 0, "Ġworld": 1, "!": 2, "Ã": 3, "©": 4, "ðŁ": 5, "ĺĢ": 6, "<|endoftext|>": 7, "Ċ": 8}}
+})";
+
+// SentencePiece exported as BPE with byte fallback, Llama-2 style.
+auto constexpr kSentencePieceTokenizer = R"({
+    "added_tokens": [
+        {"id": 0, "content": "<unk>", "special": true},
+        {"id": 1, "content": "<s>", "special": true},
+        {"id": 2, "content": "</s>", "special": true}],
+    "decoder": {"type": "Sequence", "decoders": [
+        {"type": "Replace", "pattern": {"String": "▁"}, "content": " "},
+        {"type": "ByteFallback"},
+        {"type": "Fuse"},
+        {"type": "Strip", "content": " ", "start": 1, "stop": 0}]},
+    "model": {"type": "BPE", "byte_fallback": true, "vocab": {
+        "<unk>": 0, "<s>": 1, "</s>": 2, "<0x0A>": 3, "<0xE2>": 4, "<0x82>": 5, "<0xAC>": 6,
+        "▁Hello": 7, "▁world": 8, "!": 9, "▁cost": 10}}
+})";
+
+// SentencePiece Unigram with a Metaspace decoder.
+auto constexpr kUnigramTokenizer = R"({
+    "added_tokens": [{"id": 0, "content": "<pad>", "special": true}],
+    "decoder": {"type": "Metaspace", "replacement": "▁", "add_prefix_space": true},
+    "model": {"type": "Unigram", "unk_id": 2, "vocab": [
+        ["<pad>", 0.0], ["▁Guten", -1.5], ["<unk>", 0.0], ["▁Tag", -2.0], ["s", -3.0]]}
+})";
+
+std::string concat(std::vector<TextDelta> const& deltas)
+{
+    std::string text;
+    for (auto const& delta : deltas)
+    {
+        if (delta.isReset)
+        {
+            text.clear();
+        }
+        text += delta.text;
+    }
+    return text;
+}
+
+} // namespace
+
+TEST(DetokenizerTest, byteLevelDecode)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    EXPECT_EQ(detokenizer->getVocabSize(), 9);
+    EXPECT_EQ(detokenizer->getTokenBytes(1), " world");
+    EXPECT_EQ(detokenizer->getTokenBytes(5), "\xF0\x9F");
+    EXPECT_TRUE(detokenizer->isSpecial(7));
+    EXPECT_FALSE(detokenizer->isSpecial(0));
+
+    EXPECT_EQ(detokenizer->decode({0, 1, 2, 8}), "Hello world!\n");
+    EXPECT_EQ(detokenizer->decode({0, 3, 4, 5, 6, 7}), "Hello\xC3\xA9\xF0\x9F\x98\x80");
+    EXPECT_EQ(detokenizer->decode({0, 7}, false), "Hello<|endoftext|>");
+    // A lone continuation byte is invalid.
+    EXPECT_EQ(detokenizer->decode({4, 0}), "\xEF\xBF\xBDHello");
+    EXPECT_THROW((void) detokenizer->decode({9}), common::TllmException);
+}
+
+TEST(DetokenizerTest, sentencePieceDecode)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kSentencePieceTokenizer);
+    EXPECT_EQ(detokenizer->getNumLeadingSpacesToStrip(), 1);
+    EXPECT_EQ(detokenizer->getTokenBytes(3), "\n");
+    EXPECT_EQ(detokenizer->decode({1, 7, 8, 9, 2}), "Hello world!");
+    EXPECT_EQ(detokenizer->decode({10, 4, 5, 6}), "cost\xE2\x82\xAC");
+}
+
+TEST(DetokenizerTest, unigramDecode)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kUnigramTokenizer);
+    EXPECT_EQ(detokenizer->decode({0, 1, 3, 4}), "Guten Tags");
+}
+
+TEST(DetokenizerTest, streamMultiByte)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    DetokenizerStream stream(detokenizer);
+
+    EXPECT_EQ(stream.step({0}).text, "Hello");
+    EXPECT_EQ(stream.step({3}).text, "");
+    EXPECT_EQ(stream.step({4}).text, "\xC3\xA9");
+    EXPECT_EQ(stream.step({5}).text, "");
+    EXPECT_EQ(stream.step({6, 1}).text, "\xF0\x9F\x98\x80 world");
+    EXPECT_EQ(stream.step({7}).text, "");
+    EXPECT_EQ(stream.finish().text, "");
+    EXPECT_EQ(stream.getNumTokens(), 7);
+}
+
+TEST(DetokenizerTest, streamByteFallback)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kSentencePieceTokenizer);
+    DetokenizerStream stream(detokenizer);
+
+    std::vector<TextDelta> deltas;
+    for (TokenIdType const token : {1, 7, 10, 4, 5, 6, 3})
+    {
+        deltas.push_back(stream.step({token}));
+    }
+    EXPECT_EQ(deltas[0].text, "");
+    EXPECT_EQ(deltas[1].text, "Hello");
+    EXPECT_EQ(deltas[2].text, " cost");
+    EXPECT_EQ(deltas[3].text, "");
+    EXPECT_EQ(deltas[4].text, "");
+    EXPECT_EQ(deltas[5].text, "\xE2\x82\xAC");
+    EXPECT_EQ(deltas[6].text, "\n");
+}
+
+TEST(DetokenizerTest, streamPrime)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kSentencePieceTokenizer);
+    DetokenizerStream stream(detokenizer);
+    stream.prime({1, 7, 4});
+    // The leading space is kept, and the euro sign started in the prompt is completed.
+    EXPECT_EQ(stream.step({5, 6, 8}).text, "\xE2\x82\xAC world");
+}
+
+TEST(DetokenizerTest, streamFinishIncomplete)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kSentencePieceTokenizer);
+    DetokenizerStream stream(detokenizer);
+    EXPECT_EQ(stream.step({7, 4, 5}).text, "Hello");
+    EXPECT_EQ(stream.finish().text, "\xEF\xBF\xBD");
+}
+
+TEST(DetokenizerTest, stopStringAcrossTokens)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    DetokenizerStream stream(detokenizer, {"xyz", "o w"});
+
+    std::vector<TextDelta> deltas;
+    deltas.push_back(stream.step({0}));
+    EXPECT_FALSE(deltas.back().isStopped);
+    deltas.push_back(stream.step({1}));
+    EXPECT_TRUE(deltas.back().isStopped);
+    EXPECT_EQ(deltas.back().stopStringIdx, 1);
+    EXPECT_EQ(concat(deltas), "Hell");
+    EXPECT_TRUE(stream.isStopped());
+
+    auto const after = stream.step({2});
+    EXPECT_TRUE(after.isStopped);
+    EXPECT_EQ(after.text, "");
+}
+
+TEST(DetokenizerTest, stopStringIncluded)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    DetokenizerStream stream(detokenizer, {"d!"}, true, true);
+    std::vector<TextDelta> deltas;
+    for (TokenIdType const token : {0, 1, 2, 8})
+    {
+        deltas.push_back(stream.step({token}));
+    }
+    EXPECT_EQ(concat(deltas), "Hello world!");
+    EXPECT_TRUE(deltas[2].isStopped);
+}
+
+TEST(DetokenizerTest, stopStringHoldBackFlushed)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    DetokenizerStream stream(detokenizer, {"!!"});
+    std::vector<TextDelta> deltas;
+    deltas.push_back(stream.step({0, 2}));
+    EXPECT_EQ(deltas.back().text, "Hello");
+    deltas.push_back(stream.step({3, 4}));
+    deltas.push_back(stream.finish());
+    EXPECT_FALSE(deltas.back().isStopped);
+    EXPECT_EQ(concat(deltas), "Hello!\xC3\xA9");
+}
+
+TEST(DetokenizerTest, stepAllBeamReordering)
+{
+    auto const detokenizer = Detokenizer::fromJsonString(kByteLevelTokenizer);
+    DetokenizerStream stream(detokenizer);
+
+    std::vector<TextDelta> deltas;
+    deltas.push_back(stream.stepAll({0}));
+    deltas.push_back(stream.stepAll({0, 1}));
+    EXPECT_FALSE(deltas.back().isReset);
+    EXPECT_EQ(deltas.back().text, " world");
+    deltas.push_back(stream.stepAll({0, 2, 2}));
+    EXPECT_TRUE(deltas.back().isReset);
+    EXPECT_EQ(deltas.back().text, "Hello!!");
+    EXPECT_EQ(concat(deltas), "Hello!!");
+}
+
+} // namespace tensorrt_llm::runtime
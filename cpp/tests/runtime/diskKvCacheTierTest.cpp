@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/diskKvCacheTier.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <unistd.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+auto constexpr kBlockSize = std::size_t{5000};
+auto constexpr kTokensPerBlock = 4;
+
+VecUniqueTokens makeTokens(std::initializer_list<TokenIdType> tokens)
+{
+    VecUniqueTokens uniqueTokens;
+    for (auto const token : tokens)
+    {
+        uniqueTokens.push_back({token, 0});
+    }
+    return uniqueTokens;
+}
+
+std::vector<std::uint8_t> makeBlock(std::uint8_t value)
+{
+    return std::vector<std::uint8_t>(kBlockSize, value);
+}
+
+class DiskKvCacheTierTest : public ::testing::Test // NOLINT
+{
+protected:
+    void SetUp() override
+    {
+        mPath = std::filesystem::temp_directory_path() / ("diskKvCacheTierTest." + std::to_string(::getpid()));
+        std::filesystem::remove(mPath);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(mPath);
+    }
+
+    //! \brief Prefetch hashes and return the read blocks.
+    static std::vector<std::vector<std::uint8_t>> prefetch(
+        DiskKvCacheTier& tier, std::vector<DiskKvCacheTier::BlockHash> const& hashes)
+    {
+        std::vector<std::vector<std::uint8_t>> blocks(hashes.size(), std::vector<std::uint8_t>(kBlockSize));
+        std::vector<void*> pointers;
+        for (auto& block : blocks)
+        {
+            pointers.push_back(block.data());
+        }
+        blocks.resize(tier.prefetch(hashes, pointers).get());
+        return blocks;
+    }
+
+    std::filesystem::path mPath;
+};
+
+} // namespace
+
+TEST_F(DiskKvCacheTierTest, hashBlocks)
+{
+    auto const tokens = makeTokens({1, 2, 3, 4, 5, 6, 7, 8, 9});
+    auto const hashes = DiskKvCacheTier::hashBlocks(tokens, kTokensPerBlock);
+    // The partial last block is not hashed.
+    ASSERT_EQ(hashes.size(), 2);
+    EXPECT_NE(hashes[0], hashes[1]);
+
+    // The second block depends on the first one.
+    auto const other = DiskKvCacheTier::hashBlocks(makeTokens({0, 2, 3, 4, 5, 6, 7, 8}), kTokensPerBlock);
+    EXPECT_NE(other[0], hashes[0]);
+    EXPECT_NE(other[1], hashes[1]);
+    EXPECT_EQ(DiskKvCacheTier::hashBlocks(makeTokens({1, 2, 3, 4}), kTokensPerBlock)[0], hashes[0]);
+    EXPECT_NE(DiskKvCacheTier::hashBlocks(tokens, kTokensPerBlock, 3)[0], hashes[0]);
+}
+
+TEST_F(DiskKvCacheTierTest, storeAndPrefetch)
+{
+    auto const hashes
+        = DiskKvCacheTier::hashBlocks(makeTokens({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}), kTokensPerBlock);
+    DiskKvCacheTier tier(mPath, kBlockSize, 8);
+    EXPECT_EQ(tier.matchPrefix(hashes), 0);
+    EXPECT_TRUE(tier.store(hashes[0], makeBlock(1).data()));
+    EXPECT_TRUE(tier.store(hashes[1], makeBlock(2).data()));
+    EXPECT_FALSE(tier.store(hashes[1], makeBlock(2).data()));
+
+    // Queued or written, depending on the I/O thread.
+    EXPECT_EQ(tier.matchPrefix(hashes), 2);
+    auto blocks = prefetch(tier, hashes);
+    ASSERT_EQ(blocks.size(), 2);
+    EXPECT_EQ(blocks[0], makeBlock(1));
+    EXPECT_EQ(blocks[1], makeBlock(2));
+
+    tier.flush();
+    EXPECT_EQ(tier.getNumStoredBlocks(), 2);
+    blocks = prefetch(tier, {hashes[0], hashes[2], hashes[1]});
+    ASSERT_EQ(blocks.size(), 1);
+    EXPECT_EQ(blocks[0], makeBlock(1));
+    EXPECT_EQ(tier.getStats().numWrites, 2);
+}
+
+TEST_F(DiskKvCacheTierTest, persistence)
+{
+    {
+        DiskKvCacheTier tier(mPath, kBlockSize, 4);
+        for (std::uint8_t i = 0; i < 3; ++i)
+        {
+            tier.store(100 + i, makeBlock(i).data());
+        }
+    }
+    {
+        DiskKvCacheTier tier(mPath, kBlockSize, 4);
+        EXPECT_EQ(tier.getNumStoredBlocks(), 3);
+        EXPECT_EQ(tier.matchPrefix({100, 101, 102, 103}), 3);
+        auto const blocks = prefetch(tier, {102});
+        ASSERT_EQ(blocks.size(), 1);
+        EXPECT_EQ(blocks[0], makeBlock(2));
+    }
+    // Another geometry starts from an empty tier.
+    DiskKvCacheTier tier(mPath, kBlockSize * 2, 4);
+    EXPECT_EQ(tier.getNumStoredBlocks(), 0);
+}
+
+TEST_F(DiskKvCacheTierTest, eviction)
+{
+    std::optional<DiskKvCacheTier> tier;
+    tier.emplace(mPath, kBlockSize, 2);
+    tier->store(1, makeBlock(1).data());
+    tier->store(2, makeBlock(2).data());
+    tier->flush();
+    // Reading 1 makes 2 the least recently used block.
+    EXPECT_EQ(prefetch(*tier, {1}).size(), 1);
+    tier->store(3, makeBlock(3).data());
+    tier->flush();
+
+    EXPECT_EQ(tier->matchPrefix({1}), 1);
+    EXPECT_EQ(tier->matchPrefix({2}), 0);
+    auto const blocks = prefetch(*tier, {3});
+    ASSERT_EQ(blocks.size(), 1);
+    EXPECT_EQ(blocks[0], makeBlock(3));
+    EXPECT_EQ(tier->getStats().numEvictions, 1);
+
+    // The index on disk reflects the eviction.
+    tier.reset();
+    tier.emplace(mPath, kBlockSize, 2);
+    EXPECT_EQ(tier->matchPrefix({1}), 1);
+    EXPECT_EQ(tier->matchPrefix({2}), 0);
+    EXPECT_EQ(tier->matchPrefix({3}), 1);
+}
+
+} // namespace tensorrt_llm::runtime
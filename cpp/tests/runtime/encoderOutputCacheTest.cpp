@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/encoderOutputCache.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <numeric>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace tb = tensorrt_llm::batch_manager;
+
+class EncoderOutputCacheTest : public ::testing::Test // NOLINT(cppcoreguidelines-pro-type-member-init)
+{
+protected:
+    static auto constexpr kHiddenSize = 16;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mManager = std::make_unique<BufferManager>(mStream);
+    }
+
+    //! \brief A host encoder output of length tokens, filled with value.
+    static ITensor::SharedPtr makeOutput(SizeType32 length, float value)
+    {
+        auto output = BufferManager::cpu(ITensor::makeShape({length, kHiddenSize}), nvinfer1::DataType::kFLOAT);
+        auto* data = bufferCast<float>(*output);
+        std::fill_n(data, output->getSize(), value);
+        return output;
+    }
+
+    static std::shared_ptr<tb::LlmRequest> makeRequest(
+        tb::LlmRequest::RequestIdType requestId, std::vector<TokenIdType> encoderTokens, bool returnEncoderOutput)
+    {
+        auto const inputTokens = std::make_shared<std::vector<TokenIdType>>(1, 0);
+        return std::make_shared<tb::LlmRequest>(requestId, 8, inputTokens, SamplingConfig{1}, false, std::nullopt,
+            std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+            std::nullopt, std::nullopt, std::nullopt, std::nullopt, false, false, false, std::nullopt, std::nullopt,
+            false, std::nullopt, false, std::make_shared<std::vector<TokenIdType>>(std::move(encoderTokens)),
+            returnEncoderOutput);
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::unique_ptr<BufferManager> mManager;
+};
+
+TEST_F(EncoderOutputCacheTest, KeyDerivation)
+{
+    EncoderOutputCache cache{"t5-small", 1 << 20, MemoryType::kCPU};
+    EncoderOutputCache otherModel{"t5-base", 1 << 20, MemoryType::kCPU};
+    std::vector<TokenIdType> const tokens{1, 2, 3, 4, 5};
+
+    EXPECT_EQ(cache.makeKey(tokens), cache.makeKey(tokens));
+    EXPECT_FALSE(cache.makeKey(tokens) == cache.makeKey(std::vector<TokenIdType>{1, 2, 3, 4, 6}));
+    EXPECT_FALSE(cache.makeKey(tokens) == cache.makeKey(std::vector<TokenIdType>{1, 2, 3, 4}));
+    EXPECT_FALSE(cache.makeKey(tokens) == otherModel.makeKey(tokens));
+    EXPECT_FALSE(cache.makeKey(tokens) == cache.makeKey(tokens, 0));
+    EXPECT_FALSE(cache.makeKey(tokens, 1) == cache.makeKey(tokens, 2));
+
+    // Features are keyed by their type, shape and contents.
+    auto const features = BufferManager::cpu(ITensor::makeShape({4, 2}), nvinfer1::DataType::kINT32);
+    std::iota(bufferCast<std::int32_t>(*features), bufferCast<std::int32_t>(*features) + features->getSize(), 0);
+    auto const key = cache.makeKey(*features);
+    EXPECT_EQ(cache.makeKey(*features), key);
+    features->reshape(ITensor::makeShape({2, 4}));
+    EXPECT_FALSE(cache.makeKey(*features) == key);
+    features->reshape(ITensor::makeShape({4, 2}));
+    bufferCast<std::int32_t>(*features)[7] = 0;
+    EXPECT_FALSE(cache.makeKey(*features) == key);
+
+    auto const tokenFeatures = BufferManager::cpu(ITensor::makeShape({5}), nvinfer1::DataType::kINT32);
+    std::copy(tokens.begin(), tokens.end(), bufferCast<TokenIdType>(*tokenFeatures));
+    EXPECT_FALSE(cache.makeKey(*tokenFeatures) == cache.makeKey(tokens));
+}
+
+TEST_F(EncoderOutputCacheTest, LookupAndInsert)
+{
+    EncoderOutputCache cache{"model", 1 << 20, MemoryType::kCPU};
+    auto const key = cache.makeKey(std::vector<TokenIdType>{1, 2, 3});
+    EXPECT_EQ(cache.lookup(key), nullptr);
+
+    auto const output = makeOutput(3, 1.F);
+    cache.insert(key, *output, *mManager);
+    // The cache holds a copy.
+    std::fill_n(bufferCast<float>(*output), output->getSize(), 2.F);
+
+    auto const cached = cache.lookup(key);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->getMemoryType(), MemoryType::kCPU);
+    EXPECT_EQ(cached->getShape().d[0], 3);
+    EXPECT_EQ(bufferCast<float>(*cached)[0], 1.F);
+
+    auto const stats = cache.getStats();
+    EXPECT_EQ(stats.numHits, 1u);
+    EXPECT_EQ(stats.numMisses, 1u);
+    EXPECT_EQ(stats.numInsertions, 1u);
+    EXPECT_EQ(stats.numEntries, 1u);
+    EXPECT_EQ(stats.usedBytes, output->getSizeInBytes());
+
+    cache.clear();
+    EXPECT_EQ(cache.lookup(key), nullptr);
+    EXPECT_EQ(cache.getStats().usedBytes, 0u);
+}
+
+TEST_F(EncoderOutputCacheTest, EvictsLeastRecentlyUsed)
+{
+    auto const entryBytes = makeOutput(4, 0.F)->getSizeInBytes();
+    EncoderOutputCache cache{"model", 2 * entryBytes, MemoryType::kCPU};
+    auto const keyA = cache.makeKey(std::vector<TokenIdType>{1});
+    auto const keyB = cache.makeKey(std::vector<TokenIdType>{2});
+    auto const keyC = cache.makeKey(std::vector<TokenIdType>{3});
+
+    cache.insert(keyA, *makeOutput(4, 1.F), *mManager);
+    cache.insert(keyB, *makeOutput(4, 2.F), *mManager);
+    ASSERT_NE(cache.lookup(keyA), nullptr);
+    cache.insert(keyC, *makeOutput(4, 3.F), *mManager);
+
+    EXPECT_EQ(cache.lookup(keyB), nullptr);
+    EXPECT_NE(cache.lookup(keyA), nullptr);
+    EXPECT_NE(cache.lookup(keyC), nullptr);
+    EXPECT_EQ(cache.getStats().numEvictions, 1u);
+    EXPECT_EQ(cache.getStats().usedBytes, 2 * entryBytes);
+
+    // Replacing an entry does not count as an eviction, and outputs larger than the cache are not cached.
+    cache.insert(keyA, *makeOutput(4, 4.F), *mManager);
+    EXPECT_EQ(bufferCast<float>(*cache.lookup(keyA))[0], 4.F);
+    cache.insert(keyB, *makeOutput(12, 5.F), *mManager);
+    EXPECT_EQ(cache.lookup(keyB), nullptr);
+    auto const stats = cache.getStats();
+    EXPECT_EQ(stats.numEvictions, 1u);
+    EXPECT_EQ(stats.numEntries, 2u);
+}
+
+TEST_F(EncoderOutputCacheTest, SkipsEncoderPhase)
+{
+    EncoderOutputCache cache{"model", 1 << 20, MemoryType::kCPU};
+    std::vector<TokenIdType> const source{11, 12, 13, 14};
+
+    auto first = makeRequest(1, source, false);
+    ASSERT_TRUE(first->isEncoderInitState());
+    EXPECT_FALSE(cache.loadEncoderOutput(*first, *mManager));
+    EXPECT_TRUE(first->isEncoderInitState());
+
+    // The encoder ran for the first request.
+    first->setEncoderOutput(makeOutput(4, 7.F));
+    cache.storeEncoderOutput(*first, *mManager);
+
+    auto retry = makeRequest(2, source, true);
+    ASSERT_TRUE(cache.loadEncoderOutput(*retry, *mManager));
+    EXPECT_TRUE(retry->isContextInitState());
+    auto const output = mManager->copyFrom(*retry->getEncoderOutput(), MemoryType::kCPU);
+    mManager->getStream().synchronize();
+    EXPECT_EQ(output->getShape().d[0], 4);
+    EXPECT_EQ(output->getShape().d[1], kHiddenSize);
+    EXPECT_EQ(bufferCast<float>(*output)[0], 7.F);
+    ASSERT_NE(retry->getEncoderOutputHost(), nullptr);
+    EXPECT_EQ(retry->getEncoderOutputHost()->getSize(), output->getSize());
+
+    // Writing to the returned host output leaves the cached entry intact.
+    bufferCast<float>(*retry->getEncoderOutputHost())[0] = -1.F;
+    auto again = makeRequest(4, source, true);
+    ASSERT_TRUE(cache.loadEncoderOutput(*again, *mManager));
+    mManager->getStream().synchronize();
+    EXPECT_EQ(bufferCast<float>(*again->getEncoderOutputHost())[0], 7.F);
+
+    // A request past its encoder phase is left alone.
+    EXPECT_FALSE(cache.loadEncoderOutput(*retry, *mManager));
+    auto other = makeRequest(3, {11, 12, 13}, false);
+    EXPECT_FALSE(cache.loadEncoderOutput(*other, *mManager));
+    EXPECT_TRUE(other->isEncoderInitState());
+}
+
+} // namespace tensorrt_llm::runtime
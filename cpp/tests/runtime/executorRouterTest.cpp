@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/executorRouter.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+using namespace tensorrt_llm::runtime;
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+auto constexpr kTokensPerBlock = 4;
+
+//! \brief A prompt of numBlocks full blocks, whose first numSharedBlocks blocks are the same for all prompts.
+texec::VecTokens makePrompt(SizeType32 numSharedBlocks, SizeType32 numBlocks, texec::TokenIdType id)
+{
+    texec::VecTokens tokens(numBlocks * kTokensPerBlock);
+    std::iota(tokens.begin(), tokens.begin() + numSharedBlocks * kTokensPerBlock, 0);
+    std::fill(tokens.begin() + numSharedBlocks * kTokensPerBlock, tokens.end(), id);
+    return tokens;
+}
+
+//! \brief Iteration stats as reported by an executor with numRequests active requests.
+texec::IterationStats makeStats(SizeType32 numRequests, std::optional<SizeType32> freeKvBlocks = std::nullopt)
+{
+    texec::IterationStats stats{};
+    stats.numActiveRequests = numRequests;
+    stats.numQueuedRequests = 0;
+    if (freeKvBlocks)
+    {
+        stats.kvCacheStats = texec::KvCacheStats{};
+        stats.kvCacheStats->freeNumBlocks = *freeKvBlocks;
+    }
+    return stats;
+}
+
+} // namespace
+
+TEST(ExecutorRouterTest, roundRobin)
+{
+    ExecutorRouter router{3, ExecutorRouter::Policy::kROUND_ROBIN, kTokensPerBlock};
+    auto const prompt = makePrompt(2, 2, 0);
+    for (SizeType32 i = 0; i < 7; ++i)
+    {
+        EXPECT_EQ(router.route(prompt), i % 3);
+    }
+    EXPECT_EQ(router.getLoad(0), 3);
+    EXPECT_EQ(router.getLoad(1), 2);
+    EXPECT_EQ(router.getStats().numRouted, 7);
+    EXPECT_EQ(router.getStats().numPrefixHits, 0);
+}
+
+TEST(ExecutorRouterTest, leastLoaded)
+{
+    ExecutorRouter router{3, ExecutorRouter::Policy::kLEAST_LOADED, kTokensPerBlock};
+    auto const prompt = makePrompt(2, 2, 0);
+    EXPECT_EQ(router.route(prompt), 0);
+    EXPECT_EQ(router.route(prompt), 1);
+    EXPECT_EQ(router.route(prompt), 2);
+
+    router.onFinished(1);
+    EXPECT_EQ(router.getLoad(1), 0);
+    EXPECT_EQ(router.route(prompt), 1);
+
+    // Requests enqueued on the instance by others count once they are reported.
+    router.updateLoad(0, makeStats(5));
+    EXPECT_EQ(router.getLoad(0), 5);
+    router.onFinished(1);
+    router.onFinished(2);
+    EXPECT_EQ(router.route(prompt), 2);
+    EXPECT_EQ(router.route(prompt), 1);
+
+    // Ties go to the instance with the most free KV cache blocks.
+    router.updateLoad(1, makeStats(1, 100));
+    router.updateLoad(2, makeStats(1, 10));
+    EXPECT_EQ(router.route(prompt), 1);
+
+    router.onFinished(0);
+    EXPECT_THROW(router.onFinished(0), tensorrt_llm::common::TllmException);
+}
+
+TEST(ExecutorRouterTest, prefixAffinity)
+{
+    ExecutorRouter router{3, ExecutorRouter::Policy::kPREFIX_AFFINITY, kTokensPerBlock, 1024, 2};
+    auto const first = router.route(makePrompt(3, 4, 100));
+    // Prompts sharing a prefix follow the first one, while the others spread over the idle instances.
+    EXPECT_EQ(router.route(makePrompt(3, 5, 101)), first);
+    EXPECT_EQ(router.route(makePrompt(1, 3, 102)), first);
+    EXPECT_NE(router.route(makePrompt(0, 4, 103)), first);
+    auto const stats = router.getStats();
+    EXPECT_EQ(stats.numPrefixHits, 2);
+    EXPECT_EQ(stats.numRebalanced, 0);
+
+    // Prompts shorter than a block have no prefix to follow.
+    texec::VecTokens const shortPrompt(kTokensPerBlock - 1, 0);
+    EXPECT_NE(router.route(shortPrompt), first);
+}
+
+TEST(ExecutorRouterTest, prefixAffinityRebalances)
+{
+    ExecutorRouter router{2, ExecutorRouter::Policy::kPREFIX_AFFINITY, kTokensPerBlock, 1024, 2};
+    auto const prompt = makePrompt(2, 2, 0);
+    auto const first = router.route(prompt);
+    EXPECT_EQ(router.route(prompt), first);
+    EXPECT_EQ(router.route(prompt), first);
+    // The instance with the prefix is now 3 requests above the idle one.
+    auto const other = router.route(prompt);
+    EXPECT_NE(other, first);
+    EXPECT_EQ(router.getStats().numRebalanced, 1);
+    // The prefix follows the instance it was sent to last.
+    EXPECT_EQ(router.route(prompt), other);
+}
+
+TEST(ExecutorRouterTest, prefixEviction)
+{
+    ExecutorRouter router{2, ExecutorRouter::Policy::kPREFIX_AFFINITY, kTokensPerBlock, 2};
+    auto const first = router.route(makePrompt(1, 1, 0));
+    router.onFinished(first);
+    // Two other blocks are remembered after the first prompt, which evicts it.
+    auto const second = router.route(makePrompt(0, 2, 1));
+    router.onFinished(second);
+    static_cast<void>(router.route(makePrompt(1, 1, 0)));
+    EXPECT_EQ(router.getStats().numPrefixHits, 0);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/runtime/fusedSamplingConfigBuilder.h"
+
+#include <random>
+#include <vector>
+
+namespace tr = tensorrt_llm::runtime;
+
+using tr::FusedSamplingConfigBuilder;
+using tr::SamplingConfig;
+using tr::SizeType32;
+
+namespace
+{
+
+SamplingConfig makeConfig(float temperature, SizeType32 topK)
+{
+    SamplingConfig config;
+    config.temperature = std::vector<float>{temperature};
+    config.topK = std::vector<SizeType32>{topK};
+    config.randomSeed = std::vector<uint64_t>{42};
+    return config;
+}
+
+//! \brief Expands the fields of a fused config that hold a single value to batchSize values.
+SamplingConfig expand(SamplingConfig config, std::size_t batchSize)
+{
+    auto const expandField = [batchSize](auto& field)
+    {
+        if (field && field->size() == 1)
+        {
+            auto const value = field->front();
+            field->assign(batchSize, value);
+        }
+    };
+    expandField(config.temperature);
+    expandField(config.minLength);
+    expandField(config.repetitionPenalty);
+    expandField(config.presencePenalty);
+    expandField(config.frequencyPenalty);
+    expandField(config.noRepeatNgramSize);
+    expandField(config.topK);
+    expandField(config.topP);
+    expandField(config.randomSeed);
+    expandField(config.topPDecay);
+    expandField(config.topPMin);
+    expandField(config.topPResetIds);
+    expandField(config.beamSearchDiversityRate);
+    expandField(config.lengthPenalty);
+    expandField(config.earlyStopping);
+    expandField(config.topKMedusaHeads);
+    expandField(config.outputLogProbs);
+    expandField(config.cumLogProbs);
+    expandField(config.draftAcceptanceThreshold);
+    return config;
+}
+
+} // namespace
+
+TEST(FusedSamplingConfigBuilderTest, InternsIdenticalConfigs)
+{
+    FusedSamplingConfigBuilder builder{8};
+    for (SizeType32 slot = 0; slot < 4; ++slot)
+    {
+        builder.setSlot(slot, makeConfig(0.7f, 50));
+    }
+    EXPECT_EQ(builder.getNumUniqueConfigs(), 1);
+    auto const sharedId = builder.getConfigId(0);
+    EXPECT_EQ(builder.getConfigId(3), sharedId);
+    EXPECT_EQ(builder.getConfig(sharedId), makeConfig(0.7f, 50));
+    EXPECT_EQ(builder.getConfigId(4), FusedSamplingConfigBuilder::kNoConfig);
+
+    builder.setSlot(4, makeConfig(1.f, 1));
+    EXPECT_EQ(builder.getNumUniqueConfigs(), 2);
+    EXPECT_NE(builder.getConfigId(4), sharedId);
+
+    // Reassigning a slot its own config keeps the id, replacing the config of the last slot releases it.
+    builder.setSlot(0, makeConfig(0.7f, 50));
+    EXPECT_EQ(builder.getConfigId(0), sharedId);
+    auto const releasedId = builder.getConfigId(4);
+    builder.setSlot(4, makeConfig(0.7f, 50));
+    EXPECT_EQ(builder.getNumUniqueConfigs(), 1);
+    builder.setSlot(5, makeConfig(0.2f, 5));
+    EXPECT_EQ(builder.getConfigId(5), releasedId);
+
+    for (SizeType32 slot = 0; slot < builder.getMaxNumSlots(); ++slot)
+    {
+        builder.clearSlot(slot);
+    }
+    EXPECT_EQ(builder.getNumUniqueConfigs(), 0);
+    EXPECT_THROW(builder.getConfig(sharedId), tensorrt_llm::common::TllmException);
+}
+
+TEST(FusedSamplingConfigBuilderTest, MaterializesOnlyVaryingFields)
+{
+    FusedSamplingConfigBuilder builder{4};
+    for (SizeType32 slot = 0; slot < 4; ++slot)
+    {
+        auto config = makeConfig(0.7f, 10 * (slot + 1));
+        config.topPMin = std::vector<float>{0.1f};
+        builder.setSlot(slot, config);
+    }
+    auto const fused = builder.fuse({3, 1, 2});
+    EXPECT_THAT(fused.temperature.value(), testing::ElementsAre(0.7f));
+    EXPECT_THAT(fused.randomSeed.value(), testing::ElementsAre(42u));
+    EXPECT_THAT(fused.topK.value(), testing::ElementsAre(40, 20, 30));
+    // The top-p decay parameters are set per slot, even if all requests share them.
+    EXPECT_THAT(fused.topPMin.value(), testing::ElementsAre(0.1f, 0.1f, 0.1f));
+    EXPECT_FALSE(fused.topP.has_value());
+    EXPECT_FALSE(fused.repetitionPenalty.has_value());
+
+    // A request without a value takes the default, which differs from the value of the others.
+    SamplingConfig defaultConfig;
+    defaultConfig.topK = std::vector<SizeType32>{40};
+    builder.setSlot(0, defaultConfig);
+    auto const mixed = builder.fuse({0, 3});
+    EXPECT_THAT(mixed.temperature.value(),
+        testing::ElementsAre(tensorrt_llm::layers::DefaultDecodingParams::getTemperature(), 0.7f));
+    EXPECT_THAT(mixed.topK.value(), testing::ElementsAre(40));
+}
+
+TEST(FusedSamplingConfigBuilderTest, MatchesSamplingConfigFusion)
+{
+    auto constexpr maxNumSlots = 32;
+    std::mt19937 generator{1234};
+    std::uniform_int_distribution<int> choice{0, 3};
+
+    FusedSamplingConfigBuilder builder{maxNumSlots};
+    std::vector<SamplingConfig> slotConfigs(maxNumSlots);
+    for (int step = 0; step < 20; ++step)
+    {
+        std::vector<SizeType32> slots;
+        std::vector<SamplingConfig> configs;
+        for (SizeType32 slot = 0; slot < maxNumSlots; ++slot)
+        {
+            if (choice(generator) != 0)
+            {
+                continue;
+            }
+            SamplingConfig config;
+            config.temperature = std::vector<float>{0.5f * static_cast<float>(choice(generator))};
+            if (choice(generator) == 0)
+            {
+                config.topK = std::vector<SizeType32>{choice(generator)};
+            }
+            if (choice(generator) == 0)
+            {
+                config.topPDecay = std::vector<float>{0.9f};
+            }
+            if (choice(generator) == 0)
+            {
+                config.topKMedusaHeads = std::vector<std::vector<SizeType32>>{{choice(generator), 2}};
+            }
+            config.outputLogProbs = std::vector<bool>{choice(generator) == 0};
+            config.randomSeed = std::vector<uint64_t>{static_cast<uint64_t>(choice(generator) / 3)};
+            builder.setSlot(slot, config);
+            slots.push_back(slot);
+            configs.push_back(config);
+        }
+        if (slots.empty())
+        {
+            continue;
+        }
+        auto const fused = builder.fuse(slots);
+        EXPECT_EQ(expand(fused, slots.size()), SamplingConfig(configs)) << "step " << step;
+        EXPECT_LE(builder.getNumUniqueConfigs(), maxNumSlots);
+    }
+}
+
+TEST(FusedSamplingConfigBuilderTest, RejectsInvalidSlots)
+{
+    FusedSamplingConfigBuilder builder{2};
+    EXPECT_THROW(builder.setSlot(2, makeConfig(1.f, 1)), tensorrt_llm::common::TllmException);
+    auto batched = makeConfig(1.f, 1);
+    batched.topK = std::vector<SizeType32>{1, 2};
+    EXPECT_THROW(builder.setSlot(0, batched), tensorrt_llm::common::TllmException);
+    EXPECT_EQ(builder.getNumUniqueConfigs(), 0);
+    builder.setSlot(0, makeConfig(1.f, 1));
+    EXPECT_THROW(builder.fuse({0, 1}), tensorrt_llm::common::TllmException);
+}
+
+TEST(FusedSamplingConfigBuilderTest, ValidateExpandsSharedGreedyParams)
+{
+    // Fusion keeps a single top-k and top-p for the batch, greedy requests need their own.
+    SamplingConfig config;
+    config.temperature = std::vector<float>{0.f, 0.5f, 0.f};
+    config.topK = std::vector<SizeType32>{50};
+    config.topP = std::vector<float>{0.9f};
+    EXPECT_TRUE(config.validate());
+    EXPECT_THAT(config.temperature.value(), testing::ElementsAre(1.f, 0.5f, 1.f));
+    EXPECT_THAT(config.topK.value(), testing::ElementsAre(1, 50, 1));
+    EXPECT_THAT(config.topP.value(), testing::ElementsAre(1.f, 0.9f, 1.f));
+
+    config.temperature = std::vector<float>{0.f};
+    config.topK = std::vector<SizeType32>{50, 40};
+    config.topP.reset();
+    EXPECT_TRUE(config.validate());
+    EXPECT_THAT(config.temperature.value(), testing::ElementsAre(1.f, 1.f));
+    EXPECT_THAT(config.topK.value(), testing::ElementsAre(1, 1));
+}
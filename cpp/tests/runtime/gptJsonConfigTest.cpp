@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/gptJsonConfig.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+//! \brief The config of a llama-like engine built with the current builder, with the listed entries replaced.
+std::string makeConfig(std::string const& vocabSize = R"("vocab_size": 32000,)",
+    std::string const& hiddenSize = R"("hidden_size": 4096,)", std::string const& tpSize = R"("tp_size": 2)")
+{
+    return R"({
+    "version": "0.12.0",
+    "pretrained_config": {
+        "architecture": "LlamaForCausalLM",
+        "dtype": "float16",
+        "num_hidden_layers": 32,
+        "num_attention_heads": 32,
+        "num_key_value_heads": 8,
+        )"
+        + hiddenSize + vocabSize + R"(
+        "intermediate_size": 11008,
+        "mapping": {)"
+        + tpSize + R"(},
+        "quantization": {"quant_algo": null, "kv_cache_quant_algo": null}
+    },
+    "build_config": {
+        "max_batch_size": 64,
+        "max_input_len": 1024,
+        "max_seq_len": 2048,
+        "max_num_tokens": 8192,
+        "kv_cache_type": "paged",
+        "lora_config": {"lora_target_modules": null},
+        "plugin_config": {
+            "gpt_attention_plugin": "float16",
+            "lora_plugin": null,
+            "remove_input_padding": true,
+            "paged_kv_cache": true,
+            "tokens_per_block": 64,
+            "context_fmha": true,
+            "use_paged_context_fmha": false
+        }
+    }
+})";
+}
+
+class GptJsonConfigTest : public ::testing::Test // NOLINT
+{
+protected:
+    void SetUp() override
+    {
+        mPath = std::filesystem::temp_directory_path() / ("gptJsonConfigTest." + std::to_string(::getpid()));
+        std::filesystem::remove(mPath);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(mPath);
+    }
+
+    void write(std::string const& json) const
+    {
+        std::ofstream file(mPath);
+        file << json;
+    }
+
+    std::filesystem::path mPath;
+};
+
+} // namespace
+
+TEST_F(GptJsonConfigTest, parsesConfig)
+{
+    auto const config = GptJsonConfig::parse(makeConfig());
+    EXPECT_EQ(config.getName(), "LlamaForCausalLM");
+    EXPECT_EQ(config.getPrecision(), "float16");
+    EXPECT_EQ(config.getTensorParallelism(), 2);
+    EXPECT_EQ(config.getPipelineParallelism(), 1);
+
+    auto const& modelConfig = config.getModelConfig();
+    EXPECT_EQ(modelConfig.getVocabSize(), 32000);
+    EXPECT_EQ(modelConfig.getHiddenSize(), 2048);
+    EXPECT_EQ(modelConfig.getNbHeads(), 16);
+    EXPECT_EQ(modelConfig.getNbKvHeads(), 4);
+    EXPECT_EQ(modelConfig.getMlpHiddenSize(), 5504);
+    EXPECT_EQ(modelConfig.getMaxBatchSize(), 64);
+    // Missing optional fields take their defaults.
+    EXPECT_EQ(modelConfig.getMaxBeamWidth(), 0);
+    EXPECT_EQ(modelConfig.getMaxPromptEmbeddingTableSize(), 0);
+    EXPECT_TRUE(modelConfig.usePackedInput());
+    EXPECT_TRUE(modelConfig.isPagedKVCache());
+    EXPECT_EQ(modelConfig.getTokensPerBlock(), 64);
+    EXPECT_FALSE(modelConfig.useLoraPlugin());
+}
+
+TEST_F(GptJsonConfigTest, reportsAllMissingFields)
+{
+    try
+    {
+        GptJsonConfig::parse(makeConfig("", ""));
+        FAIL() << "Expected the config to be rejected";
+    }
+    catch (tc::TllmException const& e)
+    {
+        std::string const message = e.what();
+        EXPECT_NE(message.find("missing field /pretrained_config/vocab_size"), std::string::npos) << message;
+        EXPECT_NE(message.find("missing field /pretrained_config/hidden_size"), std::string::npos) << message;
+    }
+}
+
+TEST_F(GptJsonConfigTest, reportsInvalidFields)
+{
+    try
+    {
+        GptJsonConfig::parse(makeConfig(R"("vocab_size": "32000",)", R"("hidden_size": 4096,)", R"("tp_size": 2.5)"));
+        FAIL() << "Expected the config to be rejected";
+    }
+    catch (tc::TllmException const& e)
+    {
+        std::string const message = e.what();
+        EXPECT_NE(message.find("field /pretrained_config/vocab_size must be of type integer, got string"),
+            std::string::npos)
+            << message;
+        EXPECT_NE(message.find("field /pretrained_config/mapping/tp_size must be of type integer, got number"),
+            std::string::npos)
+            << message;
+    }
+}
+
+TEST_F(GptJsonConfigTest, nullOptionalFieldsTakeDefaults)
+{
+    auto const config = GptJsonConfig::parse(makeConfig(
+        R"("vocab_size": 32000,)", R"("hidden_size": 4096, "head_size": null,)", R"("tp_size": 2, "pp_size": null)"));
+    EXPECT_EQ(config.getPipelineParallelism(), 1);
+    EXPECT_EQ(config.getModelConfig().getSizePerHead(), 128);
+}
+
+TEST_F(GptJsonConfigTest, reusesParsedFile)
+{
+    write(makeConfig());
+    auto const config = GptJsonConfig::parse(mPath);
+    EXPECT_EQ(config.getTensorParallelism(), 2);
+    auto const cached = GptJsonConfig::parse(mPath);
+    EXPECT_EQ(cached.getTensorParallelism(), 2);
+    EXPECT_EQ(cached.getModelConfig().getNbHeads(), config.getModelConfig().getNbHeads());
+
+    // A modified file is parsed again.
+    write(makeConfig(R"("vocab_size": 32000,)", R"("hidden_size": 4096,)", R"("tp_size": 4, "pp_size": 2)"));
+    auto const modified = GptJsonConfig::parse(mPath);
+    EXPECT_EQ(modified.getTensorParallelism(), 4);
+    EXPECT_EQ(modified.getPipelineParallelism(), 2);
+    EXPECT_EQ(modified.getModelConfig().getNbHeads(), 8);
+}
+
+TEST_F(GptJsonConfigTest, cachedConfigsDoNotShareModules)
+{
+    auto json = makeConfig();
+    std::string const kvCacheType = R"("kv_cache_type": "paged",)";
+    json.replace(json.find(kvCacheType), kvCacheType.size(),
+        kvCacheType + R"( "speculative_decoding_mode": 8, "max_draft_len": 4,)");
+    write(json);
+    auto const config = GptJsonConfig::parse(mPath);
+    auto const cached = GptJsonConfig::parse(mPath);
+    ASSERT_TRUE(config.getModelConfig().getSpeculativeDecodingMode().isLookaheadDecoding());
+    ASSERT_TRUE(cached.getModelConfig().hasSpeculativeDecodingModule());
+    // Executors configure their module, so each config has its own.
+    EXPECT_NE(config.getModelConfig().getSpeculativeDecodingModulePtr(),
+        cached.getModelConfig().getSpeculativeDecodingModulePtr());
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvBlockCodec.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <cuda_fp16.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+auto constexpr kNumLayers = 2;
+auto constexpr kNumHeads = 2;
+auto constexpr kTokensPerBlock = 16;
+// Not a multiple of the SIMD width, to cover the scalar tail.
+auto constexpr kSizePerHead = 36;
+auto constexpr kNumSlabs = kNumLayers * 2 * kNumHeads;
+auto constexpr kSlabSize = kTokensPerBlock * kSizePerHead;
+
+//! A KV cache block in one of the supported data types, with its values as floats.
+struct Block
+{
+    nvinfer1::DataType dtype;
+    std::vector<std::uint8_t> data;
+
+    float get(std::size_t i) const
+    {
+        switch (dtype)
+        {
+        case nvinfer1::DataType::kHALF: return __half2float(reinterpret_cast<half const*>(data.data())[i]);
+        case nvinfer1::DataType::kBF16:
+        {
+            std::uint32_t const bits = reinterpret_cast<std::uint16_t const*>(data.data())[i] << 16;
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        default: return reinterpret_cast<float const*>(data.data())[i];
+        }
+    }
+
+    void set(std::size_t i, float value)
+    {
+        switch (dtype)
+        {
+        case nvinfer1::DataType::kHALF: reinterpret_cast<half*>(data.data())[i] = __float2half(value); break;
+        case nvinfer1::DataType::kBF16:
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            reinterpret_cast<std::uint16_t*>(data.data())[i] = static_cast<std::uint16_t>(bits >> 16);
+            break;
+        }
+        default: reinterpret_cast<float*>(data.data())[i] = value;
+        }
+    }
+};
+
+Block makeBlock(KvBlockCodec const& codec, nvinfer1::DataType dtype, unsigned seed = 0)
+{
+    Block block{dtype, std::vector<std::uint8_t>(codec.getBlockSize())};
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    for (std::size_t i = 0; i < kNumSlabs * kSlabSize; ++i)
+    {
+        // Vary the range across heads, with a few outliers.
+        auto const slab = i / kSlabSize;
+        block.set(i, dist(gen) * static_cast<float>(1 + slab) * (i % 97 == 0 ? 8.f : 1.f));
+    }
+    return block;
+}
+
+KvBlockCodec makeCodec(nvinfer1::DataType dtype, KvBlockQuantization quantization, bool useSimd = true)
+{
+    return KvBlockCodec(dtype, kNumLayers, kNumHeads, kTokensPerBlock, kSizePerHead, quantization, useSimd);
+}
+
+Block roundTrip(KvBlockCodec const& codec, Block const& block)
+{
+    std::vector<std::uint8_t> encoded(codec.getEncodedSize());
+    codec.encode(block.data.data(), encoded.data());
+    Block decoded{block.dtype, std::vector<std::uint8_t>(codec.getBlockSize())};
+    codec.decode(encoded.data(), decoded.data.data());
+    return decoded;
+}
+
+//! \brief softmax(q K^T / sqrt(d)) V for one head of a block.
+std::vector<float> attention(Block const& block, std::size_t kSlab, std::size_t vSlab, std::vector<float> const& q)
+{
+    std::vector<float> logits(kTokensPerBlock);
+    for (int t = 0; t < kTokensPerBlock; ++t)
+    {
+        float dot = 0.f;
+        for (int d = 0; d < kSizePerHead; ++d)
+        {
+            dot += q[d] * block.get(kSlab * kSlabSize + t * kSizePerHead + d);
+        }
+        logits[t] = dot / std::sqrt(static_cast<float>(kSizePerHead));
+    }
+    auto const maxLogit = *std::max_element(logits.begin(), logits.end());
+    float sum = 0.f;
+    for (auto& l : logits)
+    {
+        l = std::exp(l - maxLogit);
+        sum += l;
+    }
+    std::vector<float> out(kSizePerHead);
+    for (int t = 0; t < kTokensPerBlock; ++t)
+    {
+        for (int d = 0; d < kSizePerHead; ++d)
+        {
+            out[d] += logits[t] / sum * block.get(vSlab * kSlabSize + t * kSizePerHead + d);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+class KvBlockCodecTest
+    : public ::testing::TestWithParam<std::tuple<nvinfer1::DataType, KvBlockQuantization, bool>> // NOLINT
+{
+};
+
+TEST_P(KvBlockCodecTest, roundTrip)
+{
+    auto const [dtype, quantization, useSimd] = GetParam();
+    auto const codec = makeCodec(dtype, quantization, useSimd);
+    auto const block = makeBlock(codec, dtype);
+    auto const decoded = roundTrip(codec, block);
+
+    for (std::size_t slab = 0; slab < kNumSlabs; ++slab)
+    {
+        float amax = 0.f;
+        for (std::size_t i = 0; i < kSlabSize; ++i)
+        {
+            amax = std::max(amax, std::fabs(block.get(slab * kSlabSize + i)));
+        }
+        for (std::size_t i = 0; i < kSlabSize; ++i)
+        {
+            auto const index = slab * kSlabSize + i;
+            auto const expected = block.get(index);
+            // Half a quantization step, relative for FP8, plus the rounding to the block type.
+            auto const tolerance = quantization == KvBlockQuantization::kINT8
+                ? amax / 127.f * 0.5f + std::fabs(expected) / 128.f
+                : std::fabs(expected) / 16.f + amax / 448.f / 512.f + std::fabs(expected) / 128.f;
+            ASSERT_NEAR(decoded.get(index), expected, tolerance) << "slab " << slab << " element " << i;
+        }
+    }
+}
+
+TEST_P(KvBlockCodecTest, simdMatchesScalar)
+{
+    auto const [dtype, quantization, useSimd] = GetParam();
+    auto const simd = makeCodec(dtype, quantization, useSimd);
+    auto const scalar = makeCodec(dtype, quantization, false);
+    auto const block = makeBlock(simd, dtype, 1);
+
+    std::vector<std::uint8_t> simdEncoded(simd.getEncodedSize());
+    std::vector<std::uint8_t> scalarEncoded(scalar.getEncodedSize());
+    simd.encode(block.data.data(), simdEncoded.data());
+    scalar.encode(block.data.data(), scalarEncoded.data());
+    EXPECT_EQ(simdEncoded, scalarEncoded);
+    EXPECT_EQ(roundTrip(simd, block).data, roundTrip(scalar, block).data);
+}
+
+TEST_P(KvBlockCodecTest, attentionAccuracy)
+{
+    auto const [dtype, quantization, useSimd] = GetParam();
+    auto const codec = makeCodec(dtype, quantization, useSimd);
+    auto const block = makeBlock(codec, dtype, 2);
+    auto const decoded = roundTrip(codec, block);
+
+    std::mt19937 gen(3);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    std::vector<float> q(kSizePerHead);
+    for (auto& v : q)
+    {
+        v = dist(gen);
+    }
+    for (std::size_t layer = 0; layer < kNumLayers; ++layer)
+    {
+        for (std::size_t head = 0; head < kNumHeads; ++head)
+        {
+            auto const kSlab = (layer * 2) * kNumHeads + head;
+            auto const vSlab = (layer * 2 + 1) * kNumHeads + head;
+            // Keep the logits in a realistic range despite the larger K of the later heads.
+            std::vector<float> headQ(q);
+            for (auto& v : headQ)
+            {
+                v /= static_cast<float>(1 + kSlab);
+            }
+            auto const expected = attention(block, kSlab, vSlab, headQ);
+            auto const actual = attention(decoded, kSlab, vSlab, headQ);
+            float error = 0.f;
+            float norm = 0.f;
+            for (int d = 0; d < kSizePerHead; ++d)
+            {
+                error += (actual[d] - expected[d]) * (actual[d] - expected[d]);
+                norm += expected[d] * expected[d];
+            }
+            // The outliers stretch the int8 range of their head, FP8 keeps a relative precision.
+            EXPECT_LT(std::sqrt(error / norm), quantization == KvBlockQuantization::kINT8 ? 0.05f : 0.08f);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(KvBlockCodec, KvBlockCodecTest,
+    ::testing::Combine(
+        ::testing::Values(nvinfer1::DataType::kHALF, nvinfer1::DataType::kBF16, nvinfer1::DataType::kFLOAT),
+        ::testing::Values(KvBlockQuantization::kINT8, KvBlockQuantization::kFP8), ::testing::Bool()));
+
+TEST(KvBlockCodecTest, zeroHeads)
+{
+    auto const codec = makeCodec(nvinfer1::DataType::kHALF, KvBlockQuantization::kINT8);
+    auto block = makeBlock(codec, nvinfer1::DataType::kHALF);
+    // An empty head, e.g. the unused tokens of a partially filled block.
+    for (std::size_t i = 0; i < kSlabSize; ++i)
+    {
+        block.set(kSlabSize + i, 0.f);
+    }
+    std::vector<std::uint8_t> encoded(codec.getEncodedSize(), 0xff);
+    codec.encode(block.data.data(), encoded.data());
+    float scale;
+    std::memcpy(&scale, encoded.data() + sizeof(float), sizeof(scale));
+    EXPECT_EQ(scale, 0.f);
+
+    Block decoded{block.dtype, std::vector<std::uint8_t>(codec.getBlockSize(), 0xff)};
+    codec.decode(encoded.data(), decoded.data.data());
+    for (std::size_t i = 0; i < kSlabSize; ++i)
+    {
+        ASSERT_EQ(decoded.get(kSlabSize + i), 0.f);
+    }
+}
+
+TEST(KvBlockCodecTest, hostPool)
+{
+    auto const codec = makeCodec(nvinfer1::DataType::kHALF, KvBlockQuantization::kFP8);
+    EXPECT_GT(codec.getCompressionRatio(), 1.9);
+    EXPECT_DOUBLE_EQ(makeCodec(nvinfer1::DataType::kFLOAT, KvBlockQuantization::kINT8).getCompressionRatio(),
+        4 * static_cast<double>(kSlabSize) / (kSlabSize + sizeof(float)));
+
+    // Room for 2 uncompressed blocks holds 3 compressed ones.
+    QuantizedHostBlockPool pool(codec, 2 * codec.getBlockSize() - 1);
+    ASSERT_EQ(pool.getNumBlocks(), 3);
+
+    std::vector<Block> blocks;
+    for (SizeType32 slot = 0; slot < pool.getNumBlocks(); ++slot)
+    {
+        blocks.push_back(makeBlock(codec, nvinfer1::DataType::kHALF, slot));
+        pool.offload(slot, blocks.back().data.data());
+    }
+    for (SizeType32 slot = 0; slot < pool.getNumBlocks(); ++slot)
+    {
+        Block onboarded{nvinfer1::DataType::kHALF, std::vector<std::uint8_t>(codec.getBlockSize())};
+        pool.onboard(slot, onboarded.data.data());
+        EXPECT_EQ(onboarded.data, roundTrip(codec, blocks[slot]).data);
+    }
+    std::vector<std::uint8_t> buffer(codec.getBlockSize());
+    EXPECT_THROW(pool.onboard(3, buffer.data()), tensorrt_llm::common::TllmException);
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvCacheSnapshot.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unistd.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+auto constexpr kTokensPerBlock = 4;
+
+KvCacheSnapshotInfo makeInfo()
+{
+    return KvCacheSnapshotInfo{"model", nvinfer1::DataType::kHALF, 2, 2, 8, kTokensPerBlock};
+}
+
+VecUniqueTokens makeTokens(std::initializer_list<TokenIdType> tokens, TokenExtraIdType extraId = 0)
+{
+    VecUniqueTokens uniqueTokens;
+    for (auto const token : tokens)
+    {
+        uniqueTokens.push_back({token, extraId});
+    }
+    return uniqueTokens;
+}
+
+//! \brief Host pool whose blocks are filled with their id.
+class HostPool
+{
+public:
+    HostPool(std::size_t blockSize, SizeType32 numBlocks)
+        : mBlocks(numBlocks, std::vector<std::uint8_t>(blockSize))
+    {
+    }
+
+    std::optional<SizeType32> allocate()
+    {
+        if (mNumAllocated == static_cast<SizeType32>(mBlocks.size()))
+        {
+            return std::nullopt;
+        }
+        return mNumAllocated++;
+    }
+
+    std::vector<std::uint8_t>& operator[](SizeType32 blockId)
+    {
+        return mBlocks.at(blockId);
+    }
+
+private:
+    std::vector<std::vector<std::uint8_t>> mBlocks;
+    SizeType32 mNumAllocated{0};
+};
+
+class KvCacheSnapshotTest : public ::testing::Test // NOLINT
+{
+protected:
+    void SetUp() override
+    {
+        mPath = std::filesystem::temp_directory_path() / ("kvCacheSnapshotTest." + std::to_string(::getpid()));
+        std::filesystem::remove(mPath);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(mPath);
+    }
+
+    KvCachePrefixTree load(HostPool& pool, KvCacheSnapshotInfo const& info = makeInfo()) const
+    {
+        return loadKvCacheSnapshot(
+            mPath, info, [&pool]() { return pool.allocate(); },
+            [&pool](SizeType32 blockId) { return pool[blockId].data(); });
+    }
+
+    std::filesystem::path mPath;
+};
+
+} // namespace
+
+TEST_F(KvCacheSnapshotTest, prefixTree)
+{
+    KvCachePrefixTree tree;
+    auto const a = tree.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), 10);
+    auto const b = tree.addBlock(a, 0, makeTokens({5, 6, 7, 8}), 11);
+    auto const c = tree.addBlock(a, 0, makeTokens({5, 6, 7, 9}), 12);
+    EXPECT_EQ(tree.addBlock(a, 0, makeTokens({5, 6, 7, 8}), 13), b);
+    auto const lora = tree.addBlock(KvCachePrefixTree::kRoot, 1, makeTokens({1, 2, 3, 4}), 14);
+    EXPECT_EQ(tree.getNumBlocks(), 4);
+    EXPECT_EQ(tree.getNode(b).blockId, 11);
+
+    auto const tokens = makeTokens({1, 2, 3, 4, 5, 6, 7, 9, 10, 11});
+    EXPECT_EQ(tree.findMatchingBlocks(tokens, kTokensPerBlock), (std::vector<SizeType32>{a, c}));
+    EXPECT_EQ(tree.findMatchingBlocks(tokens, kTokensPerBlock, 1), (std::vector<SizeType32>{lora}));
+    EXPECT_TRUE(tree.findMatchingBlocks(makeTokens({1, 2, 3}), kTokensPerBlock).empty());
+    EXPECT_TRUE(tree.findMatchingBlocks(makeTokens({1, 2, 3, 4}, 7), kTokensPerBlock).empty());
+    EXPECT_THROW(tree.addBlock(4, 0, makeTokens({1, 2, 3, 4}), 0), common::TllmException);
+}
+
+TEST_F(KvCacheSnapshotTest, saveAndLoad)
+{
+    auto const info = makeInfo();
+    auto const blockSize = info.getBlockSize();
+    EXPECT_EQ(blockSize, std::size_t{2 * 2 * 2 * kTokensPerBlock * 8 * 2});
+
+    HostPool pool(blockSize, 8);
+    KvCachePrefixTree tree;
+    auto const addBlock = [&](SizeType32 parent, LoraTaskIdType loraTaskId, VecUniqueTokens tokens)
+    {
+        auto const blockId = pool.allocate().value();
+        std::fill(pool[blockId].begin(), pool[blockId].end(), static_cast<std::uint8_t>(blockId + 1));
+        return tree.addBlock(parent, loraTaskId, std::move(tokens), blockId);
+    };
+    auto const a = addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}));
+    auto const b = addBlock(a, 0, makeTokens({5, 6, 7, 8}, 3));
+    addBlock(a, 0, makeTokens({5, 6, 7, 9}));
+    addBlock(b, 0, makeTokens({9, 10, 11, 12}));
+    addBlock(KvCachePrefixTree::kRoot, 2, makeTokens({1, 2, 3, 4}));
+    saveKvCacheSnapshot(mPath, info, tree, [&pool](SizeType32 blockId) { return pool[blockId].data(); });
+    EXPECT_FALSE(std::filesystem::exists(mPath.string() + ".tmp"));
+
+    HostPool restored(blockSize, 8);
+    auto const loaded = load(restored);
+    ASSERT_EQ(loaded.getNumBlocks(), tree.getNumBlocks());
+    for (SizeType32 node = 0; node < tree.getNumBlocks(); ++node)
+    {
+        auto const& expected = tree.getNode(node);
+        auto const& actual = loaded.getNode(node);
+        EXPECT_EQ(actual.parent, expected.parent);
+        EXPECT_EQ(actual.loraTaskId, expected.loraTaskId);
+        EXPECT_EQ(actual.tokens, expected.tokens);
+        EXPECT_EQ(restored[actual.blockId], pool[expected.blockId]);
+    }
+
+    auto tokens = makeTokens({1, 2, 3, 4});
+    auto const rest = makeTokens({5, 6, 7, 8, 9, 10, 11, 12}, 3);
+    tokens.insert(tokens.end(), rest.begin(), rest.end());
+    // The extra ids of the third block do not match.
+    EXPECT_EQ(loaded.findMatchingBlocks(tokens, kTokensPerBlock).size(), 2);
+    EXPECT_EQ(loaded.findMatchingBlocks(makeTokens({1, 2, 3, 4}), kTokensPerBlock, 2).size(), 1);
+}
+
+TEST_F(KvCacheSnapshotTest, poolFull)
+{
+    auto const info = makeInfo();
+    std::vector<std::uint8_t> contents(info.getBlockSize(), 1);
+    {
+        KvCacheSnapshotWriter writer(mPath, info);
+        auto const a = writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), contents.data());
+        auto const b = writer.addBlock(a, 0, makeTokens({5, 6, 7, 8}), contents.data());
+        writer.addBlock(b, 0, makeTokens({9, 10, 11, 12}), contents.data());
+        EXPECT_THROW(writer.addBlock(5, 0, makeTokens({1, 2, 3, 4}), contents.data()), common::TllmException);
+        writer.close();
+    }
+
+    HostPool pool(info.getBlockSize(), 2);
+    auto const tree = load(pool);
+    EXPECT_EQ(tree.getNumBlocks(), 2);
+    EXPECT_EQ(tree.findMatchingBlocks(makeTokens({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}), kTokensPerBlock).size(), 2);
+}
+
+TEST_F(KvCacheSnapshotTest, duplicateBlocks)
+{
+    auto const info = makeInfo();
+    std::vector<std::uint8_t> contents(info.getBlockSize(), 1);
+    std::vector<std::uint8_t> duplicateContents(info.getBlockSize(), 2);
+    {
+        KvCacheSnapshotWriter writer(mPath, info);
+        writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), contents.data());
+        auto const duplicate
+            = writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), duplicateContents.data());
+        writer.addBlock(duplicate, 0, makeTokens({5, 6, 7, 8}), contents.data());
+        writer.close();
+    }
+
+    // The duplicate takes no block of the pool and its child goes under the first block.
+    HostPool pool(info.getBlockSize(), 2);
+    auto const tree = load(pool);
+    ASSERT_EQ(tree.getNumBlocks(), 2);
+    EXPECT_EQ(tree.getNode(1).parent, 0);
+    EXPECT_EQ(pool[tree.getNode(0).blockId], contents);
+    EXPECT_FALSE(pool.allocate().has_value());
+}
+
+TEST_F(KvCacheSnapshotTest, incompatible)
+{
+    auto const info = makeInfo();
+    std::vector<std::uint8_t> contents(info.getBlockSize(), 1);
+    {
+        KvCacheSnapshotWriter writer(mPath, info);
+        writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), contents.data());
+        writer.close();
+    }
+
+    auto otherModel = info;
+    otherModel.modelId = "other";
+    EXPECT_THROW(KvCacheSnapshotReader(mPath, otherModel), common::TllmException);
+    auto otherLayout = info;
+    otherLayout.tokensPerBlock = 8;
+    EXPECT_THROW(KvCacheSnapshotReader(mPath, otherLayout), common::TllmException);
+    auto otherType = info;
+    otherType.dataType = nvinfer1::DataType::kFLOAT;
+    EXPECT_THROW(KvCacheSnapshotReader(mPath, otherType), common::TllmException);
+
+    // A truncated snapshot is rejected.
+    std::filesystem::resize_file(mPath, std::filesystem::file_size(mPath) - 1);
+    HostPool pool(info.getBlockSize(), 2);
+    EXPECT_THROW(load(pool), common::TllmException);
+}
+
+TEST_F(KvCacheSnapshotTest, interrupted)
+{
+    auto const info = makeInfo();
+    std::vector<std::uint8_t> contents(info.getBlockSize(), 1);
+    {
+        KvCacheSnapshotWriter writer(mPath, info);
+        writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({1, 2, 3, 4}), contents.data());
+        writer.close();
+    }
+    {
+        // Not closed: the previous snapshot is kept.
+        KvCacheSnapshotWriter writer(mPath, info);
+        writer.addBlock(KvCachePrefixTree::kRoot, 0, makeTokens({5, 6, 7, 8}), contents.data());
+    }
+    EXPECT_FALSE(std::filesystem::exists(mPath.string() + ".tmp"));
+
+    KvCacheSnapshotReader reader(mPath, info);
+    auto const block = reader.readBlock();
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(block->tokens, makeTokens({1, 2, 3, 4}));
+    // The contents are skipped.
+    EXPECT_FALSE(reader.readBlock().has_value());
+    EXPECT_EQ(reader.getNumBlocksRead(), 1);
+}
+
+} // namespace tensorrt_llm::runtime
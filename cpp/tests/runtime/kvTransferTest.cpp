@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kvTransferEngine.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <string>
+#include <unistd.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+KvCacheLayout makeLayout(SizeType32 tpSize = 1, SizeType32 tpRank = 0)
+{
+    KvCacheLayout layout;
+    layout.numLayers = 3;
+    layout.numKvHeads = 4;
+    layout.sizePerHead = 8;
+    layout.tokensPerBlock = 4;
+    layout.elementSize = 2;
+    layout.tpSize = tpSize;
+    layout.tpRank = tpRank;
+    return layout;
+}
+
+//! Value of a byte of the full, unsplit KV cache.
+std::uint8_t fullValue(SizeType32 block, SizeType32 layer, SizeType32 kv, SizeType32 head, std::size_t byte)
+{
+    return static_cast<std::uint8_t>(block * 131 + layer * 37 + kv * 17 + head * 7 + byte);
+}
+
+std::vector<std::vector<std::uint8_t>> makeBlocks(KvCacheLayout const& layout, SizeType32 numBlocks)
+{
+    std::vector<std::vector<std::uint8_t>> blocks(numBlocks, std::vector<std::uint8_t>(layout.getBlockBytes()));
+    for (SizeType32 b = 0; b < numBlocks; ++b)
+    {
+        auto* data = blocks[b].data();
+        for (SizeType32 layer = 0; layer < layout.numLayers; ++layer)
+        {
+            for (SizeType32 kv = 0; kv < 2; ++kv)
+            {
+                for (SizeType32 h = 0; h < layout.getNumLocalHeads(); ++h)
+                {
+                    for (std::size_t i = 0; i < layout.getHeadBytes(); ++i)
+                    {
+                        *data++ = fullValue(b, layer, kv, layout.getFirstHead() + h, i);
+                    }
+                }
+            }
+        }
+    }
+    return blocks;
+}
+
+template <typename T>
+std::vector<T*> getPointers(std::vector<std::vector<std::uint8_t>>& blocks)
+{
+    std::vector<T*> pointers;
+    for (auto& block : blocks)
+    {
+        pointers.push_back(block.data());
+    }
+    return pointers;
+}
+
+std::string getSegmentName()
+{
+    return "/kvTransferTest." + std::to_string(::getpid());
+}
+
+} // namespace
+
+TEST(KvTransferTest, sharedMemory)
+{
+    auto const layout = makeLayout();
+    auto sent = makeBlocks(layout, 5);
+    std::vector<std::vector<std::uint8_t>> received(5, std::vector<std::uint8_t>(layout.getBlockBytes()));
+
+    auto const name = getSegmentName();
+    // Smaller than the transfer so that the ring wraps around.
+    auto contextTransport = SharedMemoryTransport::create(name, 1000);
+    auto sender = std::async(std::launch::async,
+        [&]() { return KvTransferEngine(layout).sendBlocks(*contextTransport, 1, getPointers<void const>(sent), 17); });
+    auto generationTransport = SharedMemoryTransport::open(name);
+    auto const result = KvTransferEngine(layout).receiveBlocks(*generationTransport, 1, getPointers<void>(received));
+    auto const stats = sender.get();
+
+    EXPECT_EQ(received, sent);
+    EXPECT_EQ(result.numTokens, 17);
+    EXPECT_FALSE(result.contextPhaseParams);
+    EXPECT_EQ(result.stats.numBytes, 5 * layout.getBlockBytes());
+    EXPECT_EQ(stats.numBytes, 5 * layout.getBlockBytes());
+}
+
+TEST(KvTransferTest, tcp)
+{
+    auto const layout = makeLayout();
+    auto sent = makeBlocks(layout, 3);
+    std::vector<std::vector<std::uint8_t>> received(3, std::vector<std::uint8_t>(layout.getBlockBytes()));
+
+    TcpListener listener(0, "127.0.0.1");
+    auto sender = std::async(std::launch::async,
+        [&]()
+        {
+            auto transport = listener.accept();
+            KvTransferEngine const engine(layout);
+            // Two requests over one connection.
+            engine.sendBlocks(*transport, 1, getPointers<void const>(sent), 9);
+            engine.sendBlocks(*transport, 2, {getPointers<void const>(sent).front()}, 2);
+        });
+    auto transport = TcpTransport::connect("127.0.0.1", listener.getPort());
+    KvTransferEngine const engine(layout);
+    EXPECT_EQ(engine.receiveBlocks(*transport, 1, getPointers<void>(received)).numTokens, 9);
+    EXPECT_EQ(received, sent);
+    std::vector<std::uint8_t> single(layout.getBlockBytes());
+    EXPECT_EQ(engine.receiveBlocks(*transport, 2, {single.data()}).numTokens, 2);
+    EXPECT_EQ(single, sent.front());
+    sender.get();
+}
+
+TEST(KvTransferTest, splitHeads)
+{
+    // The context instance runs with TP2, the generation instance with TP1: rank 0 of generation pulls each half of
+    // the heads from one context rank.
+    auto const fullLayout = makeLayout();
+    auto const expected = makeBlocks(fullLayout, 2);
+    std::vector<std::vector<std::uint8_t>> received(2, std::vector<std::uint8_t>(fullLayout.getBlockBytes()));
+    EXPECT_EQ(getOverlappingRanks(fullLayout, 2), (std::vector<SizeType32>{0, 1}));
+
+    for (SizeType32 rank = 0; rank < 2; ++rank)
+    {
+        auto const contextLayout = makeLayout(2, rank);
+        EXPECT_EQ(getOverlappingRanks(contextLayout, 1), (std::vector<SizeType32>{0}));
+        auto sent = makeBlocks(contextLayout, 2);
+        TcpListener listener(0, "127.0.0.1");
+        auto sender = std::async(std::launch::async,
+            [&]()
+            {
+                auto transport = listener.accept();
+                return KvTransferEngine(contextLayout).sendBlocks(*transport, 3, getPointers<void const>(sent), 8);
+            });
+        auto transport = TcpTransport::connect("127.0.0.1", listener.getPort());
+        auto const result = KvTransferEngine(fullLayout).receiveBlocks(*transport, 3, getPointers<void>(received));
+        EXPECT_EQ(result.stats.numBytes, 2 * contextLayout.getBlockBytes());
+        sender.get();
+    }
+    EXPECT_EQ(received, expected);
+}
+
+TEST(KvTransferTest, mergeHeads)
+{
+    // The context instance runs with TP1, the generation instance with TP2: each generation rank pulls its half.
+    auto const fullLayout = makeLayout();
+    auto sent = makeBlocks(fullLayout, 2);
+
+    for (SizeType32 rank = 0; rank < 2; ++rank)
+    {
+        auto const generationLayout = makeLayout(2, rank);
+        std::vector<std::vector<std::uint8_t>> received(2, std::vector<std::uint8_t>(generationLayout.getBlockBytes()));
+        TcpListener listener(0, "127.0.0.1");
+        auto sender = std::async(std::launch::async,
+            [&]()
+            {
+                auto transport = listener.accept();
+                return KvTransferEngine(fullLayout).sendBlocks(*transport, 4, getPointers<void const>(sent), 8);
+            });
+        auto transport = TcpTransport::connect("127.0.0.1", listener.getPort());
+        KvTransferEngine(generationLayout).receiveBlocks(*transport, 4, getPointers<void>(received));
+        EXPECT_EQ(sender.get().numBytes, 2 * generationLayout.getBlockBytes());
+        EXPECT_EQ(received, makeBlocks(generationLayout, 2));
+    }
+}
+
+TEST(KvTransferTest, incompatibleLayout)
+{
+    auto const layout = makeLayout();
+    auto other = layout;
+    other.tokensPerBlock *= 2;
+    auto sent = makeBlocks(layout, 1);
+    std::vector<std::uint8_t> received(other.getBlockBytes());
+
+    TcpListener listener(0, "127.0.0.1");
+    auto sender = std::async(std::launch::async,
+        [&]()
+        {
+            auto transport = listener.accept();
+            KvTransferEngine(layout).sendBlocks(*transport, 5, getPointers<void const>(sent), 4);
+        });
+    auto transport = TcpTransport::connect("127.0.0.1", listener.getPort());
+    EXPECT_THROW(
+        KvTransferEngine(other).receiveBlocks(*transport, 5, {received.data()}), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(sender.get(), tensorrt_llm::common::TllmException);
+
+    auto invalid = layout;
+    invalid.tpSize = 3;
+    EXPECT_THROW(KvTransferEngine{invalid}, tensorrt_llm::common::TllmException);
+}
+
+} // namespace tensorrt_llm::runtime
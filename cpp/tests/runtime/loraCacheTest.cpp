@@ -30,6 +30,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstdlib>
 #include <filesystem>
 #include <memory>
 
@@ -164,6 +165,29 @@ TEST_F(LoraCacheTest, LoraCachePageManagerTest)
     EXPECT_EQ(manager.pagePtr(singlePageId2.value().at(0))->data(), expectedPages.at(0)->data());
 }
 
+TEST_F(LoraCacheTest, LoraCachePageManagerHugePages)
+{
+    SizeType32 constexpr maxAdapterSize = 4;
+    SizeType32 constexpr maxAdapterWeights = 8;
+
+    LoraCachePageManagerConfig config(
+        runtime::MemoryType::kPINNED, nvinfer1::DataType::kFLOAT, 8, 6, maxAdapterSize, maxAdapterWeights, 1);
+    // Read when the manager is initialized.
+    ASSERT_EQ(setenv("TRTLLM_LORA_HOST_CACHE_HUGE_PAGES", "1", 1), 0);
+    LoraCachePageManager manager(config, *mManager);
+    unsetenv("TRTLLM_LORA_HOST_CACHE_HUGE_PAGES");
+
+    auto block0 = manager.blockPtr(0);
+    EXPECT_EQ(block0->getMemoryType(), MemoryType::kPINNED);
+    EXPECT_TRUE(ITensor::shapeEquals(block0->getShape(), ITensor::makeShape({6, maxAdapterSize, maxAdapterWeights})));
+    auto pages = manager.claimPages(8);
+    ASSERT_TRUE(pages.has_value());
+    auto page = manager.mutablePagePtr(pages->back());
+    std::fill_n(bufferCast<float>(*page), page->getSize(), 1.0F);
+    manager.releasePages(*pages);
+    EXPECT_EQ(manager.numAvailablePages(), 8);
+}
+
 TEST_F(LoraCacheTest, determineNumPages)
 {
     ModelConfig modelConfig(0, 2, 0, 1, 4, nvinfer1::DataType::kFLOAT);
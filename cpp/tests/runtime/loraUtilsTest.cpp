@@ -17,6 +17,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "tensorrt_llm/common/tllmException.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/iTensor.h"
@@ -62,6 +63,18 @@ TEST_F(LoraUtilsTest, null_values)
 
     EXPECT_THAT([&]() { loraValidateRequestTensorDims(optReqLoraWeights, optReqLoraConfig); },
         testing::Throws<std::runtime_error>());
+
+    // An invalid request is an expected error, without stack trace.
+    try
+    {
+        loraValidateRequestTensorDims(optReqLoraWeights, optReqLoraConfig);
+        FAIL() << "Expected an invalid request error";
+    }
+    catch (common::TllmException const& e)
+    {
+        EXPECT_EQ(e.getErrorCode(), common::TllmErrorCode::kINVALID_ARGUMENT);
+        EXPECT_TRUE(e.getTrace().empty());
+    }
 }
 
 TEST_F(LoraUtilsTest, dims_mem_type)
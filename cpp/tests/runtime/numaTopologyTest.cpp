@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/numaTopology.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+//! \brief A fake sysfs tree.
+class NumaTopologyTest : public ::testing::Test // NOLINT
+{
+protected:
+    void SetUp() override
+    {
+        mRoot = std::filesystem::temp_directory_path() / ("numaTopologyTest." + std::to_string(::getpid()));
+        std::filesystem::remove_all(mRoot);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(mRoot);
+    }
+
+    void writeFile(std::filesystem::path const& path, std::string const& contents) const
+    {
+        std::filesystem::create_directories((mRoot / path).parent_path());
+        std::ofstream(mRoot / path) << contents << '\n';
+    }
+
+    //! \brief Two sockets of 4 cores with 2 threads each, and two GPUs.
+    void writeDualSocket() const
+    {
+        writeFile("devices/system/node/node0/cpulist", "0-3,8-11");
+        writeFile("devices/system/node/node1/cpulist", "4-7,12-15");
+        writeFile("devices/system/node/possible", "0-1");
+        writeFile("bus/pci/devices/0000:3b:00.0/numa_node", "0");
+        writeFile("bus/pci/devices/0000:3b:00.0/local_cpulist", "0-3,8-11");
+        writeFile("bus/pci/devices/0000:d8:00.0/numa_node", "1");
+        writeFile("bus/pci/devices/0000:86:00.0/numa_node", "-1");
+    }
+
+    std::filesystem::path mRoot;
+};
+
+} // namespace
+
+TEST_F(NumaTopologyTest, parseCpuList)
+{
+    EXPECT_EQ(NumaTopology::parseCpuList("0-3,8,10-11\n"), (std::vector<SizeType32>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(NumaTopology::parseCpuList("5"), (std::vector<SizeType32>{5}));
+    EXPECT_TRUE(NumaTopology::parseCpuList("").empty());
+    EXPECT_TRUE(NumaTopology::parseCpuList("\n").empty());
+    EXPECT_THROW((void) NumaTopology::parseCpuList("3-1"), common::TllmException);
+}
+
+TEST_F(NumaTopologyTest, dualSocket)
+{
+    writeDualSocket();
+    NumaTopology const topology(mRoot);
+    ASSERT_EQ(topology.getNumNodes(), 2);
+    EXPECT_EQ(topology.getNodeCpus(1), (std::vector<SizeType32>{4, 5, 6, 7, 12, 13, 14, 15}));
+    EXPECT_THROW((void) topology.getNodeCpus(2), common::TllmException);
+
+    // CUDA reports upper case bus ids.
+    auto const local = topology.getPciDeviceAffinity("0000:3B:00.0");
+    ASSERT_TRUE(local.has_value());
+    EXPECT_EQ(local->numaNode, 0);
+    EXPECT_EQ(local->cpus, topology.getNodeCpus(0));
+
+    // Without local_cpulist, the CPUs of the node are used.
+    auto const remote = topology.getPciDeviceAffinity("0000:d8:00.0");
+    ASSERT_TRUE(remote.has_value());
+    EXPECT_EQ(remote->numaNode, 1);
+    EXPECT_EQ(remote->cpus, topology.getNodeCpus(1));
+
+    EXPECT_FALSE(topology.getPciDeviceAffinity("0000:86:00.0").has_value());
+    EXPECT_FALSE(topology.getPciDeviceAffinity("0000:00:00.0").has_value());
+}
+
+TEST_F(NumaTopologyTest, withoutNuma)
+{
+    writeFile("devices/system/cpu/online", "0-7");
+    NumaTopology const topology(mRoot);
+    ASSERT_EQ(topology.getNumNodes(), 1);
+    EXPECT_EQ(topology.getNodeCpus(0).size(), std::size_t{8});
+
+    // Nothing at all: one node of all CPUs.
+    NumaTopology const empty(mRoot / "missing");
+    ASSERT_EQ(empty.getNumNodes(), 1);
+    EXPECT_FALSE(empty.getNodeCpus(0).empty());
+}
+
+TEST_F(NumaTopologyTest, bindThread)
+{
+    cpu_set_t allowed;
+    ASSERT_EQ(::sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    SizeType32 cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed))
+    {
+        ++cpu;
+    }
+
+    std::thread thread(
+        [cpu]()
+        {
+            EXPECT_TRUE(bindCurrentThreadToCpus({cpu}));
+            EXPECT_EQ(::sched_getcpu(), cpu);
+            EXPECT_FALSE(bindCurrentThreadToCpus({}));
+        });
+    thread.join();
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/requestLatency.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+using Clock = RequestLatencyRecorder::Clock;
+using std::chrono::milliseconds;
+
+//! No request finished yet in eventsRacingFinish.
+auto constexpr kNone = ~texec::IdType{0};
+
+Clock::time_point at(int ms)
+{
+    return Clock::time_point{milliseconds{1000 + ms}};
+}
+
+texec::RequestStats makeStats(texec::IdType id, texec::RequestStage stage, SizeType32 contextPrefillPosition,
+    bool scheduled, bool paused = false)
+{
+    texec::RequestStats stats{};
+    stats.id = id;
+    stats.stage = stage;
+    stats.contextPrefillPosition = contextPrefillPosition;
+    stats.scheduled = scheduled;
+    stats.paused = paused;
+    return stats;
+}
+
+RequestLatencyBreakdown roundTrip(RequestLatencyBreakdown const& breakdown)
+{
+    std::stringstream ss;
+    breakdown.serialize(ss);
+    EXPECT_EQ(ss.str().size(), breakdown.serializedSize());
+    return RequestLatencyBreakdown::deserialize(ss);
+}
+
+} // namespace
+
+TEST(RequestLatencyTest, events)
+{
+    RequestLatencyRecorder recorder{4};
+    ASSERT_TRUE(recorder.start(7, at(0)));
+    EXPECT_EQ(recorder.getNumRequests(), 1);
+
+    recorder.onScheduled(7, at(10));
+    recorder.onScheduled(7, at(15));
+    recorder.onPrefillChunk(7);
+    recorder.onPaused(7, at(20));
+    recorder.onResumed(7, at(25));
+    recorder.onToken(7, at(30));
+    recorder.onToken(7, at(40));
+    recorder.onToken(7, at(50));
+
+    auto const breakdown = recorder.finish(7, at(60));
+    ASSERT_TRUE(breakdown);
+    EXPECT_EQ(breakdown->arrival, at(0));
+    EXPECT_EQ(breakdown->firstScheduled, milliseconds{10});
+    EXPECT_EQ(breakdown->firstToken, milliseconds{30});
+    EXPECT_EQ(breakdown->lastToken, milliseconds{50});
+    EXPECT_EQ(breakdown->getDecodeTime(), milliseconds{20});
+    EXPECT_EQ(breakdown->pausedTime, milliseconds{5});
+    EXPECT_EQ(breakdown->numPreemptions, 1);
+    EXPECT_EQ(breakdown->numPrefillChunks, 1);
+
+    EXPECT_EQ(recorder.getNumRequests(), 0);
+    EXPECT_FALSE(recorder.finish(7, at(70)));
+}
+
+TEST(RequestLatencyTest, unknownRequest)
+{
+    RequestLatencyRecorder recorder{4};
+    recorder.onScheduled(3, at(10));
+    EXPECT_FALSE(recorder.onToken(3, at(20)));
+    EXPECT_FALSE(recorder.getBreakdown(3, at(30)));
+    EXPECT_FALSE(recorder.finish(3, at(30)));
+}
+
+TEST(RequestLatencyTest, pauseBeforeScheduling)
+{
+    RequestLatencyRecorder recorder{4};
+    ASSERT_TRUE(recorder.start(1, at(0)));
+    // Waiting for resources before being scheduled is not a preemption, but is paused time.
+    recorder.onPaused(1, at(5));
+    recorder.onResumed(1, at(10));
+    recorder.onScheduled(1, at(10));
+
+    auto const breakdown = recorder.getBreakdown(1, at(20));
+    ASSERT_TRUE(breakdown);
+    EXPECT_EQ(breakdown->numPreemptions, 0);
+    EXPECT_EQ(breakdown->pausedTime, milliseconds{5});
+    EXPECT_FALSE(breakdown->firstToken);
+    EXPECT_FALSE(breakdown->getDecodeTime());
+}
+
+TEST(RequestLatencyTest, ongoingPause)
+{
+    RequestLatencyRecorder recorder{4};
+    ASSERT_TRUE(recorder.start(1, at(0)));
+    recorder.onScheduled(1, at(1));
+    recorder.onPaused(1, at(10));
+    recorder.onPaused(1, at(15));
+
+    EXPECT_EQ(recorder.getBreakdown(1, at(20))->pausedTime, milliseconds{10});
+    EXPECT_EQ(recorder.getBreakdown(1, at(30))->pausedTime, milliseconds{20});
+
+    auto const breakdown = recorder.finish(1, at(40));
+    EXPECT_EQ(breakdown->pausedTime, milliseconds{30});
+    EXPECT_EQ(breakdown->numPreemptions, 1);
+}
+
+TEST(RequestLatencyTest, requestStats)
+{
+    RequestLatencyRecorder recorder{4};
+    ASSERT_TRUE(recorder.start(2, at(0)));
+
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kQUEUED, 0, false), at(5));
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kCONTEXT_IN_PROGRESS, 128, true), at(10));
+    // Reading the same iteration twice does not count its chunk twice.
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kCONTEXT_IN_PROGRESS, 128, true), at(10));
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kCONTEXT_IN_PROGRESS, 256, true), at(20));
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kCONTEXT_IN_PROGRESS, 256, false, true), at(30));
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kCONTEXT_IN_PROGRESS, 384, true), at(45));
+    recorder.onRequestStats(makeStats(2, texec::RequestStage::kGENERATION_IN_PROGRESS, 384, true), at(50));
+
+    auto const breakdown = recorder.getBreakdown(2, at(60));
+    ASSERT_TRUE(breakdown);
+    EXPECT_EQ(breakdown->firstScheduled, milliseconds{10});
+    EXPECT_EQ(breakdown->numPrefillChunks, 3);
+    EXPECT_EQ(breakdown->numPreemptions, 1);
+    EXPECT_EQ(breakdown->pausedTime, milliseconds{15});
+}
+
+TEST(RequestLatencyTest, serialization)
+{
+    RequestLatencyBreakdown breakdown;
+    breakdown.arrival = at(0);
+    EXPECT_EQ(roundTrip(breakdown), breakdown);
+
+    breakdown.firstScheduled = milliseconds{3};
+    breakdown.lastToken = milliseconds{9};
+    breakdown.pausedTime = milliseconds{2};
+    breakdown.numPreemptions = 1;
+    breakdown.numPrefillChunks = 4;
+    EXPECT_EQ(roundTrip(breakdown), breakdown);
+
+    std::stringstream ss;
+    breakdown.serialize(ss);
+    auto truncated = ss.str();
+    truncated.pop_back();
+    std::istringstream is{truncated};
+    EXPECT_THROW(static_cast<void>(RequestLatencyBreakdown::deserialize(is)), tensorrt_llm::common::TllmException);
+}
+
+TEST(RequestLatencyTest, fullTable)
+{
+    SizeType32 constexpr maxNumRequests = 8;
+    RequestLatencyRecorder recorder{maxNumRequests};
+    // Requests beyond the probe window of the home slot of a request are not recorded.
+    texec::IdType requestId = 0;
+    while (recorder.start(requestId, at(0)))
+    {
+        ++requestId;
+    }
+    EXPECT_GE(recorder.getNumRequests(), maxNumRequests);
+    EXPECT_FALSE(recorder.getBreakdown(requestId, at(1)));
+
+    for (texec::IdType id = 0; id < requestId; ++id)
+    {
+        ASSERT_TRUE(recorder.finish(id, at(1)));
+    }
+    EXPECT_EQ(recorder.getNumRequests(), 0);
+    EXPECT_TRUE(recorder.start(requestId, at(2)));
+}
+
+TEST(RequestLatencyTest, concurrentRequests)
+{
+    int constexpr numThreads = 4;
+    int constexpr numRequestsPerThread = 10000;
+    SizeType32 constexpr maxNumRequests = 64;
+    RequestLatencyRecorder recorder{maxNumRequests};
+
+    std::vector<std::thread> threads;
+    std::vector<int> numMismatches(numThreads, 0);
+    for (int t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                for (int i = 0; i < numRequestsPerThread; ++i)
+                {
+                    auto const id = static_cast<texec::IdType>(i * numThreads + t);
+                    if (!recorder.start(id, at(i)))
+                    {
+                        ++numMismatches[t];
+                        continue;
+                    }
+                    recorder.onScheduled(id, at(i + 1));
+                    recorder.onToken(id, at(i + 2));
+                    recorder.onToken(id, at(i + 3));
+                    auto const breakdown = recorder.finish(id, at(i + 4));
+                    if (!breakdown || breakdown->arrival != at(i) || breakdown->firstScheduled != milliseconds{1}
+                        || breakdown->firstToken != milliseconds{2} || breakdown->lastToken != milliseconds{3})
+                    {
+                        ++numMismatches[t];
+                    }
+                }
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int t = 0; t < numThreads; ++t)
+    {
+        EXPECT_EQ(numMismatches[t], 0) << "thread " << t;
+    }
+    EXPECT_EQ(recorder.getNumRequests(), 0);
+}
+
+TEST(RequestLatencyTest, eventsRacingFinish)
+{
+    // A small table, so that the slots of finished requests are reused right away.
+    RequestLatencyRecorder recorder{1};
+    int constexpr numRequests = 20000;
+    std::atomic<texec::IdType> lastFinished{kNone};
+    std::atomic<bool> running{false};
+    std::atomic<bool> done{false};
+
+    // Records late events of the requests just finished, which must not land in the requests reusing their slots.
+    std::thread lateEvents(
+        [&]
+        {
+            running.store(true);
+            while (!done.load())
+            {
+                auto const requestId = lastFinished.load();
+                if (requestId == kNone)
+                {
+                    continue;
+                }
+                recorder.onScheduled(requestId, at(1000));
+                recorder.onToken(requestId, at(1000));
+                recorder.onPrefillChunk(requestId);
+                recorder.onPaused(requestId, at(1000));
+            }
+        });
+
+    while (!running.load())
+    {
+        std::this_thread::yield();
+    }
+    int numMismatches = 0;
+    for (int i = 0; i < numRequests; ++i)
+    {
+        auto const requestId = static_cast<texec::IdType>(i);
+        ASSERT_TRUE(recorder.start(requestId, at(0)));
+        recorder.onToken(requestId, at(1));
+        auto const breakdown = recorder.finish(requestId, at(2));
+        lastFinished.store(requestId);
+        if (!breakdown || breakdown->firstScheduled || breakdown->firstToken != milliseconds{1}
+            || breakdown->numPrefillChunks != 0 || breakdown->pausedTime != milliseconds{0})
+        {
+            ++numMismatches;
+        }
+    }
+    done.store(true);
+    lateEvents.join();
+
+    EXPECT_EQ(numMismatches, 0);
+    EXPECT_EQ(recorder.getNumRequests(), 0);
+}
+
+} // namespace tensorrt_llm::runtime
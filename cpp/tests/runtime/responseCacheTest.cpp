@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/responseCache.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+texec::Result makeResult(texec::VecTokens tokens, bool isFinal = true)
+{
+    texec::Result result{};
+    result.isFinal = isFinal;
+    result.isSequenceFinal = isFinal;
+    result.outputTokenIds = {std::move(tokens)};
+    result.finishReasons = {isFinal ? texec::FinishReason::kEND_ID : texec::FinishReason::kNOT_FINISHED};
+    return result;
+}
+
+} // namespace
+
+TEST(ResponseCacheTest, lookup)
+{
+    ResponseCache cache(1 << 20);
+    EXPECT_FALSE(cache.lookup("a", 1));
+
+    cache.insert("a", {makeResult({1, 2, 3})});
+    auto const responses = cache.lookup("a", 42);
+    ASSERT_TRUE(responses);
+    ASSERT_EQ(responses->size(), 1);
+    EXPECT_EQ(responses->front().getRequestId(), 42);
+    EXPECT_EQ(responses->front().getResult().outputTokenIds, (texec::BeamTokens{{1, 2, 3}}));
+
+    auto const stats = cache.getStats();
+    EXPECT_EQ(stats.numHits, 1);
+    EXPECT_EQ(stats.numMisses, 1);
+    EXPECT_EQ(stats.numEntries, 1);
+}
+
+TEST(ResponseCacheTest, lruEviction)
+{
+    ResponseCache probe(1 << 20);
+    probe.insert("a", {makeResult(texec::VecTokens(100))});
+    auto const entryBytes = probe.getStats().usedBytes;
+
+    // Room for two entries.
+    ResponseCache cache(2 * entryBytes + entryBytes / 2);
+    cache.insert("a", {makeResult(texec::VecTokens(100))});
+    cache.insert("b", {makeResult(texec::VecTokens(100))});
+    EXPECT_TRUE(cache.lookup("a", 1));
+    cache.insert("c", {makeResult(texec::VecTokens(100))});
+
+    EXPECT_TRUE(cache.lookup("a", 1));
+    EXPECT_FALSE(cache.lookup("b", 1));
+    EXPECT_TRUE(cache.lookup("c", 1));
+    EXPECT_EQ(cache.getStats().numEvictions, 1);
+    EXPECT_LE(cache.getStats().usedBytes, 2 * entryBytes + entryBytes / 2);
+
+    // Too large to be cached at all.
+    cache.insert("d", {makeResult(texec::VecTokens(10000))});
+    EXPECT_FALSE(cache.lookup("d", 1));
+    EXPECT_TRUE(cache.lookup("c", 1));
+}
+
+TEST(ResponseCacheTest, timeToLive)
+{
+    ResponseCache cache(1 << 20, std::chrono::milliseconds(1));
+    cache.insert("a", {makeResult({1})});
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(cache.lookup("a", 1));
+    EXPECT_EQ(cache.getStats().numExpirations, 1);
+    EXPECT_EQ(cache.getStats().numEntries, 0);
+    EXPECT_EQ(cache.getStats().usedBytes, 0);
+}
+
+TEST(ResponseCacheTest, streamingRecording)
+{
+    ResponseCache cache(1 << 20);
+    cache.startRecording(7, "a");
+    cache.startRecording(8, "b");
+    cache.recordResponse(texec::Response(7, makeResult({1}, false)));
+    cache.recordResponse(texec::Response(8, makeResult({5}, false)));
+    cache.recordResponse(texec::Response(9, makeResult({6})));
+    EXPECT_FALSE(cache.lookup("a", 1));
+    cache.recordResponse(texec::Response(7, makeResult({2})));
+    cache.recordResponse(texec::Response(8, "failure"));
+
+    auto const responses = cache.lookup("a", 100);
+    ASSERT_TRUE(responses);
+    ASSERT_EQ(responses->size(), 2);
+    EXPECT_FALSE((*responses)[0].getResult().isFinal);
+    EXPECT_EQ((*responses)[0].getResult().outputTokenIds, (texec::BeamTokens{{1}}));
+    EXPECT_TRUE((*responses)[1].getResult().isFinal);
+    EXPECT_EQ((*responses)[1].getRequestId(), 100);
+    EXPECT_FALSE(cache.lookup("b", 1));
+}
+
+TEST(ResponseCacheTest, makeKey)
+{
+    texec::Request const request({1, 2, 3}, 16);
+    auto const key = ResponseCache::makeKey(request);
+    ASSERT_TRUE(key);
+    EXPECT_EQ(ResponseCache::makeKey(texec::Request({1, 2, 3}, 16)), key);
+    EXPECT_NE(ResponseCache::makeKey(texec::Request({1, 2, 4}, 16)), key);
+    EXPECT_NE(ResponseCache::makeKey(texec::Request({1, 2, 3}, 17)), key);
+    EXPECT_NE(ResponseCache::makeKey(texec::Request({1, 2, 3}, 16, true)), key);
+
+    auto withStopWords = request;
+    withStopWords.setStopWords({{4}});
+    EXPECT_NE(ResponseCache::makeKey(withStopWords), key);
+
+    auto withLora = request;
+    withLora.setLoraConfig(texec::LoraConfig(3));
+    EXPECT_NE(ResponseCache::makeKey(withLora), key);
+
+    auto sampled = request;
+    sampled.setSamplingConfig(texec::SamplingConfig(1, 4));
+    EXPECT_FALSE(ResponseCache::makeKey(sampled));
+
+    auto beamSearch = request;
+    beamSearch.setSamplingConfig(texec::SamplingConfig(2));
+    EXPECT_FALSE(ResponseCache::makeKey(beamSearch));
+
+    auto topK1 = request;
+    topK1.setSamplingConfig(texec::SamplingConfig(1, 1, 0.9f));
+    EXPECT_TRUE(ResponseCache::makeKey(topK1));
+
+    auto withLogits = request;
+    withLogits.setOutputConfig(texec::OutputConfig(false, false, true));
+    EXPECT_FALSE(ResponseCache::makeKey(withLogits));
+}
+
+} // namespace tensorrt_llm::runtime
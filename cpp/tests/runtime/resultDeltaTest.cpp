@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/resultDelta.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace texec = tensorrt_llm::executor;
+
+namespace
+{
+
+texec::Result makeResult(texec::BeamTokens tokens, bool isFinal = false)
+{
+    texec::Result result{};
+    result.isFinal = isFinal;
+    result.isSequenceFinal = isFinal;
+    result.outputTokenIds = std::move(tokens);
+    result.finishReasons.assign(
+        result.outputTokenIds.size(), isFinal ? texec::FinishReason::kEND_ID : texec::FinishReason::kNOT_FINISHED);
+    return result;
+}
+
+ResultDelta roundTrip(ResultDelta const& delta)
+{
+    std::stringstream ss;
+    delta.serialize(ss);
+    EXPECT_EQ(ss.str().size(), delta.serializedSize());
+    return ResultDelta::deserialize(ss);
+}
+
+} // namespace
+
+TEST(ResultDeltaTest, appendOnly)
+{
+    ResultDeltaEncoder encoder;
+    ResultDeltaDecoder decoder;
+
+    auto delta = encoder.encode(makeResult({{1, 2, 3}, {1, 2, 4}}));
+    EXPECT_EQ(delta.beams[0].tokenPrefixLength, 0);
+    EXPECT_EQ(decoder.decode(roundTrip(delta)).outputTokenIds, (texec::BeamTokens{{1, 2, 3}, {1, 2, 4}}));
+
+    delta = encoder.encode(makeResult({{1, 2, 3, 5}, {1, 2, 4, 6}}));
+    ASSERT_EQ(delta.beams.size(), 2);
+    EXPECT_EQ(delta.beams[0].sourceBeam, 0);
+    EXPECT_EQ(delta.beams[0].tokenPrefixLength, 3);
+    EXPECT_EQ(delta.beams[0].tokens, (texec::VecTokens{5}));
+    EXPECT_EQ(delta.beams[1].sourceBeam, 1);
+    EXPECT_EQ(delta.beams[1].tokens, (texec::VecTokens{6}));
+    EXPECT_EQ(decoder.decode(roundTrip(delta)).outputTokenIds, (texec::BeamTokens{{1, 2, 3, 5}, {1, 2, 4, 6}}));
+}
+
+TEST(ResultDeltaTest, beamReordering)
+{
+    ResultDeltaEncoder encoder;
+    ResultDeltaDecoder decoder;
+
+    (void) decoder.decode(roundTrip(encoder.encode(makeResult({{1, 2, 3}, {1, 7, 8}}))));
+
+    // Both beams now descend from the previous beam 1, and the first beam rewrote its last token.
+    texec::BeamTokens const expected{{1, 7, 8, 9}, {1, 7, 5}};
+    auto const delta = encoder.encode(makeResult(expected, true));
+    EXPECT_EQ(delta.beams[0].sourceBeam, 1);
+    EXPECT_EQ(delta.beams[0].tokenPrefixLength, 3);
+    EXPECT_EQ(delta.beams[1].sourceBeam, 1);
+    EXPECT_EQ(delta.beams[1].tokenPrefixLength, 2);
+    EXPECT_EQ(delta.beams[1].tokens, (texec::VecTokens{5}));
+
+    auto const& result = decoder.decode(roundTrip(delta));
+    EXPECT_EQ(result.outputTokenIds, expected);
+    EXPECT_TRUE(result.isFinal);
+    EXPECT_EQ(result.finishReasons[1], texec::FinishReason::kEND_ID);
+}
+
+TEST(ResultDeltaTest, logProbs)
+{
+    ResultDeltaEncoder encoder;
+    ResultDeltaDecoder decoder;
+
+    auto result = makeResult({{1, 2}});
+    result.logProbs = std::vector<texec::VecLogProbs>{{-0.5f, -1.f}};
+    result.cumLogProbs = texec::VecLogProbs{-1.5f};
+    (void) decoder.decode(roundTrip(encoder.encode(result)));
+
+    result = makeResult({{1, 2, 3}});
+    result.logProbs = std::vector<texec::VecLogProbs>{{-0.5f, -1.f, -0.25f}};
+    result.cumLogProbs = texec::VecLogProbs{-1.75f};
+    auto const delta = encoder.encode(result);
+    EXPECT_EQ(delta.beams[0].logProbPrefixLength, 2);
+    EXPECT_EQ(delta.beams[0].logProbs, (texec::VecLogProbs{-0.25f}));
+
+    auto const& decoded = decoder.decode(roundTrip(delta));
+    ASSERT_TRUE(decoded.logProbs.has_value());
+    EXPECT_EQ(*decoded.logProbs, *result.logProbs);
+    EXPECT_EQ(decoded.cumLogProbs, result.cumLogProbs);
+}
+
+TEST(ResultDeltaTest, disabled)
+{
+    ResultDeltaEncoder encoder(false);
+    ResultDeltaDecoder decoder;
+
+    (void) decoder.decode(encoder.encode(makeResult({{1, 2}})));
+    auto const delta = encoder.encode(makeResult({{1, 2, 3}}));
+    EXPECT_EQ(delta.beams[0].tokenPrefixLength, 0);
+    EXPECT_EQ(delta.beams[0].tokens, (texec::VecTokens{1, 2, 3}));
+    EXPECT_EQ(decoder.decode(delta).outputTokenIds, (texec::BeamTokens{{1, 2, 3}}));
+}
+
+TEST(ResultDeltaTest, invalidSource)
+{
+    ResultDeltaDecoder decoder;
+    ResultDelta delta;
+    delta.beams.resize(1);
+    delta.beams[0].sourceBeam = 1;
+    delta.beams[0].tokenPrefixLength = 2;
+    EXPECT_THROW((void) decoder.decode(delta), common::TllmException);
+}
+
+TEST(ResultDeltaTest, responses)
+{
+    ResponseDeltaEncoder encoder;
+    ResponseDeltaDecoder decoder;
+
+    std::vector<texec::Response> responses;
+    responses.emplace_back(1, makeResult({{1, 2}}));
+    responses.emplace_back(2, makeResult({{3}}));
+    auto decoded = decoder.decode(encoder.encode(responses));
+    ASSERT_EQ(decoded.size(), 2);
+    EXPECT_EQ(encoder.getNumActiveSequences(), 2);
+    EXPECT_EQ(decoder.getNumActiveSequences(), 2);
+
+    responses.clear();
+    responses.emplace_back(1, makeResult({{1, 2, 4}}, true));
+    responses.emplace_back(2, "failure");
+    decoded = decoder.decode(encoder.encode(responses));
+    ASSERT_EQ(decoded.size(), 2);
+    EXPECT_EQ(decoded[0].getRequestId(), 1);
+    EXPECT_EQ(decoded[0].getResult().outputTokenIds, (texec::BeamTokens{{1, 2, 4}}));
+    EXPECT_TRUE(decoded[1].hasError());
+    EXPECT_EQ(decoded[1].getErrorMsg(), "failure");
+    EXPECT_EQ(encoder.getNumActiveSequences(), 0);
+    EXPECT_EQ(decoder.getNumActiveSequences(), 0);
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/rnnStateCache.h"
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/rnnStateBuffers.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace tensorrt_llm::runtime
+{
+
+class RnnStateCacheTest : public ::testing::Test // NOLINT(cppcoreguidelines-pro-type-member-init)
+{
+protected:
+    static auto constexpr kNumLayers = 2;
+    static auto constexpr kNumSlots = 4;
+    static auto constexpr kStateSize = 3;
+    static auto constexpr kHiddenSize = 8;
+    static auto constexpr kConvKernel = 4;
+    static auto constexpr kInterval = 4;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mManager = std::make_unique<BufferManager>(mStream);
+
+        // Paged state buffers on the host, laid out like RnnStateBuffers: [layer * slots + slot, ...].
+        mBuffers.rnnStates = BufferManager::cpu(
+            ITensor::makeShape({kNumLayers * kNumSlots, kStateSize, kHiddenSize}), nvinfer1::DataType::kFLOAT);
+        mBuffers.convStates = BufferManager::cpu(
+            ITensor::makeShape({kNumLayers * kNumSlots, kConvKernel - 1, kHiddenSize}), nvinfer1::DataType::kHALF);
+        for (SizeType32 layer = 0; layer < kNumLayers; ++layer)
+        {
+            mBuffers.rnnState.push_back(ITensor::slice(mBuffers.rnnStates, layer * kNumSlots, kNumSlots));
+            mBuffers.convState.push_back(ITensor::slice(mBuffers.convStates, layer * kNumSlots, kNumSlots));
+        }
+        mBuffers.slotMappingHost = BufferManager::cpu(ITensor::makeShape({kNumSlots}), nvinfer1::DataType::kINT32);
+        // Batch index b uses state slot kNumSlots - 1 - b.
+        auto* slotMapping = bufferCast<SizeType32>(*mBuffers.slotMappingHost);
+        for (SizeType32 b = 0; b < kNumSlots; ++b)
+        {
+            slotMapping[b] = kNumSlots - 1 - b;
+        }
+    }
+
+    static VecUniqueTokens makeTokens(std::initializer_list<TokenIdType> ids)
+    {
+        VecUniqueTokens tokens;
+        for (auto id : ids)
+        {
+            tokens.push_back(UniqueToken{id, 0});
+        }
+        return tokens;
+    }
+
+    static VecUniqueTokens makeTokens(SizeType32 length, TokenIdType first)
+    {
+        VecUniqueTokens tokens(length);
+        for (SizeType32 i = 0; i < length; ++i)
+        {
+            tokens[i] = UniqueToken{first + i, 0};
+        }
+        return tokens;
+    }
+
+    //! \brief Fill the states of a slot of every layer with value + layer.
+    void fillSlot(SizeType32 slot, float value)
+    {
+        for (SizeType32 layer = 0; layer < kNumLayers; ++layer)
+        {
+            auto rnnState = ITensor::slice(mBuffers.rnnState[layer], slot, 1);
+            auto* rnn = bufferCast<float>(*rnnState);
+            std::fill_n(rnn, rnnState->getSize(), value + static_cast<float>(layer));
+            auto convState = ITensor::slice(mBuffers.convState[layer], slot, 1);
+            auto* conv = bufferCast<half>(*convState);
+            std::fill_n(conv, convState->getSize(), __float2half(value + static_cast<float>(layer)));
+        }
+    }
+
+    void expectSlot(SizeType32 slot, float value)
+    {
+        for (SizeType32 layer = 0; layer < kNumLayers; ++layer)
+        {
+            auto rnnState = ITensor::slice(mBuffers.rnnState[layer], slot, 1);
+            auto const* rnn = bufferCast<float>(*rnnState);
+            for (std::size_t i = 0; i < rnnState->getSize(); ++i)
+            {
+                ASSERT_EQ(rnn[i], value + static_cast<float>(layer)) << "layer " << layer << " index " << i;
+            }
+            auto convState = ITensor::slice(mBuffers.convState[layer], slot, 1);
+            auto const* conv = bufferCast<half>(*convState);
+            for (std::size_t i = 0; i < convState->getSize(); ++i)
+            {
+                ASSERT_EQ(__half2float(conv[i]), value + static_cast<float>(layer)) << "layer " << layer;
+            }
+        }
+    }
+
+    std::unique_ptr<RnnStateCache> makeCache(SizeType32 maxNumEntries)
+    {
+        return std::make_unique<RnnStateCache>(maxNumEntries, kInterval, mBuffers, *mManager, MemoryType::kCPU);
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::unique_ptr<BufferManager> mManager;
+    RnnStateBuffers mBuffers;
+};
+
+TEST_F(RnnStateCacheTest, StoreAndRestore)
+{
+    auto cache = makeCache(4);
+    auto const systemPrompt = makeTokens(8, 100);
+
+    // Batch index 0 prefilled the system prompt into slot 3.
+    fillSlot(3, 1.F);
+    EXPECT_EQ(cache->store(systemPrompt, 8, mBuffers, 0), 0);
+    EXPECT_TRUE(cache->contains(systemPrompt, 8));
+    EXPECT_FALSE(cache->contains(systemPrompt, 4));
+    EXPECT_EQ(cache->getNumEntries(), 1);
+
+    // A new request at batch index 2 shares the system prompt.
+    auto prompt = systemPrompt;
+    auto const suffix = makeTokens({7, 8, 9});
+    prompt.insert(prompt.end(), suffix.begin(), suffix.end());
+    fillSlot(1, 0.F);
+    auto const match = cache->find(prompt);
+    ASSERT_TRUE(match.has_value());
+    EXPECT_EQ(match->numTokens, 8);
+    cache->restore(*match, mBuffers, 2);
+    expectSlot(1, 1.F);
+    expectSlot(3, 1.F);
+
+    auto const& stats = cache->getStats();
+    EXPECT_EQ(stats.numHits, std::size_t{1});
+    EXPECT_EQ(stats.numStores, std::size_t{1});
+    EXPECT_EQ(stats.numTokensSaved, std::size_t{8});
+}
+
+TEST_F(RnnStateCacheTest, LongestPrefix)
+{
+    auto cache = makeCache(4);
+    auto const prompt = makeTokens(13, 0);
+    fillSlot(3, 4.F);
+    cache->store(prompt, 4, mBuffers, 0);
+    fillSlot(3, 12.F);
+    cache->store(prompt, 12, mBuffers, 0);
+
+    auto match = cache->find(prompt);
+    ASSERT_TRUE(match.has_value());
+    EXPECT_EQ(match->numTokens, 12);
+    cache->restore(*match, mBuffers, 3);
+    expectSlot(0, 12.F);
+
+    // The last prompt token is always prefilled, so a prompt of 12 tokens only reuses the first 4.
+    match = cache->find(makeTokens(12, 0));
+    ASSERT_TRUE(match.has_value());
+    EXPECT_EQ(match->numTokens, 4);
+
+    // A different token in the second interval only matches the first one.
+    auto other = prompt;
+    other[5].tokenId = 1000;
+    match = cache->find(other);
+    ASSERT_TRUE(match.has_value());
+    EXPECT_EQ(match->numTokens, 4);
+
+    EXPECT_FALSE(cache->find(makeTokens(13, 1)).has_value());
+    EXPECT_FALSE(cache->find(makeTokens(3, 0)).has_value());
+    EXPECT_EQ(cache->getStats().numMisses, std::size_t{2});
+}
+
+TEST_F(RnnStateCacheTest, LoraTaskIsPartOfTheKey)
+{
+    auto cache = makeCache(4);
+    auto const prompt = makeTokens(9, 0);
+    fillSlot(3, 1.F);
+    cache->store(prompt, 8, mBuffers, 0, 1);
+
+    EXPECT_TRUE(cache->find(prompt, 1).has_value());
+    EXPECT_FALSE(cache->find(prompt, 2).has_value());
+    EXPECT_FALSE(cache->find(prompt).has_value());
+}
+
+TEST_F(RnnStateCacheTest, EvictsLeastRecentlyUsed)
+{
+    auto cache = makeCache(2);
+    auto const promptA = makeTokens(5, 0);
+    auto const promptB = makeTokens(5, 100);
+    auto const promptC = makeTokens(5, 200);
+
+    fillSlot(3, 1.F);
+    auto const entryA = cache->store(promptA, 4, mBuffers, 0);
+    fillSlot(3, 2.F);
+    auto const entryB = cache->store(promptB, 4, mBuffers, 0);
+    EXPECT_NE(entryA, entryB);
+
+    // Storing an existing prefix does not copy the state again.
+    fillSlot(3, 5.F);
+    EXPECT_EQ(cache->store(promptB, 4, mBuffers, 0), entryB);
+    EXPECT_EQ(cache->getStats().numStores, std::size_t{2});
+
+    // Using A makes B the least recently used one.
+    EXPECT_TRUE(cache->find(promptA).has_value());
+    fillSlot(3, 3.F);
+    EXPECT_EQ(cache->store(promptC, 4, mBuffers, 0), entryB);
+    EXPECT_EQ(cache->getStats().numEvictions, std::size_t{1});
+    EXPECT_EQ(cache->getNumEntries(), 2);
+
+    EXPECT_FALSE(cache->find(promptB).has_value());
+    auto const matchA = cache->find(promptA);
+    ASSERT_TRUE(matchA.has_value());
+    cache->restore(*matchA, mBuffers, 1);
+    expectSlot(2, 1.F);
+    auto const matchC = cache->find(promptC);
+    ASSERT_TRUE(matchC.has_value());
+    cache->restore(*matchC, mBuffers, 1);
+    expectSlot(2, 3.F);
+}
+
+TEST_F(RnnStateCacheTest, InvalidArguments)
+{
+    auto cache = makeCache(2);
+    auto const prompt = makeTokens(9, 0);
+    EXPECT_THROW(cache->store(prompt, 6, mBuffers, 0), common::TllmException);
+    EXPECT_THROW(cache->store(prompt, 12, mBuffers, 0), common::TllmException);
+    EXPECT_THROW(cache->store(prompt, 8, mBuffers, kNumSlots), common::TllmException);
+
+    auto const entry = cache->store(prompt, 4, mBuffers, 0);
+    EXPECT_THROW(cache->restore(RnnStateCache::Match{entry, 8}, mBuffers, 0), common::TllmException);
+
+    RnnStateBuffers unpaged;
+    unpaged.rnnState = mBuffers.rnnState;
+    unpaged.convState = mBuffers.convState;
+    EXPECT_THROW(RnnStateCache(2, kInterval, unpaged, *mManager, MemoryType::kCPU), common::TllmException);
+}
+
+} // namespace tensorrt_llm::runtime
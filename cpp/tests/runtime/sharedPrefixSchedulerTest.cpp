@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/sharedPrefixScheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <set>
+
+using namespace tensorrt_llm::runtime;
+namespace tb = tensorrt_llm::batch_manager;
+
+namespace
+{
+
+auto constexpr kTokensPerBlock = 4;
+
+using VecTokens = tb::LlmRequest::VecTokens;
+
+//! \brief Reuse tree of a block manager, as the set of the committed prefixes of whole blocks.
+class SimulatedBlockManager
+{
+public:
+    //! \brief Store the full prompt blocks of a request for reuse, as after its context phase.
+    void storeContextBlocks(tb::LlmRequest const& request)
+    {
+        auto const& tokens = request.getTokens(0);
+        auto const numBlocks = (request.mPromptLen - 1) / kTokensPerBlock;
+        for (SizeType32 block = 1; block <= numBlocks; ++block)
+        {
+            mPrefixes.emplace(tokens.begin(), tokens.begin() + block * kTokensPerBlock);
+        }
+    }
+
+    SizeType32 numReusableBlocks(tb::LlmRequest const& request) const
+    {
+        auto const& tokens = request.getTokens(0);
+        SizeType32 numBlocks = 0;
+        while ((numBlocks + 1) * kTokensPerBlock < request.mPromptLen
+            && mPrefixes.count(VecTokens(tokens.begin(), tokens.begin() + (numBlocks + 1) * kTokensPerBlock)))
+        {
+            ++numBlocks;
+        }
+        return numBlocks;
+    }
+
+    SharedPrefixScheduler::ReusableBlocksFunc reusableBlocks() const
+    {
+        return [this](tb::LlmRequest const& request) { return numReusableBlocks(request); };
+    }
+
+private:
+    std::set<VecTokens> mPrefixes;
+};
+
+//! \brief A request whose prompt starts with numSharedBlocks blocks of the system prompt, then numUniqueTokens tokens
+//! of its own.
+SharedPrefixScheduler::LlmRequestPtr makeRequest(tb::LlmRequest::RequestIdType requestId, SizeType32 numSharedBlocks,
+    SizeType32 numUniqueTokens, std::optional<LoraTaskIdType> loraTaskId = std::nullopt)
+{
+    auto tokens = std::make_shared<VecTokens>(numSharedBlocks * kTokensPerBlock + numUniqueTokens);
+    std::iota(tokens->begin(), tokens->begin() + numSharedBlocks * kTokensPerBlock, 0);
+    std::fill(tokens->begin() + numSharedBlocks * kTokensPerBlock, tokens->end(), 1000 + requestId);
+    return std::make_shared<tb::LlmRequest>(requestId, 8, tokens, SamplingConfig{1}, false, std::nullopt,
+        std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, loraTaskId);
+}
+
+std::vector<tb::LlmRequest::RequestIdType> getIds(SharedPrefixScheduler::RequestVector const& requests)
+{
+    std::vector<tb::LlmRequest::RequestIdType> ids;
+    for (auto const& request : requests)
+    {
+        ids.push_back(request->mRequestId);
+    }
+    return ids;
+}
+
+using Ids = std::vector<tb::LlmRequest::RequestIdType>;
+
+} // namespace
+
+TEST(SharedPrefixSchedulerTest, leaderPrefillsSharedPrefix)
+{
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock};
+    SharedPrefixScheduler::RequestVector const pending{
+        makeRequest(1, 3, 5), makeRequest(2, 0, 9), makeRequest(3, 3, 5), makeRequest(4, 3, 2)};
+
+    auto plan = scheduler.schedule(pending, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{1, 2}));
+    EXPECT_EQ(getIds(plan.deferred), (Ids{3, 4}));
+    EXPECT_TRUE(scheduler.isLeader(1));
+    EXPECT_FALSE(scheduler.isLeader(2));
+    EXPECT_EQ(scheduler.getStats().numDeferredBlocks, 6);
+
+    // The followers wait for the leader.
+    plan = scheduler.schedule(plan.deferred, blockManager.reusableBlocks());
+    EXPECT_TRUE(plan.admitted.empty());
+    EXPECT_EQ(getIds(plan.deferred), (Ids{3, 4}));
+
+    // And reuse its blocks once it stored them.
+    blockManager.storeContextBlocks(*pending[0]);
+    scheduler.releaseLeader(1);
+    EXPECT_EQ(scheduler.getNumLeaders(), 0);
+    plan = scheduler.schedule(plan.deferred, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{3, 4}));
+    EXPECT_TRUE(plan.deferred.empty());
+    EXPECT_EQ(blockManager.numReusableBlocks(*pending[2]), 3);
+    EXPECT_EQ(scheduler.getNumLeaders(), 0);
+}
+
+TEST(SharedPrefixSchedulerTest, reusablePrefixIsNotDeferred)
+{
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock, 2};
+    blockManager.storeContextBlocks(*makeRequest(0, 2, 1));
+
+    // One block beyond the reusable ones is shared, less than the minimum.
+    SharedPrefixScheduler::RequestVector const pending{makeRequest(1, 3, 5), makeRequest(2, 3, 5)};
+    auto const plan = scheduler.schedule(pending, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{1, 2}));
+    EXPECT_TRUE(plan.deferred.empty());
+    EXPECT_EQ(scheduler.getNumLeaders(), 0);
+}
+
+TEST(SharedPrefixSchedulerTest, lastPromptBlockIsNotShared)
+{
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock};
+    // Identical prompts of one block: the block holds the last prompt token of both.
+    SharedPrefixScheduler::RequestVector const pending{makeRequest(1, 1, 0), makeRequest(2, 1, 0)};
+    auto const plan = scheduler.schedule(pending, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{1, 2}));
+}
+
+TEST(SharedPrefixSchedulerTest, loraTasksAreNotShared)
+{
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock};
+    SharedPrefixScheduler::RequestVector const pending{
+        makeRequest(1, 3, 5, 7), makeRequest(2, 3, 5, 8), makeRequest(3, 3, 5, 7)};
+    auto const plan = scheduler.schedule(pending, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{1, 2}));
+    EXPECT_EQ(getIds(plan.deferred), (Ids{3}));
+}
+
+TEST(SharedPrefixSchedulerTest, followerLeadsWhenLeaderIsCancelled)
+{
+    SimulatedBlockManager blockManager;
+    SharedPrefixScheduler scheduler{kTokensPerBlock};
+    SharedPrefixScheduler::RequestVector const pending{
+        makeRequest(1, 3, 5), makeRequest(2, 3, 5), makeRequest(3, 3, 5)};
+    auto plan = scheduler.schedule(pending, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.deferred), (Ids{2, 3}));
+
+    // The leader is cancelled before storing its blocks.
+    scheduler.releaseLeader(1);
+    plan = scheduler.schedule(plan.deferred, blockManager.reusableBlocks());
+    EXPECT_EQ(getIds(plan.admitted), (Ids{2}));
+    EXPECT_EQ(getIds(plan.deferred), (Ids{3}));
+    EXPECT_TRUE(scheduler.isLeader(2));
+    EXPECT_EQ(scheduler.getStats().numLeaders, 2);
+}
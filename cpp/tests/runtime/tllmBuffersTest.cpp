@@ -25,6 +25,7 @@
 #include "tensorrt_llm/runtime/tllmBuffers.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <random>
@@ -128,6 +129,60 @@ TEST_F(TllmBuffersTest, HostAllocator)
     EXPECT_EQ(allocator.getMemoryType(), MemoryType::kCPU);
 }
 
+TEST_F(TllmBuffersTest, HugePages)
+{
+    auto constexpr pageBytes = getHugePageBytes(HugePageSize::k2MB);
+    auto const mapping = mapHugePages(pageBytes + 1);
+    ASSERT_NE(mapping.data, nullptr);
+    EXPECT_EQ(mapping.size, 2 * pageBytes);
+    if (mapping.backing != HugePageBacking::kREGULAR)
+    {
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mapping.data) % pageBytes, 0);
+    }
+    std::memset(mapping.data, 1, mapping.size);
+    unmapHugePages(mapping.data, pageBytes + 1);
+}
+
+TEST_F(TllmBuffersTest, HugePageHostAllocator)
+{
+    auto constexpr size = std::size_t{3} << 20;
+    HugePageHostAllocator allocator{};
+    auto& counters = MemoryCounters::getInstance();
+    EXPECT_EQ(counters.getCpu(), 0);
+    auto ptr = allocator.allocate(size);
+    EXPECT_NE(ptr, nullptr);
+    EXPECT_EQ(counters.getCpu(), size);
+    std::memset(ptr, 1, size);
+    EXPECT_NO_THROW(allocator.deallocate(ptr, size));
+    EXPECT_EQ(counters.getCpu(), 0);
+    EXPECT_EQ(allocator.getMemoryType(), MemoryType::kCPU);
+}
+
+TEST_F(TllmBuffersTest, HugePagePinnedAllocator)
+{
+    auto constexpr size = std::size_t{3} << 20;
+    HugePagePinnedAllocator allocator{};
+    auto& counters = MemoryCounters::getInstance();
+    EXPECT_EQ(counters.getPinned(), 0);
+    auto ptr = allocator.allocate(size);
+    EXPECT_NE(ptr, nullptr);
+    EXPECT_EQ(counters.getPinned(), size);
+
+    cudaPointerAttributes attributes{};
+    TLLM_CUDA_CHECK(::cudaPointerGetAttributes(&attributes, ptr));
+    EXPECT_EQ(attributes.type, cudaMemoryTypeHost);
+    std::memset(ptr, 1, size);
+    {
+        StaticDeviceBuffer device{size, nvinfer1::DataType::kINT8};
+        TLLM_CUDA_CHECK(::cudaMemcpy(device.data(), ptr, size, cudaMemcpyHostToDevice));
+        TLLM_CUDA_CHECK(::cudaMemcpy(ptr, device.data(), size, cudaMemcpyDeviceToHost));
+    }
+
+    EXPECT_NO_THROW(allocator.deallocate(ptr, size));
+    EXPECT_EQ(counters.getPinned(), 0);
+    EXPECT_EQ(allocator.getMemoryType(), MemoryType::kPINNED);
+}
+
 TEST_F(TllmBuffersTest, UVMAllocator)
 {
     auto constexpr size = 1024;
@@ -25,6 +25,7 @@
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/executor/executor.h"
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
+#include "tensorrt_llm/runtime/executorRouter.h"
 #include <cxxopts.hpp>
 
 namespace tle = tensorrt_llm::executor;
@@ -52,12 +53,13 @@ struct RuntimeOptions
 RuntimeOptions parseArgs(int argc, char* argv[]);
 
 // Function that enqueues requests
-std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(
-    RuntimeOptions const& runtimeOpts, std::deque<tle::Executor>& executors);
+std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(RuntimeOptions const& runtimeOpts,
+    std::deque<tle::Executor>& executors, tensorrt_llm::runtime::ExecutorRouter& router);
 
 // Function that waits for responses and stores output tokens
 std::map<std::pair<int32_t, tle::IdType>, tle::BeamTokens> waitForResponses(RuntimeOptions const& runtimeOpts,
-    std::vector<std::pair<int32_t, tle::IdType>> const& instanceRequestIds, std::deque<tle::Executor>& executors);
+    std::vector<std::pair<int32_t, tle::IdType>> const& instanceRequestIds, std::deque<tle::Executor>& executors,
+    tensorrt_llm::runtime::ExecutorRouter& router);
 
 // Utility function to read input tokens from csv file
 std::vector<tle::VecTokens> readInputTokens(std::string const& path);
@@ -116,11 +118,15 @@ int main(int argc, char* argv[])
     // Only orchestrator rank (rank 0) will enter
     if (isOrchestrator)
     {
+        // Route requests sharing a prompt prefix to the same instance, so that they can reuse its KV cache
+        tensorrt_llm::runtime::ExecutorRouter router(
+            numInstances, tensorrt_llm::runtime::ExecutorRouter::Policy::kPREFIX_AFFINITY);
+
         // Create the requests
-        auto instanceRequestIds = enqueueRequests(runtimeOpts, executors);
+        auto instanceRequestIds = enqueueRequests(runtimeOpts, executors, router);
 
         // Wait for responses and store output tokens
-        auto outputTokens = waitForResponses(runtimeOpts, instanceRequestIds, executors);
+        auto outputTokens = waitForResponses(runtimeOpts, instanceRequestIds, executors, router);
 
         // Write output tokens csv file
         TLLM_LOG_INFO("Writing output tokens to %s", runtimeOpts.outputTokensCsvFile.c_str());
@@ -202,8 +208,8 @@ RuntimeOptions parseArgs(int argc, char* argv[])
     return runtimeOpts;
 }
 
-std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(
-    RuntimeOptions const& runtimeOpts, std::deque<tle::Executor>& executors)
+std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(RuntimeOptions const& runtimeOpts,
+    std::deque<tle::Executor>& executors, tensorrt_llm::runtime::ExecutorRouter& router)
 {
     tle::OutputConfig outputConfig;
     outputConfig.excludeInputFromOutput = runtimeOpts.excludeInputFromOutput;
@@ -222,11 +228,11 @@ std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(
     }
 
     // Enqueue the requests
-    // Round robin over instances
+    // Pick the instances with the router
     std::vector<std::pair<int32_t, tle::IdType>> instanceRequestIds;
     for (size_t req = 0; req < requests.size(); ++req)
     {
-        auto instanceId = req % executors.size();
+        auto instanceId = router.route(requests[req].getInputTokenIds());
         TLLM_LOG_INFO("Enqueuing request %d for instance %d", req, instanceId);
         auto requestId = executors.at(instanceId).enqueueRequest(requests[req]);
         instanceRequestIds.emplace_back(instanceId, requestId);
@@ -236,7 +242,8 @@ std::vector<std::pair<int32_t, tle::IdType>> enqueueRequests(
 }
 
 std::map<std::pair<int32_t, tle::IdType>, tle::BeamTokens> waitForResponses(RuntimeOptions const& runtimeOpts,
-    std::vector<std::pair<int32_t, tle::IdType>> const& instanceRequestIds, std::deque<tle::Executor>& executors)
+    std::vector<std::pair<int32_t, tle::IdType>> const& instanceRequestIds, std::deque<tle::Executor>& executors,
+    tensorrt_llm::runtime::ExecutorRouter& router)
 {
     // Map that will be used to store output tokens for requests
     int numRequests = 0;
@@ -282,6 +289,8 @@ std::map<std::pair<int32_t, tle::IdType>, tle::BeamTokens> waitForResponses(Runt
                     if (result.isFinal)
                     {
                         TLLM_LOG_INFO("Request id %lu is completed.", requestId);
+                        // The request no longer counts towards the load of its instance
+                        router.onFinished(static_cast<tle::SizeType32>(instanceId));
                     }
                 }
                 else